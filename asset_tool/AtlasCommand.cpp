@@ -0,0 +1,321 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "AtlasPacker.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		const uint32_t churn_size = 2048;
+		const uint32_t churn_steps = 5000;
+
+		// what a ui and effects heavy scene brings: square icons, sprites of any shape, a few larger decals and
+		// lots of tiny glyphs
+		void RandomSize( std::mt19937& rng, bool small_only, uint32_t& width, uint32_t& height )
+		{
+			const uint32_t kind = rng( ) % 100;
+			if ( kind < 40 )
+			{
+				width = height = 16u << ( rng( ) % 3 );
+			}
+			else if ( kind < 70 )
+			{
+				width = 24 + rng( ) % 137;
+				height = 24 + rng( ) % 137;
+			}
+			else if ( kind < 85 && !small_only )
+			{
+				width = 64 + rng( ) % 193;
+				height = 64 + rng( ) % 193;
+			}
+			else
+			{
+				width = 6 + rng( ) % 35;
+				height = 10 + rng( ) % 39;
+			}
+		}
+
+		template <typename Pack>
+		double BestOf( int runs, Pack pack )
+		{
+			double best = 1e30;
+			for ( int run = 0; run < runs; ++run )
+			{
+				Timer timer;
+				pack( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+
+		// every image's texels and padding hold its id, which nothing else wrote over
+		bool VerifyAtlas( const DXLayer::AtlasPacker& packer, const std::vector<uint32_t>& atlas )
+		{
+			const DXLayer::AtlasOptions& options = packer.Options( );
+			for ( uint32_t image = 0; image < packer.ImageSlots( ); ++image )
+			{
+				if ( !packer.Contains( image ) )
+					continue;
+				const DXLayer::AtlasRect rect = packer.Rect( image );
+				if ( rect.x < options.padding || rect.y < options.padding ||
+					rect.x + rect.width + options.padding > options.width || rect.y + rect.height + options.padding > options.height )
+				{
+					std::fprintf( stderr, "image %u at %u,%u %ux%u is outside the atlas\n", image, rect.x, rect.y, rect.width, rect.height );
+					return false;
+				}
+				for ( uint32_t y = rect.y - options.padding; y < rect.y + rect.height + options.padding; ++y )
+				{
+					for ( uint32_t x = rect.x - options.padding; x < rect.x + rect.width + options.padding; ++x )
+					{
+						if ( atlas[y * options.width + x] != image )
+						{
+							std::fprintf( stderr, "image %u at %u,%u %ux%u has texel %u,%u of image %u\n", image, rect.x, rect.y, rect.width, rect.height, x, y, atlas[y * options.width + x] );
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		void WriteImage( const DXLayer::AtlasPacker& packer, uint32_t image, std::vector<uint32_t>& atlas, std::vector<uint32_t>& texels )
+		{
+			const DXLayer::AtlasRect rect = packer.Rect( image );
+			texels.assign( rect.width * rect.height, image );
+			DXLayer::BlitAtlasImage( reinterpret_cast<uint8_t*>( atlas.data( ) ), packer.Options( ).width * 4, rect, packer.Options( ).padding,
+				reinterpret_cast<const uint8_t*>( texels.data( ) ), rect.width * 4 );
+		}
+
+		// all sources into scratch first, as the gpu copies would go, then the destinations
+		void ApplyMoves( const std::vector<DXLayer::AtlasMove>& moves, uint32_t atlas_width, std::vector<uint32_t>& atlas, std::vector<uint32_t>& scratch )
+		{
+			scratch.clear( );
+			for ( const DXLayer::AtlasMove& move : moves )
+			{
+				for ( uint32_t y = 0; y < move.source.height; ++y )
+				{
+					const uint32_t* row = &atlas[( move.source.y + y ) * atlas_width + move.source.x];
+					scratch.insert( scratch.end( ), row, row + move.source.width );
+				}
+			}
+			const uint32_t* source = scratch.data( );
+			for ( const DXLayer::AtlasMove& move : moves )
+			{
+				for ( uint32_t y = 0; y < move.destination.height; ++y, source += move.source.width )
+					std::memcpy( &atlas[( move.destination.y + y ) * atlas_width + move.destination.x], source, move.source.width * 4 );
+			}
+		}
+
+		// a gradient blitted into a small atlas and read back through its uv transform at every texel center,
+		// nearest, and the padding holding the edge texels
+		bool CheckUvTransforms( )
+		{
+			DXLayer::AtlasOptions options;
+			options.width = options.height = 256;
+			options.padding = 3;
+			DXLayer::AtlasPacker packer;
+			packer.Init( options );
+			std::vector<uint32_t> atlas( options.width * options.height ), texels;
+			const uint32_t sizes[] = { 37, 21, 5, 64, 100, 9, 1, 1, 48, 48 };
+			for ( uint32_t i = 0; i < 5; ++i )
+			{
+				const uint32_t image = packer.Add( sizes[i * 2], sizes[i * 2 + 1] );
+				if ( image == DXLayer::AtlasPacker::invalid_image )
+					return false;
+				const uint32_t width = sizes[i * 2], height = sizes[i * 2 + 1];
+				texels.resize( width * height );
+				for ( uint32_t t = 0; t < texels.size( ); ++t )
+					texels[t] = image << 24 | t;
+				DXLayer::BlitAtlasImage( reinterpret_cast<uint8_t*>( atlas.data( ) ), options.width * 4, packer.Rect( image ), options.padding,
+					reinterpret_cast<const uint8_t*>( texels.data( ) ), width * 4 );
+
+				const DXLayer::AtlasUvTransform transform = packer.UvTransform( image );
+				const DXLayer::AtlasRect rect = packer.Rect( image );
+				for ( uint32_t y = 0; y < height; ++y )
+				{
+					for ( uint32_t x = 0; x < width; ++x )
+					{
+						const float u = ( x + 0.5f ) / width * transform.scale_u + transform.offset_u;
+						const float v = ( y + 0.5f ) / height * transform.scale_v + transform.offset_v;
+						const uint32_t texel = atlas[uint32_t( v * options.height ) * options.width + uint32_t( u * options.width )];
+						if ( texel != ( image << 24 | ( y * width + x ) ) )
+						{
+							std::fprintf( stderr, "image %u texel %u,%u reads %08x through its uv transform\n", image, x, y, texel );
+							return false;
+						}
+					}
+				}
+				for ( uint32_t p = 1; p <= options.padding; ++p )
+				{
+					const uint32_t corner = atlas[( rect.y - p ) * options.width + rect.x - p];
+					const uint32_t right = atlas[( rect.y + height - 1 ) * options.width + rect.x + width - 1 + p];
+					if ( corner != ( image << 24 ) || right != ( image << 24 | ( width * height - 1 ) ) )
+					{
+						std::fprintf( stderr, "image %u padding %u doesn't repeat its edge\n", image, p );
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	int BenchAtlasCommand( int argc, char** argv )
+	{
+		const uint32_t image_count = argc > 0 ? std::max( 1u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 2000;
+		if ( !CheckUvTransforms( ) )
+			return 1;
+
+		// packed offline: everything known up front into a 4096 wide atlas, as short as it can be. Its height is
+		// searched for, a packer that can't fill the bottom of a tall atlas gets the same chance as one that can
+		std::mt19937 rng( 11 );
+		std::vector<uint32_t> sizes( image_count * 2 ), images( image_count );
+		uint64_t image_area = 0;
+		for ( uint32_t i = 0; i < image_count; ++i )
+		{
+			RandomSize( rng, false, sizes[i * 2], sizes[i * 2 + 1] );
+			image_area += uint64_t( sizes[i * 2] ) * sizes[i * 2 + 1];
+		}
+		std::printf( "%u images, %.1f Mtexels, packed into the shortest 4096 wide atlas they fit\n\n", image_count, image_area / 1e6 );
+		std::printf( "%-9s %7s %-9s %7s %7s %8s %10s\n", "packer", "padding", "order", "height", "fill", "padded", "pack ms" );
+		const char* const packing_names[] = { "skyline", "max rects" };
+		for ( uint32_t packing = 0; packing < 2; ++packing )
+		{
+			for ( uint32_t padding = 0; padding <= 2; padding += 2 )
+			{
+				for ( uint32_t batch = 0; batch < 2; ++batch )
+				{
+					DXLayer::AtlasOptions options;
+					options.padding = padding;
+					options.packing = DXLayer::AtlasPacking( packing );
+					DXLayer::AtlasPacker packer;
+					const auto pack = [ & ] ( uint32_t height )
+					{
+						options.height = height;
+						packer.Init( options );
+						if ( batch )
+							return packer.AddBatch( sizes.data( ), image_count, images.data( ) );
+						for ( uint32_t i = 0; i < image_count; ++i )
+						{
+							if ( packer.Add( sizes[i * 2], sizes[i * 2 + 1] ) == DXLayer::AtlasPacker::invalid_image )
+								return false;
+						}
+						return true;
+					};
+					uint32_t low = 0, high = 1 << 16;
+					while ( high - low > 16 )
+					{
+						const uint32_t height = ( low + high ) / 2 & ~15u;
+						( pack( height ) ? high : low ) = height;
+					}
+					const double ms = BestOf( 3, [ & ] ( ) { pack( high ); } );
+					std::vector<uint32_t> atlas( size_t( options.width ) * options.height ), texels;
+					for ( uint32_t image = 0; image < packer.ImageSlots( ); ++image )
+						WriteImage( packer, image, atlas, texels );
+					if ( packer.Stats( ).image_count != image_count || !VerifyAtlas( packer, atlas ) )
+					{
+						std::fprintf( stderr, "%s didn't pack the images right\n", packing_names[packing] );
+						return 1;
+					}
+
+					const DXLayer::AtlasStats stats = packer.Stats( );
+					const double used_area = double( options.width ) * stats.used_height;
+					std::printf( "%-9s %7u %-9s %7u %6.1f%% %7.1f%% %10.2f\n", packing_names[packing], padding, batch ? "largest" : "arrival", stats.used_height,
+						100.0 * stats.image_area / used_area, 100.0 * stats.padded_area / used_area, ms );
+				}
+			}
+		}
+
+		// at runtime: a fixed atlas with images coming and going, repacked whenever a new one doesn't fit
+		std::printf( "\n%ux%u atlas, padding 2, %u steps of one image out and one in, repacked when one doesn't fit\n\n", churn_size, churn_size, churn_steps );
+		std::printf( "%-9s %6s %7s %8s %8s %9s %9s %9s %6s\n", "packer", "images", "fill", "repacks", "moves", "moved MB", "repack ms", "worst ms", "full" );
+		for ( uint32_t packing = 0; packing < 2; ++packing )
+		{
+			DXLayer::AtlasOptions options;
+			options.width = options.height = churn_size;
+			options.packing = DXLayer::AtlasPacking( packing );
+			DXLayer::AtlasPacker packer;
+			packer.Init( options );
+			std::vector<uint32_t> atlas( churn_size * churn_size, DXLayer::AtlasPacker::invalid_image ), scratch, texels, live;
+			std::vector<DXLayer::AtlasMove> moves;
+			rng.seed( 17 );
+
+			// filled until the first image that doesn't fit
+			uint32_t width, height;
+			for ( ;; )
+			{
+				RandomSize( rng, true, width, height );
+				const uint32_t image = packer.Add( width, height );
+				if ( image == DXLayer::AtlasPacker::invalid_image )
+					break;
+				WriteImage( packer, image, atlas, texels );
+				live.push_back( image );
+			}
+
+			uint32_t repacks = 0, full = 0;
+			uint64_t move_count = 0, moved_texels = 0;
+			double repack_ms = 0.0, worst_ms = 0.0, fill = 0.0;
+			for ( uint32_t step = 0; step < churn_steps; ++step )
+			{
+				const uint32_t slot = rng( ) % live.size( );
+				packer.Remove( live[slot] );
+				live[slot] = live.back( );
+				live.pop_back( );
+
+				RandomSize( rng, true, width, height );
+				uint32_t image = packer.Add( width, height );
+				if ( image == DXLayer::AtlasPacker::invalid_image )
+				{
+					Timer timer;
+					const bool repacked = packer.Repack( moves );
+					const double ms = timer.Milliseconds( );
+					if ( repacked )
+					{
+						++repacks;
+						repack_ms += ms;
+						worst_ms = std::max( worst_ms, ms );
+						move_count += moves.size( );
+						for ( const DXLayer::AtlasMove& move : moves )
+							moved_texels += uint64_t( move.source.width ) * move.source.height;
+						ApplyMoves( moves, churn_size, atlas, scratch );
+						if ( !VerifyAtlas( packer, atlas ) )
+						{
+							std::fprintf( stderr, "%s repack %u moved images wrong\n", packing_names[packing], repacks );
+							return 1;
+						}
+						image = packer.Add( width, height );
+					}
+				}
+				if ( image == DXLayer::AtlasPacker::invalid_image )
+				{
+					++full;
+					continue;
+				}
+				WriteImage( packer, image, atlas, texels );
+				live.push_back( image );
+				const DXLayer::AtlasStats stats = packer.Stats( );
+				fill += double( stats.image_area ) / ( double( churn_size ) * churn_size );
+			}
+			if ( !VerifyAtlas( packer, atlas ) )
+			{
+				std::fprintf( stderr, "%s lost an image\n", packing_names[packing] );
+				return 1;
+			}
+
+			const double placed = std::max( 1.0, double( churn_steps - full ) );
+			std::printf( "%-9s %6u %6.1f%% %8u %8.1f %9.2f %9.2f %9.2f %6u\n", packing_names[packing], uint32_t( live.size( ) ), 100.0 * fill / placed, repacks,
+				move_count / std::max( 1.0, double( repacks ) ), moved_texels * 4.0 / ( 1 << 20 ) / std::max( 1u, repacks ), repack_ms / std::max( 1u, repacks ), worst_ms, full );
+		}
+		std::printf( "\nfill is the images' own texels over the atlas, padded with padding and alignment, moves and moved MB are per repack,\n"
+			"full the new images that didn't fit even after a repack and were dropped\n" );
+		return 0;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+
+// counts the checks of a check- command and reports the ones that fail with what they got and what was expected
+
+namespace AssetTool
+{
+	struct Check
+	{
+		int failed = 0;
+		int count = 0;
+
+		void operator( )( bool passed, const char* name, long long got = 0, long long expected = 0 )
+		{
+			++count;
+			if ( passed )
+				return;
+			std::fprintf( stderr, "%s: got %lld, expected %lld\n", name, got, expected );
+			++failed;
+		}
+
+		// prints the totals, returns the exit code
+		int Report( const char* what ) const
+		{
+			std::printf( "%d %s checks, %d failed\n", count, what, failed );
+			return failed ? 1 : 0;
+		}
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// every asset_tool command is a function taking the arguments after the command name.
+// Returns the process exit code
+
+namespace AssetTool
+{
+	struct Command
+	{
+		const char* name;
+		const char* usage;
+		int ( *run )( int argc, char** argv );
+	};
+
+	int OptimizeCommand( int argc, char** argv );
+	int BenchOptimizeCommand( int argc, char** argv );
+	int BenchMeshletsCommand( int argc, char** argv );
+	int SimplifyCommand( int argc, char** argv );
+	int BenchSimplifyCommand( int argc, char** argv );
+	int ConvertCommand( int argc, char** argv );
+	int BenchMeshLoadCommand( int argc, char** argv );
+	int BenchCodecCommand( int argc, char** argv );
+	int BenchStreamingCommand( int argc, char** argv );
+	int BenchPoolCommand( int argc, char** argv );
+	int PackCommand( int argc, char** argv );
+	int BenchPackCommand( int argc, char** argv );
+	int BenchSubresourceCommand( int argc, char** argv );
+	int CheckFootprintsCommand( int argc, char** argv );
+	int BenchUploadBatchCommand( int argc, char** argv );
+	int BenchTextureLoadCommand( int argc, char** argv );
+	int CompressTextureCommand( int argc, char** argv );
+	int BenchBcCommand( int argc, char** argv );
+	int CheckMipsCommand( int argc, char** argv );
+	int BenchMipsCommand( int argc, char** argv );
+	int BenchVirtualTextureCommand( int argc, char** argv );
+	int BenchAtlasCommand( int argc, char** argv );
+	int CheckReadbackCommand( int argc, char** argv );
+	int BenchDynamicGeometryCommand( int argc, char** argv );
+	int CheckRootSignaturesCommand( int argc, char** argv );
+	int CheckVertexLayoutsCommand( int argc, char** argv );
+	int CheckCBufferLayoutsCommand( int argc, char** argv );
+	int CheckPerDrawCommand( int argc, char** argv );
+	int BenchPerDrawCommand( int argc, char** argv );
+	int CheckShaderWatcherCommand( int argc, char** argv );
+	int CheckVertexEncodingCommand( int argc, char** argv );
+	int BenchVertexEncodingCommand( int argc, char** argv );
+	int CheckIndexPackingCommand( int argc, char** argv );
+}
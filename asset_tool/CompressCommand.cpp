@@ -0,0 +1,248 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BcEncoder.h"
+#include "FileMapping.h"
+#include "ImageFile.h"
+#include "MipGenerator.h"
+#include "TestImages.h"
+#include "TextureFile.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		struct BcFormatName
+		{
+			const char* name;
+			uint32_t format;		// DXGI_FORMAT
+			uint32_t srgb_format;	// 0 when there's none
+			uint32_t channels;		// what error is measured on, bits for r, g, b, a
+		};
+
+		const BcFormatName bc_formats[] = {
+			{ "bc1", 71, 72, 0x7 },
+			{ "bc3", 77, 78, 0xf },
+			{ "bc4", 80, 0, 0x1 },
+			{ "bc5", 83, 0, 0x3 },
+			{ "bc7", 98, 99, 0xf },
+		};
+
+		const char* const quality_names[] = { "fast", "normal", "high" };
+
+		const BcFormatName* FindFormat( const char* name )
+		{
+			for ( const BcFormatName& format : bc_formats )
+			{
+				if ( std::strcmp( format.name, name ) == 0 )
+					return &format;
+			}
+			return nullptr;
+		}
+
+		size_t BlockRowPitch( uint32_t format, uint32_t width )
+		{
+			return size_t( ( width + 3 ) / 4 ) * DXLayer::BcBlockBytes( format );
+		}
+
+		std::vector<uint8_t> Compress( uint32_t format, const Image& image, const DXLayer::BcEncodeOptions& options )
+		{
+			std::vector<uint8_t> blocks( BlockRowPitch( format, image.width ) * ( ( image.height + 3 ) / 4 ) );
+			const DXLayer::BcImage source = { image.texels.data( ), image.width, image.height, size_t( image.width ) * 4 };
+			DXLayer::EncodeBcImage( format, source, blocks.data( ), BlockRowPitch( format, image.width ), options );
+			return blocks;
+		}
+
+		// over the channels the format keeps. BC1 leaves out texels it stores as transparent
+		double Psnr( const Image& original, const Image& decoded, uint32_t channels, bool skip_transparent )
+		{
+			double sum = 0.0;
+			size_t count = 0;
+			for ( size_t i = 0; i < original.texels.size( ); i += 4 )
+			{
+				if ( skip_transparent && original.texels[i + 3] < 128 )
+					continue;
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					if ( !( channels & ( 1 << c ) ) )
+						continue;
+					const double d = double( original.texels[i + c] ) - double( decoded.texels[i + c] );
+					sum += d * d;
+					++count;
+				}
+			}
+			if ( !count || sum == 0.0 )
+				return 99.0;
+			return 10.0 * std::log10( 255.0 * 255.0 / ( sum / count ) );
+		}
+
+		// blocks holds every level, largest first
+		bool SaveDds( const char* path, uint32_t format, const Image& image, uint32_t mip_levels, const std::vector<uint8_t>& blocks )
+		{
+			const DXLayer::TextureLayoutDesc desc = { DXLayer::texture_2d, image.width, image.height, 1, mip_levels, format };
+			uint8_t header[DXLayer::dds_header_size];
+			uint64_t data_size;
+			if ( !DXLayer::WriteDdsHeader( desc, false, header, data_size ) || data_size != blocks.size( ) )
+				return false;
+			FILE* file = std::fopen( path, "wb" );
+			if ( !file )
+				return false;
+			const bool written = std::fwrite( header, 1, sizeof( header ), file ) == sizeof( header ) &&
+				std::fwrite( blocks.data( ), 1, blocks.size( ), file ) == blocks.size( );
+			return std::fclose( file ) == 0 && written;
+		}
+	}
+
+	int CompressTextureCommand( int argc, char** argv )
+	{
+		if ( argc < 2 )
+		{
+			std::fprintf( stderr, "compress-texture needs an input image and an output dds\n" );
+			return 1;
+		}
+		const BcFormatName* format_name = FindFormat( argc > 2 ? argv[2] : "bc7" );
+		DXLayer::BcEncodeOptions options;
+		options.thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+		bool srgb = false, mips = false;
+		for ( int arg = 3; arg < argc; ++arg )
+		{
+			if ( std::strcmp( argv[arg], "--srgb" ) == 0 )
+				srgb = true;
+			if ( std::strcmp( argv[arg], "--mips" ) == 0 )
+				mips = true;
+			for ( uint32_t quality = 0; quality < 3; ++quality )
+			{
+				if ( std::strcmp( argv[arg], quality_names[quality] ) == 0 )
+					options.quality = DXLayer::BcQuality( quality );
+			}
+		}
+		if ( !format_name || ( srgb && !format_name->srgb_format ) )
+		{
+			std::fprintf( stderr, "unknown format, or one without an srgb variant: bc1, bc3, bc4, bc5 or bc7\n" );
+			return 1;
+		}
+
+		Image image;
+		std::string error;
+		if ( !LoadImageFile( argv[0], image, error ) )
+		{
+			std::fprintf( stderr, "%s\n", error.c_str( ) );
+			return 1;
+		}
+		const uint32_t format = srgb ? format_name->srgb_format : format_name->format;
+		Timer timer;
+		std::vector<uint8_t> blocks = Compress( format, image, options );
+		const uint32_t mip_levels = mips ? DXLayer::FullMipCount( image.width, image.height ) : 1;
+		if ( mips )
+		{
+			// the chain is filtered from the texels, each level compressed on its own
+			std::vector<Image> levels( mip_levels );
+			std::vector<DXLayer::SubresourceDestination> destinations( mip_levels );
+			for ( uint32_t mip = 0; mip < mip_levels; ++mip )
+			{
+				levels[mip].width = std::max( 1u, image.width >> mip );
+				levels[mip].height = std::max( 1u, image.height >> mip );
+				levels[mip].texels.resize( size_t( levels[mip].width ) * levels[mip].height * 4 );
+				destinations[mip] = { levels[mip].texels.data( ), size_t( levels[mip].width ) * 4, levels[mip].texels.size( ) };
+			}
+			DXLayer::MipOptions mip_options;
+			mip_options.filter = DXLayer::mip_filter_kaiser;
+			mip_options.srgb = srgb;
+			mip_options.thread_count = options.thread_count;
+			const DXLayer::MipSource source = { image.texels.data( ), size_t( image.width ) * 4 };
+			DXLayer::GenerateMips( &source, 1, image.width, image.height, mip_levels, destinations.data( ), mip_options );
+			for ( uint32_t mip = 1; mip < mip_levels; ++mip )
+			{
+				const std::vector<uint8_t> level_blocks = Compress( format, levels[mip], options );
+				blocks.insert( blocks.end( ), level_blocks.begin( ), level_blocks.end( ) );
+			}
+		}
+		const double ms = timer.Milliseconds( );
+		if ( !SaveDds( argv[1], format, image, mip_levels, blocks ) )
+		{
+			std::fprintf( stderr, "can't write %s\n", argv[1] );
+			return 1;
+		}
+
+		Image decoded = image;
+		DXLayer::DecodeBcImage( format, blocks.data( ), BlockRowPitch( format, image.width ), decoded.texels.data( ), image.width, image.height, size_t( image.width ) * 4 );
+		std::printf( "%s: %ux%u %s %s, %u levels, %.1f ms, %.1f dB at the top\n", argv[1], image.width, image.height, format_name->name, quality_names[options.quality], mip_levels, ms,
+			Psnr( image, decoded, format_name->channels, format_name->format == 71 ) );
+		return 0;
+	}
+
+	int BenchBcCommand( int argc, char** argv )
+	{
+		const uint32_t size = argc > 0 ? std::max( 4u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 512;
+		const uint32_t thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+		const std::vector<TestImage> images = MakeTestImages( size );
+		const double megapixels = double( size ) * size * images.size( ) / 1e6;
+
+		std::printf( "%zu images of %ux%u, Mpixels/s over all of them and PSNR in dB on the channels each format keeps\n", images.size( ), size, size );
+		std::printf( "%-4s %-7s %9s %9s ", "", "", "1 thread", "threads" );
+		for ( const TestImage& test : images )
+			std::printf( " %8s", test.name );
+		std::printf( "\n" );
+
+		for ( const BcFormatName& format_name : bc_formats )
+		{
+			for ( uint32_t quality = 0; quality < 3; ++quality )
+			{
+				DXLayer::BcEncodeOptions options;
+				options.quality = DXLayer::BcQuality( quality );
+				std::vector<std::vector<uint8_t>> compressed( images.size( ) );
+				Timer timer;
+				for ( size_t i = 0; i < images.size( ); ++i )
+					compressed[i] = Compress( format_name.format, images[i].image, options );
+				const double ms = timer.Milliseconds( );
+
+				options.thread_count = thread_count;
+				Timer threads_timer;
+				for ( size_t i = 0; i < images.size( ); ++i )
+				{
+					// the threads split the same work, so the blocks have to come out the same
+					if ( Compress( format_name.format, images[i].image, options ) != compressed[i] )
+					{
+						std::fprintf( stderr, "%s %s: threaded blocks differ from single threaded ones\n", format_name.name, quality_names[quality] );
+						return 1;
+					}
+				}
+				const double threads_ms = threads_timer.Milliseconds( );
+
+				std::printf( "%-4s %-7s %9.2f %9.2f ", format_name.name, quality_names[quality], megapixels / ms * 1e3, megapixels / threads_ms * 1e3 );
+				for ( size_t i = 0; i < images.size( ); ++i )
+				{
+					Image decoded = images[i].image;
+					DXLayer::DecodeBcImage( format_name.format, compressed[i].data( ), BlockRowPitch( format_name.format, size ), decoded.texels.data( ), size, size, size_t( size ) * 4 );
+					std::printf( " %8.2f", Psnr( images[i].image, decoded, format_name.channels, format_name.format == 71 ) );
+				}
+				std::printf( "\n" );
+			}
+		}
+
+		// the dds the asset build writes has to come back through the loader the renderer uses, block for block
+		const char* path = "bench_bc.dds";
+		const std::vector<uint8_t> blocks = Compress( 98, images[1].image, DXLayer::BcEncodeOptions( ) );
+		DXLayer::FileMapping mapping;
+		DXLayer::TextureFileView view;
+		std::string error;
+		if ( !SaveDds( path, 98, images[1].image, 1, blocks ) || !mapping.Open( path ) || !DXLayer::ReadTextureFile( mapping.Data( ), mapping.Size( ), view, error ) ||
+			view.layout.format != 98 || view.subresource_count != 1 || std::memcmp( DXLayer::TextureFileSource( view, 0 ).data, blocks.data( ), blocks.size( ) ) != 0 )
+		{
+			std::fprintf( stderr, "the bc7 dds doesn't load back: %s\n", error.c_str( ) );
+			return 1;
+		}
+		mapping.Close( );
+		std::remove( path );
+		return 0;
+	}
+}
@@ -0,0 +1,125 @@
+#include "Commands.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "ConstantBufferLayout.h"
+#include "ShaderConstants.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		using namespace DXLayer;
+
+		// a cbuffer and the offsets and size fxc reports for it in the shader reflection
+		struct PackingCase
+		{
+			const char* hlsl;
+			std::vector<uint32_t> offsets;
+			uint32_t size;
+			uint32_t cbv_size;
+			std::vector<uint32_t> got;
+			uint32_t got_size;
+			uint32_t got_cbv_size;
+		};
+
+		template<typename Layout, uint32_t... Indices>
+		std::vector<uint32_t> Offsets( std::integer_sequence<uint32_t, Indices...> )
+		{
+			return { Layout::template Member<Indices>::offset... };
+		}
+
+		template<typename Layout>
+		PackingCase Case( const char* hlsl, std::vector<uint32_t> offsets, uint32_t size, uint32_t cbv_size = 256 )
+		{
+			return { hlsl, std::move( offsets ), size, cbv_size, Offsets<Layout>( std::make_integer_sequence<uint32_t, Layout::num_members>( ) ),
+				Layout::size, Layout::cbv_size };
+		}
+
+		typedef CBufferLayout<hlsl::float1, hlsl::Array<hlsl::float1, 3>, hlsl::float1> ArrayLayout;
+		enum { array_before, array_values, array_after };
+	}
+
+	int CheckCBufferLayoutsCommand( int, char** )
+	{
+		Check check;
+
+		const PackingCase cases[] = {
+			Case<CBufferLayout<hlsl::float4, hlsl::float2, hlsl::float2>>( "float4 a; float2 b; float2 c;", { 0, 16, 24 }, 32 ),
+			Case<CBufferLayout<hlsl::float2, hlsl::float4, hlsl::float2>>( "float2 a; float4 b; float2 c;", { 0, 16, 32 }, 48 ),
+			Case<CBufferLayout<hlsl::float1, hlsl::float2, hlsl::float3>>( "float a; float2 b; float3 c;", { 0, 4, 16 }, 32 ),
+			Case<CBufferLayout<hlsl::float3, hlsl::float1, hlsl::float2>>( "float3 a; float b; float2 c;", { 0, 12, 16 }, 32 ),
+			Case<CBufferLayout<hlsl::float1, hlsl::float3>>( "float a; float3 b;", { 0, 4 }, 16 ),
+			Case<CBufferLayout<hlsl::float3, hlsl::float3>>( "float3 a; float3 b;", { 0, 16 }, 32 ),
+			Case<CBufferLayout<hlsl::uint2, hlsl::uint3>>( "uint2 a; uint3 b;", { 0, 16 }, 32 ),
+			Case<CBufferLayout<hlsl::int1, hlsl::uint4>>( "int a; uint4 b;", { 0, 16 }, 32 ),
+			Case<CBufferLayout<hlsl::Array<hlsl::float1, 4>, hlsl::float2>>( "float a[4]; float2 b;", { 0, 52 }, 64 ),
+			Case<CBufferLayout<hlsl::float1, hlsl::Array<hlsl::float2, 2>, hlsl::float1>>( "float a; float2 b[2]; float c;", { 0, 16, 40 }, 48 ),
+			Case<ArrayLayout>( "float a; float b[3]; float c;", { 0, 16, 52 }, 64 ),
+			Case<CBufferLayout<hlsl::Array<hlsl::float4, 2>, hlsl::float1>>( "float4 a[2]; float b;", { 0, 32 }, 48 ),
+			Case<CBufferLayout<hlsl::float2, hlsl::float4x4, hlsl::float1>>( "float2 a; float4x4 b; float c;", { 0, 16, 80 }, 96 ),
+			Case<CBufferLayout<hlsl::float4x4, hlsl::float3, hlsl::float1>>( "float4x4 a; float3 b; float c;", { 0, 64, 76 }, 80 ),
+			Case<CBufferLayout<hlsl::Array<hlsl::float4x4, 2>, hlsl::float2>>( "float4x4 a[2]; float2 b;", { 0, 128 }, 144 ),
+			Case<CBufferLayout<hlsl::Array<hlsl::float4, 16>>>( "float4 a[16];", { 0 }, 256 ),
+			Case<CBufferLayout<hlsl::Array<hlsl::float4, 16>, hlsl::float1>>( "float4 a[16]; float b;", { 0, 256 }, 272, 512 ),
+			Case<PerDrawLayout>( "cbuffer PerDraw in vertex.hlsl", { 0, 12, 16, 28, 32 }, 48 ),
+		};
+		for ( const auto& c : cases )
+		{
+			const std::string name = std::string( "packing of " ) + c.hlsl;
+			check( c.got.size( ) == c.offsets.size( ), name.c_str( ), (long long)( c.got.size( ) ), (long long)( c.offsets.size( ) ) );
+			for ( size_t i = 0; i < c.offsets.size( ) && i < c.got.size( ); ++i )
+				check( c.got[i] == c.offsets[i], name.c_str( ), c.got[i], c.offsets[i] );
+			check( c.got_size == c.size, ( name + ", size" ).c_str( ), c.got_size, c.size );
+			check( c.got_cbv_size == c.cbv_size, ( name + ", cbv size" ).c_str( ), c.got_cbv_size, c.cbv_size );
+		}
+
+		// the writer puts each value at its offset, and leaves the padding between members alone
+		{
+			uint8_t memory[PerDrawLayout::size];
+			std::memset( memory, 0xcd, sizeof( memory ) );
+			CBufferWriter<PerDrawLayout> writer( memory );
+			writer.Set<PerDrawLayout::bounds_center>( DirectX::XMFLOAT3( 1.0f, 2.0f, 3.0f ) );
+			writer.Set<PerDrawLayout::object_index>( 7 );
+			writer.Set<PerDrawLayout::bounds_extent>( DirectX::XMFLOAT3( 4.0f, 5.0f, 6.0f ) );
+			writer.Set<PerDrawLayout::material_index>( 9 );
+			writer.Set<PerDrawLayout::tint>( DirectX::XMFLOAT4( 0.5f, 0.25f, 0.125f, 1.0f ) );
+			float floats[12];
+			uint32_t uints[12];
+			std::memcpy( floats, memory, sizeof( floats ) );
+			std::memcpy( uints, memory, sizeof( uints ) );
+			check( floats[0] == 1.0f && floats[2] == 3.0f && uints[3] == 7 && floats[4] == 4.0f && floats[6] == 6.0f && uints[7] == 9 &&
+				floats[8] == 0.5f && floats[11] == 1.0f, "per draw writes" );
+		}
+		{
+			uint8_t memory[ArrayLayout::size];
+			std::memset( memory, 0xcd, sizeof( memory ) );
+			CBufferWriter<ArrayLayout> writer( memory );
+			const float values[3] = { 1.0f, 2.0f, 3.0f };
+			writer.Set<array_before>( 0.5f );
+			writer.SetArray<array_values>( values, 3 );
+			writer.Set<array_after>( 4.0f );
+			// a, then b[0..2] each at the start of a register, c right after b[2]
+			const uint32_t member_offsets[] = { 0, 16, 32, 48, 52 };
+			uint32_t padding_written = 0;
+			for ( uint32_t i = 0; i < sizeof( memory ); ++i )
+			{
+				bool member = false;
+				for ( uint32_t offset : member_offsets )
+					member |= i >= offset && i < offset + 4;
+				padding_written += !member && memory[i] != 0xcd;
+			}
+			float element = 0.0f, after = 0.0f;
+			std::memcpy( &element, memory + 48, sizeof( element ) );
+			std::memcpy( &after, memory + 52, sizeof( after ) );
+			check( element == 3.0f && after == 4.0f, "array element at its register" );
+			check( padding_written == 0, "array writes leave the padding alone", padding_written, 0 );
+		}
+
+		return check.Report( "cbuffer layout" );
+	}
+}
@@ -0,0 +1,229 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameAllocator.h"
+#include "RunOnThreads.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		const uint32_t frame_count = 3;
+		const uint32_t batch_particles = 256;
+
+		// what a particle system writes for each quad corner
+		struct ParticleVertex
+		{
+			float position[3];
+			uint32_t color;
+			float uv[2];
+		};
+
+		template <typename Run>
+		double BestOf( int runs, Run run )
+		{
+			double best = 1e30;
+			for ( int r = 0; r < runs; ++r )
+			{
+				Timer timer;
+				run( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+
+		void WriteQuad( uint32_t particle, ParticleVertex* vertices )
+		{
+			const float x = float( particle % 1024 ), y = float( particle / 1024 ), size = 0.5f + ( particle % 7 ) * 0.25f;
+			const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 1.0f } };
+			for ( uint32_t c = 0; c < 4; ++c )
+			{
+				ParticleVertex& vertex = vertices[c];
+				vertex.position[0] = x + corners[c][0] * size;
+				vertex.position[1] = y + corners[c][1] * size;
+				vertex.position[2] = 1.0f;
+				vertex.color = particle;
+				vertex.uv[0] = corners[c][0];
+				vertex.uv[1] = corners[c][1];
+			}
+		}
+
+		// the mutex and bump pointer FrameAllocator replaces, for comparison
+		struct LockedAllocator
+		{
+			std::mutex mutex;
+			uint64_t begin = 0;
+			uint64_t used = 0;
+			uint64_t size = 0;
+
+			uint64_t Allocate( uint64_t bytes, uint64_t alignment )
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				const uint64_t offset = ( begin + used + alignment - 1 ) & ~( alignment - 1 );
+				if ( offset + bytes > begin + size )
+					return DXLayer::FrameAllocator::invalid_offset;
+				used = offset + bytes - begin;
+				return offset;
+			}
+		};
+
+		enum WriteMode
+		{
+			write_shared,		// every batch allocated from the shared allocator
+			write_cursor,		// every thread through its own cursor
+			write_staged		// written into an array first, then copied into the upload memory like a static upload
+		};
+
+		// one frame of particles written by thread_count threads, each batch's offset kept for the check
+		bool WriteParticles( DXLayer::FrameAllocator& allocator, std::vector<uint8_t>& upload, uint32_t particle_count, uint32_t thread_count,
+			WriteMode mode, std::vector<uint64_t>& batch_offsets )
+		{
+			const uint32_t batch_count = ( particle_count + batch_particles - 1 ) / batch_particles;
+			batch_offsets.assign( batch_count, DXLayer::FrameAllocator::invalid_offset );
+			std::atomic<bool> full( false );
+			DXLayer::RunOnThreads( thread_count, [ & ] ( uint32_t thread )
+			{
+				DXLayer::FrameAllocatorCursor cursor( allocator, 256 * 1024 );
+				std::vector<ParticleVertex> staging( batch_particles * 4 );
+				for ( uint32_t batch = thread; batch < batch_count; batch += thread_count )
+				{
+					const uint32_t first = batch * batch_particles;
+					const uint32_t count = std::min( batch_particles, particle_count - first );
+					const uint64_t bytes = uint64_t( count ) * 4 * sizeof( ParticleVertex );
+					const uint64_t offset = mode == write_cursor ? cursor.Allocate( bytes, 16 ) : allocator.Allocate( bytes, 16 );
+					if ( offset == DXLayer::FrameAllocator::invalid_offset )
+					{
+						full = true;
+						break;
+					}
+					batch_offsets[batch] = offset;
+					ParticleVertex* vertices = reinterpret_cast<ParticleVertex*>( &upload[offset] );
+					if ( mode == write_staged )
+					{
+						for ( uint32_t p = 0; p < count; ++p )
+							WriteQuad( first + p, &staging[p * 4] );
+						std::memcpy( vertices, staging.data( ), size_t( bytes ) );
+						continue;
+					}
+					// a whole quad at a time, built on the stack and streamed out
+					for ( uint32_t p = 0; p < count; ++p )
+					{
+						ParticleVertex quad[4];
+						WriteQuad( first + p, quad );
+						DXLayer::StreamStore( &vertices[p * 4], quad, sizeof( quad ) );
+					}
+				}
+				DXLayer::StreamFence( );
+			} );
+			return !full.load( );
+		}
+
+		// every particle's quad where its batch says, so no two batches got the same memory
+		bool VerifyParticles( const std::vector<uint8_t>& upload, uint32_t particle_count, const std::vector<uint64_t>& batch_offsets )
+		{
+			ParticleVertex expected[4];
+			for ( uint32_t particle = 0; particle < particle_count; ++particle )
+			{
+				const uint64_t offset = batch_offsets[particle / batch_particles];
+				if ( offset == DXLayer::FrameAllocator::invalid_offset || offset % 16 )
+					return false;
+				WriteQuad( particle, expected );
+				if ( std::memcmp( &upload[offset + ( particle % batch_particles ) * sizeof( expected )], expected, sizeof( expected ) ) )
+					return false;
+			}
+			return true;
+		}
+	}
+
+	int BenchDynamicGeometryCommand( int argc, char** argv )
+	{
+		const uint32_t particle_count = argc > 0 ? std::max( 1u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 1 << 20;
+		const uint64_t frame_bytes = uint64_t( particle_count ) * 4 * sizeof( ParticleVertex );
+		const uint64_t size_per_frame = frame_bytes + ( frame_bytes >> 3 ) + ( 4 << 20 );
+
+		// allocations alone: small pieces, one thread, from the shared allocator, a cursor and a locked bump pointer.
+		// std::mutex doesn't lock at all until the process has started a thread, which would make it look free
+		std::thread( [ ] ( ) { } ).join( );
+		{
+			const uint32_t allocation_count = 1 << 22;
+			DXLayer::FrameAllocator allocator;
+			allocator.Init( 64 << 20, frame_count );
+			LockedAllocator locked;
+			locked.size = 64 << 20;
+			uint64_t sum = 0;
+			const auto run = [ & ] ( int kind )
+			{
+				uint32_t frame = 0;
+				allocator.BeginFrame( frame );
+				locked.begin = 0;
+				locked.used = 0;
+				DXLayer::FrameAllocatorCursor cursor( allocator );
+				for ( uint32_t i = 0; i < allocation_count; ++i )
+				{
+					const uint64_t bytes = 64 + ( i & 3 ) * 64;
+					uint64_t offset = kind == 0 ? allocator.Allocate( bytes, 16 ) : kind == 1 ? cursor.Allocate( bytes, 16 ) : locked.Allocate( bytes, 16 );
+					if ( offset == DXLayer::FrameAllocator::invalid_offset )
+					{
+						allocator.BeginFrame( ++frame );
+						locked.begin = ( frame % frame_count ) * locked.size;
+						locked.used = 0;
+						offset = kind == 0 ? allocator.Allocate( bytes, 16 ) : kind == 1 ? cursor.Allocate( bytes, 16 ) : locked.Allocate( bytes, 16 );
+					}
+					sum += offset;
+				}
+			};
+			const double shared_ms = BestOf( 3, [ & ] ( ) { run( 0 ); } );
+			const double cursor_ms = BestOf( 3, [ & ] ( ) { run( 1 ); } );
+			const double locked_ms = BestOf( 3, [ & ] ( ) { run( 2 ); } );
+			std::printf( "%u allocations of 64 to 256 bytes on one thread (%llu)\n", allocation_count, (unsigned long long)( sum & 1 ) );
+			std::printf( "  compare and swap %7.1f M/s\n  cursor           %7.1f M/s\n  mutex            %7.1f M/s\n\n", allocation_count / shared_ms / 1e3,
+				allocation_count / cursor_ms / 1e3, allocation_count / locked_ms / 1e3 );
+		}
+
+		// particles: quads written straight into the upload memory they're drawn from, against writing them into an
+		// array first and copying that in, what going through a static upload costs the cpu before the gpu copy and
+		// barrier. One frame's region is enough to write into
+		DXLayer::FrameAllocator allocator;
+		allocator.Init( size_per_frame, 1 );
+		std::vector<uint8_t> upload( static_cast<size_t>( size_per_frame ) );
+		std::vector<uint64_t> batch_offsets;
+		const uint32_t hardware_threads = std::max( 4u, std::thread::hardware_concurrency( ) );
+		std::printf( "%u particles, %u vertices of %u bytes, %.1f MB a frame in batches of %u\n\n", particle_count, particle_count * 4,
+			uint32_t( sizeof( ParticleVertex ) ), frame_bytes / double( 1 << 20 ), batch_particles );
+		std::printf( "%-10s %7s %9s %9s %9s\n", "writes", "threads", "frame ms", "GB/s", "used MB" );
+		const char* const mode_names[] = { "shared", "cursor", "staged" };
+		for ( uint32_t mode = 0; mode < 3; ++mode )
+		{
+			const uint32_t thread_counts[] = { 1, hardware_threads };
+			for ( uint32_t thread_count : thread_counts )
+			{
+				uint32_t frame = 0;
+				bool written = true;
+				const double ms = BestOf( 5, [ & ] ( )
+				{
+					allocator.BeginFrame( frame++ );
+					written &= WriteParticles( allocator, upload, particle_count, thread_count, WriteMode( mode ), batch_offsets );
+				} );
+				if ( !written || !VerifyParticles( upload, particle_count, batch_offsets ) )
+				{
+					std::fprintf( stderr, "%s writes on %u threads lost particles\n", mode_names[mode], thread_count );
+					return 1;
+				}
+				std::printf( "%-10s %7u %9.2f %9.2f %9.1f\n", mode_names[mode], thread_count, ms, frame_bytes / ms / 1e6, allocator.FrameUsed( ) / double( 1 << 20 ) );
+			}
+		}
+		std::printf( "\nshared and cursor stream each quad straight into the upload memory, allocating every batch from the shared allocator\n"
+			"or a cursor per thread, staged writes a batch into an array and copies it in. used is the frame's region taken, the cursors\n"
+			"leave the ends of their %u KB chunks\n", 256 );
+		return 0;
+	}
+}
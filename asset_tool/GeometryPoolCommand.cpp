@@ -0,0 +1,226 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "GeometryPool.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		const uint32_t vertex_stride = 16;	// CompactVertexNormal
+		const uint32_t index_size = 2;
+
+		// cpu stand-ins for the pool buffers, one word per element. Every element holds a value only its mesh
+		// can have, so a mesh that was moved wrong or overwritten by another one shows up in Verify
+		struct SimulatedPool
+		{
+			DXLayer::GeometryPool pool;
+			std::vector<uint32_t> vertices;
+			std::vector<uint32_t> indices;
+			std::vector<uint32_t> live;			// geometry ids
+			std::vector<uint32_t> serials;		// per geometry id, what its data was filled from
+			uint32_t next_serial;
+
+			SimulatedPool( uint32_t vertex_capacity, uint32_t index_capacity )
+				: vertices( vertex_capacity ), indices( index_capacity ), next_serial( 1 )
+			{
+				pool.Init( vertex_capacity, vertex_stride, index_capacity, index_size );
+			}
+
+			static uint32_t Value( uint32_t serial, uint32_t element, uint32_t buffer )
+			{
+				return ( serial * 2654435761u ) ^ ( element * 40503u ) ^ ( buffer << 31 );
+			}
+
+			bool Allocate( uint32_t vertex_count, uint32_t index_count )
+			{
+				const uint32_t geometry = pool.Allocate( vertex_count, index_count );
+				if ( geometry == DXLayer::GeometryPool::invalid_geometry )
+					return false;
+
+				if ( serials.size( ) <= geometry )
+					serials.resize( geometry + 1 );
+				serials[geometry] = next_serial++;
+				const DXLayer::GeometryRange& range = pool.Range( geometry );
+				for ( uint32_t v = 0; v < range.vertex_count; ++v )
+					vertices[range.first_vertex + v] = Value( serials[geometry], v, 0 );
+				for ( uint32_t i = 0; i < range.index_count; ++i )
+					indices[range.first_index + i] = Value( serials[geometry], i, 1 );
+				live.push_back( geometry );
+				return true;
+			}
+
+			void Free( size_t live_slot )
+			{
+				pool.Free( live[live_slot] );
+				live[live_slot] = live.back( );
+				live.pop_back( );
+			}
+
+			// in order, memmove semantics, the way GeometryPoolBuffers applies them
+			uint64_t Apply( const std::vector<DXLayer::GeometryMove>& moves )
+			{
+				uint64_t bytes = 0;
+				for ( const auto& move : moves )
+				{
+					std::vector<uint32_t>& buffer = move.buffer == DXLayer::geometry_vertices ? vertices : indices;
+					std::copy( buffer.begin( ) + move.source, buffer.begin( ) + move.source + move.count, buffer.begin( ) + move.destination );
+					bytes += pool.MoveBytes( move );
+				}
+				return bytes;
+			}
+
+			bool Verify( ) const
+			{
+				for ( uint32_t geometry : live )
+				{
+					const DXLayer::GeometryRange& range = pool.Range( geometry );
+					for ( uint32_t v = 0; v < range.vertex_count; ++v )
+						if ( vertices[range.first_vertex + v] != Value( serials[geometry], v, 0 ) )
+							return false;
+					for ( uint32_t i = 0; i < range.index_count; ++i )
+						if ( indices[range.first_index + i] != Value( serials[geometry], i, 1 ) )
+							return false;
+				}
+				return true;
+			}
+		};
+
+		// streamed-in static meshes: log uniform between 64 and 16k vertices, about two triangles per vertex
+		void RandomMesh( std::mt19937& rng, uint32_t& vertex_count, uint32_t& index_count )
+		{
+			vertex_count = uint32_t( 64.0 * std::pow( 256.0, std::uniform_real_distribution<double>( 0.0, 1.0 )( rng ) ) );
+			index_count = vertex_count * 6;
+		}
+
+		void PrintStats( const char* label, const SimulatedPool& simulated )
+		{
+			const DXLayer::GeometryPoolStats stats = simulated.pool.Stats( );
+			std::printf( "  %-22s %5u meshes, %4.1f%% of vertices used in %4u free blocks (%4.1f%% fragmented), indices %4.1f%% in %4u (%4.1f%%)\n", label,
+				stats.mesh_count, 100.0 * stats.vertices_used / simulated.pool.VertexCapacity( ), stats.vertex_free_blocks, 100.0f * stats.vertex_fragmentation,
+				100.0 * stats.indices_used / simulated.pool.IndexCapacity( ), stats.index_free_blocks, 100.0f * stats.index_fragmentation );
+		}
+	}
+
+	int BenchPoolCommand( int argc, char** argv )
+	{
+		const uint32_t vertex_capacity = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 4u << 20;
+		const uint32_t index_capacity = vertex_capacity * 6;
+		const uint64_t budget_bytes = 1 << 20;
+		std::printf( "geometry pool: %u vertices of %u bytes, %u indices of %u bytes\n", vertex_capacity, vertex_stride, index_capacity, index_size );
+
+		SimulatedPool simulated( vertex_capacity, index_capacity );
+		std::mt19937 rng( 7 );
+		uint32_t vertex_count, index_count;
+
+		// fill to about 80%, then churn: every step frees a random mesh and streams in a new one
+		while ( simulated.pool.Stats( ).vertices_used < vertex_capacity / 10 * 8 )
+		{
+			RandomMesh( rng, vertex_count, index_count );
+			if ( !simulated.Allocate( vertex_count, index_count ) )
+				break;
+		}
+
+		// the pool on its own first, on a copy of the filled state
+		const int churn_steps = 200000;
+		{
+			DXLayer::GeometryPool pool = simulated.pool;
+			std::vector<uint32_t> live = simulated.live;
+			std::mt19937 churn_rng( 11 );
+			Timer pool_timer;
+			for ( int step = 0; step < churn_steps; ++step )
+			{
+				const size_t slot = std::uniform_int_distribution<size_t>( 0, live.size( ) - 1 )( churn_rng );
+				pool.Free( live[slot] );
+				live[slot] = live.back( );
+				live.pop_back( );
+				RandomMesh( churn_rng, vertex_count, index_count );
+				const uint32_t geometry = pool.Allocate( vertex_count, index_count );
+				if ( geometry != DXLayer::GeometryPool::invalid_geometry )
+					live.push_back( geometry );
+			}
+			const double pool_ms = pool_timer.Milliseconds( );
+			std::printf( "  churn: %d frees and allocations in %.1f ms, %.2f M operations/s\n", churn_steps, pool_ms, 2.0 * churn_steps / pool_ms / 1000.0 );
+		}
+
+		// then with data in the simulated buffers, checked at the end
+		const int verified_steps = 20000;
+		int failed = 0;
+		for ( int step = 0; step < verified_steps; ++step )
+		{
+			simulated.Free( std::uniform_int_distribution<size_t>( 0, simulated.live.size( ) - 1 )( rng ) );
+			RandomMesh( rng, vertex_count, index_count );
+			failed += !simulated.Allocate( vertex_count, index_count );
+		}
+		if ( !simulated.Verify( ) )
+		{
+			std::fprintf( stderr, "mesh data overlaps after churn\n" );
+			return 1;
+		}
+		std::printf( "  %d more steps with mesh data, %d meshes didn't fit\n", verified_steps, failed );
+		PrintStats( "after churn", simulated );
+
+		// how much of the free space a single mesh could use, compared with after compaction
+		const DXLayer::GeometryPoolStats churned = simulated.pool.Stats( );
+
+		// incremental defragmentation, a budget per frame like the renderer runs it
+		std::vector<DXLayer::GeometryMove> moves;
+		uint64_t defragment_bytes = 0;
+		int frames = 0;
+		double defragment_ms = 0.0;
+		for ( ; frames < 1000; ++frames )
+		{
+			Timer plan_timer;
+			simulated.pool.Defragment( budget_bytes, moves );
+			defragment_ms += plan_timer.Milliseconds( );
+			if ( moves.empty( ) )
+				break;
+			defragment_bytes += simulated.Apply( moves );
+			if ( !simulated.Verify( ) )
+			{
+				std::fprintf( stderr, "mesh data broken by defragmentation in frame %d\n", frames );
+				return 1;
+			}
+		}
+		std::printf( "  defragment: %d frames at %.1f MB each, %.1f MB moved, %.3f ms planning per frame\n",
+			frames, budget_bytes / 1048576.0, defragment_bytes / 1048576.0, frames ? defragment_ms / frames : 0.0 );
+		PrintStats( "after defragment", simulated );
+
+		// full compaction, batch by batch
+		uint64_t compact_bytes = 0;
+		int batches = 0;
+		Timer compact_timer;
+		for ( ;; ++batches )
+		{
+			simulated.pool.Compact( budget_bytes, moves );
+			if ( moves.empty( ) )
+				break;
+			compact_bytes += simulated.Apply( moves );
+		}
+		const double compact_ms = compact_timer.Milliseconds( );
+		if ( !simulated.Verify( ) )
+		{
+			std::fprintf( stderr, "mesh data broken by compaction\n" );
+			return 1;
+		}
+		const DXLayer::GeometryPoolStats compacted = simulated.pool.Stats( );
+		std::printf( "  compact: %d batches, %.1f MB moved, %.1f ms with the copies\n", batches, compact_bytes / 1048576.0, compact_ms );
+		PrintStats( "after compact", simulated );
+		if ( compacted.vertex_free_blocks > 1 || compacted.index_free_blocks > 1 )
+		{
+			std::fprintf( stderr, "compaction left gaps\n" );
+			return 1;
+		}
+
+		std::printf( "  free vertices in one block: %4.1f%% after churn, %4.1f%% after compaction\n",
+			100.0 * ( 1.0 - churned.vertex_fragmentation ), 100.0 * ( 1.0 - compacted.vertex_fragmentation ) );
+		return 0;
+	}
+}
@@ -0,0 +1,121 @@
+#include "ImageFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace AssetTool
+{
+	namespace
+	{
+		bool Fail( std::string& error, const std::string& message )
+		{
+			error = message;
+			return false;
+		}
+
+		// the next whitespace separated token of a netpbm header, skipping comments
+		bool ReadToken( FILE* file, std::string& token )
+		{
+			token.clear( );
+			int c = std::fgetc( file );
+			for ( ;; )
+			{
+				while ( c == ' ' || c == '\t' || c == '\r' || c == '\n' )
+					c = std::fgetc( file );
+				if ( c != '#' )
+					break;
+				while ( c != '\n' && c != EOF )
+					c = std::fgetc( file );
+			}
+			while ( c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' )
+			{
+				token += char( c );
+				c = std::fgetc( file );
+			}
+			// the single whitespace character after the header is consumed with the last token
+			return !token.empty( );
+		}
+
+		bool ReadNumber( FILE* file, uint32_t& value )
+		{
+			std::string token;
+			if ( !ReadToken( file, token ) || token.find_first_not_of( "0123456789" ) != std::string::npos || token.size( ) > 9 )
+				return false;
+			value = uint32_t( std::strtoul( token.c_str( ), nullptr, 10 ) );
+			return true;
+		}
+	}
+
+	bool LoadImageFile( const std::string& path, Image& image, std::string& error )
+	{
+		FILE* file = std::fopen( path.c_str( ), "rb" );
+		if ( !file )
+			return Fail( error, "can't open " + path );
+
+		std::string token;
+		uint32_t channels = 0, max_value = 0;
+		image.width = image.height = 0;
+		bool ok = ReadToken( file, token );
+		if ( ok && token == "P6" )
+		{
+			channels = 3;
+			ok = ReadNumber( file, image.width ) && ReadNumber( file, image.height ) && ReadNumber( file, max_value );
+		}
+		else if ( ok && token == "P7" )
+		{
+			while ( ( ok = ReadToken( file, token ) ) && token != "ENDHDR" )
+			{
+				if ( token == "WIDTH" )
+					ok = ReadNumber( file, image.width );
+				else if ( token == "HEIGHT" )
+					ok = ReadNumber( file, image.height );
+				else if ( token == "DEPTH" )
+					ok = ReadNumber( file, channels );
+				else if ( token == "MAXVAL" )
+					ok = ReadNumber( file, max_value );
+				else if ( token == "TUPLTYPE" )
+					ok = ReadToken( file, token );
+				if ( !ok )
+					break;
+			}
+		}
+		else
+		{
+			ok = false;
+		}
+		if ( !ok || !image.width || !image.height || channels < 1 || channels > 4 || max_value != 255 || image.width > 65536 || image.height > 65536 )
+		{
+			std::fclose( file );
+			return Fail( error, path + " isn't an 8 bit binary ppm or pam" );
+		}
+
+		std::vector<uint8_t> raw( size_t( image.width ) * image.height * channels );
+		const bool read = std::fread( raw.data( ), 1, raw.size( ), file ) == raw.size( );
+		std::fclose( file );
+		if ( !read )
+			return Fail( error, path + " is truncated" );
+
+		// gray, gray alpha, rgb, rgba
+		image.texels.resize( size_t( image.width ) * image.height * 4 );
+		for ( size_t i = 0, count = size_t( image.width ) * image.height; i < count; ++i )
+		{
+			const uint8_t* in = &raw[i * channels];
+			uint8_t* out = &image.texels[i * 4];
+			out[0] = in[0];
+			out[1] = channels >= 3 ? in[1] : in[0];
+			out[2] = channels >= 3 ? in[2] : in[0];
+			out[3] = channels == 4 ? in[3] : channels == 2 ? in[1] : 255;
+		}
+		return true;
+	}
+
+	bool SaveImageFile( const std::string& path, const Image& image )
+	{
+		FILE* file = std::fopen( path.c_str( ), "wb" );
+		if ( !file )
+			return false;
+		std::fprintf( file, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", image.width, image.height );
+		const bool written = std::fwrite( image.texels.data( ), 1, image.texels.size( ), file ) == image.texels.size( );
+		return std::fclose( file ) == 0 && written;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// netpbm images for the texture pipeline, the one format every image tool can write without plugins:
+// binary ppm (P6) for rgb and pam (P7) for rgb, rgba, gray and gray with alpha, 8 bits per channel. Everything
+// is expanded to rgba8 on load
+
+namespace AssetTool
+{
+	struct Image
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> texels;	// rgba8, rows tightly packed
+	};
+
+	bool LoadImageFile( const std::string& path, Image& image, std::string& error );
+
+	// pam with all four channels
+	bool SaveImageFile( const std::string& path, const Image& image );
+}
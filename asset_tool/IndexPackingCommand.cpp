@@ -0,0 +1,178 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "IndexPacking.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		// triangles whose vertices lie in a window that walks through the vertex range, the local order of grids and
+		// optimized meshes. The first and last index pin the range to [base, base + vertex_count)
+		std::vector<uint32_t> LocalTriangles( uint32_t vertex_count, uint32_t triangle_count, uint32_t window, uint32_t base, uint32_t seed )
+		{
+			std::mt19937 rng( seed );
+			std::uniform_int_distribution<uint32_t> offset( 0, window - 1 );
+			std::vector<uint32_t> indices( size_t( triangle_count ) * 3 );
+			for ( uint32_t t = 0; t < triangle_count; ++t )
+			{
+				const uint32_t cursor = uint32_t( uint64_t( t ) * ( vertex_count - window ) / triangle_count );
+				for ( int corner = 0; corner < 3; ++corner )
+					indices[t * 3 + corner] = base + cursor + offset( rng );
+			}
+			indices.front( ) = base;
+			indices.back( ) = base + vertex_count - 1;
+			return indices;
+		}
+
+		std::vector<uint32_t> RandomTriangles( uint32_t vertex_count, uint32_t triangle_count, uint32_t seed )
+		{
+			std::mt19937 rng( seed );
+			std::uniform_int_distribution<uint32_t> vertex( 0, vertex_count - 1 );
+			std::vector<uint32_t> indices( size_t( triangle_count ) * 3 );
+			for ( auto& index : indices )
+				index = vertex( rng );
+			return indices;
+		}
+
+		// the vertex every index fetches once the input assembler added the chunk's BaseVertexLocation
+		std::vector<uint32_t> FetchedVertices( const DXLayer::PackedIndices& packed )
+		{
+			std::vector<uint32_t> fetched;
+			for ( const auto& chunk : packed.chunks )
+				for ( uint32_t i = chunk.first_index; i < chunk.first_index + chunk.index_count; ++i )
+				{
+					const uint32_t index = packed.index_size == 2 ? reinterpret_cast<const uint16_t*>( packed.data.data( ) )[i]
+						: reinterpret_cast<const uint32_t*>( packed.data.data( ) )[i];
+					fetched.push_back( uint32_t( int64_t( index ) + chunk.base_vertex ) );
+				}
+			return fetched;
+		}
+
+		// counts what's wrong with the chunks of a packed triangle list:
+		//	chunks that don't follow each other in order, whole triangles only, over all indices
+		//	16-bit chunks spanning max_chunk_vertices or more, or using the strip cut value
+		//	vertex_count not one past the highest index of the chunk
+		//	a chunk that ended although the next triangle would have fit, for splits the greedy rule made
+		int ChunkErrors( const uint32_t* indices, size_t index_count, const DXLayer::PackedIndices& packed )
+		{
+			int errors = 0;
+			uint32_t next_index = 0;
+			for ( size_t c = 0; c < packed.chunks.size( ); ++c )
+			{
+				const DXLayer::IndexChunk& chunk = packed.chunks[c];
+				errors += chunk.first_index != next_index || chunk.index_count % 3 != 0 || chunk.index_count == 0;
+				next_index = chunk.first_index + chunk.index_count;
+				if ( next_index > index_count )
+					return errors + 1;
+
+				uint32_t low = indices[chunk.first_index], high = low;
+				for ( uint32_t i = chunk.first_index; i < next_index; ++i )
+				{
+					low = std::min( low, indices[i] );
+					high = std::max( high, indices[i] );
+				}
+				if ( packed.index_size == 2 )
+					errors += int64_t( low ) != chunk.base_vertex || high - low >= DXLayer::max_chunk_vertices;
+				errors += int64_t( high ) - chunk.base_vertex + 1 != chunk.vertex_count;
+
+				if ( packed.index_size == 2 && c + 1 < packed.chunks.size( ) )
+				{
+					const uint32_t* next = indices + next_index;
+					const uint32_t merged_low = std::min( { low, next[0], next[1], next[2] } );
+					const uint32_t merged_high = std::max( { high, next[0], next[1], next[2] } );
+					errors += merged_high - merged_low < DXLayer::max_chunk_vertices;
+				}
+			}
+			return errors + ( next_index != index_count );
+		}
+
+		struct Case
+		{
+			std::string name;
+			std::vector<uint32_t> indices;
+			DXLayer::IndexPackingOptions options;
+			uint32_t index_size;	// what PackIndices should pick
+			size_t chunks;			// 0 when any count above 1 is right
+		};
+
+		DXLayer::IndexPackingOptions NoSplit( )
+		{
+			DXLayer::IndexPackingOptions options;
+			options.allow_split = false;
+			return options;
+		}
+
+		DXLayer::IndexPackingOptions No16Bit( )
+		{
+			DXLayer::IndexPackingOptions options;
+			options.allow_16bit = false;
+			return options;
+		}
+	}
+
+	int CheckIndexPackingCommand( int, char** )
+	{
+		Check check;
+
+		// a mesh of n vertices spans n - 1, so 65535 vertices are the most one 16-bit draw takes
+		std::vector<Case> cases;
+		cases.push_back( { "65534 vertices", LocalTriangles( 65534, 200000, 64, 0, 1 ), { }, 2, 1 } );
+		cases.push_back( { "65535 vertices", LocalTriangles( 65535, 200000, 64, 0, 2 ), { }, 2, 1 } );
+		cases.push_back( { "65536 vertices", LocalTriangles( 65536, 200000, 64, 0, 3 ), { }, 2, 2 } );
+		cases.push_back( { "65537 vertices", LocalTriangles( 65537, 200000, 64, 0, 4 ), { }, 2, 2 } );
+		cases.push_back( { "65535 from 1000000", LocalTriangles( 65535, 200000, 64, 1000000, 5 ), { }, 2, 1 } );
+		cases.push_back( { "65536, no split", LocalTriangles( 65536, 200000, 64, 0, 6 ), NoSplit( ), 4, 1 } );
+		cases.push_back( { "65534, no 16-bit", LocalTriangles( 65534, 200000, 64, 0, 7 ), No16Bit( ), 4, 1 } );
+		cases.push_back( { "4M local", LocalTriangles( 4 << 20, 8 << 20, 256, 0, 8 ), { }, 2, 0 } );
+		cases.push_back( { "4M local, wide window", LocalTriangles( 4 << 20, 8 << 20, 60000, 0, 9 ), { }, 2, 0 } );
+		cases.push_back( { "1M random", RandomTriangles( 1 << 20, 2 << 20, 10 ), { }, 4, 1 } );
+		cases.push_back( { "65535 random", RandomTriangles( 65535, 200000, 11 ), { }, 2, 1 } );
+
+		// a triangle spanning 65534 vertices fits a chunk, one spanning 65535 can't be split into one
+		std::vector<uint32_t> widest = LocalTriangles( 200000, 400000, 64, 0, 12 );
+		widest[300000] = 100000;
+		widest[300001] = 100000 + DXLayer::max_chunk_vertices - 1;
+		widest[300002] = 100000;
+		cases.push_back( { "widest triangle", widest, { }, 2, 0 } );
+		widest[300001] = 100000 + DXLayer::max_chunk_vertices;
+		cases.push_back( { "too wide triangle", widest, { }, 4, 1 } );
+
+		// too many chunks for the triangles: 1M vertices take 17, the options allow 2
+		DXLayer::IndexPackingOptions few_chunks;
+		few_chunks.min_triangles_per_chunk = 200000;
+		cases.push_back( { "too many chunks", LocalTriangles( 1 << 20, 400000, 64, 0, 13 ), few_chunks, 4, 1 } );
+
+		std::printf( "%-24s %10s %6s %7s %12s %12s\n", "", "triangles", "bits", "chunks", "bytes", "saved" );
+		for ( const Case& c : cases )
+		{
+			DXLayer::PackedIndices packed;
+			DXLayer::PackIndices( c.indices.data( ), c.indices.size( ), packed, c.options );
+			std::printf( "%-24s %10zu %6u %7zu %12zu %12zu\n", c.name.c_str( ), c.indices.size( ) / 3, packed.index_size * 8, packed.chunks.size( ),
+				packed.data.size( ), packed.BytesSaved( ) );
+
+			const std::string name = c.name + ", ";
+			check( packed.index_size == c.index_size, ( name + "index size" ).c_str( ), packed.index_size, c.index_size );
+			if ( c.chunks )
+				check( packed.chunks.size( ) == c.chunks, ( name + "chunks" ).c_str( ), (long long)( packed.chunks.size( ) ), (long long)( c.chunks ) );
+			check( FetchedVertices( packed ) == c.indices, ( name + "vertices fetched through BaseVertexLocation" ).c_str( ) );
+			const int errors = ChunkErrors( c.indices.data( ), c.indices.size( ), packed );
+			check( errors == 0, ( name + "chunk boundaries" ).c_str( ), errors, 0 );
+			const size_t saved = packed.index_size == 2 ? c.indices.size( ) * 2 : 0;
+			check( packed.BytesSaved( ) == saved, ( name + "bytes saved" ).c_str( ), (long long)( packed.BytesSaved( ) ), (long long)( saved ) );
+		}
+
+		// nothing to pack is 16-bit with no draws
+		DXLayer::PackedIndices empty;
+		DXLayer::PackIndices( nullptr, 0, empty );
+		check( empty.index_size == 2 && empty.chunks.empty( ) && empty.BytesSaved( ) == 0, "empty mesh" );
+
+		return check.Report( "index packing" );
+	}
+}
@@ -0,0 +1,584 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "AssetStreamer.h"
+#include "FileMapping.h"
+#include "MeshAsset.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "ObjFile.h"
+#include "PackFile.h"
+#include "TestMeshes.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		// everything a mesh asset holds, in the layout it's written in
+		struct CompiledMesh
+		{
+			DXLayer::MeshAssetInfo info;
+			std::vector<uint8_t> vertices;
+			DXLayer::PackedIndices indices;
+			std::vector<DXLayer::MeshLod> lods;
+			DXLayer::MeshletData meshlets;
+			std::vector<DXLayer::PackedMeshletBounds> meshlet_bounds;
+			std::vector<uint8_t> vertices_encoded;	// filled by CompressMesh, written instead of the raw streams then
+			std::vector<uint8_t> indices_encoded;
+		};
+
+		// CompactVertex or CompactVertexNormal, see VertexFormats.h. Color is white, obj has none
+		void EncodeVertices( const ObjMesh& mesh, uint32_t vertex_format, const DXLayer::MeshBounds& bounds, std::vector<uint8_t>& vertices )
+		{
+			const size_t stride = DXLayer::MeshVertexStride( vertex_format );
+			const size_t color_offset = vertex_format == DXLayer::mesh_vertex_compact_normal ? 12 : 8;
+			vertices.assign( mesh.vertices.size( ) * stride, 0xff );
+			if ( mesh.vertices.empty( ) )
+				return;
+
+			DXLayer::EncodePositionsSnorm16( mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ), bounds,
+				reinterpret_cast<int16_t*>( vertices.data( ) ), stride );
+			if ( vertex_format == DXLayer::mesh_vertex_compact_normal )
+				DXLayer::EncodeNormalsOct16( mesh.vertices[0].normal, sizeof( ObjVertex ), mesh.vertices.size( ),
+					reinterpret_cast<int16_t*>( vertices.data( ) + 8 ), stride );
+			for ( size_t v = 0; v < mesh.vertices.size( ); ++v )
+				std::memset( vertices.data( ) + v * stride + color_offset, 0xff, 4 );
+		}
+
+		// optimizes the mesh in place, then builds lods, meshlets of lod 0 and the gpu formats
+		void CompileMesh( ObjMesh& mesh, uint32_t vertex_format, CompiledMesh& out )
+		{
+			std::vector<uint32_t> indices( mesh.indices.size( ) );
+			DXLayer::OptimizeVertexCache( indices.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.size( ) );
+			DXLayer::OptimizeOverdraw( mesh.indices.data( ), indices.data( ), indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ) );
+			std::vector<ObjVertex> vertices( mesh.vertices.size( ) );
+			vertices.resize( DXLayer::OptimizeVertexFetch( vertices.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.data( ), mesh.vertices.size( ), sizeof( ObjVertex ) ) );
+			mesh.vertices.swap( vertices );
+
+			const float* positions = mesh.vertices[0].position;
+			std::vector<uint32_t> lod_indices;
+			DXLayer::BuildLodChain( mesh.indices.data( ), mesh.indices.size( ), positions, sizeof( ObjVertex ), mesh.vertices.size( ), lod_indices, out.lods );
+			DXLayer::PackIndices( lod_indices.data( ), lod_indices.size( ), out.indices );
+
+			DXLayer::BuildMeshlets( out.meshlets, mesh.indices.data( ), mesh.indices.size( ), positions, sizeof( ObjVertex ), mesh.vertices.size( ) );
+			out.meshlet_bounds = DXLayer::PackMeshletBounds( out.meshlets, positions, sizeof( ObjVertex ) );
+
+			out.info.vertex_format = vertex_format;
+			out.info.vertex_count = uint32_t( mesh.vertices.size( ) );
+			out.info.index_size = out.indices.index_size;
+			out.info.index_count = uint32_t( lod_indices.size( ) );
+			out.info.bounds = DXLayer::ComputeMeshBounds( positions, sizeof( ObjVertex ), mesh.vertices.size( ) );
+			EncodeVertices( mesh, vertex_format, out.info.bounds, out.vertices );
+		}
+
+		// the packed index buffer as 32-bit values, 16-bit chunks stay relative to their base vertex
+		std::vector<uint32_t> WidenIndices( const DXLayer::PackedIndices& packed )
+		{
+			std::vector<uint32_t> indices( packed.data.size( ) / packed.index_size );
+			for ( size_t i = 0; i < indices.size( ); ++i )
+			{
+				if ( packed.index_size == 2 )
+					indices[i] = reinterpret_cast<const uint16_t*>( packed.data.data( ) )[i];
+				else
+					indices[i] = reinterpret_cast<const uint32_t*>( packed.data.data( ) )[i];
+			}
+			return indices;
+		}
+
+		void CompressMesh( CompiledMesh& compiled )
+		{
+			DXLayer::EncodeVertexBuffer( compiled.vertices_encoded, compiled.vertices.data( ), compiled.info.vertex_count, DXLayer::MeshVertexStride( compiled.info.vertex_format ) );
+			const std::vector<uint32_t> indices = WidenIndices( compiled.indices );
+			DXLayer::EncodeIndexBuffer( compiled.indices_encoded, indices.data( ), indices.size( ) );
+		}
+
+		void AddSections( const CompiledMesh& compiled, DXLayer::MeshAssetWriter& writer )
+		{
+			writer.AddSection( DXLayer::mesh_section_info, sizeof( DXLayer::MeshAssetInfo ), &compiled.info, sizeof( compiled.info ) );
+			if ( compiled.vertices_encoded.empty( ) )
+			{
+				writer.AddSection( DXLayer::mesh_section_vertices, DXLayer::MeshVertexStride( compiled.info.vertex_format ), compiled.vertices.data( ), compiled.vertices.size( ) );
+				writer.AddSection( DXLayer::mesh_section_indices, compiled.indices.index_size, compiled.indices.data.data( ), compiled.indices.data.size( ) );
+			}
+			else
+			{
+				writer.AddSection( DXLayer::mesh_section_vertices_encoded, compiled.vertices_encoded );
+				writer.AddSection( DXLayer::mesh_section_indices_encoded, compiled.indices_encoded );
+			}
+			writer.AddSection( DXLayer::mesh_section_index_chunks, compiled.indices.chunks );
+			writer.AddSection( DXLayer::mesh_section_lods, compiled.lods );
+			writer.AddSection( DXLayer::mesh_section_meshlets, compiled.meshlets.meshlets );
+			writer.AddSection( DXLayer::mesh_section_meshlet_vertices, compiled.meshlets.vertices );
+			writer.AddSection( DXLayer::mesh_section_meshlet_triangles, compiled.meshlets.triangles );
+			writer.AddSection( DXLayer::mesh_section_meshlet_bounds, compiled.meshlet_bounds );
+		}
+
+		size_t FileSize( const char* path )
+		{
+			DXLayer::FileMapping mapping;
+			return mapping.Open( path ) ? mapping.Size( ) : 0;
+		}
+
+		std::string StreamingFilePath( uint32_t file )
+		{
+			return "bench_streaming_" + std::to_string( file ) + ".mesh";
+		}
+
+		// decodes into arena with index_size indices, the way the renderer's pool takes them
+		DXLayer::AssetStreamer::DecodeFn DecodeInto( DXLayer::UploadArena& arena, uint32_t index_size )
+		{
+			return [&arena, index_size] ( const uint8_t* data, size_t size, std::string& error )
+			{
+				return DXLayer::DecodeStreamedMesh( data, size, arena, index_size, error );
+			};
+		}
+
+		// what a decode left in upload memory against what was written into the asset. Encoded triangles may come
+		// back rotated
+		bool SameUpload( const DXLayer::StreamedMesh& mesh, const CompiledMesh& compiled )
+		{
+			const uint8_t* upload = mesh.upload.Data( );
+			if ( std::memcmp( upload, compiled.vertices.data( ), compiled.vertices.size( ) ) != 0 )
+				return false;
+
+			const auto index = [] ( const uint8_t* indices, uint32_t index_size, size_t i )
+			{
+				return index_size == 2 ? uint32_t( reinterpret_cast<const uint16_t*>( indices )[i] ) : reinterpret_cast<const uint32_t*>( indices )[i];
+			};
+			for ( size_t t = 0; t < mesh.info.index_count / 3; ++t )
+			{
+				bool same = false;
+				for ( int r = 0; r < 3; ++r )
+				{
+					bool rotation_same = true;
+					for ( int k = 0; k < 3; ++k )
+						rotation_same = rotation_same && index( upload + mesh.index_offset, mesh.info.index_size, t * 3 + k ) ==
+							index( compiled.indices.data.data( ), compiled.indices.index_size, t * 3 + ( r + k ) % 3 );
+					same = same || rotation_same;
+				}
+				if ( !same )
+					return false;
+			}
+			return true;
+		}
+
+		// a render loop in miniature: takes what's finished once per frame and notes the order it arrived in.
+		// Returns false if anything failed to load
+		bool DrainStreamer( DXLayer::AssetStreamer& streamer, size_t request_count, std::vector<uint32_t>& order, double& first_ms, double& last_ms )
+		{
+			const size_t frame_budget = 64 << 20;
+			std::vector<DXLayer::StreamResult> results;
+			Timer timer;
+			order.clear( );
+			while ( order.size( ) < request_count )
+			{
+				results.clear( );
+				streamer.TakeCompleted( frame_budget, results );
+				for ( const auto& result : results )
+				{
+					if ( !result.asset )
+					{
+						std::fprintf( stderr, "request %u failed: %s\n", result.request, result.error.c_str( ) );
+						return false;
+					}
+					if ( order.empty( ) )
+						first_ms = timer.Milliseconds( );
+					order.push_back( result.request );
+				}
+				if ( results.empty( ) )
+					std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+			}
+			last_ms = timer.Milliseconds( );
+			return true;
+		}
+
+		size_t ArrivalPosition( const std::vector<uint32_t>& order, uint32_t request )
+		{
+			return std::find( order.begin( ), order.end( ), request ) - order.begin( );
+		}
+	}
+
+	int ConvertCommand( int argc, char** argv )
+	{
+		bool normals = false;
+		bool compress = false;
+		for ( int i = 2; i < argc; ++i )
+		{
+			if ( std::strcmp( argv[i], "--normals" ) == 0 )
+				normals = true;
+			else if ( std::strcmp( argv[i], "--compress" ) == 0 )
+				compress = true;
+			else
+				argc = 0;
+		}
+		if ( argc < 2 )
+		{
+			std::fprintf( stderr, "usage: asset_tool convert <in.obj> <out.mesh> [--normals] [--compress]\n" );
+			return 1;
+		}
+		const uint32_t vertex_format = normals ? DXLayer::mesh_vertex_compact_normal : DXLayer::mesh_vertex_compact;
+
+		ObjMesh mesh;
+		std::string error;
+		if ( !LoadObj( argv[0], mesh, error ) )
+		{
+			std::fprintf( stderr, "%s\n", error.c_str( ) );
+			return 1;
+		}
+		if ( mesh.indices.empty( ) )
+		{
+			std::fprintf( stderr, "%s has no triangles\n", argv[0] );
+			return 1;
+		}
+
+		CompiledMesh compiled;
+		CompileMesh( mesh, vertex_format, compiled );
+		if ( compress )
+			CompressMesh( compiled );
+
+		DXLayer::MeshAssetWriter writer;
+		AddSections( compiled, writer );
+		if ( !writer.Save( argv[1] ) )
+		{
+			std::fprintf( stderr, "can't write %s\n", argv[1] );
+			return 1;
+		}
+
+		std::printf( "%s: %zu triangles, %u vertices, %zu lods, %zu meshlets, %u-bit indices in %zu draws (%zu bytes saved), %zu bytes\n", argv[1],
+			mesh.indices.size( ) / 3, compiled.info.vertex_count, compiled.lods.size( ), compiled.meshlets.meshlets.size( ),
+			compiled.info.index_size * 8, compiled.indices.chunks.size( ), compiled.indices.BytesSaved( ), FileSize( argv[1] ) );
+		return 0;
+	}
+
+	int BenchMeshLoadCommand( int argc, char** argv )
+	{
+		const uint32_t triangle_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 1000000;
+		const char* obj_path = "bench_mesh_load.obj";
+		const char* asset_path = "bench_mesh_load.mesh";
+
+		ObjMesh mesh = MakeTorus( triangle_count );
+		CompiledMesh compiled;
+		{
+			ObjMesh optimized = mesh;
+			CompileMesh( optimized, DXLayer::mesh_vertex_compact_normal, compiled );
+			DXLayer::MeshAssetWriter writer;
+			AddSections( compiled, writer );
+			if ( !SaveObj( obj_path, optimized ) || !writer.Save( asset_path ) )
+			{
+				std::fprintf( stderr, "can't write the bench files to the current directory\n" );
+				return 1;
+			}
+		}
+		std::printf( "torus: %zu triangles, obj %.1f MB, mesh asset %.1f MB (%zu lods, meshlets included)\n", mesh.indices.size( ) / 3,
+			FileSize( obj_path ) / 1048576.0, FileSize( asset_path ) / 1048576.0, compiled.lods.size( ) );
+
+		// stands in for mapped upload heap memory, touched up front like a persistently mapped buffer would be
+		std::vector<uint8_t> upload( compiled.vertices.size( ) + compiled.indices.data.size( ), 0 );
+
+		// best of several runs, both read from the page cache
+		const int run_count = 5;
+		double obj_ms = 1e30;
+		double asset_ms = 1e30;
+		for ( int run = 0; run < run_count; ++run )
+		{
+			// text: parse, then encode to the same gpu format. Lods, meshlets and packing would come on top
+			Timer obj_timer;
+			ObjMesh loaded;
+			std::string error;
+			if ( !LoadObj( obj_path, loaded, error ) )
+			{
+				std::fprintf( stderr, "%s\n", error.c_str( ) );
+				return 1;
+			}
+			std::vector<uint8_t> vertices;
+			EncodeVertices( loaded, DXLayer::mesh_vertex_compact_normal, DXLayer::ComputeMeshBounds( loaded.vertices[0].position, sizeof( ObjVertex ), loaded.vertices.size( ) ), vertices );
+			std::memcpy( upload.data( ), vertices.data( ), std::min( vertices.size( ), upload.size( ) ) );
+			obj_ms = std::min( obj_ms, obj_timer.Milliseconds( ) );
+
+			// binary: map, validate, copy the payloads
+			Timer asset_timer;
+			DXLayer::FileMapping mapping;
+			DXLayer::MeshAssetView view;
+			if ( !mapping.Open( asset_path ) || !DXLayer::ReadMeshAsset( mapping.Data( ), mapping.Size( ), view, error ) )
+			{
+				std::fprintf( stderr, "can't load %s: %s\n", asset_path, error.c_str( ) );
+				return 1;
+			}
+			DXLayer::CopyMeshAssetVertices( view, upload.data( ) );
+			DXLayer::CopyMeshAssetIndices( view, upload.data( ) + compiled.vertices.size( ) );
+			asset_ms = std::min( asset_ms, asset_timer.Milliseconds( ) );
+		}
+
+		std::printf( "  obj parse + encode  %8.1f ms\n", obj_ms );
+		std::printf( "  mesh asset map + copy %6.1f ms, %.2f GB/s of vertex and index data, %.0fx faster\n",
+			asset_ms, upload.size( ) / asset_ms / 1e6, obj_ms / asset_ms );
+
+		std::remove( obj_path );
+		std::remove( asset_path );
+		return 0;
+	}
+
+	int BenchCodecCommand( int argc, char** argv )
+	{
+		const uint32_t triangle_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 1000000;
+
+		ObjMesh mesh = MakeTorus( triangle_count );
+		std::printf( "torus: %zu triangles, %zu vertices, optimized\n", mesh.indices.size( ) / 3, mesh.vertices.size( ) );
+
+		CompiledMesh compiled;
+		CompileMesh( mesh, DXLayer::mesh_vertex_compact_normal, compiled );
+		const std::vector<uint32_t> indices = WidenIndices( compiled.indices );
+		const size_t vertex_size = DXLayer::MeshVertexStride( compiled.info.vertex_format );
+
+		// best of several runs. The destinations are touched up front, like a persistently mapped upload heap
+		const int run_count = 5;
+		std::vector<uint8_t> vertices_encoded, indices_encoded;
+		std::vector<uint8_t> destination( std::max( compiled.vertices.size( ), compiled.indices.data.size( ) ), 0 );
+		double vertex_encode_ms = 1e30, index_encode_ms = 1e30;
+		double vertex_decode_ms = 1e30, index_decode_ms = 1e30, vertex_copy_ms = 1e30, index_copy_ms = 1e30;
+		for ( int run = 0; run < run_count; ++run )
+		{
+			Timer vertex_encode_timer;
+			DXLayer::EncodeVertexBuffer( vertices_encoded, compiled.vertices.data( ), compiled.info.vertex_count, vertex_size );
+			vertex_encode_ms = std::min( vertex_encode_ms, vertex_encode_timer.Milliseconds( ) );
+
+			Timer index_encode_timer;
+			DXLayer::EncodeIndexBuffer( indices_encoded, indices.data( ), indices.size( ) );
+			index_encode_ms = std::min( index_encode_ms, index_encode_timer.Milliseconds( ) );
+
+			Timer vertex_decode_timer;
+			if ( !DXLayer::DecodeVertexBuffer( destination.data( ), compiled.info.vertex_count, vertex_size, vertices_encoded.data( ), vertices_encoded.size( ) ) ||
+				std::memcmp( destination.data( ), compiled.vertices.data( ), compiled.vertices.size( ) ) != 0 )
+			{
+				std::fprintf( stderr, "vertex buffer doesn't round trip\n" );
+				return 1;
+			}
+			vertex_decode_ms = std::min( vertex_decode_ms, vertex_decode_timer.Milliseconds( ) );
+
+			Timer index_decode_timer;
+			if ( !DXLayer::DecodeIndexBuffer( destination.data( ), indices.size( ), compiled.indices.index_size, compiled.info.vertex_count, indices_encoded.data( ), indices_encoded.size( ) ) )
+			{
+				std::fprintf( stderr, "index buffer doesn't decode\n" );
+				return 1;
+			}
+			index_decode_ms = std::min( index_decode_ms, index_decode_timer.Milliseconds( ) );
+
+			Timer vertex_copy_timer;
+			std::memcpy( destination.data( ), compiled.vertices.data( ), compiled.vertices.size( ) );
+			vertex_copy_ms = std::min( vertex_copy_ms, vertex_copy_timer.Milliseconds( ) );
+
+			Timer index_copy_timer;
+			std::memcpy( destination.data( ), compiled.indices.data.data( ), compiled.indices.data.size( ) );
+			index_copy_ms = std::min( index_copy_ms, index_copy_timer.Milliseconds( ) );
+		}
+
+		// triangles may come back rotated, everything else has to match
+		const uint32_t* decoded32 = reinterpret_cast<const uint32_t*>( destination.data( ) );
+		const uint16_t* decoded16 = reinterpret_cast<const uint16_t*>( destination.data( ) );
+		for ( size_t t = 0; t < indices.size( ) / 3; ++t )
+		{
+			uint32_t decoded[3];
+			for ( int k = 0; k < 3; ++k )
+				decoded[k] = compiled.indices.index_size == 2 ? decoded16[t * 3 + k] : decoded32[t * 3 + k];
+			bool same = false;
+			for ( int r = 0; r < 3; ++r )
+				same = same || ( decoded[0] == indices[t * 3 + r] && decoded[1] == indices[t * 3 + ( r + 1 ) % 3] && decoded[2] == indices[t * 3 + ( r + 2 ) % 3] );
+			if ( !same )
+			{
+				std::fprintf( stderr, "index buffer doesn't round trip at triangle %zu\n", t );
+				return 1;
+			}
+		}
+
+		const double vertex_bytes = double( compiled.vertices.size( ) );
+		const double index_bytes = double( compiled.indices.data.size( ) );
+		std::printf( "  vertices %5.1f MB -> %5.1f MB (%4.1f%%, %.2f bits per vertex)\n", vertex_bytes / 1048576.0, vertices_encoded.size( ) / 1048576.0,
+			100.0 * vertices_encoded.size( ) / vertex_bytes, 8.0 * vertices_encoded.size( ) / compiled.info.vertex_count );
+		std::printf( "           encode %6.1f ms, decode %5.1f ms %5.2f GB/s, memcpy %5.2f GB/s\n", vertex_encode_ms, vertex_decode_ms,
+			vertex_bytes / vertex_decode_ms / 1e6, vertex_bytes / vertex_copy_ms / 1e6 );
+		std::printf( "  indices  %5.1f MB -> %5.1f MB (%4.1f%%, %.2f bits per triangle, %u-bit)\n", index_bytes / 1048576.0, indices_encoded.size( ) / 1048576.0,
+			100.0 * indices_encoded.size( ) / index_bytes, 8.0 * indices_encoded.size( ) / ( indices.size( ) / 3 ), compiled.indices.index_size * 8 );
+		std::printf( "           encode %6.1f ms, decode %5.1f ms %5.2f GB/s, memcpy %5.2f GB/s\n", index_encode_ms, index_decode_ms,
+			index_bytes / index_decode_ms / 1e6, index_bytes / index_copy_ms / 1e6 );
+		return 0;
+	}
+
+	int BenchStreamingCommand( int argc, char** argv )
+	{
+		const uint32_t file_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 64;
+		const uint32_t triangle_count = argc > 1 ? uint32_t( std::strtoul( argv[1], nullptr, 10 ) ) : 50000;
+		if ( file_count < 2 )
+		{
+			std::fprintf( stderr, "needs at least 2 files\n" );
+			return 1;
+		}
+
+		// one compressed torus written under many names, so decoding has real work to do
+		ObjMesh mesh = MakeTorus( triangle_count );
+		CompiledMesh compiled;
+		CompileMesh( mesh, DXLayer::mesh_vertex_compact_normal, compiled );
+		CompressMesh( compiled );
+		DXLayer::MeshAssetWriter writer;
+		AddSections( compiled, writer );
+		for ( uint32_t file = 0; file < file_count; ++file )
+		{
+			if ( !writer.Save( StreamingFilePath( file ).c_str( ) ) )
+			{
+				std::fprintf( stderr, "can't write the bench files to the current directory\n" );
+				return 1;
+			}
+		}
+		const size_t upload_bytes = compiled.vertices.size( ) + compiled.indices.data.size( );
+
+		// decodes go straight into upload memory, here plain memory in its place. A few frames' worth, decode threads
+		// wait when it's full like they would for a renderer that hasn't taken their results yet
+		std::vector<uint8_t> upload_memory( std::max<size_t>( 32 << 20, upload_bytes * 4 ) );
+		DXLayer::UploadArena arena;
+		arena.Init( upload_memory.data( ), upload_memory.size( ) );
+		const DXLayer::AssetStreamer::DecodeFn decode = DecodeInto( arena, 2 );
+		const uint32_t io_threads = 2;
+		const uint32_t decode_threads = std::max( 1u, std::thread::hardware_concurrency( ) );
+		std::printf( "%u compressed mesh assets of %zu triangles, %.1f KB each on disk, %.1f KB decoded, %u io and %u decode threads\n", file_count,
+			mesh.indices.size( ) / 3, FileSize( StreamingFilePath( 0 ).c_str( ) ) / 1024.0, upload_bytes / 1024.0, io_threads, decode_threads );
+
+		// what init did before: everything on the calling thread before the first frame
+		Timer sync_timer;
+		double sync_first_ms = 0.0;
+		for ( uint32_t file = 0; file < file_count; ++file )
+		{
+			DXLayer::FileMapping mapping;
+			std::string error;
+			if ( !mapping.Open( StreamingFilePath( file ).c_str( ) ) || !decode( mapping.Data( ), mapping.Size( ), error ) )
+			{
+				std::fprintf( stderr, "can't load %s: %s\n", StreamingFilePath( file ).c_str( ), error.c_str( ) );
+				return 1;
+			}
+			if ( file == 0 )
+				sync_first_ms = sync_timer.Milliseconds( );
+		}
+		const double sync_ms = sync_timer.Milliseconds( );
+		std::printf( "  synchronous  first asset %6.1f ms, all %7.1f ms, %6.1f MB/s decoded\n", sync_first_ms, sync_ms, file_count * upload_bytes / sync_ms / 1e3 );
+
+		// the bytes in upload memory are the ones the asset was built from, widened to 32 bits or not
+		for ( uint32_t index_size : { 2u, 4u } )
+		{
+			DXLayer::FileMapping mapping;
+			std::string error;
+			std::unique_ptr<DXLayer::StreamedAsset> asset;
+			if ( mapping.Open( StreamingFilePath( 0 ).c_str( ) ) )
+				asset = DXLayer::DecodeStreamedMesh( mapping.Data( ), mapping.Size( ), arena, index_size, error );
+			const DXLayer::StreamedMesh* decoded = static_cast<const DXLayer::StreamedMesh*>( asset.get( ) );
+			if ( !decoded || decoded->info.index_size != index_size || !SameUpload( *decoded, compiled ) )
+			{
+				std::fprintf( stderr, "the mesh decoded with %u-bit indices isn't the one written\n", index_size * 8 );
+				return 1;
+			}
+		}
+
+		DXLayer::AssetStreamer streamer;
+		streamer.Start( io_threads, decode_threads );
+		std::vector<uint32_t> order;
+		double first_ms = 0.0, last_ms = 0.0;
+
+		// queue throughput, everything at the same priority
+		for ( uint32_t file = 0; file < file_count; ++file )
+			streamer.Request( StreamingFilePath( file ), decode, 0.0f );
+		if ( !DrainStreamer( streamer, file_count, order, first_ms, last_ms ) )
+			return 1;
+		std::printf( "  streamed     first asset %6.1f ms, all %7.1f ms, %6.1f MB/s decoded, %.0f requests/s\n", first_ms, last_ms,
+			file_count * upload_bytes / last_ms / 1e3, file_count / last_ms * 1e3 );
+
+		// the same files out of a pack, one mapping for all of them and lz blocks decompressed on the io threads
+		{
+			std::vector<uint8_t> asset_file;
+			writer.Build( asset_file );
+			DXLayer::PackFileWriter pack_writer;
+			for ( uint32_t file = 0; file < file_count; ++file )
+				pack_writer.AddFile( StreamingFilePath( file ), asset_file.data( ), asset_file.size( ) );
+			DXLayer::PackFile pack;
+			std::string error;
+			if ( !pack_writer.Save( "bench_streaming.pack" ) || !pack.Open( "bench_streaming.pack", error ) )
+			{
+				std::fprintf( stderr, "can't write the bench pack to the current directory\n" );
+				return 1;
+			}
+
+			DXLayer::AssetStreamer pack_streamer;
+			pack_streamer.MountPack( &pack );
+			pack_streamer.Start( io_threads, decode_threads );
+			for ( uint32_t file = 0; file < file_count; ++file )
+				pack_streamer.Request( StreamingFilePath( file ), decode, 0.0f );
+			if ( !DrainStreamer( pack_streamer, file_count, order, first_ms, last_ms ) )
+				return 1;
+			std::printf( "  from a pack  first asset %6.1f ms, all %7.1f ms, %6.1f MB/s decoded, %.0f requests/s\n", first_ms, last_ms,
+				file_count * upload_bytes / last_ms / 1e3, file_count / last_ms * 1e3 );
+			pack_streamer.Stop( );
+			pack.Close( );
+			std::remove( "bench_streaming.pack" );
+		}
+
+		// priority inversion: something close and on screen requested behind a backlog of far away, hidden assets
+		// has to overtake it. Only the jobs already in flight when it arrives may finish first
+		const size_t allowed_position = io_threads + decode_threads + 1;
+		const float far_hidden = DXLayer::StreamingPriority( 100.0f, 1.0f, false );
+		const float near_visible = DXLayer::StreamingPriority( 2.0f, 1.0f, true );
+		for ( uint32_t file = 0; file + 1 < file_count; ++file )
+			streamer.Request( StreamingFilePath( file ), decode, far_hidden );
+		const uint32_t urgent = streamer.Request( StreamingFilePath( file_count - 1 ), decode, near_visible );
+		if ( !DrainStreamer( streamer, file_count, order, first_ms, last_ms ) )
+			return 1;
+		const size_t urgent_position = ArrivalPosition( order, urgent );
+		std::printf( "  late high priority request arrived %zu of %u, the backlog finished after %.1f ms\n", urgent_position + 1, file_count, last_ms );
+
+		// the same, but the last request only becomes visible once everything is queued
+		uint32_t last = 0;
+		for ( uint32_t file = 0; file < file_count; ++file )
+			last = streamer.Request( StreamingFilePath( file ), decode, far_hidden );
+		streamer.SetPriority( last, near_visible );
+		if ( !DrainStreamer( streamer, file_count, order, first_ms, last_ms ) )
+			return 1;
+		const size_t raised_position = ArrivalPosition( order, last );
+		std::printf( "  reprioritized request arrived %zu of %u\n", raised_position + 1, file_count );
+
+		// a small budget still hands out one asset per frame, highest priority first
+		for ( uint32_t file = 0; file < 4 && file < file_count; ++file )
+			streamer.Request( StreamingFilePath( file ), decode, float( file ) );
+		while ( streamer.PendingCount( ) )
+		{
+			std::vector<DXLayer::StreamResult> results;
+			streamer.TakeCompleted( 1, results );
+			if ( results.size( ) > 1 )
+			{
+				std::fprintf( stderr, "the frame budget let %zu assets through\n", results.size( ) );
+				return 1;
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+		streamer.Stop( );
+
+		for ( uint32_t file = 0; file < file_count; ++file )
+			std::remove( StreamingFilePath( file ).c_str( ) );
+
+		// every result was dropped, so all of their upload memory has to be back
+		if ( arena.Used( ) != 0 )
+		{
+			std::fprintf( stderr, "%llu bytes of upload memory weren't given back\n", (unsigned long long)( arena.Used( ) ) );
+			return 1;
+		}
+
+		if ( urgent_position >= allowed_position || raised_position >= allowed_position )
+		{
+			std::fprintf( stderr, "high priority requests waited behind more than the %zu jobs in flight\n", allowed_position - 1 );
+			return 1;
+		}
+		return 0;
+	}
+}
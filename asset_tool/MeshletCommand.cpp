@@ -0,0 +1,199 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "TestMeshes.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		void Normalize( float* v )
+		{
+			const float length = std::sqrt( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+			for ( int c = 0; c < 3; ++c )
+				v[c] /= length;
+		}
+
+		void Cross( const float* a, const float* b, float* result )
+		{
+			result[0] = a[1] * b[2] - a[2] * b[1];
+			result[1] = a[2] * b[0] - a[0] * b[2];
+			result[2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		float Dot( const float* a, const float* b )
+		{
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+
+		// camera at the given position looking at the origin, square 60 degree frustum
+		DXLayer::MeshletCullParams MakeCamera( const float* position )
+		{
+			DXLayer::MeshletCullParams params = { };
+			for ( int c = 0; c < 3; ++c )
+				params.camera_position[c] = position[c];
+
+			float forward[3] = { -position[0], -position[1], -position[2] };
+			Normalize( forward );
+			float up[3] = { 0.0f, 1.0f, 0.0f };
+			if ( std::fabs( forward[1] ) > 0.99f )
+			{
+				up[1] = 0.0f;
+				up[2] = 1.0f;
+			}
+			float right[3], true_up[3];
+			Cross( up, forward, right );
+			Normalize( right );
+			Cross( forward, right, true_up );
+
+			// side planes lean 30 degrees out from forward
+			const float c30 = std::cos( 0.5236f ), s30 = std::sin( 0.5236f );
+			const float* sides[4] = { right, right, true_up, true_up };
+			const float signs[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+			for ( int p = 0; p < 4; ++p )
+			{
+				float normal[3];
+				for ( int c = 0; c < 3; ++c )
+					normal[c] = forward[c] * s30 + sides[p][c] * signs[p] * c30;
+				for ( int c = 0; c < 3; ++c )
+					params.planes[p][c] = normal[c];
+				params.planes[p][3] = -Dot( normal, position );
+			}
+
+			// near at 0.1, far at 100
+			for ( int c = 0; c < 3; ++c )
+			{
+				params.planes[4][c] = forward[c];
+				params.planes[5][c] = -forward[c];
+			}
+			params.planes[4][3] = -Dot( forward, position ) - 0.1f;
+			params.planes[5][3] = Dot( forward, position ) + 100.0f;
+			return params;
+		}
+
+		// a cone cull is wrong if any triangle of the meshlet faces the camera
+		bool ConeCullIsConservative( const DXLayer::MeshletData& data, const ObjMesh& mesh, uint32_t meshlet_index, const float* camera )
+		{
+			const DXLayer::Meshlet& meshlet = data.meshlets[meshlet_index];
+			for ( uint32_t t = 0; t < meshlet.triangle_count; ++t )
+			{
+				const uint32_t packed = data.triangles[meshlet.triangle_offset + t];
+				const float* p[3];
+				for ( int k = 0; k < 3; ++k )
+					p[k] = mesh.vertices[data.vertices[meshlet.vertex_offset + ( ( packed >> ( k * 8 ) ) & 0xff )]].position;
+
+				const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+				const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+				const float to_triangle[3] = { p[0][0] - camera[0], p[0][1] - camera[1], p[0][2] - camera[2] };
+				float normal[3];
+				Cross( e1, e2, normal );
+				if ( Dot( normal, to_triangle ) < -1e-6f * std::sqrt( Dot( normal, normal ) ) )
+					return false;
+			}
+			return true;
+		}
+	}
+
+	int BenchMeshletsCommand( int argc, char** argv )
+	{
+		const uint32_t triangle_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 1000000;
+
+		ObjMesh mesh = MakeTorus( triangle_count );
+		Scramble( mesh, 1 );
+		std::vector<uint32_t> optimized( mesh.indices.size( ) );
+		DXLayer::OptimizeVertexCache( optimized.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.size( ) );
+		mesh.indices.swap( optimized );
+
+		std::printf( "torus: %zu triangles, %zu vertices, cache optimized\n", mesh.indices.size( ) / 3, mesh.vertices.size( ) );
+
+		const float cone_weights[] = { 0.0f, 0.25f, 0.5f };
+		for ( float cone_weight : cone_weights )
+		{
+			DXLayer::MeshletData data;
+			Timer build_timer;
+			DXLayer::BuildMeshlets( data, mesh.indices.data( ), mesh.indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ),
+				DXLayer::meshlet_max_vertices, DXLayer::meshlet_max_triangles, cone_weight );
+			const double build_ms = build_timer.Milliseconds( );
+
+			size_t useful_cones = 0;
+			double cone_angle_sum = 0.0;
+			double radius_sum = 0.0;
+			for ( const auto& bounds : data.bounds )
+			{
+				radius_sum += bounds.radius;
+				if ( bounds.cone_cutoff < 1.0f )
+				{
+					useful_cones++;
+					cone_angle_sum += std::asin( bounds.cone_cutoff ) * 57.2957795;
+				}
+			}
+
+			const size_t meshlet_count = data.meshlets.size( );
+			std::printf( "cone weight %.2f: build %.1f ms (%.1f M triangles/s)\n", cone_weight, build_ms, mesh.indices.size( ) / 3 / build_ms / 1000.0 );
+			std::printf( "  %zu meshlets, %.1f vertices and %.1f triangles on average (%.0f%% of the triangle limit)\n",
+				meshlet_count, double( data.vertices.size( ) ) / meshlet_count, double( data.triangles.size( ) ) / meshlet_count,
+				100.0 * data.triangles.size( ) / ( meshlet_count * DXLayer::meshlet_max_triangles ) );
+			std::printf( "  vertex duplication %.3f, average radius %.4f, useful cones %.1f%%, %.1f degree normal spread on average\n",
+				double( data.vertices.size( ) ) / mesh.vertices.size( ), radius_sum / meshlet_count,
+				100.0 * useful_cones / meshlet_count, useful_cones ? cone_angle_sum / useful_cones : 0.0 );
+
+			// cull from random viewpoints around the mesh, every cone cull is checked against the actual triangles
+			std::mt19937 random( 7 );
+			std::uniform_real_distribution<float> unit( -1.0f, 1.0f );
+			const int view_count = 64;
+			size_t frustum_culled = 0;
+			size_t cone_culled = 0;
+			size_t wrong_culls = 0;
+			double cull_ms = 0.0;
+			std::vector<uint32_t> visible;
+			std::vector<uint32_t> frustum_visible;
+			for ( int view = 0; view < view_count; ++view )
+			{
+				float camera[3] = { unit( random ), unit( random ), unit( random ) };
+				Normalize( camera );
+				const float distance = 1.5f + 2.0f * ( unit( random ) + 1.0f );
+				for ( int c = 0; c < 3; ++c )
+					camera[c] *= distance;
+
+				const DXLayer::MeshletCullParams params = MakeCamera( camera );
+
+				visible.clear( );
+				Timer cull_timer;
+				DXLayer::CullMeshlets( data, params, visible );
+				cull_ms += cull_timer.Milliseconds( );
+
+				// frustum only, to split the culled meshlets by reason
+				DXLayer::MeshletData frustum_data = data;
+				for ( auto& bounds : frustum_data.bounds )
+					bounds.cone_cutoff = 1.0f;
+				frustum_visible.clear( );
+				DXLayer::CullMeshlets( frustum_data, params, frustum_visible );
+
+				frustum_culled += meshlet_count - frustum_visible.size( );
+				cone_culled += frustum_visible.size( ) - visible.size( );
+
+				size_t v = 0;
+				for ( uint32_t m : frustum_visible )
+				{
+					if ( v < visible.size( ) && visible[v] == m )
+						v++;
+					else if ( !ConeCullIsConservative( data, mesh, m, camera ) )
+						wrong_culls++;
+				}
+			}
+
+			std::printf( "  culling over %d views: %.1f%% frustum, %.1f%% cone, %zu wrong culls, %.1f M meshlets/s\n",
+				view_count, 100.0 * frustum_culled / ( meshlet_count * view_count ), 100.0 * cone_culled / ( meshlet_count * view_count ),
+				wrong_culls, meshlet_count * view_count / cull_ms / 1000.0 );
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,274 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "MipGenerator.h"
+#include "TestImages.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		// every level of every slice packed tightly, in the order GenerateMips writes them
+		struct MipChain
+		{
+			uint32_t width;
+			uint32_t height;
+			uint32_t mip_levels;
+			std::vector<uint8_t> data;
+			std::vector<size_t> offsets;
+			std::vector<DXLayer::SubresourceDestination> destinations;
+
+			MipChain( uint32_t chain_width, uint32_t chain_height, uint32_t slice_count, uint32_t levels )
+				: width( chain_width ), height( chain_height ), mip_levels( levels )
+			{
+				size_t size = 0;
+				for ( uint32_t slice = 0; slice < slice_count; ++slice )
+				{
+					for ( uint32_t mip = 0; mip < mip_levels; ++mip )
+					{
+						offsets.push_back( size );
+						size += size_t( 4 ) * Width( mip ) * Height( mip );
+					}
+				}
+				data.resize( size );
+				for ( size_t i = 0; i < offsets.size( ); ++i )
+				{
+					const uint32_t mip = uint32_t( i % mip_levels );
+					destinations.push_back( { &data[offsets[i]], size_t( 4 ) * Width( mip ), size_t( 4 ) * Width( mip ) * Height( mip ) } );
+				}
+			}
+
+			uint32_t Width( uint32_t mip ) const { return std::max( 1u, width >> mip ); }
+			uint32_t Height( uint32_t mip ) const { return std::max( 1u, height >> mip ); }
+
+			const uint8_t* Texel( uint32_t slice, uint32_t mip, uint32_t x, uint32_t y ) const
+			{
+				return &data[offsets[slice * mip_levels + mip] + ( size_t( y ) * Width( mip ) + x ) * 4];
+			}
+		};
+
+		Image GrayImage( uint32_t width, uint32_t height, const std::vector<uint8_t>& values )
+		{
+			Image image = { width, height, std::vector<uint8_t>( size_t( width ) * height * 4 ) };
+			for ( size_t i = 0; i < size_t( width ) * height; ++i )
+			{
+				const uint8_t value = values[i % values.size( )];
+				image.texels[i * 4 + 0] = image.texels[i * 4 + 1] = image.texels[i * 4 + 2] = value;
+				image.texels[i * 4 + 3] = 255;
+			}
+			return image;
+		}
+
+		bool Generate( const Image& image, MipChain& chain, const DXLayer::MipOptions& options )
+		{
+			const DXLayer::MipSource source = { image.texels.data( ), size_t( image.width ) * 4 };
+			return DXLayer::GenerateMips( &source, 1, image.width, image.height, chain.mip_levels, chain.destinations.data( ), options );
+		}
+
+		double Coverage( const uint8_t* texels, size_t count, float cutoff )
+		{
+			size_t passed = 0;
+			for ( size_t i = 0; i < count; ++i )
+				passed += texels[i * 4 + 3] / 255.0f > cutoff;
+			return double( passed ) / count;
+		}
+
+		struct Check
+		{
+			int failed = 0;
+			int count = 0;
+
+			void operator( )( bool passed, const char* name, int got, int expected )
+			{
+				++count;
+				if ( passed )
+					return;
+				std::fprintf( stderr, "%s: got %d, expected %d\n", name, got, expected );
+				++failed;
+			}
+		};
+
+		template <typename Generate>
+		double BestOf( int runs, Generate generate )
+		{
+			double best = 1e30;
+			for ( int run = 0; run < runs; ++run )
+			{
+				Timer timer;
+				generate( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+	}
+
+	int CheckMipsCommand( int, char** )
+	{
+		Check check;
+		DXLayer::MipOptions options;
+		DXLayer::MipOptions srgb;
+		srgb.srgb = true;
+		DXLayer::MipOptions kaiser;
+		kaiser.filter = DXLayer::mip_filter_kaiser;
+
+		// values known by hand: box averages, averages in linear light, and sizes that aren't a power of two
+		{
+			MipChain chain( 2, 2, 1, 2 );
+			Generate( GrayImage( 2, 2, { 0, 255, 100, 50 } ), chain, options );
+			check( chain.Texel( 0, 1, 0, 0 )[0] == 101 && chain.Texel( 0, 1, 0, 0 )[3] == 255, "2x2 box", chain.Texel( 0, 1, 0, 0 )[0], 101 );
+			check( chain.Texel( 0, 0, 1, 0 )[0] == 255, "level 0 copied", chain.Texel( 0, 0, 1, 0 )[0], 255 );
+		}
+		{
+			MipChain chain( 2, 1, 1, 2 );
+			Generate( GrayImage( 2, 1, { 0, 255 } ), chain, srgb );
+			check( chain.Texel( 0, 1, 0, 0 )[0] == 188 && chain.Texel( 0, 1, 0, 0 )[3] == 255, "srgb black and white", chain.Texel( 0, 1, 0, 0 )[0], 188 );
+			Generate( GrayImage( 2, 1, { 0, 255 } ), chain, options );
+			check( chain.Texel( 0, 1, 0, 0 )[0] == 128, "unorm black and white", chain.Texel( 0, 1, 0, 0 )[0], 128 );
+		}
+		{
+			MipChain chain( 3, 1, 1, 2 );
+			Generate( GrayImage( 3, 1, { 0, 60, 120 } ), chain, options );
+			check( chain.Texel( 0, 1, 0, 0 )[0] == 60, "3x1 box", chain.Texel( 0, 1, 0, 0 )[0], 60 );
+		}
+		{
+			// 5 texels into 2, each covers two and a half
+			MipChain chain( 5, 1, 1, 2 );
+			Generate( GrayImage( 5, 1, { 0, 50, 100, 150, 200 } ), chain, options );
+			check( chain.Texel( 0, 1, 0, 0 )[0] == 40, "5x1 box, left", chain.Texel( 0, 1, 0, 0 )[0], 40 );
+			check( chain.Texel( 0, 1, 1, 0 )[0] == 160, "5x1 box, right", chain.Texel( 0, 1, 1, 0 )[0], 160 );
+		}
+		{
+			check( DXLayer::FullMipCount( 5, 3 ) == 3, "5x3 levels", DXLayer::FullMipCount( 5, 3 ), 3 );
+			check( DXLayer::FullMipCount( 1, 1 ) == 1, "1x1 levels", DXLayer::FullMipCount( 1, 1 ), 1 );
+			check( DXLayer::FullMipCount( 256, 16 ) == 9, "256x16 levels", DXLayer::FullMipCount( 256, 16 ), 9 );
+			MipChain chain( 5, 3, 1, 3 );
+			const Image image = GrayImage( 5, 3, { 10, 20, 30, 40, 50, 60, 70 } );
+			const DXLayer::MipSource source = { image.texels.data( ), 20 };
+			check( Generate( image, chain, options ), "5x3 chain", 0, 1 );
+			check( !DXLayer::GenerateMips( &source, 1, 5, 3, 4, chain.destinations.data( ), options ), "5x3 with 4 levels", 1, 0 );
+			check( !DXLayer::GenerateMips( &source, 1, 0, 3, 1, chain.destinations.data( ), options ), "empty", 1, 0 );
+		}
+
+		// the kaiser filter keeps flat areas flat and averages the finest stripes to grey
+		{
+			MipChain chain( 64, 64, 1, 7 );
+			Generate( GrayImage( 64, 64, { 77 } ), chain, kaiser );
+			int worst = 77;
+			for ( size_t i = 0; i < chain.data.size( ); i += 4 )
+				worst = std::abs( chain.data[i] - 77 ) > std::abs( worst - 77 ) ? chain.data[i] : worst;
+			check( worst == 77, "kaiser flat", worst, 77 );
+			Generate( GrayImage( 64, 64, { 0, 255 } ), chain, kaiser );
+			const int grey = chain.Texel( 0, 1, 16, 16 )[0];
+			check( grey >= 127 && grey <= 128, "kaiser stripes", grey, 128 );
+		}
+
+		// a texel next to the edge picks up the other side only when the texture tiles
+		{
+			DXLayer::MipOptions wrap = kaiser;
+			wrap.wrap = true;
+			std::vector<uint8_t> values( 8, 0 );
+			values[0] = 255;
+			MipChain chain( 8, 1, 1, 2 );
+			Generate( GrayImage( 8, 1, values ), chain, kaiser );
+			check( chain.Texel( 0, 1, 3, 0 )[0] == 0, "clamped edge", chain.Texel( 0, 1, 3, 0 )[0], 0 );
+			Generate( GrayImage( 8, 1, values ), chain, wrap );
+			check( chain.Texel( 0, 1, 3, 0 )[0] > 0, "wrapped edge", chain.Texel( 0, 1, 3, 0 )[0], 1 );
+		}
+
+		// array slices land where D3D12CalcSubresource puts them
+		{
+			const Image first = GrayImage( 4, 4, { 10 } ), second = GrayImage( 4, 4, { 200 } );
+			const DXLayer::MipSource sources[] = { { first.texels.data( ), 16 }, { second.texels.data( ), 16 } };
+			MipChain chain( 4, 4, 2, 3 );
+			DXLayer::GenerateMips( sources, 2, 4, 4, 3, chain.destinations.data( ), options );
+			for ( uint32_t mip = 0; mip < 3; ++mip )
+			{
+				check( chain.Texel( 0, mip, 0, 0 )[0] == 10, "array slice 0", chain.Texel( 0, mip, 0, 0 )[0], 10 );
+				check( chain.Texel( 1, mip, 0, 0 )[0] == 200, "array slice 1", chain.Texel( 1, mip, 0, 0 )[0], 200 );
+			}
+		}
+
+		// alpha tested foliage keeps its coverage down the chain, where plain filtering lets it fade
+		{
+			const std::vector<TestImage> images = MakeTestImages( 256 );
+			const Image& sprite = images[3].image;
+			DXLayer::MipOptions cutout;
+			cutout.alpha_cutoff = 0.5f;
+			MipChain plain( 256, 256, 1, 9 ), kept( 256, 256, 1, 9 );
+			Generate( sprite, plain, options );
+			Generate( sprite, kept, cutout );
+			const double reference = Coverage( sprite.texels.data( ), size_t( 256 ) * 256, 0.5f );
+			std::printf( "alpha coverage %.4f at the top\n%5s %9s %9s\n", reference, "level", "filtered", "kept" );
+			for ( uint32_t mip = 1; mip < 9; ++mip )
+			{
+				const size_t count = size_t( kept.Width( mip ) ) * kept.Height( mip );
+				const double plain_coverage = Coverage( plain.Texel( 0, mip, 0, 0 ), count, 0.5f );
+				const double kept_coverage = Coverage( kept.Texel( 0, mip, 0, 0 ), count, 0.5f );
+				std::printf( "%5u %9.4f %9.4f\n", mip, plain_coverage, kept_coverage );
+				// texels with equal alpha pass together, a cut out hole's edge averages to exactly half at level 1
+				check( std::abs( kept_coverage - reference ) <= 2.0 / count + 0.005, "alpha coverage, in texels", int( kept_coverage * count + 0.5 ), int( reference * count + 0.5 ) );
+				check( std::abs( kept_coverage - reference ) <= std::abs( plain_coverage - reference ) + 1.0 / count, "alpha coverage against plain filtering, in texels",
+					int( kept_coverage * count + 0.5 ), int( plain_coverage * count + 0.5 ) );
+			}
+		}
+
+		std::printf( "%d mip checks, %d failed\n", check.count, check.failed );
+		return check.failed ? 1 : 0;
+	}
+
+	int BenchMipsCommand( int argc, char** argv )
+	{
+		const uint32_t size = argc > 0 ? std::max( 2u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 2048;
+		const uint32_t thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+		const std::vector<TestImage> images = MakeTestImages( size );
+		const Image& image = images[3].image;
+		const double megapixels = double( size ) * size / 1e6;
+		const uint32_t mip_levels = DXLayer::FullMipCount( size, size );
+
+		struct Setting
+		{
+			const char* name;
+			DXLayer::MipFilter filter;
+			bool srgb;
+			float alpha_cutoff;
+		};
+		const Setting settings[] = {
+			{ "box", DXLayer::mip_filter_box, false, 0.0f },
+			{ "box srgb", DXLayer::mip_filter_box, true, 0.0f },
+			{ "box srgb cutout", DXLayer::mip_filter_box, true, 0.5f },
+			{ "kaiser", DXLayer::mip_filter_kaiser, false, 0.0f },
+			{ "kaiser srgb", DXLayer::mip_filter_kaiser, true, 0.0f },
+			{ "kaiser srgb cutout", DXLayer::mip_filter_kaiser, true, 0.5f },
+		};
+
+		std::printf( "%u mip levels of a %ux%u sprite, ms for the chain and top level Mpixels/s, %u threads\n", mip_levels, size, size, thread_count );
+		std::printf( "%-20s %9s %9s %9s %9s\n", "", "1 thread", "Mpix/s", "threads", "Mpix/s" );
+		MipChain chain( size, size, 1, mip_levels ), threaded( size, size, 1, mip_levels );
+		for ( const Setting& setting : settings )
+		{
+			DXLayer::MipOptions options;
+			options.filter = setting.filter;
+			options.srgb = setting.srgb;
+			options.alpha_cutoff = setting.alpha_cutoff;
+			const double ms = BestOf( 3, [ & ] ( ) { Generate( image, chain, options ); } );
+			options.thread_count = thread_count;
+			const double threads_ms = BestOf( 3, [ & ] ( ) { Generate( image, threaded, options ); } );
+
+			// bands are filtered the same on any thread, the chains have to match byte for byte
+			if ( chain.data != threaded.data )
+			{
+				std::fprintf( stderr, "%s: threaded mips differ from single threaded ones\n", setting.name );
+				return 1;
+			}
+			std::printf( "%-20s %9.2f %9.1f %9.2f %9.1f\n", setting.name, ms, megapixels / ms * 1e3, threads_ms, megapixels / threads_ms * 1e3 );
+		}
+		return 0;
+	}
+}
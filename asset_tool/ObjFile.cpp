@@ -0,0 +1,214 @@
+#include "ObjFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace AssetTool
+{
+	namespace
+	{
+		struct VertexKey
+		{
+			int position, texcoord, normal;
+
+			bool operator==( const VertexKey& other ) const
+			{
+				return position == other.position && texcoord == other.texcoord && normal == other.normal;
+			}
+		};
+
+		struct VertexKeyHash
+		{
+			size_t operator()( const VertexKey& key ) const
+			{
+				return size_t( key.position ) * 73856093u ^ size_t( key.texcoord ) * 19349663u ^ size_t( key.normal ) * 83492791u;
+			}
+		};
+
+		bool ReadFile( const std::string& path, std::vector<char>& data )
+		{
+			FILE* file = std::fopen( path.c_str( ), "rb" );
+			if ( !file )
+				return false;
+
+			std::fseek( file, 0, SEEK_END );
+			const long size = std::ftell( file );
+			std::fseek( file, 0, SEEK_SET );
+
+			data.resize( size_t( size ) + 1 );
+			const bool read = std::fread( data.data( ), 1, size_t( size ), file ) == size_t( size );
+			data[size] = '\0';
+			std::fclose( file );
+			return read;
+		}
+
+		const char* SkipSpaces( const char* s )
+		{
+			while ( *s == ' ' || *s == '\t' )
+				s++;
+			return s;
+		}
+
+		const char* NextLine( const char* s )
+		{
+			while ( *s && *s != '\n' )
+				s++;
+			return *s ? s + 1 : s;
+		}
+
+		// obj indices are 1-based, negative ones count back from the last element
+		int ResolveIndex( long index, size_t count )
+		{
+			return index < 0 ? int( count + index ) : int( index - 1 );
+		}
+	}
+
+	bool LoadObj( const std::string& path, ObjMesh& mesh, std::string& error )
+	{
+		std::vector<char> data;
+		if ( !ReadFile( path, data ) )
+		{
+			error = "can't read " + path;
+			return false;
+		}
+
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<float> normals;
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertex_map;
+		std::vector<uint32_t> polygon;
+
+		mesh.vertices.clear( );
+		mesh.indices.clear( );
+		mesh.has_normals = false;
+		mesh.has_texcoords = false;
+
+		int line_number = 1;
+		for ( const char* line = data.data( ); *line; line = NextLine( line ), line_number++ )
+		{
+			const char* s = SkipSpaces( line );
+			char* end = nullptr;
+
+			if ( s[0] == 'v' && ( s[1] == ' ' || s[1] == '\t' ) )
+			{
+				s += 2;
+				for ( int c = 0; c < 3; ++c, s = end )
+					positions.push_back( std::strtof( s, &end ) );
+			}
+			else if ( s[0] == 'v' && s[1] == 't' )
+			{
+				s += 2;
+				for ( int c = 0; c < 2; ++c, s = end )
+					texcoords.push_back( std::strtof( s, &end ) );
+			}
+			else if ( s[0] == 'v' && s[1] == 'n' )
+			{
+				s += 2;
+				for ( int c = 0; c < 3; ++c, s = end )
+					normals.push_back( std::strtof( s, &end ) );
+			}
+			else if ( s[0] == 'f' && ( s[1] == ' ' || s[1] == '\t' ) )
+			{
+				polygon.clear( );
+				s = SkipSpaces( s + 2 );
+				while ( *s && *s != '\r' && *s != '\n' && *s != '#' )
+				{
+					VertexKey key = { -1, -1, -1 };
+					key.position = ResolveIndex( std::strtol( s, &end, 10 ), positions.size( ) / 3 );
+					if ( end == s )
+						break;
+					s = end;
+					if ( *s == '/' )
+					{
+						s++;
+						if ( *s != '/' )
+						{
+							key.texcoord = ResolveIndex( std::strtol( s, &end, 10 ), texcoords.size( ) / 2 );
+							s = end;
+						}
+						if ( *s == '/' )
+						{
+							key.normal = ResolveIndex( std::strtol( s + 1, &end, 10 ), normals.size( ) / 3 );
+							s = end;
+						}
+					}
+					s = SkipSpaces( s );
+
+					// -1 means the attribute is missing
+					const bool valid = key.position >= 0 && key.position < int( positions.size( ) / 3 )
+						&& key.texcoord >= -1 && key.texcoord < int( texcoords.size( ) / 2 )
+						&& key.normal >= -1 && key.normal < int( normals.size( ) / 3 );
+					if ( !valid )
+					{
+						error = path + "(" + std::to_string( line_number ) + "): index out of range";
+						return false;
+					}
+
+					auto inserted = vertex_map.insert( std::make_pair( key, uint32_t( mesh.vertices.size( ) ) ) );
+					if ( inserted.second )
+					{
+						ObjVertex vertex = { };
+						std::memcpy( vertex.position, &positions[key.position * 3], sizeof( vertex.position ) );
+						if ( key.texcoord >= 0 )
+							std::memcpy( vertex.texcoord, &texcoords[key.texcoord * 2], sizeof( vertex.texcoord ) );
+						if ( key.normal >= 0 )
+							std::memcpy( vertex.normal, &normals[key.normal * 3], sizeof( vertex.normal ) );
+						mesh.vertices.push_back( vertex );
+					}
+					polygon.push_back( inserted.first->second );
+
+					mesh.has_texcoords |= key.texcoord >= 0;
+					mesh.has_normals |= key.normal >= 0;
+				}
+
+				for ( size_t i = 2; i < polygon.size( ); ++i )
+				{
+					mesh.indices.push_back( polygon[0] );
+					mesh.indices.push_back( polygon[i - 1] );
+					mesh.indices.push_back( polygon[i] );
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool SaveObj( const std::string& path, const ObjMesh& mesh )
+	{
+		FILE* file = std::fopen( path.c_str( ), "w" );
+		if ( !file )
+			return false;
+
+		for ( const auto& vertex : mesh.vertices )
+			std::fprintf( file, "v %.9g %.9g %.9g\n", vertex.position[0], vertex.position[1], vertex.position[2] );
+		if ( mesh.has_texcoords )
+			for ( const auto& vertex : mesh.vertices )
+				std::fprintf( file, "vt %.9g %.9g\n", vertex.texcoord[0], vertex.texcoord[1] );
+		if ( mesh.has_normals )
+			for ( const auto& vertex : mesh.vertices )
+				std::fprintf( file, "vn %.9g %.9g %.9g\n", vertex.normal[0], vertex.normal[1], vertex.normal[2] );
+
+		// vertices are already unique, so every attribute shares the vertex index
+		for ( size_t i = 0; i + 2 < mesh.indices.size( ); i += 3 )
+		{
+			std::fprintf( file, "f" );
+			for ( int k = 0; k < 3; ++k )
+			{
+				const uint32_t index = mesh.indices[i + k] + 1;
+				if ( mesh.has_texcoords && mesh.has_normals )
+					std::fprintf( file, " %u/%u/%u", index, index, index );
+				else if ( mesh.has_texcoords )
+					std::fprintf( file, " %u/%u", index, index );
+				else if ( mesh.has_normals )
+					std::fprintf( file, " %u//%u", index, index );
+				else
+					std::fprintf( file, " %u", index );
+			}
+			std::fprintf( file, "\n" );
+		}
+
+		return std::fclose( file ) == 0;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// minimal wavefront obj reader and writer for the asset pipeline. Only triangulated geometry is kept:
+// polygons are fanned, materials, groups and smoothing groups are ignored
+
+namespace AssetTool
+{
+	struct ObjVertex
+	{
+		float position[3];
+		float normal[3];
+		float texcoord[2];
+	};
+
+	struct ObjMesh
+	{
+		std::vector<ObjVertex> vertices;	// unique position/texcoord/normal combinations
+		std::vector<uint32_t> indices;		// triangle list
+		bool has_normals;
+		bool has_texcoords;
+	};
+
+	bool LoadObj( const std::string& path, ObjMesh& mesh, std::string& error );
+
+	bool SaveObj( const std::string& path, const ObjMesh& mesh );
+}
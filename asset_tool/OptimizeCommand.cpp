@@ -0,0 +1,97 @@
+#include "Commands.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "MeshOptimizer.h"
+#include "ObjFile.h"
+#include "TestMeshes.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		void PrintStats( const char* label, const ObjMesh& mesh )
+		{
+			const DXLayer::VertexCacheStats cache = DXLayer::AnalyzeVertexCache( mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.size( ) );
+			const DXLayer::VertexFetchStats fetch = DXLayer::AnalyzeVertexFetch( mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.size( ), sizeof( ObjVertex ) );
+			std::printf( "  %-10s acmr %.3f  atvr %.3f  overfetch %.3f\n", label, cache.acmr, cache.atvr, fetch.overfetch );
+		}
+
+		void OptimizeMesh( ObjMesh& mesh )
+		{
+			std::vector<uint32_t> indices( mesh.indices.size( ) );
+			std::vector<ObjVertex> vertices( mesh.vertices.size( ) );
+
+			Timer cache_timer;
+			DXLayer::OptimizeVertexCache( indices.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.size( ) );
+			const double cache_ms = cache_timer.Milliseconds( );
+
+			Timer overdraw_timer;
+			DXLayer::OptimizeOverdraw( mesh.indices.data( ), indices.data( ), indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ) );
+			const double overdraw_ms = overdraw_timer.Milliseconds( );
+
+			Timer fetch_timer;
+			const size_t vertex_count = DXLayer::OptimizeVertexFetch( vertices.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices.data( ), mesh.vertices.size( ), sizeof( ObjVertex ) );
+			const double fetch_ms = fetch_timer.Milliseconds( );
+
+			vertices.resize( vertex_count );
+			mesh.vertices.swap( vertices );
+
+			std::printf( "  time       cache %.1f ms  overdraw %.1f ms  fetch %.1f ms\n", cache_ms, overdraw_ms, fetch_ms );
+		}
+
+		void Bench( const char* name, ObjMesh& mesh )
+		{
+			std::printf( "%s: %zu triangles, %zu vertices\n", name, mesh.indices.size( ) / 3, mesh.vertices.size( ) );
+			PrintStats( "before", mesh );
+			OptimizeMesh( mesh );
+			PrintStats( "after", mesh );
+		}
+	}
+
+	int OptimizeCommand( int argc, char** argv )
+	{
+		if ( argc != 2 )
+		{
+			std::fprintf( stderr, "usage: asset_tool optimize <in.obj> <out.obj>\n" );
+			return 1;
+		}
+
+		ObjMesh mesh;
+		std::string error;
+		if ( !LoadObj( argv[0], mesh, error ) )
+		{
+			std::fprintf( stderr, "%s\n", error.c_str( ) );
+			return 1;
+		}
+		if ( mesh.indices.empty( ) )
+		{
+			std::fprintf( stderr, "%s has no triangles\n", argv[0] );
+			return 1;
+		}
+
+		Bench( argv[0], mesh );
+
+		if ( !SaveObj( argv[1], mesh ) )
+		{
+			std::fprintf( stderr, "can't write %s\n", argv[1] );
+			return 1;
+		}
+		return 0;
+	}
+
+	int BenchOptimizeCommand( int argc, char** argv )
+	{
+		const uint32_t triangle_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 1000000;
+
+		ObjMesh torus = MakeTorus( triangle_count );
+		Bench( "torus, authored order", torus );
+
+		ObjMesh scrambled = MakeTorus( triangle_count );
+		Scramble( scrambled, 1 );
+		Bench( "torus, scrambled", scrambled );
+		return 0;
+	}
+}
@@ -0,0 +1,236 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileMapping.h"
+#include "PackFile.h"
+#include "TestMeshes.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		uint32_t ThreadCount( )
+		{
+			return std::max( 1u, std::thread::hardware_concurrency( ) );
+		}
+
+		size_t FileSize( const char* path )
+		{
+			DXLayer::FileMapping mapping;
+			return mapping.Open( path ) ? mapping.Size( ) : 0;
+		}
+
+		std::string LooseFilePath( uint32_t file )
+		{
+			return "bench_pack_" + std::to_string( file ) + ".bin";
+		}
+
+		// windows paths on the command line still give '/' inside the pack
+		std::string PackPath( const char* path )
+		{
+			std::string pack_path( path );
+			std::replace( pack_path.begin( ), pack_path.end( ), '\\', '/' );
+			while ( pack_path.compare( 0, 2, "./" ) == 0 )
+				pack_path.erase( 0, 2 );
+			return pack_path;
+		}
+
+		bool WriteFile( const char* path, const uint8_t* data, size_t size )
+		{
+			FILE* out = std::fopen( path, "wb" );
+			if ( !out )
+				return false;
+			const bool written = std::fwrite( data, 1, size, out ) == size;
+			return std::fclose( out ) == 0 && written;
+		}
+	}
+
+	int PackCommand( int argc, char** argv )
+	{
+		if ( argc < 2 )
+		{
+			std::fprintf( stderr, "usage: asset_tool pack <out.pack> <file>...\n" );
+			return 1;
+		}
+
+		// the mappings have to stay open until the pack is written
+		std::vector<std::unique_ptr<DXLayer::FileMapping>> mappings;
+		DXLayer::PackFileWriter writer;
+		size_t total_size = 0;
+		for ( int i = 1; i < argc; ++i )
+		{
+			mappings.emplace_back( new DXLayer::FileMapping );
+			if ( !mappings.back( )->Open( argv[i] ) )
+			{
+				std::fprintf( stderr, "can't read %s\n", argv[i] );
+				return 1;
+			}
+			writer.AddFile( PackPath( argv[i] ), mappings.back( )->Data( ), mappings.back( )->Size( ) );
+			total_size += mappings.back( )->Size( );
+		}
+
+		Timer timer;
+		if ( !writer.Save( argv[0], ThreadCount( ) ) )
+		{
+			std::fprintf( stderr, "can't write %s\n", argv[0] );
+			return 1;
+		}
+		std::printf( "%s: %d files, %.1f MB -> %.1f MB in %.1f ms\n", argv[0], argc - 1, total_size / 1048576.0, FileSize( argv[0] ) / 1048576.0, timer.Milliseconds( ) );
+		return 0;
+	}
+
+	int BenchPackCommand( int argc, char** argv )
+	{
+		const uint32_t file_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 500;
+		const uint32_t thread_count = ThreadCount( );
+
+		// geometry as it comes out of a tool before any packing: float vertices and 32-bit indices of a few tori,
+		// each file a window of one of them, sizes log uniform between 4 KB and 1 MB. One big file on top for
+		// the parallel decompression
+		std::vector<std::vector<uint8_t>> sources;
+		for ( uint32_t triangles : { 20000u, 60000u, 200000u } )
+		{
+			const ObjMesh mesh = MakeTorus( triangles );
+			std::vector<uint8_t> source( mesh.vertices.size( ) * sizeof( ObjVertex ) + mesh.indices.size( ) * 4 );
+			std::memcpy( source.data( ), mesh.vertices.data( ), mesh.vertices.size( ) * sizeof( ObjVertex ) );
+			std::memcpy( source.data( ) + mesh.vertices.size( ) * sizeof( ObjVertex ), mesh.indices.data( ), mesh.indices.size( ) * 4 );
+			sources.push_back( source );
+		}
+
+		std::mt19937 rng( 5 );
+		std::vector<std::vector<uint8_t>> files( file_count + 1 );
+		std::vector<std::string> paths( file_count + 1 );
+		size_t total_size = 0;
+		for ( uint32_t file = 0; file < file_count; ++file )
+		{
+			const std::vector<uint8_t>& source = sources[rng( ) % sources.size( )];
+			const size_t size = std::min( source.size( ), size_t( 4096.0 * std::pow( 256.0, std::uniform_real_distribution<double>( 0.0, 1.0 )( rng ) ) ) );
+			const size_t offset = std::uniform_int_distribution<size_t>( 0, source.size( ) - size )( rng );
+			files[file].assign( source.begin( ) + offset, source.begin( ) + offset + size );
+			paths[file] = "meshes/" + std::to_string( file % 16 ) + "/" + std::to_string( file ) + ".bin";
+			total_size += size;
+		}
+		files[file_count] = sources.back( );
+		paths[file_count] = "meshes/big.bin";
+		total_size += files[file_count].size( );
+
+		DXLayer::PackFileWriter writer;
+		for ( uint32_t file = 0; file <= file_count; ++file )
+			writer.AddFile( paths[file], files[file].data( ), files[file].size( ) );
+
+		// build, on one thread and on all of them
+		std::vector<uint8_t> built;
+		Timer build_timer;
+		writer.Build( built, 1 );
+		const double build_ms = build_timer.Milliseconds( );
+		Timer parallel_build_timer;
+		writer.Build( built, thread_count );
+		const double parallel_build_ms = parallel_build_timer.Milliseconds( );
+
+		const char* pack_path = "bench_pack.pack";
+		if ( !WriteFile( pack_path, built.data( ), built.size( ) ) )
+		{
+			std::fprintf( stderr, "can't write the bench files to the current directory\n" );
+			return 1;
+		}
+		std::printf( "%u files, %.1f MB -> %.1f MB pack (%.1f%%), %u threads\n", file_count + 1, total_size / 1048576.0, built.size( ) / 1048576.0,
+			100.0 * built.size( ) / total_size, thread_count );
+		std::printf( "  build      %7.1f ms on one thread %6.1f MB/s, %7.1f ms on %u\n", build_ms, total_size / build_ms / 1e3, parallel_build_ms, thread_count );
+
+		DXLayer::PackFile pack;
+		std::string error;
+		if ( !pack.Open( pack_path, error ) )
+		{
+			std::fprintf( stderr, "%s\n", error.c_str( ) );
+			return 1;
+		}
+
+		// everything has to come back as it went in
+		std::vector<uint8_t> read;
+		for ( uint32_t file = 0; file <= file_count; ++file )
+		{
+			const uint32_t entry = pack.Find( paths[file].c_str( ) );
+			read.assign( files[file].size( ) + 1, 0 );
+			if ( entry == DXLayer::PackFile::invalid_entry || pack.EntrySize( entry ) != files[file].size( ) || !pack.ReadEntry( entry, read.data( ), thread_count ) ||
+				( files[file].size( ) && std::memcmp( read.data( ), files[file].data( ), files[file].size( ) ) != 0 ) )
+			{
+				std::fprintf( stderr, "%s doesn't round trip\n", paths[file].c_str( ) );
+				return 1;
+			}
+		}
+		uint32_t first, end;
+		pack.FindPrefix( "meshes/3/", first, end );
+		if ( end - first != ( file_count + 12 ) / 16 )
+		{
+			std::fprintf( stderr, "meshes/3/ lists %u entries\n", end - first );
+			return 1;
+		}
+
+		// random lookups against opening loose files
+		const uint32_t lookup_count = 1000000;
+		std::vector<uint32_t> lookups( lookup_count );
+		for ( auto& lookup : lookups )
+			lookup = rng( ) % ( file_count + 1 );
+		uint32_t found = 0;
+		Timer lookup_timer;
+		for ( uint32_t lookup : lookups )
+			found += pack.Find( paths[lookup].c_str( ) ) != DXLayer::PackFile::invalid_entry;
+		const double lookup_ms = lookup_timer.Milliseconds( );
+
+		for ( uint32_t file = 0; file < file_count; ++file )
+			WriteFile( LooseFilePath( file ).c_str( ), files[file].data( ), files[file].size( ) );
+		uint32_t opened = 0;
+		Timer open_timer;
+		for ( uint32_t file = 0; file < file_count; ++file )
+		{
+			DXLayer::FileMapping mapping;
+			opened += mapping.Open( LooseFilePath( file ).c_str( ) );
+		}
+		const double open_ms = open_timer.Milliseconds( );
+		for ( uint32_t file = 0; file < file_count; ++file )
+			std::remove( LooseFilePath( file ).c_str( ) );
+		std::printf( "  lookup     %7.1f ns per path (%u found), opening a loose file %.1f us (%u opened)\n", lookup_ms * 1e6 / lookup_count, found,
+			open_ms * 1e3 / file_count, opened );
+
+		// decompression: every small entry on one thread, then the big one on one thread and on all of them.
+		// Best of several runs, the destination is touched up front like mapped upload memory
+		const uint32_t big = pack.Find( paths[file_count].c_str( ) );
+		const double big_size = double( pack.EntrySize( big ) );
+		read.assign( files[file_count].size( ), 0 );
+		double all_ms = 1e30, big_ms = 1e30, parallel_ms = 1e30;
+		for ( int run = 0; run < 5; ++run )
+		{
+			Timer all_timer;
+			for ( uint32_t entry = 0; entry < pack.EntryCount( ); ++entry )
+				if ( entry != big )
+					pack.ReadEntry( entry, read.data( ) );
+			all_ms = std::min( all_ms, all_timer.Milliseconds( ) );
+
+			Timer big_timer;
+			pack.ReadEntry( big, read.data( ) );
+			big_ms = std::min( big_ms, big_timer.Milliseconds( ) );
+
+			Timer parallel_timer;
+			pack.ReadEntry( big, read.data( ), thread_count );
+			parallel_ms = std::min( parallel_ms, parallel_timer.Milliseconds( ) );
+		}
+		std::printf( "  decompress %7.1f ms for the small entries %6.1f MB/s\n", all_ms, ( total_size - big_size ) / all_ms / 1e3 );
+		std::printf( "             %7.1f ms for a %.1f MB entry %6.1f MB/s, %.1f ms on %u threads %6.1f MB/s\n", big_ms, big_size / 1048576.0,
+			big_size / big_ms / 1e3, parallel_ms, thread_count, big_size / parallel_ms / 1e3 );
+
+		pack.Close( );
+		std::remove( pack_path );
+		return 0;
+	}
+}
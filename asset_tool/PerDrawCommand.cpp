@@ -0,0 +1,398 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "FrameAllocator.h"
+#include "PerDrawParameter.h"
+#include "ShaderConstants.h"
+#include "Timer.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include "FrameUploadBuffer.h"
+#include "RootSignatureCache.h"
+#endif
+
+namespace AssetTool
+{
+	namespace
+	{
+		using namespace DXLayer;
+
+		// exactly the budget, and one DWORD over it
+		typedef CBufferLayout<hlsl::float4x4> SixteenDwordLayout;
+		typedef CBufferLayout<hlsl::float4x4, hlsl::float1> SeventeenDwordLayout;
+
+		// a partly used register, root constants take the 5 DWORDs, a cbv the whole 256 bytes
+		typedef CBufferLayout<hlsl::float4, hlsl::float1> FiveDwordLayout;
+
+		static_assert( PerDrawParameter<PerDrawLayout>::num_32bit_values == 12 && PerDrawParameter<PerDrawLayout>::uses_root_constants,
+			"the renderer's per draw data is meant to be root constants" );
+		static_assert( PerDrawParameter<SixteenDwordLayout>::uses_root_constants && !PerDrawParameter<SeventeenDwordLayout>::uses_root_constants,
+			"budget" );
+		static_assert( PerDrawParameter<FiveDwordLayout>::num_32bit_values == 5, "root constants count DWORDs, not registers" );
+
+		enum RecordedCommand : uint32_t
+		{
+			recorded_constants = 1,
+			recorded_cbv = 2
+		};
+
+		// the root argument calls of ID3D12GraphicsCommandList, appended to a command stream the way a driver records
+		// them: an opcode, the root parameter index, then the constants or the 64-bit address inline
+		struct RecordingCommandList
+		{
+			std::vector<uint32_t> commands;
+
+			void SetGraphicsRoot32BitConstants( uint32_t root_parameter_index, uint32_t num_32bit_values, const void* values, uint32_t offset )
+			{
+				const size_t at = commands.size( );
+				commands.resize( at + 3 + num_32bit_values );
+				commands[at] = recorded_constants | num_32bit_values << 8;
+				commands[at + 1] = root_parameter_index;
+				commands[at + 2] = offset;
+				std::memcpy( &commands[at + 3], values, num_32bit_values * sizeof( uint32_t ) );
+			}
+
+			void SetGraphicsRootConstantBufferView( uint32_t root_parameter_index, uint64_t gpu_address )
+			{
+				const uint32_t command[] = { recorded_cbv, root_parameter_index, uint32_t( gpu_address ), uint32_t( gpu_address >> 32 ) };
+				commands.insert( commands.end( ), command, command + 4 );
+			}
+		};
+
+		// FrameUploadBuffer's Allocate over plain memory, gpu addresses are made up from a base
+		struct UploadMemory
+		{
+			struct Allocation
+			{
+				uint8_t* cpu_address;
+				uint64_t gpu_address;
+				uint64_t offset;
+			};
+
+			static const uint64_t gpu_base = 0x7f0000000000ull;
+
+			FrameAllocator allocator;
+			std::vector<uint8_t> memory;
+
+			explicit UploadMemory( uint64_t size )
+				: memory( static_cast<size_t>( size ) )
+			{
+				allocator.Init( size, 1 );
+			}
+
+			bool Allocate( uint64_t size, uint64_t alignment, Allocation& allocation )
+			{
+				const uint64_t offset = allocator.Allocate( size, alignment );
+				if ( offset == FrameAllocator::invalid_offset )
+					return false;
+				allocation.cpu_address = &memory[static_cast<size_t>( offset )];
+				allocation.gpu_address = gpu_base + offset;
+				allocation.offset = offset;
+				return true;
+			}
+		};
+
+		// RootSignatureBuilder's Add, straight into a description
+		struct DescriptionBuilder
+		{
+			RootSignatureDescription description;
+
+			uint32_t Add( const RootParameterDescription& parameter )
+			{
+				description.parameters.push_back( parameter );
+				return uint32_t( description.parameters.size( ) - 1 );
+			}
+		};
+
+		void FillPerDraw( CBufferWriter<PerDrawLayout>& params, uint32_t draw )
+		{
+			params.Set<PerDrawLayout::bounds_center>( DirectX::XMFLOAT3( float( draw ), 1.0f, 2.0f ) );
+			params.Set<PerDrawLayout::object_index>( draw );
+			params.Set<PerDrawLayout::bounds_extent>( DirectX::XMFLOAT3( 0.5f, 0.5f, 0.5f ) );
+			params.Set<PerDrawLayout::material_index>( draw % 7 );
+			params.Set<PerDrawLayout::tint>( DirectX::XMFLOAT4( 1.0f, 0.5f, 0.25f, 1.0f ) );
+		}
+
+		void FillMatrix( CBufferWriter<SixteenDwordLayout>& params, uint32_t draw )
+		{
+			DirectX::XMFLOAT4X4 world = { };
+			world.m[0][0] = world.m[1][1] = world.m[2][2] = world.m[3][3] = 1.0f;
+			world.m[3][0] = float( draw );
+			params.Set<0>( world );
+		}
+
+		// the payload one Set leaves behind, wherever it went
+		template<typename Layout>
+		bool RecordedPayload( const RecordingCommandList& list, const UploadMemory& upload, uint32_t root_parameter_index, std::vector<uint8_t>& payload )
+		{
+			const std::vector<uint32_t>& commands = list.commands;
+			if ( commands.size( ) < 2 || commands[1] != root_parameter_index )
+				return false;
+			if ( ( commands[0] & 0xff ) == recorded_constants )
+			{
+				const uint32_t count = commands[0] >> 8;
+				if ( commands.size( ) != 3 + count || commands[2] != 0 )
+					return false;
+				payload.resize( count * sizeof( uint32_t ) );
+				std::memcpy( payload.data( ), &commands[3], payload.size( ) );
+				return true;
+			}
+			if ( commands[0] != recorded_cbv || commands.size( ) != 4 )
+				return false;
+			const uint64_t offset = ( commands[2] | uint64_t( commands[3] ) << 32 ) - UploadMemory::gpu_base;
+			if ( offset % cbuffer_placement_alignment || offset + Layout::cbv_size > upload.memory.size( ) )
+				return false;
+			payload.assign( upload.memory.begin( ) + static_cast<size_t>( offset ), upload.memory.begin( ) + static_cast<size_t>( offset ) + Layout::Pack::end );
+			return true;
+		}
+
+		// adds the parameter after a table, sets it once and checks where the payload went and that it arrived whole
+		template<typename Layout, uint32_t Budget = per_draw_root_constants_budget>
+		void CheckParameter( Check& check, const char* name, bool expect_root_constants )
+		{
+			typedef PerDrawParameter<Layout, Budget> Parameter;
+			check( Parameter::uses_root_constants == expect_root_constants, name, Parameter::uses_root_constants, expect_root_constants );
+
+			DescriptionBuilder builder;
+			builder.Add( RootParameterDescription( ) );
+			Parameter parameter;
+			parameter.AddToRootSignature( builder, 3, 1, 1 );
+			const RootParameterDescription& added = builder.description.parameters.back( );
+			const bool described = expect_root_constants ?
+				added.type == root_parameter_constants && added.num_32bit_values == Parameter::num_32bit_values && added.flags == 0 :
+				added.type == root_parameter_cbv && added.num_32bit_values == 0 && added.flags == root_descriptor_data_static;
+			check( described && added.shader_register == 3 && added.register_space == 1 && added.visibility == 1 && parameter.RootParameterIndex( ) == 1,
+				name, added.type, expect_root_constants ? root_parameter_constants : root_parameter_cbv );
+			const uint32_t cost = 1 + ( expect_root_constants ? Parameter::num_32bit_values : 2 );
+			check( RootSignatureCost( builder.description ) == cost, name, RootSignatureCost( builder.description ), cost );
+
+			// every byte of the payload written, read back from wherever it was recorded
+			RecordingCommandList list;
+			UploadMemory upload( 4096 );
+			UploadMemory::Allocation taken;
+			upload.Allocate( 4, 4, taken ); // so a cbv has to be aligned past it
+			uint8_t expected[Layout::Pack::end];
+			for ( uint32_t i = 0; i < sizeof( expected ); ++i )
+				expected[i] = uint8_t( i * 7 + 1 );
+			const bool set = parameter.Set( &list, upload, [ & ] ( CBufferWriter<Layout>& params ) { std::memcpy( params.Data( ), expected, sizeof( expected ) ); } );
+			std::vector<uint8_t> payload;
+			const bool recorded = set && RecordedPayload<Layout>( list, upload, 1, payload );
+			check( recorded && payload.size( ) >= sizeof( expected ) && std::memcmp( payload.data( ), expected, sizeof( expected ) ) == 0,
+				name, (long long)( payload.size( ) ), (long long)( sizeof( expected ) ) );
+			check( upload.allocator.FrameUsed( ) == ( expect_root_constants ? 4 : cbuffer_placement_alignment + Layout::cbv_size ), name,
+				(long long)( upload.allocator.FrameUsed( ) ), expect_root_constants ? 4 : cbuffer_placement_alignment + Layout::cbv_size );
+		}
+	
+		template <typename Run>
+		double BestOf( int runs, Run run )
+		{
+			double best = 1e30;
+			for ( int r = 0; r < runs; ++r )
+			{
+				Timer timer;
+				run( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+
+		struct BenchResult
+		{
+			double ms;
+			uint64_t command_bytes;
+			uint64_t upload_bytes;
+		};
+
+		// draws parameter sets into the recording list, fill writes draw's payload
+		template<typename Layout, uint32_t Budget, typename Fill>
+		BenchResult BenchParameter( uint32_t draws, Fill fill, RecordingCommandList& list, UploadMemory& upload, bool& all_set )
+		{
+			PerDrawParameter<Layout, Budget> parameter;
+			DescriptionBuilder builder;
+			parameter.AddToRootSignature( builder, 0 );
+			BenchResult result;
+			result.ms = BestOf( 5, [ & ] ( )
+			{
+				list.commands.clear( );
+				upload.allocator.BeginFrame( 0 );
+				for ( uint32_t draw = 0; draw < draws; ++draw )
+					all_set &= parameter.Set( &list, upload, [ & ] ( CBufferWriter<Layout>& params ) { fill( params, draw ); } );
+			} );
+			result.command_bytes = list.commands.size( ) * sizeof( uint32_t );
+			result.upload_bytes = upload.allocator.FrameUsed( );
+			return result;
+		}
+
+#ifdef _WIN32
+		// the same on a command list of the warp device. The list is recorded and closed, never executed: without a pso
+		// or render target there is nothing to draw, what is measured is the runtime and driver recording the arguments
+		template<typename Layout, uint32_t Budget, typename Fill>
+		BenchResult BenchParameterOnDevice( uint32_t draws, Fill fill, RootSignatureCache& root_signature_cache, ID3D12CommandAllocator* command_allocator,
+			ID3D12GraphicsCommandList* command_list, FrameUploadBuffer& upload_buffer, bool& all_set )
+		{
+			PerDrawParameter<Layout, Budget> parameter;
+			RootSignatureBuilder builder( D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT );
+			parameter.AddToRootSignature( builder, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX );
+			ID3D12RootSignature* root_signature = root_signature_cache.GetOrCreate( builder );
+			BenchResult result = { 0.0, 0, 0 };
+			if ( !root_signature )
+			{
+				all_set = false;
+				return result;
+			}
+			result.ms = BestOf( 5, [ & ] ( )
+			{
+				command_allocator->Reset( );
+				command_list->Reset( command_allocator, nullptr );
+				upload_buffer.BeginFrame( 0 );
+				command_list->SetGraphicsRootSignature( root_signature );
+				for ( uint32_t draw = 0; draw < draws; ++draw )
+					all_set &= parameter.Set( command_list, upload_buffer, [ & ] ( CBufferWriter<Layout>& params ) { fill( params, draw ); } );
+				all_set &= SUCCEEDED( command_list->Close( ) );
+			} );
+			result.upload_bytes = upload_buffer.Allocator( ).FrameUsed( );
+			return result;
+		}
+
+		int BenchOnDevice( uint32_t draws, uint64_t upload_size )
+		{
+			IDXGIFactory4* factory = nullptr;
+			IDXGIAdapter* warp = nullptr;
+			ID3D12Device* device = nullptr;
+			if ( FAILED( CreateDXGIFactory1( IID_PPV_ARGS( &factory ) ) ) || FAILED( factory->EnumWarpAdapter( IID_PPV_ARGS( &warp ) ) ) ||
+				FAILED( D3D12CreateDevice( warp, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS( &device ) ) ) )
+			{
+				std::fprintf( stderr, "no warp device\n" );
+				if ( warp )
+					warp->Release( );
+				if ( factory )
+					factory->Release( );
+				return 1;
+			}
+
+			ID3D12CommandAllocator* command_allocator = nullptr;
+			ID3D12GraphicsCommandList* command_list = nullptr;
+			RootSignatureCache root_signature_cache;
+			FrameUploadBuffer upload_buffer;
+			bool ready = SUCCEEDED( device->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS( &command_allocator ) ) ) &&
+				SUCCEEDED( device->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_DIRECT, command_allocator, nullptr, IID_PPV_ARGS( &command_list ) ) ) &&
+				SUCCEEDED( command_list->Close( ) ) && root_signature_cache.Init( device, nullptr ) &&
+				upload_buffer.Init( device, upload_size, 1, L"Per Draw Bench Upload Buffer" );
+
+			bool all_set = ready;
+			if ( ready )
+			{
+				const BenchResult results[] = {
+					BenchParameterOnDevice<PerDrawLayout, 64>( draws, FillPerDraw, root_signature_cache, command_allocator, command_list, upload_buffer, all_set ),
+					BenchParameterOnDevice<PerDrawLayout, 0>( draws, FillPerDraw, root_signature_cache, command_allocator, command_list, upload_buffer, all_set ),
+					BenchParameterOnDevice<SixteenDwordLayout, 64>( draws, FillMatrix, root_signature_cache, command_allocator, command_list, upload_buffer, all_set ),
+					BenchParameterOnDevice<SixteenDwordLayout, 0>( draws, FillMatrix, root_signature_cache, command_allocator, command_list, upload_buffer, all_set ),
+				};
+				std::printf( "\nwarp command list\n" );
+				for ( size_t i = 0; i < 4; ++i )
+					std::printf( "%-10s %-14s %9.1f %12s %12.0f\n", i < 2 ? "per draw" : "matrix", i % 2 ? "root cbv" : "root constants",
+						results[i].ms * 1e6 / draws, "-", results[i].upload_bytes / double( draws ) );
+			}
+
+			upload_buffer.Release( );
+			root_signature_cache.Release( );
+			if ( command_list )
+				command_list->Release( );
+			if ( command_allocator )
+				command_allocator->Release( );
+			device->Release( );
+			warp->Release( );
+			factory->Release( );
+			if ( !all_set )
+			{
+				std::fprintf( stderr, "setting the parameters on the device failed\n" );
+				return 1;
+			}
+			return 0;
+		}
+#endif
+	}
+
+	int CheckPerDrawCommand( int, char** )
+	{
+		Check check;
+
+		// the budget decides, 16 DWORDs still go into the root signature, 17 are bound as a cbv
+		CheckParameter<PerDrawLayout>( check, "per draw data, 12 DWORDs", true );
+		CheckParameter<SixteenDwordLayout>( check, "16 DWORDs", true );
+		CheckParameter<SeventeenDwordLayout>( check, "17 DWORDs", false );
+		CheckParameter<FiveDwordLayout>( check, "5 DWORDs", true );
+		CheckParameter<FiveDwordLayout, 4>( check, "5 DWORDs over a budget of 4", false );
+		CheckParameter<PerDrawLayout, 0>( check, "per draw data without a budget", false );
+
+		// a cbv that doesn't fit into the upload buffer any more fails the set and records nothing
+		{
+			PerDrawParameter<SeventeenDwordLayout> parameter;
+			RecordingCommandList list;
+			UploadMemory upload( 128 );
+			const bool set = parameter.Set( &list, upload, [ ] ( CBufferWriter<SeventeenDwordLayout>& ) { } );
+			check( !set && list.commands.empty( ), "upload buffer full", (long long)( list.commands.size( ) ), 0 );
+		}
+
+		return check.Report( "per draw parameter" );
+	}
+
+	int BenchPerDrawCommand( int argc, char** argv )
+	{
+		uint32_t draws = 100000;
+		bool on_device = false;
+		for ( int i = 0; i < argc; ++i )
+		{
+			if ( std::strcmp( argv[i], "--device" ) == 0 )
+				on_device = true;
+			else
+				draws = std::max( 1u, uint32_t( std::strtoul( argv[i], nullptr, 10 ) ) );
+		}
+
+		// both payloads once as root constants, once as a root cbv, whatever the budget would pick
+		const uint64_t upload_size = uint64_t( draws ) * 256;
+		RecordingCommandList list;
+		list.commands.reserve( size_t( draws ) * 20 );
+		UploadMemory upload( upload_size );
+		bool all_set = true;
+		const BenchResult results[] = {
+			BenchParameter<PerDrawLayout, 64>( draws, FillPerDraw, list, upload, all_set ),
+			BenchParameter<PerDrawLayout, 0>( draws, FillPerDraw, list, upload, all_set ),
+			BenchParameter<SixteenDwordLayout, 64>( draws, FillMatrix, list, upload, all_set ),
+			BenchParameter<SixteenDwordLayout, 0>( draws, FillMatrix, list, upload, all_set ),
+		};
+		if ( !all_set )
+		{
+			std::fprintf( stderr, "setting the parameters failed\n" );
+			return 1;
+		}
+
+		std::printf( "%u draws, per draw data of 12 DWORDs and a 16 DWORD matrix\n\n", draws );
+		std::printf( "%-10s %-14s %9s %12s %12s\n", "payload", "bound as", "ns/draw", "list bytes", "upload bytes" );
+		for ( size_t i = 0; i < 4; ++i )
+			std::printf( "%-10s %-14s %9.1f %12.0f %12.0f\n", i < 2 ? "per draw" : "matrix", i % 2 ? "root cbv" : "root constants",
+				results[i].ms * 1e6 / draws, results[i].command_bytes / double( draws ), results[i].upload_bytes / double( draws ) );
+		std::printf( "\nroot constants are copied into the command list, a root cbv writes the payload to upload memory and records its\n"
+			"address. On the cpu side that is what a draw costs, the gpu side, the extra load through the cbv, isn't measured here\n" );
+
+		if ( on_device )
+		{
+#ifdef _WIN32
+			return BenchOnDevice( draws, upload_size );
+#else
+			std::fprintf( stderr, "--device needs d3d12\n" );
+			return 1;
+#endif
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,277 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "ReadbackRing.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		struct Check
+		{
+			int failed = 0;
+			int count = 0;
+
+			void operator( )( bool passed, const char* name, long long got, long long expected )
+			{
+				++count;
+				if ( passed )
+					return;
+				std::fprintf( stderr, "%s: got %lld, expected %lld\n", name, got, expected );
+				++failed;
+			}
+		};
+
+		uint8_t PatternByte( uint32_t id, uint64_t i )
+		{
+			return uint8_t( ( id * 2654435761u ) >> 24 ^ ( i * 31 ) ^ ( i >> 8 ) );
+		}
+
+		// a copy the simulated gpu makes when its submission runs
+		struct SimulatedCopy
+		{
+			uint32_t id;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct SimulatedSubmission
+		{
+			uint64_t fence_value;
+			uint32_t done_frame;
+			std::vector<SimulatedCopy> copies;
+		};
+
+		// what the readback ring gets from a renderer and a gpu running frames behind it: readbacks of every size
+		// asked for each frame, some of them from the callbacks of earlier ones, submissions finishing 1 to 3 frames
+		// later and now and then a stall of 20 frames. The gpu writes each copy when its submission finishes, so a slot
+		// handed out again too early is overwritten before its callback reads it
+		struct Simulation
+		{
+			DXLayer::ReadbackRing ring;
+			std::vector<uint8_t> memory;
+			std::mt19937 rng;
+			std::deque<SimulatedSubmission> gpu;
+			std::vector<SimulatedCopy> recording;
+			std::deque<uint32_t> expected;				// ids in flight, in the order their callbacks are due
+			std::vector<uint64_t> fence_values;			// of each id
+			std::vector<uint32_t> asked_frame;
+			uint64_t completed = 0;
+			uint32_t frame = 0;
+			uint32_t next_id = 0;
+			uint32_t errors = 0;
+			uint64_t delivered = 0, refused = 0, follow_ups = 0, latency_frames = 0, max_used = 0;
+			uint32_t max_in_flight = 0;
+
+			Simulation( uint64_t size )
+				: memory( size ), rng( 23 )
+			{
+				ring.Init( size );
+			}
+
+			void Error( const char* what, uint32_t id )
+			{
+				if ( errors++ < 10 )
+					std::fprintf( stderr, "frame %u, readback %u: %s\n", frame, id, what );
+			}
+
+			void Ask( uint64_t size, uint64_t alignment, bool follow_up )
+			{
+				const uint32_t id = next_id;
+				const uint64_t offset = ring.Allocate( size, alignment, [ this, id, size ] ( const uint8_t* data, uint64_t data_size ) { Deliver( id, size, data, data_size ); } );
+				if ( offset == DXLayer::ReadbackRing::invalid_offset )
+				{
+					++refused;
+					return;
+				}
+				++next_id;
+				follow_ups += follow_up;
+				if ( offset % alignment || offset + size > memory.size( ) )
+					Error( "slot misplaced", id );
+
+				// nothing in flight may share bytes with the new slot
+				for ( const SimulatedSubmission& submission : gpu )
+				{
+					for ( const SimulatedCopy& copy : submission.copies )
+					{
+						if ( offset < copy.offset + copy.size && copy.offset < offset + size )
+							Error( "slot overlaps one in flight", id );
+					}
+				}
+				for ( const SimulatedCopy& copy : recording )
+				{
+					if ( offset < copy.offset + copy.size && copy.offset < offset + size )
+						Error( "slot overlaps one being recorded", id );
+				}
+				recording.push_back( SimulatedCopy{ id, offset, size } );
+				expected.push_back( id );
+				fence_values.push_back( ring.NextFenceValue( ) );
+				asked_frame.push_back( frame );
+				max_in_flight = std::max( max_in_flight, ring.InFlight( ) );
+				max_used = std::max( max_used, ring.Used( ) );
+			}
+
+			void Deliver( uint32_t id, uint64_t size, const uint8_t* data, uint64_t data_size )
+			{
+				if ( expected.empty( ) || expected.front( ) != id )
+					Error( "called back out of order", id );
+				else
+					expected.pop_front( );
+				if ( fence_values[id] > completed )
+					Error( "called back before its fence completed", id );
+				if ( data_size != size )
+					Error( "called back with the wrong size", id );
+				for ( uint64_t i = 0; i < data_size; ++i )
+				{
+					if ( data[i] != PatternByte( id, i ) )
+					{
+						Error( "data overwritten", id );
+						break;
+					}
+				}
+				++delivered;
+				latency_frames += frame - asked_frame[id];
+
+				// a tenth of them ask again right away, say for the next feedback buffer
+				if ( rng( ) % 10 == 0 )
+					Ask( 64 + rng( ) % 4096, 16, true );
+			}
+
+			void AskRandom( )
+			{
+				const uint64_t alignments[] = { 8, 16, 256, 512 };
+				const uint32_t kind = rng( ) % 100;
+				const uint64_t size = kind < 70 ? 8 + rng( ) % 505 : kind < 95 ? 1024 + rng( ) % 15361 : 65536 + rng( ) % 196609;
+				Ask( size, alignments[rng( ) % 4], false );
+			}
+
+			void RunGpu( )
+			{
+				while ( !gpu.empty( ) && gpu.front( ).done_frame <= frame )
+				{
+					for ( const SimulatedCopy& copy : gpu.front( ).copies )
+					{
+						for ( uint64_t i = 0; i < copy.size; ++i )
+							memory[copy.offset + i] = PatternByte( copy.id, i );
+					}
+					completed = gpu.front( ).fence_value;
+					gpu.pop_front( );
+				}
+			}
+
+			void Frame( bool ask, uint32_t stall )
+			{
+				RunGpu( );
+				ring.Retire( completed, memory.data( ) );
+				if ( ask )
+				{
+					for ( uint32_t count = rng( ) % 6; count; --count )
+						AskRandom( );
+				}
+
+				const uint32_t done_frame = std::max( gpu.empty( ) ? 0 : gpu.back( ).done_frame, frame + 1 + uint32_t( rng( ) % 3 ) + stall );
+				gpu.push_back( SimulatedSubmission{ ring.Submit( ), done_frame, std::move( recording ) } );
+				recording.clear( );
+				++frame;
+			}
+		};
+
+		void CheckBasics( Check& check )
+		{
+			DXLayer::ReadbackRing ring;
+			ring.Init( 1024 );
+			std::vector<uint8_t> memory( 1024 );
+			std::vector<int> order;
+			const auto record = [ &order ] ( int id ) { return [ &order, id ] ( const uint8_t*, uint64_t ) { order.push_back( id ); }; };
+
+			// 300 at 0, 300 at 512, and a third would have to wrap into the first
+			check( ring.Allocate( 300, 256, record( 0 ) ) == 0, "first slot", ring.Used( ), 300 );
+			check( ring.Allocate( 300, 256, record( 1 ) ) == 512, "second slot aligned", ring.Used( ), 812 );
+			check( ring.Allocate( 300, 256, record( 2 ) ) == DXLayer::ReadbackRing::invalid_offset, "full ring refuses", ring.InFlight( ), 2 );
+			check( ring.Allocate( 2048, 1, record( 2 ) ) == DXLayer::ReadbackRing::invalid_offset, "larger than the ring", ring.InFlight( ), 2 );
+
+			check( ring.Retire( 0, memory.data( ) ) == 0, "nothing back before a submit", int( order.size( ) ), 0 );
+			const uint64_t first = ring.Submit( );
+			check( first == 1, "first fence value", first, 1 );
+			check( ring.Retire( first - 1, memory.data( ) ) == 0, "nothing back before the fence", int( order.size( ) ), 0 );
+
+			// a slot for the next submission isn't called back with the ones before it
+			check( ring.Allocate( 100, 8, record( 2 ) ) == 816, "third slot after the second", ring.Used( ), 916 );
+			check( ring.Retire( first, memory.data( ) ) == 2, "submission back", int( order.size( ) ), 2 );
+			check( order.size( ) == 2 && order[0] == 0 && order[1] == 1, "in order", order.size( ) == 2 ? order[1] : -1, 1 );
+			check( ring.Used( ) == 916 - 812, "space given back", ring.Used( ), 916 - 812 );
+
+			// 200 doesn't fit after 916, it wraps to 0 and the gap goes with it
+			check( ring.Allocate( 200, 8, record( 3 ) ) == 0, "wrapped", ring.Used( ), 104 + 308 );
+			const uint64_t second = ring.Submit( );
+			check( ring.Retire( second, memory.data( ) ) == 2 && order.back( ) == 3, "wrapped slot back", int( order.size( ) ), 4 );
+			check( ring.Used( ) == 0 && ring.InFlight( ) == 0, "empty again", ring.Used( ), 0 );
+
+			// callbacks can ask again, the new slot goes out with the next submission
+			order.clear( );
+			ring.Allocate( 64, 8, [ & ] ( const uint8_t*, uint64_t ) { order.push_back( 0 ); ring.Allocate( 64, 8, record( 1 ) ); } );
+			const uint64_t third = ring.Submit( );
+			ring.Retire( third, memory.data( ) );
+			check( order.size( ) == 1 && ring.InFlight( ) == 1, "asked again from a callback", ring.InFlight( ), 1 );
+			ring.Retire( third, memory.data( ) );
+			check( order.size( ) == 1, "not back with the submission before it", int( order.size( ) ), 1 );
+			ring.Retire( ring.Submit( ), memory.data( ) );
+			check( order.size( ) == 2 && order[1] == 1, "back with its own", int( order.size( ) ), 2 );
+
+			ring.Allocate( 64, 8, record( 2 ) );
+			ring.Clear( );
+			ring.Retire( ~0ull, memory.data( ) );
+			check( order.size( ) == 2 && ring.Used( ) == 0, "cleared without calling back", int( order.size( ) ), 2 );
+		}
+	}
+
+	int CheckReadbackCommand( int argc, char** argv )
+	{
+		const uint32_t frames = argc > 0 ? std::max( 1u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 20000;
+		Check check;
+		CheckBasics( check );
+		std::printf( "%d readback ring checks, %d failed\n", check.count, check.failed );
+
+		// 1 MB of ring, a gpu stalling for 20 frames every 1000, then drained
+		Simulation simulation( 1 << 20 );
+		for ( uint32_t frame = 0; frame < frames; ++frame )
+			simulation.Frame( true, frame % 1000 == 999 ? 20 : 0 );
+		while ( simulation.ring.InFlight( ) )
+			simulation.Frame( false, 0 );
+		if ( !simulation.expected.empty( ) )
+			simulation.Error( "never called back", simulation.expected.front( ) );
+		if ( simulation.ring.Used( ) )
+			simulation.Error( "space left in use", 0 );
+		std::printf( "%u frames, %llu readbacks called back (%llu asked from callbacks), %llu refused while the ring was full, %.2f frames late on average\n",
+			frames, (unsigned long long)simulation.delivered, (unsigned long long)simulation.follow_ups, (unsigned long long)simulation.refused,
+			double( simulation.latency_frames ) / std::max( 1ull, (unsigned long long)simulation.delivered ) );
+		std::printf( "at most %u in flight in %.0f KB, %u errors\n", simulation.max_in_flight, simulation.max_used / 1024.0, simulation.errors );
+
+		// the cost of a readback to the cpu: a slot, its callback, giving it back
+		DXLayer::ReadbackRing ring;
+		ring.Init( 1 << 20 );
+		std::vector<uint8_t> memory( 1 << 20 );
+		uint64_t sum = 0;
+		const uint32_t readbacks = 1 << 20;
+		Timer timer;
+		for ( uint32_t i = 0; i < readbacks; ++i )
+		{
+			ring.Allocate( 8 + i % 256, 8, [ &sum ] ( const uint8_t*, uint64_t size ) { sum += size; } );
+			if ( i % 16 == 15 )
+			{
+				const uint64_t submitted = ring.Submit( );
+				ring.Retire( submitted > 2 ? submitted - 2 : 0, memory.data( ) );
+			}
+		}
+		const double ms = timer.Milliseconds( );
+		std::printf( "%.0f ns a readback through the ring (%llu bytes)\n", ms * 1e6 / readbacks, (unsigned long long)sum );
+		return check.failed || simulation.errors ? 1 : 0;
+	}
+}
@@ -0,0 +1,223 @@
+#include "Commands.h"
+
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "RootSignatureDescription.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		using DXLayer::RootParameterDescription;
+		using DXLayer::RootSignatureBlobs;
+		using DXLayer::RootSignatureDescription;
+
+		RootParameterDescription Parameter( DXLayer::RootParameterType type, uint32_t shader_register, uint32_t num_32bit_values = 0, uint32_t flags = 0 )
+		{
+			RootParameterDescription parameter = { };
+			parameter.type = type;
+			parameter.shader_register = shader_register;
+			parameter.num_32bit_values = num_32bit_values;
+			parameter.flags = flags;
+			return parameter;
+		}
+
+		// what the renderer's signature looks like plus a table and a sampler, put together from scratch every call
+		RootSignatureDescription MainSignature( )
+		{
+			RootSignatureDescription description = { };
+			description.flags = 1;		// ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
+			description.parameters.push_back( Parameter( DXLayer::root_parameter_constants, 0, 12 ) );
+			description.parameters.push_back( Parameter( DXLayer::root_parameter_cbv, 1, 0, 8 ) );
+			RootParameterDescription table = Parameter( DXLayer::root_parameter_table, 0 );
+			table.visibility = 5;		// pixel
+			table.ranges.push_back( { 0, 4, 0, 0, 4, 0 } );
+			table.ranges.push_back( { 0, 1, 4, 0, 0, 4 } );
+			description.parameters.push_back( table );
+			DXLayer::RootStaticSampler sampler = { };
+			sampler.filter = 0x15;
+			sampler.address_u = sampler.address_v = sampler.address_w = 1;
+			sampler.max_lod = 1000.0f;
+			description.static_samplers.push_back( sampler );
+			return description;
+		}
+
+		std::vector<char> Blob( std::mt19937& rng, size_t size )
+		{
+			std::vector<char> blob( size );
+			for ( auto& byte : blob )
+				byte = char( rng( ) );
+			return blob;
+		}
+
+		std::string Saved( RootSignatureBlobs& blobs )
+		{
+			std::ostringstream stream( std::ios::binary );
+			blobs.Save( stream );
+			return stream.str( );
+		}
+
+		bool Load( RootSignatureBlobs& blobs, const std::string& file )
+		{
+			std::istringstream stream( file, std::ios::binary );
+			return blobs.Load( stream );
+		}
+	}
+
+	int CheckRootSignaturesCommand( int, char** )
+	{
+		Check check;
+
+		// equal descriptions hash, compare and serialize equal, changing any one thing changes all three
+		const uint64_t hash = DXLayer::HashRootSignature( MainSignature( ) );
+		check( DXLayer::HashRootSignature( MainSignature( ) ) == hash, "equal descriptions" );
+		check( MainSignature( ) == MainSignature( ) && !( MainSignature( ) != MainSignature( ) ), "equal descriptions compare equal" );
+		check( DXLayer::SerializeRootSignatureDescription( MainSignature( ) ) == DXLayer::SerializeRootSignatureDescription( MainSignature( ) ),
+			"equal descriptions serialize equal" );
+		check( DXLayer::RootSignatureCost( MainSignature( ) ) == 15, "cost", DXLayer::RootSignatureCost( MainSignature( ) ), 15 );
+		{
+			std::vector<RootSignatureDescription> changed( 10, MainSignature( ) );
+			changed[0].flags = 0;
+			changed[1].parameters[0].num_32bit_values = 11;
+			changed[2].parameters[1].type = DXLayer::root_parameter_srv;
+			changed[3].parameters[1].flags = 2;
+			changed[4].parameters[2].visibility = 0;
+			changed[5].parameters[2].ranges[1].base_shader_register = 5;
+			changed[6].parameters[2].ranges.pop_back( );
+			std::swap( changed[7].parameters[0], changed[7].parameters[1] );
+			changed[8].static_samplers[0].max_lod = 0.0f;
+			changed[9].static_samplers.clear( );
+			for ( size_t i = 0; i < changed.size( ); ++i )
+			{
+				const std::string name = "changed description " + std::to_string( i );
+				check( DXLayer::HashRootSignature( changed[i] ) != hash, name.c_str( ) );
+				check( changed[i] != MainSignature( ), ( name + " compares" ).c_str( ) );
+				check( DXLayer::SerializeRootSignatureDescription( changed[i] ) != DXLayer::SerializeRootSignatureDescription( MainSignature( ) ),
+					( name + " serializes" ).c_str( ) );
+			}
+		}
+
+		// the cache keys its signatures and blobs by hash, so equal descriptions share one entry
+		{
+			std::mt19937 rng( 26 );
+			RootSignatureBlobs blobs;
+			RootSignatureDescription other = MainSignature( );
+			other.parameters.pop_back( );
+			const RootSignatureDescription descriptions[] = { MainSignature( ), other, MainSignature( ) };
+			for ( const auto& description : descriptions )
+			{
+				const uint64_t key = RootSignatureBlobs::Key( DXLayer::HashRootSignature( description ), 2 );
+				if ( !blobs.Find( key, description ) )
+				{
+					const std::vector<char> blob = Blob( rng, 64 );
+					blobs.Store( key, description, blob.data( ), blob.size( ) );
+				}
+			}
+			check( blobs.Count( ) == 2, "equal descriptions share a blob", (long long)( blobs.Count( ) ), 2 );
+			check( RootSignatureBlobs::Key( hash, 1 ) != RootSignatureBlobs::Key( hash, 2 ), "1.0 and 1.1 blobs keyed apart" );
+			check( blobs.Dirty( ), "dirty after store" );
+
+			// two descriptions colliding on one key: each only ever gets the blob serialized from itself
+			const uint64_t key = RootSignatureBlobs::Key( hash, 2 );
+			check( !blobs.Find( key, other ), "colliding key, other description" );
+			const std::vector<char> other_blob = Blob( rng, 64 );
+			blobs.Store( key, other, other_blob.data( ), other_blob.size( ) );
+			const std::vector<char>* found = blobs.Find( key, other );
+			check( found && *found == other_blob && !blobs.Find( key, MainSignature( ) ), "colliding key replaced" );
+		}
+
+		// blobs survive a save and a load byte for byte
+		std::mt19937 rng( 1 );
+		RootSignatureBlobs saved;
+		std::vector<std::vector<char>> contents;
+		std::vector<RootSignatureDescription> described;
+		const size_t sizes[] = { 1, 3, 52, 700, 65536 };
+		for ( size_t i = 0; i < 5; ++i )
+		{
+			contents.push_back( Blob( rng, sizes[i] ) );
+			described.push_back( MainSignature( ) );
+			described.back( ).parameters[0].shader_register = uint32_t( i );
+			saved.Store( 1000 + i, described.back( ), contents.back( ).data( ), contents.back( ).size( ) );
+		}
+		const std::string file = Saved( saved );
+		check( !saved.Dirty( ), "clean after save" );
+		{
+			RootSignatureBlobs loaded;
+			const std::vector<char> stale( 10, 'x' );
+			loaded.Store( 7, MainSignature( ), stale.data( ), stale.size( ) );
+			check( Load( loaded, file ), "load" );
+			check( loaded.Count( ) == contents.size( ), "blob count", (long long)( loaded.Count( ) ), (long long)( contents.size( ) ) );
+			check( !loaded.Find( 7, MainSignature( ) ), "load replaces the blobs" );
+			check( !loaded.Dirty( ), "clean after load" );
+			int wrong_descriptions_found = 0;
+			for ( size_t i = 0; i < contents.size( ); ++i )
+			{
+				const std::vector<char>* blob = loaded.Find( 1000 + i, described[i] );
+				check( blob && *blob == contents[i], "blob round trip", (long long)( blob ? blob->size( ) : 0 ), (long long)( contents[i].size( ) ) );
+				wrong_descriptions_found += loaded.Find( 1000 + i, described[( i + 1 ) % described.size( )] ) != nullptr;
+			}
+			check( wrong_descriptions_found == 0, "loaded blobs keep their descriptions", wrong_descriptions_found, 0 );
+			check( Saved( loaded ).size( ) == file.size( ), "saved again", (long long)( Saved( loaded ).size( ) ), (long long)( file.size( ) ) );
+		}
+
+		// a damaged file leaves no blobs and asks to be rewritten, whatever is wrong with it
+		const auto rejected = [ & ] ( const std::string& damaged, const char* name )
+		{
+			RootSignatureBlobs loaded;
+			const bool loaded_it = Load( loaded, damaged );
+			check( !loaded_it && loaded.Count( ) == 0 && loaded.Dirty( ), name, (long long)( loaded.Count( ) ), 0 );
+		};
+		int truncations_accepted = 0;
+		for ( size_t size = 0; size < file.size( ); size += size < 64 ? 1 : 997 )
+		{
+			RootSignatureBlobs loaded;
+			truncations_accepted += Load( loaded, file.substr( 0, size ) ) || loaded.Count( );
+		}
+		check( truncations_accepted == 0, "truncated files rejected", truncations_accepted, 0 );
+		rejected( file + std::string( 5, '\0' ), "trailing bytes" );
+		{
+			std::string damaged = file;
+			damaged[0] ^= 1;
+			rejected( damaged, "wrong magic" );
+			damaged = file;
+			damaged[4] ^= 1;
+			rejected( damaged, "wrong version" );
+			damaged = file;
+			damaged[8] += 1;
+			rejected( damaged, "blob count too high" );
+			damaged = file;
+			damaged[8] -= 1;
+			rejected( damaged, "blob count too low" );
+			// the first blob's description and blob sizes, 4 GB, must be refused before anything is allocated for them
+			const size_t description_size = 12 + 8, blob_size = 12 + 12;
+			for ( size_t field : { description_size, blob_size } )
+			{
+				damaged = file;
+				for ( size_t i = 0; i < 4; ++i )
+					damaged[field + i] = char( 0xff );
+				rejected( damaged, field == blob_size ? "blob size past the end" : "description size past the end" );
+				for ( size_t i = 0; i < 4; ++i )
+					damaged[field + i] = 0;
+				rejected( damaged, field == blob_size ? "empty blob" : "empty description" );
+			}
+
+			// a description changed on disk no longer matches the one asking for the blob
+			damaged = file;
+			damaged[12 + 16 + 4] ^= 1;
+			RootSignatureBlobs loaded;
+			int found = 0;
+			if ( Load( loaded, damaged ) )
+				for ( size_t i = 0; i < described.size( ); ++i )
+					found += loaded.Find( 1000 + i, described[i] ) != nullptr;
+			check( found == int( described.size( ) ) - 1, "damaged description not found", found, (long long)( described.size( ) ) - 1 );
+		}
+		rejected( std::string( ), "empty file" );
+
+		return check.Report( "root signature" );
+	}
+}
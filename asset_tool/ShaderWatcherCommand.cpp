@@ -0,0 +1,256 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ShaderWatcher.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		using DXLayer::ShaderWatcher;
+
+		// shader sources in memory. A file is its includes and a body; editing it bumps its write time, compiling a
+		// shader concatenates the bodies of everything it includes, so the code shows what it was compiled from
+		struct FakeFiles
+		{
+			struct File
+			{
+				std::vector<std::wstring> includes;
+				std::string body;
+				uint64_t write_time;
+			};
+
+			std::map<std::wstring, File> files;
+			std::map<std::wstring, int> compiles;	// by shader path
+			int failing_compiles = 0;				// the next ones fail whatever the code, like a file still being saved
+			uint64_t clock = 0;
+
+			void Edit( const std::wstring& path, const std::string& body, std::vector<std::wstring> includes )
+			{
+				File& file = files[path];
+				file.body = body;
+				file.includes = std::move( includes );
+				file.write_time = ++clock;
+			}
+
+			std::vector<std::wstring> ScanIncludes( const std::wstring& path ) const
+			{
+				auto it = files.find( path );
+				return it != files.end( ) ? it->second.includes : std::vector<std::wstring>( );
+			}
+
+			uint64_t WriteTime( const std::wstring& path ) const
+			{
+				auto it = files.find( path );
+				return it != files.end( ) ? it->second.write_time : 0;
+			}
+
+			// a body containing "error" doesn't compile, a diamond's shared file is pasted once like #pragma once does
+			bool Compile( const std::wstring& path, std::vector<char>& bytecode )
+			{
+				++compiles[path];
+				if ( failing_compiles > 0 )
+				{
+					--failing_compiles;
+					return false;
+				}
+				std::string code;
+				std::vector<std::wstring> included;
+				if ( !Preprocess( path, included, code ) || code.find( "error" ) != std::string::npos )
+					return false;
+				bytecode.assign( code.begin( ), code.end( ) );
+				return true;
+			}
+
+			bool Preprocess( const std::wstring& path, std::vector<std::wstring>& included, std::string& code ) const
+			{
+				if ( std::find( included.begin( ), included.end( ), path ) != included.end( ) )
+					return true;
+				included.push_back( path );
+				auto it = files.find( path );
+				if ( it == files.end( ) )
+					return false;
+				for ( const auto& include : it->second.includes )
+					if ( !Preprocess( include, included, code ) )
+						return false;
+				code += it->second.body + ";";
+				return true;
+			}
+		};
+
+		std::string Code( const ShaderWatcher& watcher, uint32_t shader_id )
+		{
+			const std::vector<char>& code = watcher.Code( shader_id );
+			return std::string( code.begin( ), code.end( ) );
+		}
+
+		// links everything but shaders whose code contains "unlinkable", and remembers what it was asked
+		struct FakeLinker
+		{
+			const ShaderWatcher* watcher;
+			std::vector<std::vector<uint32_t>> calls;
+
+			std::vector<uint32_t> operator( )( const std::vector<uint32_t>& staged )
+			{
+				calls.push_back( staged );
+				std::vector<uint32_t> failed;
+				for ( uint32_t shader_id : staged )
+					if ( Code( *watcher, shader_id ).find( "unlinkable" ) != std::string::npos )
+						failed.push_back( shader_id );
+				return failed;
+			}
+		};
+
+		std::vector<uint32_t> Sorted( std::vector<uint32_t> ids )
+		{
+			std::sort( ids.begin( ), ids.end( ) );
+			return ids;
+		}
+	}
+
+	int CheckShaderWatcherCommand( int, char** )
+	{
+		Check check;
+
+		// a diamond: main.hlsl includes lighting.hlsli and shadows.hlsli, both include common.hlsli.
+		// pixel.hlsl includes shadows.hlsli only, vertex.hlsl nothing
+		FakeFiles files;
+		files.Edit( L"common.hlsli", "common", { } );
+		files.Edit( L"lighting.hlsli", "lighting", { L"common.hlsli" } );
+		files.Edit( L"shadows.hlsli", "shadows", { L"common.hlsli" } );
+		files.Edit( L"main.hlsl", "main", { L"lighting.hlsli", L"shadows.hlsli" } );
+		files.Edit( L"pixel.hlsl", "pixel", { L"shadows.hlsli" } );
+		files.Edit( L"vertex.hlsl", "vertex", { } );
+
+		// the graph alone first
+		{
+			DXLayer::ShaderDependencyGraph graph( [&files] ( const std::wstring& path ) { return files.ScanIncludes( path ); } );
+			graph.AddShader( 0, L"main.hlsl" );
+			graph.AddShader( 1, L"pixel.hlsl" );
+			graph.AddShader( 2, L"vertex.hlsl" );
+			check( graph.Files( ).size( ) == 6, "files in the graph", (long long)( graph.Files( ).size( ) ), 6 );
+			check( Sorted( graph.Invalidate( { L"common.hlsli" } ) ) == std::vector<uint32_t>{ 0, 1 }, "diamond bottom invalidates both sides, once" );
+			check( graph.Invalidate( { L"lighting.hlsli" } ) == std::vector<uint32_t>{ 0 }, "one side of the diamond" );
+			check( graph.Invalidate( { L"vertex.hlsl" } ) == std::vector<uint32_t>{ 2 }, "a shader without includes" );
+			check( Sorted( graph.Invalidate( { L"lighting.hlsli", L"pixel.hlsl" } ) ) == std::vector<uint32_t>{ 0, 1 }, "two files changed" );
+			check( graph.Invalidate( { L"unknown.hlsli" } ).empty( ), "a file nothing includes" );
+
+			// an include cycle must not hang the scan or the invalidation
+			files.Edit( L"common.hlsli", "common", { L"lighting.hlsli" } );
+			check( Sorted( graph.Invalidate( { L"common.hlsli" } ) ) == std::vector<uint32_t>{ 0, 1 }, "include cycle" );
+			files.Edit( L"common.hlsli", "common", { } );
+			graph.Invalidate( { L"common.hlsli" } );
+		}
+
+		ShaderWatcher watcher(
+			[&files] ( const std::wstring& path, const std::string&, const std::string&, std::vector<char>& bytecode ) { return files.Compile( path, bytecode ); },
+			[&files] ( const std::wstring& path ) { return files.WriteTime( path ); },
+			[&files] ( const std::wstring& path ) { return files.ScanIncludes( path ); } );
+		const uint32_t main_shader = watcher.Add( L"main.hlsl", "main", "ps_5_0" );
+		const uint32_t pixel_shader = watcher.Add( L"pixel.hlsl", "main", "ps_5_0" );
+		const uint32_t vertex_shader = watcher.Add( L"vertex.hlsl", "main", "vs_5_0" );
+		check( Code( watcher, main_shader ) == "common;lighting;shadows;main;", "diamond compiled with its shared file once" );
+		check( watcher.Add( L"missing.hlsl", "main", "ps_5_0" ) == ShaderWatcher::invalid_shader, "missing shader" );
+
+		FakeLinker linker = { &watcher, { } };
+		const auto apply = [&] ( ) { return Sorted( watcher.ApplyUpdates( std::ref( linker ) ) ); };
+		const auto compiles = [&files] ( const wchar_t* path ) { return files.compiles[path]; };
+
+		// nothing changed, nothing compiled, link not even asked
+		files.compiles.clear( );
+		watcher.Poll( );
+		check( apply( ).empty( ) && linker.calls.empty( ) && files.compiles.empty( ), "quiet poll" );
+
+		// the bottom of the diamond: both shaders above it recompiled, once each, the other one left alone
+		files.Edit( L"common.hlsli", "common2", { } );
+		watcher.Poll( );
+		check( Code( watcher, main_shader ) == "common;lighting;shadows;main;", "nothing applied before ApplyUpdates" );
+		check( apply( ) == std::vector<uint32_t>{ main_shader, pixel_shader }, "diamond edit applied" );
+		check( compiles( L"main.hlsl" ) == 1 && compiles( L"pixel.hlsl" ) == 1 && compiles( L"vertex.hlsl" ) == 0, "diamond edit compiles",
+			compiles( L"main.hlsl" ), 1 );
+		check( Code( watcher, main_shader ) == "common2;lighting;shadows;main;" && Code( watcher, pixel_shader ) == "common2;shadows;pixel;",
+			"diamond edit code" );
+
+		// vertex.hlsl gains an include: it is recompiled for the edit, and afterwards for edits of the new include
+		files.compiles.clear( );
+		files.Edit( L"vertex.hlsl", "vertex", { L"skinning.hlsli" } );
+		files.Edit( L"skinning.hlsli", "skinning", { } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ vertex_shader } && Code( watcher, vertex_shader ) == "skinning;vertex;", "include gained" );
+		files.Edit( L"skinning.hlsli", "skinning2", { } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ vertex_shader } && Code( watcher, vertex_shader ) == "skinning2;vertex;", "new include watched" );
+
+		// main.hlsl loses lighting.hlsli: editing that no longer recompiles it
+		files.Edit( L"main.hlsl", "main", { L"shadows.hlsli" } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ main_shader } && Code( watcher, main_shader ) == "common2;shadows;main;", "include lost" );
+		files.compiles.clear( );
+		files.Edit( L"lighting.hlsli", "lighting2", { } );
+		watcher.Poll( );
+		check( apply( ).empty( ) && files.compiles.empty( ), "lost include not watched", (long long)( files.compiles.size( ) ), 0 );
+
+		// a compile error keeps the old code of everything it broke, fixing it brings the new code in
+		files.compiles.clear( );
+		files.Edit( L"shadows.hlsli", "shadows error", { L"common.hlsli" } );
+		watcher.Poll( );
+		check( apply( ).empty( ) && compiles( L"main.hlsl" ) == 1 && compiles( L"pixel.hlsl" ) == 1, "compile error applies nothing" );
+		check( Code( watcher, main_shader ) == "common2;shadows;main;" && Code( watcher, pixel_shader ) == "common2;shadows;pixel;",
+			"compile error keeps the old code" );
+		files.Edit( L"shadows.hlsli", "shadows3", { L"common.hlsli" } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ main_shader, pixel_shader } && Code( watcher, pixel_shader ) == "common2;shadows3;pixel;",
+			"fixed compile error" );
+		check( compiles( L"main.hlsl" ) == 2 && compiles( L"pixel.hlsl" ) == 2, "fixed compile error compiles once", compiles( L"main.hlsl" ), 2 );
+
+		// a compile that fails without the file changing again is retried on the next poll, until it works
+		files.compiles.clear( );
+		files.failing_compiles = 2;
+		files.Edit( L"vertex.hlsl", "vertex3", { L"skinning.hlsli" } );
+		watcher.Poll( );
+		check( apply( ).empty( ) && Code( watcher, vertex_shader ) == "skinning2;vertex;", "transient compile failure keeps the old code" );
+		watcher.Poll( );
+		check( apply( ).empty( ) && compiles( L"vertex.hlsl" ) == 2, "failed again", compiles( L"vertex.hlsl" ), 2 );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ vertex_shader } && Code( watcher, vertex_shader ) == "skinning2;vertex3;",
+			"transient compile failure retried without an edit" );
+		watcher.Poll( );
+		check( apply( ).empty( ) && compiles( L"vertex.hlsl" ) == 3 && compiles( L"main.hlsl" ) == 0, "retries stop once it compiles",
+			compiles( L"vertex.hlsl" ), 3 );
+
+		// compiles but doesn't link: the old code stays, the shaders that did link are kept, and link is asked again
+		// with only those so nothing built with the rejected code survives
+		linker.calls.clear( );
+		files.Edit( L"pixel.hlsl", "pixel unlinkable", { L"shadows.hlsli" } );
+		files.Edit( L"vertex.hlsl", "vertex2", { L"skinning.hlsli" } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ vertex_shader }, "link failure drops only the failing shader" );
+		check( Code( watcher, pixel_shader ) == "common2;shadows3;pixel;" && Code( watcher, vertex_shader ) == "skinning2;vertex2;",
+			"link failure keeps the old code" );
+		check( linker.calls.size( ) == 2 && Sorted( linker.calls[0] ) == std::vector<uint32_t>{ pixel_shader, vertex_shader } &&
+			linker.calls[1] == std::vector<uint32_t>{ vertex_shader }, "link asked again without the failing shader", (long long)( linker.calls.size( ) ), 2 );
+		files.Edit( L"pixel.hlsl", "pixel", { L"shadows.hlsli" } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ pixel_shader } && Code( watcher, pixel_shader ) == "common2;shadows3;pixel;", "fixed link failure" );
+
+		// nothing links: everything goes back
+		linker.calls.clear( );
+		files.Edit( L"common.hlsli", "common unlinkable", { } );
+		watcher.Poll( );
+		check( apply( ).empty( ) && linker.calls.size( ) == 1, "nothing links", (long long)( linker.calls.size( ) ), 1 );
+		check( Code( watcher, main_shader ) == "common2;shadows3;main;" && Code( watcher, pixel_shader ) == "common2;shadows3;pixel;",
+			"nothing links keeps all old code" );
+
+		// and a later edit that links is taken
+		files.Edit( L"common.hlsli", "common4", { } );
+		watcher.Poll( );
+		check( apply( ) == std::vector<uint32_t>{ main_shader, pixel_shader } && Code( watcher, main_shader ) == "common4;shadows3;main;", "linked again" );
+
+		return check.Report( "shader watcher" );
+	}
+}
@@ -0,0 +1,209 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "LodSelector.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjFile.h"
+#include "TestMeshes.h"
+#include "Timer.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		// MakeTorus radii, the generated meshes can be checked against the exact surface
+		const float torus_major_radius = 1.0f;
+		const float torus_minor_radius = 0.4f;
+
+		float TorusDistance( const float* p )
+		{
+			const float ring = std::sqrt( p[0] * p[0] + p[2] * p[2] ) - torus_major_radius;
+			return std::fabs( std::sqrt( ring * ring + p[1] * p[1] ) - torus_minor_radius );
+		}
+
+		// distance of edge midpoints and centroids to the exact torus, the vertices themselves are on it
+		void MeasureTorusDeviation( const ObjMesh& mesh, const uint32_t* indices, size_t index_count, double& max_deviation, double& mean_deviation )
+		{
+			max_deviation = 0.0;
+			double sum = 0.0;
+			size_t samples = 0;
+			for ( size_t i = 0; i < index_count; i += 3 )
+			{
+				const float* p[3];
+				for ( int k = 0; k < 3; ++k )
+					p[k] = mesh.vertices[indices[i + k]].position;
+
+				float points[4][3];
+				for ( int c = 0; c < 3; ++c )
+				{
+					points[0][c] = ( p[0][c] + p[1][c] ) * 0.5f;
+					points[1][c] = ( p[1][c] + p[2][c] ) * 0.5f;
+					points[2][c] = ( p[2][c] + p[0][c] ) * 0.5f;
+					points[3][c] = ( p[0][c] + p[1][c] + p[2][c] ) / 3.0f;
+				}
+				for ( const auto& point : points )
+				{
+					const double deviation = TorusDistance( point );
+					max_deviation = std::max( max_deviation, deviation );
+					sum += deviation;
+					samples++;
+				}
+			}
+			mean_deviation = samples ? sum / samples : 0.0;
+		}
+
+		// a quarter of the ring removed, which leaves a tube with two open borders
+		void CutTorusOpen( ObjMesh& mesh )
+		{
+			size_t write = 0;
+			for ( size_t i = 0; i < mesh.indices.size( ); i += 3 )
+			{
+				float centroid[3] = { };
+				for ( int k = 0; k < 3; ++k )
+					for ( int c = 0; c < 3; ++c )
+						centroid[c] += mesh.vertices[mesh.indices[i + k]].position[c] / 3.0f;
+				if ( centroid[0] > 0.0f && centroid[2] > 0.0f )
+					continue;
+				for ( int k = 0; k < 3; ++k )
+					mesh.indices[write++] = mesh.indices[i + k];
+			}
+			mesh.indices.resize( write );
+		}
+
+		void BenchLodChain( const char* name, const ObjMesh& mesh )
+		{
+			const float extent = DXLayer::MeshExtent( mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ) );
+			std::printf( "%s: %zu triangles, %zu vertices, extent %.2f\n", name, mesh.indices.size( ) / 3, mesh.vertices.size( ), extent );
+
+			DXLayer::LodChainOptions options;
+			options.max_lods = 8;
+			options.max_error = 0.1f;
+
+			std::vector<uint32_t> lod_indices;
+			std::vector<DXLayer::MeshLod> lods;
+			Timer timer;
+			DXLayer::BuildLodChain( mesh.indices.data( ), mesh.indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ), mesh.vertices.size( ), lod_indices, lods, options );
+			const double chain_ms = timer.Milliseconds( );
+
+			std::printf( "  lod chain %.1f ms (%.2f M input triangles/s), %zu lods, %.2fx the lod 0 index data\n",
+				chain_ms, mesh.indices.size( ) / 3 / chain_ms / 1000.0, lods.size( ), double( lod_indices.size( ) ) / mesh.indices.size( ) );
+			for ( size_t l = 0; l < lods.size( ); ++l )
+			{
+				double max_deviation, mean_deviation;
+				MeasureTorusDeviation( mesh, lod_indices.data( ) + lods[l].first_index, lods[l].index_count, max_deviation, mean_deviation );
+				const DXLayer::VertexCacheStats cache = DXLayer::AnalyzeVertexCache( lod_indices.data( ) + lods[l].first_index, lods[l].index_count, mesh.vertices.size( ) );
+				std::printf( "  lod %zu: %8u triangles  error %.5f  measured max %.5f mean %.5f  acmr %.3f\n", l, lods[l].index_count / 3,
+					lods[l].error / extent, max_deviation / extent, mean_deviation / extent, cache.acmr );
+			}
+
+			// single simplification straight to 1% of the triangles, what the chain's last steps compete with
+			std::vector<uint32_t> simplified( mesh.indices.size( ) );
+			float error = 0.0f;
+			Timer direct_timer;
+			const size_t index_count = DXLayer::SimplifyMesh( simplified.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ),
+				mesh.vertices.size( ), mesh.indices.size( ) / 300 * 3, 1.0f, &error );
+			const double direct_ms = direct_timer.Milliseconds( );
+			double max_deviation, mean_deviation;
+			MeasureTorusDeviation( mesh, simplified.data( ), index_count, max_deviation, mean_deviation );
+			std::printf( "  direct to 1%%: %zu triangles in %.1f ms (%.2f M triangles/s), error %.5f  measured max %.5f mean %.5f\n",
+				index_count / 3, direct_ms, mesh.indices.size( ) / 3 / direct_ms / 1000.0, error, max_deviation / extent, mean_deviation / extent );
+
+			// camera drifting back and forth with some jitter, like a player walking around the object while the view bobs.
+			// The range is centered on the distance where the middle lod hits the error budget
+			const float fov_y = 1.0472f;
+			const float viewport_height = 1080.0f;
+			const float middle_distance = lods[lods.size( ) / 2].error * DXLayer::PerspectivePixelsPerUnit( 1.0f, fov_y, viewport_height ) / DXLayer::LodSelectParams( ).max_error_pixels;
+			const int frame_count = 2000;
+			const float hysteresis_values[] = { 0.0f, 0.25f };
+			for ( float hysteresis : hysteresis_values )
+			{
+				DXLayer::LodSelectParams params;
+				params.hysteresis = hysteresis;
+
+				std::mt19937 random( 3 );
+				std::uniform_real_distribution<float> jitter( -0.03f, 0.03f );
+				uint32_t lod = 0;
+				uint32_t switches = 0;
+				size_t triangles = 0;
+				for ( int frame = 0; frame < frame_count; ++frame )
+				{
+					const float distance = middle_distance * std::pow( 4.0f, std::sin( frame * 0.01f ) ) * ( 1.0f + jitter( random ) );
+					const float pixels_per_unit = DXLayer::PerspectivePixelsPerUnit( distance, fov_y, viewport_height );
+					const uint32_t selected = DXLayer::SelectLod( lods.data( ), uint32_t( lods.size( ) ), pixels_per_unit, lod, params );
+					switches += selected != lod;
+					lod = selected;
+					triangles += lods[lod].index_count / 3;
+				}
+				std::printf( "  selection, hysteresis %.2f: %u lod switches over %d frames, %.0f triangles drawn on average\n",
+					hysteresis, switches, frame_count, double( triangles ) / frame_count );
+			}
+		}
+	}
+
+	int SimplifyCommand( int argc, char** argv )
+	{
+		if ( argc < 2 || argc > 4 )
+		{
+			std::fprintf( stderr, "usage: asset_tool simplify <in.obj> <out.obj> [ratio] [error]\n" );
+			return 1;
+		}
+		const float ratio = argc > 2 ? float( std::atof( argv[2] ) ) : 0.5f;
+		const float target_error = argc > 3 ? float( std::atof( argv[3] ) ) : 0.01f;
+
+		ObjMesh mesh;
+		std::string error;
+		if ( !LoadObj( argv[0], mesh, error ) )
+		{
+			std::fprintf( stderr, "%s\n", error.c_str( ) );
+			return 1;
+		}
+		if ( mesh.indices.empty( ) )
+		{
+			std::fprintf( stderr, "%s has no triangles\n", argv[0] );
+			return 1;
+		}
+
+		const size_t target_index_count = size_t( mesh.indices.size( ) / 3 * ratio ) * 3;
+		std::vector<uint32_t> indices( mesh.indices.size( ) );
+		float result_error = 0.0f;
+		Timer timer;
+		const size_t index_count = DXLayer::SimplifyMesh( indices.data( ), mesh.indices.data( ), mesh.indices.size( ), mesh.vertices[0].position, sizeof( ObjVertex ),
+			mesh.vertices.size( ), target_index_count, target_error, &result_error );
+		const double simplify_ms = timer.Milliseconds( );
+		std::printf( "%s: %zu -> %zu triangles in %.1f ms, error %.5f of the extent\n", argv[0], mesh.indices.size( ) / 3, index_count / 3, simplify_ms, result_error );
+
+		// drop the vertices nothing uses anymore
+		indices.resize( index_count );
+		DXLayer::OptimizeVertexCache( mesh.indices.data( ), indices.data( ), index_count, mesh.vertices.size( ) );
+		mesh.indices.resize( index_count );
+		std::vector<ObjVertex> vertices( mesh.vertices.size( ) );
+		vertices.resize( DXLayer::OptimizeVertexFetch( vertices.data( ), mesh.indices.data( ), index_count, mesh.vertices.data( ), mesh.vertices.size( ), sizeof( ObjVertex ) ) );
+		mesh.vertices.swap( vertices );
+
+		if ( !SaveObj( argv[1], mesh ) )
+		{
+			std::fprintf( stderr, "can't write %s\n", argv[1] );
+			return 1;
+		}
+		return 0;
+	}
+
+	int BenchSimplifyCommand( int argc, char** argv )
+	{
+		const uint32_t triangle_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 1000000;
+
+		ObjMesh torus = MakeTorus( triangle_count );
+		BenchLodChain( "closed torus", torus );
+
+		ObjMesh open_torus = MakeTorus( triangle_count );
+		CutTorusOpen( open_torus );
+		BenchLodChain( "open torus", open_torus );
+		return 0;
+	}
+}
@@ -0,0 +1,158 @@
+#include "TestImages.h"
+
+#include <cmath>
+#include <random>
+
+namespace AssetTool
+{
+	namespace
+	{
+		float Hash( int32_t x, int32_t y, uint32_t seed )
+		{
+			uint32_t h = uint32_t( x ) * 0x8da6b343u ^ uint32_t( y ) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+			h ^= h >> 13;
+			h *= 0x5bd1e995u;
+			h ^= h >> 15;
+			return float( h & 0xffffff ) / float( 0xffffff );
+		}
+
+		float Smooth( float t )
+		{
+			return t * t * ( 3.0f - 2.0f * t );
+		}
+
+		// value noise in 0..1
+		float Noise( float x, float y, uint32_t seed )
+		{
+			const int32_t ix = int32_t( std::floor( x ) ), iy = int32_t( std::floor( y ) );
+			const float fx = Smooth( x - float( ix ) ), fy = Smooth( y - float( iy ) );
+			const float top = Hash( ix, iy, seed ) + ( Hash( ix + 1, iy, seed ) - Hash( ix, iy, seed ) ) * fx;
+			const float bottom = Hash( ix, iy + 1, seed ) + ( Hash( ix + 1, iy + 1, seed ) - Hash( ix, iy + 1, seed ) ) * fx;
+			return top + ( bottom - top ) * fy;
+		}
+
+		// octaves of noise from a feature size of period texels down, 0..1
+		float Fractal( float x, float y, float period, uint32_t octaves, uint32_t seed )
+		{
+			float sum = 0.0f, amplitude = 0.5f, total = 0.0f;
+			for ( uint32_t octave = 0; octave < octaves; ++octave )
+			{
+				sum += Noise( x / period, y / period, seed + octave ) * amplitude;
+				total += amplitude;
+				amplitude *= 0.5f;
+				period *= 0.5f;
+			}
+			return sum / total;
+		}
+
+		uint8_t Byte( float value )
+		{
+			return uint8_t( value <= 0.0f ? 0 : value >= 255.0f ? 255 : int( value + 0.5f ) );
+		}
+
+		Image MakeImage( uint32_t size )
+		{
+			Image image;
+			image.width = image.height = size;
+			image.texels.resize( size_t( size ) * size * 4 );
+			return image;
+		}
+
+		void Set( Image& image, uint32_t x, uint32_t y, float r, float g, float b, float a )
+		{
+			uint8_t* texel = &image.texels[( size_t( y ) * image.width + x ) * 4];
+			texel[0] = Byte( r );
+			texel[1] = Byte( g );
+			texel[2] = Byte( b );
+			texel[3] = Byte( a );
+		}
+	}
+
+	std::vector<TestImage> MakeTestImages( uint32_t size )
+	{
+		std::vector<TestImage> images;
+		const float s = float( size );
+		std::mt19937 rng( 17 );
+		std::uniform_real_distribution<float> grain( -4.0f, 4.0f );
+
+		TestImage gradient = { "gradient", MakeImage( size ) };
+		for ( uint32_t y = 0; y < size; ++y )
+		{
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				const float u = x / s, v = y / s;
+				Set( gradient.image, x, y, 255.0f * u, 255.0f * v * v, 255.0f * ( 0.5f + 0.5f * std::sin( 6.2831853f * ( u + v ) ) ), 255.0f );
+			}
+		}
+		images.push_back( gradient );
+
+		// luminance with detail at every scale, hue drifting slowly over it, and sensor grain
+		TestImage photo = { "photo", MakeImage( size ) };
+		for ( uint32_t y = 0; y < size; ++y )
+		{
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				const float luminance = Fractal( float( x ), float( y ), s / 4.0f, 7, 1 ) * 255.0f;
+				const float warm = Fractal( float( x ), float( y ), s / 2.0f, 3, 20 ) - 0.5f;
+				const float green = Fractal( float( x ), float( y ), s / 3.0f, 3, 40 ) - 0.5f;
+				Set( photo.image, x, y, luminance * ( 1.0f + warm ) + grain( rng ), luminance * ( 1.0f + green * 0.5f ) + grain( rng ),
+					luminance * ( 1.0f - warm ) + grain( rng ), 255.0f );
+			}
+		}
+		images.push_back( photo );
+
+		// flat colors with hard edges: rings, bars and a checkerboard, what ui and text look like
+		TestImage shapes = { "shapes", MakeImage( size ) };
+		for ( uint32_t y = 0; y < size; ++y )
+		{
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				const float dx = x - s * 0.5f, dy = y - s * 0.5f;
+				const int ring = int( std::sqrt( dx * dx + dy * dy ) / ( s / 24.0f ) );
+				const bool bar = ( x / ( size / 32 + 1 ) ) % 5 == 0;
+				const bool check = ( ( x / 8 ) + ( y / 8 ) ) % 2 == 0;
+				if ( bar )
+					Set( shapes.image, x, y, 10.0f, 10.0f, 10.0f, 255.0f );
+				else if ( y < size / 4 )
+					Set( shapes.image, x, y, check ? 250.0f : 30.0f, check ? 250.0f : 30.0f, check ? 250.0f : 30.0f, 255.0f );
+				else
+					Set( shapes.image, x, y, ring % 3 == 0 ? 230.0f : 20.0f, ring % 3 == 1 ? 200.0f : 40.0f, ring % 3 == 2 ? 240.0f : 60.0f, 255.0f );
+			}
+		}
+		images.push_back( shapes );
+
+		// photo colors in a disc fading out at the rim, with holes cut out of it
+		TestImage sprite = { "sprite", MakeImage( size ) };
+		for ( uint32_t y = 0; y < size; ++y )
+		{
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				const float dx = ( x - s * 0.5f ) / ( s * 0.5f ), dy = ( y - s * 0.5f ) / ( s * 0.5f );
+				const float radius = std::sqrt( dx * dx + dy * dy );
+				float alpha = radius < 0.7f ? 255.0f : radius > 0.95f ? 0.0f : 255.0f * ( 0.95f - radius ) / 0.25f;
+				if ( Noise( float( x ) / ( s / 16.0f ), float( y ) / ( s / 16.0f ), 60 ) > 0.75f )
+					alpha = 0.0f;
+				const uint8_t* color = &photo.image.texels[( size_t( y ) * size + x ) * 4];
+				Set( sprite.image, x, y, color[0], color[1], color[2], alpha );
+			}
+		}
+		images.push_back( sprite );
+
+		// normals of a bumpy height field, xyz in rgb
+		TestImage normals = { "normals", MakeImage( size ) };
+		for ( uint32_t y = 0; y < size; ++y )
+		{
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				const float strength = s / 8.0f;
+				const float height = Fractal( float( x ), float( y ), s / 8.0f, 3, 80 );
+				const float slope_x = ( Fractal( float( x + 1 ), float( y ), s / 8.0f, 3, 80 ) - height ) * strength;
+				const float slope_y = ( Fractal( float( x ), float( y + 1 ), s / 8.0f, 3, 80 ) - height ) * strength;
+				const float length = std::sqrt( slope_x * slope_x + slope_y * slope_y + 1.0f );
+				Set( normals.image, x, y, 127.5f - 127.5f * slope_x / length, 127.5f - 127.5f * slope_y / length, 127.5f + 127.5f / length, 255.0f );
+			}
+		}
+		images.push_back( normals );
+		return images;
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageFile.h"
+
+// generated images for the texture bench commands, the kinds of content block compression has to deal with
+
+namespace AssetTool
+{
+	struct TestImage
+	{
+		const char* name;
+		Image image;
+	};
+
+	// size x size each: smooth gradients, a noisy photo-like image, hard edged shapes, a sprite with soft and cut
+	// out alpha, and a tangent space normal map
+	std::vector<TestImage> MakeTestImages( uint32_t size );
+}
@@ -0,0 +1,75 @@
+#include "TestMeshes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace AssetTool
+{
+	ObjMesh MakeTorus( uint32_t triangle_count )
+	{
+		const uint32_t minor_segments = std::max<uint32_t>( 3, uint32_t( std::sqrt( triangle_count / 4.0 ) ) );
+		const uint32_t major_segments = minor_segments * 2;
+		const float major_radius = 1.0f;
+		const float minor_radius = 0.4f;
+		const float two_pi = 6.28318531f;
+
+		ObjMesh mesh;
+		mesh.has_normals = true;
+		mesh.has_texcoords = true;
+
+		for ( uint32_t i = 0; i < major_segments; ++i )
+		{
+			const float u = float( i ) / float( major_segments );
+			for ( uint32_t j = 0; j < minor_segments; ++j )
+			{
+				const float v = float( j ) / float( minor_segments );
+				const float cu = std::cos( u * two_pi ), su = std::sin( u * two_pi );
+				const float cv = std::cos( v * two_pi ), sv = std::sin( v * two_pi );
+
+				ObjVertex vertex = { { ( major_radius + minor_radius * cv ) * cu, minor_radius * sv, ( major_radius + minor_radius * cv ) * su }, { cv * cu, sv, cv * su }, { u, v } };
+				mesh.vertices.push_back( vertex );
+			}
+		}
+
+		for ( uint32_t i = 0; i < major_segments; ++i )
+		{
+			for ( uint32_t j = 0; j < minor_segments; ++j )
+			{
+				const uint32_t a = i * minor_segments + j;
+				const uint32_t b = ( ( i + 1 ) % major_segments ) * minor_segments + j;
+				const uint32_t c = ( ( i + 1 ) % major_segments ) * minor_segments + ( j + 1 ) % minor_segments;
+				const uint32_t d = i * minor_segments + ( j + 1 ) % minor_segments;
+				const uint32_t quad[] = { a, d, b, b, d, c };
+				mesh.indices.insert( mesh.indices.end( ), quad, quad + 6 );
+			}
+		}
+		return mesh;
+	}
+
+	void Scramble( ObjMesh& mesh, uint32_t seed )
+	{
+		std::mt19937 random( seed );
+
+		const size_t triangle_count = mesh.indices.size( ) / 3;
+		for ( size_t t = triangle_count - 1; t > 0; --t )
+		{
+			const size_t other = random( ) % ( t + 1 );
+			for ( int k = 0; k < 3; ++k )
+				std::swap( mesh.indices[t * 3 + k], mesh.indices[other * 3 + k] );
+		}
+
+		std::vector<uint32_t> permutation( mesh.vertices.size( ) );
+		for ( size_t v = 0; v < permutation.size( ); ++v )
+			permutation[v] = uint32_t( v );
+		std::shuffle( permutation.begin( ), permutation.end( ), random );
+
+		std::vector<ObjVertex> vertices( mesh.vertices.size( ) );
+		for ( size_t v = 0; v < permutation.size( ); ++v )
+			vertices[permutation[v]] = mesh.vertices[v];
+		mesh.vertices.swap( vertices );
+
+		for ( auto& index : mesh.indices )
+			index = permutation[index];
+	}
+}
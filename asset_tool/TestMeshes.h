@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ObjFile.h"
+
+// generated meshes for the bench commands
+
+namespace AssetTool
+{
+	// a torus has no poles, no borders and hides part of itself from most directions
+	ObjMesh MakeTorus( uint32_t triangle_count );
+
+	// what a mesh looks like after an exporter that doesn't care: random triangle and vertex order
+	void Scramble( ObjMesh& mesh, uint32_t seed );
+}
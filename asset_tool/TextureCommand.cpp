@@ -0,0 +1,342 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileMapping.h"
+#include "SubresourceCopy.h"
+#include "TextureFile.h"
+#include "TextureFootprints.h"
+#include "Timer.h"
+#include "UploadBatch.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		using DXLayer::TextureLayoutDesc;
+
+		struct TextureCase
+		{
+			const char* name;
+			TextureLayoutDesc desc;
+			bool cube;
+			uint32_t container;		// TextureFileContainer
+			uint32_t vk_format;		// for ktx2
+			bool legacy_dds;		// DDS_PIXELFORMAT fourcc instead of the dx10 header
+		};
+
+		struct WrittenTexture
+		{
+			std::string path;
+			std::vector<uint8_t> file;
+			std::vector<uint64_t> offsets;	// of every subresource, worked out while writing
+			std::vector<uint64_t> sizes;
+			uint64_t texel_bytes;
+		};
+
+		void Append32( std::vector<uint8_t>& file, uint32_t value )
+		{
+			const size_t at = file.size( );
+			file.resize( at + 4 );
+			std::memcpy( &file[at], &value, 4 );
+		}
+
+		void Append64( std::vector<uint8_t>& file, uint64_t value )
+		{
+			Append32( file, uint32_t( value ) );
+			Append32( file, uint32_t( value >> 32 ) );
+		}
+
+		void AppendNoise( std::vector<uint8_t>& file, uint64_t size, std::mt19937& rng )
+		{
+			const size_t at = file.size( );
+			file.resize( at + size_t( size ) );
+			for ( size_t i = at; i < file.size( ); ++i )
+				file[i] = uint8_t( rng( ) );
+		}
+
+		// the tightly packed size of each mip of one array element
+		bool MipSizes( const TextureLayoutDesc& desc, std::vector<uint64_t>& sizes, uint32_t& element_count )
+		{
+			TextureLayoutDesc resolved;
+			uint32_t subresource_count;
+			if ( !DXLayer::ResolveTextureLayout( desc, resolved, subresource_count ) )
+				return false;
+			std::vector<DXLayer::TextureFootprint> footprints( resolved.mip_levels );
+			DXLayer::GetTextureFootprints( resolved, 0, resolved.mip_levels, 0, footprints.data( ) );
+			sizes.clear( );
+			for ( const DXLayer::TextureFootprint& footprint : footprints )
+				sizes.push_back( footprint.row_size * footprint.row_count * footprint.depth );
+			element_count = resolved.dimension == DXLayer::texture_3d ? 1 : resolved.depth_or_array_size;
+			return true;
+		}
+
+		// dds: every array element with its mip chain in turn
+		bool WriteDds( const TextureCase& texture_case, WrittenTexture& written, std::mt19937& rng )
+		{
+			uint8_t header[DXLayer::dds_header_size];
+			uint64_t data_size;
+			std::vector<uint64_t> mip_sizes;
+			uint32_t element_count;
+			if ( !DXLayer::WriteDdsHeader( texture_case.desc, texture_case.cube, header, data_size ) || !MipSizes( texture_case.desc, mip_sizes, element_count ) )
+				return false;
+
+			written.file.assign( header, header + DXLayer::dds_header_size );
+			if ( texture_case.legacy_dds )
+			{
+				// what d3dx9 wrote: the format as a fourcc and no dx10 header
+				const uint32_t dxt5 = 0x35545844;
+				std::memcpy( &written.file[4 + 72 + 8], &dxt5, 4 );
+				written.file.resize( 4 + 124 );
+			}
+			for ( uint32_t element = 0; element < element_count; ++element )
+			{
+				for ( uint64_t size : mip_sizes )
+				{
+					written.offsets.push_back( written.file.size( ) );
+					written.sizes.push_back( size );
+					AppendNoise( written.file, size, rng );
+				}
+			}
+			written.texel_bytes = data_size;
+			return true;
+		}
+
+		// ktx2: the level index up front, then the levels smallest first, each with its layers and faces in turn.
+		// There's no data format descriptor or key/value data, the reader needs neither
+		bool WriteKtx2( const TextureCase& texture_case, WrittenTexture& written, std::mt19937& rng )
+		{
+			std::vector<uint64_t> mip_sizes;
+			uint32_t element_count;
+			if ( !MipSizes( texture_case.desc, mip_sizes, element_count ) )
+				return false;
+			const TextureLayoutDesc& desc = texture_case.desc;
+			const uint32_t level_count = uint32_t( mip_sizes.size( ) );
+			const uint8_t identifier[12] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+			written.file.assign( identifier, identifier + 12 );
+			Append32( written.file, texture_case.vk_format );
+			Append32( written.file, 1 );
+			Append32( written.file, uint32_t( desc.width ) );
+			Append32( written.file, desc.dimension == DXLayer::texture_1d ? 0 : desc.height );
+			Append32( written.file, desc.dimension == DXLayer::texture_3d ? desc.depth_or_array_size : 0 );
+			Append32( written.file, desc.dimension == DXLayer::texture_3d || element_count == ( texture_case.cube ? 6u : 1u ) ? 0 : element_count / ( texture_case.cube ? 6 : 1 ) );
+			Append32( written.file, texture_case.cube ? 6 : 1 );
+			Append32( written.file, level_count );
+			Append32( written.file, 0 );
+			for ( int i = 0; i < 4; ++i )
+				Append32( written.file, 0 );
+			Append64( written.file, 0 );
+			Append64( written.file, 0 );
+			const size_t index = written.file.size( );
+			written.file.resize( index + level_count * 24 );
+
+			written.offsets.resize( level_count * element_count );
+			written.sizes.resize( level_count * element_count );
+			written.texel_bytes = 0;
+			for ( uint32_t mip = level_count; mip-- > 0; )
+			{
+				written.file.resize( ( written.file.size( ) + 15 ) & ~size_t( 15 ) );
+				const uint64_t level_offset = written.file.size( );
+				const uint64_t level_size = mip_sizes[mip] * element_count;
+				for ( uint32_t element = 0; element < element_count; ++element )
+				{
+					written.offsets[element * level_count + mip] = written.file.size( );
+					written.sizes[element * level_count + mip] = mip_sizes[mip];
+					AppendNoise( written.file, mip_sizes[mip], rng );
+				}
+				const uint64_t entry[3] = { level_offset, level_size, level_size };
+				std::memcpy( &written.file[index + mip * 24], entry, sizeof( entry ) );
+				written.texel_bytes += level_size;
+			}
+			return true;
+		}
+
+		bool SaveFile( const std::string& path, const std::vector<uint8_t>& data )
+		{
+			FILE* file = std::fopen( path.c_str( ), "wb" );
+			if ( !file )
+				return false;
+			const bool written = std::fwrite( data.data( ), 1, data.size( ), file ) == data.size( );
+			return std::fclose( file ) == 0 && written;
+		}
+
+		// the usual loader: the whole file into a heap buffer, then every subresource copied out of it
+		bool LoadFileToHeap( const std::string& path, std::vector<uint8_t>& data )
+		{
+			FILE* file = std::fopen( path.c_str( ), "rb" );
+			if ( !file )
+				return false;
+			std::fseek( file, 0, SEEK_END );
+			data.resize( size_t( std::ftell( file ) ) );
+			std::fseek( file, 0, SEEK_SET );
+			const bool read = std::fread( data.data( ), 1, data.size( ), file ) == data.size( );
+			std::fclose( file );
+			return read;
+		}
+
+		template <typename Load>
+		double BestOf( int runs, Load load )
+		{
+			double best = 1e30;
+			for ( int run = 0; run < runs; ++run )
+			{
+				Timer timer;
+				load( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+	}
+
+	int BenchTextureLoadCommand( int argc, char** argv )
+	{
+		const uint32_t size = argc > 0 ? std::max( 8u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 2048;
+		const uint32_t thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+
+		// DXGI_FORMAT values, the ktx2 cases carry the matching VkFormat
+		const uint32_t bc1 = 71, bc3 = 77, bc7 = 98, rgba8 = 28, r16f = 54, r8 = 61;
+		const TextureCase cases[] = {
+			{ "bc7 mips", { DXLayer::texture_2d, size, size, 1, 0, bc7 }, false, DXLayer::texture_file_dds, 0, false },
+			{ "bc3 dx9", { DXLayer::texture_2d, size, size, 1, 0, bc3 }, false, DXLayer::texture_file_dds, 0, true },
+			{ "rgba8 array", { DXLayer::texture_2d, size / 2, size / 2, 8, 0, rgba8 }, false, DXLayer::texture_file_dds, 0, false },
+			{ "bc1 cube", { DXLayer::texture_2d, size / 2, size / 2, 6, 0, bc1 }, true, DXLayer::texture_file_dds, 0, false },
+			{ "r16f volume", { DXLayer::texture_3d, size / 16, size / 16, size / 16, 0, r16f }, false, DXLayer::texture_file_dds, 0, false },
+			{ "r8 1d array", { DXLayer::texture_1d, size, 1, 64, 0, r8 }, false, DXLayer::texture_file_dds, 0, false },
+			{ "bc7 mips", { DXLayer::texture_2d, size, size, 1, 0, bc7 }, false, DXLayer::texture_file_ktx2, 145, false },
+			{ "rgba8 array", { DXLayer::texture_2d, size / 2, size / 2, 8, 0, rgba8 }, false, DXLayer::texture_file_ktx2, 37, false },
+			{ "bc1 cube", { DXLayer::texture_2d, size / 2, size / 2, 12, 0, bc1 }, true, DXLayer::texture_file_ktx2, 131, false },
+			{ "r16f volume", { DXLayer::texture_3d, size / 16, size / 16, size / 16, 0, r16f }, false, DXLayer::texture_file_ktx2, 76, false },
+		};
+		const size_t case_count = sizeof( cases ) / sizeof( cases[0] );
+
+		std::mt19937 rng( 13 );
+		std::vector<WrittenTexture> written( case_count );
+		for ( size_t i = 0; i < case_count; ++i )
+		{
+			written[i].path = "bench_texture_" + std::to_string( i ) + ( cases[i].container == DXLayer::texture_file_dds ? ".dds" : ".ktx2" );
+			const bool made = cases[i].container == DXLayer::texture_file_dds ? WriteDds( cases[i], written[i], rng ) : WriteKtx2( cases[i], written[i], rng );
+			if ( !made || !SaveFile( written[i].path, written[i].file ) )
+			{
+				std::fprintf( stderr, "can't write %s to the current directory\n", written[i].path.c_str( ) );
+				return 1;
+			}
+			written[i].file.clear( );
+		}
+
+		// stands in for the upload heap, touched up front like a persistently mapped buffer would be
+		std::vector<DXLayer::PlannedUpload> storage( 1024 );
+		DXLayer::UploadPlanner planner( storage.data( ), uint32_t( storage.size( ) ), 0 );
+		std::vector<uint8_t> upload;
+		DXLayer::SubresourceCopyOptions one_thread;
+		DXLayer::SubresourceCopyOptions all_threads;
+		all_threads.thread_count = thread_count;
+
+		std::printf( "%-12s %5s %6s %5s %4s %9s   %9s %9s %9s %9s  (GB/s of texel data)\n", "case", "file", "width", "array", "mips", "MB", "parse us", "heap", "mapped", "threads" );
+		const int runs = 5;
+		uint64_t total_bytes = 0;
+		double total_heap_ms = 0, total_mapped_ms = 0, total_threads_ms = 0;
+		for ( size_t i = 0; i < case_count; ++i )
+		{
+			const WrittenTexture& texture = written[i];
+			DXLayer::FileMapping mapping;
+			DXLayer::TextureFileView view;
+			std::string error;
+			if ( !mapping.Open( texture.path.c_str( ) ) || !DXLayer::ReadTextureFile( mapping.Data( ), mapping.Size( ), view, error ) )
+			{
+				std::fprintf( stderr, "can't read %s: %s\n", texture.path.c_str( ), error.c_str( ) );
+				return 1;
+			}
+			if ( view.subresource_count != texture.offsets.size( ) || view.cube != cases[i].cube )
+			{
+				std::fprintf( stderr, "%s: %u subresources read back, %zu written\n", texture.path.c_str( ), view.subresource_count, texture.offsets.size( ) );
+				return 1;
+			}
+			planner.Reset( 0 );
+			if ( !DXLayer::AddTextureFile( planner, 0, view ) )
+			{
+				std::fprintf( stderr, "%s has more subresources than the bench plans for\n", texture.path.c_str( ) );
+				return 1;
+			}
+			if ( upload.size( ) < planner.End( ) )
+				upload.resize( size_t( planner.End( ) ), 0 );
+			DXLayer::FillUploads( planner.Uploads( ), planner.Count( ), upload.data( ), all_threads );
+
+			// every row in the upload buffer has to be the one written at that subresource's offset
+			for ( uint32_t s = 0; s < planner.Count( ); ++s )
+			{
+				const DXLayer::PlannedUpload& planned = planner.Uploads( )[s];
+				const DXLayer::TextureFootprint& footprint = planned.footprint;
+				const uint64_t rows = uint64_t( footprint.row_count ) * footprint.depth;
+				if ( footprint.row_size * rows != texture.sizes[planned.subresource] )
+				{
+					std::fprintf( stderr, "%s subresource %u has the wrong size\n", texture.path.c_str( ), planned.subresource );
+					return 1;
+				}
+				for ( uint64_t row = 0; row < rows; ++row )
+				{
+					const uint8_t* staged = &upload[size_t( footprint.offset + ( row / footprint.row_count ) * footprint.row_pitch * footprint.row_count +
+						( row % footprint.row_count ) * footprint.row_pitch )];
+					if ( std::memcmp( staged, mapping.Data( ) + texture.offsets[planned.subresource] + row * footprint.row_size, size_t( footprint.row_size ) ) != 0 )
+					{
+						std::fprintf( stderr, "%s subresource %u row %llu isn't the one in the file\n", texture.path.c_str( ), planned.subresource, (unsigned long long)row );
+						return 1;
+					}
+				}
+			}
+			const double parse_ms = BestOf( 50, [ & ] ( ) { DXLayer::ReadTextureFile( mapping.Data( ), mapping.Size( ), view, error ); } );
+			mapping.Close( );
+
+			// the file is in the page cache for all of them, what's timed is getting it from there into the upload buffer
+			std::vector<uint8_t> heap;
+			const double heap_ms = BestOf( runs, [ & ] ( )
+			{
+				std::vector<uint8_t>( ).swap( heap );
+				DXLayer::TextureFileView heap_view;
+				LoadFileToHeap( texture.path, heap );
+				DXLayer::ReadTextureFile( heap.data( ), heap.size( ), heap_view, error );
+				std::vector<DXLayer::TextureFootprint> footprints( heap_view.subresource_count );
+				DXLayer::GetTextureFootprints( heap_view.layout, 0, heap_view.subresource_count, 0, footprints.data( ) );
+				for ( uint32_t s = 0; s < heap_view.subresource_count; ++s )
+				{
+					const DXLayer::SubresourceDestination destination = { &upload[size_t( footprints[s].offset )], footprints[s].row_pitch,
+						size_t( footprints[s].row_pitch ) * footprints[s].row_count };
+					DXLayer::CopySubresourceRows( destination, DXLayer::TextureFileSource( heap_view, s ), size_t( footprints[s].row_size ), footprints[s].row_count, footprints[s].depth );
+				}
+			} );
+			const auto load_mapped = [ & ] ( const DXLayer::SubresourceCopyOptions& options )
+			{
+				DXLayer::FileMapping file;
+				DXLayer::TextureFileView mapped_view;
+				file.Open( texture.path.c_str( ) );
+				DXLayer::ReadTextureFile( file.Data( ), file.Size( ), mapped_view, error );
+				planner.Reset( 0 );
+				DXLayer::AddTextureFile( planner, 0, mapped_view );
+				DXLayer::FillUploads( planner.Uploads( ), planner.Count( ), upload.data( ), options );
+			};
+			const double mapped_ms = BestOf( runs, [ & ] ( ) { load_mapped( one_thread ); } );
+			const double threads_ms = BestOf( runs, [ & ] ( ) { load_mapped( all_threads ); } );
+
+			const double gb = texture.texel_bytes / 1e9;
+			std::printf( "%-12s %5s %6u %5u %4u %9.1f   %9.1f %9.2f %9.2f %9.2f\n", cases[i].name, cases[i].container == DXLayer::texture_file_dds ? "dds" : "ktx2",
+				uint32_t( view.layout.width ), view.layout.dimension == DXLayer::texture_3d ? 1 : view.layout.depth_or_array_size, view.layout.mip_levels,
+				texture.texel_bytes / 1048576.0, parse_ms * 1e3, gb / heap_ms * 1e3, gb / mapped_ms * 1e3, gb / threads_ms * 1e3 );
+			total_bytes += texture.texel_bytes;
+			total_heap_ms += heap_ms;
+			total_mapped_ms += mapped_ms;
+			total_threads_ms += threads_ms;
+		}
+		std::printf( "all %zu files, %.1f MB: read to heap + copy %.1f ms, mapped into staging %.1f ms (%.2fx), on %u threads %.1f ms (%.2fx)\n", case_count,
+			total_bytes / 1048576.0, total_heap_ms, total_mapped_ms, total_heap_ms / total_mapped_ms, thread_count, total_threads_ms, total_heap_ms / total_threads_ms );
+
+		for ( const WrittenTexture& texture : written )
+			std::remove( texture.path.c_str( ) );
+		return 0;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+
+namespace AssetTool
+{
+	class Timer
+	{
+	public:
+		Timer( )
+			: start( std::chrono::steady_clock::now( ) )
+		{ }
+
+		double Milliseconds( ) const
+		{
+			return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start;
+	};
+}
@@ -0,0 +1,463 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "SubresourceCopy.h"
+#include "TextureFootprints.h"
+#include "Timer.h"
+#include "UploadBatch.h"
+
+// the device cross check, windows.h would take std::min and std::max away
+#ifdef _WIN32
+#define NOMINMAX
+#include <d3d12.h>
+#endif
+
+namespace AssetTool
+{
+	namespace
+	{
+		size_t AlignPitch( size_t row_size )
+		{
+			return ( row_size + DXLayer::texture_pitch_alignment - 1 ) & ~size_t( DXLayer::texture_pitch_alignment - 1 );
+		}
+
+		struct CopyCase
+		{
+			const char* name;
+			size_t row_size;
+			uint32_t row_count;
+			uint32_t slice_count;
+			size_t source_row_pitch;
+			size_t destination_row_pitch;
+		};
+
+		// best of runs, in ms
+		template <typename Copy>
+		double BestOf( int runs, Copy copy )
+		{
+			double best = 1e30;
+			for ( int run = 0; run < runs; ++run )
+			{
+				Timer timer;
+				copy( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+	}
+
+	int BenchSubresourceCommand( int argc, char** argv )
+	{
+		const uint32_t max_size = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 4096;
+		const uint32_t thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+
+		// rgba8 textures of a few sizes with tightly packed sources, as they come out of a loader. Widths of 64 texels
+		// and up are already a multiple of the pitch alignment, so their rows collapse. Odd widths and bc blocks keep
+		// the padding, a volume has slices on top
+		std::vector<CopyCase> cases;
+		for ( uint32_t size = 64; size <= max_size; size *= 4 )
+			cases.push_back( CopyCase{ "rgba8", size * 4u, size, 1, size * 4u, AlignPitch( size * 4u ) } );
+		for ( uint32_t size = 100; size <= max_size; size *= 4 )
+			cases.push_back( CopyCase{ "rgba8 odd", size * 4u, size, 1, size * 4u, AlignPitch( size * 4u ) } );
+		for ( uint32_t size = 60; size <= max_size; size *= 4 )
+			cases.push_back( CopyCase{ "bc1", ( size + 3 ) / 4 * 8u, ( size + 3 ) / 4, 1, ( size + 3 ) / 4 * 8u, AlignPitch( ( size + 3 ) / 4 * 8u ) } );
+		cases.push_back( CopyCase{ "rgba8 3d", 64 * 4, 64, 64, 64 * 4, 64 * 4 } );
+		cases.push_back( CopyCase{ "r8 3d odd", 48, 48, 48, 48, AlignPitch( 48 ) } );
+
+		std::printf( "%-10s %6s %6s %5s %8s   %8s %8s %8s %8s  (GB/s)\n", "case", "row", "rows", "slices", "MB", "rows", "collapse", "stream", "threads" );
+		std::mt19937 rng( 9 );
+		for ( const CopyCase& copy_case : cases )
+		{
+			const size_t source_slice_pitch = copy_case.source_row_pitch * copy_case.row_count;
+			const size_t destination_slice_pitch = copy_case.destination_row_pitch * copy_case.row_count;
+			std::vector<uint8_t> source( source_slice_pitch * copy_case.slice_count );
+			for ( auto& byte : source )
+				byte = uint8_t( rng( ) );
+
+			// the destination stays allocated and touched, like a persistently mapped upload heap. Padding is filled
+			// with a marker that has to survive
+			std::vector<uint8_t> destination( destination_slice_pitch * copy_case.slice_count + 64 );
+			std::vector<uint8_t> expected( destination.size( ), 0xcd );
+			const DXLayer::SubresourceSource source_layout = { source.data( ), copy_case.source_row_pitch, source_slice_pitch };
+			const DXLayer::SubresourceDestination expected_layout = { expected.data( ), copy_case.destination_row_pitch, destination_slice_pitch };
+			const DXLayer::SubresourceDestination destination_layout = { destination.data( ), copy_case.destination_row_pitch, destination_slice_pitch };
+			DXLayer::CopySubresourceRows( expected_layout, source_layout, copy_case.row_size, copy_case.row_count, copy_case.slice_count );
+
+			DXLayer::SubresourceCopyOptions cached;
+			cached.write_combined = false;
+			DXLayer::SubresourceCopyOptions streamed;
+			DXLayer::SubresourceCopyOptions threaded;
+			threaded.thread_count = thread_count;
+			threaded.min_bytes_per_thread = 1 << 20;
+			const DXLayer::SubresourceCopyOptions* variants[] = { &cached, &streamed, &threaded };
+			for ( const DXLayer::SubresourceCopyOptions* options : variants )
+			{
+				std::fill( destination.begin( ), destination.end( ), uint8_t( 0xcd ) );
+				DXLayer::CopySubresource( destination_layout, source_layout, copy_case.row_size, copy_case.row_count, copy_case.slice_count, *options );
+				if ( destination != expected )
+				{
+					std::fprintf( stderr, "%s %zu x %u x %u copies wrong\n", copy_case.name, copy_case.row_size, copy_case.row_count, copy_case.slice_count );
+					return 1;
+				}
+			}
+
+			// small copies are repeated so each timing is a few ms
+			const size_t bytes = copy_case.row_size * copy_case.row_count * copy_case.slice_count;
+			const int repeat = int( std::max<size_t>( 1, ( 8 << 20 ) / bytes ) );
+			const int runs = 7;
+			double ms[4];
+			ms[0] = BestOf( runs, [ & ] ( )
+			{
+				for ( int r = 0; r < repeat; ++r )
+					DXLayer::CopySubresourceRows( destination_layout, source_layout, copy_case.row_size, copy_case.row_count, copy_case.slice_count );
+			} );
+			for ( int v = 0; v < 3; ++v )
+			{
+				ms[v + 1] = BestOf( runs, [ & ] ( )
+				{
+					for ( int r = 0; r < repeat; ++r )
+						DXLayer::CopySubresource( destination_layout, source_layout, copy_case.row_size, copy_case.row_count, copy_case.slice_count, *variants[v] );
+				} );
+			}
+			std::printf( "%-10s %6zu %6u %5u %8.2f   %8.2f %8.2f %8.2f %8.2f\n", copy_case.name, copy_case.row_size, copy_case.row_count, copy_case.slice_count,
+				bytes / 1048576.0, bytes * repeat / ms[0] / 1e6, bytes * repeat / ms[1] / 1e6, bytes * repeat / ms[2] / 1e6, bytes * repeat / ms[3] / 1e6 );
+		}
+		std::printf( "rows: one memcpy per row as in d3dx12.h, collapse: contiguous rows and slices as one copy, stream: collapsed with streaming stores,\n"
+			"threads: streamed on up to %u threads. Host memory is cached, streaming stores only pay off this much against write-combined upload heaps\n", thread_count );
+		return 0;
+	}
+
+	namespace
+	{
+		using DXLayer::TextureFootprint;
+		using DXLayer::TextureLayoutDesc;
+
+		// DXGI_FORMAT values
+		const uint32_t format_r32g32b32a32_float = 2;
+		const uint32_t format_r8g8_typeless = 48;
+		const uint32_t format_r16_float = 54;
+		const uint32_t format_r8_typeless = 60;
+		const uint32_t format_r8_unorm = 61;
+		const uint32_t format_r8g8b8a8_unorm = 28;
+		const uint32_t format_bc1_unorm = 71;
+		const uint32_t format_bc7_unorm = 98;
+		const uint32_t format_nv12 = 103;
+
+		// footprints worked out by hand from the d3d12 placement rules
+		struct FootprintCase
+		{
+			const char* name;
+			TextureLayoutDesc desc;
+			uint32_t first_subresource;
+			uint32_t count;
+			uint64_t base_offset;
+			uint64_t total;
+			std::vector<TextureFootprint> footprints;	// offset, format, width, height, depth, row pitch, rows, row size
+		};
+
+		std::vector<FootprintCase> FootprintCases( )
+		{
+			const uint32_t rgba8 = format_r8g8b8a8_unorm;
+			return std::vector<FootprintCase>{
+				{ "rgba8 4x4, the last row isn't padded", { DXLayer::texture_2d, 4, 4, 1, 1, rgba8 }, 0, 1, 0, 784,
+					{ { 0, rgba8, 4, 4, 1, 256, 4, 16 } } },
+				{ "rgba8 4x4 at an offset", { DXLayer::texture_2d, 4, 4, 1, 1, rgba8 }, 0, 1, 1024, 784,
+					{ { 1024, rgba8, 4, 4, 1, 256, 4, 16 } } },
+				{ "rgba8 256x256 mip chain", { DXLayer::texture_2d, 256, 256, 1, 9, rgba8 }, 0, 9, 0, 359940,
+					{ { 0, rgba8, 256, 256, 1, 1024, 256, 1024 }, { 262144, rgba8, 128, 128, 1, 512, 128, 512 }, { 327680, rgba8, 64, 64, 1, 256, 64, 256 },
+					{ 344064, rgba8, 32, 32, 1, 256, 32, 128 }, { 352256, rgba8, 16, 16, 1, 256, 16, 64 }, { 356352, rgba8, 8, 8, 1, 256, 8, 32 },
+					{ 358400, rgba8, 4, 4, 1, 256, 4, 16 }, { 359424, rgba8, 2, 2, 1, 256, 2, 8 }, { 359936, rgba8, 1, 1, 1, 256, 1, 4 } } },
+				{ "rgba8 256x256 mips 1 and 2 alone", { DXLayer::texture_2d, 256, 256, 1, 9, rgba8 }, 1, 2, 0, 81920,
+					{ { 0, rgba8, 128, 128, 1, 512, 128, 512 }, { 65536, rgba8, 64, 64, 1, 256, 64, 256 } } },
+				{ "rgba8 8x2 full chain from 0 mips", { DXLayer::texture_2d, 8, 2, 1, 0, rgba8 }, 0, 4, 0, 1540,
+					{ { 0, rgba8, 8, 2, 1, 256, 2, 32 }, { 512, rgba8, 4, 1, 1, 256, 1, 16 }, { 1024, rgba8, 2, 1, 1, 256, 1, 8 }, { 1536, rgba8, 1, 1, 1, 256, 1, 4 } } },
+				{ "r8 300x2, pitch past 256", { DXLayer::texture_2d, 300, 2, 1, 1, format_r8_unorm }, 0, 1, 0, 812,
+					{ { 0, format_r8_unorm, 300, 2, 1, 512, 2, 300 } } },
+				{ "bc1 60x60 counts rows of blocks", { DXLayer::texture_2d, 60, 60, 1, 1, format_bc1_unorm }, 0, 1, 0, 3704,
+					{ { 0, format_bc1_unorm, 60, 60, 1, 256, 15, 120 } } },
+				{ "bc1 mips below a block are a whole block", { DXLayer::texture_2d, 4, 4, 1, 3, format_bc1_unorm }, 0, 3, 0, 1032,
+					{ { 0, format_bc1_unorm, 4, 4, 1, 256, 1, 8 }, { 512, format_bc1_unorm, 4, 4, 1, 256, 1, 8 }, { 1024, format_bc1_unorm, 4, 4, 1, 256, 1, 8 } } },
+				{ "bc7 130x66 rounds up to blocks", { DXLayer::texture_2d, 130, 66, 1, 1, format_bc7_unorm }, 0, 1, 0, 12816,
+					{ { 0, format_bc7_unorm, 132, 68, 1, 768, 17, 528 } } },
+				{ "rgba8 16x16 array of 3 with 2 mips", { DXLayer::texture_2d, 16, 16, 3, 2, rgba8 }, 0, 6, 0, 18208,
+					{ { 0, rgba8, 16, 16, 1, 256, 16, 64 }, { 4096, rgba8, 8, 8, 1, 256, 8, 32 }, { 6144, rgba8, 16, 16, 1, 256, 16, 64 },
+					{ 10240, rgba8, 8, 8, 1, 256, 8, 32 }, { 12288, rgba8, 16, 16, 1, 256, 16, 64 }, { 16384, rgba8, 8, 8, 1, 256, 8, 32 } } },
+				{ "r16f 10x6x5 volume, slices are rows * pitch apart", { DXLayer::texture_3d, 10, 6, 5, 2, format_r16_float }, 0, 2, 0, 8970,
+					{ { 0, format_r16_float, 10, 6, 5, 256, 6, 20 }, { 7680, format_r16_float, 5, 3, 2, 256, 3, 10 } } },
+				{ "rgba32f 1d array of 2", { DXLayer::texture_1d, 100, 1, 2, 1, format_r32g32b32a32_float }, 0, 2, 0, 3648,
+					{ { 0, format_r32g32b32a32_float, 100, 1, 1, 1792, 1, 1600 }, { 2048, format_r32g32b32a32_float, 100, 1, 1, 1792, 1, 1600 } } },
+				{ "nv12 64x32, a plane per subresource with 512 byte rows", { DXLayer::texture_2d, 64, 32, 1, 1, format_nv12 }, 0, 2, 0, 24128,
+					{ { 0, format_r8_typeless, 64, 32, 1, 512, 32, 64 }, { 16384, format_r8g8_typeless, 32, 16, 1, 512, 16, 64 } } },
+				{ "buffer", { DXLayer::texture_buffer, 1000, 1, 1, 1, 0 }, 0, 1, 0, 1000,
+					{ { 0, 0, 1000, 1, 1, 1024, 1, 1000 } } },
+				{ "subresources past the end", { DXLayer::texture_2d, 16, 16, 1, 2, rgba8 }, 1, 2, 0, DXLayer::invalid_footprint_size, { } },
+				{ "more mips than the chain has", { DXLayer::texture_2d, 16, 16, 1, 6, rgba8 }, 0, 1, 0, DXLayer::invalid_footprint_size, { } },
+				{ "unsupported format", { DXLayer::texture_2d, 16, 16, 1, 1, 45 }, 0, 1, 0, DXLayer::invalid_footprint_size, { } },
+			};
+		}
+
+		bool SameFootprint( const TextureFootprint& a, const TextureFootprint& b )
+		{
+			return a.offset == b.offset && a.format == b.format && a.width == b.width && a.height == b.height && a.depth == b.depth &&
+				a.row_pitch == b.row_pitch && a.row_count == b.row_count && a.row_size == b.row_size;
+		}
+
+		void PrintFootprint( const char* label, const TextureFootprint& footprint )
+		{
+			std::fprintf( stderr, "    %s offset %llu format %u %ux%ux%u pitch %u rows %u row size %llu\n", label, (unsigned long long)footprint.offset, footprint.format,
+				footprint.width, footprint.height, footprint.depth, footprint.row_pitch, footprint.row_count, (unsigned long long)footprint.row_size );
+		}
+
+#ifdef _WIN32
+		// every footprint of desc against what the device says. Descs the device rejects are skipped
+		bool MatchesDevice( ID3D12Device* device, const TextureLayoutDesc& desc, uint32_t& compared )
+		{
+			TextureLayoutDesc resolved;
+			uint32_t subresource_count;
+			if ( !DXLayer::ResolveTextureLayout( desc, resolved, subresource_count ) )
+				return true;
+
+			D3D12_RESOURCE_DESC resource_desc = { };
+			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION( desc.dimension );
+			resource_desc.Width = desc.width;
+			resource_desc.Height = desc.height;
+			resource_desc.DepthOrArraySize = UINT16( desc.depth_or_array_size );
+			resource_desc.MipLevels = UINT16( resolved.mip_levels );
+			resource_desc.Format = DXGI_FORMAT( resolved.format );
+			resource_desc.SampleDesc.Count = 1;
+			resource_desc.Layout = desc.dimension == DXLayer::texture_buffer ? D3D12_TEXTURE_LAYOUT_ROW_MAJOR : D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+			std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts( subresource_count );
+			std::vector<UINT> row_counts( subresource_count );
+			std::vector<UINT64> row_sizes( subresource_count );
+			UINT64 device_total = 0;
+			device->GetCopyableFootprints( &resource_desc, 0, subresource_count, 0, layouts.data( ), row_counts.data( ), row_sizes.data( ), &device_total );
+			if ( device_total == ~0ull )
+				return true;
+
+			std::vector<TextureFootprint> footprints( subresource_count );
+			const uint64_t total = DXLayer::GetTextureFootprints( desc, 0, subresource_count, 0, footprints.data( ) );
+			bool matches = total == device_total;
+			for ( uint32_t s = 0; s < subresource_count; ++s )
+			{
+				const TextureFootprint device_footprint = { layouts[s].Offset, uint32_t( layouts[s].Footprint.Format ), layouts[s].Footprint.Width, layouts[s].Footprint.Height,
+					layouts[s].Footprint.Depth, layouts[s].Footprint.RowPitch, row_counts[s], row_sizes[s] };
+				if ( !SameFootprint( footprints[s], device_footprint ) )
+				{
+					if ( matches )
+						std::fprintf( stderr, "  dimension %u %llux%ux%u, %u mips, format %u differs from the device:\n", desc.dimension, (unsigned long long)desc.width, desc.height,
+							desc.depth_or_array_size, resolved.mip_levels, resolved.format );
+					PrintFootprint( "device", device_footprint );
+					PrintFootprint( "ours  ", footprints[s] );
+					matches = false;
+				}
+			}
+			if ( total != device_total )
+				std::fprintf( stderr, "  total %llu, the device says %llu\n", (unsigned long long)total, (unsigned long long)device_total );
+			++compared;
+			return matches;
+		}
+
+		// the table and a sweep over every supported format, sizes around block and pitch boundaries, arrays and volumes
+		int CheckFootprintsAgainstDevice( const std::vector<FootprintCase>& cases )
+		{
+			ID3D12Device* device = nullptr;
+			if ( FAILED( D3D12CreateDevice( nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS( &device ) ) ) )
+			{
+				std::fprintf( stderr, "no d3d12 device\n" );
+				return 1;
+			}
+
+			uint32_t compared = 0, mismatches = 0;
+			for ( const FootprintCase& footprint_case : cases )
+				mismatches += !MatchesDevice( device, footprint_case.desc, compared );
+			const uint32_t sizes[] = { 1, 2, 3, 4, 5, 17, 64, 100, 257 };
+			for ( uint32_t format = 1; format <= 130; ++format )
+			{
+				DXLayer::TextureFormatInfo info;
+				if ( !DXLayer::GetTextureFormatInfo( format, info ) )
+					continue;
+				for ( uint32_t width : sizes )
+				{
+					for ( uint32_t height : sizes )
+					{
+						mismatches += !MatchesDevice( device, { DXLayer::texture_2d, width, height, 3, 0, format }, compared );
+						mismatches += !MatchesDevice( device, { DXLayer::texture_3d, width, height, 5, 0, format }, compared );
+					}
+					mismatches += !MatchesDevice( device, { DXLayer::texture_1d, width, 1, 2, 0, format }, compared );
+				}
+			}
+			for ( uint32_t width : sizes )
+				mismatches += !MatchesDevice( device, { DXLayer::texture_buffer, width * 1000u, 1, 1, 1, 0 }, compared );
+			device->Release( );
+
+			std::printf( "%u layouts compared with the device, %u differ\n", compared, mismatches );
+			return mismatches ? 1 : 0;
+		}
+#endif
+	}
+
+	int CheckFootprintsCommand( int argc, char** argv )
+	{
+		const std::vector<FootprintCase> cases = FootprintCases( );
+		int failed = 0;
+		for ( const FootprintCase& footprint_case : cases )
+		{
+			std::vector<TextureFootprint> footprints( footprint_case.count + 1 );
+			const uint64_t total = DXLayer::GetTextureFootprints( footprint_case.desc, footprint_case.first_subresource, footprint_case.count, footprint_case.base_offset,
+				footprints.data( ) );
+			bool matches = total == footprint_case.total;
+			for ( size_t s = 0; s < footprint_case.footprints.size( ) && total != DXLayer::invalid_footprint_size; ++s )
+			{
+				if ( !SameFootprint( footprints[s], footprint_case.footprints[s] ) )
+				{
+					std::fprintf( stderr, "%s, subresource %zu:\n", footprint_case.name, footprint_case.first_subresource + s );
+					PrintFootprint( "expected", footprint_case.footprints[s] );
+					PrintFootprint( "got     ", footprints[s] );
+					matches = false;
+				}
+			}
+
+			// the size alone has to agree with the full calculation
+			if ( DXLayer::GetTextureFootprints( footprint_case.desc, footprint_case.first_subresource, footprint_case.count, footprint_case.base_offset, nullptr ) != total )
+				matches = false;
+			if ( !matches )
+				std::fprintf( stderr, "%s: total %llu, expected %llu\n", footprint_case.name, (unsigned long long)total, (unsigned long long)footprint_case.total );
+			failed += !matches;
+		}
+		std::printf( "%zu footprint cases, %d failed\n", cases.size( ), failed );
+		if ( failed )
+			return 1;
+
+		// planning many uploads, the reason this exists
+		const uint32_t plan_count = 100000;
+		uint64_t planned = 0;
+		TextureFootprint footprints[12];
+		Timer timer;
+		for ( uint32_t i = 0; i < plan_count; ++i )
+		{
+			const TextureLayoutDesc desc = { DXLayer::texture_2d, 64u + ( i & 1023 ), 64u + ( ( i >> 3 ) & 511 ), 1, 0, i & 1 ? format_bc7_unorm : format_r8g8b8a8_unorm };
+			planned += DXLayer::GetTextureFootprints( desc, 0, 7, 0, footprints );
+		}
+		std::printf( "%.1f ns per 7 mip texture (%.1f GB planned)\n", timer.Milliseconds( ) * 1e6 / plan_count, planned / 1e9 );
+
+		if ( argc > 0 && std::strcmp( argv[0], "--device" ) == 0 )
+		{
+#ifdef _WIN32
+			return CheckFootprintsAgainstDevice( cases );
+#else
+			std::fprintf( stderr, "--device needs d3d12\n" );
+			return 1;
+#endif
+		}
+		return 0;
+	}
+
+	int BenchUploadBatchCommand( int argc, char** argv )
+	{
+		const uint32_t layer_count = argc > 0 ? uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) : 2048;
+		const uint32_t thread_count = std::max( 1u, std::thread::hardware_concurrency( ) );
+
+		// a texture array with mip chains, every layer its own tightly packed source like a loader hands them over
+		const TextureLayoutDesc desc = { DXLayer::texture_2d, 128, 128, layer_count, 0, format_r8g8b8a8_unorm };
+		TextureLayoutDesc resolved;
+		uint32_t subresource_count;
+		if ( layer_count == 0 || !DXLayer::ResolveTextureLayout( desc, resolved, subresource_count ) )
+		{
+			std::fprintf( stderr, "%u layers don't make a texture array\n", layer_count );
+			return 1;
+		}
+		const uint32_t mip_count = resolved.mip_levels;
+
+		std::vector<DXLayer::SubresourceSource> sources( subresource_count );
+		size_t layer_size = 0;
+		for ( uint32_t mip = 0; mip < mip_count; ++mip )
+			layer_size += size_t( 4 ) * ( 128 >> mip ) * ( 128 >> mip );
+		std::vector<uint8_t> source_data( layer_size * layer_count );
+		std::mt19937 rng( 11 );
+		for ( size_t i = 0; i < source_data.size( ); i += 4 )
+		{
+			const uint32_t value = rng( );
+			std::memcpy( &source_data[i], &value, 4 );
+		}
+		size_t source_offset = 0;
+		for ( uint32_t layer = 0; layer < layer_count; ++layer )
+		{
+			for ( uint32_t mip = 0; mip < mip_count; ++mip )
+			{
+				const size_t row_pitch = size_t( 4 ) * ( 128 >> mip );
+				sources[layer * mip_count + mip] = { &source_data[source_offset], row_pitch, row_pitch * ( 128 >> mip ) };
+				source_offset += row_pitch * ( 128 >> mip );
+			}
+		}
+
+		// the storage is reused run after run, planning allocates nothing
+		std::vector<DXLayer::PlannedUpload> storage( subresource_count );
+		DXLayer::UploadPlanner planner( storage.data( ), subresource_count, 0 );
+		const int runs = 5;
+		const double plan_ms = BestOf( runs, [ & ] ( )
+		{
+			planner.Reset( 0 );
+			planner.Add( 0, desc, 0, subresource_count, sources.data( ) );
+		} );
+		std::vector<uint8_t> upload( planner.End( ) );
+		std::printf( "%u layers of 128x128 rgba8 with %u mips: %u subresources, %.1f MB of sources, %.1f MB upload buffer\n", layer_count, mip_count, subresource_count,
+			source_data.size( ) / 1048576.0, upload.size( ) / 1048576.0 );
+
+		// what the heap allocating UpdateSubresources does once per layer, minus the device calls for the footprints
+		// and the map and unmap, which only a gpu can time
+		const double per_call_ms = BestOf( runs, [ & ] ( )
+		{
+			uint64_t offset = 0;
+			for ( uint32_t layer = 0; layer < layer_count; ++layer )
+			{
+				std::vector<TextureFootprint> layouts( mip_count );
+				offset = ( offset + DXLayer::texture_placement_alignment - 1 ) & ~uint64_t( DXLayer::texture_placement_alignment - 1 );
+				offset += DXLayer::GetTextureFootprints( desc, layer * mip_count, mip_count, offset, layouts.data( ) );
+				for ( uint32_t mip = 0; mip < mip_count; ++mip )
+				{
+					const DXLayer::SubresourceDestination destination = { &upload[size_t( layouts[mip].offset )], layouts[mip].row_pitch,
+						size_t( layouts[mip].row_pitch ) * layouts[mip].row_count };
+					DXLayer::CopySubresourceRows( destination, sources[layer * mip_count + mip], size_t( layouts[mip].row_size ), layouts[mip].row_count, layouts[mip].depth );
+				}
+			}
+		} );
+
+		DXLayer::SubresourceCopyOptions one_thread;
+		DXLayer::SubresourceCopyOptions all_threads;
+		all_threads.thread_count = thread_count;
+		std::fill( upload.begin( ), upload.end( ), uint8_t( 0 ) );
+		const double fill_ms = BestOf( runs, [ & ] ( ) { DXLayer::FillUploads( planner.Uploads( ), planner.Count( ), upload.data( ), one_thread ); } );
+		const double parallel_fill_ms = BestOf( runs, [ & ] ( ) { DXLayer::FillUploads( planner.Uploads( ), planner.Count( ), upload.data( ), all_threads ); } );
+
+		// every row has to be where its footprint says
+		for ( uint32_t i = 0; i < planner.Count( ); ++i )
+		{
+			const DXLayer::PlannedUpload& planned = planner.Uploads( )[i];
+			for ( uint32_t row = 0; row < planned.footprint.row_count; ++row )
+			{
+				if ( std::memcmp( &upload[size_t( planned.footprint.offset ) + size_t( row ) * planned.footprint.row_pitch],
+					static_cast<const uint8_t*>( planned.source.data ) + row * planned.source.row_pitch, size_t( planned.footprint.row_size ) ) != 0 )
+				{
+					std::fprintf( stderr, "subresource %u row %u isn't where its footprint says\n", planned.subresource, row );
+					return 1;
+				}
+			}
+		}
+
+		const double mb = source_data.size( ) / 1048576.0;
+		std::printf( "  one call per layer  %7.2f ms\n", per_call_ms );
+		std::printf( "  batched: plan       %7.2f ms, %.0f ns per subresource\n", plan_ms, plan_ms * 1e6 / subresource_count );
+		std::printf( "           fill       %7.2f ms %7.1f MB/s on one thread, %.2f ms %7.1f MB/s on %u\n", fill_ms, mb / fill_ms * 1e3, parallel_fill_ms,
+			mb / parallel_fill_ms * 1e3, thread_count );
+		std::printf( "           total      %7.2f ms, the copies are recorded from the same plan\n", plan_ms + parallel_fill_ms );
+		return 0;
+	}
+}
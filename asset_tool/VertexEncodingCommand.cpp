@@ -0,0 +1,278 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Timer.h"
+#include "VertexEncoding.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		// an authored vertex, the encoders read its members at the vertex stride
+		struct FloatVertex
+		{
+			float position[3];
+			float normal[3];
+			float color[4];
+		};
+
+		// what the compact vertex formats hold for one
+		struct EncodedVertex
+		{
+			int16_t position[4];
+			uint16_t half_position[4];
+			int16_t normal[2];
+			uint8_t color[4];
+		};
+
+		// random positions in an off-center box, normals of random length in every direction, colors partly outside [0, 1]
+		std::vector<FloatVertex> RandomVertices( uint32_t count, uint32_t seed )
+		{
+			std::mt19937 rng( seed );
+			std::uniform_real_distribution<float> x( -50.0f, 150.0f ), y( 10.0f, 12.0f ), z( -1000.0f, 1000.0f ), color( -0.1f, 1.1f );
+			std::normal_distribution<float> direction;
+			std::uniform_real_distribution<float> length( 0.01f, 100.0f );
+			std::vector<FloatVertex> vertices( count );
+			for ( auto& vertex : vertices )
+			{
+				vertex.position[0] = x( rng );
+				vertex.position[1] = y( rng );
+				vertex.position[2] = z( rng );
+				for ( int c = 0; c < 3; ++c )
+					vertex.normal[c] = direction( rng );
+				const float scale = length( rng );
+				for ( int c = 0; c < 3; ++c )
+					vertex.normal[c] *= scale;
+				for ( int c = 0; c < 4; ++c )
+					vertex.color[c] = color( rng );
+			}
+			return vertices;
+		}
+
+		// the whole array in one call, sse2 where there is a wide path
+		void EncodeAll( const std::vector<FloatVertex>& vertices, const DXLayer::MeshBounds& bounds, std::vector<EncodedVertex>& encoded )
+		{
+			encoded.resize( vertices.size( ) );
+			const size_t count = vertices.size( );
+			DXLayer::EncodePositionsSnorm16( vertices[0].position, sizeof( FloatVertex ), count, bounds, encoded[0].position, sizeof( EncodedVertex ) );
+			DXLayer::EncodePositionsHalf( vertices[0].position, sizeof( FloatVertex ), count, bounds, encoded[0].half_position, sizeof( EncodedVertex ) );
+			DXLayer::EncodeNormalsOct16( vertices[0].normal, sizeof( FloatVertex ), count, encoded[0].normal, sizeof( EncodedVertex ) );
+			DXLayer::EncodeColorsUnorm8( vertices[0].color, sizeof( FloatVertex ), count, encoded[0].color, sizeof( EncodedVertex ) );
+		}
+
+		// a vertex at a time through the scalar paths: a single position at a 12 byte stride has nothing after it to
+		// read past, a single normal never fills the 4 of the sse2 loop
+		void EncodeOneByOne( const std::vector<FloatVertex>& vertices, const DXLayer::MeshBounds& bounds, std::vector<EncodedVertex>& encoded )
+		{
+			encoded.resize( vertices.size( ) );
+			for ( size_t i = 0; i < vertices.size( ); ++i )
+			{
+				const float position[3] = { vertices[i].position[0], vertices[i].position[1], vertices[i].position[2] };
+				DXLayer::EncodePositionsSnorm16( position, 3 * sizeof( float ), 1, bounds, encoded[i].position, sizeof( EncodedVertex ) );
+				DXLayer::EncodeNormalsOct16( vertices[i].normal, sizeof( FloatVertex ), 1, encoded[i].normal, sizeof( EncodedVertex ) );
+			}
+		}
+
+		float Length( const float* v )
+		{
+			return std::sqrt( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+		}
+
+		// angle between a normal and its round trip, in radians
+		double AngleError( const float* normal, const int16_t* encoded )
+		{
+			float decoded[3];
+			DXLayer::DecodeNormalOct16( encoded, decoded );
+			const double length = Length( normal );
+			const double dot = ( double( decoded[0] ) * normal[0] + double( decoded[1] ) * normal[1] + double( decoded[2] ) * normal[2] ) / length;
+			return std::acos( std::min( std::max( dot, -1.0 ), 1.0 ) );
+		}
+
+		template <typename Run>
+		double BestOf( int runs, Run run )
+		{
+			double best = 1e30;
+			for ( int r = 0; r < runs; ++r )
+			{
+				Timer timer;
+				run( );
+				best = std::min( best, timer.Milliseconds( ) );
+			}
+			return best;
+		}
+	}
+
+	int CheckVertexEncodingCommand( int, char** )
+	{
+		Check check;
+
+		// not a multiple of 4, so the scalar tail runs after the sse2 loops
+		const std::vector<FloatVertex> vertices = RandomVertices( 100003, 31 );
+		const DXLayer::MeshBounds bounds = DXLayer::ComputeMeshBounds( vertices[0].position, sizeof( FloatVertex ), vertices.size( ) );
+		std::vector<EncodedVertex> encoded, one_by_one;
+		EncodeAll( vertices, bounds, encoded );
+		EncodeOneByOne( vertices, bounds, one_by_one );
+
+		// the wide and the scalar paths agree to the bit
+		int position_mismatches = 0, normal_mismatches = 0;
+		for ( size_t i = 0; i < vertices.size( ); ++i )
+		{
+			position_mismatches += std::memcmp( encoded[i].position, one_by_one[i].position, sizeof( encoded[i].position ) ) != 0;
+			normal_mismatches += std::memcmp( encoded[i].normal, one_by_one[i].normal, sizeof( encoded[i].normal ) ) != 0;
+		}
+		check( position_mismatches == 0, "snorm16 positions, sse2 and scalar", position_mismatches, 0 );
+		check( normal_mismatches == 0, "oct16 normals, sse2 and scalar", normal_mismatches, 0 );
+
+		// snorm16: within half a step of the 32767 each side of the center, plus float error of the decode.
+		// half: within half an ulp of the half float of the bounds relative position, 2^-11 of it or 2^-25 for denormals.
+		// oct16: the best of the 4 neighbours in the snorm grid, as told apart by a float dot, which can't see under about
+		// 3.5e-4 rad, found to stay under 6e-4 rad, checked against 1e-3.
+		// unorm8: within half a step after clamping to [0, 1]
+		double snorm_steps = 0.0, half_error = 0.0, normal_error = 0.0, color_steps = 0.0;
+		int w_wrong = 0, color_rounding_wrong = 0;
+		for ( size_t i = 0; i < vertices.size( ); ++i )
+		{
+			const FloatVertex& vertex = vertices[i];
+			float position[3];
+			DXLayer::DecodePositionSnorm16( encoded[i].position, bounds, position );
+			for ( int c = 0; c < 3; ++c )
+			{
+				snorm_steps = std::max( snorm_steps, std::fabs( double( position[c] ) - vertex.position[c] ) / ( bounds.extent[c] / 32767.0 ) );
+				const float relative = ( vertex.position[c] - bounds.center[c] ) / bounds.extent[c];
+				const double error = std::fabs( double( DXLayer::HalfToFloat( encoded[i].half_position[c] ) ) - relative );
+				half_error = std::max( half_error, error / std::max( std::fabs( relative ) * std::ldexp( 1.0, -11 ), std::ldexp( 1.0, -25 ) ) );
+			}
+			w_wrong += encoded[i].position[3] != 32767 || encoded[i].half_position[3] != 0x3c00;
+
+			normal_error = std::max( normal_error, AngleError( vertex.normal, encoded[i].normal ) );
+
+			float color[4];
+			DXLayer::DecodeColorUnorm8( encoded[i].color, color );
+			for ( int c = 0; c < 4; ++c )
+			{
+				const float clamped = std::min( std::max( vertex.color[c], 0.0f ), 1.0f );
+				color_steps = std::max( color_steps, std::fabs( double( color[c] ) - clamped ) * 255.0 );
+				color_rounding_wrong += encoded[i].color[c] != uint8_t( std::nearbyint( clamped * 255.0f ) );
+			}
+		}
+		std::printf( "largest errors: snorm16 %.4f steps, half %.4f of its bound, oct16 %.3g rad, unorm8 %.4f steps\n", snorm_steps, half_error,
+			normal_error, color_steps );
+		check( snorm_steps <= 0.51, "snorm16 position error", (long long)( snorm_steps * 1000 ), 510 );
+		check( half_error <= 1.0, "half position error", (long long)( half_error * 1000 ), 1000 );
+		check( normal_error <= 1e-3, "oct16 normal error", (long long)( normal_error * 1e6 ), 1000 );
+		check( color_steps <= 0.5001, "unorm8 color error", (long long)( color_steps * 1000 ), 500 );
+		check( w_wrong == 0, "w is 1", w_wrong, 0 );
+		check( color_rounding_wrong == 0, "unorm8 rounds to nearest even", color_rounding_wrong, 0 );
+
+		// ties go to even on both paths: a bounds extent of 32767 makes a position its own snorm value
+		{
+			const DXLayer::MeshBounds unit_steps = { { 0.0f, 0.0f, 0.0f }, { 32767.0f, 32767.0f, 32767.0f } };
+			const float ties[8][4] = {
+				{ 0.5f, 1.5f, 2.5f, 0.0f }, { -0.5f, -1.5f, -2.5f, 0.0f }, { 32766.5f, -32766.5f, 3.5f, 0.0f }, { 1e6f, -1e6f, 0.0f, 0.0f },
+				{ 0.5f, 1.5f, 2.5f, 0.0f }, { -0.5f, -1.5f, -2.5f, 0.0f }, { 32766.5f, -32766.5f, 3.5f, 0.0f }, { 1e6f, -1e6f, 0.0f, 0.0f } };
+			const int16_t expected[4][3] = { { 0, 2, 2 }, { 0, -2, -2 }, { 32766, -32766, 4 }, { 32767, -32767, 0 } };
+			int16_t wide[8][4], scalar[8][4];
+			DXLayer::EncodePositionsSnorm16( ties[0], sizeof( ties[0] ), 8, unit_steps, wide[0], sizeof( wide[0] ) );
+			for ( int i = 0; i < 8; ++i )
+				DXLayer::EncodePositionsSnorm16( ties[i], 3 * sizeof( float ), 1, unit_steps, scalar[i], sizeof( scalar[i] ) );
+			int wrong = 0;
+			for ( int i = 0; i < 8; ++i )
+				for ( int c = 0; c < 3; ++c )
+					wrong += wide[i][c] != expected[i % 4][c] || scalar[i][c] != expected[i % 4][c];
+			check( wrong == 0, "snorm16 ties to even, clamping", wrong, 0 );
+
+			// 0.5 * 255 is the one exact tie of unorm8
+			const float colors[4] = { 0.5f, 0.0f, 1.0f, -1.0f };
+			uint8_t color[4];
+			DXLayer::EncodeColorsUnorm8( colors, sizeof( colors ), 1, color, sizeof( color ) );
+			check( color[0] == 128 && color[1] == 0 && color[2] == 255 && color[3] == 0, "unorm8 tie and clamping", color[0], 128 );
+		}
+
+		// every 8 bit value and every finite half survives a round trip
+		{
+			int unorm_wrong = 0;
+			for ( int value = 0; value < 256; ++value )
+			{
+				const float color[4] = { value / 255.0f, value / 255.0f, value / 255.0f, value / 255.0f };
+				uint8_t color_encoded[4];
+				DXLayer::EncodeColorsUnorm8( color, sizeof( color ), 1, color_encoded, sizeof( color_encoded ) );
+				unorm_wrong += color_encoded[0] != value;
+			}
+			check( unorm_wrong == 0, "unorm8 round trip", unorm_wrong, 0 );
+
+			int half_wrong = 0;
+			for ( uint32_t half = 0; half < 0x10000; ++half )
+				if ( ( half & 0x7c00 ) != 0x7c00 )
+					half_wrong += DXLayer::FloatToHalf( DXLayer::HalfToFloat( uint16_t( half ) ) ) != half;
+			check( half_wrong == 0, "half round trip", half_wrong, 0 );
+		}
+
+		// axes come back exactly, a zero normal is 0, 0 on both paths
+		{
+			const float axes[8][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, 0, 0 }, { 0, 0, 0 } };
+			int16_t wide[8][2], scalar[8][2];
+			DXLayer::EncodeNormalsOct16( axes[0], sizeof( axes[0] ), 8, wide[0], sizeof( wide[0] ) );
+			int wrong = 0;
+			for ( int i = 0; i < 8; ++i )
+			{
+				DXLayer::EncodeNormalsOct16( axes[i], sizeof( axes[i] ), 1, scalar[i], sizeof( scalar[i] ) );
+				wrong += wide[i][0] != scalar[i][0] || wide[i][1] != scalar[i][1];
+				if ( i < 6 )
+				{
+					float decoded[3];
+					DXLayer::DecodeNormalOct16( wide[i], decoded );
+					wrong += decoded[0] != axes[i][0] || decoded[1] != axes[i][1] || decoded[2] != axes[i][2];
+				}
+				else
+					wrong += wide[i][0] != 0 || wide[i][1] != 0;
+			}
+			check( wrong == 0, "oct16 axes and zero normals", wrong, 0 );
+		}
+
+		return check.Report( "vertex encoding" );
+	}
+
+	int BenchVertexEncodingCommand( int argc, char** argv )
+	{
+		const uint32_t count = argc > 0 ? std::max( 4u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) ) : 1 << 20;
+		const std::vector<FloatVertex> vertices = RandomVertices( count, 1 );
+		const DXLayer::MeshBounds bounds = DXLayer::ComputeMeshBounds( vertices[0].position, sizeof( FloatVertex ), count );
+		std::vector<EncodedVertex> encoded( count );
+		const size_t in = sizeof( FloatVertex ), out = sizeof( EncodedVertex );
+
+		const double snorm_ms = BestOf( 5, [ & ] ( ) { DXLayer::EncodePositionsSnorm16( vertices[0].position, in, count, bounds, encoded[0].position, out ); } );
+		const double half_ms = BestOf( 5, [ & ] ( ) { DXLayer::EncodePositionsHalf( vertices[0].position, in, count, bounds, encoded[0].half_position, out ); } );
+		const double oct_ms = BestOf( 5, [ & ] ( ) { DXLayer::EncodeNormalsOct16( vertices[0].normal, in, count, encoded[0].normal, out ); } );
+		const double color_ms = BestOf( 5, [ & ] ( ) { DXLayer::EncodeColorsUnorm8( vertices[0].color, in, count, encoded[0].color, out ); } );
+
+		// the scalar paths, one vertex a call
+		const double snorm_scalar_ms = BestOf( 5, [ & ] ( )
+		{
+			for ( uint32_t i = 0; i < count; ++i )
+				DXLayer::EncodePositionsSnorm16( vertices[i].position, 3 * sizeof( float ), 1, bounds, encoded[i].position, out );
+		} );
+		const double oct_scalar_ms = BestOf( 5, [ & ] ( )
+		{
+			for ( uint32_t i = 0; i < count; ++i )
+				DXLayer::EncodeNormalsOct16( vertices[i].normal, in, 1, encoded[i].normal, out );
+		} );
+
+		const auto rate = [ count ] ( double ms ) { return count / ms / 1e3; };
+		std::printf( "%u vertices, M vertices/s\n\n", count );
+		std::printf( "%-16s %10s %10s\n", "", "sse2", "scalar" );
+		std::printf( "%-16s %10.1f %10.1f\n", "snorm16 position", rate( snorm_ms ), rate( snorm_scalar_ms ) );
+		std::printf( "%-16s %10s %10.1f\n", "half position", "-", rate( half_ms ) );
+		std::printf( "%-16s %10.1f %10.1f\n", "oct16 normal", rate( oct_ms ), rate( oct_scalar_ms ) );
+		std::printf( "%-16s %10.1f %10s\n", "unorm8 color", rate( color_ms ), "-" );
+		std::printf( "\nthe scalar column encodes a vertex per call, which is what takes the scalar path on an sse2 build\n" );
+		return 0;
+	}
+}
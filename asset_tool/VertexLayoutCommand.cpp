@@ -0,0 +1,119 @@
+#include "Commands.h"
+
+#include <cstring>
+
+#include "Check.h"
+#include "VertexFormats.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		using namespace DXLayer;
+
+		// the vertex the renderer started with, its layout used to be written out by hand as offsets 0 and 12
+		struct FloatVertex
+		{
+			DirectX::XMFLOAT3 pos;
+			DirectX::XMFLOAT4 color;
+		};
+
+		typedef VertexLayout<FloatVertex,
+			DXL_VERTEX_ATTRIBUTE( FloatVertex, pos, POSITION, 0 ),
+			DXL_VERTEX_ATTRIBUTE( FloatVertex, color, COLOR, 0 )> FloatVertexLayout;
+
+		// CompactVertex again under another name, it has to share its psos
+		struct SameAsCompactVertex
+		{
+			int16_t position[4];
+			uint8_t tint[4];
+		};
+
+		typedef VertexLayout<SameAsCompactVertex,
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, position, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, tint, COLOR, 0, vertex_format_r8g8b8a8_unorm )> SameAsCompactVertexLayout;
+
+		// CompactVertex with one thing changed each
+		typedef VertexLayout<SameAsCompactVertex,
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, position, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, tint, COLOR, 0, vertex_format_r8g8b8a8_snorm )> OtherFormatLayout;
+		typedef VertexLayout<SameAsCompactVertex,
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, position, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, tint, COLOR, 1, vertex_format_r8g8b8a8_unorm )> OtherSemanticIndexLayout;
+		typedef VertexLayout<SameAsCompactVertex,
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, position, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+			DXL_VERTEX_ATTRIBUTE_FORMAT( SameAsCompactVertex, tint, TEXCOORD, 0, vertex_format_r8g8b8a8_unorm )> OtherSemanticLayout;
+
+		struct ColorFirstVertex
+		{
+			uint8_t tint[4];
+			int16_t position[4];
+		};
+
+		typedef VertexLayout<ColorFirstVertex,
+			DXL_VERTEX_ATTRIBUTE_FORMAT( ColorFirstVertex, tint, COLOR, 0, vertex_format_r8g8b8a8_unorm ),
+			DXL_VERTEX_ATTRIBUTE_FORMAT( ColorFirstVertex, position, POSITION, 0, vertex_format_r16g16b16a16_snorm )> OtherOrderLayout;
+
+		// the hashes are constants, psos are looked up with them as they are. A format that doesn't match its
+		// member, overlapping or padded members don't compile at all, see VertexAttribute and VertexLayout
+		static_assert( SameAsCompactVertexLayout::Hash( ) == CompactVertexInputLayout::Hash( ), "equal layouts hash apart" );
+		static_assert( OtherFormatLayout::Hash( ) != CompactVertexInputLayout::Hash( ), "format not hashed" );
+		static_assert( OtherSemanticIndexLayout::Hash( ) != CompactVertexInputLayout::Hash( ), "semantic index not hashed" );
+		static_assert( OtherSemanticLayout::Hash( ) != CompactVertexInputLayout::Hash( ), "semantic not hashed" );
+		static_assert( OtherOrderLayout::Hash( ) != CompactVertexInputLayout::Hash( ), "attribute order not hashed" );
+		static_assert( FloatVertexLayout::stride == 28 && CompactVertexInputLayout::stride == 12 && CompactVertexNormalInputLayout::stride == 16, "strides" );
+
+		struct ExpectedElement
+		{
+			const char* semantic;
+			uint32_t semantic_index;
+			uint32_t format;
+			uint32_t offset;
+		};
+
+		template<typename Layout>
+		void CheckElements( Check& check, const char* name, const ExpectedElement* expected, uint32_t count )
+		{
+			check( Layout::num_elements == count, name, Layout::num_elements, count );
+			if ( Layout::num_elements != count )
+				return;
+			const VertexElement* elements = Layout::VertexElements( );
+			for ( uint32_t i = 0; i < count; ++i )
+			{
+				check( std::strcmp( elements[i].semantic, expected[i].semantic ) == 0 && elements[i].semantic_index == expected[i].semantic_index,
+					name, i, i );
+				check( elements[i].format == expected[i].format, name, elements[i].format, expected[i].format );
+				check( elements[i].offset == expected[i].offset, name, elements[i].offset, expected[i].offset );
+			}
+		}
+	}
+
+	int CheckVertexLayoutsCommand( int, char** )
+	{
+		Check check;
+
+		// the elements the input assembler gets, DXGI_FORMAT values written out
+		const ExpectedElement float_vertex[] = { { "POSITION", 0, 6, 0 }, { "COLOR", 0, 2, 12 } };
+		const ExpectedElement compact_vertex[] = { { "POSITION", 0, 13, 0 }, { "COLOR", 0, 28, 8 } };
+		const ExpectedElement compact_vertex_normal[] = { { "POSITION", 0, 13, 0 }, { "NORMAL", 0, 37, 8 }, { "COLOR", 0, 28, 12 } };
+		CheckElements<FloatVertexLayout>( check, "float vertex", float_vertex, 2 );
+		CheckElements<CompactVertexInputLayout>( check, "compact vertex", compact_vertex, 2 );
+		CheckElements<CompactVertexNormalInputLayout>( check, "compact vertex with normal", compact_vertex_normal, 3 );
+
+		// what the format size check compares members against
+		const struct
+		{
+			uint32_t format;
+			uint32_t size;
+		} sizes[] = {
+			{ 0, 0 }, { vertex_format_r32g32b32a32_float, 16 }, { vertex_format_r32g32b32_uint, 12 }, { vertex_format_r16g16b16a16_snorm, 8 },
+			{ vertex_format_r32g32_float, 8 }, { vertex_format_r10g10b10a2_unorm, 4 }, { vertex_format_r8g8b8a8_unorm, 4 },
+			{ vertex_format_r16g16_snorm, 4 }, { vertex_format_r32_uint, 4 }, { vertex_format_r8g8_unorm, 2 }, { vertex_format_r16_uint, 2 },
+			{ 61, 1 }, { vertex_format_b8g8r8a8_unorm, 4 }, { 70, 0 }, { 98, 0 }
+		};
+		for ( const auto& size : sizes )
+			check( VertexFormatSize( size.format ) == size.size, "format size", VertexFormatSize( size.format ), size.size );
+
+		return check.Report( "vertex layout" );
+	}
+}
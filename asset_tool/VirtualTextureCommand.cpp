@@ -0,0 +1,275 @@
+#include "Commands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Timer.h"
+#include "VirtualTexture.h"
+
+namespace AssetTool
+{
+	namespace
+	{
+		const uint32_t texture_size = 16384;
+		const uint32_t texture_format = 98;			// BC7
+		const uint32_t feedback_width = 160;		// a 1280x720 view, feedback written at an eighth of it
+		const uint32_t feedback_height = 90;
+		const uint32_t screen_width = 1280;
+		const uint32_t map_budget = 32;				// 2 MB of tile copies a frame
+
+		// what the gpu would have after UpdateTileMappings and the copies: every page's pool tile, every tile's data
+		struct SimulatedGpu
+		{
+			const DXLayer::VirtualTextureLayout& layout;
+			std::vector<uint32_t> first_page;
+			std::vector<uint32_t> mappings;
+			std::vector<uint32_t> tile_data;		// the page whose data was copied into each pool tile
+
+			SimulatedGpu( const DXLayer::VirtualTextureLayout& texture_layout, uint32_t pool_tile_count )
+				: layout( texture_layout ), tile_data( pool_tile_count, DXLayer::invalid_virtual_page )
+			{
+				uint32_t page_count = 0;
+				for ( uint32_t mip = 0; mip < layout.mip_count; ++mip )
+				{
+					first_page.push_back( page_count );
+					page_count += layout.width_in_tiles[mip] * layout.height_in_tiles[mip];
+				}
+				mappings.assign( page_count, DXLayer::VirtualTexture::invalid_pool_tile );
+			}
+
+			uint32_t& Mapping( uint32_t mip, uint32_t x, uint32_t y )
+			{
+				return mappings[first_page[mip] + y * layout.width_in_tiles[mip] + x];
+			}
+
+			// region by region, each run's tiles row after row
+			void UpdateTileMappings( const std::vector<DXLayer::VirtualTileRun>& runs )
+			{
+				for ( const DXLayer::VirtualTileRun& run : runs )
+				{
+					uint32_t x = run.x, y = run.y;
+					for ( uint32_t t = 0; t < run.tile_count; ++t )
+					{
+						Mapping( run.mip, x, y ) = run.pool_tile == DXLayer::VirtualTexture::invalid_pool_tile ? run.pool_tile : run.pool_tile + t;
+						if ( ++x == layout.width_in_tiles[run.mip] )
+						{
+							x = 0;
+							++y;
+						}
+					}
+				}
+			}
+
+			void CopyTiles( const std::vector<DXLayer::VirtualTileUpdate>& updates )
+			{
+				for ( const DXLayer::VirtualTileUpdate& update : updates )
+				{
+					if ( update.pool_tile != DXLayer::VirtualTexture::invalid_pool_tile )
+						tile_data[update.pool_tile] = update.page;
+				}
+			}
+
+			// the page table agrees with the mappings, mapped pages read their own data, no tile backs two pages,
+			// the mips above a resident page are resident and the min mip map points at resident pages only
+			bool Verify( const DXLayer::VirtualTexture& texture, std::vector<uint8_t>& min_mips ) const
+			{
+				std::vector<uint8_t> tile_used( tile_data.size( ) );
+				for ( uint32_t mip = 0; mip < layout.mip_count; ++mip )
+				{
+					for ( uint32_t y = 0; y < layout.height_in_tiles[mip]; ++y )
+					{
+						for ( uint32_t x = 0; x < layout.width_in_tiles[mip]; ++x )
+						{
+							const uint32_t page = DXLayer::VirtualPageKey( mip, x, y );
+							const uint32_t tile = mappings[first_page[mip] + y * layout.width_in_tiles[mip] + x];
+							if ( texture.PoolTile( page ) != tile )
+								return false;
+							if ( tile == DXLayer::VirtualTexture::invalid_pool_tile )
+								continue;
+							if ( tile_data[tile] != page || tile_used[tile]++ || tile < layout.packed_tile_count )
+								return false;
+							if ( mip + 1 < layout.mip_count && texture.PoolTile( DXLayer::VirtualPageKey( mip + 1, std::min( x / 2, layout.width_in_tiles[mip + 1] - 1 ),
+								std::min( y / 2, layout.height_in_tiles[mip + 1] - 1 ) ) ) == DXLayer::VirtualTexture::invalid_pool_tile )
+								return false;
+						}
+					}
+				}
+
+				min_mips.resize( layout.width_in_tiles[0] * layout.height_in_tiles[0] );
+				texture.MinMipMap( min_mips.data( ) );
+				for ( uint32_t y = 0; y < layout.height_in_tiles[0]; ++y )
+				{
+					for ( uint32_t x = 0; x < layout.width_in_tiles[0]; ++x )
+					{
+						const uint32_t mip = min_mips[y * layout.width_in_tiles[0] + x];
+						if ( mip > layout.mip_count || ( mip < layout.mip_count &&
+							texture.PoolTile( DXLayer::VirtualPageKey( mip, std::min( x >> mip, layout.width_in_tiles[mip] - 1 ), std::min( y >> mip, layout.height_in_tiles[mip] - 1 ) ) ) ==
+							DXLayer::VirtualTexture::invalid_pool_tile ) )
+							return false;
+					}
+				}
+				return true;
+			}
+		};
+
+		struct Camera
+		{
+			float x;
+			float y;
+			float heading;
+			float height;
+		};
+
+		// a view over a ground plane textured with the virtual texture, repeating: per feedback pixel the page
+		// at the mip its screen pixel's footprint picks. The top of the view is sky and asks for nothing
+		void WriteFeedback( const Camera& camera, const DXLayer::VirtualTextureLayout& layout, std::vector<uint32_t>& feedback )
+		{
+			const float pi = 3.14159265f;
+			const float vertical_fov = 50.0f * pi / 180.0f;
+			const float horizon = 0.35f;		// of the view height, from the top
+			const float max_distance = 40000.0f;
+			const float forward_x = std::cos( camera.heading ), forward_y = std::sin( camera.heading );
+			feedback.assign( feedback_width * feedback_height, DXLayer::invalid_virtual_page );
+			for ( uint32_t row = 0; row < feedback_height; ++row )
+			{
+				const float below_horizon = ( ( row + 0.5f ) / feedback_height - horizon ) * vertical_fov;
+				if ( below_horizon <= 0.0f )
+					continue;
+				const float distance = std::min( camera.height / std::tan( below_horizon ), max_distance );
+				const float footprint = distance * 2.0f / screen_width;		// texels per screen pixel, 90 degrees across
+				const uint32_t mip = std::min( uint32_t( std::log2( std::max( footprint, 1.0f ) ) ), layout.mip_count );
+				if ( mip == layout.mip_count )
+					continue;		// packed, always there
+				for ( uint32_t column = 0; column < feedback_width; ++column )
+				{
+					const float across = ( ( column + 0.5f ) / feedback_width * 2.0f - 1.0f ) * distance;
+					const float u = camera.x + forward_x * distance - forward_y * across;
+					const float v = camera.y + forward_y * distance + forward_x * across;
+					const uint32_t texel_x = uint32_t( int64_t( std::floor( u ) ) & ( texture_size - 1 ) ) >> mip;
+					const uint32_t texel_y = uint32_t( int64_t( std::floor( v ) ) & ( texture_size - 1 ) ) >> mip;
+					feedback[row * feedback_width + column] = DXLayer::VirtualPageKey( mip, std::min( texel_x / layout.tile_width, layout.width_in_tiles[mip] - 1 ),
+						std::min( texel_y / layout.tile_height, layout.height_in_tiles[mip] - 1 ) );
+				}
+			}
+		}
+
+		struct PhaseStats
+		{
+			double requested = 0.0;
+			double hits = 0.0;
+			double mapped = 0.0;
+			double evicted = 0.0;
+			double updates = 0.0;
+			double runs = 0.0;
+			double exact = 0.0;			// feedback samples whose page was resident after the update
+			double samples = 0.0;
+			double ms = 0.0;
+			uint32_t resident = 0;
+		};
+	}
+
+	int BenchVirtualTextureCommand( int argc, char** argv )
+	{
+		const uint32_t frames_per_phase = argc > 0 ? std::max( 1u, uint32_t( std::strtoul( argv[0], nullptr, 10 ) ) / 4 ) : 300;
+		const uint32_t pool_tile_count = argc > 1 ? uint32_t( std::strtoul( argv[1], nullptr, 10 ) ) : 256;
+
+		DXLayer::VirtualTextureLayout layout;
+		DXLayer::VirtualTexture texture;
+		if ( !DXLayer::StandardVirtualTextureLayout( texture_format, texture_size, texture_size, 0, layout ) || !texture.Init( layout, pool_tile_count ) )
+		{
+			std::fprintf( stderr, "a pool of %u tiles doesn't hold the packed mips\n", pool_tile_count );
+			return 1;
+		}
+		uint64_t full_tiles = layout.packed_tile_count;
+		for ( uint32_t mip = 0; mip < layout.mip_count; ++mip )
+			full_tiles += layout.width_in_tiles[mip] * layout.height_in_tiles[mip];
+		std::printf( "%ux%u BC7 virtual texture, %u standard mips of %ux%u texel tiles, %u packed mips in %u tiles: %.0f MB resident would be all of it\n",
+			texture_size, texture_size, layout.mip_count, layout.tile_width, layout.tile_height, layout.packed_mip_count, layout.packed_tile_count, full_tiles * 65536.0 / ( 1 << 20 ) );
+		std::printf( "pool of %u tiles (%.0f MB), %ux%u feedback, %u pages mapped a frame at most\n\n", pool_tile_count, pool_tile_count * 65536.0 / ( 1 << 20 ),
+			feedback_width, feedback_height, map_budget );
+
+		SimulatedGpu gpu( layout, pool_tile_count );
+		std::vector<uint32_t> feedback;
+		std::vector<DXLayer::VirtualTileUpdate> updates;
+		std::vector<DXLayer::VirtualTileRun> runs;
+		std::vector<uint8_t> min_mips;
+		std::mt19937 rng( 5 );
+		Camera camera = { 3000.0f, 3000.0f, 0.0f, 120.0f };
+
+		const char* const phase_names[] = { "walk", "turn", "teleport", "fly up" };
+		std::printf( "%-9s %9s %7s %7s %7s %8s %8s %8s %9s %10s\n", "", "requested", "hits", "mapped", "evicted", "updates", "regions", "exact", "resident", "update us" );
+		for ( uint32_t phase = 0; phase < 4; ++phase )
+		{
+			PhaseStats stats;
+			for ( uint32_t frame = 0; frame < frames_per_phase; ++frame )
+			{
+				// walking and turning move a little every frame, teleports jump somewhere new now and then, flying up
+				// sees more of the texture at coarser mips
+				if ( phase == 0 )
+				{
+					camera.heading += 0.004f * std::sin( frame * 0.01f );
+					camera.x += 6.0f * std::cos( camera.heading );
+					camera.y += 6.0f * std::sin( camera.heading );
+				}
+				else if ( phase == 1 )
+				{
+					camera.heading += 0.03f;
+				}
+				else if ( phase == 2 && frame % 60 == 0 )
+				{
+					camera.x = float( rng( ) % texture_size );
+					camera.y = float( rng( ) % texture_size );
+					camera.heading = float( rng( ) % 628 ) / 100.0f;
+				}
+				else if ( phase == 3 )
+				{
+					camera.height *= 1.01f;
+					camera.x += 4.0f;
+				}
+
+				WriteFeedback( camera, layout, feedback );
+				Timer timer;
+				texture.AddFeedback( feedback.data( ), feedback.size( ) );
+				texture.Update( map_budget, updates );
+				DXLayer::BuildTileRuns( layout, updates, runs );
+				stats.ms += timer.Milliseconds( );
+
+				gpu.UpdateTileMappings( runs );
+				gpu.CopyTiles( updates );
+				if ( !gpu.Verify( texture, min_mips ) )
+				{
+					std::fprintf( stderr, "%s, frame %u: the page table, the mappings or the min mip map went wrong\n", phase_names[phase], frame );
+					return 1;
+				}
+
+				const DXLayer::VirtualTextureStats& frame_stats = texture.Stats( );
+				stats.requested += frame_stats.requested;
+				stats.hits += frame_stats.hits;
+				stats.mapped += frame_stats.mapped;
+				stats.evicted += frame_stats.evicted;
+				stats.updates += updates.size( );
+				stats.runs += runs.size( );
+				stats.resident = frame_stats.resident;
+				for ( uint32_t page : feedback )
+				{
+					if ( page == DXLayer::invalid_virtual_page )
+						continue;
+					stats.exact += texture.PoolTile( page ) != DXLayer::VirtualTexture::invalid_pool_tile;
+					++stats.samples;
+				}
+			}
+
+			const double frames = frames_per_phase;
+			std::printf( "%-9s %9.0f %6.1f%% %7.1f %7.1f %8.1f %8.1f %7.1f%% %5.1f MB %10.1f\n", phase_names[phase], stats.requested / frames, 100.0 * stats.hits / std::max( 1.0, stats.requested ),
+				stats.mapped / frames, stats.evicted / frames, stats.updates / frames, stats.runs / frames, 100.0 * stats.exact / std::max( 1.0, stats.samples ),
+				( stats.resident + layout.packed_tile_count ) * 65536.0 / ( 1 << 20 ), stats.ms * 1e3 / frames );
+		}
+		std::printf( "\nrequested pages include the mips above them, hits were resident before the update, updates are pages mapped or unmapped,\n"
+			"regions what UpdateTileMappings gets after merging, exact the feedback samples at the mip they asked for\n" );
+		return 0;
+	}
+}
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Commands.h"
+
+// offline asset pipeline, runs without a gpu or windows
+
+namespace
+{
+	const AssetTool::Command commands[] = {
+		{ "optimize", "optimize <in.obj> <out.obj>\n\treorders triangles and vertices for the vertex cache, overdraw and vertex fetch", AssetTool::OptimizeCommand },
+		{ "bench-optimize", "bench-optimize [triangles]\n\truns the mesh optimizer on generated meshes, 1M triangles by default", AssetTool::BenchOptimizeCommand },
+		{ "bench-meshlets", "bench-meshlets [triangles]\n\tbuilds meshlets for a generated mesh, reports build speed, cluster quality and culling rates", AssetTool::BenchMeshletsCommand },
+		{ "simplify", "simplify <in.obj> <out.obj> [ratio] [error]\n\tsimplifies to ratio of the triangles (0.5) unless that needs more than error of the mesh extent (0.01)", AssetTool::SimplifyCommand },
+		{ "bench-simplify", "bench-simplify [triangles]\n\tbuilds lod chains for generated meshes, reports speed, error against the exact surface and lod selection stability", AssetTool::BenchSimplifyCommand },
+		{ "convert", "convert <in.obj> <out.mesh> [--normals] [--compress]\n\tcompiles an obj into a mesh asset: optimized, with lods, meshlets and compact vertices (CompactVertexNormal with --normals).\n\t--compress stores vertices and indices with the MeshCodec encoders", AssetTool::ConvertCommand },
+		{ "bench-mesh-load", "bench-mesh-load [triangles]\n\tcompares loading a generated mesh from obj text against mapping its mesh asset", AssetTool::BenchMeshLoadCommand },
+		{ "bench-codec", "bench-codec [triangles]\n\tvertex and index buffer compression ratio and encode/decode speed on a generated mesh", AssetTool::BenchCodecCommand },
+		{ "bench-streaming", "bench-streaming [files] [triangles]\n\tloads generated mesh assets through the asset streamer: queue throughput against loading them one by one, and how soon late high priority requests arrive", AssetTool::BenchStreamingCommand },
+		{ "bench-pool", "bench-pool [vertices]\n\tchurns a simulated geometry pool with streamed meshes, then defragments and compacts it, checking every mesh's data", AssetTool::BenchPoolCommand },
+		{ "pack", "pack <out.pack> <file>...\n\tpacks files into one archive under their relative paths, in lz compressed 64 KB blocks. The renderer streams from assets.pack before loose files", AssetTool::PackCommand },
+		{ "bench-pack", "bench-pack [files]\n\tpacks generated files, reports build speed, path lookups against opening loose files and decompression speed on one and all threads", AssetTool::BenchPackCommand },
+		{ "bench-subresource", "bench-subresource [size]\n\tcopies textures of generated sizes and pitches into upload heap layouts: row by row against collapsed rows, streaming stores and threads, up to size texels wide (4096)", AssetTool::BenchSubresourceCommand },
+		{ "check-footprints", "check-footprints [--device]\n\tchecks the texture footprint calculator against a table of known layouts and times it. --device compares it with GetCopyableFootprints over every format it covers, windows only", AssetTool::CheckFootprintsCommand },
+		{ "bench-upload-batch", "bench-upload-batch [layers]\n\tplans and fills the upload of a texture array with mip chains in one batch, against one UpdateSubresources style call per layer (2048 layers)", AssetTool::BenchUploadBatchCommand },
+		{ "bench-texture-load", "bench-texture-load [size]\n\twrites generated dds and ktx2 textures, 2d, arrays, cube maps and volumes up to size texels wide (2048), and loads them into a staging buffer: read into the heap and copied against mapped and copied straight into place", AssetTool::BenchTextureLoadCommand },
+		{ "compress-texture", "compress-texture <in.ppm|in.pam> <out.dds> [bc1|bc3|bc4|bc5|bc7] [fast|normal|high] [--srgb] [--mips]\n\tblock compresses an 8 bit netpbm image into a dds the renderer loads, bc7 at normal quality by default. --mips adds the full chain, kaiser filtered", AssetTool::CompressTextureCommand },
+		{ "bench-bc", "bench-bc [size]\n\tblock compresses generated images in every format and quality: megapixels per second on one and all threads, and PSNR (512x512)", AssetTool::BenchBcCommand },
+		{ "check-mips", "check-mips\n\tchecks generated mip levels against values worked out by hand: box and srgb averages, sizes that aren't a power of two, the kaiser filter, edges, array slices and alpha coverage", AssetTool::CheckMipsCommand },
+		{ "bench-mips", "bench-mips [size]\n\tgenerates the mip chain of a size x size sprite (2048) with every filter, srgb and alpha coverage, on one and all threads", AssetTool::BenchMipsCommand },
+		{ "bench-virtual-texture", "bench-virtual-texture [frames] [pool tiles]\n\tdrives the page table of a 16384x16384 virtual texture with the feedback of a simulated camera walking, turning, teleporting and flying up (1200 frames, 256 tiles): hit rates, mapping updates and the tile mappings, checked every frame", AssetTool::BenchVirtualTextureCommand },
+		{ "bench-atlas", "bench-atlas [images]\n\tpacks a mix of icons, sprites, decals and glyphs (2000) with the skyline and max rects packers, with and without padding, then keeps a 2048x2048 atlas busy with images coming and going: fill, pack and repack times, checked against a simulated atlas", AssetTool::BenchAtlasCommand },
+		{ "check-readback", "check-readback [frames]\n\tchecks the readback ring against a simulated gpu and fence (20000 frames): slots stay untouched until their callbacks, which come in order once their fence completed, and a full ring refuses instead of waiting", AssetTool::CheckReadbackCommand },
+		{ "bench-dynamic-geometry", "bench-dynamic-geometry [particles]\n\tallocates from the frame upload allocator on one thread, shared, through a cursor and behind a mutex, then writes the quads of particles (1M) straight into upload memory on one and all threads against staging and copying them, checking every vertex", AssetTool::BenchDynamicGeometryCommand },
+		{ "check-root-signatures", "check-root-signatures\n\tchecks root signature hashing, that equal descriptions share one cache entry while any change gets its own, and the blob cache file: blobs survive a save and a load, truncated or corrupt files are thrown away", AssetTool::CheckRootSignaturesCommand },
+		{ "check-vertex-layouts", "check-vertex-layouts\n\tchecks the input layouts generated from vertex structs against the elements written out by hand, the sizes of vertex formats, and that layout hashes, the pso keys, are equal for equal layouts and differ for any change", AssetTool::CheckVertexLayoutsCommand },
+		{ "check-cbuffer-layouts", "check-cbuffer-layouts\n\tcompares the offsets and sizes of cbuffer layouts with what fxc reports for the same hlsl: vectors around register boundaries, arrays, matrices and the shaders' own cbuffers, and checks the writer leaves padding alone", AssetTool::CheckCBufferLayoutsCommand },
+		{ "check-per-draw", "check-per-draw\n\tchecks that per draw data up to the 16 DWORD budget goes into root constants and anything bigger into a root cbv, with the root parameter, its cost and the payload as recorded", AssetTool::CheckPerDrawCommand },
+		{ "bench-per-draw", "bench-per-draw [draws] [--device]\n\tsets the per draw data of draws (100000) draws as root constants and as a root cbv on a recording stand-in for the command list, --device also on a warp command list", AssetTool::BenchPerDrawCommand },
+		{ "check-shader-watcher", "check-shader-watcher\n\tdrives the shader watcher over files in memory: a diamond include, includes gained and lost by an edit, compile errors and shaders that don't link keeping their old code", AssetTool::CheckShaderWatcherCommand },
+		{ "check-vertex-encoding", "check-vertex-encoding\n\tround trips random vertices through the compact formats against error bounds, checks the sse2 and scalar encoders give the same bits and round ties to even", AssetTool::CheckVertexEncodingCommand },
+		{ "bench-vertex-encoding", "bench-vertex-encoding [vertices]\n\tencodes a million vertices, or the given count, in one call against one vertex a call through the scalar paths", AssetTool::BenchVertexEncodingCommand },
+		{ "check-index-packing", "check-index-packing\n\tpacks meshes just under and over 65536 vertices and large random ones, checks chunk boundaries and the vertices fetched through each chunk's BaseVertexLocation, prints the bytes 16-bit indices save", AssetTool::CheckIndexPackingCommand },
+	};
+
+	void PrintUsage( )
+	{
+		std::printf( "usage: asset_tool <command> [arguments]\n\n" );
+		for ( const auto& command : commands )
+			std::printf( "  %s\n\n", command.usage );
+	}
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		PrintUsage( );
+		return 1;
+	}
+
+	for ( const auto& command : commands )
+		if ( std::strcmp( argv[1], command.name ) == 0 )
+			return command.run( argc - 2, argv + 2 );
+
+	std::fprintf( stderr, "unknown command %s\n\n", argv[1] );
+	PrintUsage( );
+	return 1;
+}
@@ -0,0 +1,332 @@
+#include "AssetStreamer.h"
+
+#include "SubresourceCopy.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// faults the whole mapping in on the io thread, so decoding runs from memory instead of waiting on the disk
+		uint32_t TouchPages( const uint8_t* data, size_t size )
+		{
+			const size_t page_size = 4096;
+			uint32_t sum = 0;
+			for ( size_t offset = 0; offset < size; offset += page_size )
+				sum += data[offset];
+			return sum + data[size - 1];
+		}
+
+		// the packed indices of a chunk are relative to its base vertex, these are too. indices is decoded cpu
+		// memory, the re-split reads it back, and gets the 16-bit indices in its place
+		bool NarrowIndices( StreamedMesh& mesh, std::vector<uint8_t>& indices )
+		{
+			const uint32_t* wide = reinterpret_cast<const uint32_t*>( indices.data( ) );
+			std::vector<uint32_t> absolute( wide, wide + mesh.info.index_count );
+			for ( const IndexChunk& chunk : mesh.chunks )
+				for ( uint32_t i = chunk.first_index; i < chunk.first_index + chunk.index_count; ++i )
+					absolute[i] += chunk.base_vertex;
+
+			// every split is worth it here, the alternative is not drawing the mesh at all
+			IndexPackingOptions options;
+			options.min_triangles_per_chunk = 0;
+			PackedIndices packed;
+			PackIndices( absolute.data( ), absolute.size( ), packed, options );
+			if ( packed.index_size != 2 )
+				return false;
+
+			indices.swap( packed.data );
+			mesh.chunks.swap( packed.chunks );
+			return true;
+		}
+
+		// into upload memory, which is only written
+		void WidenIndices( const std::vector<uint8_t>& indices, uint32_t index_count, uint8_t* destination )
+		{
+			const uint16_t* narrow = reinterpret_cast<const uint16_t*>( indices.data( ) );
+			uint32_t* wide = reinterpret_cast<uint32_t*>( destination );
+			for ( uint32_t i = 0; i < index_count; ++i )
+				wide[i] = narrow[i];
+		}
+	}
+
+	AssetStreamer::AssetStreamer( )
+		: pack_threads( 1 ), next_request( 0 ), stop_requested( false )
+	{ }
+
+	AssetStreamer::~AssetStreamer( )
+	{
+		Stop( );
+	}
+
+	void AssetStreamer::MountPack( const PackFile* pack )
+	{
+		packs.push_back( pack );
+	}
+
+	bool AssetStreamer::Contains( const std::string& path ) const
+	{
+		for ( const PackFile* pack : packs )
+			if ( pack->Find( path.c_str( ) ) != PackFile::invalid_entry )
+				return true;
+		return FileMapping::Exists( path.c_str( ) );
+	}
+
+	void AssetStreamer::Start( uint32_t io_threads, uint32_t decode_threads )
+	{
+		if ( !threads.empty( ) )
+			return;
+
+		stop_requested = false;
+		pack_threads = decode_threads > 1 ? decode_threads : 1;
+		for ( uint32_t t = 0; t < io_threads; ++t )
+			threads.emplace_back( [this] ( ) { Worker( state_read_queued ); } );
+		for ( uint32_t t = 0; t < decode_threads; ++t )
+			threads.emplace_back( [this] ( ) { Worker( state_decode_queued ); } );
+	}
+
+	void AssetStreamer::Stop( )
+	{
+		if ( threads.empty( ) )
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			stop_requested = true;
+		}
+		read_condition.notify_all( );
+		decode_condition.notify_all( );
+		for ( auto& thread : threads )
+			thread.join( );
+		threads.clear( );
+	}
+
+	uint32_t AssetStreamer::Request( const std::string& path, DecodeFn decode, float priority )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		const uint32_t request = next_request++;
+		Job& job = jobs[request];
+		job.path = path;
+		job.decode = decode;
+		job.priority = priority;
+		job.state = state_read_queued;
+		job.cancelled = false;
+
+		QueueEntry entry = { priority, request };
+		read_queue.insert( entry );
+		read_condition.notify_one( );
+		return request;
+	}
+
+	void AssetStreamer::SetPriority( uint32_t request, float priority )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = jobs.find( request );
+		if ( it == jobs.end( ) || it->second.cancelled )
+			return;
+
+		Job& job = it->second;
+		Queue* queue = QueueOf( job.state );
+		if ( queue )
+		{
+			QueueEntry entry = { job.priority, request };
+			queue->erase( entry );
+			entry.priority = priority;
+			queue->insert( entry );
+		}
+		job.priority = priority;
+	}
+
+	void AssetStreamer::Cancel( uint32_t request )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = jobs.find( request );
+		if ( it == jobs.end( ) )
+			return;
+
+		Job& job = it->second;
+		Queue* queue = QueueOf( job.state );
+		if ( !queue )
+		{
+			job.cancelled = true;
+			return;
+		}
+		QueueEntry entry = { job.priority, request };
+		queue->erase( entry );
+		jobs.erase( it );
+	}
+
+	void AssetStreamer::TakeCompleted( size_t budget_bytes, std::vector<StreamResult>& results )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		size_t taken_bytes = 0;
+		bool first = true;
+		while ( !done_queue.empty( ) )
+		{
+			auto it = jobs.find( done_queue.begin( )->request );
+			Job& job = it->second;
+			const size_t bytes = job.asset ? job.asset->upload_bytes : 0;
+			if ( !first && taken_bytes + bytes > budget_bytes )
+				break;
+
+			StreamResult result;
+			result.request = it->first;
+			result.priority = job.priority;
+			result.asset = std::move( job.asset );
+			result.error = std::move( job.error );
+			results.push_back( std::move( result ) );
+
+			done_queue.erase( done_queue.begin( ) );
+			jobs.erase( it );
+			taken_bytes += bytes;
+			first = false;
+		}
+	}
+
+	size_t AssetStreamer::PendingCount( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		return jobs.size( );
+	}
+
+	// one loop for both kinds of threads, a job leaves the read stage into the decode queue and the decode stage
+	// into the finished list. A job whose file couldn't be read skips decoding
+	void AssetStreamer::Worker( State queued_state )
+	{
+		Queue& queue = *QueueOf( queued_state );
+		std::condition_variable& condition = queued_state == state_read_queued ? read_condition : decode_condition;
+
+		std::unique_lock<std::mutex> lock( mutex );
+		for ( ;; )
+		{
+			condition.wait( lock, [this, &queue] ( ) { return stop_requested || !queue.empty( ); } );
+			if ( stop_requested )
+				return;
+
+			const uint32_t request = queue.begin( )->request;
+			queue.erase( queue.begin( ) );
+			Job& job = jobs.find( request )->second; // map nodes stay put while other jobs come and go
+			job.state = State( queued_state + 1 );
+
+			lock.unlock( );
+			if ( queued_state == state_read_queued )
+				Read( job );
+			else
+				Decode( job );
+			lock.lock( );
+
+			if ( job.cancelled )
+			{
+				jobs.erase( request );
+				continue;
+			}
+
+			job.state = queued_state == state_read_queued && job.error.empty( ) ? state_decode_queued : state_done;
+			QueueEntry entry = { job.priority, request };
+			QueueOf( job.state )->insert( entry );
+			if ( job.state == state_decode_queued )
+				decode_condition.notify_one( );
+		}
+	}
+
+	AssetStreamer::Queue* AssetStreamer::QueueOf( State state )
+	{
+		switch ( state )
+		{
+		case state_read_queued: return &read_queue;
+		case state_decode_queued: return &decode_queue;
+		case state_done: return &done_queue;
+		default: return nullptr;
+		}
+	}
+
+	void AssetStreamer::Read( Job& job ) const
+	{
+		for ( const PackFile* pack : packs )
+		{
+			const uint32_t entry = pack->Find( job.path.c_str( ) );
+			if ( entry == PackFile::invalid_entry )
+				continue;
+
+			job.unpacked.resize( size_t( pack->EntrySize( entry ) ) );
+			if ( !pack->ReadEntry( entry, job.unpacked.data( ), pack_threads ) )
+				job.error = "corrupt pack entry " + job.path;
+			return;
+		}
+
+		job.file.reset( new FileMapping );
+		if ( !job.file->Open( job.path.c_str( ) ) )
+		{
+			job.file.reset( );
+			job.error = "can't open " + job.path;
+			return;
+		}
+
+		volatile uint32_t sum = TouchPages( job.file->Data( ), job.file->Size( ) );
+		( void )sum;
+	}
+
+	void AssetStreamer::Decode( Job& job )
+	{
+		if ( job.file )
+			job.asset = job.decode( job.file->Data( ), job.file->Size( ), job.error );
+		else
+			job.asset = job.decode( job.unpacked.data( ), job.unpacked.size( ), job.error );
+		job.file.reset( );
+		std::vector<uint8_t>( ).swap( job.unpacked );
+		if ( !job.asset && job.error.empty( ) )
+			job.error = "can't decode " + job.path;
+	}
+
+	std::unique_ptr<StreamedAsset> DecodeStreamedMesh( const uint8_t* data, size_t size, UploadArena& arena, uint32_t index_size, std::string& error )
+	{
+		MeshAssetView view;
+		if ( !ReadMeshAsset( data, size, view, error ) )
+			return nullptr;
+
+		std::unique_ptr<StreamedMesh> mesh( new StreamedMesh );
+		mesh->info = *view.info;
+		mesh->chunks.assign( view.chunks, view.chunks + view.chunk_count );
+		mesh->lods.assign( view.lods, view.lods + view.lod_count );
+
+		// indices of another size are converted on the way, that needs them in cpu memory first. The upload space
+		// is only taken once their final size is known
+		std::vector<uint8_t> converted;
+		if ( view.info->index_size != index_size )
+		{
+			converted.resize( size_t( view.info->index_count ) * view.info->index_size );
+			if ( !CopyMeshAssetIndices( view, converted.data( ) ) )
+			{
+				error = "corrupt index data";
+				return nullptr;
+			}
+			if ( view.info->index_size > index_size && !NarrowIndices( *mesh, converted ) )
+			{
+				error = "a triangle spans more than 64K vertices, the mesh needs 32-bit indices";
+				return nullptr;
+			}
+		}
+
+		const uint64_t vertex_bytes = uint64_t( view.info->vertex_count ) * MeshVertexStride( view.info->vertex_format );
+		mesh->index_offset = ( vertex_bytes + UploadArena::alignment - 1 ) & ~( UploadArena::alignment - 1 );
+		mesh->info.index_size = index_size;
+		if ( !mesh->upload.Allocate( arena, mesh->index_offset + uint64_t( mesh->info.index_count ) * index_size ) )
+		{
+			error = "the mesh doesn't fit into upload memory";
+			return nullptr;
+		}
+
+		uint8_t* upload = mesh->upload.Data( );
+		if ( !CopyMeshAssetVertices( view, upload ) || ( converted.empty( ) && !CopyMeshAssetIndices( view, upload + mesh->index_offset ) ) )
+		{
+			error = "corrupt vertex or index data";
+			return nullptr;
+		}
+		if ( view.info->index_size > index_size )
+			CopyToWriteCombined( upload + mesh->index_offset, converted.data( ), converted.size( ) );
+		else if ( view.info->index_size < index_size )
+			WidenIndices( converted, mesh->info.index_count, upload + mesh->index_offset );
+
+		mesh->upload_bytes = size_t( mesh->upload.Size( ) );
+		return mesh;
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileMapping.h"
+#include "IndexPacking.h"
+#include "MeshAsset.h"
+#include "PackFile.h"
+#include "UploadArena.h"
+
+// loads asset files in the background. A request goes through two stages with their own threads: io threads
+// map the file and touch every page so it's resident, decode threads turn the bytes into what the renderer
+// uploads. Both stages and the finished list are served in priority order, and a request's priority can change
+// while it waits, so something that just became visible overtakes the backlog at every stage, not only the first.
+// The render thread takes finished assets at a frame boundary within a byte budget, streaming never stalls a
+// frame. Paths are looked up in the mounted pack files first, loose files are the fallback.
+// No d3d in here, the renderer does the uploads
+
+namespace DXLayer
+{
+	// what a decoder made of a file, derived from per asset type. upload_bytes is what the render thread
+	// budgets its uploads by
+	struct StreamedAsset
+	{
+		StreamedAsset( )
+			: upload_bytes( 0 )
+		{ }
+		virtual ~StreamedAsset( ) { }
+
+		size_t upload_bytes;
+	};
+
+	struct StreamResult
+	{
+		uint32_t request;
+		float priority;
+		std::unique_ptr<StreamedAsset> asset;	// null when loading failed
+		std::string error;
+	};
+
+	// bigger loads sooner. Anything visible outranks everything that isn't, within each group the larger
+	// it appears the sooner it loads. distance as from LodDistance
+	inline float StreamingPriority( float distance, float radius, bool visible )
+	{
+		const float size = radius / ( distance > radius ? distance : radius ); // 1 up close, towards 0 far away
+		return visible ? 1.0f + size : size;
+	}
+
+	class AssetStreamer
+	{
+	public:
+		// runs on a decode thread, data is valid for the duration of the call. Returns null and sets error on failure
+		typedef std::function<std::unique_ptr<StreamedAsset>( const uint8_t* data, size_t size, std::string& error )> DecodeFn;
+
+		static const uint32_t invalid_request = ~0u;
+
+		AssetStreamer( );
+		~AssetStreamer( );
+
+		// before Start. A pack entry is decompressed on the io thread, big ones with help from as many threads as
+		// there are decode threads. Packs mounted first win when several have the same path
+		void MountPack( const PackFile* pack );
+
+		// in a mounted pack or as a loose file. Loose files are only looked up, not opened, so it's cheap on the render thread
+		bool Contains( const std::string& path ) const;
+
+		void Start( uint32_t io_threads, uint32_t decode_threads );
+
+		// waits for the jobs in flight, queued requests stay queued for the next Start
+		void Stop( );
+
+		uint32_t Request( const std::string& path, DecodeFn decode, float priority );
+
+		// a queued request moves in its queue. One that's being read or decoded right now keeps going
+		void SetPriority( uint32_t request, float priority );
+
+		// drops the request at whatever stage it is, a finished result that wasn't taken yet is thrown away
+		void Cancel( uint32_t request );
+
+		// render thread, at a frame boundary. Appends finished requests, highest priority first, until budget_bytes
+		// of upload_bytes are taken. The first one is taken even if it's over budget, so big assets still arrive
+		void TakeCompleted( size_t budget_bytes, std::vector<StreamResult>& results );
+
+		// requests that haven't been taken yet, finished or not
+		size_t PendingCount( );
+
+	private:
+		enum State
+		{
+			state_read_queued,
+			state_reading,
+			state_decode_queued,
+			state_decoding,
+			state_done
+		};
+
+		struct Job
+		{
+			std::string path;
+			DecodeFn decode;
+			float priority;
+			State state;
+			bool cancelled;		// in flight when it was cancelled, the worker drops it when it's done
+			std::unique_ptr<FileMapping> file;	// loose files are mapped
+			std::vector<uint8_t> unpacked;		// pack entries are decompressed
+			std::unique_ptr<StreamedAsset> asset;
+			std::string error;
+		};
+
+		// highest priority first, requests of the same priority in the order they came in
+		struct QueueEntry
+		{
+			float priority;
+			uint32_t request;
+
+			bool operator<( const QueueEntry& other ) const
+			{
+				return priority != other.priority ? priority > other.priority : request < other.request;
+			}
+		};
+
+		typedef std::set<QueueEntry> Queue;
+
+		void Worker( State queued_state );
+		Queue* QueueOf( State state );
+		void Read( Job& job ) const;
+		static void Decode( Job& job );
+
+		std::vector<const PackFile*> packs;				// only changes before Start
+		uint32_t pack_threads;
+
+		std::mutex mutex;								// guards everything below. Workers only touch a job's data, asset
+		std::map<uint32_t, Job> jobs;					// and error while it's theirs, with the lock released
+		Queue read_queue;
+		Queue decode_queue;
+		Queue done_queue;
+		uint32_t next_request;
+
+		std::vector<std::thread> threads;
+		std::condition_variable read_condition;
+		std::condition_variable decode_condition;
+		bool stop_requested;
+	};
+
+	// mesh assets
+
+	// a mesh asset decoded straight into upload memory, vertices at the start of upload and indices at index_offset
+	// from there. The render thread records copies out of it, the file is closed by then
+	struct StreamedMesh : StreamedAsset
+	{
+		MeshAssetInfo info;
+		UploadArenaAllocation upload;
+		uint64_t index_offset;
+		std::vector<IndexChunk> chunks;
+		std::vector<MeshLod> lods;
+	};
+
+	// decodes the vertex and index streams into arena, the indices converted to index_size (2 or 4). Going to
+	// 16 bits re-splits 32-bit meshes into 16-bit chunks, that fails only if a single triangle spans 64K vertices.
+	// Only converted indices go through cpu memory first, the rest is written once, into the arena.
+	// Waits while the arena is full, see UploadArena::Allocate
+	std::unique_ptr<StreamedAsset> DecodeStreamedMesh( const uint8_t* data, size_t size, UploadArena& arena, uint32_t index_size, std::string& error );
+}
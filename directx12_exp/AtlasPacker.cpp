@@ -0,0 +1,399 @@
+#include "AtlasPacker.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DXLayer
+{
+	namespace
+	{
+		bool Intersects( const AtlasRect& a, const AtlasRect& b )
+		{
+			return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+		}
+
+		bool Encloses( const AtlasRect& outer, const AtlasRect& inner )
+		{
+			return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+		}
+
+		bool SameRect( const AtlasRect& a, const AtlasRect& b )
+		{
+			return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+		}
+	}
+
+	const uint32_t AtlasPacker::invalid_image;
+
+	AtlasPacker::AtlasPacker( )
+	{
+		Init( AtlasOptions( ) );
+	}
+
+	void AtlasPacker::Init( const AtlasOptions& options )
+	{
+		this->options = options;
+		this->options.alignment = options.alignment ? options.alignment : 1;
+		this->options.width -= options.width % this->options.alignment;
+		this->options.height -= options.height % this->options.alignment;
+		images.clear( );
+		free_images.clear( );
+		Clear( );
+	}
+
+	uint32_t AtlasPacker::Add( uint32_t width, uint32_t height )
+	{
+		AtlasRect padded;
+		if ( !width || !height || !Place( PaddedSize( width ), PaddedSize( height ), padded ) )
+			return invalid_image;
+		return NewImage( width, height, padded );
+	}
+
+	bool AtlasPacker::AddBatch( const uint32_t* sizes, uint32_t count, uint32_t* batch_images )
+	{
+		// what to go back to when one doesn't fit, the skyline can't take images out again
+		const std::vector<SkylineSegment> saved_skyline( skyline );
+		const std::vector<AtlasRect> saved_free_rects( free_rects );
+		const std::vector<uint32_t> saved_free_images( free_images );
+		const size_t saved_image_count = images.size( );
+
+		std::vector<uint32_t> order( count );
+		for ( uint32_t i = 0; i < count; ++i )
+			order[i] = i;
+		SortLargestFirst( order, sizes );
+		for ( uint32_t i : order )
+		{
+			batch_images[i] = Add( sizes[i * 2], sizes[i * 2 + 1] );
+			if ( batch_images[i] != invalid_image )
+				continue;
+
+			for ( uint32_t j : order )
+			{
+				if ( j == i )
+					break;
+				images[batch_images[j]].live = false;
+			}
+			images.resize( saved_image_count );
+			skyline = saved_skyline;
+			free_rects = saved_free_rects;
+			free_images = saved_free_images;
+			return false;
+		}
+		return true;
+	}
+
+	void AtlasPacker::Remove( uint32_t image )
+	{
+		if ( !Contains( image ) )
+			return;
+		images[image].live = false;
+		free_images.push_back( image );
+		if ( options.packing == atlas_max_rects )
+			FreeRect( images[image].padded );
+	}
+
+	bool AtlasPacker::Repack( std::vector<AtlasMove>& moves )
+	{
+		moves.clear( );
+		std::vector<uint32_t> live, sizes;
+		for ( uint32_t image = 0; image < images.size( ); ++image )
+		{
+			if ( !images[image].live )
+				continue;
+			live.push_back( image );
+			sizes.push_back( images[image].width );
+			sizes.push_back( images[image].height );
+		}
+		std::vector<uint32_t> order( live.size( ) );
+		for ( uint32_t i = 0; i < order.size( ); ++i )
+			order[i] = i;
+		SortLargestFirst( order, sizes.data( ) );
+
+		const std::vector<SkylineSegment> saved_skyline( skyline );
+		const std::vector<AtlasRect> saved_free_rects( free_rects );
+		Clear( );
+		std::vector<AtlasRect> placed( live.size( ) );
+		for ( uint32_t i : order )
+		{
+			if ( !Place( PaddedSize( sizes[i * 2] ), PaddedSize( sizes[i * 2 + 1] ), placed[i] ) )
+			{
+				skyline = saved_skyline;
+				free_rects = saved_free_rects;
+				return false;
+			}
+		}
+
+		for ( uint32_t i = 0; i < live.size( ); ++i )
+		{
+			Image& image = images[live[i]];
+			if ( !SameRect( image.padded, placed[i] ) )
+				moves.push_back( AtlasMove{ live[i], image.padded, placed[i] } );
+			image.padded = placed[i];
+		}
+		return true;
+	}
+
+	AtlasRect AtlasPacker::Rect( uint32_t image ) const
+	{
+		const Image& entry = images[image];
+		return AtlasRect{ entry.padded.x + options.padding, entry.padded.y + options.padding, entry.width, entry.height };
+	}
+
+	AtlasUvTransform AtlasPacker::UvTransform( uint32_t image ) const
+	{
+		const AtlasRect rect = Rect( image );
+		const float width = float( options.width ), height = float( options.height );
+		return AtlasUvTransform{ rect.width / width, rect.height / height, rect.x / width, rect.y / height };
+	}
+
+	void AtlasPacker::WriteUvTransforms( AtlasUvTransform* transforms ) const
+	{
+		for ( uint32_t image = 0; image < images.size( ); ++image )
+			transforms[image] = images[image].live ? UvTransform( image ) : AtlasUvTransform{ 0.0f, 0.0f, 0.0f, 0.0f };
+	}
+
+	AtlasStats AtlasPacker::Stats( ) const
+	{
+		AtlasStats stats = { };
+		for ( const Image& image : images )
+		{
+			if ( !image.live )
+				continue;
+			++stats.image_count;
+			stats.image_area += uint64_t( image.width ) * image.height;
+			stats.padded_area += uint64_t( image.padded.width ) * image.padded.height;
+			stats.used_height = std::max( stats.used_height, image.padded.y + image.padded.height );
+		}
+		stats.free_rect_count = options.packing == atlas_max_rects ? uint32_t( free_rects.size( ) ) : 0;
+		return stats;
+	}
+
+	void AtlasPacker::Clear( )
+	{
+		skyline.assign( 1, SkylineSegment{ 0, 0, options.width } );
+		free_rects.assign( 1, AtlasRect{ 0, 0, options.width, options.height } );
+	}
+
+	uint32_t AtlasPacker::PaddedSize( uint32_t size ) const
+	{
+		const uint32_t padded = size + options.padding * 2;
+		return ( padded + options.alignment - 1 ) / options.alignment * options.alignment;
+	}
+
+	bool AtlasPacker::Place( uint32_t width, uint32_t height, AtlasRect& rect )
+	{
+		if ( width > options.width || height > options.height )
+			return false;
+		return options.packing == atlas_skyline ? PlaceSkyline( width, height, rect ) : PlaceMaxRects( width, height, rect );
+	}
+
+	// the lowest top edge a rect starting at each segment would have, leftmost on ties
+	bool AtlasPacker::PlaceSkyline( uint32_t width, uint32_t height, AtlasRect& rect )
+	{
+		size_t best = skyline.size( );
+		uint32_t best_y = 0;
+		for ( size_t i = 0; i < skyline.size( ) && skyline[i].x + width <= options.width; ++i )
+		{
+			uint32_t y = 0;
+			for ( size_t j = i, covered = 0; covered < width; covered += skyline[j++].width )
+				y = std::max( y, skyline[j].y );
+			if ( y + height <= options.height && ( best == skyline.size( ) || y + height < best_y + height ) )
+			{
+				best = i;
+				best_y = y;
+			}
+		}
+		if ( best == skyline.size( ) )
+			return false;
+
+		// the new segment covers the start of the ones under it
+		rect = AtlasRect{ skyline[best].x, best_y, width, height };
+		skyline.insert( skyline.begin( ) + best, SkylineSegment{ rect.x, best_y + height, width } );
+		const uint32_t end = rect.x + width;
+		size_t next = best + 1;
+		while ( next < skyline.size( ) && skyline[next].x < end )
+		{
+			const uint32_t segment_end = skyline[next].x + skyline[next].width;
+			if ( segment_end <= end )
+			{
+				skyline.erase( skyline.begin( ) + next );
+				continue;
+			}
+			skyline[next].width = segment_end - end;
+			skyline[next].x = end;
+			break;
+		}
+
+		// neighbors at the same height are one segment
+		for ( size_t i = 0; i + 1 < skyline.size( ); )
+		{
+			if ( skyline[i].y == skyline[i + 1].y )
+			{
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase( skyline.begin( ) + i + 1 );
+			}
+			else
+			{
+				++i;
+			}
+		}
+		return true;
+	}
+
+	// best short side fit: the free rect leaving the least on its tighter side, then on the other
+	bool AtlasPacker::PlaceMaxRects( uint32_t width, uint32_t height, AtlasRect& rect )
+	{
+		size_t best = free_rects.size( );
+		uint32_t best_short = ~0u, best_long = ~0u;
+		for ( size_t i = 0; i < free_rects.size( ); ++i )
+		{
+			const AtlasRect& free_rect = free_rects[i];
+			if ( free_rect.width < width || free_rect.height < height )
+				continue;
+			const uint32_t left_x = free_rect.width - width, left_y = free_rect.height - height;
+			const uint32_t short_side = std::min( left_x, left_y ), long_side = std::max( left_x, left_y );
+			if ( short_side < best_short || ( short_side == best_short && long_side < best_long ) )
+			{
+				best = i;
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+		if ( best == free_rects.size( ) )
+			return false;
+
+		rect = AtlasRect{ free_rects[best].x, free_rects[best].y, width, height };
+		SplitFreeRects( rect );
+		return true;
+	}
+
+	// every free rect the used one cuts into is replaced by the up to four largest rects around it
+	void AtlasPacker::SplitFreeRects( const AtlasRect& used )
+	{
+		const size_t old_count = free_rects.size( );
+		std::vector<AtlasRect> pieces;
+		size_t kept = 0;
+		for ( size_t i = 0; i < old_count; ++i )
+		{
+			const AtlasRect free_rect = free_rects[i];
+			if ( !Intersects( free_rect, used ) )
+			{
+				free_rects[kept++] = free_rect;
+				continue;
+			}
+			if ( used.x > free_rect.x )
+				pieces.push_back( AtlasRect{ free_rect.x, free_rect.y, used.x - free_rect.x, free_rect.height } );
+			if ( used.x + used.width < free_rect.x + free_rect.width )
+				pieces.push_back( AtlasRect{ used.x + used.width, free_rect.y, free_rect.x + free_rect.width - used.x - used.width, free_rect.height } );
+			if ( used.y > free_rect.y )
+				pieces.push_back( AtlasRect{ free_rect.x, free_rect.y, free_rect.width, used.y - free_rect.y } );
+			if ( used.y + used.height < free_rect.y + free_rect.height )
+				pieces.push_back( AtlasRect{ free_rect.x, used.y + used.height, free_rect.width, free_rect.y + free_rect.height - used.y - used.height } );
+		}
+		free_rects.resize( kept );
+
+		// the untouched rects didn't contain each other before, and a piece can't hold one of them, it's part of a
+		// rect that didn't. So only pieces inside other rects go
+		for ( size_t i = 0; i < pieces.size( ); ++i )
+		{
+			bool contained = false;
+			for ( size_t j = 0; j < kept && !contained; ++j )
+				contained = Encloses( free_rects[j], pieces[i] );
+			for ( size_t j = 0; j < pieces.size( ) && !contained; ++j )
+				contained = j != i && Encloses( pieces[j], pieces[i] ) && ( !SameRect( pieces[j], pieces[i] ) || j < i );
+			if ( !contained )
+				free_rects.push_back( pieces[i] );
+		}
+	}
+
+	void AtlasPacker::PruneFreeRects( )
+	{
+		for ( size_t i = 0; i < free_rects.size( ); )
+		{
+			bool contained = false;
+			for ( size_t j = 0; j < free_rects.size( ) && !contained; ++j )
+				contained = j != i && Encloses( free_rects[j], free_rects[i] );
+			if ( contained )
+			{
+				free_rects[i] = free_rects.back( );
+				free_rects.pop_back( );
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	// a removed image's rect goes back, joined with the free rects that share a whole edge with it, which keeps
+	// the free rects close to maximal
+	void AtlasPacker::FreeRect( const AtlasRect& rect )
+	{
+		AtlasRect grown = rect;
+		for ( bool merged = true; merged; )
+		{
+			merged = false;
+			for ( const AtlasRect& free_rect : free_rects )
+			{
+				const bool column = free_rect.x == grown.x && free_rect.width == grown.width &&
+					( free_rect.y + free_rect.height == grown.y || grown.y + grown.height == free_rect.y );
+				const bool row = free_rect.y == grown.y && free_rect.height == grown.height &&
+					( free_rect.x + free_rect.width == grown.x || grown.x + grown.width == free_rect.x );
+				if ( column || row )
+				{
+					grown = AtlasRect{ std::min( grown.x, free_rect.x ), std::min( grown.y, free_rect.y ),
+						column ? grown.width : grown.width + free_rect.width, column ? grown.height + free_rect.height : grown.height };
+					merged = true;
+					break;
+				}
+			}
+			if ( merged )
+				free_rects.push_back( grown );
+		}
+		free_rects.push_back( rect );
+		PruneFreeRects( );
+	}
+
+	uint32_t AtlasPacker::NewImage( uint32_t width, uint32_t height, const AtlasRect& padded )
+	{
+		const Image image = { padded, width, height, true };
+		if ( !free_images.empty( ) )
+		{
+			const uint32_t id = free_images.back( );
+			free_images.pop_back( );
+			images[id] = image;
+			return id;
+		}
+		images.push_back( image );
+		return uint32_t( images.size( ) - 1 );
+	}
+
+	// the skyline packs tightest by height, max rects by the longer side
+	void AtlasPacker::SortLargestFirst( std::vector<uint32_t>& order, const uint32_t* sizes ) const
+	{
+		const bool skyline_order = options.packing == atlas_skyline;
+		std::stable_sort( order.begin( ), order.end( ), [ & ] ( uint32_t a, uint32_t b )
+		{
+			const uint32_t a_width = sizes[a * 2], a_height = sizes[a * 2 + 1], b_width = sizes[b * 2], b_height = sizes[b * 2 + 1];
+			if ( skyline_order )
+				return a_height != b_height ? a_height > b_height : a_width > b_width;
+			const uint32_t a_long = std::max( a_width, a_height ), b_long = std::max( b_width, b_height );
+			return a_long != b_long ? a_long > b_long : std::min( a_width, a_height ) > std::min( b_width, b_height );
+		} );
+	}
+
+	void BlitAtlasImage( uint8_t* atlas, size_t atlas_row_pitch, const AtlasRect& rect, uint32_t padding, const uint8_t* texels, size_t row_pitch )
+	{
+		for ( int32_t row = -int32_t( padding ); row < int32_t( rect.height + padding ); ++row )
+		{
+			const int32_t source_row = std::min( std::max( row, 0 ), int32_t( rect.height ) - 1 );
+			const uint8_t* source = texels + source_row * row_pitch;
+			uint8_t* destination = atlas + ( rect.y + row ) * atlas_row_pitch + ( rect.x - padding ) * 4;
+			for ( uint32_t p = 0; p < padding; ++p )
+				std::memcpy( destination + p * 4, source, 4 );
+			std::memcpy( destination + padding * 4, source, rect.width * 4 );
+			for ( uint32_t p = 0; p < padding; ++p )
+				std::memcpy( destination + ( padding + rect.width + p ) * 4, source + ( rect.width - 1 ) * 4, 4 );
+		}
+	}
+}
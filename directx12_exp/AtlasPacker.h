@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// rectangles for many small images in one fixed size atlas texture, so one descriptor and one bind cover all of
+// them and the shader finds an image through its uv transform. Two packers: a skyline, fast and good for images
+// of similar heights, and max rects, slower but tighter for mixed sizes and the one that reuses the space of
+// removed images. When an image doesn't fit any more, Repack lays every image out again from scratch and returns
+// the copies that get there. No d3d in here
+
+namespace DXLayer
+{
+	enum AtlasPacking : uint32_t
+	{
+		atlas_skyline,		// bottom left along the top edge of what's placed, removed images leave holes until a repack
+		atlas_max_rects		// best short side fit into the largest free rectangles, removed images go back into them
+	};
+
+	struct AtlasOptions
+	{
+		AtlasOptions( )
+			: width( 4096 ), height( 4096 ), padding( 2 ), alignment( 4 ), packing( atlas_max_rects )
+		{ }
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t padding;		// texels around each image holding copies of its edge, so filtering doesn't reach a neighbor
+		uint32_t alignment;		// padded images start on and span multiples of this: 4 keeps BC blocks whole, with 2^n
+								// and a padding of 2^n the first n mips stay clear of the neighbors too
+		AtlasPacking packing;
+	};
+
+	struct AtlasRect
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// an image's own texture coordinates into the atlas: uv * scale + offset
+	struct AtlasUvTransform
+	{
+		float scale_u;
+		float scale_v;
+		float offset_u;
+		float offset_v;
+	};
+
+	// an image moved by a repack, padding included. Destinations can overlap other images' sources, every source
+	// has to be read before any destination is written, through a scratch texture
+	struct AtlasMove
+	{
+		uint32_t image;
+		AtlasRect source;
+		AtlasRect destination;
+	};
+
+	struct AtlasStats
+	{
+		uint32_t image_count;
+		uint64_t image_area;		// texels of the images themselves
+		uint64_t padded_area;		// with padding and alignment
+		uint32_t used_height;		// the lowest edge of any image
+		uint32_t free_rect_count;	// max rects only
+	};
+
+	class AtlasPacker
+	{
+	public:
+		static const uint32_t invalid_image = ~0u;
+
+		AtlasPacker( );
+
+		// an empty atlas. Its size is rounded down to the alignment
+		void Init( const AtlasOptions& options );
+
+		// returns invalid_image when there's no room, even if a repack would make some
+		uint32_t Add( uint32_t width, uint32_t height );
+
+		// sizes[2 * count], width and height of each image, placed largest first, which packs tighter than one
+		// at a time. images gets their ids in the order of sizes. False and nothing added when one doesn't fit
+		bool AddBatch( const uint32_t* sizes, uint32_t count, uint32_t* images );
+
+		void Remove( uint32_t image );
+
+		// places every image again, largest first, into the empty atlas. Ids stay, moves gets the images whose
+		// place changed. False and nothing moved when they don't all fit
+		bool Repack( std::vector<AtlasMove>& moves );
+
+		// where an image's texels are, padding aside
+		AtlasRect Rect( uint32_t image ) const;
+		AtlasUvTransform UvTransform( uint32_t image ) const;
+
+		// ImageSlots( ) transforms indexed by image id, zeros for ids not in use. What the shader's table holds
+		void WriteUvTransforms( AtlasUvTransform* transforms ) const;
+
+		uint32_t ImageSlots( ) const { return uint32_t( images.size( ) ); }
+		bool Contains( uint32_t image ) const { return image < images.size( ) && images[image].live; }
+		const AtlasOptions& Options( ) const { return options; }
+		AtlasStats Stats( ) const;
+
+	private:
+		struct Image
+		{
+			AtlasRect padded;
+			uint32_t width;
+			uint32_t height;
+			bool live;
+		};
+
+		struct SkylineSegment
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+		};
+
+		void Clear( );
+		uint32_t PaddedSize( uint32_t size ) const;
+		bool Place( uint32_t width, uint32_t height, AtlasRect& rect );
+		bool PlaceSkyline( uint32_t width, uint32_t height, AtlasRect& rect );
+		bool PlaceMaxRects( uint32_t width, uint32_t height, AtlasRect& rect );
+		void SplitFreeRects( const AtlasRect& used );
+		void PruneFreeRects( );
+		void FreeRect( const AtlasRect& rect );
+		uint32_t NewImage( uint32_t width, uint32_t height, const AtlasRect& padded );
+		void SortLargestFirst( std::vector<uint32_t>& order, const uint32_t* sizes ) const;
+
+		AtlasOptions options;
+		std::vector<Image> images;
+		std::vector<uint32_t> free_images;			// ids to reuse
+		std::vector<SkylineSegment> skyline;		// left to right, covering the width
+		std::vector<AtlasRect> free_rects;			// maximal free rectangles, they overlap each other
+	};
+
+	// copies an rgba8 image into an rgba8 atlas at rect, its edge texels repeated into padding texels around it
+	void BlitAtlasImage( uint8_t* atlas, size_t atlas_row_pitch, const AtlasRect& rect, uint32_t padding, const uint8_t* texels, size_t row_pitch );
+}
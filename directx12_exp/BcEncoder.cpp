@@ -0,0 +1,966 @@
+#include "BcEncoder.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "RunOnThreads.h"
+#include "Simd.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// DXGI_FORMAT values
+		const uint32_t format_bc1 = 71, format_bc1_srgb = 72;
+		const uint32_t format_bc3 = 77, format_bc3_srgb = 78;
+		const uint32_t format_bc4 = 80;
+		const uint32_t format_bc5 = 83;
+		const uint32_t format_bc7 = 98, format_bc7_srgb = 99;
+
+		// BC7 interpolation weights out of 64
+		const uint32_t bc7_weights2[4] = { 0, 21, 43, 64 };
+		const uint32_t bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// how hard each quality tries
+		struct Effort
+		{
+			uint32_t axis_iterations;	// power iterations for the principal axis, from the bounding box diagonal
+			uint32_t refits;			// least squares passes over the endpoints
+			bool extra_modes;			// BC1 3 color blocks, BC4 blocks with 0 and 255, BC7 mode 5
+		};
+
+		Effort EffortOf( BcQuality quality )
+		{
+			const Effort efforts[3] = { { 1, 0, false }, { 4, 1, false }, { 8, 3, true } };
+			return efforts[quality <= bc_quality_high ? quality : bc_quality_high];
+		}
+
+		// up to 16 points of up to 4 channels in 0..255, channel after channel so four points fit a register.
+		// Lanes past count are zero
+		struct Points
+		{
+			float v[4][16];
+			uint32_t dims;
+			uint32_t count;
+		};
+
+		// the channels first, first + 1 ... of the texels, skipping those where keep is false
+		void GatherPoints( const uint8_t ( &texels )[64], uint32_t first, uint32_t dims, const bool* keep, Points& points )
+		{
+			std::memset( &points, 0, sizeof( points ) );
+			points.dims = dims;
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				if ( keep && !keep[i] )
+					continue;
+				for ( uint32_t c = 0; c < dims; ++c )
+					points.v[c][points.count] = texels[i * 4 + first + c];
+				++points.count;
+			}
+		}
+
+		float Clamp255( float value )
+		{
+			return value < 0.0f ? 0.0f : value > 255.0f ? 255.0f : value;
+		}
+
+		// endpoints at the extremes of the points along their principal axis
+		void FitLine( const Points& points, uint32_t iterations, float* e0, float* e1 )
+		{
+			const uint32_t dims = points.dims;
+			float mean[4] = {}, low[4], high[4];
+			for ( uint32_t c = 0; c < dims; ++c )
+			{
+				low[c] = 255.0f;
+				high[c] = 0.0f;
+				for ( uint32_t i = 0; i < points.count; ++i )
+				{
+					const float value = points.v[c][i];
+					mean[c] += value;
+					low[c] = value < low[c] ? value : low[c];
+					high[c] = value > high[c] ? value : high[c];
+				}
+				mean[c] /= float( points.count );
+			}
+			if ( dims == 1 )
+			{
+				e0[0] = low[0];
+				e1[0] = high[0];
+				return;
+			}
+
+			float covariance[4][4] = {};
+			for ( uint32_t i = 0; i < points.count; ++i )
+			{
+				for ( uint32_t a = 0; a < dims; ++a )
+				{
+					for ( uint32_t b = a; b < dims; ++b )
+						covariance[a][b] += ( points.v[a][i] - mean[a] ) * ( points.v[b][i] - mean[b] );
+				}
+			}
+			for ( uint32_t a = 0; a < dims; ++a )
+			{
+				for ( uint32_t b = 0; b < a; ++b )
+					covariance[a][b] = covariance[b][a];
+			}
+
+			float axis[4];
+			for ( uint32_t c = 0; c < dims; ++c )
+				axis[c] = high[c] - low[c];
+			for ( uint32_t iteration = 0; iteration < iterations; ++iteration )
+			{
+				float next[4] = {};
+				float length = 0.0f;
+				for ( uint32_t a = 0; a < dims; ++a )
+				{
+					for ( uint32_t b = 0; b < dims; ++b )
+						next[a] += covariance[a][b] * axis[b];
+					length += next[a] * next[a];
+				}
+				// no spread along the axis, the bounding box diagonal is as good as anything
+				if ( length < 1e-12f )
+					break;
+				const float scale = 1.0f / std::sqrt( length );
+				for ( uint32_t c = 0; c < dims; ++c )
+					axis[c] = next[c] * scale;
+			}
+
+			float length = 0.0f;
+			for ( uint32_t c = 0; c < dims; ++c )
+				length += axis[c] * axis[c];
+			if ( length < 1e-12f )
+			{
+				for ( uint32_t c = 0; c < dims; ++c )
+					e0[c] = e1[c] = mean[c];
+				return;
+			}
+			float t_low = 1e30f, t_high = -1e30f;
+			for ( uint32_t i = 0; i < points.count; ++i )
+			{
+				float t = 0.0f;
+				for ( uint32_t c = 0; c < dims; ++c )
+					t += ( points.v[c][i] - mean[c] ) * axis[c];
+				t_low = t < t_low ? t : t_low;
+				t_high = t > t_high ? t : t_high;
+			}
+			for ( uint32_t c = 0; c < dims; ++c )
+			{
+				e0[c] = Clamp255( mean[c] + axis[c] * t_low / length );
+				e1[c] = Clamp255( mean[c] + axis[c] * t_high / length );
+			}
+		}
+
+		// index 0 .. levels - 1 of the nearest step along e0 to e1 for every point, the steps evenly spaced.
+		// The BC7 weights are within a tenth of a step of even, close enough to pick from
+		void ProjectIndices( const Points& points, const float* e0, const float* e1, uint32_t levels, uint8_t* indices )
+		{
+			float direction[4] = {};
+			float length = 0.0f;
+			for ( uint32_t c = 0; c < points.dims; ++c )
+			{
+				direction[c] = e1[c] - e0[c];
+				length += direction[c] * direction[c];
+			}
+			const float scale = length > 0.0f ? float( levels - 1 ) / length : 0.0f;
+			for ( uint32_t c = 0; c < points.dims; ++c )
+				direction[c] *= scale;
+
+			uint32_t i = 0;
+#if DXL_SSE2
+			const __m128 top = _mm_set1_ps( float( levels - 1 ) );
+			for ( ; i < points.count; i += 4 )
+			{
+				__m128 t = _mm_setzero_ps( );
+				for ( uint32_t c = 0; c < points.dims; ++c )
+					t = _mm_add_ps( t, _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( &points.v[c][i] ), _mm_set1_ps( e0[c] ) ), _mm_set1_ps( direction[c] ) ) );
+				t = _mm_min_ps( _mm_max_ps( t, _mm_setzero_ps( ) ), top );
+
+				// rounds to nearest, then 32 to 8 bits. Lanes past count land in the padding of indices
+				const __m128i q = _mm_cvtps_epi32( t );
+				const __m128i q16 = _mm_packs_epi32( q, q );
+				const int packed = _mm_cvtsi128_si32( _mm_packus_epi16( q16, q16 ) );
+				std::memcpy( indices + i, &packed, 4 );
+			}
+#else
+			for ( ; i < points.count; ++i )
+			{
+				float t = 0.0f;
+				for ( uint32_t c = 0; c < points.dims; ++c )
+					t += ( points.v[c][i] - e0[c] ) * direction[c];
+				t = t < 0.0f ? 0.0f : t > float( levels - 1 ) ? float( levels - 1 ) : t;
+				indices[i] = uint8_t( t + 0.5f );
+			}
+#endif
+		}
+
+		// squared error of the points against their steps, weights out of 64
+		float LineError( const Points& points, const float* e0, const float* e1, const uint32_t* weights, const uint8_t* indices )
+		{
+			float error = 0.0f;
+			for ( uint32_t i = 0; i < points.count; ++i )
+			{
+				const float w = float( weights[indices[i]] ) / 64.0f;
+				for ( uint32_t c = 0; c < points.dims; ++c )
+				{
+					const float d = e0[c] + ( e1[c] - e0[c] ) * w - points.v[c][i];
+					error += d * d;
+				}
+			}
+			return error;
+		}
+
+		// least squares endpoints for the points with these indices. False when the indices don't pin them down
+		bool RefitLine( const Points& points, const uint32_t* weights, const uint8_t* indices, float* e0, float* e1 )
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ap[4] = {}, bp[4] = {};
+			for ( uint32_t i = 0; i < points.count; ++i )
+			{
+				const float w = float( weights[indices[i]] ) / 64.0f;
+				aa += ( 1.0f - w ) * ( 1.0f - w );
+				ab += ( 1.0f - w ) * w;
+				bb += w * w;
+				for ( uint32_t c = 0; c < points.dims; ++c )
+				{
+					ap[c] += ( 1.0f - w ) * points.v[c][i];
+					bp[c] += w * points.v[c][i];
+				}
+			}
+			const float determinant = aa * bb - ab * ab;
+			if ( std::fabs( determinant ) < 1e-6f )
+				return false;
+			for ( uint32_t c = 0; c < points.dims; ++c )
+			{
+				e0[c] = Clamp255( ( ap[c] * bb - bp[c] * ab ) / determinant );
+				e1[c] = Clamp255( ( bp[c] * aa - ap[c] * ab ) / determinant );
+			}
+			return true;
+		}
+
+		// evenly spaced weights out of 64 for 3, 4 and 8 levels
+		const uint32_t even_weights3[3] = { 0, 32, 64 };
+		const uint32_t even_weights4[4] = { 0, 21, 43, 64 };
+		const uint32_t even_weights8[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+
+		// the fit every format runs: endpoints along the axis, quantized, indices projected, refitted while that helps.
+		// quantize rounds the float endpoints to what the block can store and sets them to their decoded values
+		template <typename Quantize>
+		void FitAndQuantize( const Points& points, const Effort& effort, uint32_t levels, const uint32_t* weights, Quantize quantize, float* e0, float* e1, uint8_t* indices )
+		{
+			FitLine( points, effort.axis_iterations, e0, e1 );
+			quantize( e0, e1 );
+			ProjectIndices( points, e0, e1, levels, indices );
+			float error = LineError( points, e0, e1, weights, indices );
+			for ( uint32_t refit = 0; refit < effort.refits && error > 0.0f; ++refit )
+			{
+				float f0[4], f1[4];
+				uint8_t refit_indices[16];
+				if ( !RefitLine( points, weights, indices, f0, f1 ) )
+					break;
+				quantize( f0, f1 );
+				ProjectIndices( points, f0, f1, levels, refit_indices );
+				const float refit_error = LineError( points, f0, f1, weights, refit_indices );
+				if ( refit_error >= error )
+					break;
+				error = refit_error;
+				std::memcpy( e0, f0, sizeof( f0 ) );
+				std::memcpy( e1, f1, sizeof( f1 ) );
+				std::memcpy( indices, refit_indices, 16 );
+			}
+		}
+
+		// 128 bits written and read from bit 0 up, as the BC7 layout counts them
+		struct Bits
+		{
+			uint64_t words[2];
+			uint32_t position;
+
+			void Put( uint32_t value, uint32_t count )
+			{
+				for ( uint32_t i = 0; i < count; ++i, ++position )
+				{
+					if ( ( value >> i ) & 1 )
+						words[position >> 6] |= 1ull << ( position & 63 );
+				}
+			}
+
+			uint32_t Get( uint32_t count )
+			{
+				uint32_t value = 0;
+				for ( uint32_t i = 0; i < count; ++i, ++position )
+					value |= uint32_t( ( words[position >> 6] >> ( position & 63 ) ) & 1 ) << i;
+				return value;
+			}
+		};
+
+		uint32_t Round( float value )
+		{
+			return uint32_t( value + 0.5f );
+		}
+
+		// ---- BC1, the color half of BC3
+
+		uint32_t Expand5( uint32_t value ) { return ( value << 3 ) | ( value >> 2 ); }
+		uint32_t Expand6( uint32_t value ) { return ( value << 2 ) | ( value >> 4 ); }
+
+		uint32_t Pack565( const float* color )
+		{
+			return Round( color[0] * 31.0f / 255.0f ) << 11 | Round( color[1] * 63.0f / 255.0f ) << 5 | Round( color[2] * 31.0f / 255.0f );
+		}
+
+		void Unpack565( uint32_t packed, float* color )
+		{
+			color[0] = float( Expand5( packed >> 11 ) );
+			color[1] = float( Expand6( ( packed >> 5 ) & 63 ) );
+			color[2] = float( Expand5( packed & 31 ) );
+		}
+
+		void Quantize565( float* e0, float* e1 )
+		{
+			Unpack565( Pack565( e0 ), e0 );
+			Unpack565( Pack565( e1 ), e1 );
+		}
+
+		// four colors, or three and transparent black when three_color is set. Texels with alpha under 128 are
+		// transparent in a three color block
+		void EncodeColorBlock( const uint8_t ( &texels )[64], bool three_color, const Effort& effort, uint8_t* block )
+		{
+			bool opaque[16];
+			for ( uint32_t i = 0; i < 16; ++i )
+				opaque[i] = !three_color || texels[i * 4 + 3] >= 128;
+			Points points;
+			GatherPoints( texels, 0, 3, opaque, points );
+
+			const uint32_t levels = three_color ? 3 : 4;
+			float e0[4], e1[4];
+			uint8_t indices[16] = {};
+			if ( points.count )
+				FitAndQuantize( points, effort, levels, three_color ? even_weights3 : even_weights4, Quantize565, e0, e1, indices );
+			uint32_t c0 = points.count ? Pack565( e0 ) : 0;
+			uint32_t c1 = points.count ? Pack565( e1 ) : 0;
+
+			// four colors need c0 > c1, three c0 <= c1, the order of the endpoints picks the mode. Equal endpoints
+			// in a four color block can only be one color, every index 0 then
+			const bool swap = three_color ? c0 > c1 : c0 < c1;
+			if ( swap )
+			{
+				const uint32_t c = c0;
+				c0 = c1;
+				c1 = c;
+			}
+			const uint8_t four_codes[4] = { 0, 2, 3, 1 };
+			const uint8_t three_codes[3] = { 0, 2, 1 };
+			uint32_t selectors = 0;
+			for ( uint32_t i = 0, point = 0; i < 16; ++i )
+			{
+				uint32_t code = 3;
+				if ( opaque[i] )
+				{
+					const uint32_t index = swap ? levels - 1 - indices[point] : indices[point];
+					code = three_color ? three_codes[index] : ( c0 == c1 ? 0 : four_codes[index] );
+					++point;
+				}
+				selectors |= code << ( i * 2 );
+			}
+			block[0] = uint8_t( c0 );
+			block[1] = uint8_t( c0 >> 8 );
+			block[2] = uint8_t( c1 );
+			block[3] = uint8_t( c1 >> 8 );
+			std::memcpy( block + 4, &selectors, 4 );
+		}
+
+		// always_four for the color half of BC3, which ignores the order of the endpoints
+		void DecodeColorBlock( const uint8_t* block, bool always_four, uint8_t ( &texels )[64] )
+		{
+			const uint32_t c0 = block[0] | block[1] << 8;
+			const uint32_t c1 = block[2] | block[3] << 8;
+			float e0[3], e1[3];
+			Unpack565( c0, e0 );
+			Unpack565( c1, e1 );
+			uint32_t palette[4][4];
+			for ( uint32_t c = 0; c < 3; ++c )
+			{
+				const uint32_t a = uint32_t( e0[c] ), b = uint32_t( e1[c] );
+				palette[0][c] = a;
+				palette[1][c] = b;
+				if ( always_four || c0 > c1 )
+				{
+					palette[2][c] = ( 2 * a + b ) / 3;
+					palette[3][c] = ( a + 2 * b ) / 3;
+				}
+				else
+				{
+					palette[2][c] = ( a + b ) / 2;
+					palette[3][c] = 0;
+				}
+			}
+			palette[0][3] = palette[1][3] = palette[2][3] = 255;
+			palette[3][3] = always_four || c0 > c1 ? 255 : 0;
+
+			uint32_t selectors;
+			std::memcpy( &selectors, block + 4, 4 );
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				for ( uint32_t c = 0; c < 4; ++c )
+					texels[i * 4 + c] = uint8_t( palette[( selectors >> ( i * 2 ) ) & 3][c] );
+			}
+		}
+
+		// ---- BC4, the alpha half of BC3 and both halves of BC5
+
+		void QuantizeByte( float* e0, float* e1 )
+		{
+			e0[0] = float( Round( e0[0] ) );
+			e1[0] = float( Round( e1[0] ) );
+		}
+
+		void DecodeChannelBlock( const uint8_t* block, uint8_t ( &texels )[64], uint32_t channel )
+		{
+			const uint32_t e0 = block[0], e1 = block[1];
+			uint32_t palette[8] = { e0, e1 };
+			if ( e0 > e1 )
+			{
+				for ( uint32_t k = 1; k < 7; ++k )
+					palette[k + 1] = ( ( 7 - k ) * e0 + k * e1 ) / 7;
+			}
+			else
+			{
+				for ( uint32_t k = 1; k < 5; ++k )
+					palette[k + 1] = ( ( 5 - k ) * e0 + k * e1 ) / 5;
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+			uint64_t codes = 0;
+			for ( uint32_t b = 0; b < 6; ++b )
+				codes |= uint64_t( block[2 + b] ) << ( b * 8 );
+			for ( uint32_t i = 0; i < 16; ++i )
+				texels[i * 4 + channel] = uint8_t( palette[( codes >> ( i * 3 ) ) & 7] );
+		}
+
+		uint32_t ChannelError( const uint8_t* block, const uint8_t ( &texels )[64], uint32_t channel )
+		{
+			uint8_t decoded[64];
+			DecodeChannelBlock( block, decoded, channel );
+			uint32_t error = 0;
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				const int d = int( decoded[i * 4 + channel] ) - int( texels[i * 4 + channel] );
+				error += uint32_t( d * d );
+			}
+			return error;
+		}
+
+		void WriteChannelBlock( uint32_t e0, uint32_t e1, const uint8_t* codes, uint8_t* block )
+		{
+			block[0] = uint8_t( e0 );
+			block[1] = uint8_t( e1 );
+			uint64_t packed = 0;
+			for ( uint32_t i = 0; i < 16; ++i )
+				packed |= uint64_t( codes[i] ) << ( i * 3 );
+			for ( uint32_t b = 0; b < 6; ++b )
+				block[2 + b] = uint8_t( packed >> ( b * 8 ) );
+		}
+
+		// eight steps from e0 down to e1, at high quality also six steps with 0 and 255 on the side, whichever is closer
+		void EncodeChannelBlock( const uint8_t ( &texels )[64], uint32_t channel, const Effort& effort, uint8_t* block )
+		{
+			Points points;
+			GatherPoints( texels, channel, 1, nullptr, points );
+			float e0[4], e1[4];
+			uint8_t indices[16];
+			FitAndQuantize( points, effort, 8, even_weights8, QuantizeByte, e0, e1, indices );
+
+			// eight steps need the first endpoint larger, the steps then run from it down to the second
+			const bool swap = e0[0] < e1[0];
+			const uint32_t high = uint32_t( swap ? e1[0] : e0[0] ), low = uint32_t( swap ? e0[0] : e1[0] );
+			uint8_t codes[16];
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				const uint32_t step = swap ? 7 - indices[i] : indices[i];
+				codes[i] = uint8_t( high == low || step == 0 ? 0 : step == 7 ? 1 : step + 1 );
+			}
+			WriteChannelBlock( high, low, codes, block );
+			if ( !effort.extra_modes )
+				return;
+
+			// six steps between the values that aren't 0 or 255, picked exactly, there are only eight choices
+			uint32_t inner_low = 255, inner_high = 0;
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				const uint32_t value = texels[i * 4 + channel];
+				if ( value != 0 && value != 255 )
+				{
+					inner_low = value < inner_low ? value : inner_low;
+					inner_high = value > inner_high ? value : inner_high;
+				}
+			}
+			if ( inner_low > inner_high )
+				inner_low = inner_high = 0;
+			uint32_t palette[8] = { inner_low, inner_high };
+			for ( uint32_t k = 1; k < 5; ++k )
+				palette[k + 1] = ( ( 5 - k ) * inner_low + k * inner_high ) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				const int value = texels[i * 4 + channel];
+				uint32_t best = 0;
+				int best_error = 1 << 30;
+				for ( uint32_t code = 0; code < 8; ++code )
+				{
+					const int d = int( palette[code] ) - value;
+					if ( d * d < best_error )
+					{
+						best_error = d * d;
+						best = code;
+					}
+				}
+				codes[i] = uint8_t( best );
+			}
+			uint8_t six_step[8];
+			WriteChannelBlock( inner_low, inner_high, codes, six_step );
+			if ( ChannelError( six_step, texels, channel ) < ChannelError( block, texels, channel ) )
+				std::memcpy( block, six_step, 8 );
+		}
+
+		// ---- BC7 modes 5 and 6
+
+		uint32_t Interpolate( uint32_t e0, uint32_t e1, uint32_t weight )
+		{
+			return ( ( 64 - weight ) * e0 + weight * e1 + 32 ) >> 6;
+		}
+
+		// 7 bits and a p bit shared by the channels of an endpoint, the p bit that lands closer
+		void QuantizeMode6Endpoint( float* endpoint, uint32_t* quantized, uint32_t& p_bit )
+		{
+			float best_error = 1e30f;
+			for ( uint32_t p = 0; p < 2; ++p )
+			{
+				uint32_t q[4];
+				float error = 0.0f;
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					const float value = ( endpoint[c] - float( p ) ) / 2.0f;
+					q[c] = value <= 0.0f ? 0 : value >= 127.0f ? 127 : Round( value );
+					const float d = float( q[c] * 2 + p ) - endpoint[c];
+					error += d * d;
+				}
+				if ( error < best_error )
+				{
+					best_error = error;
+					p_bit = p;
+					std::memcpy( quantized, q, sizeof( q ) );
+				}
+			}
+			for ( uint32_t c = 0; c < 4; ++c )
+				endpoint[c] = float( quantized[c] * 2 + p_bit );
+		}
+
+		void EncodeMode6( const uint8_t ( &texels )[64], const Effort& effort, uint8_t* block )
+		{
+			Points points;
+			GatherPoints( texels, 0, 4, nullptr, points );
+			float e0[4], e1[4];
+			uint8_t indices[16];
+			uint32_t q0[4], q1[4], p0 = 0, p1 = 0;
+			FitAndQuantize( points, effort, 16, bc7_weights4, [ & ] ( float* a, float* b )
+			{
+				QuantizeMode6Endpoint( a, q0, p0 );
+				QuantizeMode6Endpoint( b, q1, p1 );
+			}, e0, e1, indices );
+			// the fit quantized the endpoints it kept last, which may not be the ones it kept
+			QuantizeMode6Endpoint( e0, q0, p0 );
+			QuantizeMode6Endpoint( e1, q1, p1 );
+
+			// the index of texel 0 drops its top bit, it has to be in the lower half
+			if ( indices[0] >= 8 )
+			{
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					const uint32_t q = q0[c];
+					q0[c] = q1[c];
+					q1[c] = q;
+				}
+				const uint32_t p = p0;
+				p0 = p1;
+				p1 = p;
+				for ( uint32_t i = 0; i < 16; ++i )
+					indices[i] = uint8_t( 15 - indices[i] );
+			}
+
+			Bits bits = {};
+			bits.Put( 1 << 6, 7 );
+			for ( uint32_t c = 0; c < 4; ++c )
+			{
+				bits.Put( q0[c], 7 );
+				bits.Put( q1[c], 7 );
+			}
+			bits.Put( p0, 1 );
+			bits.Put( p1, 1 );
+			for ( uint32_t i = 0; i < 16; ++i )
+				bits.Put( indices[i], i ? 4 : 3 );
+			std::memcpy( block, bits.words, 16 );
+		}
+
+		uint32_t Quantize7( float value )
+		{
+			// the 7 bit value whose expansion ( q << 1 ) | ( q >> 6 ) is nearest
+			uint32_t q = Round( value / 2.0f );
+			q = q > 127 ? 127 : q;
+			float best = std::fabs( float( ( q << 1 ) | ( q >> 6 ) ) - value );
+			const uint32_t candidates[2] = { q ? q - 1 : q, q < 127 ? q + 1 : q };
+			for ( uint32_t candidate : candidates )
+			{
+				const float error = std::fabs( float( ( candidate << 1 ) | ( candidate >> 6 ) ) - value );
+				if ( error < best )
+				{
+					best = error;
+					q = candidate;
+				}
+			}
+			return q;
+		}
+
+		void QuantizeMode5Color( float* e0, float* e1 )
+		{
+			for ( uint32_t c = 0; c < 3; ++c )
+			{
+				const uint32_t q0 = Quantize7( e0[c] ), q1 = Quantize7( e1[c] );
+				e0[c] = float( ( q0 << 1 ) | ( q0 >> 6 ) );
+				e1[c] = float( ( q1 << 1 ) | ( q1 >> 6 ) );
+			}
+		}
+
+		// color and alpha fitted on their own, rotation swaps alpha with red, green or blue first so the
+		// channel that varies most on its own gets its own indices
+		void EncodeMode5( const uint8_t ( &texels )[64], uint32_t rotation, const Effort& effort, uint8_t* block )
+		{
+			uint8_t rotated[64];
+			std::memcpy( rotated, texels, sizeof( rotated ) );
+			if ( rotation )
+			{
+				for ( uint32_t i = 0; i < 16; ++i )
+				{
+					const uint8_t value = rotated[i * 4 + rotation - 1];
+					rotated[i * 4 + rotation - 1] = rotated[i * 4 + 3];
+					rotated[i * 4 + 3] = value;
+				}
+			}
+
+			Points color, alpha;
+			GatherPoints( rotated, 0, 3, nullptr, color );
+			GatherPoints( rotated, 3, 1, nullptr, alpha );
+			float c0[4], c1[4], a0[4], a1[4];
+			uint8_t color_indices[16], alpha_indices[16];
+			FitAndQuantize( color, effort, 4, bc7_weights2, QuantizeMode5Color, c0, c1, color_indices );
+			FitAndQuantize( alpha, effort, 4, bc7_weights2, QuantizeByte, a0, a1, alpha_indices );
+
+			uint32_t q0[3], q1[3];
+			for ( uint32_t c = 0; c < 3; ++c )
+			{
+				q0[c] = Quantize7( c0[c] );
+				q1[c] = Quantize7( c1[c] );
+			}
+			uint32_t alpha0 = Round( a0[0] ), alpha1 = Round( a1[0] );
+			if ( color_indices[0] >= 2 )
+			{
+				for ( uint32_t c = 0; c < 3; ++c )
+				{
+					const uint32_t q = q0[c];
+					q0[c] = q1[c];
+					q1[c] = q;
+				}
+				for ( uint32_t i = 0; i < 16; ++i )
+					color_indices[i] = uint8_t( 3 - color_indices[i] );
+			}
+			if ( alpha_indices[0] >= 2 )
+			{
+				const uint32_t a = alpha0;
+				alpha0 = alpha1;
+				alpha1 = a;
+				for ( uint32_t i = 0; i < 16; ++i )
+					alpha_indices[i] = uint8_t( 3 - alpha_indices[i] );
+			}
+
+			Bits bits = {};
+			bits.Put( 1 << 5, 6 );
+			bits.Put( rotation, 2 );
+			for ( uint32_t c = 0; c < 3; ++c )
+			{
+				bits.Put( q0[c], 7 );
+				bits.Put( q1[c], 7 );
+			}
+			bits.Put( alpha0, 8 );
+			bits.Put( alpha1, 8 );
+			for ( uint32_t i = 0; i < 16; ++i )
+				bits.Put( color_indices[i], i ? 2 : 1 );
+			for ( uint32_t i = 0; i < 16; ++i )
+				bits.Put( alpha_indices[i], i ? 2 : 1 );
+			std::memcpy( block, bits.words, 16 );
+		}
+
+		// modes 5 and 6, anything else comes out as 0 like the reserved mode does on the gpu
+		void DecodeBc7Block( const uint8_t* block, uint8_t ( &texels )[64] )
+		{
+			Bits bits = {};
+			std::memcpy( bits.words, block, 16 );
+			uint32_t mode = 0;
+			while ( mode < 8 && !bits.Get( 1 ) )
+				++mode;
+
+			if ( mode == 6 )
+			{
+				uint32_t e[2][4];
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					e[0][c] = bits.Get( 7 ) << 1;
+					e[1][c] = bits.Get( 7 ) << 1;
+				}
+				const uint32_t p0 = bits.Get( 1 ), p1 = bits.Get( 1 );
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					e[0][c] |= p0;
+					e[1][c] |= p1;
+				}
+				for ( uint32_t i = 0; i < 16; ++i )
+				{
+					const uint32_t weight = bc7_weights4[bits.Get( i ? 4 : 3 )];
+					for ( uint32_t c = 0; c < 4; ++c )
+						texels[i * 4 + c] = uint8_t( Interpolate( e[0][c], e[1][c], weight ) );
+				}
+				return;
+			}
+			if ( mode == 5 )
+			{
+				const uint32_t rotation = bits.Get( 2 );
+				uint32_t e[2][4];
+				for ( uint32_t c = 0; c < 3; ++c )
+				{
+					const uint32_t q0 = bits.Get( 7 ), q1 = bits.Get( 7 );
+					e[0][c] = ( q0 << 1 ) | ( q0 >> 6 );
+					e[1][c] = ( q1 << 1 ) | ( q1 >> 6 );
+				}
+				e[0][3] = bits.Get( 8 );
+				e[1][3] = bits.Get( 8 );
+				uint32_t color_weights[16];
+				for ( uint32_t i = 0; i < 16; ++i )
+					color_weights[i] = bc7_weights2[bits.Get( i ? 2 : 1 )];
+				for ( uint32_t i = 0; i < 16; ++i )
+				{
+					const uint32_t alpha_weight = bc7_weights2[bits.Get( i ? 2 : 1 )];
+					uint8_t* texel = texels + i * 4;
+					for ( uint32_t c = 0; c < 3; ++c )
+						texel[c] = uint8_t( Interpolate( e[0][c], e[1][c], color_weights[i] ) );
+					texel[3] = uint8_t( Interpolate( e[0][3], e[1][3], alpha_weight ) );
+					if ( rotation )
+					{
+						const uint8_t value = texel[rotation - 1];
+						texel[rotation - 1] = texel[3];
+						texel[3] = value;
+					}
+				}
+				return;
+			}
+			std::memset( texels, 0, sizeof( texels ) );
+		}
+
+		uint32_t BlockError( uint32_t format, const uint8_t* block, const uint8_t ( &texels )[64] )
+		{
+			uint8_t decoded[64];
+			DecodeBcBlock( format, block, decoded );
+			uint32_t error = 0;
+			for ( uint32_t i = 0; i < 64; ++i )
+			{
+				const int d = int( decoded[i] ) - int( texels[i] );
+				error += uint32_t( d * d );
+			}
+			return error;
+		}
+
+		// the 4x4 block at block_x, block_y, texels over the edge repeat the last row and column
+		void LoadBlock( const BcImage& image, uint32_t block_x, uint32_t block_y, uint8_t ( &texels )[64] )
+		{
+			for ( uint32_t y = 0; y < 4; ++y )
+			{
+				const uint32_t image_y = block_y * 4 + y < image.height ? block_y * 4 + y : image.height - 1;
+				const uint8_t* row = image.texels + image_y * image.row_pitch;
+				if ( block_x * 4 + 4 <= image.width )
+				{
+					std::memcpy( texels + y * 16, row + block_x * 16, 16 );
+					continue;
+				}
+				for ( uint32_t x = 0; x < 4; ++x )
+				{
+					const uint32_t image_x = block_x * 4 + x < image.width ? block_x * 4 + x : image.width - 1;
+					std::memcpy( texels + y * 16 + x * 4, row + image_x * 4, 4 );
+				}
+			}
+		}
+	}
+
+	bool IsBcEncoderFormat( uint32_t format )
+	{
+		return BcBlockBytes( format ) != 0;
+	}
+
+	uint32_t BcBlockBytes( uint32_t format )
+	{
+		switch ( format )
+		{
+		case format_bc1:
+		case format_bc1_srgb:
+		case format_bc4:
+			return 8;
+		case format_bc3:
+		case format_bc3_srgb:
+		case format_bc5:
+		case format_bc7:
+		case format_bc7_srgb:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	void EncodeBcBlock( uint32_t format, const uint8_t ( &texels )[64], uint8_t* block, BcQuality quality )
+	{
+		const Effort effort = EffortOf( quality );
+		switch ( format )
+		{
+		case format_bc1:
+		case format_bc1_srgb:
+		{
+			// any texel under half alpha needs the three color block with transparent black
+			bool transparent = false;
+			for ( uint32_t i = 0; i < 16; ++i )
+				transparent |= texels[i * 4 + 3] < 128;
+			EncodeColorBlock( texels, transparent, effort, block );
+			if ( !transparent && effort.extra_modes )
+			{
+				uint8_t three_color[8];
+				EncodeColorBlock( texels, true, effort, three_color );
+				if ( BlockError( format, three_color, texels ) < BlockError( format, block, texels ) )
+					std::memcpy( block, three_color, 8 );
+			}
+			break;
+		}
+		case format_bc3:
+		case format_bc3_srgb:
+			EncodeChannelBlock( texels, 3, effort, block );
+			EncodeColorBlock( texels, false, effort, block + 8 );
+			break;
+		case format_bc4:
+			EncodeChannelBlock( texels, 0, effort, block );
+			break;
+		case format_bc5:
+			EncodeChannelBlock( texels, 0, effort, block );
+			EncodeChannelBlock( texels, 1, effort, block + 8 );
+			break;
+		case format_bc7:
+		case format_bc7_srgb:
+		{
+			EncodeMode6( texels, effort, block );
+			if ( !effort.extra_modes )
+				break;
+			uint32_t error = BlockError( format, block, texels );
+			for ( uint32_t rotation = 0; rotation < 4 && error; ++rotation )
+			{
+				uint8_t mode5[16];
+				EncodeMode5( texels, rotation, effort, mode5 );
+				const uint32_t mode5_error = BlockError( format, mode5, texels );
+				if ( mode5_error < error )
+				{
+					error = mode5_error;
+					std::memcpy( block, mode5, 16 );
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void DecodeBcBlock( uint32_t format, const uint8_t* block, uint8_t ( &texels )[64] )
+	{
+		switch ( format )
+		{
+		case format_bc1:
+		case format_bc1_srgb:
+			DecodeColorBlock( block, false, texels );
+			break;
+		case format_bc3:
+		case format_bc3_srgb:
+			DecodeColorBlock( block + 8, true, texels );
+			DecodeChannelBlock( block, texels, 3 );
+			break;
+		case format_bc4:
+		case format_bc5:
+			for ( uint32_t i = 0; i < 16; ++i )
+			{
+				texels[i * 4 + 1] = texels[i * 4 + 2] = 0;
+				texels[i * 4 + 3] = 255;
+			}
+			DecodeChannelBlock( block, texels, 0 );
+			if ( format == format_bc5 )
+				DecodeChannelBlock( block + 8, texels, 1 );
+			break;
+		case format_bc7:
+		case format_bc7_srgb:
+			DecodeBc7Block( block, texels );
+			break;
+		default:
+			std::memset( texels, 0, sizeof( texels ) );
+			break;
+		}
+	}
+
+	bool EncodeBcImage( uint32_t format, const BcImage& image, uint8_t* blocks, size_t block_row_pitch, const BcEncodeOptions& options )
+	{
+		const uint32_t block_bytes = BcBlockBytes( format );
+		if ( !block_bytes || !image.width || !image.height )
+			return false;
+
+		const uint32_t blocks_wide = ( image.width + 3 ) / 4;
+		const uint32_t blocks_high = ( image.height + 3 ) / 4;
+		const uint32_t thread_count = options.thread_count < 1 ? 1 : options.thread_count < blocks_high ? options.thread_count : blocks_high;
+		RunOnThreads( thread_count, [ & ] ( uint32_t thread )
+		{
+			const uint32_t first = uint32_t( uint64_t( blocks_high ) * thread / thread_count );
+			const uint32_t end = uint32_t( uint64_t( blocks_high ) * ( thread + 1 ) / thread_count );
+			for ( uint32_t block_y = first; block_y < end; ++block_y )
+			{
+				uint8_t* row = blocks + block_y * block_row_pitch;
+				for ( uint32_t block_x = 0; block_x < blocks_wide; ++block_x )
+				{
+					uint8_t texels[64];
+					LoadBlock( image, block_x, block_y, texels );
+					EncodeBcBlock( format, texels, row + block_x * block_bytes, options.quality );
+				}
+			}
+		} );
+		return true;
+	}
+
+	bool DecodeBcImage( uint32_t format, const uint8_t* blocks, size_t block_row_pitch, uint8_t* texels, uint32_t width, uint32_t height, size_t row_pitch )
+	{
+		const uint32_t block_bytes = BcBlockBytes( format );
+		if ( !block_bytes )
+			return false;
+
+		for ( uint32_t block_y = 0; block_y * 4 < height; ++block_y )
+		{
+			for ( uint32_t block_x = 0; block_x * 4 < width; ++block_x )
+			{
+				uint8_t decoded[64];
+				DecodeBcBlock( format, blocks + block_y * block_row_pitch + block_x * block_bytes, decoded );
+				for ( uint32_t y = 0; y < 4 && block_y * 4 + y < height; ++y )
+				{
+					const uint32_t columns = width - block_x * 4 < 4 ? width - block_x * 4 : 4;
+					std::memcpy( texels + ( block_y * 4 + y ) * row_pitch + block_x * 16, decoded + y * 16, columns * 4 );
+				}
+			}
+		}
+		return true;
+	}
+}
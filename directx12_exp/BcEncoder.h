@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// block compression of rgba8 images for the asset build, so textures ship as BC1, BC3, BC4, BC5 or BC7 without
+// texconv. Every 4x4 block is fitted on its own: endpoints along the principal axis of the block's colors, indices
+// by projecting onto the endpoint line with sse2, four pixels at a time, then least squares refits at the higher
+// qualities. BC7 uses mode 6, and mode 5 with its channel rotations at high quality, which covers opaque and
+// alpha textures without the partition tables. Rows of blocks are shared out between threads. The decoder is the
+// reference the benchmarks measure error against. Formats are DXGI_FORMAT values, no d3d in here
+
+namespace DXLayer
+{
+	enum BcQuality : uint32_t
+	{
+		bc_quality_fast,		// bounding box endpoints, one pass
+		bc_quality_normal,		// principal axis endpoints, one refit
+		bc_quality_high			// more refits and the extra modes of each format
+	};
+
+	struct BcEncodeOptions
+	{
+		BcEncodeOptions( )
+			: quality( bc_quality_normal ), thread_count( 1 )
+		{ }
+
+		BcQuality quality;
+		uint32_t thread_count;		// the calling thread is one of them
+	};
+
+	// BC1, BC3 and BC7 unorm and srgb, BC4 and BC5 unorm. srgb only changes the format, blocks are fitted to the
+	// stored values either way
+	bool IsBcEncoderFormat( uint32_t format );
+
+	// 8 for BC1 and BC4, 16 for the others, 0 for formats the encoder doesn't write
+	uint32_t BcBlockBytes( uint32_t format );
+
+	// rgba8 texels, four bytes each. BC4 keeps red, BC5 red and green
+	struct BcImage
+	{
+		const uint8_t* texels;
+		uint32_t width;
+		uint32_t height;
+		size_t row_pitch;
+	};
+
+	// one block from 16 texels in row order
+	void EncodeBcBlock( uint32_t format, const uint8_t ( &texels )[64], uint8_t* block, BcQuality quality );
+	void DecodeBcBlock( uint32_t format, const uint8_t* block, uint8_t ( &texels )[64] );
+
+	// every block of image into rows of blocks block_row_pitch apart, ( height + 3 ) / 4 of them. Blocks over the
+	// edge repeat the last row and column. False for a format the encoder doesn't write
+	bool EncodeBcImage( uint32_t format, const BcImage& image, uint8_t* blocks, size_t block_row_pitch, const BcEncodeOptions& options = BcEncodeOptions( ) );
+
+	// the other way, into rgba8 texels. Channels a format doesn't store come out as 0, alpha as 255
+	bool DecodeBcImage( uint32_t format, const uint8_t* blocks, size_t block_row_pitch, uint8_t* texels, uint32_t width, uint32_t height, size_t row_pitch );
+}
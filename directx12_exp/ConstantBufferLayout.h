@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "MathTypes.h"
+
+// constant buffer structs declared once in C++ with hlsl packing rules applied at compile time:
+//
+//	// cbuffer PerDraw { float4x4 world; float3 tint; uint object_index; }
+//	struct PerDrawCB : CBufferLayout<hlsl::float4x4, hlsl::float3, hlsl::uint> { enum { world, tint, object_index }; };
+//
+//	CBufferWriter<PerDrawCB> cb( mapped_upload_ptr );
+//	cb.Set<PerDrawCB::tint>( DirectX::XMFLOAT3( 1.0f, 0.5f, 0.5f ) );
+//
+// packing rules (same as fxc):
+//	- a member never straddles a 16-byte register, it is moved to the next register instead
+//	- arrays and matrices always start a new register, every array element is register aligned
+//	- a member following an array or matrix may pack into its last register
+// nested structs are not supported. No d3d in here, so the packing tests below also build in asset_tool, where
+// check-cbuffer-layouts compares more layouts against the offsets fxc reports
+
+namespace DXLayer
+{
+	static const uint32_t cbuffer_placement_alignment = 256;	// D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+
+	namespace hlsl
+	{
+		template<typename CpuType, uint32_t Size, bool StartsRegister>
+		struct Type
+		{
+			typedef CpuType cpu_type;
+			static const uint32_t size = Size;
+			static const bool starts_register = StartsRegister;
+			static_assert( sizeof( CpuType ) == Size, "cpu type size doesn't match the hlsl type" );
+		};
+
+		typedef Type<float, 4, false> float1;
+		typedef Type<DirectX::XMFLOAT2, 8, false> float2;
+		typedef Type<DirectX::XMFLOAT3, 12, false> float3;
+		typedef Type<DirectX::XMFLOAT4, 16, false> float4;
+		typedef Type<uint32_t, 4, false> uint;
+		typedef Type<DirectX::XMUINT2, 8, false> uint2;
+		typedef Type<DirectX::XMUINT3, 12, false> uint3;
+		typedef Type<DirectX::XMUINT4, 16, false> uint4;
+		typedef Type<int32_t, 4, false> int1;
+
+		// hlsl matrices are column_major by default, transpose before writing or declare them row_major in the shader
+		typedef Type<DirectX::XMFLOAT4X4, 64, true> float4x4;
+
+		// each element occupies its own register(s), the last one isn't padded
+		template<typename Element, uint32_t Count>
+		struct Array
+		{
+			static_assert( Count > 0, "empty hlsl array" );
+
+			typedef typename Element::cpu_type cpu_type;
+			static const uint32_t element_stride = ( Element::size + 15 ) & ~15u;
+			static const uint32_t size = element_stride * ( Count - 1 ) + Element::size;
+			static const uint32_t count = Count;
+			static const bool starts_register = true;
+		};
+	}
+
+	namespace detail
+	{
+		constexpr uint32_t AlignRegister( uint32_t offset )
+		{
+			return ( offset + 15 ) & ~15u;
+		}
+
+		constexpr uint32_t PlaceMember( uint32_t offset, uint32_t size, bool starts_register )
+		{
+			return ( starts_register || ( offset % 16 ) + size > 16 ) ? AlignRegister( offset ) : offset;
+		}
+
+		template<uint32_t Start, typename... Members>
+		struct CBufferPack
+		{
+			static const uint32_t end = Start;
+		};
+
+		template<uint32_t Start, typename First, typename... Rest>
+		struct CBufferPack<Start, First, Rest...>
+		{
+			typedef First type;
+			static const uint32_t offset = PlaceMember( Start, First::size, First::starts_register );
+
+			typedef CBufferPack<offset + First::size, Rest...> Next;
+			static const uint32_t end = Next::end;
+		};
+
+		template<typename Pack, uint32_t Index>
+		struct CBufferPackAt
+		{
+			typedef typename CBufferPackAt<typename Pack::Next, Index - 1>::Node Node;
+		};
+
+		template<typename Pack>
+		struct CBufferPackAt<Pack, 0>
+		{
+			typedef Pack Node;
+		};
+	}
+
+	template<typename... Members>
+	struct CBufferLayout
+	{
+		typedef detail::CBufferPack<0, Members...> Pack;
+
+		static const uint32_t num_members = sizeof...( Members );
+
+		// size as seen by the shader (whole registers)
+		static const uint32_t size = detail::AlignRegister( Pack::end );
+
+		// size of a CBV pointing to one instance, cbv addresses must be 256-byte aligned
+		static const uint32_t cbv_size = ( size + cbuffer_placement_alignment - 1 ) & ~( cbuffer_placement_alignment - 1 );
+
+		template<uint32_t Index>
+		struct Member
+		{
+			static_assert( Index < sizeof...( Members ), "cbuffer member index out of range" );
+
+			typedef typename detail::CBufferPackAt<Pack, Index>::Node Node;
+			typedef typename Node::type type;
+			static const uint32_t offset = Node::offset;
+		};
+	};
+
+	// writes members straight into mapped upload memory. Upload heaps are write-combined:
+	// the writer never reads from the destination, and writing members in declaration order
+	// lets the cpu merge them into full cache line writes
+	template<typename Layout>
+	class CBufferWriter
+	{
+	public:
+		explicit CBufferWriter( void* mapped_data )
+			: data( static_cast<uint8_t*>( mapped_data ) )
+		{ }
+
+		template<uint32_t Index>
+		void Set( const typename Layout::template Member<Index>::type::cpu_type& value )
+		{
+			std::memcpy( data + Layout::template Member<Index>::offset, &value, sizeof( value ) );
+		}
+
+		template<uint32_t Index>
+		void SetElement( uint32_t element, const typename Layout::template Member<Index>::type::cpu_type& value )
+		{
+			typedef typename Layout::template Member<Index>::type ArrayType;
+			std::memcpy( data + Layout::template Member<Index>::offset + element * ArrayType::element_stride, &value, sizeof( value ) );
+		}
+
+		template<uint32_t Index>
+		void SetArray( const typename Layout::template Member<Index>::type::cpu_type* values, uint32_t count )
+		{
+			for ( uint32_t i = 0; i < count; ++i )
+				SetElement<Index>( i, values[i] );
+		}
+
+		uint8_t* Data( ) const { return data; }
+
+	private:
+		uint8_t* data;
+	};
+
+	namespace detail
+	{
+		// reference layouts from the hlsl packing rules documentation
+
+		typedef CBufferLayout<hlsl::float4, hlsl::float2, hlsl::float2> PackingTest0;
+		static_assert( PackingTest0::Member<1>::offset == 16 && PackingTest0::Member<2>::offset == 24 && PackingTest0::size == 32, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::float2, hlsl::float4, hlsl::float2> PackingTest1;
+		static_assert( PackingTest1::Member<1>::offset == 16 && PackingTest1::Member<2>::offset == 32 && PackingTest1::size == 48, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::float1, hlsl::float2, hlsl::float3> PackingTest2;
+		static_assert( PackingTest2::Member<1>::offset == 4 && PackingTest2::Member<2>::offset == 16 && PackingTest2::size == 32, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::float3, hlsl::float1, hlsl::float2> PackingTest3;
+		static_assert( PackingTest3::Member<1>::offset == 12 && PackingTest3::Member<2>::offset == 16, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::Array<hlsl::float1, 4>, hlsl::float2> PackingTest4;
+		static_assert( PackingTest4::Member<0>::type::size == 52 && PackingTest4::Member<1>::offset == 52 && PackingTest4::size == 64, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::float1, hlsl::Array<hlsl::float2, 2>, hlsl::float1> PackingTest5;
+		static_assert( PackingTest5::Member<1>::offset == 16 && PackingTest5::Member<2>::offset == 40, "hlsl packing" );
+
+		typedef CBufferLayout<hlsl::float2, hlsl::float4x4, hlsl::float1> PackingTest6;
+		static_assert( PackingTest6::Member<1>::offset == 16 && PackingTest6::Member<2>::offset == 80 && PackingTest6::size == 96 && PackingTest6::cbv_size == 256, "hlsl packing" );
+	}
+}
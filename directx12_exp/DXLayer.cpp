@@ -6,6 +6,27 @@
 #include <DirectXMath.h>
 #include "d3dx12.h"
 
+#include <cstring>
+#include <cwchar>
+#include <string>
+
+#include "AssetStreamer.h"
+#include "FrameUploadBuffer.h"
+#include "GeometryPool.h"
+#include "GeometryPoolBuffers.h"
+#include "IndexPacking.h"
+#include "LodSelector.h"
+#include "MeshAsset.h"
+#include "MeshSimplifier.h"
+#include "PerDrawParameter.h"
+#include "PipelineStateRegistry.h"
+#include "ReadbackBuffer.h"
+#include "RootSignatureCache.h"
+#include "ShaderConstants.h"
+#include "ShaderWatcher.h"
+#include "StreamUploadBuffer.h"
+#include "VertexFormats.h"
+
 namespace DXLayer
 {
 	static const int framebuffer_count = 3;
@@ -45,22 +66,81 @@ namespace DXLayer
 		DirectX::XMFLOAT4 color;
 	};
 
-	ID3D12PipelineState* pipeline_state_object; // pso containing a pipeline state
+	MeshBounds simple_quads_bounds; // quad vertices are stored relative to these bounds
+
+	ShaderWatcher shader_watcher( CompileShaderFromFile, GetFileWriteTime, ScanShaderIncludes ); // compiles shaders and recompiles them on file changes
+
+	PipelineStateRegistry pso_registry; // owns psos and rebuilds them when their shaders change
+
+	UINT simple_quad_pso; // pso used to draw the quads, an index into pso_registry
+
+	ID3D12RootSignature* root_signature; // root signature defines data shaders will access, owned by root_signature_cache
+
+	RootSignatureCache root_signature_cache; // deduplicates root signatures and keeps their serialized blobs between runs
+
+	PerDrawParameter<PerDrawLayout> per_draw_parameter; // object index, material index and tint of a draw call
+
+	FrameUploadBuffer frame_upload_buffer; // per-frame constants that don't fit into root constants
 
-	ID3D12RootSignature* root_signature; // root signature defines data shaders will access
+	ReadbackBuffer readback_buffer; // copies passes make for the cpu, delivered frames later without waiting on the gpu
+
+	ID3D12QueryHeap* pipeline_statistics_heap; // a pipeline statistics query per frame in flight, around the scene's draws
+
+	D3D12_QUERY_DATA_PIPELINE_STATISTICS scene_statistics; // what the gpu did for the scene draws, read back a few frames late
+
+	HWND window; // its title shows scene_statistics
+
+	std::wstring window_title; // the title the window was created with
 
 	D3D12_VIEWPORT viewport; // area that output from rasterizer will be stretched to.
 
 	D3D12_RECT scissor_rect; // the area to draw in. pixels outside that area will not be drawn onto
 
-	ID3D12Resource* vertex_buffer; // a default buffer in GPU memory that we will load vertex data for our triangle into
+	GeometryPool geometry_pool; // ranges of the shared vertex and index buffers every static mesh lives in
+
+	GeometryPoolBuffers geometry_pool_buffers; // the buffers themselves, bound once for all static meshes
+
+	const uint32_t geometry_pool_vertices = 1 << 20; // pool capacity, streamed meshes that don't fit aren't drawn
+
+	const uint32_t geometry_pool_indices = 3 << 20;
+
+	const uint32_t geometry_pool_index_size = 2; // streamed meshes are converted to this on the decode threads
 
-	D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view; // a structure containing a pointer to the vertex data in gpu memory
-												 // the total size of the buffer, and the size of each element (vertex)
+	const UINT64 geometry_pool_move_budget = 1 << 20; // bytes of defragmentation copies per frame, also the scratch buffer size
 
-	ID3D12Resource* index_buffer; // a default buffer in GPU memory that we will load index data for our triangle into
+	std::vector<GeometryMove> geometry_moves; // this frame's defragmentation copies, kept to reuse its memory
 
-	D3D12_INDEX_BUFFER_VIEW index_buffer_view; // a structure holding information about the index buffer
+	uint32_t simple_quad_geometry; // the quad mesh in geometry_pool
+
+	std::vector<IndexChunk> simple_quad_chunks; // draw calls of the quad index buffer, one unless it had to be split for 16-bit indices
+
+	std::vector<MeshLod> simple_quad_lods; // index ranges of the quad lod chain, all lods share the index buffer
+
+	uint32_t simple_quad_current_lod[2] = { }; // lod each quad drew with last frame, for the selection hysteresis
+
+	const char* simple_quads_path = "simple_quads.mesh"; // optional mesh asset drawn instead of the built-in quads once it streamed in
+
+	bool simple_quads_from_file; // a loaded mesh has no second quad at vertex 4, it's drawn once
+
+	StreamUploadBuffer stream_upload_buffer; // decode threads write meshes straight into it, the pool copies from there. Outlives asset_streamer's results
+
+	const UINT64 stream_upload_size = 32 << 20; // a few frames of upload budget, decode threads wait when it's full
+
+	AssetStreamer asset_streamer; // reads and decodes mesh assets in the background, the first frame doesn't wait for them
+
+	PackFile asset_pack; // assets.pack when it's there, the streamer looks for paths in it before loose files
+
+	const char* asset_pack_path = "assets.pack";
+
+	const uint32_t asset_streamer_io_threads = 2;
+
+	const uint32_t asset_streamer_decode_threads = 2;
+
+	const size_t asset_streamer_upload_budget = 8 << 20; // bytes of streamed mesh data copied into upload heaps per frame
+
+	uint32_t simple_quads_request = AssetStreamer::invalid_request; // simple_quads.mesh while it streams in
+
+	std::vector<UploadArenaAllocation> stream_uploads[framebuffer_count]; // upload memory of the meshes copied into the pool while recording each frame
 
 	ID3D12Resource* depth_stencil_buffer; // This is the memory for our depth buffer. it will also be used for a stencil buffer in a later tutorial
 	ID3D12DescriptorHeap* ds_descriptor_heap; // This is a heap for our depth/stencil buffer descriptor
@@ -70,11 +150,9 @@ namespace DXLayer
 
 	namespace
 	{
-		bool InitSimpleQuads( )
+		// the built-in quads as a mesh asset in memory, so they load through the same path as converted meshes
+		void BuildSimpleQuadAsset( std::vector<uint8_t>& file )
 		{
-			HRESULT hr;
-			// Create vertex buffer
-
 			// a quad
 			Vertex v_list[] = {
 				{ -0.5f,  0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f },
@@ -87,93 +165,107 @@ namespace DXLayer
 				{ 0.3f,  0.3f, 0.5f, 1.0f, 0.8f, 0.3f, 1.0f }
 			};
 
-			int v_buffer_size = sizeof( v_list );
+			MeshAssetInfo info = { };
+			info.vertex_format = mesh_vertex_compact;
+			info.vertex_count = _countof( v_list );
+
+			// the gpu gets compact vertices, 12 bytes instead of 28
+			info.bounds = ComputeMeshBounds( &v_list[0].pos.x, sizeof( Vertex ), _countof( v_list ) );
+
+			CompactVertex compact_v_list[_countof( v_list )];
+			EncodePositionsSnorm16( &v_list[0].pos.x, sizeof( Vertex ), _countof( v_list ), info.bounds, compact_v_list[0].pos, sizeof( CompactVertex ) );
+			EncodeColorsUnorm8( &v_list[0].color.x, sizeof( Vertex ), _countof( v_list ), compact_v_list[0].color, sizeof( CompactVertex ) );
 
 			// Create index buffer
-			DWORD i_list[] = {
+			uint32_t i_list[] = {
 				0, 1, 2,
 				0, 3, 1
 			};
 
-			int i_buffer_size = sizeof( i_list );
-
-			// create default heap
-			// default heap is memory on the GPU. Only the GPU has access to this memory
-			// To get data into this heap, we will have to upload the data using
-			// an upload heap
-			device->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ), // a default heap
-				D3D12_HEAP_FLAG_NONE, // no flags
-				&CD3DX12_RESOURCE_DESC::Buffer( v_buffer_size ), // resource description for a buffer
-				D3D12_RESOURCE_STATE_COPY_DEST, // we will start this heap in the copy destination state since we will copy data
-												// from the upload heap to this heap
-				nullptr, // optimized clear value must be null for this type of resource. used for render targets and depth/stencil buffers
-				IID_PPV_ARGS( &vertex_buffer ) );
-
-			// we can give resource heaps a name so when we debug with the graphics debugger we know what resource we are looking at
-			vertex_buffer->SetName( L"Vertex Buffer Resource Heap" );
-
-			// create upload heap
-			// upload heaps are used to upload data to the GPU. CPU can write to it, GPU can read from it
-			// We will upload the vertex buffer using this heap to the default heap
-			ID3D12Resource* v_buffer_upload_heap;
-			device->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), // upload heap
-				D3D12_HEAP_FLAG_NONE, // no flags
-				&CD3DX12_RESOURCE_DESC::Buffer( v_buffer_size ), // resource description for a buffer
-				D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-				nullptr,
-				IID_PPV_ARGS( &v_buffer_upload_heap ) );
-			v_buffer_upload_heap->SetName( L"Vertex Buffer Upload Resource Heap" );
-
-			// store vertex buffer in upload heap
-			D3D12_SUBRESOURCE_DATA vertex_data = { };
-			vertex_data.pData = reinterpret_cast<BYTE*>( v_list ); // pointer to our vertex array
-			vertex_data.RowPitch = v_buffer_size; // size of all our triangle vertex data
-			vertex_data.SlicePitch = v_buffer_size; // also the size of our triangle vertex data
-
-			// we are now creating a command with the command list to copy the data from
-			// the upload heap to the default heap
-			UpdateSubresources( command_list, vertex_buffer, v_buffer_upload_heap, 0, 0, 1, &vertex_data );
-
-			// transition the vertex buffer data from copy destination state to vertex buffer state
-			command_list->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( vertex_buffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER ) );
-
-			// create default heap to hold index buffer
-			device->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ), // a default heap
-				D3D12_HEAP_FLAG_NONE, // no flags
-				&CD3DX12_RESOURCE_DESC::Buffer( i_buffer_size ), // resource description for a buffer
-				D3D12_RESOURCE_STATE_COPY_DEST, // start in the copy destination state
-				nullptr, // optimized clear value must be null for this type of resource
-				IID_PPV_ARGS( &index_buffer ) );
-
-			// we can give resource heaps a name so when we debug with the graphics debugger we know what resource we are looking at
-			index_buffer->SetName( L"Index Buffer Resource Heap" );
-
-			// create upload heap to upload index buffer
-			ID3D12Resource* i_buffer_upload_heap;
-			device->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), // upload heap
-				D3D12_HEAP_FLAG_NONE, // no flags
-				&CD3DX12_RESOURCE_DESC::Buffer( i_buffer_size ), // resource description for a buffer
-				D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-				nullptr,
-				IID_PPV_ARGS( &i_buffer_upload_heap ) );
-			i_buffer_upload_heap->SetName( L"Index Buffer Upload Resource Heap" );
-
-			// store index buffer in upload heap
-			D3D12_SUBRESOURCE_DATA index_data = { };
-			index_data.pData = reinterpret_cast<BYTE*>( i_list ); // pointer to our index array
-			index_data.RowPitch = i_buffer_size; // size of all our index buffer
-			index_data.SlicePitch = i_buffer_size; // also the size of our index buffer
-
-			// we are now creating a command with the command list to copy the data from
-			// the upload heap to the default heap
-			UpdateSubresources( command_list, index_buffer, i_buffer_upload_heap, 0, 0, 1, &index_data );
-
-			// transition the vertex buffer data from copy destination state to vertex buffer state
-			command_list->ResourceBarrier( 1, &CD3DX12_RESOURCE_BARRIER::Transition( index_buffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER ) );
+			// every lod goes into the same index buffer, a lod is just a range of it. Two triangles are already
+			// below the minimum lod size, so this stays a single lod until the quads become real meshes
+			std::vector<uint32_t> lod_indices;
+			std::vector<MeshLod> lods;
+			BuildLodChain( i_list, _countof( i_list ), &v_list[0].pos.x, sizeof( Vertex ), _countof( v_list ), lod_indices, lods );
+
+			// 16-bit indices whenever the vertex range allows it, big meshes get split into several draws
+			PackedIndices packed_indices;
+			PackIndices( lod_indices.data( ), lod_indices.size( ), packed_indices );
+			info.index_size = packed_indices.index_size;
+			info.index_count = uint32_t( lod_indices.size( ) );
+
+			MeshAssetWriter writer;
+			writer.AddSection( mesh_section_info, sizeof( info ), &info, sizeof( info ) );
+			writer.AddSection( mesh_section_vertices, sizeof( CompactVertex ), compact_v_list, sizeof( compact_v_list ) );
+			writer.AddSection( mesh_section_indices, packed_indices.index_size, packed_indices.data.data( ), packed_indices.data.size( ) );
+			writer.AddSection( mesh_section_index_chunks, packed_indices.chunks );
+			writer.AddSection( mesh_section_lods, lods );
+			writer.Build( file );
+		}
+
+		// runs on a decode thread, the mesh goes into stream_upload_buffer with the indices in the pool's format
+		std::unique_ptr<StreamedAsset> DecodePoolMesh( const uint8_t* data, size_t size, std::string& error )
+		{
+			return DecodeStreamedMesh( data, size, stream_upload_buffer.Arena( ), geometry_pool_index_size, error );
+		}
+
+		// records the copies of a decoded mesh from stream_upload_buffer into a new range of the geometry pool. The decode
+		// threads already wrote it there, nothing is copied on the cpu. Its upload memory stays with the frame until
+		// the command list ran
+		bool UploadMesh( StreamedMesh& mesh, uint32_t& geometry )
+		{
+			// the static scene shares one vertex and one index buffer, the mesh is a range of each
+			geometry = geometry_pool.Allocate( mesh.info.vertex_count, mesh.info.index_count );
+			if ( geometry == GeometryPool::invalid_geometry )
+			{
+				return false;
+			}
+
+			// copy the data from the upload heap into the pool's ranges, the buffers end up in the vertex and index buffer states
+			const UINT64 upload_offset = mesh.upload.Offset( );
+			geometry_pool_buffers.Upload( command_list, geometry_pool.Range( geometry ), stream_upload_buffer.Resource( ), upload_offset, upload_offset + mesh.index_offset );
+			stream_uploads[frame_index].push_back( std::move( mesh.upload ) );
+			return true;
+		}
+
+		// draw data is small and gets copied
+		void SetSimpleQuadMesh( const StreamedMesh& mesh )
+		{
+			simple_quads_bounds = mesh.info.bounds;
+			simple_quad_chunks = mesh.chunks;
+			simple_quad_lods = mesh.lods;
+			simple_quad_current_lod[0] = 0;
+			simple_quad_current_lod[1] = 0;
+		}
+
+		// the built-in quads go up right away, so the first frame has something to draw. A mesh converted with
+		// asset_tool convert replaces them once it streamed in
+		bool InitSimpleQuads( )
+		{
+			HRESULT hr;
+
+			static_assert( sizeof( CompactVertex ) == 12, "CompactVertex has to match mesh_vertex_compact" );
+
+			// fixed capacity, growing would mean new buffers and copying everything over
+			geometry_pool.Init( geometry_pool_vertices, CompactVertexInputLayout::stride, geometry_pool_indices, geometry_pool_index_size );
+			if ( !geometry_pool_buffers.Init( device, geometry_pool, geometry_pool_move_budget ) )
+			{
+				return false;
+			}
+			if ( !stream_upload_buffer.Init( device, stream_upload_size, L"Stream Upload Buffer" ) )
+			{
+				return false;
+			}
+
+			std::vector<uint8_t> built_in;
+			BuildSimpleQuadAsset( built_in );
+			std::string error;
+			std::unique_ptr<StreamedAsset> mesh = DecodePoolMesh( built_in.data( ), built_in.size( ), error );
+			if ( !mesh || !UploadMesh( static_cast<StreamedMesh&>( *mesh ), simple_quad_geometry ) )
+			{
+				return false;
+			}
+			SetSimpleQuadMesh( static_cast<const StreamedMesh&>( *mesh ) );
 
 			// Now we execute the command list to upload the initial assets (triangle data)
 			command_list->Close( );
@@ -188,19 +280,69 @@ namespace DXLayer
 				return false;
 			}
 
-			// create a vertex buffer view for the triangle. We get the GPU memory address to the vertex pointer using the GetGPUVirtualAddress() method
-			vertex_buffer_view.BufferLocation = vertex_buffer->GetGPUVirtualAddress( );
-			vertex_buffer_view.StrideInBytes = sizeof( Vertex );
-			vertex_buffer_view.SizeInBytes = v_buffer_size;
+			// a missing pack isn't an error, everything can come from loose files
+			if ( asset_pack.Open( asset_pack_path, error ) )
+				asset_streamer.MountPack( &asset_pack );
 
-			// create a index buffer view for the triangle. We get the GPU memory address to the vertex pointer using the GetGPUVirtualAddress() method
-			index_buffer_view.BufferLocation = index_buffer->GetGPUVirtualAddress( );
-			index_buffer_view.Format = DXGI_FORMAT_R32_UINT; // 32-bit unsigned integer (this is what a dword is, double word, a word is 2 bytes)
-			index_buffer_view.SizeInBytes = i_buffer_size;
+			// the mesh replaces what's in the middle of the screen, nothing is more urgent
+			asset_streamer.Start( asset_streamer_io_threads, asset_streamer_decode_threads );
+			if ( asset_streamer.Contains( simple_quads_path ) )
+				simple_quads_request = asset_streamer.Request( simple_quads_path, DecodePoolMesh, StreamingPriority( 0.0f, 1.0f, true ) );
 
 			return true;
 		}
 
+		// takes the meshes the asset streamer finished, within the frame's upload budget, and records their copies into
+		// the geometry pool. Their upload memory stays with the frame until it comes around again, the rest is freed here
+		void UploadStreamedMeshes( )
+		{
+			std::vector<StreamResult> results;
+			asset_streamer.TakeCompleted( asset_streamer_upload_budget, results );
+			for ( auto& result : results )
+			{
+				if ( result.request != simple_quads_request )
+					continue;
+				simple_quads_request = AssetStreamer::invalid_request;
+
+				// it has to use the vertex format the quad pso was built for
+				StreamedMesh* mesh = static_cast<StreamedMesh*>( result.asset.get( ) );
+				if ( !mesh || mesh->info.vertex_format != mesh_vertex_compact )
+				{
+					OutputDebugStringA( mesh ? "simple_quads.mesh doesn't use compact vertices\n" : ( result.error + "\n" ).c_str( ) );
+					continue;
+				}
+
+				uint32_t geometry;
+				if ( !UploadMesh( *mesh, geometry ) )
+				{
+					OutputDebugStringA( "simple_quads.mesh doesn't fit into the geometry pool\n" );
+					continue;
+				}
+
+				// frames in flight drew from the built-in quads' ranges before this frame's copies can land there
+				geometry_pool.Free( simple_quad_geometry );
+				simple_quad_geometry = geometry;
+				SetSimpleQuadMesh( *mesh );
+				simple_quads_from_file = true;
+			}
+		}
+
+		// draws one lod of the quad index buffer, split up where the 16-bit packing split the buffer.
+		// Everything is relative to the quad mesh's ranges in the geometry pool
+		void DrawSimpleQuadLod( const MeshLod& lod, int32_t base_vertex )
+		{
+			const GeometryRange& range = geometry_pool.Range( simple_quad_geometry );
+			const uint32_t lod_end = lod.first_index + lod.index_count;
+			for ( const auto& chunk : simple_quad_chunks )
+			{
+				const uint32_t chunk_end = chunk.first_index + chunk.index_count;
+				const uint32_t first = chunk.first_index > lod.first_index ? chunk.first_index : lod.first_index;
+				const uint32_t end = chunk_end < lod_end ? chunk_end : lod_end;
+				if ( first < end )
+					command_list->DrawIndexedInstanced( end - first, 1, range.first_index + first, int32_t( range.first_vertex ) + chunk.base_vertex + base_vertex, 0 );
+			}
+		}
+
 		bool DrawSimpleQuad( )
 		{
 			// draw quad
@@ -208,13 +350,58 @@ namespace DXLayer
 			command_list->RSSetViewports( 1, &viewport ); // set the viewports
 			command_list->RSSetScissorRects( 1, &scissor_rect ); // set the scissor rects
 			command_list->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST ); // set the primitive topology
-			command_list->IASetVertexBuffers( 0, 1, &vertex_buffer_view ); // set the vertex buffer (using the vertex buffer view)
-			command_list->IASetIndexBuffer( &index_buffer_view );
-			command_list->DrawIndexedInstanced( 6, 1, 0, 0, 0 ); // finally draw quad
-			command_list->DrawIndexedInstanced( 6, 1, 0, 4, 0 ); // draw second quad
+			geometry_pool_buffers.Bind( command_list ); // one vertex and index buffer for every static mesh
+
+			// per-draw data goes to root constants, no buffer writes needed
+			bool params_set = per_draw_parameter.Set( command_list, frame_upload_buffer, [] ( CBufferWriter<PerDrawLayout>& params )
+			{
+				params.Set<PerDrawLayout::bounds_center>( DirectX::XMFLOAT3( simple_quads_bounds.center ) );
+				params.Set<PerDrawLayout::object_index>( 0 );
+				params.Set<PerDrawLayout::bounds_extent>( DirectX::XMFLOAT3( simple_quads_bounds.extent ) );
+				params.Set<PerDrawLayout::material_index>( 0 );
+				params.Set<PerDrawLayout::tint>( DirectX::XMFLOAT4( 1.0f, 1.0f, 1.0f, 1.0f ) );
+			} );
+			if ( !params_set )
+				return false;
+
+			// the quads are already in clip space, one unit is half the viewport height
+			const float pixels_per_unit = viewport.Height * 0.5f;
+			for ( uint32_t quad = 0; quad < 2; ++quad )
+				simple_quad_current_lod[quad] = SelectLod( simple_quad_lods.data( ), uint32_t( simple_quad_lods.size( ) ), pixels_per_unit, simple_quad_current_lod[quad] );
+
+			DrawSimpleQuadLod( simple_quad_lods[simple_quad_current_lod[0]], 0 ); // finally draw quad
+
+			if ( simple_quads_from_file )
+				return true;
+
+			params_set = per_draw_parameter.Set( command_list, frame_upload_buffer, [] ( CBufferWriter<PerDrawLayout>& params )
+			{
+				params.Set<PerDrawLayout::bounds_center>( DirectX::XMFLOAT3( simple_quads_bounds.center ) );
+				params.Set<PerDrawLayout::object_index>( 1 );
+				params.Set<PerDrawLayout::bounds_extent>( DirectX::XMFLOAT3( simple_quads_bounds.extent ) );
+				params.Set<PerDrawLayout::material_index>( 0 );
+				params.Set<PerDrawLayout::tint>( DirectX::XMFLOAT4( 0.5f, 0.5f, 0.5f, 1.0f ) );
+			} );
+			if ( !params_set )
+				return false;
+			DrawSimpleQuadLod( simple_quad_lods[simple_quad_current_lod[1]], 4 ); // draw second quad, its vertices start at 4
 
 			return true;
 		}
+
+		// a frame's statistics came back, the title only changes when they do
+		void ShowSceneStatistics( const uint8_t* data, uint64_t )
+		{
+			D3D12_QUERY_DATA_PIPELINE_STATISTICS statistics;
+			std::memcpy( &statistics, data, sizeof( statistics ) );
+			if ( statistics.IAPrimitives == scene_statistics.IAPrimitives && statistics.PSInvocations == scene_statistics.PSInvocations )
+				return;
+			scene_statistics = statistics;
+
+			wchar_t title[256];
+			swprintf( title, _countof( title ), L"%ls - %llu triangles, %llu pixels shaded", window_title.c_str( ), statistics.IAPrimitives, statistics.PSInvocations );
+			SetWindowTextW( window, title );
+		}
 	}
 
 	bool InitD3D( HWND window_handle, int width, int height, bool is_fullscreen )
@@ -393,22 +580,21 @@ namespace DXLayer
 
 		// create root signature
 
-		CD3DX12_ROOT_SIGNATURE_DESC root_signature_desc;
-		root_signature_desc.Init( 0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT );
-
-		ID3DBlob* signature;
-		hr = D3D12SerializeRootSignature( &root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr );
-		if ( FAILED( hr ) )
-		{
+		if ( !root_signature_cache.Init( device, L"root_signatures.cache" ) )
 			return false;
-		}
 
-		hr = device->CreateRootSignature( 0, signature->GetBufferPointer( ), signature->GetBufferSize( ), IID_PPV_ARGS( &root_signature ) );
-		if ( FAILED( hr ) )
+		RootSignatureBuilder root_signature_builder( D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT );
+		per_draw_parameter.AddToRootSignature( root_signature_builder, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX );
+
+		root_signature = root_signature_cache.GetOrCreate( root_signature_builder );
+		if ( !root_signature )
 		{
 			return false;
 		}
 
+		// not fatal, we will just serialize again next time
+		root_signature_cache.SaveBlobs( );
+
 		// create vertex and pixel shaders
 
 		// when debugging, we can compile the shader files at runtime.
@@ -418,67 +604,15 @@ namespace DXLayer
 		// shader bytecode, which of course is faster than compiling
 		// them at runtime
 
-		// compile vertex shader
-		ID3DBlob* vertex_shader; // d3d blob for holding vertex shader bytecode
-		ID3DBlob* error_buff; // a buffer holding the error data if any
-		hr = D3DCompileFromFile( L"vertex.hlsl",
-			nullptr,
-			nullptr,
-			"main",
-			"vs_5_0",
-			D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
-			0,
-			&vertex_shader,
-			&error_buff );
-		if ( FAILED( hr ) )
-		{
-			OutputDebugStringA( (char*) error_buff->GetBufferPointer( ) );
+		// shaders are recompiled in the background when their files (or files they include) change,
+		// the psos using them are rebuilt at the start of the next frame
+		UINT vertex_shader = shader_watcher.Add( L"vertex.hlsl", "main", "vs_5_0" );
+		if ( vertex_shader == ShaderWatcher::invalid_shader )
 			return false;
-		}
 
-		// fill out a shader bytecode structure, which is basically just a pointer
-		// to the shader bytecode and the size of the shader bytecode
-		D3D12_SHADER_BYTECODE vertex_shader_bytecode = { };
-		vertex_shader_bytecode.BytecodeLength = vertex_shader->GetBufferSize( );
-		vertex_shader_bytecode.pShaderBytecode = vertex_shader->GetBufferPointer( );
-
-		// compile pixel shader
-		ID3DBlob* pixel_shader;
-		hr = D3DCompileFromFile( L"pixel.hlsl",
-			nullptr,
-			nullptr,
-			"main",
-			"ps_5_0",
-			D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
-			0,
-			&pixel_shader,
-			&error_buff );
-		if ( FAILED( hr ) )
-		{
-			OutputDebugStringA( (char*) error_buff->GetBufferPointer( ) );
+		UINT pixel_shader = shader_watcher.Add( L"pixel.hlsl", "main", "ps_5_0" );
+		if ( pixel_shader == ShaderWatcher::invalid_shader )
 			return false;
-		}
-
-		// fill out shader bytecode structure for pixel shader
-		D3D12_SHADER_BYTECODE pixel_shader_bytecode = { };
-		pixel_shader_bytecode.BytecodeLength = pixel_shader->GetBufferSize( );
-		pixel_shader_bytecode.pShaderBytecode = pixel_shader->GetBufferPointer( );
-
-		// create input layout
-
-		// The input layout is used by the Input Assembler so that it knows
-		// how to read the vertex data bound to it.
-
-		D3D12_INPUT_ELEMENT_DESC input_layout[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-
-		// fill out an input layout description structure
-		D3D12_INPUT_LAYOUT_DESC input_layout_desc = { };
-		input_layout_desc.NumElements = _countof( input_layout );
-		input_layout_desc.pInputElementDescs = input_layout;
 
 		// create a pipeline state object (PSO)
 
@@ -494,10 +628,7 @@ namespace DXLayer
 
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = { }; // a structure to define a pso
 		{
-			pso_desc.InputLayout = input_layout_desc; // the structure describing our input layout
 			pso_desc.pRootSignature = root_signature; // the root signature that describes the input data this pso needs
-			pso_desc.VS = vertex_shader_bytecode; // structure describing where to find the vertex shader bytecode and how large it is
-			pso_desc.PS = pixel_shader_bytecode; // same as VS but for pixel shader
 			pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // type of topology we are drawing
 			pso_desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // format of the render target
 			pso_desc.SampleDesc = sample_desc; // must be the same sample description as the swapchain and depth/stencil buffer
@@ -508,13 +639,38 @@ namespace DXLayer
 			pso_desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC( D3D12_DEFAULT ); // depth and stencil
 		}
 
-		// create the pso
-		hr = device->CreateGraphicsPipelineState( &pso_desc, IID_PPV_ARGS( &pipeline_state_object ) );
-		if ( FAILED( hr ) )
+		// create the pso, VS and PS are filled by the registry from the shader watcher.
+		// The input layout is used by the Input Assembler so that it knows how to read the vertex data bound to it,
+		// its element array is generated from CompactVertex at compile time and its hash keys the pso
+		pso_registry.Init( device, &shader_watcher, framebuffer_count );
+		simple_quad_pso = pso_registry.Add<CompactVertexInputLayout>( pso_desc, vertex_shader, pixel_shader );
+		if ( simple_quad_pso == PipelineStateRegistry::invalid_pso )
 		{
 			return false;
 		}
 
+		shader_watcher.Start( 500 );
+
+		// per-frame constants and the geometry the cpu writes fresh every frame
+		if ( !frame_upload_buffer.Init( device, 4 * 1024 * 1024, framebuffer_count, L"Frame Upload Buffer" ) )
+			return false;
+
+		// the pipeline statistics of the frames in flight are 88 bytes each, the rest is room for other small readbacks.
+		// A screenshot will need a bigger ring
+		if ( !readback_buffer.Init( device, 64 * 1024, L"Readback Buffer" ) )
+			return false;
+
+		D3D12_QUERY_HEAP_DESC query_heap_desc = { };
+		query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+		query_heap_desc.Count = framebuffer_count;
+		hr = device->CreateQueryHeap( &query_heap_desc, IID_PPV_ARGS( &pipeline_statistics_heap ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		window = window_handle;
+		wchar_t title[128];
+		window_title.assign( title, GetWindowTextW( window_handle, title, _countof( title ) ) );
+
 		// Fill out the Viewport
 		viewport.TopLeftX = 0;
 		viewport.TopLeftY = 0;
@@ -579,6 +735,18 @@ namespace DXLayer
 		if ( !WaitForPreviousFrame( ) )
 			return false;
 
+		// the gpu is done with this frame's constants as well
+		frame_upload_buffer.BeginFrame( frame_index );
+
+		// whatever readbacks have come back by now, the rest arrive in later frames
+		readback_buffer.Retire( );
+
+		// and with the upload memory of meshes streamed in the last time this frame was recorded
+		stream_uploads[frame_index].clear( );
+
+		// swap in recompiled shaders, this is the only point where no command list is being recorded
+		pso_registry.BeginFrame( );
+
 		// we can only reset an allocator once the gpu is done with it
 		// resetting an allocator frees the memory that the command list was stored in
 		hr = command_allocator[frame_index]->Reset( );
@@ -595,7 +763,7 @@ namespace DXLayer
 		// but in this tutorial we are only clearing the rtv, and do not actually need
 		// anything but an initial default pipeline, which is what we get by setting
 		// the second parameter to NULL
-		hr = command_list->Reset( command_allocator[frame_index], pipeline_state_object );
+		hr = command_list->Reset( command_allocator[frame_index], pso_registry.Get( simple_quad_pso ) );
 		if ( FAILED( hr ) )
 			return false;
 
@@ -621,10 +789,22 @@ namespace DXLayer
 		command_list->ClearRenderTargetView( rtv_handle, clearColor, 0, nullptr );
 
 		command_list->ClearDepthStencilView( ds_descriptor_heap->GetCPUDescriptorHandleForHeapStart( ), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr );
+
+		// meshes that finished streaming go into the geometry pool, then a bounded step of closing the holes freed
+		// meshes left in it, before anything draws from it
+		UploadStreamedMeshes( );
+		geometry_pool.Defragment( geometry_pool_move_budget, geometry_moves );
+		geometry_pool_buffers.Move( command_list, geometry_moves );
 		
-		// Draw simple green triangle
+		// Draw simple green triangle, counting what the gpu does for it. This frame's query slot is free again, the
+		// gpu is done with the frame that used it last
+		command_list->BeginQuery( pipeline_statistics_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, frame_index );
 		if ( !DrawSimpleQuad( ) )
 			return false;
+		command_list->EndQuery( pipeline_statistics_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, frame_index );
+
+		// skipped when the ring is full, the title keeps the last statistics that came back
+		readback_buffer.ReadQueries( command_list, pipeline_statistics_heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, frame_index, 1, ShowSceneStatistics );
 
 		// transition the "frameIndex" render target from the render target state to the present state. If the debug layer is enabled, you will receive a
 		// warning if present is called on the render target when it's not in the present state
@@ -650,6 +830,10 @@ namespace DXLayer
 		// execute the array of command lists
 		command_queue->ExecuteCommandLists( _countof( command_lists ), command_lists );
 
+		// the readbacks recorded this frame are done once this is
+		if ( !readback_buffer.Submit( command_queue ) )
+			return false;
+
 		// this command goes in at the end of our command queue. we will know when our command queue 
 		// has finished because the fence value will be set to "fenceValue" from the GPU since the command
 		// queue is being executed on the GPU
@@ -684,10 +868,20 @@ namespace DXLayer
 		SAFE_RELEASE( command_queue );
 		SAFE_RELEASE( rtv_descriptor_heap );
 		SAFE_RELEASE( command_list );
-		SAFE_RELEASE( pipeline_state_object );
-		SAFE_RELEASE( root_signature );
-		SAFE_RELEASE( vertex_buffer );
-		SAFE_RELEASE( index_buffer );
+		stream_upload_buffer.Arena( ).Close( ); // decode threads waiting for upload memory give up, so Stop doesn't wait on them
+		asset_streamer.Stop( );
+		asset_pack.Close( );
+		shader_watcher.Stop( );
+		pso_registry.Release( );
+		root_signature_cache.Release( );
+		root_signature = nullptr;
+		geometry_pool_buffers.Release( );
+		for ( auto& uploads : stream_uploads )
+			uploads.clear( );
+		stream_upload_buffer.Release( );
+		frame_upload_buffer.Release( );
+		readback_buffer.Release( );
+		SAFE_RELEASE( pipeline_statistics_heap );
 
 		for ( int i = 0; i < framebuffer_count; ++i )
 		{
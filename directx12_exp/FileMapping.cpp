@@ -0,0 +1,125 @@
+#include "FileMapping.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DXLayer
+{
+#ifdef _WIN32
+	FileMapping::FileMapping( )
+		: data( nullptr ), size( 0 ), file( INVALID_HANDLE_VALUE ), mapping( nullptr )
+	{ }
+
+	bool FileMapping::Open( const char* path )
+	{
+		Close( );
+
+		file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if ( file == INVALID_HANDLE_VALUE )
+			return false;
+
+		LARGE_INTEGER file_size;
+		if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 || UINT64( file_size.QuadPart ) > SIZE_MAX )
+		{
+			Close( );
+			return false;
+		}
+
+		mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if ( !mapping )
+		{
+			Close( );
+			return false;
+		}
+
+		data = static_cast<const uint8_t*>( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+		if ( !data )
+		{
+			Close( );
+			return false;
+		}
+		size = size_t( file_size.QuadPart );
+		return true;
+	}
+
+	void FileMapping::Close( )
+	{
+		if ( data )
+			UnmapViewOfFile( data );
+		if ( mapping )
+			CloseHandle( mapping );
+		if ( file != INVALID_HANDLE_VALUE )
+			CloseHandle( file );
+		data = nullptr;
+		size = 0;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+	}
+
+	bool FileMapping::Exists( const char* path )
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if ( !GetFileAttributesExA( path, GetFileExInfoStandard, &attributes ) )
+			return false;
+		return !( attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) && ( attributes.nFileSizeHigh || attributes.nFileSizeLow );
+	}
+#else
+	FileMapping::FileMapping( )
+		: data( nullptr ), size( 0 ), file( -1 )
+	{ }
+
+	bool FileMapping::Open( const char* path )
+	{
+		Close( );
+
+		file = open( path, O_RDONLY );
+		if ( file < 0 )
+			return false;
+
+		struct stat file_stat;
+		if ( fstat( file, &file_stat ) != 0 || file_stat.st_size <= 0 )
+		{
+			Close( );
+			return false;
+		}
+
+		void* view = mmap( nullptr, size_t( file_stat.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+		if ( view == MAP_FAILED )
+		{
+			Close( );
+			return false;
+		}
+		data = static_cast<const uint8_t*>( view );
+		size = size_t( file_stat.st_size );
+		return true;
+	}
+
+	void FileMapping::Close( )
+	{
+		if ( data )
+			munmap( const_cast<uint8_t*>( data ), size );
+		if ( file >= 0 )
+			close( file );
+		data = nullptr;
+		size = 0;
+		file = -1;
+	}
+
+	bool FileMapping::Exists( const char* path )
+	{
+		struct stat file_stat;
+		return stat( path, &file_stat ) == 0 && S_ISREG( file_stat.st_mode ) && file_stat.st_size > 0;
+	}
+#endif
+
+	FileMapping::~FileMapping( )
+	{
+		Close( );
+	}
+}
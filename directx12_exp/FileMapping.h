@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// read-only view of a whole file. Pages are loaded by the os on first touch, so opening is cheap and
+// reading a section costs only the pages it covers. Uses win32 file mappings on windows and mmap elsewhere,
+// so the asset tools can share loading code with the renderer
+
+namespace DXLayer
+{
+	class FileMapping
+	{
+	public:
+		FileMapping( );
+		~FileMapping( );
+
+		// closes whatever was open before. Empty files fail, they can't be mapped
+		bool Open( const char* path );
+		void Close( );
+
+		// whether Open would find something to map, from the file's attributes alone, without opening or mapping it
+		static bool Exists( const char* path );
+
+		const uint8_t* Data( ) const { return data; }
+		size_t Size( ) const { return size; }
+
+	private:
+		FileMapping( const FileMapping& );
+		FileMapping& operator=( const FileMapping& );
+
+		const uint8_t* data;
+		size_t size;
+#ifdef _WIN32
+		void* file;			// HANDLE, kept out of the header so it doesn't pull in windows.h
+		void* mapping;
+#else
+		int file;
+#endif
+	};
+}
@@ -0,0 +1,75 @@
+#include "FrameAllocator.h"
+
+namespace DXLayer
+{
+	const uint64_t FrameAllocator::invalid_offset;
+
+	FrameAllocator::FrameAllocator( )
+		: size_per_frame( 0 ), frame_count( 1 ), frame_serial( 0 ), frame_begin( 0 ), frame_offset( 0 )
+	{ }
+
+	void FrameAllocator::Init( uint64_t size_per_frame, uint32_t frame_count )
+	{
+		this->size_per_frame = size_per_frame;
+		this->frame_count = frame_count ? frame_count : 1;
+		BeginFrame( 0 );
+	}
+
+	void FrameAllocator::BeginFrame( uint32_t frame_index )
+	{
+		frame_begin = size_per_frame * ( frame_index % frame_count );
+		frame_offset.store( 0, std::memory_order_relaxed );
+		++frame_serial;
+	}
+
+	uint64_t FrameAllocator::Allocate( uint64_t size, uint64_t alignment )
+	{
+		// frame regions are not necessarily aligned, so align the absolute offset
+		uint64_t used = frame_offset.load( std::memory_order_relaxed );
+		for ( ;; )
+		{
+			const uint64_t offset = ( frame_begin + used + alignment - 1 ) & ~( alignment - 1 );
+			if ( offset + size > frame_begin + size_per_frame )
+				return invalid_offset;
+			if ( frame_offset.compare_exchange_weak( used, offset + size - frame_begin, std::memory_order_relaxed ) )
+				return offset;
+		}
+	}
+
+	FrameAllocatorCursor::FrameAllocatorCursor( FrameAllocator& allocator, uint64_t chunk_size )
+		: allocator( &allocator ), chunk_size( chunk_size ), cursor( 0 ), end( 0 ), frame_serial( allocator.FrameSerial( ) - 1 )
+	{ }
+
+	uint64_t FrameAllocatorCursor::Allocate( uint64_t size, uint64_t alignment )
+	{
+		if ( frame_serial != allocator->FrameSerial( ) )
+		{
+			frame_serial = allocator->FrameSerial( );
+			cursor = end = 0;
+		}
+
+		const uint64_t offset = ( cursor + alignment - 1 ) & ~( alignment - 1 );
+		if ( end && offset + size <= end )
+		{
+			cursor = offset + size;
+			return offset;
+		}
+
+		// a new chunk, aligned like the allocation so it starts at its beginning
+		const uint64_t chunk = size > chunk_size ? size : chunk_size;
+		const uint64_t chunk_alignment = alignment > 256 ? alignment : 256;
+		uint64_t begin = allocator->Allocate( chunk, chunk_alignment );
+		if ( begin == FrameAllocator::invalid_offset )
+		{
+			// the end of the region may still hold this one allocation
+			begin = allocator->Allocate( size, alignment );
+			if ( begin == FrameAllocator::invalid_offset )
+				return FrameAllocator::invalid_offset;
+			cursor = end = 0;
+			return begin;
+		}
+		cursor = begin + size;
+		end = begin + chunk;
+		return begin;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "Simd.h"
+
+// offsets into a buffer split into a region per frame in flight, handed out linearly within the region of the frame
+// being recorded and all given back when the frame comes around again. Any number of threads can allocate at once,
+// each allocation is one compare and swap, threads writing many small pieces take chunks of the region through a
+// FrameAllocatorCursor and allocate from those without touching shared state. No d3d in here, FrameUploadBuffer
+// puts an upload heap behind it
+
+namespace DXLayer
+{
+	class FrameAllocator
+	{
+	public:
+		static const uint64_t invalid_offset = ~0ull;
+
+		FrameAllocator( );
+
+		void Init( uint64_t size_per_frame, uint32_t frame_count );
+
+		// starts the region of frame_index over, the gpu must be done with it. Not while other threads allocate
+		void BeginFrame( uint32_t frame_index );
+
+		// size bytes at a multiple of alignment, a power of two, from the start of the buffer. invalid_offset when
+		// the frame's region is used up
+		uint64_t Allocate( uint64_t size, uint64_t alignment );
+
+		uint64_t FrameBegin( ) const { return frame_begin; }
+		uint64_t FrameUsed( ) const { return frame_offset.load( std::memory_order_relaxed ); }
+		uint64_t SizePerFrame( ) const { return size_per_frame; }
+		uint32_t FrameSerial( ) const { return frame_serial; }		// counts BeginFrame calls
+
+	private:
+		uint64_t size_per_frame;
+		uint32_t frame_count;
+		uint32_t frame_serial;
+		uint64_t frame_begin;
+		std::atomic<uint64_t> frame_offset;		// relative to frame_begin
+	};
+
+	// one thread's allocations out of chunks it takes from a FrameAllocator, chunk_size bytes at a time or a whole
+	// allocation larger than that. A cursor left over from an earlier frame notices and starts over. The rest of a
+	// chunk that runs out is wasted
+	class FrameAllocatorCursor
+	{
+	public:
+		explicit FrameAllocatorCursor( FrameAllocator& allocator, uint64_t chunk_size = 64 * 1024 );
+
+		uint64_t Allocate( uint64_t size, uint64_t alignment );
+
+	private:
+		FrameAllocator* allocator;
+		uint64_t chunk_size;
+		uint64_t cursor;				// from the start of the buffer
+		uint64_t end;
+		uint32_t frame_serial;
+	};
+
+	// stores a piece the cpu built itself, a vertex or a quad, into upload memory in whole 16 byte blocks with streaming
+	// stores. Into write combined memory they go like plain stores do, into cached upload memory, on integrated gpus,
+	// they skip reading each line before writing it. destination is 16 byte aligned, size a multiple of 16.
+	// StreamFence once the thread is done writing
+	inline void StreamStore( void* destination, const void* source, size_t size )
+	{
+#if DXL_SSE2
+		for ( size_t i = 0; i < size / 16; ++i )
+			_mm_stream_si128( static_cast<__m128i*>( destination ) + i, _mm_loadu_si128( static_cast<const __m128i*>( source ) + i ) );
+#else
+		std::memcpy( destination, source, size );
+#endif
+	}
+
+	inline void StreamFence( )
+	{
+#if DXL_SSE2
+		_mm_sfence( );
+#endif
+	}
+}
@@ -0,0 +1,103 @@
+#include "FrameUploadBuffer.h"
+
+#include "d3dx12.h"
+
+namespace DXLayer
+{
+	FrameUploadBuffer::FrameUploadBuffer( )
+		: buffer( nullptr ), mapped_data( nullptr ), gpu_address( 0 )
+	{ }
+
+	bool FrameUploadBuffer::Init( ID3D12Device* device, UINT64 size_per_frame, UINT num_frames, const wchar_t* name )
+	{
+		allocator.Init( size_per_frame, num_frames );
+
+		HRESULT hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer( size_per_frame * num_frames ),
+			D3D12_RESOURCE_STATE_GENERIC_READ, // the only allowed state for upload heaps
+			nullptr,
+			IID_PPV_ARGS( &buffer ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		if ( name )
+			buffer->SetName( name );
+
+		// we never read from this memory on the cpu
+		CD3DX12_RANGE read_range( 0, 0 );
+		hr = buffer->Map( 0, &read_range, reinterpret_cast<void**>( &mapped_data ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		gpu_address = buffer->GetGPUVirtualAddress( );
+		return true;
+	}
+
+	void FrameUploadBuffer::BeginFrame( UINT frame_index )
+	{
+		allocator.BeginFrame( frame_index );
+	}
+
+	bool FrameUploadBuffer::Allocate( UINT64 size, UINT64 alignment, Allocation& allocation )
+	{
+		// alignment must be a power of two
+		const UINT64 offset = allocator.Allocate( size, alignment );
+		if ( offset == FrameAllocator::invalid_offset )
+			return false;
+
+		allocation.cpu_address = mapped_data + offset;
+		allocation.gpu_address = gpu_address + offset;
+		allocation.offset = offset;
+		return true;
+	}
+
+	bool FrameUploadBuffer::Allocate( FrameAllocatorCursor& cursor, UINT64 size, UINT64 alignment, Allocation& allocation )
+	{
+		const UINT64 offset = cursor.Allocate( size, alignment );
+		if ( offset == FrameAllocator::invalid_offset )
+			return false;
+
+		allocation.cpu_address = mapped_data + offset;
+		allocation.gpu_address = gpu_address + offset;
+		allocation.offset = offset;
+		return true;
+	}
+
+	bool FrameUploadBuffer::AllocateVertices( UINT stride, UINT count, Allocation& allocation, D3D12_VERTEX_BUFFER_VIEW& view, FrameAllocatorCursor* cursor )
+	{
+		// vertex buffer views only need 4 byte alignment, 16 keeps simd stores aligned for the common strides
+		const UINT64 size = UINT64( stride ) * count;
+		if ( !( cursor ? Allocate( *cursor, size, 16, allocation ) : Allocate( size, 16, allocation ) ) )
+			return false;
+
+		view.BufferLocation = allocation.gpu_address;
+		view.StrideInBytes = stride;
+		view.SizeInBytes = UINT( size );
+		return true;
+	}
+
+	bool FrameUploadBuffer::AllocateIndices( DXGI_FORMAT format, UINT count, Allocation& allocation, D3D12_INDEX_BUFFER_VIEW& view, FrameAllocatorCursor* cursor )
+	{
+		const UINT64 size = UINT64( format == DXGI_FORMAT_R16_UINT ? 2 : 4 ) * count;
+		if ( !( cursor ? Allocate( *cursor, size, 16, allocation ) : Allocate( size, 16, allocation ) ) )
+			return false;
+
+		view.BufferLocation = allocation.gpu_address;
+		view.SizeInBytes = UINT( size );
+		view.Format = format;
+		return true;
+	}
+
+	void FrameUploadBuffer::Release( )
+	{
+		if ( buffer )
+		{
+			buffer->Unmap( 0, nullptr );
+			buffer->Release( );
+			buffer = nullptr;
+		}
+		mapped_data = nullptr;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "FrameAllocator.h"
+
+namespace DXLayer
+{
+	// one persistently mapped upload buffer split into a region per frame in flight.
+	// Allocations are linear within the region of the current frame and are recycled
+	// when that frame comes around again, so the caller must have waited for its fence.
+	// Besides constants it holds what the cpu writes for one frame's draws, particles, debug
+	// lines, ui: the vertices are written in place and drawn straight from the upload heap,
+	// no copy and no barrier. Allocation is safe from several threads at once
+	class FrameUploadBuffer
+	{
+	public:
+		struct Allocation
+		{
+			BYTE* cpu_address;
+			D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+			UINT64 offset; // from the start of the buffer
+		};
+
+		FrameUploadBuffer( );
+
+		bool Init( ID3D12Device* device, UINT64 size_per_frame, UINT num_frames, const wchar_t* name );
+
+		// resets the region of the frame, the gpu must be done with it
+		void BeginFrame( UINT frame_index );
+
+		// returns false if the frame region is exhausted
+		bool Allocate( UINT64 size, UINT64 alignment, Allocation& allocation );
+
+		// the same through a thread's cursor over Allocator( ), for threads writing many small pieces
+		bool Allocate( FrameAllocatorCursor& cursor, UINT64 size, UINT64 alignment, Allocation& allocation );
+
+		// room for count vertices of stride bytes and the view to draw them from, the cursor is optional
+		bool AllocateVertices( UINT stride, UINT count, Allocation& allocation, D3D12_VERTEX_BUFFER_VIEW& view, FrameAllocatorCursor* cursor = nullptr );
+
+		// format is DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+		bool AllocateIndices( DXGI_FORMAT format, UINT count, Allocation& allocation, D3D12_INDEX_BUFFER_VIEW& view, FrameAllocatorCursor* cursor = nullptr );
+
+		FrameAllocator& Allocator( ) { return allocator; }
+
+		ID3D12Resource* Resource( ) const { return buffer; }
+
+		void Release( );
+
+	private:
+		ID3D12Resource* buffer;
+		BYTE* mapped_data;					// mapped for the whole lifetime of the buffer, upload heaps allow that
+		D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+		FrameAllocator allocator;
+	};
+}
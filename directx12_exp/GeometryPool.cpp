@@ -0,0 +1,281 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace DXLayer
+{
+	RangeAllocator::RangeAllocator( )
+		: capacity( 0 ), free_size( 0 )
+	{ }
+
+	void RangeAllocator::Reset( uint32_t capacity )
+	{
+		this->capacity = capacity;
+		free_size = 0;
+		free_by_offset.clear( );
+		free_by_size.clear( );
+		if ( capacity )
+			InsertFree( 0, capacity );
+	}
+
+	uint32_t RangeAllocator::Allocate( uint32_t size )
+	{
+		const auto best = free_by_size.lower_bound( size );
+		if ( size == 0 || best == free_by_size.end( ) )
+			return invalid_offset;
+		const uint32_t offset = best->second;
+		return Take( free_by_offset.find( offset ), offset, size );
+	}
+
+	uint32_t RangeAllocator::AllocateBelow( uint32_t size, uint32_t limit )
+	{
+		for ( auto sized = free_by_size.lower_bound( size ); sized != free_by_size.end( ); ++sized )
+			if ( sized->second < limit )
+				return Take( free_by_offset.find( sized->second ), sized->second, size );
+		return invalid_offset;
+	}
+
+	void RangeAllocator::AllocateAt( uint32_t offset, uint32_t size )
+	{
+		auto block = free_by_offset.upper_bound( offset );
+		assert( block != free_by_offset.begin( ) );
+		--block;
+		assert( block->first + block->second >= offset + size );
+		Take( block, offset, size );
+	}
+
+	void RangeAllocator::Free( uint32_t offset, uint32_t size )
+	{
+		if ( size == 0 )
+			return;
+
+		// merge with the free blocks right before and right after
+		auto next = free_by_offset.lower_bound( offset );
+		if ( next != free_by_offset.begin( ) )
+		{
+			auto previous = std::prev( next );
+			if ( previous->first + previous->second == offset )
+			{
+				offset = previous->first;
+				size += previous->second;
+				EraseFree( previous );
+			}
+		}
+		if ( next != free_by_offset.end( ) && next->first == offset + size )
+		{
+			size += next->second;
+			EraseFree( next );
+		}
+		InsertFree( offset, size );
+	}
+
+	uint32_t RangeAllocator::LargestFreeBlock( ) const
+	{
+		return free_by_size.empty( ) ? 0 : free_by_size.rbegin( )->first;
+	}
+
+	void RangeAllocator::InsertFree( uint32_t offset, uint32_t size )
+	{
+		free_by_offset.insert( std::make_pair( offset, size ) );
+		free_by_size.insert( std::make_pair( size, offset ) );
+		free_size += size;
+	}
+
+	void RangeAllocator::EraseFree( std::map<uint32_t, uint32_t>::iterator block )
+	{
+		const auto sized = free_by_size.equal_range( block->second );
+		for ( auto it = sized.first; it != sized.second; ++it )
+		{
+			if ( it->second == block->first )
+			{
+				free_by_size.erase( it );
+				break;
+			}
+		}
+		free_size -= block->second;
+		free_by_offset.erase( block );
+	}
+
+	// carves [offset, offset + size) out of a free block, the pieces left on either side stay free
+	uint32_t RangeAllocator::Take( std::map<uint32_t, uint32_t>::iterator block, uint32_t offset, uint32_t size )
+	{
+		const uint32_t block_offset = block->first;
+		const uint32_t block_end = block->first + block->second;
+		EraseFree( block );
+		if ( offset > block_offset )
+			InsertFree( block_offset, offset - block_offset );
+		if ( offset + size < block_end )
+			InsertFree( offset + size, block_end - offset - size );
+		return offset;
+	}
+
+	GeometryPool::GeometryPool( )
+		: vertex_stride( 0 ), index_size( 0 )
+	{ }
+
+	void GeometryPool::Init( uint32_t vertex_capacity, uint32_t vertex_stride, uint32_t index_capacity, uint32_t index_size )
+	{
+		this->vertex_stride = vertex_stride;
+		this->index_size = index_size;
+		vertex_allocator.Reset( vertex_capacity );
+		index_allocator.Reset( index_capacity );
+		meshes.clear( );
+		free_meshes.clear( );
+	}
+
+	uint32_t GeometryPool::Allocate( uint32_t vertex_count, uint32_t index_count )
+	{
+		const uint32_t first_vertex = vertex_allocator.Allocate( vertex_count );
+		if ( first_vertex == RangeAllocator::invalid_offset )
+			return invalid_geometry;
+		const uint32_t first_index = index_allocator.Allocate( index_count );
+		if ( first_index == RangeAllocator::invalid_offset )
+		{
+			vertex_allocator.Free( first_vertex, vertex_count );
+			return invalid_geometry;
+		}
+
+		uint32_t geometry;
+		if ( !free_meshes.empty( ) )
+		{
+			geometry = free_meshes.back( );
+			free_meshes.pop_back( );
+		}
+		else
+		{
+			geometry = uint32_t( meshes.size( ) );
+			meshes.push_back( Mesh( ) );
+		}
+
+		Mesh& mesh = meshes[geometry];
+		mesh.range.first_vertex = first_vertex;
+		mesh.range.vertex_count = vertex_count;
+		mesh.range.first_index = first_index;
+		mesh.range.index_count = index_count;
+		mesh.live = true;
+		return geometry;
+	}
+
+	void GeometryPool::Free( uint32_t geometry )
+	{
+		Mesh& mesh = meshes[geometry];
+		assert( mesh.live );
+		vertex_allocator.Free( mesh.range.first_vertex, mesh.range.vertex_count );
+		index_allocator.Free( mesh.range.first_index, mesh.range.index_count );
+		mesh.live = false;
+		free_meshes.push_back( geometry );
+	}
+
+	void GeometryPool::Defragment( uint64_t budget_bytes, std::vector<GeometryMove>& moves )
+	{
+		moves.clear( );
+		uint64_t planned_bytes = 0;
+
+		std::vector<uint32_t> order;
+		const GeometryBuffer buffers[] = { geometry_vertices, geometry_indices };
+		for ( GeometryBuffer buffer : buffers )
+		{
+			RangeAllocator& allocator = buffer == geometry_vertices ? vertex_allocator : index_allocator;
+			const uint32_t element_size = buffer == geometry_vertices ? vertex_stride : index_size;
+
+			// the back of the buffer first, whatever moves out of there leaves the tail free
+			SortedMeshes( buffer, order );
+			for ( auto it = order.rbegin( ); it != order.rend( ); ++it )
+			{
+				GeometryRange& range = meshes[*it].range;
+				uint32_t& first = buffer == geometry_vertices ? range.first_vertex : range.first_index;
+				const uint32_t count = buffer == geometry_vertices ? range.vertex_count : range.index_count;
+				if ( planned_bytes + uint64_t( count ) * element_size > budget_bytes )
+					return;
+				if ( count > allocator.LargestFreeBlock( ) )
+					continue;
+
+				const uint32_t destination = allocator.AllocateBelow( count, first );
+				if ( destination == RangeAllocator::invalid_offset )
+					continue;
+
+				GeometryMove move = { buffer, first, destination, count };
+				moves.push_back( move );
+				planned_bytes += uint64_t( count ) * element_size;
+				allocator.Free( first, count );
+				first = destination;
+			}
+		}
+	}
+
+	void GeometryPool::Compact( uint64_t budget_bytes, std::vector<GeometryMove>& moves )
+	{
+		moves.clear( );
+		uint64_t planned_bytes = 0;
+
+		std::vector<uint32_t> order;
+		const GeometryBuffer buffers[] = { geometry_vertices, geometry_indices };
+		for ( GeometryBuffer buffer : buffers )
+		{
+			RangeAllocator& allocator = buffer == geometry_vertices ? vertex_allocator : index_allocator;
+			const uint32_t element_size = buffer == geometry_vertices ? vertex_stride : index_size;
+
+			SortedMeshes( buffer, order );
+			uint32_t packed_end = 0;
+			for ( uint32_t geometry : order )
+			{
+				GeometryRange& range = meshes[geometry].range;
+				uint32_t& first = buffer == geometry_vertices ? range.first_vertex : range.first_index;
+				const uint32_t count = buffer == geometry_vertices ? range.vertex_count : range.index_count;
+				if ( first != packed_end )
+				{
+					const uint64_t bytes = uint64_t( count ) * element_size;
+					if ( !moves.empty( ) && planned_bytes + bytes > budget_bytes )
+						return;
+
+					// freeing merges the range with the gap below it, the new place is the start of that block
+					allocator.Free( first, count );
+					allocator.AllocateAt( packed_end, count );
+					GeometryMove move = { buffer, first, packed_end, count };
+					moves.push_back( move );
+					planned_bytes += bytes;
+					first = packed_end;
+				}
+				packed_end += count;
+			}
+		}
+	}
+
+	uint64_t GeometryPool::MoveBytes( const GeometryMove& move ) const
+	{
+		return uint64_t( move.count ) * ( move.buffer == geometry_vertices ? vertex_stride : index_size );
+	}
+
+	GeometryPoolStats GeometryPool::Stats( ) const
+	{
+		const auto fragmentation = [ ] ( const RangeAllocator& allocator )
+		{
+			return allocator.FreeSize( ) ? 1.0f - float( allocator.LargestFreeBlock( ) ) / float( allocator.FreeSize( ) ) : 0.0f;
+		};
+
+		GeometryPoolStats stats;
+		stats.mesh_count = uint32_t( meshes.size( ) - free_meshes.size( ) );
+		stats.vertices_used = vertex_allocator.Capacity( ) - vertex_allocator.FreeSize( );
+		stats.indices_used = index_allocator.Capacity( ) - index_allocator.FreeSize( );
+		stats.vertex_free_blocks = vertex_allocator.FreeBlockCount( );
+		stats.index_free_blocks = index_allocator.FreeBlockCount( );
+		stats.vertex_fragmentation = fragmentation( vertex_allocator );
+		stats.index_fragmentation = fragmentation( index_allocator );
+		return stats;
+	}
+
+	void GeometryPool::SortedMeshes( GeometryBuffer buffer, std::vector<uint32_t>& order ) const
+	{
+		order.clear( );
+		for ( uint32_t geometry = 0; geometry < uint32_t( meshes.size( ) ); ++geometry )
+			if ( meshes[geometry].live )
+				order.push_back( geometry );
+
+		std::sort( order.begin( ), order.end( ), [ this, buffer ] ( uint32_t a, uint32_t b )
+		{
+			return buffer == geometry_vertices ? meshes[a].range.first_vertex < meshes[b].range.first_vertex : meshes[a].range.first_index < meshes[b].range.first_index;
+		} );
+	}
+}
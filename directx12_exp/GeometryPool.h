@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// bookkeeping for a few big shared vertex and index buffers holding every static mesh. A mesh is a vertex range
+// and an index range in them, so drawing it needs no buffer binds, only StartIndexLocation and BaseVertexLocation.
+// Indices stay relative to the mesh's first vertex, moving vertex data only changes BaseVertexLocation.
+// No d3d in here, GeometryPoolBuffers owns the buffers and applies the moves planned here
+
+namespace DXLayer
+{
+	// free list over [0, capacity) in elements. Allocation is best fit, freed ranges merge with their neighbors
+	class RangeAllocator
+	{
+	public:
+		static const uint32_t invalid_offset = ~0u;
+
+		RangeAllocator( );
+
+		void Reset( uint32_t capacity );
+
+		// returns invalid_offset when no free block is large enough
+		uint32_t Allocate( uint32_t size );
+
+		// best fit among the free blocks starting below limit, for moving data towards the front
+		uint32_t AllocateBelow( uint32_t size, uint32_t limit );
+
+		// [offset, offset + size) has to lie in one free block
+		void AllocateAt( uint32_t offset, uint32_t size );
+
+		void Free( uint32_t offset, uint32_t size );
+
+		uint32_t Capacity( ) const { return capacity; }
+		uint32_t FreeSize( ) const { return free_size; }
+		uint32_t LargestFreeBlock( ) const;
+		uint32_t FreeBlockCount( ) const { return uint32_t( free_by_offset.size( ) ); }
+
+	private:
+		void InsertFree( uint32_t offset, uint32_t size );
+		void EraseFree( std::map<uint32_t, uint32_t>::iterator block );
+		uint32_t Take( std::map<uint32_t, uint32_t>::iterator block, uint32_t offset, uint32_t size );
+
+		uint32_t capacity;
+		uint32_t free_size;
+		std::map<uint32_t, uint32_t> free_by_offset;		// offset -> size
+		std::multimap<uint32_t, uint32_t> free_by_size;		// size -> offset
+	};
+
+	enum GeometryBuffer : uint32_t
+	{
+		geometry_vertices,
+		geometry_indices
+	};
+
+	// copy count elements of one buffer from source to destination. Moves are applied in order and always go
+	// towards the front of the buffer, a destination may overlap its own source like with memmove
+	struct GeometryMove
+	{
+		GeometryBuffer buffer;
+		uint32_t source;
+		uint32_t destination;
+		uint32_t count;
+	};
+
+	// where a mesh lives, in elements. The draw arguments are first_index and base_vertex
+	struct GeometryRange
+	{
+		uint32_t first_vertex;
+		uint32_t vertex_count;
+		uint32_t first_index;
+		uint32_t index_count;
+	};
+
+	struct GeometryPoolStats
+	{
+		uint32_t mesh_count;
+		uint32_t vertices_used;
+		uint32_t indices_used;
+		uint32_t vertex_free_blocks;
+		uint32_t index_free_blocks;
+		float vertex_fragmentation;	// 1 - largest free block / free space, 0 when all free space is one block
+		float index_fragmentation;
+	};
+
+	class GeometryPool
+	{
+	public:
+		static const uint32_t invalid_geometry = ~0u;
+
+		GeometryPool( );
+
+		void Init( uint32_t vertex_capacity, uint32_t vertex_stride, uint32_t index_capacity, uint32_t index_size );
+
+		// both counts have to be non-zero. Returns invalid_geometry when either buffer has no block large enough,
+		// even if defragmenting would make room
+		uint32_t Allocate( uint32_t vertex_count, uint32_t index_count );
+
+		void Free( uint32_t geometry );
+
+		const GeometryRange& Range( uint32_t geometry ) const { return meshes[geometry].range; }
+
+		// moves meshes from the back of the buffers into holes further front, until budget_bytes of data are
+		// planned. Ranges change right away, the moves have to be applied before the next draw
+		void Defragment( uint64_t budget_bytes, std::vector<GeometryMove>& moves );
+
+		// slides meshes down to close every gap, in offset order. Call until it plans no moves for fully packed
+		// buffers. budget_bytes limits one batch, but a mesh larger than the budget still moves on its own
+		void Compact( uint64_t budget_bytes, std::vector<GeometryMove>& moves );
+
+		uint32_t VertexStride( ) const { return vertex_stride; }
+		uint32_t IndexSize( ) const { return index_size; }
+		uint32_t VertexCapacity( ) const { return vertex_allocator.Capacity( ); }
+		uint32_t IndexCapacity( ) const { return index_allocator.Capacity( ); }
+		uint64_t MoveBytes( const GeometryMove& move ) const;
+
+		GeometryPoolStats Stats( ) const;
+
+	private:
+		struct Mesh
+		{
+			GeometryRange range;
+			bool live;
+		};
+
+		// live meshes ordered by where their data starts in one of the buffers
+		void SortedMeshes( GeometryBuffer buffer, std::vector<uint32_t>& order ) const;
+
+		uint32_t vertex_stride;
+		uint32_t index_size;
+		RangeAllocator vertex_allocator;
+		RangeAllocator index_allocator;
+		std::vector<Mesh> meshes;
+		std::vector<uint32_t> free_meshes;	// slots of freed meshes, reused before meshes grows
+	};
+}
@@ -0,0 +1,155 @@
+#include "GeometryPoolBuffers.h"
+
+#include "d3dx12.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const D3D12_RESOURCE_STATES vertex_buffer_state = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+		const D3D12_RESOURCE_STATES index_buffer_state = D3D12_RESOURCE_STATE_INDEX_BUFFER;
+
+		HRESULT CreateBuffer( ID3D12Device* device, UINT64 size, D3D12_RESOURCE_STATES state, const wchar_t* name, ID3D12Resource** buffer )
+		{
+			HRESULT hr = device->CreateCommittedResource(
+				&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ),
+				D3D12_HEAP_FLAG_NONE,
+				&CD3DX12_RESOURCE_DESC::Buffer( size ),
+				state,
+				nullptr,
+				IID_PPV_ARGS( buffer ) );
+			if ( SUCCEEDED( hr ) )
+				( *buffer )->SetName( name );
+			return hr;
+		}
+	}
+
+	GeometryPoolBuffers::GeometryPoolBuffers( )
+		: vertex_buffer( nullptr ), index_buffer( nullptr ), scratch_buffer( nullptr ), scratch_size( 0 ), vertex_stride( 0 ), index_size( 0 ),
+		vertex_state( D3D12_RESOURCE_STATE_COPY_DEST ), index_state( D3D12_RESOURCE_STATE_COPY_DEST ), scratch_state( D3D12_RESOURCE_STATE_COPY_DEST ),
+		vertex_buffer_view( ), index_buffer_view( )
+	{ }
+
+	bool GeometryPoolBuffers::Init( ID3D12Device* device, const GeometryPool& pool, UINT64 scratch_size )
+	{
+		this->scratch_size = scratch_size;
+		vertex_stride = pool.VertexStride( );
+		index_size = pool.IndexSize( );
+
+		// everything starts out waiting for its first upload
+		const UINT64 vertex_bytes = UINT64( pool.VertexCapacity( ) ) * vertex_stride;
+		const UINT64 index_bytes = UINT64( pool.IndexCapacity( ) ) * index_size;
+		if ( FAILED( CreateBuffer( device, vertex_bytes, vertex_state, L"Geometry Pool Vertex Buffer", &vertex_buffer ) ) ||
+			FAILED( CreateBuffer( device, index_bytes, index_state, L"Geometry Pool Index Buffer", &index_buffer ) ) ||
+			FAILED( CreateBuffer( device, scratch_size, scratch_state, L"Geometry Pool Scratch Buffer", &scratch_buffer ) ) )
+			return false;
+
+		vertex_buffer_view.BufferLocation = vertex_buffer->GetGPUVirtualAddress( );
+		vertex_buffer_view.StrideInBytes = vertex_stride;
+		vertex_buffer_view.SizeInBytes = UINT( vertex_bytes );
+
+		index_buffer_view.BufferLocation = index_buffer->GetGPUVirtualAddress( );
+		index_buffer_view.Format = index_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		index_buffer_view.SizeInBytes = UINT( index_bytes );
+		return true;
+	}
+
+	void GeometryPoolBuffers::Upload( ID3D12GraphicsCommandList* command_list, const GeometryRange& range,
+		ID3D12Resource* upload, UINT64 vertex_offset, UINT64 index_offset )
+	{
+		Transition( command_list, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_DEST, scratch_state );
+		command_list->CopyBufferRegion( vertex_buffer, UINT64( range.first_vertex ) * vertex_stride, upload, vertex_offset, UINT64( range.vertex_count ) * vertex_stride );
+		command_list->CopyBufferRegion( index_buffer, UINT64( range.first_index ) * index_size, upload, index_offset, UINT64( range.index_count ) * index_size );
+		Transition( command_list, vertex_buffer_state, index_buffer_state, scratch_state );
+	}
+
+	void GeometryPoolBuffers::Move( ID3D12GraphicsCommandList* command_list, const std::vector<GeometryMove>& moves )
+	{
+		// moves bigger than the scratch buffer are cut into pieces, front to back. Moves only go towards the front,
+		// so writing a piece never clobbers a later piece's source
+		std::vector<Piece> pieces;
+		for ( const GeometryMove& move : moves )
+		{
+			const UINT64 element_size = move.buffer == geometry_vertices ? vertex_stride : index_size;
+			const UINT64 size = UINT64( move.count ) * element_size;
+			for ( UINT64 done = 0; done < size; done += scratch_size )
+			{
+				Piece piece = { Buffer( move.buffer ), move.source * element_size + done, move.destination * element_size + done, size - done < scratch_size ? size - done : scratch_size };
+				pieces.push_back( piece );
+			}
+		}
+
+		size_t first = 0;
+		while ( first < pieces.size( ) )
+		{
+			size_t end = first;
+			UINT64 scratch_used = 0;
+			while ( end < pieces.size( ) && scratch_used + pieces[end].size <= scratch_size )
+				scratch_used += pieces[end++].size;
+			CopyThroughScratch( command_list, &pieces[first], end - first );
+			first = end;
+		}
+
+		if ( !pieces.empty( ) )
+			Transition( command_list, vertex_buffer_state, index_buffer_state, scratch_state );
+	}
+
+	void GeometryPoolBuffers::Bind( ID3D12GraphicsCommandList* command_list ) const
+	{
+		command_list->IASetVertexBuffers( 0, 1, &vertex_buffer_view );
+		command_list->IASetIndexBuffer( &index_buffer_view );
+	}
+
+	void GeometryPoolBuffers::Release( )
+	{
+		if ( vertex_buffer )
+			vertex_buffer->Release( );
+		if ( index_buffer )
+			index_buffer->Release( );
+		if ( scratch_buffer )
+			scratch_buffer->Release( );
+		vertex_buffer = nullptr;
+		index_buffer = nullptr;
+		scratch_buffer = nullptr;
+	}
+
+	// every source of the run into the scratch buffer, then every destination out of it. Within a run a destination
+	// may overlap another piece's source, all of them have been read by then
+	void GeometryPoolBuffers::CopyThroughScratch( ID3D12GraphicsCommandList* command_list, const Piece* pieces, size_t piece_count )
+	{
+		Transition( command_list, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST );
+		UINT64 scratch_offset = 0;
+		for ( size_t p = 0; p < piece_count; ++p )
+		{
+			command_list->CopyBufferRegion( scratch_buffer, scratch_offset, pieces[p].buffer, pieces[p].source, pieces[p].size );
+			scratch_offset += pieces[p].size;
+		}
+
+		Transition( command_list, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE );
+		scratch_offset = 0;
+		for ( size_t p = 0; p < piece_count; ++p )
+		{
+			command_list->CopyBufferRegion( pieces[p].buffer, pieces[p].destination, scratch_buffer, scratch_offset, pieces[p].size );
+			scratch_offset += pieces[p].size;
+		}
+	}
+
+	// one barrier call for whatever changes state
+	void GeometryPoolBuffers::Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES vertex_state, D3D12_RESOURCE_STATES index_state, D3D12_RESOURCE_STATES scratch_state )
+	{
+		D3D12_RESOURCE_BARRIER barriers[3];
+		UINT barrier_count = 0;
+		if ( vertex_state != this->vertex_state )
+			barriers[barrier_count++] = CD3DX12_RESOURCE_BARRIER::Transition( vertex_buffer, this->vertex_state, vertex_state );
+		if ( index_state != this->index_state )
+			barriers[barrier_count++] = CD3DX12_RESOURCE_BARRIER::Transition( index_buffer, this->index_state, index_state );
+		if ( scratch_state != this->scratch_state )
+			barriers[barrier_count++] = CD3DX12_RESOURCE_BARRIER::Transition( scratch_buffer, this->scratch_state, scratch_state );
+		if ( barrier_count )
+			command_list->ResourceBarrier( barrier_count, barriers );
+
+		this->vertex_state = vertex_state;
+		this->index_state = index_state;
+		this->scratch_state = scratch_state;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <vector>
+
+#include "GeometryPool.h"
+
+namespace DXLayer
+{
+	// the default heap vertex and index buffers behind a GeometryPool, bound once for every mesh in it.
+	// Between uses the buffers sit in the vertex and index buffer states, Upload and Move transition them
+	// for the copies and back, so they're recorded on the same queue as the draws that read the buffers
+	class GeometryPoolBuffers
+	{
+	public:
+		GeometryPoolBuffers( );
+
+		// moves go through a scratch buffer of scratch_size bytes, larger batches take several rounds of copies
+		bool Init( ID3D12Device* device, const GeometryPool& pool, UINT64 scratch_size );
+
+		// copies a mesh's data out of an upload heap into its pool ranges
+		void Upload( ID3D12GraphicsCommandList* command_list, const GeometryRange& range,
+			ID3D12Resource* upload, UINT64 vertex_offset, UINT64 index_offset );
+
+		// applies a batch of moves planned by the pool. D3d can't copy between two ranges of one buffer, the data
+		// goes through the scratch buffer: as many sources as fit, then their destinations
+		void Move( ID3D12GraphicsCommandList* command_list, const std::vector<GeometryMove>& moves );
+
+		// one bind for every mesh in the pool
+		void Bind( ID3D12GraphicsCommandList* command_list ) const;
+
+		void Release( );
+
+	private:
+		struct Piece
+		{
+			ID3D12Resource* buffer;
+			UINT64 source;
+			UINT64 destination;
+			UINT64 size;
+		};
+
+		void CopyThroughScratch( ID3D12GraphicsCommandList* command_list, const Piece* pieces, size_t piece_count );
+		void Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES vertex_state, D3D12_RESOURCE_STATES index_state, D3D12_RESOURCE_STATES scratch_state );
+		ID3D12Resource* Buffer( GeometryBuffer buffer ) const { return buffer == geometry_vertices ? vertex_buffer : index_buffer; }
+
+		ID3D12Resource* vertex_buffer;
+		ID3D12Resource* index_buffer;
+		ID3D12Resource* scratch_buffer;		// default heap, only copied through
+		UINT64 scratch_size;
+		UINT vertex_stride;
+		UINT index_size;
+		D3D12_RESOURCE_STATES vertex_state;
+		D3D12_RESOURCE_STATES index_state;
+		D3D12_RESOURCE_STATES scratch_state;
+		D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+		D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DXLayer
+{
+	// 64-bit FNV-1a. Not cryptographic, only used for cache keys and lookup tables
+
+	static const uint64_t fnv_offset_basis = 14695981039346656037ull;
+	static const uint64_t fnv_prime = 1099511628211ull;
+
+	inline uint64_t Fnv1a64( const void* data, size_t size, uint64_t hash = fnv_offset_basis )
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>( data );
+		for ( size_t i = 0; i < size; ++i )
+		{
+			hash ^= bytes[i];
+			hash *= fnv_prime;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	inline uint64_t Fnv1a64( const T& value, uint64_t hash )
+	{
+		return Fnv1a64( &value, sizeof( value ), hash );
+	}
+
+	// compile-time version for null-terminated strings
+	constexpr uint64_t Fnv1a64Str( const char* str, uint64_t hash = fnv_offset_basis )
+	{
+		return *str ? Fnv1a64Str( str + 1, ( hash ^ uint64_t( uint8_t( *str ) ) ) * fnv_prime ) : hash;
+	}
+
+	// compile-time version for integral values, hashes the value byte by byte (little endian)
+	constexpr uint64_t Fnv1a64Int( uint64_t value, int num_bytes, uint64_t hash )
+	{
+		return num_bytes > 0 ? Fnv1a64Int( value >> 8, num_bytes - 1, ( hash ^ ( value & 0xff ) ) * fnv_prime ) : hash;
+	}
+
+	inline uint64_t HashCombine( uint64_t seed, uint64_t value )
+	{
+		return Fnv1a64( value, seed );
+	}
+}
@@ -0,0 +1,135 @@
+#include "IndexPacking.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DXLayer
+{
+	namespace
+	{
+		void PackSingleChunk32( const uint32_t* indices, size_t index_count, uint32_t max_vertex, PackedIndices& out )
+		{
+			out.index_size = 4;
+			out.data.resize( index_count * 4 );
+			std::memcpy( out.data.data( ), indices, index_count * 4 );
+
+			IndexChunk chunk = { 0, uint32_t( index_count ), 0, max_vertex + 1 };
+			out.chunks.assign( 1, chunk );
+		}
+
+		void PackChunks16( const uint32_t* indices, PackedIndices& out )
+		{
+			out.index_size = 2;
+
+			size_t index_count = 0;
+			for ( const auto& chunk : out.chunks )
+				index_count += chunk.index_count;
+			out.data.resize( index_count * 2 );
+
+			uint16_t* packed = reinterpret_cast<uint16_t*>( out.data.data( ) );
+			for ( const auto& chunk : out.chunks )
+			{
+				const uint32_t base = uint32_t( chunk.base_vertex );
+				for ( uint32_t i = chunk.first_index; i < chunk.first_index + chunk.index_count; ++i )
+					packed[i] = uint16_t( indices[i] - base );
+			}
+		}
+	}
+
+	size_t PackedIndices::BytesSaved( ) const
+	{
+		return data.size( ) / index_size * 4 - data.size( );
+	}
+
+	bool SplitIndexChunks( const uint32_t* indices, size_t index_count, std::vector<IndexChunk>& chunks )
+	{
+		chunks.clear( );
+
+		uint32_t chunk_min = 0;
+		uint32_t chunk_max = 0;
+		IndexChunk chunk = { 0, 0, 0, 0 };
+
+		for ( size_t i = 0; i + 2 < index_count; i += 3 )
+		{
+			const uint32_t tri_min = std::min( std::min( indices[i], indices[i + 1] ), indices[i + 2] );
+			const uint32_t tri_max = std::max( std::max( indices[i], indices[i + 1] ), indices[i + 2] );
+			if ( tri_max - tri_min >= max_chunk_vertices )
+				return false; // a single triangle spans more than 16 bits, nothing to split
+
+			const uint32_t new_min = chunk.index_count ? std::min( chunk_min, tri_min ) : tri_min;
+			const uint32_t new_max = chunk.index_count ? std::max( chunk_max, tri_max ) : tri_max;
+			if ( new_max - new_min >= max_chunk_vertices )
+			{
+				chunk.base_vertex = int32_t( chunk_min );
+				chunk.vertex_count = chunk_max - chunk_min + 1;
+				chunks.push_back( chunk );
+
+				chunk.first_index = uint32_t( i );
+				chunk.index_count = 0;
+				chunk_min = tri_min;
+				chunk_max = tri_max;
+			}
+			else
+			{
+				chunk_min = new_min;
+				chunk_max = new_max;
+			}
+			chunk.index_count += 3;
+		}
+
+		if ( chunk.index_count )
+		{
+			chunk.base_vertex = int32_t( chunk_min );
+			chunk.vertex_count = chunk_max - chunk_min + 1;
+			chunks.push_back( chunk );
+		}
+		return true;
+	}
+
+	void PackIndices( const uint32_t* indices, size_t index_count, PackedIndices& out, const IndexPackingOptions& options )
+	{
+		out.data.clear( );
+		out.chunks.clear( );
+		if ( index_count == 0 )
+		{
+			out.index_size = 2;
+			return;
+		}
+
+		uint32_t min_vertex = indices[0];
+		uint32_t max_vertex = min_vertex;
+		for ( size_t i = 1; i < index_count; ++i )
+		{
+			min_vertex = std::min( min_vertex, indices[i] );
+			max_vertex = std::max( max_vertex, indices[i] );
+		}
+
+		if ( !options.allow_16bit )
+		{
+			PackSingleChunk32( indices, index_count, max_vertex, out );
+			return;
+		}
+
+		// the whole mesh fits, one draw with the lowest vertex as base
+		if ( max_vertex - min_vertex < max_chunk_vertices )
+		{
+			IndexChunk chunk = { 0, uint32_t( index_count ), int32_t( min_vertex ), max_vertex - min_vertex + 1 };
+			out.chunks.assign( 1, chunk );
+			PackChunks16( indices, out );
+			return;
+		}
+
+		if ( options.allow_split && SplitIndexChunks( indices, index_count, out.chunks ) )
+		{
+			const size_t triangle_count = index_count / 3;
+			const size_t max_chunks = std::max<size_t>( 1, triangle_count / std::max<uint32_t>( options.min_triangles_per_chunk, 1 ) );
+			if ( out.chunks.size( ) <= max_chunks )
+			{
+				PackChunks16( indices, out );
+				return;
+			}
+		}
+
+		PackSingleChunk32( indices, index_count, max_vertex, out );
+	}
+}
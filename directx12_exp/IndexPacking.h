@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// picks the smallest index format for a triangle list. Meshes whose vertex range fits into 16 bits
+// get R16_UINT indices. Bigger meshes are split into chunks that each reference fewer than 64K
+// vertices; every chunk stores its indices relative to its lowest vertex and is drawn with that
+// vertex as BaseVertexLocation, so the vertex buffer stays untouched.
+// Triangle order is kept, a chunk ends when the next triangle would push its vertex range past
+// 16 bits. That works well for meshes with local vertex order (grids, optimized meshes) and badly
+// for scrambled ones, those fall back to 32-bit indices rather than turning into hundreds of draws
+
+namespace DXLayer
+{
+	// one draw call: DrawIndexedInstanced( index_count, 1, first_index, base_vertex, 0 )
+	struct IndexChunk
+	{
+		uint32_t first_index;	// into the packed buffer, in indices
+		uint32_t index_count;
+		int32_t base_vertex;	// added to every index of the chunk by the input assembler
+		uint32_t vertex_count;	// highest index in the chunk + 1, relative to base_vertex
+	};
+
+	struct PackedIndices
+	{
+		PackedIndices( )
+			: index_size( 4 )
+		{ }
+
+		uint32_t index_size;			// 2 or 4 bytes
+		std::vector<uint8_t> data;		// index_size * total index count
+		std::vector<IndexChunk> chunks;
+
+		size_t BytesSaved( ) const;		// compared to storing everything as 32-bit
+	};
+
+	struct IndexPackingOptions
+	{
+		IndexPackingOptions( )
+			: allow_16bit( true ), allow_split( true ), min_triangles_per_chunk( 1024 )
+		{ }
+
+		bool allow_16bit;
+		bool allow_split;					// false keeps the mesh in a single draw, so only meshes below 64K vertices get 16-bit indices
+		uint32_t min_triangles_per_chunk;	// average chunk size below which splitting isn't worth the extra draws
+	};
+
+	// largest vertex range a 16-bit chunk may span. 0xffff is left unused, it's the strip cut value
+	static const uint32_t max_chunk_vertices = 0xffff;
+
+	// index_count has to be a multiple of 3
+	void PackIndices( const uint32_t* indices, size_t index_count, PackedIndices& out, const IndexPackingOptions& options = IndexPackingOptions( ) );
+
+	// splits a triangle list into chunks without writing any indices, PackIndices uses this to decide on the format.
+	// Fails if a single triangle spans 64K vertices or more
+	bool SplitIndexChunks( const uint32_t* indices, size_t index_count, std::vector<IndexChunk>& chunks );
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "MeshSimplifier.h"
+
+// runtime lod choice from the errors BuildLodChain stored. A lod's object space error is projected to pixels
+// and the coarsest lod under the budget wins. Going coarser needs the error to fit a tighter budget than
+// going back finer, so objects sitting right at a threshold don't swap lods every frame
+
+namespace DXLayer
+{
+	struct LodSelectParams
+	{
+		LodSelectParams( )
+			: max_error_pixels( 1.0f ), hysteresis( 0.25f )
+		{ }
+
+		float max_error_pixels;
+		float hysteresis;		// coarser lods must fit max_error_pixels * ( 1 - hysteresis )
+	};
+
+	// pixels per object space unit at the given view distance, for a perspective projection with vertical fov fov_y
+	inline float PerspectivePixelsPerUnit( float distance, float fov_y, float viewport_height )
+	{
+		const float safe_distance = distance > 1e-4f ? distance : 1e-4f;
+		return viewport_height * 0.5f / ( std::tan( fov_y * 0.5f ) * safe_distance );
+	}
+
+	// distance used for projection. The closest point of the bounding sphere gives the largest error anywhere on the mesh
+	inline float LodDistance( const float* camera_position, const float* bounds_center, float bounds_radius )
+	{
+		const float dx = bounds_center[0] - camera_position[0];
+		const float dy = bounds_center[1] - camera_position[1];
+		const float dz = bounds_center[2] - camera_position[2];
+		const float distance = std::sqrt( dx * dx + dy * dy + dz * dz ) - bounds_radius;
+		return distance > 0.0f ? distance : 0.0f;
+	}
+
+	// current_lod is what the object drew with last frame, 0 for new objects
+	inline uint32_t SelectLod( const MeshLod* lods, uint32_t lod_count, float pixels_per_unit, uint32_t current_lod, const LodSelectParams& params = LodSelectParams( ) )
+	{
+		if ( lod_count == 0 )
+			return 0;
+		if ( current_lod >= lod_count )
+			current_lod = lod_count - 1;
+
+		// finer right away once the current lod shows too much error
+		uint32_t lod = current_lod;
+		while ( lod > 0 && lods[lod].error * pixels_per_unit > params.max_error_pixels )
+			lod--;
+		if ( lod != current_lod )
+			return lod;
+
+		// coarser only with some room below the budget
+		const float coarser_budget = params.max_error_pixels * ( 1.0f - params.hysteresis );
+		while ( lod + 1 < lod_count && lods[lod + 1].error * pixels_per_unit <= coarser_budget )
+			lod++;
+		return lod;
+	}
+}
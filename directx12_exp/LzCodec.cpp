@@ -0,0 +1,183 @@
+#include "LzCodec.h"
+
+#include <cstring>
+#include <vector>
+
+namespace DXLayer
+{
+	namespace
+	{
+		const size_t min_match = 4;
+		const size_t max_offset = 0xffff;
+		const int hash_bits = 14;
+
+		uint32_t Read32( const uint8_t* p )
+		{
+			uint32_t value;
+			std::memcpy( &value, p, 4 );
+			return value;
+		}
+
+		uint32_t Hash( uint32_t value )
+		{
+			return ( value * 2654435761u ) >> ( 32 - hash_bits );
+		}
+
+		uint8_t* WriteLength( uint8_t* out, size_t length )
+		{
+			for ( ; length >= 255; length -= 255 )
+				*out++ = 255;
+			*out++ = uint8_t( length );
+			return out;
+		}
+
+		uint8_t* WriteSequence( uint8_t* out, const uint8_t* literals, size_t literal_count, size_t offset, size_t match_length )
+		{
+			const size_t match_code = match_length ? match_length - min_match : 0;
+			*out++ = uint8_t( ( literal_count < 15 ? literal_count : 15 ) << 4 | ( match_code < 15 ? match_code : 15 ) );
+			if ( literal_count >= 15 )
+				out = WriteLength( out, literal_count - 15 );
+			if ( literal_count )
+				std::memcpy( out, literals, literal_count );
+			out += literal_count;
+			if ( !match_length )
+				return out;
+
+			*out++ = uint8_t( offset );
+			*out++ = uint8_t( offset >> 8 );
+			if ( match_code >= 15 )
+				out = WriteLength( out, match_code - 15 );
+			return out;
+		}
+
+		// the rest of a 15 in the token. False when it runs past the end
+		bool ReadLength( const uint8_t*& in, const uint8_t* end, size_t& length )
+		{
+			uint8_t byte;
+			do
+			{
+				if ( in == end )
+					return false;
+				byte = *in++;
+				length += byte;
+			} while ( byte == 255 );
+			return true;
+		}
+	}
+
+	size_t LzCompressBound( size_t size )
+	{
+		return size + size / 255 + 16;
+	}
+
+	size_t LzCompress( const uint8_t* source, size_t size, uint8_t* destination )
+	{
+		uint8_t* out = destination;
+		const uint8_t* anchor = source;
+		if ( size >= min_match )
+		{
+			std::vector<uint32_t> table( size_t( 1 ) << hash_bits, 0 ); // position + 1, 0 is empty
+			const uint8_t* end = source + size;
+			const uint8_t* p = source;
+			uint32_t misses = 0;
+			while ( p + min_match <= end )
+			{
+				const uint32_t value = Read32( p );
+				uint32_t& slot = table[Hash( value )];
+				const uint8_t* candidate = slot ? source + slot - 1 : nullptr;
+				slot = uint32_t( p - source + 1 );
+				if ( !candidate || size_t( p - candidate ) > max_offset || Read32( candidate ) != value )
+				{
+					// the longer nothing matched, the bigger the steps, incompressible data goes by quickly
+					p += 1 + ( misses++ >> 6 );
+					continue;
+				}
+				misses = 0;
+
+				// a match starting earlier is a longer one
+				while ( p > anchor && candidate > source && p[-1] == candidate[-1] )
+				{
+					--p;
+					--candidate;
+				}
+				const uint8_t* match_end = p + min_match;
+				const uint8_t* candidate_end = candidate + min_match;
+				while ( match_end < end && *match_end == *candidate_end )
+				{
+					++match_end;
+					++candidate_end;
+				}
+
+				out = WriteSequence( out, anchor, size_t( p - anchor ), size_t( p - candidate ), size_t( match_end - p ) );
+				anchor = p = match_end;
+				if ( p + min_match <= end )
+					table[Hash( Read32( p - 2 ) )] = uint32_t( p - 2 - source + 1 );
+			}
+		}
+		return size_t( WriteSequence( out, anchor, size_t( source + size - anchor ), 0, 0 ) - destination );
+	}
+
+	bool LzDecompress( const uint8_t* source, size_t size, uint8_t* destination, size_t destination_size )
+	{
+		const uint8_t* in = source;
+		const uint8_t* in_end = source + size;
+		uint8_t* out = destination;
+		uint8_t* out_end = destination + destination_size;
+		while ( in < in_end )
+		{
+			const uint8_t token = *in++;
+
+			size_t literal_count = token >> 4;
+			if ( literal_count == 15 && !ReadLength( in, in_end, literal_count ) )
+				return false;
+			if ( literal_count > size_t( in_end - in ) || literal_count > size_t( out_end - out ) )
+				return false;
+
+			// 16 bytes at a time while both sides have room for the overshoot
+			if ( size_t( in_end - in ) >= literal_count + 16 && size_t( out_end - out ) >= literal_count + 16 )
+			{
+				for ( size_t copied = 0; copied < literal_count; copied += 16 )
+					std::memcpy( out + copied, in + copied, 16 );
+			}
+			else if ( literal_count )
+			{
+				std::memcpy( out, in, literal_count );
+			}
+			in += literal_count;
+			out += literal_count;
+			if ( in == in_end )
+				break;
+
+			if ( in_end - in < 2 )
+				return false;
+			const size_t offset = size_t( in[0] ) | size_t( in[1] ) << 8;
+			in += 2;
+			size_t match_length = token & 15;
+			if ( match_length == 15 && !ReadLength( in, in_end, match_length ) )
+				return false;
+			match_length += min_match;
+			if ( offset == 0 || offset > size_t( out - destination ) || match_length > size_t( out_end - out ) )
+				return false;
+
+			// short matches far enough back are a single 16 byte copy. 8 bytes at a time reads only bytes that
+			// are already written when the match is at least 8 back
+			const uint8_t* match = out - offset;
+			if ( match_length <= 16 && offset >= 16 && out_end - out >= 16 )
+			{
+				std::memcpy( out, match, 16 );
+			}
+			else if ( offset >= 8 && size_t( out_end - out ) >= match_length + 8 )
+			{
+				for ( size_t copied = 0; copied < match_length; copied += 8 )
+					std::memcpy( out + copied, match + copied, 8 );
+			}
+			else
+			{
+				for ( size_t i = 0; i < match_length; ++i )
+					out[i] = match[i];
+			}
+			out += match_length;
+		}
+		return in == in_end && out == out_end;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// general purpose byte compression in the lz77 family, for pack file blocks. The stream is a list of
+// sequences: a token byte with a literal count and a match length in its two halves, longer counts
+// continue in bytes of 255, then the literals, then a 16-bit match offset back into the output. The last
+// sequence has literals only. Compression is greedy with a single hash table probe per position and
+// skips ahead faster through data that doesn't match, decompression is a tight copy loop with every
+// read and write checked against the buffer ends, so corrupt data can't take it out of bounds
+
+namespace DXLayer
+{
+	// largest output LzCompress can produce for size bytes of input
+	size_t LzCompressBound( size_t size );
+
+	// destination has to hold LzCompressBound( size ) bytes. Returns the compressed size
+	size_t LzCompress( const uint8_t* source, size_t size, uint8_t* destination );
+
+	// false unless the data decodes to exactly destination_size bytes
+	bool LzDecompress( const uint8_t* source, size_t size, uint8_t* destination, size_t destination_size );
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// the DirectXMath storage types vertex and constant buffer layouts are declared with. On windows they are the real
+// ones, anywhere else plain structs of the same size and layout, so VertexLayout.h and ConstantBufferLayout.h and
+// their checks build in asset_tool
+
+#ifdef _WIN32
+
+#include <DirectXMath.h>
+
+#else
+
+#include <cstdint>
+
+namespace DirectX
+{
+	struct XMFLOAT2
+	{
+		float x, y;
+		XMFLOAT2( ) = default;
+		constexpr XMFLOAT2( float x, float y ) : x( x ), y( y ) { }
+		explicit XMFLOAT2( const float* v ) : x( v[0] ), y( v[1] ) { }
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+		XMFLOAT3( ) = default;
+		constexpr XMFLOAT3( float x, float y, float z ) : x( x ), y( y ), z( z ) { }
+		explicit XMFLOAT3( const float* v ) : x( v[0] ), y( v[1] ), z( v[2] ) { }
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+		XMFLOAT4( ) = default;
+		constexpr XMFLOAT4( float x, float y, float z, float w ) : x( x ), y( y ), z( z ), w( w ) { }
+		explicit XMFLOAT4( const float* v ) : x( v[0] ), y( v[1] ), z( v[2] ), w( v[3] ) { }
+	};
+
+	struct XMUINT2
+	{
+		uint32_t x, y;
+		XMUINT2( ) = default;
+		constexpr XMUINT2( uint32_t x, uint32_t y ) : x( x ), y( y ) { }
+	};
+
+	struct XMUINT3
+	{
+		uint32_t x, y, z;
+		XMUINT3( ) = default;
+		constexpr XMUINT3( uint32_t x, uint32_t y, uint32_t z ) : x( x ), y( y ), z( z ) { }
+	};
+
+	struct XMUINT4
+	{
+		uint32_t x, y, z, w;
+		XMUINT4( ) = default;
+		constexpr XMUINT4( uint32_t x, uint32_t y, uint32_t z, uint32_t w ) : x( x ), y( y ), z( z ), w( w ) { }
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "MeshAsset.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "MeshCodec.h"
+#include "SubresourceCopy.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// 0 for sections whose element size depends on the info section
+		const uint32_t section_element_sizes[mesh_section_type_count] = {
+			sizeof( MeshAssetInfo ),
+			0,
+			0,
+			sizeof( IndexChunk ),
+			sizeof( MeshLod ),
+			sizeof( Meshlet ),
+			sizeof( uint32_t ),
+			sizeof( uint32_t ),
+			sizeof( PackedMeshletBounds ),
+			1,
+			1,
+		};
+
+		bool Fail( std::string& error, const char* message )
+		{
+			error = message;
+			return false;
+		}
+
+		uint64_t AlignUp( uint64_t value )
+		{
+			return ( value + mesh_asset_alignment - 1 ) & ~uint64_t( mesh_asset_alignment - 1 );
+		}
+
+		bool RangeFits( uint64_t first, uint64_t count, uint64_t limit )
+		{
+			return first <= limit && count <= limit - first;
+		}
+	}
+
+	uint32_t MeshVertexStride( uint32_t vertex_format )
+	{
+		switch ( vertex_format )
+		{
+		case mesh_vertex_compact:
+			return 12;
+		case mesh_vertex_compact_normal:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	bool ReadMeshAsset( const void* data, size_t size, MeshAssetView& view, std::string& error )
+	{
+		std::memset( &view, 0, sizeof( view ) );
+
+		const uint8_t* bytes = static_cast<const uint8_t*>( data );
+		if ( size < sizeof( MeshAssetHeader ) )
+			return Fail( error, "file too small for a mesh asset header" );
+
+		const MeshAssetHeader* header = reinterpret_cast<const MeshAssetHeader*>( bytes );
+		if ( header->magic != mesh_asset_magic )
+			return Fail( error, "not a mesh asset" );
+		if ( header->version == 0 || header->version > mesh_asset_version )
+			return Fail( error, "unsupported mesh asset version" );
+		if ( header->file_size > size )
+			return Fail( error, "mesh asset is truncated" );
+		if ( !RangeFits( sizeof( MeshAssetHeader ), uint64_t( header->section_count ) * sizeof( MeshAssetSection ), header->file_size ) )
+			return Fail( error, "section table runs past the end of the file" );
+
+		// unknown section types are skipped, so newer tools can add optional sections without a version bump
+		const MeshAssetSection* table = reinterpret_cast<const MeshAssetSection*>( bytes + sizeof( MeshAssetHeader ) );
+		const MeshAssetSection* sections[mesh_section_type_count] = { };
+		for ( uint32_t s = 0; s < header->section_count; ++s )
+		{
+			const MeshAssetSection& section = table[s];
+			if ( section.type >= mesh_section_type_count )
+				continue;
+			if ( sections[section.type] )
+				return Fail( error, "duplicate section" );
+			if ( section.offset % mesh_asset_alignment != 0 || !RangeFits( section.offset, section.size, header->file_size ) )
+				return Fail( error, "section out of bounds or misaligned" );
+			const uint32_t expected_size = section_element_sizes[section.type];
+			if ( section.element_size == 0 || ( expected_size != 0 && section.element_size != expected_size ) || section.size % section.element_size != 0 )
+				return Fail( error, "section element size doesn't match this build" );
+			sections[section.type] = &section;
+		}
+
+		const MeshAssetSectionType required[] = { mesh_section_info, mesh_section_index_chunks, mesh_section_lods };
+		for ( MeshAssetSectionType type : required )
+			if ( !sections[type] )
+				return Fail( error, "required section missing" );
+		if ( !sections[mesh_section_vertices] == !sections[mesh_section_vertices_encoded] || !sections[mesh_section_indices] == !sections[mesh_section_indices_encoded] )
+			return Fail( error, "vertices and indices need exactly one of the raw and encoded sections each" );
+
+		const auto payload = [ bytes, &sections ]( MeshAssetSectionType type ) { return bytes + sections[type]->offset; };
+		const auto count = [ &sections ]( MeshAssetSectionType type ) { return uint32_t( sections[type]->size / sections[type]->element_size ); };
+
+		if ( sections[mesh_section_info]->size != sizeof( MeshAssetInfo ) )
+			return Fail( error, "info section has the wrong size" );
+		view.info = reinterpret_cast<const MeshAssetInfo*>( payload( mesh_section_info ) );
+		const MeshAssetInfo& info = *view.info;
+
+		const uint32_t stride = MeshVertexStride( info.vertex_format );
+		if ( stride == 0 )
+			return Fail( error, "unknown vertex format" );
+		if ( sections[mesh_section_vertices] )
+		{
+			if ( sections[mesh_section_vertices]->element_size != stride || sections[mesh_section_vertices]->size != uint64_t( info.vertex_count ) * stride )
+				return Fail( error, "vertex section doesn't match the vertex format" );
+			view.vertices = payload( mesh_section_vertices );
+			view.vertex_bytes = size_t( sections[mesh_section_vertices]->size );
+		}
+		else
+		{
+			view.vertices_encoded = payload( mesh_section_vertices_encoded );
+			view.vertices_encoded_bytes = size_t( sections[mesh_section_vertices_encoded]->size );
+		}
+
+		if ( ( info.index_size != 2 && info.index_size != 4 ) || info.index_count % 3 != 0 )
+			return Fail( error, "index section doesn't match the index format" );
+		if ( sections[mesh_section_indices] )
+		{
+			if ( sections[mesh_section_indices]->element_size != info.index_size || sections[mesh_section_indices]->size != uint64_t( info.index_count ) * info.index_size )
+				return Fail( error, "index section doesn't match the index format" );
+			view.indices = payload( mesh_section_indices );
+			view.index_bytes = size_t( sections[mesh_section_indices]->size );
+		}
+		else
+		{
+			view.indices_encoded = payload( mesh_section_indices_encoded );
+			view.indices_encoded_bytes = size_t( sections[mesh_section_indices_encoded]->size );
+		}
+
+		// draw ranges are used as they are, so they have to stay inside the buffers
+		view.chunks = reinterpret_cast<const IndexChunk*>( payload( mesh_section_index_chunks ) );
+		view.chunk_count = count( mesh_section_index_chunks );
+		for ( uint32_t c = 0; c < view.chunk_count; ++c )
+		{
+			const IndexChunk& chunk = view.chunks[c];
+			if ( !RangeFits( chunk.first_index, chunk.index_count, info.index_count ) || chunk.base_vertex < 0 ||
+				!RangeFits( uint32_t( chunk.base_vertex ), chunk.vertex_count, info.vertex_count ) )
+				return Fail( error, "index chunk out of range" );
+		}
+
+		view.lods = reinterpret_cast<const MeshLod*>( payload( mesh_section_lods ) );
+		view.lod_count = count( mesh_section_lods );
+		if ( view.lod_count == 0 )
+			return Fail( error, "mesh asset without lods" );
+		for ( uint32_t l = 0; l < view.lod_count; ++l )
+			if ( !RangeFits( view.lods[l].first_index, view.lods[l].index_count, info.index_count ) || view.lods[l].index_count % 3 != 0 )
+				return Fail( error, "lod out of range" );
+
+		// meshlets are optional, but come as a set
+		const MeshAssetSectionType meshlet_sections[] = { mesh_section_meshlets, mesh_section_meshlet_vertices, mesh_section_meshlet_triangles, mesh_section_meshlet_bounds };
+		uint32_t meshlet_sections_present = 0;
+		for ( MeshAssetSectionType type : meshlet_sections )
+			meshlet_sections_present += sections[type] != nullptr;
+		if ( meshlet_sections_present != 0 && meshlet_sections_present != 4 )
+			return Fail( error, "incomplete meshlet sections" );
+
+		if ( meshlet_sections_present )
+		{
+			view.meshlets = reinterpret_cast<const Meshlet*>( payload( mesh_section_meshlets ) );
+			view.meshlet_count = count( mesh_section_meshlets );
+			view.meshlet_vertices = reinterpret_cast<const uint32_t*>( payload( mesh_section_meshlet_vertices ) );
+			view.meshlet_vertex_count = count( mesh_section_meshlet_vertices );
+			view.meshlet_triangles = reinterpret_cast<const uint32_t*>( payload( mesh_section_meshlet_triangles ) );
+			view.meshlet_triangle_count = count( mesh_section_meshlet_triangles );
+			view.meshlet_bounds = reinterpret_cast<const PackedMeshletBounds*>( payload( mesh_section_meshlet_bounds ) );
+			if ( count( mesh_section_meshlet_bounds ) != view.meshlet_count )
+				return Fail( error, "meshlet bounds don't match the meshlets" );
+
+			for ( uint32_t m = 0; m < view.meshlet_count; ++m )
+			{
+				const Meshlet& meshlet = view.meshlets[m];
+				if ( !RangeFits( meshlet.vertex_offset, meshlet.vertex_count, view.meshlet_vertex_count ) ||
+					!RangeFits( meshlet.triangle_offset, meshlet.triangle_count, view.meshlet_triangle_count ) )
+					return Fail( error, "meshlet out of range" );
+			}
+		}
+		return true;
+	}
+
+	bool CopyMeshAssetVertices( const MeshAssetView& view, void* destination )
+	{
+		const size_t stride = MeshVertexStride( view.info->vertex_format );
+		if ( view.vertices )
+		{
+			CopyToWriteCombined( destination, view.vertices, view.vertex_bytes );
+			return true;
+		}
+		return DecodeVertexBuffer( destination, view.info->vertex_count, stride, view.vertices_encoded, view.vertices_encoded_bytes );
+	}
+
+	bool CopyMeshAssetIndices( const MeshAssetView& view, void* destination )
+	{
+		if ( view.indices )
+		{
+			CopyToWriteCombined( destination, view.indices, view.index_bytes );
+			return true;
+		}
+
+		// 16-bit indices are relative to their chunk's base vertex, so they're only checked against the largest chunk
+		size_t vertex_limit = view.info->vertex_count;
+		if ( view.info->index_size == 2 )
+		{
+			vertex_limit = 0;
+			for ( uint32_t c = 0; c < view.chunk_count; ++c )
+				vertex_limit = view.chunks[c].vertex_count > vertex_limit ? view.chunks[c].vertex_count : vertex_limit;
+		}
+		return DecodeIndexBuffer( destination, view.info->index_count, view.info->index_size, vertex_limit, view.indices_encoded, view.indices_encoded_bytes );
+	}
+
+	void MeshAssetWriter::AddSection( MeshAssetSectionType type, uint32_t element_size, const void* data, size_t size )
+	{
+		PendingSection section = { type, element_size, data, size };
+		sections.push_back( section );
+	}
+
+	void MeshAssetWriter::Build( std::vector<uint8_t>& file ) const
+	{
+		uint64_t offset = AlignUp( sizeof( MeshAssetHeader ) + sections.size( ) * sizeof( MeshAssetSection ) );
+		std::vector<MeshAssetSection> table;
+		for ( const auto& pending : sections )
+		{
+			MeshAssetSection section = { uint32_t( pending.type ), pending.element_size, offset, pending.size };
+			table.push_back( section );
+			offset = AlignUp( offset + pending.size );
+		}
+
+		// padding stays zero, so identical input gives identical files
+		file.assign( size_t( offset ), 0 );
+		MeshAssetHeader header = { mesh_asset_magic, mesh_asset_version, uint32_t( sections.size( ) ), 0, offset };
+		std::memcpy( file.data( ), &header, sizeof( header ) );
+		if ( !table.empty( ) )
+			std::memcpy( file.data( ) + sizeof( header ), table.data( ), table.size( ) * sizeof( MeshAssetSection ) );
+		for ( size_t s = 0; s < sections.size( ); ++s )
+			if ( sections[s].size )
+				std::memcpy( file.data( ) + table[s].offset, sections[s].data, sections[s].size );
+	}
+
+	bool MeshAssetWriter::Save( const char* path ) const
+	{
+		std::vector<uint8_t> file;
+		Build( file );
+
+		FILE* out = std::fopen( path, "wb" );
+		if ( !out )
+			return false;
+		const bool written = std::fwrite( file.data( ), 1, file.size( ), out ) == file.size( );
+		return std::fclose( out ) == 0 && written;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IndexPacking.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "VertexEncoding.h"
+
+// binary mesh container, written by asset_tool and memory mapped by the renderer:
+//	MeshAssetHeader
+//	MeshAssetSection[section_count]
+//	payloads, each starting at a multiple of mesh_asset_alignment
+// Payloads are stored exactly the way the gpu or the renderer consume them, so loading a mesh means
+// checking the section table and handing out pointers into the mapping. Vertex and index data go from
+// there straight into upload heap memory, or are decoded into it when they're stored compressed, see
+// MeshCodec.h. Everything is little endian
+
+namespace DXLayer
+{
+	static const uint32_t mesh_asset_magic = 0x4d4c5844; // "DXLM"
+	static const uint32_t mesh_asset_version = 2; // 2 added the encoded sections, version 1 files still load
+	static const uint32_t mesh_asset_alignment = 64; // cache lines, so copies out of the mapping run at full speed
+
+	enum MeshAssetSectionType : uint32_t
+	{
+		mesh_section_info,					// one MeshAssetInfo
+		mesh_section_vertices,				// vertex_count vertices in vertex_format
+		mesh_section_indices,				// index_count indices of index_size bytes, all lods back to back
+		mesh_section_index_chunks,			// IndexChunk, draws of the whole index buffer
+		mesh_section_lods,					// MeshLod, lod 0 first
+		mesh_section_meshlets,				// Meshlet of lod 0, the next three sections come with it
+		mesh_section_meshlet_vertices,		// uint32_t
+		mesh_section_meshlet_triangles,		// uint32_t, three 8-bit local indices each
+		mesh_section_meshlet_bounds,		// PackedMeshletBounds
+		mesh_section_vertices_encoded,		// EncodeVertexBuffer output, instead of mesh_section_vertices
+		mesh_section_indices_encoded,		// EncodeIndexBuffer output, instead of mesh_section_indices
+		mesh_section_type_count
+	};
+
+	enum MeshVertexFormat : uint32_t
+	{
+		mesh_vertex_compact,				// CompactVertex, 12 bytes
+		mesh_vertex_compact_normal,			// CompactVertexNormal, 16 bytes
+		mesh_vertex_format_count
+	};
+
+	uint32_t MeshVertexStride( uint32_t vertex_format );
+
+	struct MeshAssetHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t section_count;
+		uint32_t reserved;
+		uint64_t file_size;
+	};
+
+	struct MeshAssetSection
+	{
+		uint32_t type;
+		uint32_t element_size;	// checked against the reader's struct sizes
+		uint64_t offset;		// from the start of the file
+		uint64_t size;			// in bytes, a multiple of element_size
+	};
+
+	struct MeshAssetInfo
+	{
+		uint32_t vertex_format;
+		uint32_t vertex_count;
+		uint32_t index_size;	// 2 or 4
+		uint32_t index_count;
+		MeshBounds bounds;		// positions are encoded relative to these
+	};
+
+	// pointers into the mapped file, valid while the mapping is open. Optional sections are null with a zero count.
+	// Each stream is either raw or encoded, the other pointer is null
+	struct MeshAssetView
+	{
+		const MeshAssetInfo* info;
+		const void* vertices;
+		size_t vertex_bytes;
+		const void* indices;
+		size_t index_bytes;
+		const uint8_t* vertices_encoded;
+		size_t vertices_encoded_bytes;
+		const uint8_t* indices_encoded;
+		size_t indices_encoded_bytes;
+		const IndexChunk* chunks;
+		uint32_t chunk_count;
+		const MeshLod* lods;
+		uint32_t lod_count;
+		const Meshlet* meshlets;
+		uint32_t meshlet_count;
+		const uint32_t* meshlet_vertices;
+		uint32_t meshlet_vertex_count;
+		const uint32_t* meshlet_triangles;
+		uint32_t meshlet_triangle_count;
+		const PackedMeshletBounds* meshlet_bounds;
+	};
+
+	// validates the header and section table and checks every range against the file and the index buffer.
+	// Only the info, chunk, lod and meshlet tables are read, vertex and index payloads are never touched.
+	// Encoded payloads are validated by their decoder
+	bool ReadMeshAsset( const void* data, size_t size, MeshAssetView& view, std::string& error );
+
+	// raw or encoded vertex and index data into the buffers, the destination is only written.
+	// The sizes are info->vertex_count * stride and info->index_count * info->index_size
+	bool CopyMeshAssetVertices( const MeshAssetView& view, void* destination );
+	bool CopyMeshAssetIndices( const MeshAssetView& view, void* destination );
+
+	// collects sections and lays them out. The data has to stay alive until Build or Save
+	class MeshAssetWriter
+	{
+	public:
+		void AddSection( MeshAssetSectionType type, uint32_t element_size, const void* data, size_t size );
+
+		template <typename T>
+		void AddSection( MeshAssetSectionType type, const std::vector<T>& elements )
+		{
+			AddSection( type, uint32_t( sizeof( T ) ), elements.data( ), elements.size( ) * sizeof( T ) );
+		}
+
+		void Build( std::vector<uint8_t>& file ) const;
+		bool Save( const char* path ) const;
+
+	private:
+		struct PendingSection
+		{
+			MeshAssetSectionType type;
+			uint32_t element_size;
+			const void* data;
+			size_t size;
+		};
+
+		std::vector<PendingSection> sections;
+	};
+}
@@ -0,0 +1,664 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Simd.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const uint8_t vertex_codec_header = 0xa0;
+		const uint8_t index_codec_header = 0xe0;
+
+		const size_t group_size = 16;
+		const size_t max_vertex_size = 256;
+		const size_t max_block_bytes = 8192; // the decoder's two block buffers stay in l1
+
+		// group widths, 2 bits per group in the column header
+		enum GroupWidth { group_zero, group_2bit, group_4bit, group_8bit };
+
+		size_t BlockVertices( size_t vertex_size )
+		{
+			return std::min<size_t>( 256, std::max<size_t>( group_size, ( max_block_bytes / vertex_size ) & ~( group_size - 1 ) ) );
+		}
+
+		uint8_t Zigzag8( uint8_t delta )
+		{
+			return uint8_t( ( delta << 1 ) ^ uint8_t( int8_t( delta ) >> 7 ) );
+		}
+
+		uint8_t Unzigzag8( uint8_t value )
+		{
+			return uint8_t( ( value >> 1 ) ^ uint8_t( -int( value & 1 ) ) );
+		}
+
+		// bytes a group takes at the given width, escapes included
+		size_t GroupCost( const uint8_t* values, int width )
+		{
+			if ( width == group_zero )
+			{
+				for ( size_t i = 0; i < group_size; ++i )
+					if ( values[i] )
+						return ~size_t( 0 );
+				return 0;
+			}
+			if ( width == group_8bit )
+				return group_size;
+
+			const int bits = width == group_2bit ? 2 : 4;
+			const uint8_t sentinel = uint8_t( ( 1 << bits ) - 1 );
+			size_t cost = group_size * bits / 8;
+			for ( size_t i = 0; i < group_size; ++i )
+				cost += values[i] >= sentinel;
+			return cost;
+		}
+
+		void EncodeGroup( std::vector<uint8_t>& out, const uint8_t* values, int width )
+		{
+			if ( width == group_zero )
+				return;
+			if ( width == group_8bit )
+			{
+				out.insert( out.end( ), values, values + group_size );
+				return;
+			}
+
+			const int bits = width == group_2bit ? 2 : 4;
+			const int per_byte = 8 / bits;
+			const uint8_t sentinel = uint8_t( ( 1 << bits ) - 1 );
+			for ( size_t i = 0; i < group_size; i += per_byte )
+			{
+				uint8_t packed = 0;
+				for ( int j = 0; j < per_byte; ++j )
+					packed |= uint8_t( std::min( values[i + j], sentinel ) << ( j * bits ) );
+				out.push_back( packed );
+			}
+			for ( size_t i = 0; i < group_size; ++i )
+				if ( values[i] >= sentinel )
+					out.push_back( values[i] );
+		}
+
+		// index of the lowest set bit, mask isn't zero
+		int LowestBit( int mask )
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward( &index, static_cast<unsigned long>( mask ) );
+			return int( index );
+#else
+			return __builtin_ctz( unsigned( mask ) );
+#endif
+		}
+
+		// one group of zigzagged deltas into values[16]. Returns the data after the group, null when it runs past end
+		const uint8_t* DecodeGroupScalar( const uint8_t* data, const uint8_t* end, int width, uint8_t* values )
+		{
+			if ( width == group_zero )
+			{
+				std::memset( values, 0, group_size );
+				return data;
+			}
+			if ( width == group_8bit )
+			{
+				if ( size_t( end - data ) < group_size )
+					return nullptr;
+				std::memcpy( values, data, group_size );
+				return data + group_size;
+			}
+
+			const int bits = width == group_2bit ? 2 : 4;
+			const int per_byte = 8 / bits;
+			const size_t packed_size = group_size * bits / 8;
+			if ( size_t( end - data ) < packed_size )
+				return nullptr;
+			const uint8_t sentinel = uint8_t( ( 1 << bits ) - 1 );
+
+			for ( size_t i = 0; i < group_size; ++i )
+				values[i] = uint8_t( ( data[i / per_byte] >> ( ( i % per_byte ) * bits ) ) & sentinel );
+			data += packed_size;
+
+			for ( size_t i = 0; i < group_size; ++i )
+			{
+				if ( values[i] != sentinel )
+					continue;
+				if ( data == end )
+					return nullptr;
+				values[i] = *data++;
+			}
+			return data;
+		}
+
+#if DXL_SSE2
+		// same as DecodeGroupScalar, for groups with at least 16 bytes of data left. Widths are mixed about evenly in
+		// real meshes, so instead of branching on them all widths are unpacked from one load and the right one is
+		// picked by mask
+		const uint8_t* DecodeGroupSimd( const uint8_t* data, const uint8_t* end, int width, uint8_t* values )
+		{
+			static const uint8_t packed_sizes[4] = { 0, 4, 8, 16 };
+
+			const __m128i raw = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+
+			// every byte of the group gets a copy of its packed byte, then each lane masks out its own bits.
+			// There are no per-byte shifts in sse2, so the possible shifts are done on all lanes and blended by mask
+			const __m128i pairs = _mm_unpacklo_epi8( raw, raw );
+			const __m128i quads = _mm_unpacklo_epi16( pairs, pairs );
+			const __m128i two_bit = _mm_or_si128(
+				_mm_or_si128( _mm_and_si128( quads, _mm_set1_epi32( 0x00000003 ) ), _mm_and_si128( _mm_srli_epi16( quads, 2 ), _mm_set1_epi32( 0x00000300 ) ) ),
+				_mm_or_si128( _mm_and_si128( _mm_srli_epi16( quads, 4 ), _mm_set1_epi32( 0x00030000 ) ), _mm_and_si128( _mm_srli_epi16( quads, 6 ), _mm_set1_epi32( 0x03000000 ) ) ) );
+			const __m128i four_bit = _mm_or_si128( _mm_and_si128( pairs, _mm_set1_epi16( 0x000f ) ), _mm_and_si128( _mm_srli_epi16( pairs, 4 ), _mm_set1_epi16( 0x0f00 ) ) );
+
+			const __m128i selector = _mm_set1_epi8( char( width ) );
+			const __m128i is_two_bit = _mm_cmpeq_epi8( selector, _mm_set1_epi8( group_2bit ) );
+			const __m128i is_four_bit = _mm_cmpeq_epi8( selector, _mm_set1_epi8( group_4bit ) );
+			const __m128i is_raw = _mm_cmpeq_epi8( selector, _mm_set1_epi8( group_8bit ) );
+			const __m128i unpacked = _mm_or_si128( _mm_and_si128( is_raw, raw ),
+				_mm_or_si128( _mm_and_si128( is_two_bit, two_bit ), _mm_and_si128( is_four_bit, four_bit ) ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( values ), unpacked );
+			data += packed_sizes[width];
+
+			// escaped lanes take the next byte each, in lane order. Only the narrow widths have escapes
+			const __m128i sentinel = _mm_or_si128( _mm_and_si128( is_two_bit, _mm_set1_epi8( 3 ) ), _mm_and_si128( is_four_bit, _mm_set1_epi8( 15 ) ) );
+			const __m128i narrow = _mm_or_si128( is_two_bit, is_four_bit );
+			for ( int escapes = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( unpacked, sentinel ), narrow ) ); escapes; escapes &= escapes - 1 )
+			{
+				if ( data == end )
+					return nullptr;
+				values[LowestBit( escapes )] = *data++;
+			}
+			return data;
+		}
+#endif
+
+		const uint8_t* DecodeGroup( const uint8_t* data, const uint8_t* end, int width, uint8_t* values )
+		{
+#if DXL_SSE2
+			if ( size_t( end - data ) >= group_size )
+				return DecodeGroupSimd( data, end, width, values );
+#endif
+			return DecodeGroupScalar( data, end, width, values );
+		}
+
+		// zigzagged deltas of one column back to bytes, continuing from the column's byte in the previous vertex
+		void UndoDeltas( uint8_t* column, size_t count, uint8_t previous )
+		{
+			size_t v = 0;
+#if DXL_SSE2
+			const __m128i zero = _mm_setzero_si128( );
+			const __m128i low_bit = _mm_set1_epi8( 1 );
+			const __m128i low_seven = _mm_set1_epi8( 0x7f );
+			__m128i carry = _mm_set1_epi8( char( previous ) );
+			for ( ; v + group_size <= count; v += group_size )
+			{
+				const __m128i z = _mm_loadu_si128( reinterpret_cast<const __m128i*>( column + v ) );
+				__m128i d = _mm_xor_si128( _mm_and_si128( _mm_srli_epi16( z, 1 ), low_seven ), _mm_sub_epi8( zero, _mm_and_si128( z, low_bit ) ) );
+
+				// prefix sum over the 16 lanes in four shifted adds
+				d = _mm_add_epi8( d, _mm_slli_si128( d, 1 ) );
+				d = _mm_add_epi8( d, _mm_slli_si128( d, 2 ) );
+				d = _mm_add_epi8( d, _mm_slli_si128( d, 4 ) );
+				d = _mm_add_epi8( d, _mm_slli_si128( d, 8 ) );
+				d = _mm_add_epi8( d, carry );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( column + v ), d );
+
+				// broadcast lane 15
+				carry = _mm_unpackhi_epi8( d, d );
+				carry = _mm_shufflehi_epi16( carry, 0xff );
+				carry = _mm_shuffle_epi32( carry, 0xff );
+			}
+			if ( v > 0 )
+				previous = column[v - 1];
+#endif
+			for ( ; v < count; ++v )
+			{
+				previous = uint8_t( previous + Unzigzag8( column[v] ) );
+				column[v] = previous;
+			}
+		}
+
+		// columns[k * column_stride + v] -> vertices[v * vertex_size + k], count rounded up to a group
+		void TransposeColumns( const uint8_t* columns, size_t column_stride, size_t count, size_t vertex_size, uint8_t* vertices )
+		{
+#if DXL_SSE2
+			// 8 columns at a time while they last, 12 and 16 byte vertices are 8 + 4 and 8 + 8
+			size_t k = 0;
+			for ( ; k + 8 <= vertex_size; k += 8 )
+			{
+				const uint8_t* c = columns + k * column_stride;
+				for ( size_t v = 0; v < count; v += group_size )
+				{
+					__m128i t[8];
+					for ( int i = 0; i < 4; ++i )
+					{
+						const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + column_stride * ( i * 2 ) + v ) );
+						const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + column_stride * ( i * 2 + 1 ) + v ) );
+						t[i * 2] = _mm_unpacklo_epi8( a, b );
+						t[i * 2 + 1] = _mm_unpackhi_epi8( a, b );
+					}
+
+					// bytes 0-3 and 4-7 of 4 vertices each
+					const __m128i low[4] = { _mm_unpacklo_epi16( t[0], t[2] ), _mm_unpackhi_epi16( t[0], t[2] ), _mm_unpacklo_epi16( t[1], t[3] ), _mm_unpackhi_epi16( t[1], t[3] ) };
+					const __m128i high[4] = { _mm_unpacklo_epi16( t[4], t[6] ), _mm_unpackhi_epi16( t[4], t[6] ), _mm_unpacklo_epi16( t[5], t[7] ), _mm_unpackhi_epi16( t[5], t[7] ) };
+
+					uint8_t* out = vertices + v * vertex_size + k;
+					for ( int i = 0; i < 4; ++i )
+					{
+						const __m128i first = _mm_unpacklo_epi32( low[i], high[i] );
+						const __m128i second = _mm_unpackhi_epi32( low[i], high[i] );
+						_mm_storel_epi64( reinterpret_cast<__m128i*>( out ), first );
+						_mm_storel_epi64( reinterpret_cast<__m128i*>( out + vertex_size ), _mm_unpackhi_epi64( first, first ) );
+						_mm_storel_epi64( reinterpret_cast<__m128i*>( out + vertex_size * 2 ), second );
+						_mm_storel_epi64( reinterpret_cast<__m128i*>( out + vertex_size * 3 ), _mm_unpackhi_epi64( second, second ) );
+						out += vertex_size * 4;
+					}
+				}
+			}
+
+			for ( ; k < vertex_size; k += 4 )
+			{
+				const uint8_t* c = columns + k * column_stride;
+				for ( size_t v = 0; v < count; v += group_size )
+				{
+					const __m128i c0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + v ) );
+					const __m128i c1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + column_stride + v ) );
+					const __m128i c2 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + column_stride * 2 + v ) );
+					const __m128i c3 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( c + column_stride * 3 + v ) );
+
+					const __m128i t0 = _mm_unpacklo_epi8( c0, c1 );
+					const __m128i t1 = _mm_unpackhi_epi8( c0, c1 );
+					const __m128i t2 = _mm_unpacklo_epi8( c2, c3 );
+					const __m128i t3 = _mm_unpackhi_epi8( c2, c3 );
+
+					// four bytes of 4 vertices each
+					__m128i rows[4] = { _mm_unpacklo_epi16( t0, t2 ), _mm_unpackhi_epi16( t0, t2 ), _mm_unpacklo_epi16( t1, t3 ), _mm_unpackhi_epi16( t1, t3 ) };
+					uint8_t* out = vertices + v * vertex_size + k;
+					for ( int r = 0; r < 4; ++r )
+					{
+						for ( int j = 0; j < 4; ++j )
+						{
+							const int dword = _mm_cvtsi128_si32( rows[r] );
+							std::memcpy( out, &dword, 4 );
+							out += vertex_size;
+							rows[r] = _mm_srli_si128( rows[r], 4 );
+						}
+					}
+				}
+			}
+#else
+			for ( size_t v = 0; v < count; ++v )
+				for ( size_t k = 0; k < vertex_size; ++k )
+					vertices[v * vertex_size + k] = columns[k * column_stride + v];
+#endif
+		}
+
+		void WriteVarint( std::vector<uint8_t>& out, uint32_t value )
+		{
+			while ( value >= 0x80 )
+			{
+				out.push_back( uint8_t( value | 0x80 ) );
+				value >>= 7;
+			}
+			out.push_back( uint8_t( value ) );
+		}
+
+		bool ReadVarint( const uint8_t*& data, const uint8_t* end, uint32_t& value )
+		{
+			value = 0;
+			for ( int shift = 0; shift < 35; shift += 7 )
+			{
+				if ( data == end )
+					return false;
+				const uint8_t byte = *data++;
+				value |= uint32_t( byte & 0x7f ) << shift;
+				if ( !( byte & 0x80 ) )
+					return true;
+			}
+			return false;
+		}
+
+		uint32_t Zigzag32( int32_t value )
+		{
+			return ( uint32_t( value ) << 1 ) ^ uint32_t( value >> 31 );
+		}
+
+		int32_t Unzigzag32( uint32_t value )
+		{
+			return int32_t( value >> 1 ) ^ -int32_t( value & 1 );
+		}
+
+		// fifo of the edges new triangles can attach to. Both sides of the codec keep one in lockstep
+		const uint32_t edge_fifo_size = 16;		// 15 usable, code 0xf means no edge
+		const uint32_t vertex_fifo_size = 16;	// 14 usable, codes 0 and 0xf mean new and explicit
+		const uint32_t no_edge = 15;
+		const uint32_t vertex_next = 0;
+		const uint32_t vertex_explicit = 15;
+
+		struct IndexCodecState
+		{
+			uint32_t edges[edge_fifo_size][2];
+			uint32_t vertices[vertex_fifo_size];
+			uint32_t edge_head;
+			uint32_t vertex_head;
+			uint32_t next;	// the vertex a first use is expected to have
+			uint32_t last;	// explicit vertices are coded relative to the previous explicit one
+
+			IndexCodecState( )
+				: edge_head( 0 ), vertex_head( 0 ), next( 0 ), last( 0 )
+			{
+				std::memset( edges, 0xff, sizeof( edges ) );
+				std::memset( vertices, 0xff, sizeof( vertices ) );
+			}
+
+			void PushEdge( uint32_t a, uint32_t b )
+			{
+				edges[edge_head & ( edge_fifo_size - 1 )][0] = a;
+				edges[edge_head & ( edge_fifo_size - 1 )][1] = b;
+				edge_head++;
+			}
+
+			void PushVertex( uint32_t v )
+			{
+				vertices[vertex_head & ( vertex_fifo_size - 1 )] = v;
+				vertex_head++;
+			}
+
+			const uint32_t* Edge( uint32_t age ) const
+			{
+				return edges[( edge_head - 1 - age ) & ( edge_fifo_size - 1 )];
+			}
+
+			uint32_t Vertex( uint32_t age ) const
+			{
+				return vertices[( vertex_head - 1 - age ) & ( vertex_fifo_size - 1 )];
+			}
+
+			// 0 for a new vertex, 1 for a fifo hit, 2 when it has to be stored
+			int VertexCost( uint32_t v ) const
+			{
+				if ( v == next )
+					return 0;
+				for ( uint32_t age = 0; age < vertex_explicit - 1; ++age )
+					if ( Vertex( age ) == v )
+						return 1;
+				return 2;
+			}
+
+			// 0 new, 1..14 fifo, 15 explicit. Fifo hits don't go back into the fifo, it would just fill up with repeats
+			uint32_t EncodeVertex( uint32_t v, std::vector<uint8_t>& data )
+			{
+				if ( v == next )
+				{
+					next++;
+					PushVertex( v );
+					return vertex_next;
+				}
+				for ( uint32_t age = 0; age < vertex_explicit - 1; ++age )
+					if ( Vertex( age ) == v )
+						return age + 1;
+
+				WriteVarint( data, Zigzag32( int32_t( v - last ) ) );
+				last = v;
+				PushVertex( v );
+				return vertex_explicit;
+			}
+
+			bool DecodeVertex( uint32_t code, const uint8_t*& data, const uint8_t* end, uint32_t& v )
+			{
+				if ( code == vertex_next )
+				{
+					v = next++;
+					PushVertex( v );
+					return true;
+				}
+				if ( code < vertex_explicit )
+				{
+					v = Vertex( code - 1 );
+					return true;
+				}
+
+				uint32_t delta;
+				if ( !ReadVarint( data, end, delta ) )
+					return false;
+				v = last + uint32_t( Unzigzag32( delta ) );
+				last = v;
+				PushVertex( v );
+				return true;
+			}
+		};
+
+		template <typename T>
+		bool DecodeIndices( T* destination, size_t index_count, size_t vertex_count, const uint8_t* encoded, size_t encoded_size )
+		{
+			const size_t triangle_count = index_count / 3;
+			if ( encoded_size < 1 + triangle_count || encoded[0] != index_codec_header )
+				return false;
+
+			const uint8_t* codes = encoded + 1;
+			const uint8_t* data = codes + triangle_count;
+			const uint8_t* end = encoded + encoded_size;
+
+			IndexCodecState state;
+			for ( size_t t = 0; t < triangle_count; ++t )
+			{
+				const uint32_t code = codes[t];
+				uint32_t a, b, c;
+				if ( ( code >> 4 ) != no_edge )
+				{
+					const uint32_t* edge = state.Edge( code >> 4 );
+					a = edge[0];
+					b = edge[1];
+					if ( !state.DecodeVertex( code & 15, data, end, c ) )
+						return false;
+					state.PushEdge( c, b );
+					state.PushEdge( a, c );
+				}
+				else
+				{
+					uint32_t refs[3];
+					for ( int k = 0; k < 3; ++k )
+						if ( data == end || !state.DecodeVertex( ( *data++ ) & 15, data, end, refs[k] ) )
+							return false;
+					a = refs[0];
+					b = refs[1];
+					c = refs[2];
+					state.PushEdge( b, a );
+					state.PushEdge( c, b );
+					state.PushEdge( a, c );
+				}
+
+				if ( a >= vertex_count || b >= vertex_count || c >= vertex_count )
+					return false;
+				destination[t * 3 + 0] = T( a );
+				destination[t * 3 + 1] = T( b );
+				destination[t * 3 + 2] = T( c );
+			}
+			return data == end;
+		}
+	}
+
+	void EncodeVertexBuffer( std::vector<uint8_t>& encoded, const void* vertices, size_t vertex_count, size_t vertex_size )
+	{
+		encoded.clear( );
+		encoded.push_back( vertex_codec_header );
+
+		const uint8_t* bytes = static_cast<const uint8_t*>( vertices );
+		const size_t block_vertices = BlockVertices( vertex_size );
+		uint8_t previous[max_vertex_size] = { };
+		uint8_t column[256];
+
+		for ( size_t block_start = 0; block_start < vertex_count; block_start += block_vertices )
+		{
+			const size_t block_count = std::min( block_vertices, vertex_count - block_start );
+			const size_t group_count = ( block_count + group_size - 1 ) / group_size;
+			const uint8_t* block = bytes + block_start * vertex_size;
+
+			for ( size_t k = 0; k < vertex_size; ++k )
+			{
+				uint8_t last = previous[k];
+				for ( size_t v = 0; v < group_count * group_size; ++v )
+				{
+					if ( v < block_count )
+					{
+						const uint8_t value = block[v * vertex_size + k];
+						column[v] = Zigzag8( uint8_t( value - last ) );
+						last = value;
+					}
+					else
+						column[v] = 0;
+				}
+				previous[k] = last;
+
+				// widths first, so the decoder knows where every group starts
+				const size_t header_offset = encoded.size( );
+				encoded.resize( header_offset + ( group_count * 2 + 7 ) / 8, 0 );
+				for ( size_t g = 0; g < group_count; ++g )
+				{
+					int best_width = group_8bit;
+					size_t best_cost = group_size;
+					for ( int width = group_zero; width < group_8bit; ++width )
+					{
+						const size_t cost = GroupCost( column + g * group_size, width );
+						if ( cost < best_cost )
+						{
+							best_cost = cost;
+							best_width = width;
+						}
+					}
+					encoded[header_offset + g / 4] |= uint8_t( best_width << ( ( g % 4 ) * 2 ) );
+					EncodeGroup( encoded, column + g * group_size, best_width );
+				}
+			}
+		}
+	}
+
+	bool DecodeVertexBuffer( void* destination, size_t vertex_count, size_t vertex_size, const uint8_t* encoded, size_t encoded_size )
+	{
+		if ( vertex_size == 0 || vertex_size % 4 != 0 || vertex_size > max_vertex_size )
+			return false;
+		if ( encoded_size < 1 || encoded[0] != vertex_codec_header )
+			return false;
+
+		const uint8_t* data = encoded + 1;
+		const uint8_t* end = encoded + encoded_size;
+		uint8_t* out = static_cast<uint8_t*>( destination );
+
+		const size_t block_vertices = BlockVertices( vertex_size );
+		uint8_t previous[max_vertex_size] = { };
+		// one array for both, the gap keeps block writes from 4k aliasing the column reads
+		uint8_t buffers[max_block_bytes * 2 + 128];
+		uint8_t* columns = buffers;
+		uint8_t* block = buffers + max_block_bytes + 128;
+
+		for ( size_t block_start = 0; block_start < vertex_count; block_start += block_vertices )
+		{
+			const size_t block_count = std::min( block_vertices, vertex_count - block_start );
+			const size_t group_count = ( block_count + group_size - 1 ) / group_size;
+			const size_t padded_count = group_count * group_size;
+
+			for ( size_t k = 0; k < vertex_size; ++k )
+			{
+				const size_t header_size = ( group_count * 2 + 7 ) / 8;
+				if ( size_t( end - data ) < header_size )
+					return false;
+				const uint8_t* header = data;
+				data += header_size;
+
+				uint8_t* column = columns + k * padded_count;
+				for ( size_t g = 0; g < group_count; ++g )
+				{
+					const int width = ( header[g / 4] >> ( ( g % 4 ) * 2 ) ) & 3;
+					data = DecodeGroup( data, end, width, column + g * group_size );
+					if ( !data )
+						return false;
+				}
+
+				UndoDeltas( column, padded_count, previous[k] );
+				previous[k] = column[block_count - 1];
+			}
+
+			// whole vertices are assembled in the block buffer, the destination only sees sequential writes
+			TransposeColumns( columns, padded_count, padded_count, vertex_size, block );
+			std::memcpy( out + block_start * vertex_size, block, block_count * vertex_size );
+		}
+		return data == end;
+	}
+
+	void EncodeIndexBuffer( std::vector<uint8_t>& encoded, const uint32_t* indices, size_t index_count )
+	{
+		const size_t triangle_count = index_count / 3;
+		encoded.assign( 1 + triangle_count, 0 );
+		encoded[0] = index_codec_header;
+
+		std::vector<uint8_t> data;
+		IndexCodecState state;
+		for ( size_t t = 0; t < triangle_count; ++t )
+		{
+			const uint32_t* triangle = indices + t * 3;
+
+			// of the rotations whose first edge is in the fifo, the one with the cheapest third vertex
+			uint32_t edge_age = no_edge;
+			int rotation = 0;
+			int best_cost = 3;
+			for ( int r = 0; r < 3; ++r )
+			{
+				const uint32_t a = triangle[r];
+				const uint32_t b = triangle[( r + 1 ) % 3];
+				for ( uint32_t age = 0; age < no_edge; ++age )
+				{
+					const uint32_t* edge = state.Edge( age );
+					if ( edge[0] != a || edge[1] != b )
+						continue;
+					const int cost = state.VertexCost( triangle[( r + 2 ) % 3] );
+					if ( cost < best_cost )
+					{
+						best_cost = cost;
+						edge_age = age;
+						rotation = r;
+					}
+					break;
+				}
+			}
+
+			if ( edge_age != no_edge )
+			{
+				const uint32_t a = triangle[rotation];
+				const uint32_t b = triangle[( rotation + 1 ) % 3];
+				const uint32_t c = triangle[( rotation + 2 ) % 3];
+				const uint32_t vertex_code = state.EncodeVertex( c, data );
+				encoded[1 + t] = uint8_t( ( edge_age << 4 ) | vertex_code );
+				state.PushEdge( c, b );
+				state.PushEdge( a, c );
+			}
+			else
+			{
+				// the vertex codes go to the data stream, explicit deltas right after their code
+				encoded[1 + t] = uint8_t( no_edge << 4 );
+				for ( int k = 0; k < 3; ++k )
+				{
+					const size_t code_offset = data.size( );
+					data.push_back( 0 );
+					data[code_offset] = uint8_t( state.EncodeVertex( triangle[k], data ) );
+				}
+				state.PushEdge( triangle[1], triangle[0] );
+				state.PushEdge( triangle[2], triangle[1] );
+				state.PushEdge( triangle[0], triangle[2] );
+			}
+		}
+		encoded.insert( encoded.end( ), data.begin( ), data.end( ) );
+	}
+
+	bool DecodeIndexBuffer( void* destination, size_t index_count, size_t index_size, size_t vertex_count, const uint8_t* encoded, size_t encoded_size )
+	{
+		if ( index_count % 3 != 0 )
+			return false;
+		if ( index_size == 2 )
+			return vertex_count <= 0x10000 && DecodeIndices( static_cast<uint16_t*>( destination ), index_count, vertex_count, encoded, encoded_size );
+		if ( index_size == 4 )
+			return DecodeIndices( static_cast<uint32_t*>( destination ), index_count, vertex_count, encoded, encoded_size );
+		return false;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// lossless compression for vertex and index buffers, used for mesh asset payloads.
+//
+// Vertices are coded per byte column: every byte of a vertex is delta coded against the same byte of the
+// previous vertex and zigzagged, so small signed changes become small bytes. Columns are then stored in
+// groups of 16 bytes at 0, 2, 4 or 8 bits each, the narrow widths with an escape for the odd outlier.
+// Decoding is sse2 and goes through a small block buffer, the destination is only written, sequentially,
+// so it can be write-combined upload heap memory.
+//
+// Indices are coded per triangle against a fifo of recent edges and a fifo of recent vertices. On a cache
+// optimized mesh with vertices in first-use order most triangles take one byte: the edge they share with
+// a recent triangle and whether the third vertex is new, recent or has to be stored explicitly.
+// Triangles may come back rotated, winding is kept
+
+namespace DXLayer
+{
+	// vertex_size has to be a multiple of 4 and at most 256
+	void EncodeVertexBuffer( std::vector<uint8_t>& encoded, const void* vertices, size_t vertex_count, size_t vertex_size );
+
+	// false on malformed or truncated data, destination contents are undefined then
+	bool DecodeVertexBuffer( void* destination, size_t vertex_count, size_t vertex_size, const uint8_t* encoded, size_t encoded_size );
+
+	// index_count has to be a multiple of 3
+	void EncodeIndexBuffer( std::vector<uint8_t>& encoded, const uint32_t* indices, size_t index_count );
+
+	// writes 16-bit or 32-bit indices. False on malformed data or indices that reach vertex_count
+	bool DecodeIndexBuffer( void* destination, size_t index_count, size_t index_size, size_t vertex_count, const uint8_t* encoded, size_t encoded_size );
+}
@@ -0,0 +1,412 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace DXLayer
+{
+	namespace
+	{
+		// fifo cache simulation. A vertex is cached while fewer than cache_size misses happened since it was loaded,
+		// so flushing the whole cache is just a jump of the timestamp
+		class FifoCache
+		{
+		public:
+			FifoCache( size_t vertex_count, uint32_t cache_size )
+				: timestamps( vertex_count, 0 ), timestamp( cache_size + 1 ), cache_size( cache_size )
+			{ }
+
+			// returns 1 on a miss
+			uint32_t Access( uint32_t vertex )
+			{
+				if ( timestamp - timestamps[vertex] <= cache_size )
+					return 0;
+				timestamps[vertex] = timestamp++;
+				return 1;
+			}
+
+			uint32_t AccessTriangle( const uint32_t* triangle )
+			{
+				return Access( triangle[0] ) + Access( triangle[1] ) + Access( triangle[2] );
+			}
+
+			void Flush( )
+			{
+				timestamp += cache_size + 1;
+			}
+
+		private:
+			std::vector<uint32_t> timestamps;
+			uint32_t timestamp;
+			uint32_t cache_size;
+		};
+
+		// Forsyth, "Linear-Speed Vertex Cache Optimisation"
+		const int forsyth_cache_size = 32;
+		const int forsyth_max_valence = 64; // higher valences use the last table entry, the boost is tiny by then anyway
+
+		struct ForsythScores
+		{
+			float cache[forsyth_cache_size];
+			float valence[forsyth_max_valence + 1];
+
+			ForsythScores( )
+			{
+				const float cache_decay_power = 1.5f;
+				const float last_triangle_score = 0.75f;
+				const float valence_boost_scale = 2.0f;
+				const float valence_boost_power = 0.5f;
+
+				for ( int i = 0; i < forsyth_cache_size; ++i )
+				{
+					// the vertices of the last triangle get a fixed score, so the next triangle doesn't just walk back over it
+					if ( i < 3 )
+						cache[i] = last_triangle_score;
+					else
+						cache[i] = std::pow( 1.0f - float( i - 3 ) / float( forsyth_cache_size - 3 ), cache_decay_power );
+				}
+
+				// vertices with few triangles left are boosted, so lone triangles get emitted instead of left behind
+				valence[0] = 0.0f;
+				for ( int i = 1; i <= forsyth_max_valence; ++i )
+					valence[i] = valence_boost_scale * std::pow( float( i ), -valence_boost_power );
+			}
+
+			float Vertex( int cache_position, uint32_t live_triangles ) const
+			{
+				if ( live_triangles == 0 )
+					return -1.0f;
+				const float cache_score = cache_position >= 0 ? cache[cache_position] : 0.0f;
+				return cache_score + valence[std::min<uint32_t>( live_triangles, forsyth_max_valence )];
+			}
+		};
+
+		struct Float3
+		{
+			float x, y, z;
+		};
+
+		Float3 LoadPosition( const float* positions, size_t stride, uint32_t vertex )
+		{
+			const float* p = reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + stride * vertex );
+			Float3 result = { p[0], p[1], p[2] };
+			return result;
+		}
+	}
+
+	VertexCacheStats AnalyzeVertexCache( const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size )
+	{
+		FifoCache cache( vertex_count, cache_size );
+		std::vector<bool> referenced( vertex_count, false );
+
+		VertexCacheStats stats = { };
+		size_t unique_vertices = 0;
+		for ( size_t i = 0; i < index_count; ++i )
+		{
+			stats.vertices_transformed += cache.Access( indices[i] );
+			if ( !referenced[indices[i]] )
+			{
+				referenced[indices[i]] = true;
+				unique_vertices++;
+			}
+		}
+
+		stats.acmr = index_count ? float( stats.vertices_transformed ) / float( index_count / 3 ) : 0.0f;
+		stats.atvr = unique_vertices ? float( stats.vertices_transformed ) / float( unique_vertices ) : 0.0f;
+		return stats;
+	}
+
+	VertexFetchStats AnalyzeVertexFetch( const uint32_t* indices, size_t index_count, size_t vertex_count, size_t vertex_size )
+	{
+		const size_t line_size = 64;
+		const uint32_t cache_lines = 128 * 1024 / line_size;
+
+		FifoCache cache( ( vertex_count * vertex_size + line_size - 1 ) / line_size, cache_lines );
+		std::vector<bool> referenced( vertex_count, false );
+
+		VertexFetchStats stats = { };
+		size_t unique_vertices = 0;
+		for ( size_t i = 0; i < index_count; ++i )
+		{
+			const size_t first_line = indices[i] * vertex_size / line_size;
+			const size_t last_line = ( ( indices[i] + 1 ) * vertex_size - 1 ) / line_size;
+			for ( size_t line = first_line; line <= last_line; ++line )
+				stats.bytes_fetched += cache.Access( uint32_t( line ) ) * uint32_t( line_size );
+
+			if ( !referenced[indices[i]] )
+			{
+				referenced[indices[i]] = true;
+				unique_vertices++;
+			}
+		}
+
+		stats.overfetch = unique_vertices ? float( stats.bytes_fetched ) / float( unique_vertices * vertex_size ) : 0.0f;
+		return stats;
+	}
+
+	void OptimizeVertexCache( uint32_t* destination, const uint32_t* indices, size_t index_count, size_t vertex_count )
+	{
+		static const ForsythScores scores;
+
+		const size_t triangle_count = index_count / 3;
+
+		// vertex -> triangles that still have to be emitted, the live part of each list shrinks as triangles go out
+		std::vector<uint32_t> live_triangles( vertex_count, 0 );
+		for ( size_t i = 0; i < index_count; ++i )
+			live_triangles[indices[i]]++;
+
+		std::vector<uint32_t> adjacency_offsets( vertex_count + 1, 0 );
+		for ( size_t v = 0; v < vertex_count; ++v )
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+
+		std::vector<uint32_t> adjacency( index_count );
+		{
+			std::vector<uint32_t> fill( adjacency_offsets.begin( ), adjacency_offsets.end( ) - 1 );
+			for ( size_t i = 0; i < index_count; ++i )
+				adjacency[fill[indices[i]]++] = uint32_t( i / 3 );
+		}
+
+		std::vector<int> cache_position( vertex_count, -1 );
+		std::vector<float> vertex_score( vertex_count );
+		for ( size_t v = 0; v < vertex_count; ++v )
+			vertex_score[v] = scores.Vertex( -1, live_triangles[v] );
+
+		std::vector<float> triangle_score( triangle_count );
+		for ( size_t t = 0; t < triangle_count; ++t )
+			triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+
+		std::vector<bool> emitted( triangle_count, false );
+
+		uint32_t cache[forsyth_cache_size + 3];
+		int cache_count = 0;
+
+		size_t input_cursor = 0; // restarts pick the next triangle in input order, which keeps this linear
+		int best_triangle = -1;
+
+		for ( size_t output = 0; output < triangle_count; ++output )
+		{
+			if ( best_triangle < 0 )
+			{
+				while ( emitted[input_cursor] )
+					input_cursor++;
+				best_triangle = int( input_cursor );
+			}
+
+			const uint32_t* triangle = &indices[best_triangle * 3];
+			std::memcpy( &destination[output * 3], triangle, 3 * sizeof( uint32_t ) );
+			emitted[best_triangle] = true;
+
+			// the triangle is no longer live for its vertices
+			for ( int k = 0; k < 3; ++k )
+			{
+				const uint32_t v = triangle[k];
+				uint32_t* begin = &adjacency[adjacency_offsets[v]];
+				uint32_t* end = begin + live_triangles[v];
+				uint32_t* it = std::find( begin, end, uint32_t( best_triangle ) );
+				std::swap( *it, *( end - 1 ) );
+				live_triangles[v]--;
+			}
+
+			// the triangle's vertices move to the front of the lru, the rest shift back
+			uint32_t new_cache[forsyth_cache_size + 3];
+			int new_count = 0;
+			for ( int k = 0; k < 3; ++k )
+				new_cache[new_count++] = triangle[k];
+			for ( int i = 0; i < cache_count; ++i )
+				if ( cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2] )
+					new_cache[new_count++] = cache[i];
+
+			// vertices that fell out of the cache lose their cache score
+			for ( int i = forsyth_cache_size; i < new_count; ++i )
+				cache_position[new_cache[i]] = -1;
+
+			cache_count = std::min( new_count, forsyth_cache_size );
+			std::memcpy( cache, new_cache, cache_count * sizeof( uint32_t ) );
+
+			// rescore everything that moved and find the best triangle touching the cache
+			float best_score = -1.0f;
+			best_triangle = -1;
+
+			for ( int i = 0; i < new_count; ++i )
+			{
+				const uint32_t v = new_cache[i];
+				if ( i < forsyth_cache_size )
+					cache_position[v] = i;
+
+				const float score = scores.Vertex( cache_position[v], live_triangles[v] );
+				const float delta = score - vertex_score[v];
+				vertex_score[v] = score;
+
+				const uint32_t* adjacent = &adjacency[adjacency_offsets[v]];
+				for ( uint32_t j = 0; j < live_triangles[v]; ++j )
+					triangle_score[adjacent[j]] += delta;
+			}
+
+			for ( int i = 0; i < cache_count; ++i )
+			{
+				const uint32_t v = cache[i];
+				const uint32_t* adjacent = &adjacency[adjacency_offsets[v]];
+				for ( uint32_t j = 0; j < live_triangles[v]; ++j )
+				{
+					if ( triangle_score[adjacent[j]] > best_score )
+					{
+						best_score = triangle_score[adjacent[j]];
+						best_triangle = int( adjacent[j] );
+					}
+				}
+			}
+		}
+	}
+
+	void OptimizeOverdraw( uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count, float threshold )
+	{
+		const size_t triangle_count = index_count / 3;
+		if ( triangle_count == 0 )
+			return;
+
+		// hard boundaries: triangles where the cache optimizer had to restart, reordering there costs nothing
+		std::vector<size_t> hard_clusters;
+		{
+			FifoCache cache( vertex_count, default_vertex_cache_size );
+			for ( size_t t = 0; t < triangle_count; ++t )
+				if ( cache.AccessTriangle( &indices[t * 3] ) == 3 || t == 0 )
+					hard_clusters.push_back( t );
+		}
+		hard_clusters.push_back( triangle_count );
+
+		// soft boundaries: split hard clusters further wherever the running acmr already got close enough to the cluster's acmr
+		std::vector<size_t> clusters;
+		{
+			FifoCache cache( vertex_count, default_vertex_cache_size );
+			for ( size_t c = 0; c + 1 < hard_clusters.size( ); ++c )
+			{
+				const size_t begin = hard_clusters[c];
+				const size_t end = hard_clusters[c + 1];
+
+				cache.Flush( );
+				uint32_t cluster_misses = 0;
+				for ( size_t t = begin; t < end; ++t )
+					cluster_misses += cache.AccessTriangle( &indices[t * 3] );
+				const float cluster_threshold = threshold * float( cluster_misses ) / float( end - begin );
+
+				cache.Flush( );
+				clusters.push_back( begin );
+				size_t sub_begin = begin;
+				uint32_t misses = 0;
+				for ( size_t t = begin; t + 1 < end; ++t )
+				{
+					misses += cache.AccessTriangle( &indices[t * 3] );
+					if ( float( misses ) / float( t - sub_begin + 1 ) <= cluster_threshold )
+					{
+						clusters.push_back( t + 1 );
+						sub_begin = t + 1;
+						misses = 0;
+						cache.Flush( );
+					}
+				}
+			}
+		}
+		clusters.push_back( triangle_count );
+
+		// sort key: how much the cluster faces away from the mesh center. Outward facing clusters occlude the rest
+		const size_t cluster_count = clusters.size( ) - 1;
+		std::vector<Float3> centroids( cluster_count );
+		std::vector<Float3> normals( cluster_count );
+
+		Float3 mesh_centroid = { 0.0f, 0.0f, 0.0f };
+		float mesh_area = 0.0f;
+
+		for ( size_t c = 0; c < cluster_count; ++c )
+		{
+			Float3 centroid = { 0.0f, 0.0f, 0.0f };
+			Float3 normal = { 0.0f, 0.0f, 0.0f };
+			float area = 0.0f;
+
+			for ( size_t t = clusters[c]; t < clusters[c + 1]; ++t )
+			{
+				const Float3 p0 = LoadPosition( positions, position_stride, indices[t * 3] );
+				const Float3 p1 = LoadPosition( positions, position_stride, indices[t * 3 + 1] );
+				const Float3 p2 = LoadPosition( positions, position_stride, indices[t * 3 + 2] );
+
+				const Float3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+				const Float3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+				const Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+				const float triangle_area = std::sqrt( n.x * n.x + n.y * n.y + n.z * n.z );
+
+				centroid.x += ( p0.x + p1.x + p2.x ) * ( triangle_area / 3.0f );
+				centroid.y += ( p0.y + p1.y + p2.y ) * ( triangle_area / 3.0f );
+				centroid.z += ( p0.z + p1.z + p2.z ) * ( triangle_area / 3.0f );
+				normal.x += n.x;
+				normal.y += n.y;
+				normal.z += n.z;
+				area += triangle_area;
+			}
+
+			mesh_centroid.x += centroid.x;
+			mesh_centroid.y += centroid.y;
+			mesh_centroid.z += centroid.z;
+			mesh_area += area;
+
+			const float inv_area = area > 0.0f ? 1.0f / area : 0.0f;
+			centroids[c].x = centroid.x * inv_area;
+			centroids[c].y = centroid.y * inv_area;
+			centroids[c].z = centroid.z * inv_area;
+
+			const float normal_length = std::sqrt( normal.x * normal.x + normal.y * normal.y + normal.z * normal.z );
+			const float inv_length = normal_length > 0.0f ? 1.0f / normal_length : 0.0f;
+			normals[c].x = normal.x * inv_length;
+			normals[c].y = normal.y * inv_length;
+			normals[c].z = normal.z * inv_length;
+		}
+
+		const float inv_mesh_area = mesh_area > 0.0f ? 1.0f / mesh_area : 0.0f;
+		mesh_centroid.x *= inv_mesh_area;
+		mesh_centroid.y *= inv_mesh_area;
+		mesh_centroid.z *= inv_mesh_area;
+
+		std::vector<float> sort_keys( cluster_count );
+		for ( size_t c = 0; c < cluster_count; ++c )
+		{
+			sort_keys[c] = ( centroids[c].x - mesh_centroid.x ) * normals[c].x
+				+ ( centroids[c].y - mesh_centroid.y ) * normals[c].y
+				+ ( centroids[c].z - mesh_centroid.z ) * normals[c].z;
+		}
+
+		std::vector<uint32_t> order( cluster_count );
+		for ( size_t c = 0; c < cluster_count; ++c )
+			order[c] = uint32_t( c );
+		std::stable_sort( order.begin( ), order.end( ), [&sort_keys] ( uint32_t a, uint32_t b ) { return sort_keys[a] > sort_keys[b]; } );
+
+		size_t output = 0;
+		for ( uint32_t c : order )
+		{
+			const size_t count = ( clusters[c + 1] - clusters[c] ) * 3;
+			std::memcpy( &destination[output], &indices[clusters[c] * 3], count * sizeof( uint32_t ) );
+			output += count;
+		}
+	}
+
+	size_t OptimizeVertexFetch( void* destination, uint32_t* indices, size_t index_count, const void* vertices, size_t vertex_count, size_t vertex_size )
+	{
+		const uint32_t unused = uint32_t( -1 );
+		std::vector<uint32_t> remap( vertex_count, unused );
+
+		const uint8_t* source = static_cast<const uint8_t*>( vertices );
+		uint8_t* target = static_cast<uint8_t*>( destination );
+
+		size_t next_vertex = 0;
+		for ( size_t i = 0; i < index_count; ++i )
+		{
+			uint32_t& new_index = remap[indices[i]];
+			if ( new_index == unused )
+			{
+				std::memcpy( target + next_vertex * vertex_size, source + size_t( indices[i] ) * vertex_size, vertex_size );
+				new_index = uint32_t( next_vertex++ );
+			}
+			indices[i] = new_index;
+		}
+		return next_vertex;
+	}
+}
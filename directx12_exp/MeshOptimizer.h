@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// offline reordering of indexed triangle lists, meant to run in the asset pipeline. The usual order is
+//	OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch
+// the first two only reorder triangles, the last one reorders vertices to match the final index order.
+// None of this changes what is rendered, only how fast the gpu gets through it
+
+namespace DXLayer
+{
+	// post-transform cache efficiency of an index order, simulated with a fifo cache
+	struct VertexCacheStats
+	{
+		uint32_t vertices_transformed;
+		float acmr;		// average cache miss ratio, transformed vertices per triangle. 0.5 is the ideal for big regular meshes, 3 the worst
+		float atvr;		// average transformed to vertex ratio, transformed vertices per referenced vertex. 1 is the ideal
+	};
+
+	// pre-transform (vertex fetch) efficiency, simulated with a 128KB cache of 64 byte lines
+	struct VertexFetchStats
+	{
+		uint32_t bytes_fetched;
+		float overfetch;	// fetched bytes per byte of referenced vertex data, 1 is the ideal
+	};
+
+	// 16 is close to what current gpus keep around between draws of neighbouring triangles
+	static const uint32_t default_vertex_cache_size = 16;
+
+	VertexCacheStats AnalyzeVertexCache( const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size = default_vertex_cache_size );
+
+	VertexFetchStats AnalyzeVertexFetch( const uint32_t* indices, size_t index_count, size_t vertex_count, size_t vertex_size );
+
+	// reorders triangles for post-transform cache hits using Forsyth's linear-speed algorithm with a 32 entry lru model,
+	// which doesn't depend on the exact cache size of the gpu. destination must not alias indices
+	void OptimizeVertexCache( uint32_t* destination, const uint32_t* indices, size_t index_count, size_t vertex_count );
+
+	// reorders clusters of a cache optimized index buffer so outward facing triangles come first, which lets
+	// early z reject more of what's behind them. Clusters are cut wherever that costs at most threshold times
+	// the acmr of the input (1.05 keeps 95% of the cache gains). destination must not alias indices
+	void OptimizeOverdraw( uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count, float threshold = 1.05f );
+
+	// reorders vertices by first use and rewrites indices in place. Unreferenced vertices are dropped,
+	// returns the new vertex count. destination must not alias vertices
+	size_t OptimizeVertexFetch( void* destination, uint32_t* indices, size_t index_count, const void* vertices, size_t vertex_count, size_t vertex_size );
+}
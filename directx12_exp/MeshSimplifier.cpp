@@ -0,0 +1,529 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "MeshOptimizer.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		struct Vector3
+		{
+			float x, y, z;
+		};
+
+		Vector3 Sub( const Vector3& a, const Vector3& b )
+		{
+			return { a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		Vector3 Cross( const Vector3& a, const Vector3& b )
+		{
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+		float Dot( const Vector3& a, const Vector3& b )
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		float Length( const Vector3& a )
+		{
+			return std::sqrt( Dot( a, a ) );
+		}
+
+		// sum of weighted squared distances to a set of planes, divided by the weight when evaluated
+		// so the error is an average squared distance independent of triangle size
+		struct Quadric
+		{
+			double a00, a11, a22, a10, a20, a21;
+			double b0, b1, b2;
+			double c;
+			double w;
+		};
+
+		Quadric PlaneQuadric( const Vector3& n, float d, float w )
+		{
+			Quadric q;
+			q.a00 = w * n.x * n.x;
+			q.a11 = w * n.y * n.y;
+			q.a22 = w * n.z * n.z;
+			q.a10 = w * n.y * n.x;
+			q.a20 = w * n.z * n.x;
+			q.a21 = w * n.z * n.y;
+			q.b0 = w * n.x * d;
+			q.b1 = w * n.y * d;
+			q.b2 = w * n.z * d;
+			q.c = w * d * d;
+			q.w = w;
+			return q;
+		}
+
+		void Add( Quadric& q, const Quadric& r )
+		{
+			q.a00 += r.a00;
+			q.a11 += r.a11;
+			q.a22 += r.a22;
+			q.a10 += r.a10;
+			q.a20 += r.a20;
+			q.a21 += r.a21;
+			q.b0 += r.b0;
+			q.b1 += r.b1;
+			q.b2 += r.b2;
+			q.c += r.c;
+			q.w += r.w;
+		}
+
+		// unnormalized, pT A p + 2 bT p + c
+		double Evaluate( const Quadric& q, const Vector3& p )
+		{
+			const double rx = q.b0 + q.a00 * p.x + q.a10 * p.y + q.a20 * p.z;
+			const double ry = q.b1 + q.a10 * p.x + q.a11 * p.y + q.a21 * p.z;
+			const double rz = q.b2 + q.a20 * p.x + q.a21 * p.y + q.a22 * p.z;
+			return rx * p.x + ry * p.y + rz * p.z + q.b0 * p.x + q.b1 * p.y + q.b2 * p.z + q.c;
+		}
+
+		// border planes are weighted up so open edges keep their shape longer than the surface next to them
+		const float border_weight = 10.0f;
+
+		enum VertexKind : uint8_t
+		{
+			vertex_manifold,	// collapses in any direction
+			vertex_border,		// on a single open border, collapses along it
+			vertex_locked		// seams, corners of several borders, non-manifold edges
+		};
+
+		const uint32_t no_vertex = ~0u;
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			float error;
+		};
+
+		// every vertex maps to the lowest vertex with the same position, which owns its quadric and kind.
+		// Sorting beats a hash map here, the chain runs this once per lod on the full vertex buffer
+		void BuildPositionRemap( const std::vector<Vector3>& positions, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge_count )
+		{
+			const auto less = [ &positions ]( uint32_t a, uint32_t b )
+			{
+				const Vector3& pa = positions[a];
+				const Vector3& pb = positions[b];
+				if ( pa.x != pb.x )
+					return pa.x < pb.x;
+				if ( pa.y != pb.y )
+					return pa.y < pb.y;
+				if ( pa.z != pb.z )
+					return pa.z < pb.z;
+				return a < b;
+			};
+
+			std::vector<uint32_t> order( positions.size( ) );
+			for ( uint32_t v = 0; v < uint32_t( order.size( ) ); ++v )
+				order[v] = v;
+			std::sort( order.begin( ), order.end( ), less );
+
+			remap.resize( positions.size( ) );
+			wedge_count.assign( positions.size( ), 0 );
+			uint32_t first = 0;
+			for ( size_t i = 0; i < order.size( ); ++i )
+			{
+				const Vector3& p = positions[order[i]];
+				const Vector3& q = positions[first];
+				if ( i == 0 || p.x != q.x || p.y != q.y || p.z != q.z )
+					first = order[i];
+				remap[order[i]] = first;
+				wedge_count[first]++;
+			}
+		}
+
+		// classifies canonical vertices from their open half edges (no twin going the other way) and records
+		// the border neighbours of border vertices
+		void ClassifyVertices( const uint32_t* indices, size_t index_count, const std::vector<uint32_t>& remap, const std::vector<uint32_t>& wedge_count,
+			std::vector<uint8_t>& kind, std::vector<uint32_t>& border_next, std::vector<uint32_t>& border_prev )
+		{
+			const size_t vertex_count = remap.size( );
+
+			// outgoing half edges per canonical vertex
+			std::vector<uint32_t> offsets( vertex_count + 1, 0 );
+			for ( size_t i = 0; i < index_count; ++i )
+				offsets[remap[indices[i]] + 1]++;
+			for ( size_t v = 0; v < vertex_count; ++v )
+				offsets[v + 1] += offsets[v];
+			std::vector<uint32_t> targets( index_count );
+			std::vector<uint32_t> fill( offsets.begin( ), offsets.end( ) - 1 );
+			for ( size_t i = 0; i < index_count; i += 3 )
+			{
+				for ( int k = 0; k < 3; ++k )
+				{
+					const uint32_t a = remap[indices[i + k]];
+					const uint32_t b = remap[indices[i + ( k + 1 ) % 3]];
+					targets[fill[a]++] = b;
+				}
+			}
+
+			std::vector<uint32_t> open_out( vertex_count, 0 );
+			std::vector<uint32_t> open_in( vertex_count, 0 );
+			kind.assign( vertex_count, vertex_manifold );
+			border_next.assign( vertex_count, no_vertex );
+			border_prev.assign( vertex_count, no_vertex );
+
+			for ( uint32_t a = 0; a < uint32_t( vertex_count ); ++a )
+			{
+				for ( uint32_t e = offsets[a]; e < offsets[a + 1]; ++e )
+				{
+					const uint32_t b = targets[e];
+					uint32_t same = 0;
+					for ( uint32_t f = offsets[a]; f < offsets[a + 1]; ++f )
+						same += targets[f] == b;
+					uint32_t twins = 0;
+					for ( uint32_t f = offsets[b]; f < offsets[b + 1]; ++f )
+						twins += targets[f] == a;
+
+					if ( same > 1 || twins > 1 )
+					{
+						kind[a] = vertex_locked;
+						kind[b] = vertex_locked;
+					}
+					else if ( twins == 0 )
+					{
+						open_out[a]++;
+						open_in[b]++;
+						border_next[a] = b;
+						border_prev[b] = a;
+					}
+				}
+			}
+
+			for ( uint32_t v = 0; v < uint32_t( vertex_count ); ++v )
+			{
+				if ( remap[v] != v || kind[v] == vertex_locked )
+					continue;
+				if ( wedge_count[v] > 1 )
+					kind[v] = vertex_locked;
+				else if ( open_out[v] == 1 && open_in[v] == 1 )
+					kind[v] = vertex_border;
+				else if ( open_out[v] != 0 || open_in[v] != 0 )
+					kind[v] = vertex_locked;
+			}
+		}
+
+		// upper bound of the error of the count-th cheapest collapse, within an eighth. Histogram over the float
+		// bits, which order like the values for positive floats, since nth_element crawls on the many equal
+		// errors of regular meshes
+		float ErrorQuantile( const std::vector<Collapse>& collapses, size_t count, std::vector<uint32_t>& histogram )
+		{
+			if ( count >= collapses.size( ) )
+				return std::numeric_limits<float>::max( );
+
+			const int bucket_shift = 20; // sign, exponent and 3 mantissa bits
+			histogram.assign( size_t( 1 ) << ( 32 - bucket_shift ), 0 );
+			for ( const Collapse& collapse : collapses )
+			{
+				uint32_t bits;
+				std::memcpy( &bits, &collapse.error, sizeof( bits ) );
+				histogram[bits >> bucket_shift]++;
+			}
+
+			size_t total = 0;
+			for ( uint32_t bucket = 0; bucket < uint32_t( histogram.size( ) ); ++bucket )
+			{
+				total += histogram[bucket];
+				if ( total > count )
+				{
+					const uint32_t bits = ( ( bucket + 1 ) << bucket_shift ) - 1;
+					float error;
+					std::memcpy( &error, &bits, sizeof( error ) );
+					return error;
+				}
+			}
+			return std::numeric_limits<float>::max( );
+		}
+
+		float CollapseError( const std::vector<Quadric>& quadrics, uint32_t from, uint32_t to, const Vector3& position )
+		{
+			const Quadric& q0 = quadrics[from];
+			const Quadric& q1 = quadrics[to];
+			const double weight = q0.w + q1.w;
+			if ( weight <= 0.0 )
+				return 0.0f;
+			return float( std::max( ( Evaluate( q0, position ) + Evaluate( q1, position ) ) / weight, 0.0 ) );
+		}
+	}
+
+	float MeshExtent( const float* positions, size_t position_stride, size_t vertex_count )
+	{
+		if ( vertex_count == 0 )
+			return 0.0f;
+
+		float minimum[3] = { positions[0], positions[1], positions[2] };
+		float maximum[3] = { positions[0], positions[1], positions[2] };
+		for ( size_t v = 0; v < vertex_count; ++v )
+		{
+			const float* p = reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + v * position_stride );
+			for ( int c = 0; c < 3; ++c )
+			{
+				minimum[c] = std::min( minimum[c], p[c] );
+				maximum[c] = std::max( maximum[c], p[c] );
+			}
+		}
+		return std::max( maximum[0] - minimum[0], std::max( maximum[1] - minimum[1], maximum[2] - minimum[2] ) );
+	}
+
+	size_t SimplifyMesh( uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		size_t target_index_count, float target_error, float* result_error )
+	{
+		if ( destination != indices )
+			std::memmove( destination, indices, index_count * sizeof( uint32_t ) );
+		if ( result_error )
+			*result_error = 0.0f;
+		if ( index_count <= target_index_count || vertex_count == 0 )
+			return index_count;
+
+		// positions scaled to a unit box, so errors come out relative to the extent
+		const float extent = MeshExtent( positions, position_stride, vertex_count );
+		const float inverse_extent = extent > 0.0f ? 1.0f / extent : 0.0f;
+		std::vector<Vector3> scaled( vertex_count );
+		for ( size_t v = 0; v < vertex_count; ++v )
+		{
+			const float* p = reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + v * position_stride );
+			scaled[v] = { p[0] * inverse_extent, p[1] * inverse_extent, p[2] * inverse_extent };
+		}
+
+		std::vector<uint32_t> remap, wedge_count;
+		BuildPositionRemap( scaled, remap, wedge_count );
+
+		std::vector<uint8_t> kind;
+		std::vector<uint32_t> border_next, border_prev;
+		ClassifyVertices( destination, index_count, remap, wedge_count, kind, border_next, border_prev );
+
+		// area weighted face planes, plus planes standing on open edges
+		std::vector<Quadric> quadrics( vertex_count, Quadric( ) );
+		for ( size_t i = 0; i < index_count; i += 3 )
+		{
+			const uint32_t corners[3] = { remap[destination[i]], remap[destination[i + 1]], remap[destination[i + 2]] };
+			const Vector3& p0 = scaled[corners[0]];
+			Vector3 normal = Cross( Sub( scaled[corners[1]], p0 ), Sub( scaled[corners[2]], p0 ) );
+			const float area = Length( normal );
+			if ( area > 0.0f )
+				normal = { normal.x / area, normal.y / area, normal.z / area };
+			const Quadric face = PlaneQuadric( normal, -Dot( normal, p0 ), area );
+			for ( int k = 0; k < 3; ++k )
+				Add( quadrics[corners[k]], face );
+
+			for ( int k = 0; k < 3; ++k )
+			{
+				const uint32_t a = corners[k];
+				const uint32_t b = corners[( k + 1 ) % 3];
+				if ( border_next[a] != b )
+					continue;
+
+				const Vector3 edge = Sub( scaled[b], scaled[a] );
+				Vector3 side = Cross( edge, normal );
+				const float side_length = Length( side );
+				if ( side_length == 0.0f )
+					continue;
+				side = { side.x / side_length, side.y / side_length, side.z / side_length };
+				const Quadric border = PlaneQuadric( side, -Dot( side, scaled[a] ), Dot( edge, edge ) * border_weight );
+				Add( quadrics[a], border );
+				Add( quadrics[b], border );
+			}
+		}
+
+		const float error_limit = target_error * target_error;
+		float max_error = 0.0f;
+
+		std::vector<uint32_t> triangle_offsets( vertex_count + 1 );
+		std::vector<uint32_t> vertex_triangles;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> collapse_target( vertex_count );
+		std::vector<uint8_t> touched( vertex_count );
+		std::vector<uint32_t> error_histogram;
+
+		while ( index_count > target_index_count )
+		{
+			// vertex -> triangles. Vertices that can move have one wedge, so every triangle uses the same id
+			std::fill( triangle_offsets.begin( ), triangle_offsets.end( ), 0 );
+			for ( size_t i = 0; i < index_count; ++i )
+				triangle_offsets[destination[i] + 1]++;
+			for ( size_t v = 0; v < vertex_count; ++v )
+				triangle_offsets[v + 1] += triangle_offsets[v];
+			vertex_triangles.resize( index_count );
+			{
+				std::vector<uint32_t> fill( triangle_offsets.begin( ), triangle_offsets.end( ) - 1 );
+				for ( size_t i = 0; i < index_count; ++i )
+					vertex_triangles[fill[destination[i]]++] = uint32_t( i / 3 );
+			}
+
+			// cheapest direction of every edge. Interior edges show up in two triangles and only the one going
+			// to the higher vertex counts, open edges only have the one
+			collapses.clear( );
+			for ( size_t i = 0; i < index_count; i += 3 )
+			{
+				for ( int k = 0; k < 3; ++k )
+				{
+					const uint32_t v0 = destination[i + k];
+					const uint32_t v1 = destination[i + ( k + 1 ) % 3];
+					const uint32_t r0 = remap[v0];
+					const uint32_t r1 = remap[v1];
+					if ( r0 > r1 && border_next[r0] != r1 && border_prev[r1] != r0 )
+						continue;
+
+					const bool forward = kind[r0] == vertex_manifold || ( kind[r0] == vertex_border && ( border_next[r0] == r1 || border_prev[r0] == r1 ) );
+					const bool backward = kind[r1] == vertex_manifold || ( kind[r1] == vertex_border && ( border_next[r1] == r0 || border_prev[r1] == r0 ) );
+					if ( !forward && !backward )
+						continue;
+
+					const float forward_error = forward ? CollapseError( quadrics, r0, r1, scaled[r1] ) : std::numeric_limits<float>::max( );
+					const float backward_error = backward ? CollapseError( quadrics, r1, r0, scaled[r0] ) : std::numeric_limits<float>::max( );
+					if ( forward_error <= backward_error )
+						collapses.push_back( { v0, v1, forward_error } );
+					else
+						collapses.push_back( { v1, v0, backward_error } );
+				}
+			}
+			if ( collapses.empty( ) )
+				break;
+
+			// an interior collapse removes two triangles. Collapses much worse than the ones this pass would need
+			// wait for the next pass, where cheaper edges blocked by touched vertices get their turn
+			const size_t collapse_goal = ( index_count - target_index_count ) / 6 + 1;
+			const float pass_limit = std::min( error_limit, ErrorQuantile( collapses, collapse_goal, error_histogram ) * 1.5f );
+
+			// only the part this pass can use gets sorted
+			const auto pass_end = std::partition( collapses.begin( ), collapses.end( ), [ pass_limit ]( const Collapse& c ) { return c.error <= pass_limit; } );
+			std::sort( collapses.begin( ), pass_end, [ ]( const Collapse& a, const Collapse& b ) { return a.error < b.error; } );
+			collapses.erase( pass_end, collapses.end( ) );
+
+			for ( size_t v = 0; v < vertex_count; ++v )
+				collapse_target[v] = uint32_t( v );
+			std::fill( touched.begin( ), touched.end( ), uint8_t( 0 ) );
+
+			size_t collapse_count = 0;
+			float pass_error = 0.0f;
+			for ( const Collapse& collapse : collapses )
+			{
+				if ( collapse_count >= collapse_goal )
+					break;
+
+				const uint32_t from = collapse.from;
+				const uint32_t to = collapse.to;
+				const uint32_t r0 = remap[from];
+				const uint32_t r1 = remap[to];
+				if ( touched[r0] || touched[r1] )
+					continue;
+
+				// reject collapses that flip or nearly flip a triangle that survives them. Corners that already
+				// collapsed this pass are looked at where they moved to
+				bool flips = false;
+				for ( uint32_t t = triangle_offsets[from]; t < triangle_offsets[from + 1] && !flips; ++t )
+				{
+					const uint32_t* triangle = destination + vertex_triangles[t] * 3;
+					const int k = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+					const uint32_t a = collapse_target[triangle[( k + 1 ) % 3]];
+					const uint32_t b = collapse_target[triangle[( k + 2 ) % 3]];
+					if ( remap[a] == r1 || remap[b] == r1 || remap[a] == remap[b] )
+						continue;
+
+					const Vector3& pa = scaled[a];
+					const Vector3& pb = scaled[b];
+					const Vector3 before = Cross( Sub( pa, scaled[from] ), Sub( pb, scaled[from] ) );
+					const Vector3 after = Cross( Sub( pa, scaled[to] ), Sub( pb, scaled[to] ) );
+					flips = Dot( before, after ) <= 1e-2f * Length( before ) * Length( after );
+				}
+				if ( flips )
+					continue;
+
+				Add( quadrics[r1], quadrics[r0] );
+				collapse_target[from] = to;
+
+				if ( kind[r0] == vertex_border )
+				{
+					const uint32_t next = border_next[r0];
+					const uint32_t prev = border_prev[r0];
+					if ( next == r1 )
+					{
+						border_prev[r1] = prev;
+						border_next[prev] = r1;
+					}
+					else
+					{
+						border_next[r1] = next;
+						border_prev[next] = r1;
+					}
+				}
+
+				// neither end moves again this pass, so collapse_target never needs more than one step
+				touched[r0] = 1;
+				touched[r1] = 1;
+
+				pass_error = std::max( pass_error, collapse.error );
+				collapse_count++;
+			}
+			if ( collapse_count == 0 )
+				break;
+			max_error = std::max( max_error, pass_error );
+
+			size_t write = 0;
+			for ( size_t i = 0; i < index_count; i += 3 )
+			{
+				const uint32_t a = collapse_target[destination[i]];
+				const uint32_t b = collapse_target[destination[i + 1]];
+				const uint32_t c = collapse_target[destination[i + 2]];
+				if ( remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a] )
+					continue;
+				destination[write++] = a;
+				destination[write++] = b;
+				destination[write++] = c;
+			}
+			index_count = write;
+		}
+
+		if ( result_error )
+			*result_error = std::sqrt( max_error );
+		return index_count;
+	}
+
+	void BuildLodChain( const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		std::vector<uint32_t>& lod_indices, std::vector<MeshLod>& lods, const LodChainOptions& options )
+	{
+		lod_indices.assign( indices, indices + index_count );
+		lods.clear( );
+		lods.push_back( { 0, uint32_t( index_count ), 0.0f } );
+
+		const float extent = MeshExtent( positions, position_stride, vertex_count );
+
+		// each lod starts from the previous one, so its error against lod 0 is at most the sum of the steps
+		std::vector<uint32_t> current( indices, indices + index_count );
+		std::vector<uint32_t> next;
+		float accumulated_error = 0.0f;
+		while ( lods.size( ) < options.max_lods && accumulated_error < options.max_error )
+		{
+			const size_t target_index_count = size_t( current.size( ) * options.reduction ) / 3 * 3;
+			if ( target_index_count < size_t( options.min_triangles ) * 3 )
+				break;
+
+			float error = 0.0f;
+			next.resize( current.size( ) );
+			const size_t next_count = SimplifyMesh( next.data( ), current.data( ), current.size( ), positions, position_stride, vertex_count,
+				target_index_count, options.max_error - accumulated_error, &error );
+
+			// stalled on locked vertices or the error limit, another lod wouldn't save enough to be worth a switch
+			if ( next_count == 0 || next_count > current.size( ) * 9 / 10 )
+				break;
+
+			next.resize( next_count );
+			current.resize( next_count );
+			OptimizeVertexCache( current.data( ), next.data( ), next_count, vertex_count );
+			accumulated_error += error;
+
+			lods.push_back( { uint32_t( lod_indices.size( ) ), uint32_t( next_count ), accumulated_error * extent } );
+			lod_indices.insert( lod_indices.end( ), current.begin( ), current.end( ) );
+		}
+	}
+}
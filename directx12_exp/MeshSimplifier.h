@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// quadric error metric simplification and lod chains built on top of it. Edges collapse into one of
+// their existing vertices, so every lod keeps using the original vertex buffer and a lod is only an
+// index range. Open borders only collapse along themselves, vertices on attribute seams (same position,
+// different vertex) and non-manifold vertices never move
+
+namespace DXLayer
+{
+	// simplifies until the index count drops to target_index_count or the next collapse would exceed
+	// target_error, relative to the mesh extent (0.01 = 1% of the largest bounding box side).
+	// Returns the new index count, result_error receives the error reached in the same units.
+	// destination may alias indices
+	size_t SimplifyMesh( uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		size_t target_index_count, float target_error, float* result_error = nullptr );
+
+	// largest side of the bounding box, what SimplifyMesh errors are relative to
+	float MeshExtent( const float* positions, size_t position_stride, size_t vertex_count );
+
+	struct MeshLod
+	{
+		uint32_t first_index;	// StartIndexLocation
+		uint32_t index_count;	// IndexCountPerInstance
+		float error;			// object space distance from the full detail mesh, 0 for lod 0
+	};
+
+	struct LodChainOptions
+	{
+		LodChainOptions( )
+			: max_lods( 6 ), reduction( 0.5f ), max_error( 0.05f ), min_triangles( 32 )
+		{ }
+
+		uint32_t max_lods;		// including lod 0
+		float reduction;		// target index count of a lod relative to the previous one
+		float max_error;		// relative to the mesh extent, no lod goes beyond this
+		uint32_t min_triangles;
+	};
+
+	// builds lods from full detail down, each simplified from the previous one and cache optimized.
+	// All lods end up in lod_indices back to back. The chain stops early once simplification stalls
+	void BuildLodChain( const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		std::vector<uint32_t>& lod_indices, std::vector<MeshLod>& lods, const LodChainOptions& options = LodChainOptions( ) );
+}
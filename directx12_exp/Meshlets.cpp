@@ -0,0 +1,485 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace DXLayer
+{
+	namespace
+	{
+		struct Float3
+		{
+			float x, y, z;
+		};
+
+		Float3 operator-( const Float3& a, const Float3& b ) { Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+		Float3 operator+( const Float3& a, const Float3& b ) { Float3 r = { a.x + b.x, a.y + b.y, a.z + b.z }; return r; }
+		Float3 operator*( const Float3& a, float s ) { Float3 r = { a.x * s, a.y * s, a.z * s }; return r; }
+		float Dot( const Float3& a, const Float3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		float Length( const Float3& a ) { return std::sqrt( Dot( a, a ) ); }
+
+		Float3 Cross( const Float3& a, const Float3& b )
+		{
+			Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+			return r;
+		}
+
+		Float3 Normalize( const Float3& a )
+		{
+			const float length = Length( a );
+			return length > 0.0f ? a * ( 1.0f / length ) : a;
+		}
+
+		Float3 LoadPosition( const float* positions, size_t stride, uint32_t vertex )
+		{
+			const float* p = reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + stride * vertex );
+			Float3 result = { p[0], p[1], p[2] };
+			return result;
+		}
+
+		// unit normal, zero for degenerate triangles
+		Float3 TriangleNormal( const Float3& p0, const Float3& p1, const Float3& p2 )
+		{
+			return Normalize( Cross( p1 - p0, p2 - p0 ) );
+		}
+
+		uint32_t PackTriangle( uint32_t a, uint32_t b, uint32_t c )
+		{
+			return a | ( b << 8 ) | ( c << 16 );
+		}
+
+		uint32_t LocalIndex( uint32_t packed, int corner )
+		{
+			return ( packed >> ( corner * 8 ) ) & 0xff;
+		}
+
+		// the cone only helps if every triangle leans towards the axis by a margin, otherwise it never culls anything
+		const float min_cone_dot = 0.1f;
+
+		float ConeCutoff( const Float3& axis, const std::vector<Float3>& normals )
+		{
+			float min_dot = 1.0f;
+			for ( const auto& normal : normals )
+				if ( Dot( normal, normal ) > 0.0f )
+					min_dot = std::min( min_dot, Dot( axis, normal ) );
+
+			return min_dot <= min_cone_dot ? 1.0f : std::sqrt( 1.0f - min_dot * min_dot );
+		}
+
+		void MeshletGeometry( const MeshletData& data, const Meshlet& meshlet, const float* positions, size_t position_stride,
+			std::vector<Float3>& vertex_positions, std::vector<Float3>& normals, std::vector<Float3>& triangle_points )
+		{
+			vertex_positions.clear( );
+			normals.clear( );
+			triangle_points.clear( );
+
+			for ( uint32_t v = 0; v < meshlet.vertex_count; ++v )
+				vertex_positions.push_back( LoadPosition( positions, position_stride, data.vertices[meshlet.vertex_offset + v] ) );
+
+			for ( uint32_t t = 0; t < meshlet.triangle_count; ++t )
+			{
+				const uint32_t packed = data.triangles[meshlet.triangle_offset + t];
+				const Float3& p0 = vertex_positions[LocalIndex( packed, 0 )];
+				const Float3& p1 = vertex_positions[LocalIndex( packed, 1 )];
+				const Float3& p2 = vertex_positions[LocalIndex( packed, 2 )];
+				normals.push_back( TriangleNormal( p0, p1, p2 ) );
+				triangle_points.push_back( p0 );
+			}
+		}
+
+		int8_t QuantizeSnorm8( float value )
+		{
+			return int8_t( std::floor( std::min( std::max( value, -1.0f ), 1.0f ) * 127.0f + 0.5f ) );
+		}
+	}
+
+	void BuildMeshlets( MeshletData& out, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		uint32_t max_vertices, uint32_t max_triangles, float cone_weight )
+	{
+		max_vertices = std::min( std::max( max_vertices, 3u ), 256u ); // local indices are 8-bit
+		max_triangles = std::max( max_triangles, 1u );
+
+		out.meshlets.clear( );
+		out.vertices.clear( );
+		out.triangles.clear( );
+		out.bounds.clear( );
+
+		const size_t triangle_count = index_count / 3;
+
+		std::vector<Float3> triangle_normals( triangle_count );
+		std::vector<Float3> triangle_centroids( triangle_count );
+		float area_sum = 0.0f;
+		for ( size_t t = 0; t < triangle_count; ++t )
+		{
+			const Float3 p0 = LoadPosition( positions, position_stride, indices[t * 3] );
+			const Float3 p1 = LoadPosition( positions, position_stride, indices[t * 3 + 1] );
+			const Float3 p2 = LoadPosition( positions, position_stride, indices[t * 3 + 2] );
+			const Float3 n = Cross( p1 - p0, p2 - p0 );
+			area_sum += Length( n ) * 0.5f;
+			triangle_normals[t] = Normalize( n );
+			triangle_centroids[t] = ( p0 + p1 + p2 ) * ( 1.0f / 3.0f );
+		}
+
+		// radius of a full meshlet if it were a disc of average triangles, distances are measured against it
+		const float expected_radius = std::max( std::sqrt( area_sum / float( std::max<size_t>( triangle_count, 1 ) ) * float( max_triangles ) / 3.14159265f ), 1e-20f );
+
+		// vertex -> triangles not yet in a meshlet, emitted triangles are swapped out of the live part
+		std::vector<uint32_t> live_triangles( vertex_count, 0 );
+		for ( size_t i = 0; i < index_count; ++i )
+			live_triangles[indices[i]]++;
+
+		std::vector<uint32_t> adjacency_offsets( vertex_count + 1, 0 );
+		for ( size_t v = 0; v < vertex_count; ++v )
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+
+		std::vector<uint32_t> adjacency( index_count );
+		{
+			std::vector<uint32_t> fill( adjacency_offsets.begin( ), adjacency_offsets.end( ) - 1 );
+			for ( size_t i = 0; i < index_count; ++i )
+				adjacency[fill[indices[i]]++] = uint32_t( i / 3 );
+		}
+
+		std::vector<bool> emitted( triangle_count, false );
+
+		// vertices and candidate triangles belong to the current meshlet if their stamp matches,
+		// so nothing has to be cleared between meshlets
+		std::vector<uint32_t> vertex_stamp( vertex_count, 0 );
+		std::vector<uint32_t> candidate_stamp( triangle_count, 0 );
+		std::vector<uint8_t> local_index( vertex_count, 0 );
+		uint32_t stamp = 1;
+
+		// live triangles touching the meshlet, only these are considered so meshlets stay connected
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> seed_candidates; // candidates left over from the previous meshlet
+
+		Meshlet meshlet = { 0, 0, 0, 0 };
+		Float3 normal_sum = { 0.0f, 0.0f, 0.0f };
+		Float3 centroid_sum = { 0.0f, 0.0f, 0.0f };
+		size_t seed_cursor = 0;
+
+		auto finish_meshlet = [&] ( )
+		{
+			if ( meshlet.triangle_count )
+				out.meshlets.push_back( meshlet );
+
+			meshlet.vertex_offset = uint32_t( out.vertices.size( ) );
+			meshlet.triangle_offset = uint32_t( out.triangles.size( ) );
+			meshlet.vertex_count = 0;
+			meshlet.triangle_count = 0;
+			normal_sum.x = normal_sum.y = normal_sum.z = 0.0f;
+			centroid_sum.x = centroid_sum.y = centroid_sum.z = 0.0f;
+			seed_candidates.swap( candidates );
+			candidates.clear( );
+			stamp++;
+		};
+
+		for ( size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count )
+		{
+			int best_triangle = -1;
+
+			if ( meshlet.triangle_count )
+			{
+				const Float3 axis = Normalize( normal_sum );
+				const Float3 center = centroid_sum * ( 1.0f / float( meshlet.triangle_count ) );
+				uint32_t best_priority = 5;
+				float best_score = 0.0f;
+
+				size_t kept = 0;
+				for ( size_t i = 0; i < candidates.size( ); ++i )
+				{
+					const uint32_t t = candidates[i];
+					if ( emitted[t] )
+						continue;
+					candidates[kept++] = t;
+
+					const uint32_t* triangle = &indices[t * 3];
+					uint32_t extra = 0;
+					for ( int k = 0; k < 3; ++k )
+						extra += vertex_stamp[triangle[k]] != stamp;
+
+					if ( meshlet.vertex_count + extra > max_vertices )
+						continue;
+
+					// triangles adding no vertices come first, then dangling ones (the last live triangle of a vertex),
+					// they would end up as expensive tiny meshlets otherwise
+					uint32_t priority = 0;
+					if ( extra )
+						priority = live_triangles[triangle[0]] == 1 || live_triangles[triangle[1]] == 1 || live_triangles[triangle[2]] == 1 ? 1 : extra + 1;
+					if ( priority > best_priority )
+						continue;
+
+					// then the triangle closest to the meshlet that deviates least from its cone
+					const float distance = Length( triangle_centroids[t] - center ) / expected_radius;
+					const float cone = std::max( 1.0f - Dot( triangle_normals[t], axis ) * cone_weight, 1e-3f );
+					const float score = ( 1.0f + distance * ( 1.0f - cone_weight ) ) * cone;
+					if ( priority < best_priority || score < best_score )
+					{
+						best_priority = priority;
+						best_score = score;
+						best_triangle = int( t );
+					}
+				}
+				candidates.resize( kept );
+
+				if ( best_triangle < 0 )
+					finish_meshlet( );
+			}
+
+			if ( best_triangle < 0 )
+			{
+				// seed next to the previous meshlet, at the triangle with the fewest live neighbours. Starting in corners
+				// keeps the leftover region compact, seeding anywhere else leaves slivers that end up as tiny meshlets
+				uint32_t best_live = ~0u;
+				for ( uint32_t t : seed_candidates )
+				{
+					if ( emitted[t] )
+						continue;
+					const uint32_t live = live_triangles[indices[t * 3]] + live_triangles[indices[t * 3 + 1]] + live_triangles[indices[t * 3 + 2]];
+					if ( live < best_live )
+					{
+						best_live = live;
+						best_triangle = int( t );
+					}
+				}
+
+				if ( best_triangle < 0 )
+				{
+					while ( emitted[seed_cursor] )
+						seed_cursor++;
+					best_triangle = int( seed_cursor );
+				}
+			}
+
+			const uint32_t* triangle = &indices[best_triangle * 3];
+			uint32_t local[3];
+			for ( int k = 0; k < 3; ++k )
+			{
+				const uint32_t v = triangle[k];
+				uint32_t* begin = &adjacency[adjacency_offsets[v]];
+				uint32_t* end = begin + live_triangles[v];
+				std::swap( *std::find( begin, end, uint32_t( best_triangle ) ), *( end - 1 ) );
+				live_triangles[v]--;
+
+				if ( vertex_stamp[v] != stamp )
+				{
+					vertex_stamp[v] = stamp;
+					local_index[v] = uint8_t( meshlet.vertex_count++ );
+					out.vertices.push_back( v );
+
+					for ( uint32_t j = 0; j < live_triangles[v]; ++j )
+					{
+						const uint32_t t = begin[j];
+						if ( candidate_stamp[t] != stamp )
+						{
+							candidate_stamp[t] = stamp;
+							candidates.push_back( t );
+						}
+					}
+				}
+				local[k] = local_index[v];
+			}
+
+			out.triangles.push_back( PackTriangle( local[0], local[1], local[2] ) );
+			meshlet.triangle_count++;
+			emitted[best_triangle] = true;
+			normal_sum = normal_sum + triangle_normals[best_triangle];
+			centroid_sum = centroid_sum + triangle_centroids[best_triangle];
+
+			if ( meshlet.triangle_count == max_triangles )
+				finish_meshlet( );
+		}
+		finish_meshlet( );
+
+		out.bounds.reserve( out.meshlets.size( ) );
+		for ( const auto& m : out.meshlets )
+			out.bounds.push_back( ComputeMeshletBounds( out, m, positions, position_stride ) );
+	}
+
+	MeshletBounds ComputeMeshletBounds( const MeshletData& data, const Meshlet& meshlet, const float* positions, size_t position_stride )
+	{
+		std::vector<Float3> points;
+		std::vector<Float3> normals;
+		std::vector<Float3> triangle_points;
+		MeshletGeometry( data, meshlet, positions, position_stride, points, normals, triangle_points );
+
+		MeshletBounds bounds = { };
+
+		// ritter: start from the most distant pair of axis extremes, then grow the sphere over outliers
+		{
+			size_t min_point[3] = { 0, 0, 0 };
+			size_t max_point[3] = { 0, 0, 0 };
+			for ( size_t i = 0; i < points.size( ); ++i )
+			{
+				const float* p = &points[i].x;
+				for ( int c = 0; c < 3; ++c )
+				{
+					if ( p[c] < ( &points[min_point[c]].x )[c] ) min_point[c] = i;
+					if ( p[c] > ( &points[max_point[c]].x )[c] ) max_point[c] = i;
+				}
+			}
+
+			int widest = 0;
+			float widest_distance = -1.0f;
+			for ( int c = 0; c < 3; ++c )
+			{
+				const Float3 d = points[max_point[c]] - points[min_point[c]];
+				if ( Dot( d, d ) > widest_distance )
+				{
+					widest_distance = Dot( d, d );
+					widest = c;
+				}
+			}
+
+			Float3 center = ( points[min_point[widest]] + points[max_point[widest]] ) * 0.5f;
+			float radius = std::sqrt( widest_distance ) * 0.5f;
+
+			for ( const auto& p : points )
+			{
+				const float distance = Length( p - center );
+				if ( distance > radius )
+				{
+					const float new_radius = ( radius + distance ) * 0.5f;
+					center = center + ( p - center ) * ( ( new_radius - radius ) / distance );
+					radius = new_radius;
+				}
+			}
+
+			bounds.center[0] = center.x;
+			bounds.center[1] = center.y;
+			bounds.center[2] = center.z;
+			bounds.radius = radius;
+		}
+
+		// cone around the average normal
+		Float3 normal_sum = { 0.0f, 0.0f, 0.0f };
+		for ( const auto& normal : normals )
+			normal_sum = normal_sum + normal;
+
+		Float3 axis = Normalize( normal_sum );
+		if ( Dot( axis, axis ) == 0.0f )
+		{
+			axis.x = axis.y = 0.0f;
+			axis.z = 1.0f;
+		}
+
+		bounds.cone_axis[0] = axis.x;
+		bounds.cone_axis[1] = axis.y;
+		bounds.cone_axis[2] = axis.z;
+		bounds.cone_cutoff = ConeCutoff( axis, normals );
+
+		// apex: the point on the axis behind the center from which every triangle plane is seen from the back
+		const Float3 center = { bounds.center[0], bounds.center[1], bounds.center[2] };
+		float max_t = 0.0f;
+		if ( bounds.cone_cutoff < 1.0f )
+		{
+			for ( size_t t = 0; t < normals.size( ); ++t )
+			{
+				const float dn = Dot( axis, normals[t] );
+				if ( dn > 0.0f )
+					max_t = std::max( max_t, Dot( center - triangle_points[t], normals[t] ) / dn );
+			}
+		}
+		const Float3 apex = center - axis * max_t;
+		bounds.cone_apex[0] = apex.x;
+		bounds.cone_apex[1] = apex.y;
+		bounds.cone_apex[2] = apex.z;
+
+		return bounds;
+	}
+
+	std::vector<PackedMeshletBounds> PackMeshletBounds( const MeshletData& data, const float* positions, size_t position_stride )
+	{
+		std::vector<PackedMeshletBounds> packed( data.meshlets.size( ) );
+
+		std::vector<Float3> points;
+		std::vector<Float3> normals;
+		std::vector<Float3> triangle_points;
+		for ( size_t i = 0; i < data.meshlets.size( ); ++i )
+		{
+			const MeshletBounds& bounds = data.bounds[i];
+			PackedMeshletBounds& p = packed[i];
+			for ( int c = 0; c < 3; ++c )
+			{
+				p.center[c] = bounds.center[c];
+				p.cone_apex[c] = bounds.cone_apex[c];
+			}
+			p.radius = bounds.radius;
+
+			const int8_t axis[3] = { QuantizeSnorm8( bounds.cone_axis[0] ), QuantizeSnorm8( bounds.cone_axis[1] ), QuantizeSnorm8( bounds.cone_axis[2] ) };
+
+			// recompute the cutoff for the axis the gpu will see, and round it up so nothing visible is culled
+			int8_t cutoff = 127;
+			if ( bounds.cone_cutoff < 1.0f )
+			{
+				MeshletGeometry( data, data.meshlets[i], positions, position_stride, points, normals, triangle_points );
+				const Float3 quantized_axis = { float( axis[0] ), float( axis[1] ), float( axis[2] ) };
+				const float quantized_cutoff = ConeCutoff( Normalize( quantized_axis ), normals );
+				cutoff = int8_t( std::min( std::ceil( quantized_cutoff * 127.0f ), 127.0f ) );
+			}
+
+			p.cone = uint32_t( uint8_t( axis[0] ) ) | ( uint32_t( uint8_t( axis[1] ) ) << 8 ) | ( uint32_t( uint8_t( axis[2] ) ) << 16 ) | ( uint32_t( uint8_t( cutoff ) ) << 24 );
+		}
+		return packed;
+	}
+
+	void BuildMeshletIndexBuffer( const MeshletData& data, std::vector<uint32_t>& indices )
+	{
+		indices.resize( data.triangles.size( ) * 3 );
+		for ( const auto& meshlet : data.meshlets )
+		{
+			for ( uint32_t t = 0; t < meshlet.triangle_count; ++t )
+			{
+				const uint32_t packed = data.triangles[meshlet.triangle_offset + t];
+				for ( int k = 0; k < 3; ++k )
+					indices[( meshlet.triangle_offset + t ) * 3 + k] = data.vertices[meshlet.vertex_offset + LocalIndex( packed, k )];
+			}
+		}
+	}
+
+	void CullMeshlets( const MeshletData& data, const MeshletCullParams& params, std::vector<uint32_t>& visible )
+	{
+		const Float3 camera = { params.camera_position[0], params.camera_position[1], params.camera_position[2] };
+
+		for ( size_t i = 0; i < data.bounds.size( ); ++i )
+		{
+			const MeshletBounds& bounds = data.bounds[i];
+			const Float3 center = { bounds.center[0], bounds.center[1], bounds.center[2] };
+
+			bool inside = true;
+			for ( int p = 0; p < 6 && inside; ++p )
+				inside = params.planes[p][0] * center.x + params.planes[p][1] * center.y + params.planes[p][2] * center.z + params.planes[p][3] >= -bounds.radius;
+			if ( !inside )
+				continue;
+
+			// backfacing if the camera is inside the cone widened by the sphere
+			if ( bounds.cone_cutoff < 1.0f )
+			{
+				const Float3 axis = { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] };
+				const Float3 view = center - camera;
+				if ( Dot( view, axis ) >= bounds.cone_cutoff * Length( view ) + bounds.radius )
+					continue;
+			}
+
+			visible.push_back( uint32_t( i ) );
+		}
+	}
+
+	void MergeMeshletDraws( const MeshletData& data, const std::vector<uint32_t>& visible, std::vector<MeshletDraw>& draws )
+	{
+		for ( uint32_t index : visible )
+		{
+			const Meshlet& meshlet = data.meshlets[index];
+			const uint32_t first_index = meshlet.triangle_offset * 3;
+			const uint32_t index_count = meshlet.triangle_count * 3;
+
+			if ( !draws.empty( ) && draws.back( ).first_index + draws.back( ).index_count == first_index )
+			{
+				draws.back( ).index_count += index_count;
+				continue;
+			}
+
+			MeshletDraw draw = { first_index, index_count };
+			draws.push_back( draw );
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// splits indexed triangle lists into small clusters (meshlets) with bounds for per-cluster culling.
+// Every meshlet has its own vertex list and triangles index into that list with 8-bit local indices,
+// which is the layout mesh shaders want. Until the renderer has those, BuildMeshletIndexBuffer turns
+// meshlets back into a plain index buffer with one contiguous range per meshlet, and CullMeshlets
+// output becomes a handful of DrawIndexedInstanced calls over the surviving ranges
+
+namespace DXLayer
+{
+	// 64 vertices / 124 triangles keep a meshlet's local data within 256 + 372 bytes
+	static const uint32_t meshlet_max_vertices = 64;
+	static const uint32_t meshlet_max_triangles = 124;
+
+	// 16 bytes, read as uint4 on the gpu
+	struct Meshlet
+	{
+		uint32_t vertex_offset;		// into MeshletData::vertices
+		uint32_t triangle_offset;	// into MeshletData::triangles
+		uint32_t vertex_count;
+		uint32_t triangle_count;
+	};
+
+	struct MeshletBounds
+	{
+		float center[3];		// bounding sphere
+		float radius;
+		float cone_apex[3];		// every triangle faces away from a viewer inside the cone at apex, opening along -axis
+		float cone_axis[3];
+		float cone_cutoff;		// sine of the cone half angle. 1 means the cone is useless and never culls
+	};
+
+	// 32 bytes, read as two float4 on the gpu. The axis is snorm8 and gets normalized again after unpacking,
+	// the cutoff is computed against the quantized axis so culling stays conservative
+	struct PackedMeshletBounds
+	{
+		float center[3];
+		float radius;
+		float cone_apex[3];
+		uint32_t cone;			// axis xyz and cutoff as snorm8, x in the low byte
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices;		// meshlet local vertex -> mesh vertex
+		std::vector<uint32_t> triangles;	// three 8-bit local indices per triangle, the first in the low byte
+		std::vector<MeshletBounds> bounds;	// one per meshlet
+	};
+
+	// grows meshlets greedily from adjacent triangles. Triangles that add the fewest vertices win, ties go to
+	// the closest triangle, and cone_weight shifts that towards triangles facing the same way as the meshlet
+	// (0 for compact meshlets, 1 for tight normal cones). New meshlets are seeded in index order, so this works
+	// best on a cache optimized index buffer
+	void BuildMeshlets( MeshletData& out, const uint32_t* indices, size_t index_count, const float* positions, size_t position_stride, size_t vertex_count,
+		uint32_t max_vertices = meshlet_max_vertices, uint32_t max_triangles = meshlet_max_triangles, float cone_weight = 0.25f );
+
+	MeshletBounds ComputeMeshletBounds( const MeshletData& data, const Meshlet& meshlet, const float* positions, size_t position_stride );
+
+	std::vector<PackedMeshletBounds> PackMeshletBounds( const MeshletData& data, const float* positions, size_t position_stride );
+
+	// meshlet i covers indices [triangle_offset * 3, ( triangle_offset + triangle_count ) * 3) of the result
+	void BuildMeshletIndexBuffer( const MeshletData& data, std::vector<uint32_t>& indices );
+
+	struct MeshletCullParams
+	{
+		float planes[6][4];			// frustum planes, xyz . p + w >= 0 inside
+		float camera_position[3];
+	};
+
+	// reference for gpu culling: frustum test against the sphere, backface test against the cone.
+	// Appends indices of visible meshlets
+	void CullMeshlets( const MeshletData& data, const MeshletCullParams& params, std::vector<uint32_t>& visible );
+
+	struct MeshletDraw
+	{
+		uint32_t first_index;
+		uint32_t index_count;
+	};
+
+	// merges runs of visible meshlets into draws over the buffer from BuildMeshletIndexBuffer
+	void MergeMeshletDraws( const MeshletData& data, const std::vector<uint32_t>& visible, std::vector<MeshletDraw>& draws );
+}
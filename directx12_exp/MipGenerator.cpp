@@ -0,0 +1,415 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "RunOnThreads.h"
+#include "Simd.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const uint32_t band_rows = 32;						// output rows a thread filters at a time
+		const uint32_t min_texels_per_thread = 1 << 16;		// smaller levels use fewer threads
+		const float kaiser_width = 3.0f;					// in texels of the smaller level, as nvtt has it
+		const float kaiser_alpha = 4.0f;
+
+		// the source texels one output texel is made of
+		struct Tap
+		{
+			uint32_t index;
+			float weight;
+		};
+
+		struct Taps
+		{
+			std::vector<uint32_t> first;	// output texel x uses taps[first[x], first[x + 1])
+			std::vector<Tap> taps;
+		};
+
+		double BesselI0( double x )
+		{
+			double sum = 1.0, term = 1.0;
+			for ( int k = 1; k < 32 && term > sum * 1e-12; ++k )
+			{
+				term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+				sum += term;
+			}
+			return sum;
+		}
+
+		double Kaiser( double t )
+		{
+			if ( std::fabs( t ) >= kaiser_width )
+				return 0.0;
+			const double pi = 3.14159265358979;
+			const double sinc = t == 0.0 ? 1.0 : std::sin( pi * t ) / ( pi * t );
+			const double window = t / kaiser_width;
+			return sinc * BesselI0( kaiser_alpha * std::sqrt( 1.0 - window * window ) ) / BesselI0( kaiser_alpha );
+		}
+
+		// weights of the source texels for every texel of size along one axis, normalized to 1
+		void BuildTaps( uint32_t source_size, uint32_t size, const MipOptions& options, Taps& taps )
+		{
+			const double ratio = double( source_size ) / double( size );
+			taps.first.clear( );
+			taps.taps.clear( );
+			for ( uint32_t x = 0; x < size; ++x )
+			{
+				taps.first.push_back( uint32_t( taps.taps.size( ) ) );
+				if ( source_size == size )
+				{
+					taps.taps.push_back( Tap{ x, 1.0f } );
+					continue;
+				}
+
+				double total = 0.0;
+				const size_t begin = taps.taps.size( );
+				if ( options.filter == mip_filter_box )
+				{
+					// how much of each source texel the output texel covers
+					const double low = x * ratio, high = ( x + 1 ) * ratio;
+					for ( uint32_t i = uint32_t( low ); i < source_size && i < high; ++i )
+					{
+						const double weight = std::min( high, i + 1.0 ) - std::max( low, double( i ) );
+						if ( weight > 1e-9 )
+						{
+							taps.taps.push_back( Tap{ i, float( weight ) } );
+							total += weight;
+						}
+					}
+				}
+				else
+				{
+					// the filter stretched by the ratio, sampled at the source texel centers
+					const double center = ( x + 0.5 ) * ratio;
+					const double radius = kaiser_width * ratio;
+					const int32_t low = int32_t( std::floor( center - radius ) ), high = int32_t( std::ceil( center + radius ) );
+					for ( int32_t i = low; i <= high; ++i )
+					{
+						const double weight = Kaiser( ( i + 0.5 - center ) / ratio );
+						if ( weight == 0.0 )
+							continue;
+						const int32_t n = int32_t( source_size );
+						const int32_t index = options.wrap ? ( ( i % n ) + n ) % n : std::min( std::max( i, 0 ), n - 1 );
+						taps.taps.push_back( Tap{ uint32_t( index ), float( weight ) } );
+						total += weight;
+					}
+				}
+				for ( size_t t = begin; t < taps.taps.size( ); ++t )
+					taps.taps[t].weight = float( taps.taps[t].weight / total );
+			}
+			taps.first.push_back( uint32_t( taps.taps.size( ) ) );
+		}
+
+		// srgb to linear for every byte, and the linear values where rounding goes from one srgb byte to the next
+		struct SrgbTables
+		{
+			static const uint32_t start_count = 4096;
+
+			float to_linear[256];
+			float unorm[256];
+			float thresholds[256];				// the last one is past every value
+			uint8_t starts[start_count + 1];	// the byte for the low end of each step of linear values
+
+			SrgbTables( )
+			{
+				for ( uint32_t i = 0; i < 256; ++i )
+				{
+					to_linear[i] = float( ToLinear( i / 255.0 ) );
+					unorm[i] = i / 255.0f;
+					thresholds[i] = i < 255 ? float( ToLinear( ( i + 0.5 ) / 255.0 ) ) : 2.0f;
+				}
+				uint32_t byte = 0;
+				for ( uint32_t i = 0; i <= start_count; ++i )
+				{
+					while ( thresholds[byte] <= float( i ) / start_count )
+						++byte;
+					starts[i] = uint8_t( byte );
+				}
+			}
+
+			static double ToLinear( double value )
+			{
+				return value <= 0.04045 ? value / 12.92 : std::pow( ( value + 0.055 ) / 1.055, 2.4 );
+			}
+
+			// the srgb byte nearest to value, rounded in srgb. The steps are finer than the thresholds are apart,
+			// so it's a byte or two on from where the step starts
+			uint8_t ToSrgb( float value ) const
+			{
+				value = value > 0.0f ? ( value < 1.0f ? value : 1.0f ) : 0.0f;
+				uint32_t byte = starts[uint32_t( value * start_count )];
+				while ( thresholds[byte] <= value )
+					++byte;
+				return uint8_t( byte );
+			}
+		};
+
+		const SrgbTables& Srgb( )
+		{
+			static const SrgbTables tables;
+			return tables;
+		}
+
+		// one level in linear float rgba, or the rgba8 top level read through the tables
+		struct Level
+		{
+			uint32_t width;
+			uint32_t height;
+			const float* texels;		// null for the top level
+			const MipSource* source;
+			const float* rgb_table;
+		};
+
+		const float* LevelRow( const Level& level, uint32_t y, float* scratch )
+		{
+			if ( level.texels )
+				return level.texels + size_t( y ) * level.width * 4;
+			const uint8_t* row = level.source->texels + y * level.source->row_pitch;
+			const float* unorm = Srgb( ).unorm;
+			for ( uint32_t i = 0; i < level.width * 4; i += 4 )
+			{
+				scratch[i + 0] = level.rgb_table[row[i + 0]];
+				scratch[i + 1] = level.rgb_table[row[i + 1]];
+				scratch[i + 2] = level.rgb_table[row[i + 2]];
+				scratch[i + 3] = unorm[row[i + 3]];
+			}
+			return scratch;
+		}
+
+		void FilterRow( const float* source, const Taps& taps, uint32_t width, float* out )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				const Tap* tap = &taps.taps[taps.first[x]];
+				const Tap* end = &taps.taps[0] + taps.first[x + 1];
+#if DXL_SSE2
+				__m128 sum = _mm_setzero_ps( );
+				for ( ; tap < end; ++tap )
+					sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( source + tap->index * 4 ), _mm_set1_ps( tap->weight ) ) );
+				_mm_storeu_ps( out + x * 4, sum );
+#else
+				float sum[4] = {};
+				for ( ; tap < end; ++tap )
+				{
+					for ( uint32_t c = 0; c < 4; ++c )
+						sum[c] += source[tap->index * 4 + c] * tap->weight;
+				}
+				std::memcpy( out + x * 4, sum, sizeof( sum ) );
+#endif
+			}
+		}
+
+		// out += row * weight over count floats
+		void AddRow( const float* row, float weight, size_t count, float* out )
+		{
+			size_t i = 0;
+#if DXL_SSE2
+			const __m128 w = _mm_set1_ps( weight );
+			for ( ; i < count; i += 4 )
+				_mm_storeu_ps( out + i, _mm_add_ps( _mm_loadu_ps( out + i ), _mm_mul_ps( _mm_loadu_ps( row + i ), w ) ) );
+#endif
+			for ( ; i < count; ++i )
+				out[i] += row[i] * weight;
+		}
+
+		// a row of linear texels as rgba8, alpha scaled first
+		void WriteRow( const float* row, uint32_t width, bool srgb, float alpha_scale, uint8_t* scratch, void* destination )
+		{
+			uint32_t x = 0;
+#if DXL_SSE2
+			const __m128 scale = _mm_setr_ps( 255.0f, 255.0f, 255.0f, 255.0f * alpha_scale );
+			const __m128 top = _mm_set1_ps( 255.0f );
+			for ( ; x < width; ++x )
+			{
+				const __m128 value = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( row + x * 4 ), scale ), _mm_setzero_ps( ) ), top );
+				const __m128i q = _mm_cvtps_epi32( value );
+				const __m128i q16 = _mm_packs_epi32( q, q );
+				const int packed = _mm_cvtsi128_si32( _mm_packus_epi16( q16, q16 ) );
+				std::memcpy( scratch + x * 4, &packed, 4 );
+			}
+#else
+			for ( ; x < width; ++x )
+			{
+				for ( uint32_t c = 0; c < 4; ++c )
+				{
+					const float value = row[x * 4 + c] * ( c == 3 ? alpha_scale : 1.0f );
+					scratch[x * 4 + c] = uint8_t( value <= 0.0f ? 0 : value >= 1.0f ? 255 : int( value * 255.0f + 0.5f ) );
+				}
+			}
+#endif
+			if ( srgb )
+			{
+				const SrgbTables& tables = Srgb( );
+				for ( x = 0; x < width; ++x )
+				{
+					for ( uint32_t c = 0; c < 3; ++c )
+						scratch[x * 4 + c] = tables.ToSrgb( row[x * 4 + c] );
+				}
+			}
+			std::memcpy( destination, scratch, width * 4 );
+		}
+
+		// share of texels whose alpha passes the test
+		float Coverage( const MipSource& source, uint32_t width, uint32_t height, float cutoff )
+		{
+			uint64_t passed = 0;
+			for ( uint32_t y = 0; y < height; ++y )
+			{
+				const uint8_t* row = source.texels + y * source.row_pitch;
+				for ( uint32_t x = 0; x < width; ++x )
+					passed += row[x * 4 + 3] / 255.0f > cutoff;
+			}
+			return float( passed ) / ( float( width ) * float( height ) );
+		}
+
+		// the scale that lets the same share of the level's texels pass the test on the stored bytes: the alpha of the
+		// texel that should just pass goes to the first byte over the cutoff. Texels with the same alpha pass or fail
+		// together, at the edge the count nearest the top level's wins
+		float CoverageScale( const std::vector<float>& texels, float coverage, float cutoff )
+		{
+			const size_t count = texels.size( ) / 4;
+			const size_t passing = size_t( coverage * count + 0.5f );
+			if ( !passing )
+				return 1.0f;
+			std::vector<float> alpha( count );
+			for ( size_t i = 0; i < count; ++i )
+				alpha[i] = texels[i * 4 + 3];
+			std::nth_element( alpha.begin( ), alpha.begin( ) + ( passing - 1 ), alpha.end( ), std::greater<float>( ) );
+			float edge = alpha[passing - 1];
+			size_t above = 0, with_edge = passing;
+			float next = 2.0f;
+			for ( size_t i = 0; i < passing - 1; ++i )
+			{
+				if ( alpha[i] > edge )
+				{
+					++above;
+					next = alpha[i] < next ? alpha[i] : next;
+				}
+			}
+			for ( size_t i = passing; i < count; ++i )
+				with_edge += alpha[i] == edge;
+			if ( above && passing - above < with_edge - passing )
+				edge = next;
+			if ( edge <= 0.0f )
+				return 1.0f;
+
+			// bytes round to nearest, the edge lands just past the halfway point below the first passing byte
+			const float first_byte = std::floor( cutoff * 255.0f ) + 1.0f;
+			return ( first_byte - 0.5f + 1.0f / 64 ) / ( 255.0f * edge );
+		}
+	}
+
+	uint32_t FullMipCount( uint32_t width, uint32_t height )
+	{
+		uint32_t largest = width > height ? width : height;
+		uint32_t count = 1;
+		while ( largest >>= 1 )
+			++count;
+		return count;
+	}
+
+	bool GenerateMips( const MipSource* slices, uint32_t slice_count, uint32_t width, uint32_t height, uint32_t mip_levels,
+		const SubresourceDestination* destinations, const MipOptions& options )
+	{
+		if ( !width || !height || !slice_count )
+			return false;
+		if ( !mip_levels )
+			mip_levels = FullMipCount( width, height );
+		if ( mip_levels > FullMipCount( width, height ) )
+			return false;
+
+		const bool alpha_test = options.alpha_cutoff > 0.0f;
+		const float* rgb_table = options.srgb ? Srgb( ).to_linear : Srgb( ).unorm;
+		std::vector<float> above, below;
+		Taps horizontal, vertical;
+		for ( uint32_t slice = 0; slice < slice_count; ++slice )
+		{
+			const MipSource& source = slices[slice];
+			const SubresourceDestination* slice_destinations = destinations + slice * mip_levels;
+			CopySubresource( slice_destinations[0], SubresourceSource{ source.texels, source.row_pitch, source.row_pitch * height }, width * 4, height, 1 );
+			const float coverage = alpha_test ? Coverage( source, width, height, options.alpha_cutoff ) : 0.0f;
+
+			Level level = { width, height, nullptr, &source, rgb_table };
+			for ( uint32_t mip = 1; mip < mip_levels; ++mip )
+			{
+				const uint32_t level_width = width >> mip ? width >> mip : 1;
+				const uint32_t level_height = height >> mip ? height >> mip : 1;
+				BuildTaps( level.width, level_width, options, horizontal );
+				BuildTaps( level.height, level_height, options, vertical );
+				below.resize( size_t( level_width ) * level_height * 4 );
+				const SubresourceDestination& destination = slice_destinations[mip];
+
+				const uint32_t band_count = ( level_height + band_rows - 1 ) / band_rows;
+				const uint32_t wanted = level_width * level_height / min_texels_per_thread + 1;
+				uint32_t thread_count = options.thread_count < wanted ? options.thread_count : wanted;
+				thread_count = thread_count < band_count ? thread_count : band_count;
+				thread_count = thread_count ? thread_count : 1;
+				RunOnThreads( thread_count, [ & ] ( uint32_t thread )
+				{
+					// the band's source rows are filtered across once each, then summed down into the output rows
+					std::vector<float> scratch( level.width * 4 );
+					std::vector<float> rows;
+					std::vector<int32_t> slots( level.height, -1 );
+					std::vector<uint32_t> needed;
+					std::vector<uint8_t> packed( level_width * 4 );
+					for ( uint32_t band = thread; band < band_count; band += thread_count )
+					{
+						const uint32_t first = band * band_rows;
+						const uint32_t end = first + band_rows < level_height ? first + band_rows : level_height;
+						needed.clear( );
+						for ( uint32_t t = vertical.first[first]; t < vertical.first[end]; ++t )
+						{
+							const uint32_t index = vertical.taps[t].index;
+							if ( slots[index] < 0 )
+							{
+								slots[index] = int32_t( needed.size( ) );
+								needed.push_back( index );
+							}
+						}
+						rows.resize( needed.size( ) * level_width * 4 );
+						for ( size_t r = 0; r < needed.size( ); ++r )
+							FilterRow( LevelRow( level, needed[r], scratch.data( ) ), horizontal, level_width, &rows[r * level_width * 4] );
+
+						for ( uint32_t y = first; y < end; ++y )
+						{
+							float* out = &below[size_t( y ) * level_width * 4];
+							std::fill( out, out + level_width * 4, 0.0f );
+							for ( uint32_t t = vertical.first[y]; t < vertical.first[y + 1]; ++t )
+								AddRow( &rows[slots[vertical.taps[t].index] * size_t( level_width ) * 4], vertical.taps[t].weight, level_width * 4, out );
+							if ( !alpha_test )
+								WriteRow( out, level_width, options.srgb, 1.0f, packed.data( ), static_cast<uint8_t*>( destination.data ) + y * destination.row_pitch );
+						}
+						for ( uint32_t index : needed )
+							slots[index] = -1;
+					}
+				} );
+
+				// the alpha scale needs the whole level, it's written out in a second pass
+				if ( alpha_test )
+				{
+					const float scale = CoverageScale( below, coverage, options.alpha_cutoff );
+					RunOnThreads( thread_count, [ & ] ( uint32_t thread )
+					{
+						std::vector<uint8_t> packed( level_width * 4 );
+						for ( uint32_t y = thread; y < level_height; y += thread_count )
+						{
+							WriteRow( &below[size_t( y ) * level_width * 4], level_width, options.srgb, scale, packed.data( ),
+								static_cast<uint8_t*>( destination.data ) + y * destination.row_pitch );
+						}
+					} );
+				}
+
+				// the next level is filtered from this one as it was before the alpha scale
+				above.swap( below );
+				level = Level{ level_width, level_height, above.data( ), nullptr, nullptr };
+			}
+		}
+		return true;
+	}
+}
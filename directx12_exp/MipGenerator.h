@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SubresourceCopy.h"
+
+// mip chains of rgba8 textures for the asset build. Each level is resampled from the one above it, kept in linear
+// float so the chain doesn't round at every step: a box filter, or a kaiser windowed sinc that keeps more detail.
+// Sizes that aren't a power of two shrink to floor( size / 2 ) with the filter stretched to match, so no texel is
+// dropped. srgb textures are filtered in linear light. Alpha tested textures can keep the share of texels above
+// their cutoff at every level, so foliage doesn't thin out with distance. Levels are filtered in bands of rows
+// spread over threads, four channels in one sse2 register. No d3d in here
+
+namespace DXLayer
+{
+	enum MipFilter : uint32_t
+	{
+		mip_filter_box,			// the average of the texels each one covers
+		mip_filter_kaiser		// sinc windowed over 3 texels of the smaller level, sharper, can ring a little
+	};
+
+	struct MipOptions
+	{
+		MipOptions( )
+			: filter( mip_filter_box ), srgb( false ), wrap( false ), alpha_cutoff( 0.0f ), thread_count( 1 )
+		{ }
+
+		MipFilter filter;
+		bool srgb;				// rgb is srgb encoded, alpha never is
+		bool wrap;				// the texture tiles, filters reach over the edges to the other side instead of clamping
+		float alpha_cutoff;		// above 0, alpha is scaled at each level so as many texels pass this alpha test as at the top
+		uint32_t thread_count;	// the calling thread is one of them
+	};
+
+	// one array slice of the top level, rgba8
+	struct MipSource
+	{
+		const uint8_t* texels;
+		size_t row_pitch;
+	};
+
+	// levels of a full chain, down to 1 x 1
+	uint32_t FullMipCount( uint32_t width, uint32_t height );
+
+	// every level of every slice into destinations[mip + slice * mip_levels], the order of D3D12CalcSubresource,
+	// level 0 copied as it is. Level mip is max( 1, width >> mip ) x max( 1, height >> mip ), rows of 4 byte texels.
+	// The destinations are only written, they can be upload heap footprints. mip_levels of 0 is the full chain.
+	// False for an empty texture or more levels than the full chain
+	bool GenerateMips( const MipSource* slices, uint32_t slice_count, uint32_t width, uint32_t height, uint32_t mip_levels,
+		const SubresourceDestination* destinations, const MipOptions& options = MipOptions( ) );
+}
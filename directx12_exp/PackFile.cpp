@@ -0,0 +1,319 @@
+#include "PackFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "LzCodec.h"
+#include "RunOnThreads.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		uint64_t AlignUp( uint64_t value )
+		{
+			return ( value + pack_file_alignment - 1 ) & ~uint64_t( pack_file_alignment - 1 );
+		}
+
+		bool RangeFits( uint64_t first, uint64_t count, uint64_t limit )
+		{
+			return first <= limit && count <= limit - first;
+		}
+
+		uint32_t BlockCount( uint64_t size, uint32_t block_size )
+		{
+			return uint32_t( ( size + block_size - 1 ) / block_size );
+		}
+	}
+
+	uint64_t PackPathHash( const char* path )
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for ( ; *path; ++path )
+			hash = ( hash ^ uint8_t( *path ) ) * 1099511628211ull;
+		return hash;
+	}
+
+	PackFile::PackFile( )
+		: header( nullptr ), entries( nullptr ), hash_slots( nullptr ), blocks( nullptr ), paths( nullptr )
+	{ }
+
+	bool PackFile::Open( const char* path, std::string& error )
+	{
+		Close( );
+		if ( !mapping.Open( path ) )
+			return Fail( error, "can't open the pack file" );
+
+		const uint8_t* bytes = mapping.Data( );
+		const size_t size = mapping.Size( );
+		if ( size < sizeof( PackFileHeader ) )
+			return Fail( error, "file too small for a pack file header" );
+		const PackFileHeader* file_header = reinterpret_cast<const PackFileHeader*>( bytes );
+		if ( file_header->magic != pack_file_magic )
+			return Fail( error, "not a pack file" );
+		if ( file_header->version == 0 || file_header->version > pack_file_version )
+			return Fail( error, "unsupported pack file version" );
+		if ( file_header->file_size > size )
+			return Fail( error, "pack file is truncated" );
+		if ( file_header->block_size == 0 )
+			return Fail( error, "pack file has no block size" );
+
+		// the tables lie back to back after the header
+		const uint64_t entries_offset = sizeof( PackFileHeader );
+		const uint64_t hash_slots_offset = entries_offset + uint64_t( file_header->entry_count ) * sizeof( PackFileEntry );
+		const uint64_t blocks_offset = hash_slots_offset + uint64_t( file_header->entry_count ) * sizeof( PackFileHashSlot );
+		const uint64_t paths_offset = blocks_offset + uint64_t( file_header->block_count ) * sizeof( PackFileBlock );
+		if ( !RangeFits( paths_offset, file_header->paths_size, file_header->file_size ) )
+			return Fail( error, "pack file tables run past the end of the file" );
+		if ( file_header->entry_count && ( file_header->paths_size == 0 || bytes[paths_offset + file_header->paths_size - 1] != 0 ) )
+			return Fail( error, "pack file paths aren't terminated" );
+
+		const PackFileEntry* file_entries = reinterpret_cast<const PackFileEntry*>( bytes + entries_offset );
+		const PackFileHashSlot* file_hash_slots = reinterpret_cast<const PackFileHashSlot*>( bytes + hash_slots_offset );
+		const PackFileBlock* file_blocks = reinterpret_cast<const PackFileBlock*>( bytes + blocks_offset );
+		for ( uint32_t e = 0; e < file_header->entry_count; ++e )
+		{
+			const PackFileEntry& entry = file_entries[e];
+			if ( entry.path_offset >= file_header->paths_size || !RangeFits( entry.first_block, entry.block_count, file_header->block_count ) ||
+				entry.block_count != BlockCount( entry.size, file_header->block_size ) )
+				return Fail( error, "pack file entry out of bounds" );
+			if ( file_hash_slots[e].entry >= file_header->entry_count )
+				return Fail( error, "pack file hash slot out of bounds" );
+		}
+		const size_t max_stored_size = LzCompressBound( file_header->block_size );
+		for ( uint32_t b = 0; b < file_header->block_count; ++b )
+			if ( file_blocks[b].stored_size > max_stored_size || !RangeFits( file_blocks[b].offset, file_blocks[b].stored_size, file_header->file_size ) )
+				return Fail( error, "pack file block out of bounds" );
+
+		header = file_header;
+		entries = file_entries;
+		hash_slots = file_hash_slots;
+		blocks = file_blocks;
+		paths = reinterpret_cast<const char*>( bytes + paths_offset );
+		return true;
+	}
+
+	void PackFile::Close( )
+	{
+		mapping.Close( );
+		header = nullptr;
+		entries = nullptr;
+		hash_slots = nullptr;
+		blocks = nullptr;
+		paths = nullptr;
+	}
+
+	uint32_t PackFile::Find( const char* path ) const
+	{
+		const uint64_t hash = PackPathHash( path );
+		const PackFileHashSlot* end = hash_slots + EntryCount( );
+		const PackFileHashSlot* slot = std::lower_bound( hash_slots, end, hash, [ ] ( const PackFileHashSlot& slot, uint64_t hash ) { return slot.hash < hash; } );
+		for ( ; slot != end && slot->hash == hash; ++slot )
+			if ( std::strcmp( EntryPath( slot->entry ), path ) == 0 )
+				return slot->entry;
+		return invalid_entry;
+	}
+
+	void PackFile::FindPrefix( const char* prefix, uint32_t& first, uint32_t& end ) const
+	{
+		const size_t prefix_length = std::strlen( prefix );
+		const auto before = [ this, prefix, prefix_length ] ( uint32_t entry ) { return std::strncmp( EntryPath( entry ), prefix, prefix_length ) < 0; };
+		const auto within = [ this, prefix, prefix_length ] ( uint32_t entry ) { return std::strncmp( EntryPath( entry ), prefix, prefix_length ) <= 0; };
+
+		// binary searches over the entries, which are sorted by path
+		uint32_t low = 0, high = EntryCount( );
+		while ( low < high )
+		{
+			const uint32_t middle = low + ( high - low ) / 2;
+			if ( before( middle ) )
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		first = low;
+		high = EntryCount( );
+		while ( low < high )
+		{
+			const uint32_t middle = low + ( high - low ) / 2;
+			if ( within( middle ) )
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		end = low;
+	}
+
+	bool PackFile::ReadBlocks( uint32_t entry, uint32_t first_block, uint32_t block_count, void* destination ) const
+	{
+		const PackFileEntry& pack_entry = entries[entry];
+		if ( first_block > pack_entry.block_count || block_count > pack_entry.block_count - first_block )
+			return false;
+
+		uint8_t* out = static_cast<uint8_t*>( destination );
+		for ( uint32_t b = first_block; b < first_block + block_count; ++b )
+		{
+			const uint64_t block_start = uint64_t( b ) * header->block_size;
+			const size_t size = size_t( std::min<uint64_t>( header->block_size, pack_entry.size - block_start ) );
+			const PackFileBlock& block = blocks[pack_entry.first_block + b];
+			const uint8_t* stored = mapping.Data( ) + block.offset;
+			if ( block.stored_size == size )
+				std::memcpy( out, stored, size );
+			else if ( !LzDecompress( stored, block.stored_size, out, size ) )
+				return false;
+			out += size;
+		}
+		return true;
+	}
+
+	bool PackFile::ReadEntry( uint32_t entry, void* destination, uint32_t thread_count ) const
+	{
+		const uint32_t block_count = entries[entry].block_count;
+		const uint32_t useful_threads = std::max( 1u, std::min( thread_count, block_count / pack_parallel_min_blocks ) );
+		if ( useful_threads == 1 )
+			return ReadBlocks( entry, 0, block_count, destination );
+
+		// contiguous runs of blocks, one per thread
+		std::atomic<bool> failed( false );
+		RunOnThreads( useful_threads, [ &, this ] ( uint32_t thread )
+		{
+			const uint32_t first = uint32_t( uint64_t( block_count ) * thread / useful_threads );
+			const uint32_t end = uint32_t( uint64_t( block_count ) * ( thread + 1 ) / useful_threads );
+			uint8_t* out = static_cast<uint8_t*>( destination ) + uint64_t( first ) * header->block_size;
+			if ( !ReadBlocks( entry, first, end - first, out ) )
+				failed = true;
+		} );
+		return !failed;
+	}
+
+	bool PackFile::Fail( std::string& error, const char* message )
+	{
+		Close( );
+		error = message;
+		return false;
+	}
+
+	void PackFileWriter::AddFile( const std::string& path, const void* data, size_t size )
+	{
+		PendingFile file = { path, static_cast<const uint8_t*>( data ), size };
+		files.push_back( file );
+	}
+
+	void PackFileWriter::Build( std::vector<uint8_t>& file, uint32_t thread_count ) const
+	{
+		std::vector<uint32_t> order( files.size( ) );
+		for ( uint32_t f = 0; f < uint32_t( order.size( ) ); ++f )
+			order[f] = f;
+		std::sort( order.begin( ), order.end( ), [ this ] ( uint32_t a, uint32_t b ) { return files[a].path < files[b].path; } );
+
+		std::vector<PackFileEntry> entries( files.size( ) );
+		std::vector<PackFileHashSlot> hash_slots( files.size( ) );
+		std::string paths;
+		uint32_t block_count = 0;
+		for ( uint32_t e = 0; e < uint32_t( order.size( ) ); ++e )
+		{
+			const PendingFile& pending = files[order[e]];
+			PackFileEntry& entry = entries[e];
+			entry.path_offset = uint32_t( paths.size( ) );
+			entry.first_block = block_count;
+			entry.block_count = BlockCount( pending.size, pack_block_size );
+			entry.reserved = 0;
+			entry.size = pending.size;
+			block_count += entry.block_count;
+			paths.append( pending.path.c_str( ), pending.path.size( ) + 1 );
+
+			PackFileHashSlot slot = { PackPathHash( pending.path.c_str( ) ), e, 0 };
+			hash_slots[e] = slot;
+		}
+		std::sort( hash_slots.begin( ), hash_slots.end( ), [ ] ( const PackFileHashSlot& a, const PackFileHashSlot& b ) { return a.hash < b.hash; } );
+
+		// every block on its own, threads take the next one until none are left
+		struct PendingBlock
+		{
+			const uint8_t* data;
+			size_t size;
+			std::vector<uint8_t> compressed;	// empty when the block is stored
+		};
+		std::vector<PendingBlock> pending_blocks( block_count );
+		for ( const PackFileEntry& entry : entries )
+		{
+			const PendingFile& pending = files[order[&entry - entries.data( )]];
+			for ( uint32_t b = 0; b < entry.block_count; ++b )
+			{
+				PendingBlock& block = pending_blocks[entry.first_block + b];
+				block.data = pending.data + uint64_t( b ) * pack_block_size;
+				block.size = size_t( std::min<uint64_t>( pack_block_size, pending.size - uint64_t( b ) * pack_block_size ) );
+			}
+		}
+		std::atomic<uint32_t> next_block( 0 );
+		RunOnThreads( std::max( 1u, thread_count ), [ & ] ( uint32_t )
+		{
+			std::vector<uint8_t> scratch( LzCompressBound( pack_block_size ) );
+			for ( uint32_t b = next_block++; b < block_count; b = next_block++ )
+			{
+				PendingBlock& block = pending_blocks[b];
+				const size_t compressed_size = LzCompress( block.data, block.size, scratch.data( ) );
+				// a block that barely compresses reads faster stored, decompressing it costs more than the bytes it saves
+				if ( compressed_size < block.size - block.size / 16 )
+					block.compressed.assign( scratch.begin( ), scratch.begin( ) + compressed_size );
+			}
+		} );
+
+		// layout: tables, paths, then each entry's blocks back to back from an aligned start
+		std::vector<PackFileBlock> blocks( block_count );
+		uint64_t offset = sizeof( PackFileHeader ) + entries.size( ) * ( sizeof( PackFileEntry ) + sizeof( PackFileHashSlot ) ) +
+			uint64_t( block_count ) * sizeof( PackFileBlock ) + paths.size( );
+		for ( const PackFileEntry& entry : entries )
+		{
+			offset = AlignUp( offset );
+			for ( uint32_t b = entry.first_block; b < entry.first_block + entry.block_count; ++b )
+			{
+				const PendingBlock& pending = pending_blocks[b];
+				const uint32_t stored_size = uint32_t( pending.compressed.empty( ) ? pending.size : pending.compressed.size( ) );
+				PackFileBlock block = { offset, stored_size, 0 };
+				blocks[b] = block;
+				offset += stored_size;
+			}
+		}
+
+		// padding stays zero, so identical input gives identical files
+		file.assign( size_t( offset ), 0 );
+		PackFileHeader header = { pack_file_magic, pack_file_version, pack_block_size, uint32_t( entries.size( ) ), block_count, uint32_t( paths.size( ) ), offset };
+		uint8_t* out = file.data( );
+		std::memcpy( out, &header, sizeof( header ) );
+		out += sizeof( header );
+		if ( !entries.empty( ) )
+		{
+			std::memcpy( out, entries.data( ), entries.size( ) * sizeof( PackFileEntry ) );
+			out += entries.size( ) * sizeof( PackFileEntry );
+			std::memcpy( out, hash_slots.data( ), hash_slots.size( ) * sizeof( PackFileHashSlot ) );
+			out += hash_slots.size( ) * sizeof( PackFileHashSlot );
+		}
+		if ( !blocks.empty( ) )
+		{
+			std::memcpy( out, blocks.data( ), blocks.size( ) * sizeof( PackFileBlock ) );
+			out += blocks.size( ) * sizeof( PackFileBlock );
+		}
+		std::memcpy( out, paths.data( ), paths.size( ) );
+		for ( uint32_t b = 0; b < block_count; ++b )
+		{
+			const PendingBlock& pending = pending_blocks[b];
+			const uint8_t* stored = pending.compressed.empty( ) ? pending.data : pending.compressed.data( );
+			if ( blocks[b].stored_size )
+				std::memcpy( file.data( ) + blocks[b].offset, stored, blocks[b].stored_size );
+		}
+	}
+
+	bool PackFileWriter::Save( const char* path, uint32_t thread_count ) const
+	{
+		std::vector<uint8_t> file;
+		Build( file, thread_count );
+
+		FILE* out = std::fopen( path, "wb" );
+		if ( !out )
+			return false;
+		const bool written = std::fwrite( file.data( ), 1, file.size( ), out ) == file.size( );
+		return std::fclose( out ) == 0 && written;
+	}
+}
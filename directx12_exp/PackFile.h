@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileMapping.h"
+
+// many asset files in one, so loading one costs a hash lookup in a mapping that's already open instead of
+// a file open. Layout:
+//	PackFileHeader
+//	PackFileEntry[entry_count], sorted by path
+//	PackFileHashSlot[entry_count], sorted by hash
+//	PackFileBlock[block_count]
+//	paths, zero terminated
+//	block data, every entry's first block starting at a multiple of pack_file_alignment
+// Entries are cut into blocks of pack_block_size bytes, each compressed on its own with LzCompress or stored
+// as it is when that doesn't save anything. Any block decompresses without the ones before it, so parts of
+// an entry can be read alone and a big entry's blocks can be spread over threads. Paths are relative with
+// '/' between directories, entries of a directory are next to each other in path order. Little endian
+
+namespace DXLayer
+{
+	static const uint32_t pack_file_magic = 0x4b505844; // "DXPK"
+	static const uint32_t pack_file_version = 1;
+	static const uint32_t pack_block_size = 64 << 10;
+	static const uint32_t pack_file_alignment = 64;
+
+	struct PackFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t block_size;
+		uint32_t entry_count;
+		uint32_t block_count;
+		uint32_t paths_size;
+		uint64_t file_size;
+	};
+
+	struct PackFileEntry
+	{
+		uint32_t path_offset;	// into the paths
+		uint32_t first_block;
+		uint32_t block_count;	// size rounded up to whole blocks
+		uint32_t reserved;
+		uint64_t size;			// uncompressed
+	};
+
+	struct PackFileHashSlot
+	{
+		uint64_t hash;			// PackPathHash of the entry's path
+		uint32_t entry;
+		uint32_t reserved;
+	};
+
+	struct PackFileBlock
+	{
+		uint64_t offset;		// from the start of the file
+		uint32_t stored_size;	// equal to the uncompressed size for blocks that are stored as they are
+		uint32_t reserved;
+	};
+
+	// 64-bit fnv-1a
+	uint64_t PackPathHash( const char* path );
+
+	// read-only view of a pack file. Every const method may be called from any number of threads at once
+	class PackFile
+	{
+	public:
+		static const uint32_t invalid_entry = ~0u;
+
+		PackFile( );
+
+		// validates the header and tables, block data is checked when it's decompressed
+		bool Open( const char* path, std::string& error );
+		void Close( );
+
+		uint32_t Find( const char* path ) const;
+
+		// entries whose path starts with prefix, "meshes/" for a directory, as [first, end)
+		void FindPrefix( const char* prefix, uint32_t& first, uint32_t& end ) const;
+
+		uint32_t EntryCount( ) const { return header ? header->entry_count : 0; }
+		const char* EntryPath( uint32_t entry ) const { return paths + entries[entry].path_offset; }
+		uint64_t EntrySize( uint32_t entry ) const { return entries[entry].size; }
+		uint32_t EntryBlockCount( uint32_t entry ) const { return entries[entry].block_count; }
+
+		// blocks [first_block, first_block + block_count) of an entry, into destination. False on corrupt data
+		bool ReadBlocks( uint32_t entry, uint32_t first_block, uint32_t block_count, void* destination ) const;
+
+		// the whole entry. Entries of several blocks are decompressed on up to thread_count threads, the calling
+		// thread is one of them, as long as every thread gets pack_parallel_min_blocks or more
+		bool ReadEntry( uint32_t entry, void* destination, uint32_t thread_count = 1 ) const;
+
+		static const uint32_t pack_parallel_min_blocks = 8;
+
+	private:
+		PackFile( const PackFile& );
+		PackFile& operator=( const PackFile& );
+
+		bool Fail( std::string& error, const char* message );
+
+		FileMapping mapping;
+		const PackFileHeader* header;
+		const PackFileEntry* entries;
+		const PackFileHashSlot* hash_slots;
+		const PackFileBlock* blocks;
+		const char* paths;
+	};
+
+	// collects files and lays them out. The data has to stay alive until Build or Save
+	class PackFileWriter
+	{
+	public:
+		void AddFile( const std::string& path, const void* data, size_t size );
+
+		// blocks are compressed on thread_count threads
+		void Build( std::vector<uint8_t>& file, uint32_t thread_count = 1 ) const;
+		bool Save( const char* path, uint32_t thread_count = 1 ) const;
+
+	private:
+		struct PendingFile
+		{
+			std::string path;
+			const uint8_t* data;
+			size_t size;
+		};
+
+		std::vector<PendingFile> files;
+	};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "ConstantBufferLayout.h"
+#include "RootSignatureDescription.h"
+
+namespace DXLayer
+{
+	// how many of the 64 root signature DWORDs a single per-draw payload may take as root constants.
+	// Root constants live in the command list itself, so setting them costs no memory write and no indirection,
+	// but every DWORD spent here is taken from the other root parameters
+	static const uint32_t per_draw_root_constants_budget = 16;
+
+	// per-draw data declared as a cbuffer layout. The shader always sees a cbuffer at the given register;
+	// small payloads are passed as root constants, larger ones are written to the frame upload buffer
+	// and bound as a root cbv. The choice is made at compile time from the layout size and the budget.
+	// No d3d in here: the builder, command list and upload buffer are template parameters, RootSignatureBuilder,
+	// ID3D12GraphicsCommandList and FrameUploadBuffer in the renderer, stand-ins in asset_tool's bench-per-draw
+	template<typename Layout, uint32_t Budget = per_draw_root_constants_budget>
+	class PerDrawParameter
+	{
+	public:
+		// root constants only need the DWORDs actually used, not whole registers
+		static const uint32_t num_32bit_values = ( Layout::Pack::end + 3 ) / 4;
+		static const bool uses_root_constants = num_32bit_values <= Budget;
+
+		PerDrawParameter( )
+			: root_parameter_index( 0 )
+		{ }
+
+		// visibility is a D3D12_SHADER_VISIBILITY, 0 is ALL
+		static RootParameterDescription RootParameter( uint32_t shader_register, uint32_t register_space = 0, uint32_t visibility = 0 )
+		{
+			RootParameterDescription parameter = { };
+			parameter.visibility = visibility;
+			parameter.shader_register = shader_register;
+			parameter.register_space = register_space;
+			if ( uses_root_constants )
+			{
+				parameter.type = root_parameter_constants;
+				parameter.num_32bit_values = num_32bit_values;
+			}
+			else // the upload buffer region is written before the command list is recorded and never modified afterwards
+			{
+				parameter.type = root_parameter_cbv;
+				parameter.flags = root_descriptor_data_static;
+			}
+			return parameter;
+		}
+
+		template<typename Builder>
+		void AddToRootSignature( Builder& builder, uint32_t shader_register, uint32_t register_space = 0, uint32_t visibility = 0 )
+		{
+			root_parameter_index = builder.Add( RootParameter( shader_register, register_space, visibility ) );
+		}
+
+		// fill is called with a CBufferWriter<Layout>& and must write the payload.
+		// upload_buffer is only used for payloads that don't fit into root constants
+		template<typename CommandList, typename UploadBuffer, typename FillFn>
+		bool Set( CommandList* command_list, UploadBuffer& upload_buffer, FillFn fill ) const
+		{
+			return Set( command_list, upload_buffer, fill, std::integral_constant<bool, uses_root_constants>( ) );
+		}
+
+		uint32_t RootParameterIndex( ) const { return root_parameter_index; }
+
+	private:
+		template<typename CommandList, typename UploadBuffer, typename FillFn>
+		bool Set( CommandList* command_list, UploadBuffer&, FillFn& fill, std::true_type ) const
+		{
+			uint32_t values[num_32bit_values] = { };
+			CBufferWriter<Layout> writer( values );
+			fill( writer );
+			command_list->SetGraphicsRoot32BitConstants( root_parameter_index, num_32bit_values, values, 0 );
+			return true;
+		}
+
+		template<typename CommandList, typename UploadBuffer, typename FillFn>
+		bool Set( CommandList* command_list, UploadBuffer& upload_buffer, FillFn& fill, std::false_type ) const
+		{
+			typename UploadBuffer::Allocation allocation;
+			if ( !upload_buffer.Allocate( Layout::cbv_size, cbuffer_placement_alignment, allocation ) )
+				return false;
+
+			CBufferWriter<Layout> writer( allocation.cpu_address );
+			fill( writer );
+			command_list->SetGraphicsRootConstantBufferView( root_parameter_index, allocation.gpu_address );
+			return true;
+		}
+
+		uint32_t root_parameter_index;
+	};
+}
@@ -0,0 +1,119 @@
+#include "PersistentGeometryBuffer.h"
+
+#include "d3dx12.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const UINT64 unit_size = 16;
+		const D3D12_RESOURCE_STATES geometry_state = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER;
+	}
+
+	const UINT PersistentGeometryBuffer::invalid_block;
+
+	PersistentGeometryBuffer::PersistentGeometryBuffer( )
+		: buffer( nullptr ), gpu_address( 0 ), buffer_state( geometry_state )
+	{ }
+
+	bool PersistentGeometryBuffer::Init( ID3D12Device* device, UINT64 size, const wchar_t* name )
+	{
+		buffer_state = geometry_state;
+		HRESULT hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_DEFAULT ),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer( size ),
+			buffer_state,
+			nullptr,
+			IID_PPV_ARGS( &buffer ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		if ( name )
+			buffer->SetName( name );
+
+		gpu_address = buffer->GetGPUVirtualAddress( );
+		allocator.Reset( UINT( size / unit_size ) );
+		blocks.clear( );
+		free_blocks.clear( );
+		return true;
+	}
+
+	UINT PersistentGeometryBuffer::Allocate( UINT64 size )
+	{
+		const UINT units = UINT( ( size + unit_size - 1 ) / unit_size );
+		const UINT offset = units ? allocator.Allocate( units ) : RangeAllocator::invalid_offset;
+		if ( offset == RangeAllocator::invalid_offset )
+			return invalid_block;
+
+		const Block block = { offset * unit_size, size, true };
+		if ( !free_blocks.empty( ) )
+		{
+			const UINT id = free_blocks.back( );
+			free_blocks.pop_back( );
+			blocks[id] = block;
+			return id;
+		}
+		blocks.push_back( block );
+		return UINT( blocks.size( ) - 1 );
+	}
+
+	void PersistentGeometryBuffer::Free( UINT block )
+	{
+		if ( block >= blocks.size( ) || !blocks[block].live )
+			return;
+		allocator.Free( UINT( blocks[block].offset / unit_size ), UINT( ( blocks[block].size + unit_size - 1 ) / unit_size ) );
+		blocks[block].live = false;
+		free_blocks.push_back( block );
+	}
+
+	void PersistentGeometryBuffer::Promote( ID3D12GraphicsCommandList* command_list, ID3D12Resource* upload, const Promotion* promotions, UINT count )
+	{
+		if ( !count )
+			return;
+
+		Transition( command_list, D3D12_RESOURCE_STATE_COPY_DEST );
+		for ( UINT p = 0; p < count; ++p )
+		{
+			const Block& block = blocks[promotions[p].block];
+			command_list->CopyBufferRegion( buffer, block.offset, upload, promotions[p].upload_offset, block.size );
+		}
+		Transition( command_list, geometry_state );
+	}
+
+	D3D12_VERTEX_BUFFER_VIEW PersistentGeometryBuffer::VertexView( UINT block, UINT stride ) const
+	{
+		D3D12_VERTEX_BUFFER_VIEW view;
+		view.BufferLocation = gpu_address + blocks[block].offset;
+		view.StrideInBytes = stride;
+		view.SizeInBytes = UINT( blocks[block].size );
+		return view;
+	}
+
+	D3D12_INDEX_BUFFER_VIEW PersistentGeometryBuffer::IndexView( UINT block, DXGI_FORMAT format ) const
+	{
+		D3D12_INDEX_BUFFER_VIEW view;
+		view.BufferLocation = gpu_address + blocks[block].offset;
+		view.SizeInBytes = UINT( blocks[block].size );
+		view.Format = format;
+		return view;
+	}
+
+	void PersistentGeometryBuffer::Release( )
+	{
+		if ( buffer )
+			buffer->Release( );
+		buffer = nullptr;
+		blocks.clear( );
+		free_blocks.clear( );
+	}
+
+	void PersistentGeometryBuffer::Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES state )
+	{
+		if ( state == buffer_state )
+			return;
+		const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition( buffer, buffer_state, state );
+		command_list->ResourceBarrier( 1, &barrier );
+		buffer_state = state;
+	}
+}
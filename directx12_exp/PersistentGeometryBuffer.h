@@ -0,0 +1,61 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <vector>
+
+#include "GeometryPool.h"
+
+namespace DXLayer
+{
+	// a default heap buffer for geometry the cpu wrote into the frame upload buffer and wants to keep drawing for
+	// many frames: promoting it costs one copy and a barrier once, instead of writing it again every frame. Blocks of
+	// any size come from a RangeAllocator in 16 byte units. Between promotions the buffer sits in the vertex and
+	// index buffer states
+	class PersistentGeometryBuffer
+	{
+	public:
+		static const UINT invalid_block = ~0u;
+
+		struct Promotion
+		{
+			UINT block;
+			UINT64 upload_offset;		// of the data in the upload buffer, its size is the block's
+		};
+
+		PersistentGeometryBuffer( );
+
+		bool Init( ID3D12Device* device, UINT64 size, const wchar_t* name );
+
+		// invalid_block when no free range is large enough
+		UINT Allocate( UINT64 size );
+
+		// once the gpu is done with the draws reading it
+		void Free( UINT block );
+
+		// copies the data of every promotion out of upload, with one barrier before the batch and one after
+		void Promote( ID3D12GraphicsCommandList* command_list, ID3D12Resource* upload, const Promotion* promotions, UINT count );
+
+		D3D12_VERTEX_BUFFER_VIEW VertexView( UINT block, UINT stride ) const;
+		D3D12_INDEX_BUFFER_VIEW IndexView( UINT block, DXGI_FORMAT format ) const;
+
+		void Release( );
+
+	private:
+		struct Block
+		{
+			UINT64 offset;
+			UINT64 size;
+			bool live;
+		};
+
+		void Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES state );
+
+		ID3D12Resource* buffer;
+		D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+		D3D12_RESOURCE_STATES buffer_state;
+		RangeAllocator allocator;
+		std::vector<Block> blocks;
+		std::vector<UINT> free_blocks;		// ids to reuse
+	};
+}
@@ -0,0 +1,224 @@
+#include "PipelineStateRegistry.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Hash.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// calls visit( field of a, same field of b ) for everything in the descs but the input layout and the shaders.
+		// Field by field, the state structs have padding
+		template<typename Visit>
+		void VisitStates( const D3D12_GRAPHICS_PIPELINE_STATE_DESC& a, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& b, Visit visit )
+		{
+			visit( a.pRootSignature, b.pRootSignature );
+			visit( a.StreamOutput.pSODeclaration, b.StreamOutput.pSODeclaration );
+			visit( a.StreamOutput.NumEntries, b.StreamOutput.NumEntries );
+			visit( a.StreamOutput.pBufferStrides, b.StreamOutput.pBufferStrides );
+			visit( a.StreamOutput.NumStrides, b.StreamOutput.NumStrides );
+			visit( a.StreamOutput.RasterizedStream, b.StreamOutput.RasterizedStream );
+
+			visit( a.BlendState.AlphaToCoverageEnable, b.BlendState.AlphaToCoverageEnable );
+			visit( a.BlendState.IndependentBlendEnable, b.BlendState.IndependentBlendEnable );
+			for ( size_t i = 0; i < _countof( a.BlendState.RenderTarget ); ++i )
+			{
+				visit( a.BlendState.RenderTarget[i].BlendEnable, b.BlendState.RenderTarget[i].BlendEnable );
+				visit( a.BlendState.RenderTarget[i].LogicOpEnable, b.BlendState.RenderTarget[i].LogicOpEnable );
+				visit( a.BlendState.RenderTarget[i].SrcBlend, b.BlendState.RenderTarget[i].SrcBlend );
+				visit( a.BlendState.RenderTarget[i].DestBlend, b.BlendState.RenderTarget[i].DestBlend );
+				visit( a.BlendState.RenderTarget[i].BlendOp, b.BlendState.RenderTarget[i].BlendOp );
+				visit( a.BlendState.RenderTarget[i].SrcBlendAlpha, b.BlendState.RenderTarget[i].SrcBlendAlpha );
+				visit( a.BlendState.RenderTarget[i].DestBlendAlpha, b.BlendState.RenderTarget[i].DestBlendAlpha );
+				visit( a.BlendState.RenderTarget[i].BlendOpAlpha, b.BlendState.RenderTarget[i].BlendOpAlpha );
+				visit( a.BlendState.RenderTarget[i].LogicOp, b.BlendState.RenderTarget[i].LogicOp );
+				visit( a.BlendState.RenderTarget[i].RenderTargetWriteMask, b.BlendState.RenderTarget[i].RenderTargetWriteMask );
+			}
+			visit( a.SampleMask, b.SampleMask );
+
+			visit( a.RasterizerState.FillMode, b.RasterizerState.FillMode );
+			visit( a.RasterizerState.CullMode, b.RasterizerState.CullMode );
+			visit( a.RasterizerState.FrontCounterClockwise, b.RasterizerState.FrontCounterClockwise );
+			visit( a.RasterizerState.DepthBias, b.RasterizerState.DepthBias );
+			visit( a.RasterizerState.DepthBiasClamp, b.RasterizerState.DepthBiasClamp );
+			visit( a.RasterizerState.SlopeScaledDepthBias, b.RasterizerState.SlopeScaledDepthBias );
+			visit( a.RasterizerState.DepthClipEnable, b.RasterizerState.DepthClipEnable );
+			visit( a.RasterizerState.MultisampleEnable, b.RasterizerState.MultisampleEnable );
+			visit( a.RasterizerState.AntialiasedLineEnable, b.RasterizerState.AntialiasedLineEnable );
+			visit( a.RasterizerState.ForcedSampleCount, b.RasterizerState.ForcedSampleCount );
+			visit( a.RasterizerState.ConservativeRaster, b.RasterizerState.ConservativeRaster );
+
+			visit( a.DepthStencilState.DepthEnable, b.DepthStencilState.DepthEnable );
+			visit( a.DepthStencilState.DepthWriteMask, b.DepthStencilState.DepthWriteMask );
+			visit( a.DepthStencilState.DepthFunc, b.DepthStencilState.DepthFunc );
+			visit( a.DepthStencilState.StencilEnable, b.DepthStencilState.StencilEnable );
+			visit( a.DepthStencilState.StencilReadMask, b.DepthStencilState.StencilReadMask );
+			visit( a.DepthStencilState.StencilWriteMask, b.DepthStencilState.StencilWriteMask );
+			const D3D12_DEPTH_STENCILOP_DESC* faces_a[] = { &a.DepthStencilState.FrontFace, &a.DepthStencilState.BackFace };
+			const D3D12_DEPTH_STENCILOP_DESC* faces_b[] = { &b.DepthStencilState.FrontFace, &b.DepthStencilState.BackFace };
+			for ( int i = 0; i < 2; ++i )
+			{
+				visit( faces_a[i]->StencilFailOp, faces_b[i]->StencilFailOp );
+				visit( faces_a[i]->StencilDepthFailOp, faces_b[i]->StencilDepthFailOp );
+				visit( faces_a[i]->StencilPassOp, faces_b[i]->StencilPassOp );
+				visit( faces_a[i]->StencilFunc, faces_b[i]->StencilFunc );
+			}
+
+			visit( a.IBStripCutValue, b.IBStripCutValue );
+			visit( a.PrimitiveTopologyType, b.PrimitiveTopologyType );
+			visit( a.NumRenderTargets, b.NumRenderTargets );
+			visit( a.RTVFormats, b.RTVFormats );
+			visit( a.DSVFormat, b.DSVFormat );
+			visit( a.SampleDesc.Count, b.SampleDesc.Count );
+			visit( a.SampleDesc.Quality, b.SampleDesc.Quality );
+			visit( a.NodeMask, b.NodeMask );
+			visit( a.Flags, b.Flags );
+		}
+
+		UINT64 HashStates( const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc )
+		{
+			UINT64 hash = fnv_offset_basis;
+			VisitStates( desc, desc, [&hash] ( const auto& field, const auto& ) { hash = Fnv1a64( field, hash ); } );
+			return hash;
+		}
+
+		bool SameStates( const D3D12_GRAPHICS_PIPELINE_STATE_DESC& a, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& b )
+		{
+			bool same = true;
+			VisitStates( a, b, [&same] ( const auto& field_a, const auto& field_b ) { same = same && std::memcmp( &field_a, &field_b, sizeof( field_a ) ) == 0; } );
+			return same;
+		}
+	}
+
+	PipelineStateRegistry::PipelineStateRegistry( )
+		: device( nullptr ), shaders( nullptr ), frames_in_flight( 0 ), frame_number( 0 )
+	{ }
+
+	void PipelineStateRegistry::Init( ID3D12Device* device, ShaderWatcher* shaders, UINT frames_in_flight )
+	{
+		this->device = device;
+		this->shaders = shaders;
+		this->frames_in_flight = frames_in_flight;
+	}
+
+	ID3D12PipelineState* PipelineStateRegistry::Create( const Pso& pso ) const
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = pso.desc;
+		desc.VS = shaders->Bytecode( pso.vertex_shader );
+		desc.PS = pso.pixel_shader == ShaderWatcher::invalid_shader ? D3D12_SHADER_BYTECODE( ) : shaders->Bytecode( pso.pixel_shader );
+
+		ID3D12PipelineState* pipeline_state = nullptr;
+		if ( FAILED( device->CreateGraphicsPipelineState( &desc, IID_PPV_ARGS( &pipeline_state ) ) ) )
+			return nullptr;
+
+		return pipeline_state;
+	}
+
+	UINT PipelineStateRegistry::Add( const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 input_layout_hash, UINT vertex_shader, UINT pixel_shader )
+	{
+		UINT64 key = HashCombine( input_layout_hash, HashStates( desc ) );
+		key = HashCombine( key, vertex_shader );
+		key = HashCombine( key, pixel_shader );
+
+		// a hit only counts if everything hashed is the same, keys that collide get a pso each
+		std::vector<UINT>& same_key = pso_ids[key];
+		for ( UINT id : same_key )
+		{
+			const Pso& existing = psos[id];
+			if ( existing.input_layout_hash == input_layout_hash && existing.vertex_shader == vertex_shader && existing.pixel_shader == pixel_shader &&
+				SameStates( existing.desc, desc ) )
+				return id;
+		}
+
+		Pso pso;
+		pso.desc = desc;
+		pso.input_layout_hash = input_layout_hash;
+		pso.vertex_shader = vertex_shader;
+		pso.pixel_shader = pixel_shader;
+		pso.pso = Create( pso );
+		if ( !pso.pso )
+			return invalid_pso;
+
+		psos.push_back( pso );
+		same_key.push_back( UINT( psos.size( ) - 1 ) );
+		return UINT( psos.size( ) - 1 );
+	}
+
+	void PipelineStateRegistry::BeginFrame( )
+	{
+		frame_number++;
+
+		// the caller has waited for the frame that was recorded frames_in_flight frames ago
+		auto first_alive = std::partition( retired.begin( ), retired.end( ), [this] ( const RetiredPso& pso ) { return pso.release_frame <= frame_number; } );
+		for ( auto it = retired.begin( ); it != first_alive; ++it )
+			it->pso->Release( );
+		retired.erase( retired.begin( ), first_alive );
+
+		// psos using a recompiled shader are built with the new code first. If one doesn't link the new shaders it
+		// uses go back to their old code, the watcher asks again with the rest, and whatever was built is thrown away
+		std::vector<ID3D12PipelineState*> rebuilt( psos.size( ), nullptr );
+		const auto release_rebuilt = [&rebuilt] ( )
+		{
+			for ( auto& pso : rebuilt )
+			{
+				if ( pso )
+					pso->Release( );
+				pso = nullptr;
+			}
+		};
+		const std::vector<UINT> updated_shaders = shaders->ApplyUpdates( [&] ( const std::vector<UINT>& staged )
+		{
+			release_rebuilt( );
+			std::vector<UINT> failed;
+			for ( size_t i = 0; i < psos.size( ); ++i )
+			{
+				const Pso& pso = psos[i];
+				const bool new_vertex_shader = std::find( staged.begin( ), staged.end( ), pso.vertex_shader ) != staged.end( );
+				const bool new_pixel_shader = std::find( staged.begin( ), staged.end( ), pso.pixel_shader ) != staged.end( );
+				if ( !new_vertex_shader && !new_pixel_shader )
+					continue;
+
+				rebuilt[i] = Create( pso );
+				if ( rebuilt[i] )
+					continue;
+
+				OutputDebugStringA( "failed to rebuild pso after a shader change, keeping the old shader\n" );
+				if ( new_vertex_shader )
+					failed.push_back( pso.vertex_shader );
+				if ( new_pixel_shader )
+					failed.push_back( pso.pixel_shader );
+			}
+			return failed;
+		} );
+		if ( updated_shaders.empty( ) )
+		{
+			release_rebuilt( );
+			return;
+		}
+
+		for ( size_t i = 0; i < psos.size( ); ++i )
+		{
+			if ( !rebuilt[i] )
+				continue;
+
+			RetiredPso old_pso = { psos[i].pso, frame_number + frames_in_flight };
+			retired.push_back( old_pso );
+			psos[i].pso = rebuilt[i];
+		}
+	}
+
+	void PipelineStateRegistry::Release( )
+	{
+		for ( auto& pso : retired )
+			pso.pso->Release( );
+		retired.clear( );
+
+		for ( auto& pso : psos )
+			if ( pso.pso )
+				pso.pso->Release( );
+		psos.clear( );
+		pso_ids.clear( );
+	}
+}
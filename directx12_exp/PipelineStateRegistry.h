@@ -0,0 +1,73 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderWatcher.h"
+
+namespace DXLayer
+{
+	// graphics psos built from watched shaders. When a shader is recompiled only the psos using it are rebuilt,
+	// the old ones are kept alive until every frame that might still reference them has finished.
+	// A pso asked for again with the same input layout, shaders and states is the one created the first time, keyed
+	// by the compile-time hash of the layout with the shaders and states mixed in and compared field by field on a hit
+	class PipelineStateRegistry
+	{
+	public:
+		static const UINT invalid_pso = UINT( -1 );
+
+		PipelineStateRegistry( );
+
+		void Init( ID3D12Device* device, ShaderWatcher* shaders, UINT frames_in_flight );
+
+		// VS and PS of desc are taken from the watcher, the input layout is Layout's (a VertexLayout).
+		// Everything else desc points to (root signature) must outlive the registry. Returns invalid_pso on failure
+		template<typename Layout>
+		UINT Add( D3D12_GRAPHICS_PIPELINE_STATE_DESC desc, UINT vertex_shader, UINT pixel_shader )
+		{
+			desc.InputLayout = Layout::Desc( );
+			return Add( desc, Layout::Hash( ), vertex_shader, pixel_shader );
+		}
+
+		// same, for an input layout of desc that isn't a VertexLayout. input_layout_hash has to tell it apart from
+		// every other layout
+		UINT Add( const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 input_layout_hash, UINT vertex_shader, UINT pixel_shader );
+
+		ID3D12PipelineState* Get( UINT pso_id ) const { return psos[pso_id].pso; }
+
+		// render thread, at a frame boundary before anything is recorded.
+		// Picks up recompiled shaders and rebuilds dependent psos
+		void BeginFrame( );
+
+		void Release( );
+
+	private:
+		struct Pso
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+			UINT64 input_layout_hash;
+			UINT vertex_shader;
+			UINT pixel_shader;
+			ID3D12PipelineState* pso;
+		};
+
+		struct RetiredPso
+		{
+			ID3D12PipelineState* pso;
+			UINT64 release_frame;
+		};
+
+		ID3D12PipelineState* Create( const Pso& pso ) const;
+
+		ID3D12Device* device;
+		ShaderWatcher* shaders;
+		UINT frames_in_flight;
+		UINT64 frame_number;
+
+		std::vector<Pso> psos;
+		std::unordered_map<UINT64, std::vector<UINT>> pso_ids;	// by key, more than one when keys collide
+		std::vector<RetiredPso> retired;
+	};
+}
@@ -0,0 +1,130 @@
+#include "ReadbackBuffer.h"
+
+#include <utility>
+
+#include "d3dx12.h"
+#include "TextureUpload.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// what ResolveQueryData writes for each query
+		UINT64 QueryDataSize( D3D12_QUERY_TYPE type )
+		{
+			switch ( type )
+			{
+			case D3D12_QUERY_TYPE_PIPELINE_STATISTICS:
+				return sizeof( D3D12_QUERY_DATA_PIPELINE_STATISTICS );
+			case D3D12_QUERY_TYPE_SO_STATISTICS_STREAM0:
+			case D3D12_QUERY_TYPE_SO_STATISTICS_STREAM1:
+			case D3D12_QUERY_TYPE_SO_STATISTICS_STREAM2:
+			case D3D12_QUERY_TYPE_SO_STATISTICS_STREAM3:
+				return sizeof( D3D12_QUERY_DATA_SO_STATISTICS );
+			default:
+				return sizeof( UINT64 );
+			}
+		}
+	}
+
+	ReadbackBuffer::ReadbackBuffer( )
+		: buffer( nullptr ), fence( nullptr ), mapped_data( nullptr )
+	{ }
+
+	bool ReadbackBuffer::Init( ID3D12Device* device, UINT64 size, const wchar_t* name )
+	{
+		HRESULT hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_READBACK ),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer( size ),
+			D3D12_RESOURCE_STATE_COPY_DEST, // the only allowed state for readback heaps
+			nullptr,
+			IID_PPV_ARGS( &buffer ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		if ( name )
+			buffer->SetName( name );
+
+		// mapped once, the whole of it is read from at one time or another
+		CD3DX12_RANGE read_range( 0, SIZE_T( size ) );
+		void* data;
+		if ( FAILED( buffer->Map( 0, &read_range, &data ) ) )
+			return false;
+		mapped_data = static_cast<const BYTE*>( data );
+
+		if ( FAILED( device->CreateFence( 0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS( &fence ) ) ) )
+			return false;
+		ring.Init( size, 1 );
+		return true;
+	}
+
+	bool ReadbackBuffer::ReadBuffer( ID3D12GraphicsCommandList* command_list, ID3D12Resource* source, UINT64 offset, UINT64 size, ReadbackCallback callback )
+	{
+		const UINT64 destination = ring.Allocate( size, 16, std::move( callback ) );
+		if ( destination == ReadbackRing::invalid_offset )
+			return false;
+		command_list->CopyBufferRegion( buffer, destination, source, offset, size );
+		return true;
+	}
+
+	bool ReadbackBuffer::ReadTexture( ID3D12GraphicsCommandList* command_list, ID3D12Resource* texture, UINT subresource, TextureFootprint& footprint, ReadbackCallback callback )
+	{
+		const UINT64 size = GetTextureFootprints( TextureLayoutOf( texture->GetDesc( ) ), subresource, 1, 0, &footprint );
+		if ( size == invalid_footprint_size )
+			return false;
+		const UINT64 destination = ring.Allocate( size, texture_placement_alignment, std::move( callback ) );
+		if ( destination == ReadbackRing::invalid_offset )
+			return false;
+
+		footprint.offset = destination;
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed;
+		placed.Offset = footprint.offset;
+		placed.Footprint.Format = DXGI_FORMAT( footprint.format );
+		placed.Footprint.Width = footprint.width;
+		placed.Footprint.Height = footprint.height;
+		placed.Footprint.Depth = footprint.depth;
+		placed.Footprint.RowPitch = footprint.row_pitch;
+		CD3DX12_TEXTURE_COPY_LOCATION copy_to( buffer, placed );
+		CD3DX12_TEXTURE_COPY_LOCATION copy_from( texture, subresource );
+		command_list->CopyTextureRegion( &copy_to, 0, 0, 0, &copy_from, nullptr );
+		return true;
+	}
+
+	bool ReadbackBuffer::ReadQueries( ID3D12GraphicsCommandList* command_list, ID3D12QueryHeap* heap, D3D12_QUERY_TYPE type, UINT start, UINT count, ReadbackCallback callback )
+	{
+		// resolves go to multiples of 8 bytes
+		const UINT64 destination = ring.Allocate( QueryDataSize( type ) * count, 8, std::move( callback ) );
+		if ( destination == ReadbackRing::invalid_offset )
+			return false;
+		command_list->ResolveQueryData( heap, type, start, count, buffer, destination );
+		return true;
+	}
+
+	bool ReadbackBuffer::Submit( ID3D12CommandQueue* queue )
+	{
+		return SUCCEEDED( queue->Signal( fence, ring.Submit( ) ) );
+	}
+
+	UINT ReadbackBuffer::Retire( )
+	{
+		return ring.Retire( fence->GetCompletedValue( ), mapped_data );
+	}
+
+	void ReadbackBuffer::Release( )
+	{
+		ring.Clear( );
+		if ( buffer )
+		{
+			// nothing was written
+			CD3DX12_RANGE written_range( 0, 0 );
+			buffer->Unmap( 0, &written_range );
+			buffer->Release( );
+			buffer = nullptr;
+		}
+		if ( fence )
+			fence->Release( );
+		fence = nullptr;
+		mapped_data = nullptr;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "ReadbackRing.h"
+#include "TextureFootprints.h"
+
+namespace DXLayer
+{
+	// a ReadbackRing over a buffer in a readback heap, mapped for its whole lifetime, with a fence of its own. Passes
+	// record their copies into it on any command list going out before the next Submit, Retire at the start of a
+	// frame delivers whatever has come back. The buffer stays in the copy dest state, as readback heaps require
+	class ReadbackBuffer
+	{
+	public:
+		ReadbackBuffer( );
+
+		bool Init( ID3D12Device* device, UINT64 size, const wchar_t* name );
+
+		// size bytes from offset in source, a buffer in the copy source state. False when the ring is full
+		bool ReadBuffer( ID3D12GraphicsCommandList* command_list, ID3D12Resource* source, UINT64 offset, UINT64 size, ReadbackCallback callback );
+
+		// a subresource of a texture in the copy source state, screenshots and feedback maps. footprint says how the
+		// callback's data is laid out, its offset is from the start of the buffer. False when the ring is full or
+		// the format isn't one GetTextureFootprints covers
+		bool ReadTexture( ID3D12GraphicsCommandList* command_list, ID3D12Resource* texture, UINT subresource, TextureFootprint& footprint, ReadbackCallback callback );
+
+		// queries [start, start + count) of a heap, resolved straight into the ring
+		bool ReadQueries( ID3D12GraphicsCommandList* command_list, ID3D12QueryHeap* heap, D3D12_QUERY_TYPE type, UINT start, UINT count, ReadbackCallback callback );
+
+		// signals the fence after the command lists with this frame's copies were executed on queue
+		bool Submit( ID3D12CommandQueue* queue );
+
+		// calls back every readback that's done, never waits. Returns how many
+		UINT Retire( );
+
+		const ReadbackRing& Ring( ) const { return ring; }
+
+		void Release( );
+
+	private:
+		ReadbackRing ring;
+		ID3D12Resource* buffer;
+		ID3D12Fence* fence;
+		const BYTE* mapped_data;
+	};
+}
@@ -0,0 +1,76 @@
+#include "ReadbackRing.h"
+
+#include <utility>
+
+namespace DXLayer
+{
+	const uint64_t ReadbackRing::invalid_offset;
+
+	ReadbackRing::ReadbackRing( )
+		: size( 0 ), tail( 0 ), used( 0 ), next_fence_value( 1 )
+	{ }
+
+	void ReadbackRing::Init( uint64_t size, uint64_t first_fence_value )
+	{
+		this->size = size;
+		next_fence_value = first_fence_value;
+		Clear( );
+	}
+
+	uint64_t ReadbackRing::Allocate( uint64_t size, uint64_t alignment, ReadbackCallback callback )
+	{
+		if ( size > this->size )
+			return invalid_offset;
+
+		// the free space runs from tail around to the oldest slot. A slot that would cross the end of the buffer
+		// starts over at 0 and the rest of the end goes with it
+		uint64_t offset = ( tail + alignment - 1 ) & ~( alignment - 1 );
+		uint64_t span = offset + size - tail;
+		if ( offset + size > this->size )
+		{
+			offset = 0;
+			span = this->size - tail + size;
+		}
+		if ( used + span > this->size )
+			return invalid_offset;
+
+		tail = offset + size == this->size ? 0 : offset + size;
+		used += span;
+		slots.push_back( Slot{ offset, size, span, next_fence_value, std::move( callback ) } );
+		return offset;
+	}
+
+	uint64_t ReadbackRing::Submit( )
+	{
+		return next_fence_value++;
+	}
+
+	uint32_t ReadbackRing::Retire( uint64_t completed_value, const uint8_t* data )
+	{
+		uint32_t retired = 0;
+		while ( !slots.empty( ) && slots.front( ).fence_value <= completed_value )
+		{
+			// freed before the callback so it can ask again. Whatever it gets is only written by copies recorded
+			// from now on, the data it reads stays as it is
+			Slot slot = std::move( slots.front( ) );
+			slots.pop_front( );
+			used -= slot.span;
+			if ( slots.empty( ) )
+			{
+				tail = 0;
+				used = 0;
+			}
+			if ( slot.callback )
+				slot.callback( data + slot.offset, slot.size );
+			++retired;
+		}
+		return retired;
+	}
+
+	void ReadbackRing::Clear( )
+	{
+		slots.clear( );
+		tail = 0;
+		used = 0;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// space in one persistently mapped readback buffer for copies the gpu makes for the cpu: screenshots, query results,
+// culling stats, feedback buffers. Each readback gets a slot tagged with the fence value of the submission its copy
+// goes out with, and its callback runs once that value has completed, frames later, in the order they were asked for.
+// Nothing ever waits on the gpu, when the ring is full of readbacks not back yet new ones are refused. No d3d in here
+
+namespace DXLayer
+{
+	// data is the slot's bytes in the mapped buffer, valid during the callback only
+	typedef std::function<void( const uint8_t* data, uint64_t size )> ReadbackCallback;
+
+	class ReadbackRing
+	{
+	public:
+		static const uint64_t invalid_offset = ~0ull;
+
+		ReadbackRing( );
+
+		// an empty ring over size bytes, fence values counting up from first_fence_value
+		void Init( uint64_t size, uint64_t first_fence_value = 1 );
+
+		// the offset of size bytes at a multiple of alignment, a power of two, for copies recorded before the next
+		// Submit. invalid_offset when that doesn't fit in the space readbacks still in flight leave. Callbacks may
+		// ask for more readbacks
+		uint64_t Allocate( uint64_t size, uint64_t alignment, ReadbackCallback callback );
+
+		// the fence value to signal on the queue after the command lists holding the copies of the slots allocated
+		// since the last Submit
+		uint64_t Submit( );
+
+		// calls back every slot whose fence value completed_value has reached, oldest first, with the buffer
+		// mapped at data, and frees it. Returns how many
+		uint32_t Retire( uint64_t completed_value, const uint8_t* data );
+
+		// forgets every slot without calling back, for when their copies are never going to run
+		void Clear( );
+
+		uint64_t Size( ) const { return size; }
+		uint64_t Used( ) const { return used; }						// the slots' bytes and the gaps before them
+		uint32_t InFlight( ) const { return uint32_t( slots.size( ) ); }
+		uint64_t NextFenceValue( ) const { return next_fence_value; }
+
+	private:
+		struct Slot
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint64_t span;				// from the end of the slot before it, alignment and the gap of a wrap included
+			uint64_t fence_value;
+			ReadbackCallback callback;
+		};
+
+		std::deque<Slot> slots;			// oldest first, their fence values never go down
+		uint64_t size;
+		uint64_t tail;					// where the free space starts
+		uint64_t used;
+		uint64_t next_fence_value;
+	};
+}
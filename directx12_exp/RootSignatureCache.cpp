@@ -0,0 +1,232 @@
+#include "RootSignatureCache.h"
+
+#include <fstream>
+
+namespace DXLayer
+{
+	RootSignatureBuilder::RootSignatureBuilder( D3D12_ROOT_SIGNATURE_FLAGS flags )
+	{
+		description.flags = flags;
+	}
+
+	UINT RootSignatureBuilder::AddParameter( RootParameterType type, UINT shader_register, UINT register_space, UINT num_32bit_values, UINT flags,
+											  D3D12_SHADER_VISIBILITY visibility )
+	{
+		RootParameterDescription parameter = { };
+		parameter.type = type;
+		parameter.visibility = visibility;
+		parameter.shader_register = shader_register;
+		parameter.register_space = register_space;
+		parameter.num_32bit_values = num_32bit_values;
+		parameter.flags = flags;
+		return Add( parameter );
+	}
+
+	UINT RootSignatureBuilder::Add( const RootParameterDescription& parameter )
+	{
+		description.parameters.push_back( parameter );
+		return UINT( description.parameters.size( ) - 1 );
+	}
+
+	UINT RootSignatureBuilder::AddConstants( UINT num_32bit_values, UINT shader_register, UINT register_space, D3D12_SHADER_VISIBILITY visibility )
+	{
+		return AddParameter( root_parameter_constants, shader_register, register_space, num_32bit_values, 0, visibility );
+	}
+
+	UINT RootSignatureBuilder::AddCBV( UINT shader_register, UINT register_space, D3D12_ROOT_DESCRIPTOR_FLAGS flags, D3D12_SHADER_VISIBILITY visibility )
+	{
+		return AddParameter( root_parameter_cbv, shader_register, register_space, 0, flags, visibility );
+	}
+
+	UINT RootSignatureBuilder::AddSRV( UINT shader_register, UINT register_space, D3D12_ROOT_DESCRIPTOR_FLAGS flags, D3D12_SHADER_VISIBILITY visibility )
+	{
+		return AddParameter( root_parameter_srv, shader_register, register_space, 0, flags, visibility );
+	}
+
+	UINT RootSignatureBuilder::AddUAV( UINT shader_register, UINT register_space, D3D12_ROOT_DESCRIPTOR_FLAGS flags, D3D12_SHADER_VISIBILITY visibility )
+	{
+		return AddParameter( root_parameter_uav, shader_register, register_space, 0, flags, visibility );
+	}
+
+	UINT RootSignatureBuilder::AddTable( const D3D12_DESCRIPTOR_RANGE1* table_ranges, UINT num_ranges, D3D12_SHADER_VISIBILITY visibility )
+	{
+		const UINT index = AddParameter( root_parameter_table, 0, 0, 0, 0, visibility );
+		for ( UINT i = 0; i < num_ranges; ++i )
+		{
+			const D3D12_DESCRIPTOR_RANGE1& range = table_ranges[i];
+			const RootDescriptorRange copy = { UINT( range.RangeType ), range.NumDescriptors, range.BaseShaderRegister, range.RegisterSpace,
+											   UINT( range.Flags ), range.OffsetInDescriptorsFromTableStart };
+			description.parameters[index].ranges.push_back( copy );
+		}
+		return index;
+	}
+
+	void RootSignatureBuilder::AddStaticSampler( const D3D12_STATIC_SAMPLER_DESC& sampler )
+	{
+		const RootStaticSampler copy = { UINT( sampler.Filter ), UINT( sampler.AddressU ), UINT( sampler.AddressV ), UINT( sampler.AddressW ),
+										 sampler.MipLODBias, sampler.MaxAnisotropy, UINT( sampler.ComparisonFunc ), UINT( sampler.BorderColor ),
+										 sampler.MinLOD, sampler.MaxLOD, sampler.ShaderRegister, sampler.RegisterSpace, UINT( sampler.ShaderVisibility ) };
+		description.static_samplers.push_back( copy );
+	}
+
+	const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& RootSignatureBuilder::Desc( )
+	{
+		const size_t count = description.parameters.size( );
+		parameters.resize( count );
+		ranges.resize( count );
+		for ( size_t i = 0; i < count; ++i )
+		{
+			const RootParameterDescription& parameter = description.parameters[i];
+			const D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY( parameter.visibility );
+			const D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAGS( parameter.flags );
+			ranges[i].clear( );
+			switch ( parameter.type )
+			{
+			case root_parameter_constants:
+				parameters[i].InitAsConstants( parameter.num_32bit_values, parameter.shader_register, parameter.register_space, visibility );
+				break;
+			case root_parameter_cbv:
+				parameters[i].InitAsConstantBufferView( parameter.shader_register, parameter.register_space, flags, visibility );
+				break;
+			case root_parameter_srv:
+				parameters[i].InitAsShaderResourceView( parameter.shader_register, parameter.register_space, flags, visibility );
+				break;
+			case root_parameter_uav:
+				parameters[i].InitAsUnorderedAccessView( parameter.shader_register, parameter.register_space, flags, visibility );
+				break;
+			case root_parameter_table:
+				for ( const auto& range : parameter.ranges )
+				{
+					CD3DX12_DESCRIPTOR_RANGE1 copy;
+					copy.Init( D3D12_DESCRIPTOR_RANGE_TYPE( range.range_type ), range.num_descriptors, range.base_shader_register, range.register_space,
+							   D3D12_DESCRIPTOR_RANGE_FLAGS( range.flags ), range.offset_in_descriptors_from_table_start );
+					ranges[i].push_back( copy );
+				}
+				parameters[i].InitAsDescriptorTable( UINT( ranges[i].size( ) ), ranges[i].empty( ) ? nullptr : ranges[i].data( ), visibility );
+				break;
+			}
+		}
+
+		static_samplers.clear( );
+		for ( const auto& sampler : description.static_samplers )
+		{
+			const D3D12_STATIC_SAMPLER_DESC copy = { D3D12_FILTER( sampler.filter ), D3D12_TEXTURE_ADDRESS_MODE( sampler.address_u ),
+													 D3D12_TEXTURE_ADDRESS_MODE( sampler.address_v ), D3D12_TEXTURE_ADDRESS_MODE( sampler.address_w ),
+													 sampler.mip_lod_bias, sampler.max_anisotropy, D3D12_COMPARISON_FUNC( sampler.comparison_func ),
+													 D3D12_STATIC_BORDER_COLOR( sampler.border_color ), sampler.min_lod, sampler.max_lod,
+													 sampler.shader_register, sampler.register_space, D3D12_SHADER_VISIBILITY( sampler.visibility ) };
+			static_samplers.push_back( copy );
+		}
+
+		desc.Init_1_1( UINT( count ), parameters.empty( ) ? nullptr : parameters.data( ),
+					   UINT( static_samplers.size( ) ), static_samplers.empty( ) ? nullptr : static_samplers.data( ),
+					   D3D12_ROOT_SIGNATURE_FLAGS( description.flags ) );
+		return desc;
+	}
+
+	RootSignatureCache::RootSignatureCache( )
+		: device( nullptr ), version( D3D_ROOT_SIGNATURE_VERSION_1_0 )
+	{ }
+
+	bool RootSignatureCache::Init( ID3D12Device* device, const wchar_t* blob_cache_path )
+	{
+		this->device = device;
+		this->blob_cache_path = blob_cache_path ? blob_cache_path : L"";
+
+		// 1.1 is only available starting with the anniversary update runtime
+		D3D12_FEATURE_DATA_ROOT_SIGNATURE feature_data = { };
+		feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		if ( FAILED( device->CheckFeatureSupport( D3D12_FEATURE_ROOT_SIGNATURE, &feature_data, sizeof( feature_data ) ) ) )
+			feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+		version = feature_data.HighestVersion;
+
+		if ( this->blob_cache_path.empty( ) )
+			return true;
+
+		std::ifstream file( this->blob_cache_path, std::ios::binary );
+		if ( file && !blobs.Load( file ) )
+			OutputDebugStringA( "root signature blob cache is corrupt, rebuilding it\n" );
+
+		return true;
+	}
+
+	ID3D12RootSignature* RootSignatureCache::GetOrCreate( RootSignatureBuilder& builder )
+	{
+		// the hardware limit, everything above has to go to descriptor tables
+		if ( builder.Cost( ) > D3D12_MAX_ROOT_COST )
+		{
+			OutputDebugStringA( "root signature exceeds 64 DWORDs\n" );
+			return nullptr;
+		}
+
+		const UINT64 hash = builder.Hash( );
+		const RootSignatureDescription& description = builder.Description( );
+
+		// a hash match alone could hand out a signature of another layout, and bind everything wrong
+		std::vector<CachedSignature>& cached = signatures[hash];
+		for ( const auto& entry : cached )
+			if ( entry.description == description )
+				return entry.signature;
+
+		ID3D12RootSignature* signature = nullptr;
+
+		// a blob serialized with 1.0 fallback differs from a 1.1 one, don't mix them up
+		const UINT64 blob_key = RootSignatureBlobs::Key( hash, UINT32( version ) );
+
+		const std::vector<char>* blob = blobs.Find( blob_key, description );
+		if ( blob )
+		{
+			HRESULT hr = device->CreateRootSignature( 0, blob->data( ), blob->size( ), IID_PPV_ARGS( &signature ) );
+			if ( FAILED( hr ) )
+			{
+				// stale blob, serialize it again below
+				signature = nullptr;
+				blobs.Erase( blob_key );
+			}
+		}
+
+		if ( !signature )
+		{
+			ID3DBlob* serialized = nullptr;
+			ID3DBlob* error_buff = nullptr;
+			HRESULT hr = D3DX12SerializeVersionedRootSignature( &builder.Desc( ), version, &serialized, &error_buff );
+			if ( FAILED( hr ) )
+			{
+				if ( error_buff )
+				{
+					OutputDebugStringA( (char*) error_buff->GetBufferPointer( ) );
+					error_buff->Release( );
+				}
+				return nullptr;
+			}
+
+			hr = device->CreateRootSignature( 0, serialized->GetBufferPointer( ), serialized->GetBufferSize( ), IID_PPV_ARGS( &signature ) );
+			if ( SUCCEEDED( hr ) )
+				blobs.Store( blob_key, description, serialized->GetBufferPointer( ), serialized->GetBufferSize( ) );
+			serialized->Release( );
+			if ( FAILED( hr ) )
+				return nullptr;
+		}
+
+		const CachedSignature entry = { description, signature };
+		cached.push_back( entry );
+		return signature;
+	}
+
+	bool RootSignatureCache::SaveBlobs( )
+	{
+		if ( !blobs.Dirty( ) || blob_cache_path.empty( ) )
+			return true;
+
+		std::ofstream file( blob_cache_path, std::ios::binary | std::ios::trunc );
+		return file && blobs.Save( file );
+	}
+
+	void RootSignatureCache::Release( )
+	{
+		for ( auto& cached : signatures )
+			for ( auto& entry : cached.second )
+				entry.signature->Release( );
+		signatures.clear( );
+	}
+}
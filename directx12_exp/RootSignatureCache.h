@@ -0,0 +1,106 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "d3dx12.h"
+#include "RootSignatureDescription.h"
+
+namespace DXLayer
+{
+	// collects root signature 1.1 parameters into a RootSignatureDescription. The d3d desc returned by Desc( )
+	// points into the builder, so it is only valid while the builder is alive and until the next Add*
+	class RootSignatureBuilder
+	{
+	public:
+		explicit RootSignatureBuilder( D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_NONE );
+
+		// every Add* returns the root parameter index to use with SetGraphicsRoot*
+
+		UINT AddConstants( UINT num_32bit_values, UINT shader_register, UINT register_space = 0,
+						   D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL );
+
+		// DATA_STATIC tells the driver the data won't change after the descriptor is recorded,
+		// which allows it to prefetch constants. Pass DATA_VOLATILE for buffers written by the gpu during the frame
+		UINT AddCBV( UINT shader_register, UINT register_space = 0,
+					 D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+					 D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL );
+		UINT AddSRV( UINT shader_register, UINT register_space = 0,
+					 D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+					 D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL );
+		UINT AddUAV( UINT shader_register, UINT register_space = 0,
+					 D3D12_ROOT_DESCRIPTOR_FLAGS flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+					 D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL );
+
+		// ranges are copied. Use D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE on ranges whose descriptors
+		// may be rewritten after the table is bound, DATA_STATIC on ranges pointing to immutable resources
+		UINT AddTable( const D3D12_DESCRIPTOR_RANGE1* ranges, UINT num_ranges,
+					   D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL );
+
+		void AddStaticSampler( const D3D12_STATIC_SAMPLER_DESC& sampler );
+
+		// a parameter described up front, see PerDrawParameter::RootParameter
+		UINT Add( const RootParameterDescription& parameter );
+
+		// root signature cost in DWORDs, the hardware limit is 64
+		UINT Cost( ) const { return RootSignatureCost( description ); }
+
+		// hash of the signature contents (not of the pointers), equal signatures give equal hashes
+		UINT64 Hash( ) const { return HashRootSignature( description ); }
+
+		const RootSignatureDescription& Description( ) const { return description; }
+
+		const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& Desc( );
+
+	private:
+		UINT AddParameter( RootParameterType type, UINT shader_register, UINT register_space, UINT num_32bit_values, UINT flags,
+						   D3D12_SHADER_VISIBILITY visibility );
+
+		RootSignatureDescription description;
+
+		// what Desc( ) builds from the description
+		std::vector<CD3DX12_ROOT_PARAMETER1> parameters;
+		std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> ranges; // per parameter, empty for non-table parameters
+		std::vector<D3D12_STATIC_SAMPLER_DESC> static_samplers;
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+	};
+
+	// owns all root signatures of the app. Identical signatures are created once, found by hash and confirmed by
+	// comparing descriptions, serialized blobs are persisted to disk so the next startup skips serialization
+	class RootSignatureCache
+	{
+	public:
+		RootSignatureCache( );
+
+		// queries the highest root signature version the runtime supports and loads previously saved blobs.
+		// a missing, stale or corrupt blob file is not an error, it is rebuilt
+		bool Init( ID3D12Device* device, const wchar_t* blob_cache_path );
+
+		// returns a signature owned by the cache (not AddRef'ed), nullptr on failure
+		ID3D12RootSignature* GetOrCreate( RootSignatureBuilder& builder );
+
+		// writes blobs to the file passed to Init, does nothing if no new blobs were serialized
+		bool SaveBlobs( );
+
+		void Release( );
+
+		D3D_ROOT_SIGNATURE_VERSION Version( ) const { return version; }
+
+	private:
+		ID3D12Device* device;
+		D3D_ROOT_SIGNATURE_VERSION version;
+		std::wstring blob_cache_path;
+
+		struct CachedSignature
+		{
+			RootSignatureDescription description;
+			ID3D12RootSignature* signature;
+		};
+
+		std::unordered_map<UINT64, std::vector<CachedSignature>> signatures;	// by signature hash, more than one when hashes collide
+		RootSignatureBlobs blobs;
+	};
+}
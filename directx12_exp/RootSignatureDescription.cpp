@@ -0,0 +1,238 @@
+#include "RootSignatureDescription.h"
+
+#include <cstring>
+
+#include "Hash.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const uint32_t blob_file_magic = 0x43425352; // "RSBC"
+		const uint32_t blob_file_version = 3;
+
+		// key, description size and blob size in front of every blob
+		const uint64_t blob_header_size = sizeof( uint64_t ) + 2 * sizeof( uint32_t );
+
+		// flags and the parameter and sampler counts of an empty signature
+		const uint32_t min_description_size = 3 * sizeof( uint32_t );
+
+		void Append( std::vector<char>& out, const void* data, size_t size )
+		{
+			const char* bytes = static_cast<const char*>( data );
+			out.insert( out.end( ), bytes, bytes + size );
+		}
+
+		void Append( std::vector<char>& out, uint32_t value )
+		{
+			Append( out, &value, sizeof( value ) );
+		}
+
+		uint64_t HashParameter( const RootParameterDescription& parameter, uint64_t hash )
+		{
+			hash = Fnv1a64( uint32_t( parameter.type ), hash );
+			hash = Fnv1a64( parameter.visibility, hash );
+			hash = Fnv1a64( parameter.shader_register, hash );
+			hash = Fnv1a64( parameter.register_space, hash );
+			hash = Fnv1a64( parameter.num_32bit_values, hash );
+			hash = Fnv1a64( parameter.flags, hash );
+
+			// ranges are 4-byte fields only, no padding to worry about
+			hash = Fnv1a64( uint32_t( parameter.ranges.size( ) ), hash );
+			if ( !parameter.ranges.empty( ) )
+				hash = Fnv1a64( parameter.ranges.data( ), parameter.ranges.size( ) * sizeof( RootDescriptorRange ), hash );
+			return hash;
+		}
+	}
+
+	uint32_t RootSignatureCost( const RootSignatureDescription& description )
+	{
+		uint32_t cost = 0;
+		for ( const auto& parameter : description.parameters )
+		{
+			switch ( parameter.type )
+			{
+			case root_parameter_constants:
+				cost += parameter.num_32bit_values;
+				break;
+			case root_parameter_table:
+				cost += 1;
+				break;
+			default: // root descriptors are 64-bit gpu addresses
+				cost += 2;
+				break;
+			}
+		}
+		return cost;
+	}
+
+	uint64_t HashRootSignature( const RootSignatureDescription& description )
+	{
+		uint64_t hash = Fnv1a64( description.flags, fnv_offset_basis );
+
+		hash = Fnv1a64( uint32_t( description.parameters.size( ) ), hash );
+		for ( const auto& parameter : description.parameters )
+			hash = HashParameter( parameter, hash );
+
+		hash = Fnv1a64( uint32_t( description.static_samplers.size( ) ), hash );
+		if ( !description.static_samplers.empty( ) )
+			hash = Fnv1a64( description.static_samplers.data( ), description.static_samplers.size( ) * sizeof( RootStaticSampler ), hash );
+
+		return hash;
+	}
+
+	std::vector<char> SerializeRootSignatureDescription( const RootSignatureDescription& description )
+	{
+		std::vector<char> out;
+		Append( out, description.flags );
+		Append( out, uint32_t( description.parameters.size( ) ) );
+		for ( const auto& parameter : description.parameters )
+		{
+			Append( out, uint32_t( parameter.type ) );
+			Append( out, parameter.visibility );
+			Append( out, parameter.shader_register );
+			Append( out, parameter.register_space );
+			Append( out, parameter.num_32bit_values );
+			Append( out, parameter.flags );
+			Append( out, uint32_t( parameter.ranges.size( ) ) );
+			if ( !parameter.ranges.empty( ) )
+				Append( out, parameter.ranges.data( ), parameter.ranges.size( ) * sizeof( RootDescriptorRange ) );
+		}
+
+		// 4-byte fields only, like the ranges
+		Append( out, uint32_t( description.static_samplers.size( ) ) );
+		if ( !description.static_samplers.empty( ) )
+			Append( out, description.static_samplers.data( ), description.static_samplers.size( ) * sizeof( RootStaticSampler ) );
+		return out;
+	}
+
+	bool operator==( const RootSignatureDescription& a, const RootSignatureDescription& b )
+	{
+		if ( a.flags != b.flags || a.parameters.size( ) != b.parameters.size( ) || a.static_samplers.size( ) != b.static_samplers.size( ) )
+			return false;
+		for ( size_t i = 0; i < a.parameters.size( ); ++i )
+		{
+			const RootParameterDescription& pa = a.parameters[i];
+			const RootParameterDescription& pb = b.parameters[i];
+			if ( pa.type != pb.type || pa.visibility != pb.visibility || pa.shader_register != pb.shader_register ||
+				pa.register_space != pb.register_space || pa.num_32bit_values != pb.num_32bit_values || pa.flags != pb.flags ||
+				pa.ranges.size( ) != pb.ranges.size( ) )
+				return false;
+			if ( !pa.ranges.empty( ) && std::memcmp( pa.ranges.data( ), pb.ranges.data( ), pa.ranges.size( ) * sizeof( RootDescriptorRange ) ) != 0 )
+				return false;
+		}
+
+		// bitwise like the hash, so the floats of a sampler compare the way they hash
+		return a.static_samplers.empty( ) ||
+			std::memcmp( a.static_samplers.data( ), b.static_samplers.data( ), a.static_samplers.size( ) * sizeof( RootStaticSampler ) ) == 0;
+	}
+
+	bool operator!=( const RootSignatureDescription& a, const RootSignatureDescription& b )
+	{
+		return !( a == b );
+	}
+
+	RootSignatureBlobs::RootSignatureBlobs( )
+		: dirty( false )
+	{ }
+
+	uint64_t RootSignatureBlobs::Key( uint64_t signature_hash, uint32_t version )
+	{
+		return HashCombine( signature_hash, version );
+	}
+
+	const std::vector<char>* RootSignatureBlobs::Find( uint64_t key, const RootSignatureDescription& description ) const
+	{
+		auto it = blobs.find( key );
+		if ( it == blobs.end( ) || it->second.description != SerializeRootSignatureDescription( description ) )
+			return nullptr;
+		return &it->second.blob;
+	}
+
+	void RootSignatureBlobs::Store( uint64_t key, const RootSignatureDescription& description, const void* data, size_t size )
+	{
+		const char* bytes = static_cast<const char*>( data );
+		Entry& entry = blobs[key];
+		entry.description = SerializeRootSignatureDescription( description );
+		entry.blob.assign( bytes, bytes + size );
+		dirty = true;
+	}
+
+	void RootSignatureBlobs::Erase( uint64_t key )
+	{
+		if ( blobs.erase( key ) )
+			dirty = true;
+	}
+
+	bool RootSignatureBlobs::Load( std::istream& stream )
+	{
+		blobs.clear( );
+		dirty = true;
+
+		const std::streamoff begin = stream.tellg( );
+		stream.seekg( 0, std::ios::end );
+		const std::streamoff end = stream.tellg( );
+		stream.seekg( begin );
+		if ( begin < 0 || end < begin || !stream )
+			return false;
+		uint64_t left = uint64_t( end - begin );
+
+		uint32_t header[3] = { }; // magic, version, blob count
+		if ( left < sizeof( header ) || !stream.read( reinterpret_cast<char*>( header ), sizeof( header ) ) ||
+			header[0] != blob_file_magic || header[1] != blob_file_version )
+			return false;
+		left -= sizeof( header );
+
+		for ( uint32_t i = 0; i < header[2]; ++i )
+		{
+			uint64_t key = 0;
+			uint32_t sizes[2] = { }; // description, blob
+			if ( left < blob_header_size || !stream.read( reinterpret_cast<char*>( &key ), sizeof( key ) ) ||
+				!stream.read( reinterpret_cast<char*>( sizes ), sizeof( sizes ) ) )
+				break;
+			left -= blob_header_size;
+
+			// checked before allocating, a corrupt size would otherwise ask for up to 8 GB
+			if ( sizes[0] < min_description_size || !sizes[1] || sizes[0] > left || sizes[1] > left - sizes[0] )
+				break;
+
+			Entry& entry = blobs[key];
+			entry.description.resize( sizes[0] );
+			entry.blob.resize( sizes[1] );
+			if ( !stream.read( entry.description.data( ), sizes[0] ) || !stream.read( entry.blob.data( ), sizes[1] ) )
+				break;
+			left -= uint64_t( sizes[0] ) + sizes[1];
+		}
+
+		// anything but exactly header[2] blobs filling the file means it can't be trusted
+		if ( blobs.size( ) != header[2] || left )
+		{
+			blobs.clear( );
+			return false;
+		}
+
+		dirty = false;
+		return true;
+	}
+
+	bool RootSignatureBlobs::Save( std::ostream& stream )
+	{
+		const uint32_t header[3] = { blob_file_magic, blob_file_version, uint32_t( blobs.size( ) ) };
+		stream.write( reinterpret_cast<const char*>( header ), sizeof( header ) );
+		for ( const auto& blob : blobs )
+		{
+			const Entry& entry = blob.second;
+			const uint32_t sizes[2] = { uint32_t( entry.description.size( ) ), uint32_t( entry.blob.size( ) ) };
+			stream.write( reinterpret_cast<const char*>( &blob.first ), sizeof( blob.first ) );
+			stream.write( reinterpret_cast<const char*>( sizes ), sizeof( sizes ) );
+			stream.write( entry.description.data( ), sizes[0] );
+			stream.write( entry.blob.data( ), sizes[1] );
+		}
+
+		if ( !stream )
+			return false;
+
+		dirty = false;
+		return true;
+	}
+}
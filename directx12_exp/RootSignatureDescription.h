@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// what a root signature is made of, in the values of the d3d enums and structs, and the file its serialized blobs
+// are kept in between runs. Equal descriptions hash equal however they were put together, fields a parameter type
+// doesn't use stay 0. No d3d in here, RootSignatureBuilder fills a description and RootSignatureCache creates the
+// signatures
+
+namespace DXLayer
+{
+	// the values of D3D12_ROOT_PARAMETER_TYPE
+	enum RootParameterType : uint32_t
+	{
+		root_parameter_table = 0,
+		root_parameter_constants = 1,
+		root_parameter_cbv = 2,
+		root_parameter_srv = 3,
+		root_parameter_uav = 4
+	};
+
+	// the values of D3D12_ROOT_DESCRIPTOR_FLAGS
+	enum RootDescriptorFlags : uint32_t
+	{
+		root_descriptor_none = 0,
+		root_descriptor_data_volatile = 2,
+		root_descriptor_data_static_while_set_at_execute = 4,
+		root_descriptor_data_static = 8
+	};
+
+	// D3D12_DESCRIPTOR_RANGE1
+	struct RootDescriptorRange
+	{
+		uint32_t range_type;
+		uint32_t num_descriptors;
+		uint32_t base_shader_register;
+		uint32_t register_space;
+		uint32_t flags;
+		uint32_t offset_in_descriptors_from_table_start;
+	};
+
+	// D3D12_ROOT_PARAMETER1. num_32bit_values for constants, flags for root descriptors, ranges for tables
+	struct RootParameterDescription
+	{
+		RootParameterType type;
+		uint32_t visibility;
+		uint32_t shader_register;
+		uint32_t register_space;
+		uint32_t num_32bit_values;
+		uint32_t flags;
+		std::vector<RootDescriptorRange> ranges;
+	};
+
+	// D3D12_STATIC_SAMPLER_DESC, field for field
+	struct RootStaticSampler
+	{
+		uint32_t filter;
+		uint32_t address_u;
+		uint32_t address_v;
+		uint32_t address_w;
+		float mip_lod_bias;
+		uint32_t max_anisotropy;
+		uint32_t comparison_func;
+		uint32_t border_color;
+		float min_lod;
+		float max_lod;
+		uint32_t shader_register;
+		uint32_t register_space;
+		uint32_t visibility;
+	};
+
+	struct RootSignatureDescription
+	{
+		uint32_t flags;
+		std::vector<RootParameterDescription> parameters;
+		std::vector<RootStaticSampler> static_samplers;
+	};
+
+	// cost in DWORDs, the hardware limit is 64
+	uint32_t RootSignatureCost( const RootSignatureDescription& description );
+
+	// of the contents, equal signatures give equal hashes
+	uint64_t HashRootSignature( const RootSignatureDescription& description );
+
+	// field for field, what a hash match has to be confirmed with before a cached signature is handed out
+	bool operator==( const RootSignatureDescription& a, const RootSignatureDescription& b );
+	bool operator!=( const RootSignatureDescription& a, const RootSignatureDescription& b );
+
+	// every field in order, equal descriptions give equal bytes. Kept next to each blob in the file
+	std::vector<char> SerializeRootSignatureDescription( const RootSignatureDescription& description );
+
+	// serialized root signatures by key, and the file they are saved to. Each blob keeps the description it was
+	// serialized from, so a key two descriptions hash to never hands one of them the other's blob
+	class RootSignatureBlobs
+	{
+	public:
+		RootSignatureBlobs( );
+
+		// a blob serialized as 1.0 differs from a 1.1 one of the same signature, the key keeps them apart
+		static uint64_t Key( uint64_t signature_hash, uint32_t version );
+
+		// nullptr when there is none, or the one there was serialized from a different description
+		const std::vector<char>* Find( uint64_t key, const RootSignatureDescription& description ) const;
+
+		// replaces the blob of key, if any
+		void Store( uint64_t key, const RootSignatureDescription& description, const void* data, size_t size );
+		void Erase( uint64_t key );
+
+		size_t Count( ) const { return blobs.size( ); }
+
+		// true when blobs changed since the last Load or Save
+		bool Dirty( ) const { return dirty; }
+
+		// replaces the blobs with the ones in the stream. A stream that isn't a blob file, is truncated or has sizes
+		// running past its end leaves no blobs at all and returns false, every signature is serialized again and
+		// the next Save rewrites the file
+		bool Load( std::istream& stream );
+
+		bool Save( std::ostream& stream );
+
+	private:
+		struct Entry
+		{
+			std::vector<char> description;	// SerializeRootSignatureDescription
+			std::vector<char> blob;
+		};
+
+		std::unordered_map<uint64_t, Entry> blobs;
+		bool dirty;
+	};
+}
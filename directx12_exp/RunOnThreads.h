@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace DXLayer
+{
+	// runs work( thread ) on thread_count threads, the calling thread is thread 0. The threads are started for
+	// the call, so the work should be worth a few hundred microseconds or more
+	template <typename Work>
+	void RunOnThreads( uint32_t thread_count, Work work )
+	{
+		std::vector<std::thread> threads;
+		for ( uint32_t t = 1; t < thread_count; ++t )
+			threads.emplace_back( [&work, t] ( ) { work( t ); } );
+		work( 0 );
+		for ( auto& thread : threads )
+			thread.join( );
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ConstantBufferLayout.h"
+
+// the cbuffers of the shaders, each declared once here and matched to its hlsl by check-cbuffer-layouts
+
+namespace DXLayer
+{
+	// must match cbuffer PerDraw in vertex.hlsl. The uints fill the gaps after the float3s, 12 DWORDs in total
+	struct PerDrawLayout : CBufferLayout<hlsl::float3, hlsl::uint, hlsl::float3, hlsl::uint, hlsl::float4>
+	{
+		enum { bounds_center, object_index, bounds_extent, material_index, tint };
+	};
+}
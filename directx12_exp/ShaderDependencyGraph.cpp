@@ -0,0 +1,72 @@
+#include "ShaderDependencyGraph.h"
+
+namespace DXLayer
+{
+	ShaderDependencyGraph::ShaderDependencyGraph( ScanIncludesFn scan_includes )
+		: scan_includes( scan_includes )
+	{ }
+
+	void ShaderDependencyGraph::AddShader( uint32_t shader_id, const std::wstring& root_path )
+	{
+		shader_roots[shader_id] = root_path;
+		Scan( root_path, false );
+	}
+
+	void ShaderDependencyGraph::Scan( const std::wstring& path, bool force )
+	{
+		if ( !force && includes.count( path ) )
+			return;
+
+		// insert before recursing, include cycles would recurse forever otherwise
+		std::vector<std::wstring>& file_includes = includes[path];
+		file_includes = scan_includes( path );
+
+		const std::vector<std::wstring> children = file_includes;
+		for ( const auto& child : children )
+			Scan( child, false );
+	}
+
+	bool ShaderDependencyGraph::DependsOn( const std::wstring& path, const std::set<std::wstring>& changed, std::set<std::wstring>& visited ) const
+	{
+		if ( changed.count( path ) )
+			return true;
+
+		if ( !visited.insert( path ).second )
+			return false;
+
+		auto it = includes.find( path );
+		if ( it == includes.end( ) )
+			return false;
+
+		for ( const auto& child : it->second )
+			if ( DependsOn( child, changed, visited ) )
+				return true;
+
+		return false;
+	}
+
+	std::vector<uint32_t> ShaderDependencyGraph::Invalidate( const std::vector<std::wstring>& changed_files )
+	{
+		for ( const auto& file : changed_files )
+			Scan( file, true );
+
+		const std::set<std::wstring> changed( changed_files.begin( ), changed_files.end( ) );
+
+		std::vector<uint32_t> affected;
+		for ( const auto& shader : shader_roots )
+		{
+			std::set<std::wstring> visited;
+			if ( DependsOn( shader.second, changed, visited ) )
+				affected.push_back( shader.first );
+		}
+		return affected;
+	}
+
+	std::vector<std::wstring> ShaderDependencyGraph::Files( ) const
+	{
+		std::vector<std::wstring> files;
+		for ( const auto& file : includes )
+			files.push_back( file.first );
+		return files;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace DXLayer
+{
+	// include graph of shader source files, knows which shaders have to be recompiled when a file changes.
+	// File access goes through scan_includes, so the graph itself doesn't touch the file system
+	class ShaderDependencyGraph
+	{
+	public:
+		// returns resolved paths of the files directly included by the given file
+		typedef std::function<std::vector<std::wstring>( const std::wstring& path )> ScanIncludesFn;
+
+		explicit ShaderDependencyGraph( ScanIncludesFn scan_includes );
+
+		void AddShader( uint32_t shader_id, const std::wstring& root_path );
+
+		// rescans includes of the changed files (they may have gained or lost includes)
+		// and returns ids of all shaders that depend on any of them, each once
+		std::vector<uint32_t> Invalidate( const std::vector<std::wstring>& changed_files );
+
+		std::vector<std::wstring> Files( ) const;
+
+	private:
+		void Scan( const std::wstring& path, bool force );
+		bool DependsOn( const std::wstring& path, const std::set<std::wstring>& changed, std::set<std::wstring>& visited ) const;
+
+		ScanIncludesFn scan_includes;
+		std::map<std::wstring, std::vector<std::wstring>> includes; // file -> directly included files
+		std::map<uint32_t, std::wstring> shader_roots;
+	};
+}
@@ -0,0 +1,251 @@
+#include "ShaderWatcher.h"
+
+#ifdef _WIN32
+#include <D3Dcompiler.h>
+
+#include <fstream>
+#endif
+
+#include <algorithm>
+#include <chrono>
+
+namespace DXLayer
+{
+	ShaderWatcher::ShaderWatcher( CompileFn compile, WriteTimeFn write_time, ShaderDependencyGraph::ScanIncludesFn scan_includes )
+		: compile( compile ), write_time( write_time ), graph( scan_includes ), stop_requested( false )
+	{ }
+
+	ShaderWatcher::~ShaderWatcher( )
+	{
+		Stop( );
+	}
+
+	uint32_t ShaderWatcher::Add( const std::wstring& path, const std::string& entry_point, const std::string& target )
+	{
+		Shader shader;
+		shader.path = path;
+		shader.entry_point = entry_point;
+		shader.target = target;
+		if ( !compile( path, entry_point, target, shader.bytecode ) )
+			return invalid_shader;
+
+		std::lock_guard<std::mutex> lock( mutex );
+
+		const uint32_t shader_id = uint32_t( shaders.size( ) );
+		shaders.push_back( std::move( shader ) );
+		graph.AddShader( shader_id, path );
+
+		// remember current write times, so the shader isn't recompiled on the first poll
+		for ( const auto& file : graph.Files( ) )
+			if ( !write_times.count( file ) )
+				write_times[file] = write_time( file );
+
+		return shader_id;
+	}
+
+	const std::vector<char>& ShaderWatcher::Code( uint32_t shader_id ) const
+	{
+		static const std::vector<char> none;
+		return shader_id < shaders.size( ) ? shaders[shader_id].bytecode : none;
+	}
+
+	void ShaderWatcher::Start( uint32_t poll_interval_ms )
+	{
+		if ( thread.joinable( ) )
+			return;
+
+		stop_requested = false;
+		thread = std::thread( [this, poll_interval_ms] ( )
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			while ( !stop_condition.wait_for( lock, std::chrono::milliseconds( poll_interval_ms ), [this] ( ) { return stop_requested; } ) )
+			{
+				lock.unlock( );
+				Poll( );
+				lock.lock( );
+			}
+		} );
+	}
+
+	void ShaderWatcher::Stop( )
+	{
+		if ( !thread.joinable( ) )
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			stop_requested = true;
+		}
+		stop_condition.notify_all( );
+		thread.join( );
+	}
+
+	void ShaderWatcher::Poll( )
+	{
+		std::vector<uint32_t> affected;
+		std::vector<Shader> to_compile;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+
+			std::vector<std::wstring> changed;
+			for ( auto& file : write_times )
+			{
+				const uint64_t time = write_time( file.first );
+				if ( time != file.second )
+				{
+					file.second = time;
+					changed.push_back( file.first );
+				}
+			}
+
+			if ( changed.empty( ) && failed.empty( ) )
+				return;
+
+			if ( !changed.empty( ) )
+			{
+				affected = graph.Invalidate( changed );
+
+				// newly included files have to be watched too
+				for ( const auto& file : graph.Files( ) )
+					if ( !write_times.count( file ) )
+						write_times[file] = write_time( file );
+			}
+
+			// shaders that didn't compile last time are tried again, the error may have been the editor still
+			// writing the file or holding it locked
+			affected.insert( affected.end( ), failed.begin( ), failed.end( ) );
+			failed.clear( );
+			std::sort( affected.begin( ), affected.end( ) );
+			affected.erase( std::unique( affected.begin( ), affected.end( ) ), affected.end( ) );
+
+			for ( uint32_t shader_id : affected )
+			{
+				Shader shader;
+				shader.path = shaders[shader_id].path;
+				shader.entry_point = shaders[shader_id].entry_point;
+				shader.target = shaders[shader_id].target;
+				to_compile.push_back( std::move( shader ) );
+			}
+		}
+
+		// compile without holding the lock, this can take a while
+		for ( size_t i = 0; i < affected.size( ); ++i )
+		{
+			Shader& shader = to_compile[i];
+			const bool compiled = compile( shader.path, shader.entry_point, shader.target, shader.bytecode );
+
+			std::lock_guard<std::mutex> lock( mutex );
+			if ( compiled )
+				pending[affected[i]] = std::move( shader.bytecode );
+			else
+				failed.push_back( affected[i] ); // keep the old bytecode, the error is already reported by the compiler
+		}
+	}
+
+	std::vector<uint32_t> ShaderWatcher::ApplyUpdates( LinkFn link )
+	{
+		std::map<uint32_t, std::vector<char>> updates;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			updates.swap( pending );
+		}
+
+		// the new code goes in and the old one waits in updates until link is happy with the new one
+		std::vector<uint32_t> staged;
+		for ( auto& update : updates )
+		{
+			shaders[update.first].bytecode.swap( update.second );
+			staged.push_back( update.first );
+		}
+
+		// every round puts at least one shader back, so this ends with nothing failing or nothing staged
+		while ( !staged.empty( ) )
+		{
+			const std::vector<uint32_t> failed = link( staged );
+			bool restored = false;
+			for ( uint32_t shader_id : failed )
+			{
+				auto it = std::find( staged.begin( ), staged.end( ), shader_id );
+				if ( it == staged.end( ) )
+					continue;
+				shaders[shader_id].bytecode.swap( updates[shader_id] );
+				staged.erase( it );
+				restored = true;
+			}
+			if ( !restored )
+				break;
+		}
+		return staged;
+	}
+
+#ifdef _WIN32
+	bool CompileShaderFromFile( const std::wstring& path, const std::string& entry_point, const std::string& target, std::vector<char>& bytecode )
+	{
+		ID3DBlob* shader = nullptr;
+		ID3DBlob* error_buff = nullptr;
+		HRESULT hr = D3DCompileFromFile( path.c_str( ),
+			nullptr,
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, // resolves includes relative to the including file, same as ScanShaderIncludes
+			entry_point.c_str( ),
+			target.c_str( ),
+			D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
+			0,
+			&shader,
+			&error_buff );
+
+		if ( error_buff )
+		{
+			OutputDebugStringA( (char*) error_buff->GetBufferPointer( ) );
+			error_buff->Release( );
+		}
+
+		if ( FAILED( hr ) )
+			return false;
+
+		const char* data = static_cast<const char*>( shader->GetBufferPointer( ) );
+		bytecode.assign( data, data + shader->GetBufferSize( ) );
+		shader->Release( );
+		return true;
+	}
+
+	UINT64 GetFileWriteTime( const std::wstring& path )
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if ( !GetFileAttributesExW( path.c_str( ), GetFileExInfoStandard, &attributes ) )
+			return 0;
+
+		return ( UINT64( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) | attributes.ftLastWriteTime.dwLowDateTime;
+	}
+
+	std::vector<std::wstring> ScanShaderIncludes( const std::wstring& path )
+	{
+		std::vector<std::wstring> result;
+
+		std::ifstream file( path );
+		if ( !file )
+			return result;
+
+		const size_t dir_end = path.find_last_of( L"/\\" );
+		const std::wstring dir = dir_end == std::wstring::npos ? std::wstring( ) : path.substr( 0, dir_end + 1 );
+
+		// doesn't care about comments or #if blocks, a spurious dependency only costs an extra recompile
+		std::string line;
+		while ( std::getline( file, line ) )
+		{
+			const size_t directive = line.find( "#include" );
+			if ( directive == std::string::npos )
+				continue;
+
+			const size_t name_begin = line.find( '"', directive );
+			const size_t name_end = name_begin == std::string::npos ? std::string::npos : line.find( '"', name_begin + 1 );
+			if ( name_end == std::string::npos )
+				continue; // system includes are not watched
+
+			const std::string name = line.substr( name_begin + 1, name_end - name_begin - 1 );
+			result.push_back( dir + std::wstring( name.begin( ), name.end( ) ) );
+		}
+
+		return result;
+	}
+#endif
+}
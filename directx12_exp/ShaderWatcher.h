@@ -0,0 +1,100 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#include <d3d12.h>
+#endif
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderDependencyGraph.h"
+
+namespace DXLayer
+{
+	// compiles shader files and keeps them up to date while the app runs. A background thread polls
+	// write times of every file in the include graph and recompiles only the affected shaders.
+	// Results are handed over to the render thread in ApplyUpdates, so bytecode never changes mid-frame.
+	// Only the default file and compiler functions below need windows, the watcher runs anywhere
+	class ShaderWatcher
+	{
+	public:
+		typedef std::function<bool( const std::wstring& path, const std::string& entry_point, const std::string& target, std::vector<char>& bytecode )> CompileFn;
+		typedef std::function<uint64_t( const std::wstring& path )> WriteTimeFn; // 0 for missing files
+
+		// builds whatever uses the staged shaders and returns the ids of those it failed with, empty when everything linked
+		typedef std::function<std::vector<uint32_t>( const std::vector<uint32_t>& staged )> LinkFn;
+
+		static const uint32_t invalid_shader = uint32_t( -1 );
+
+		ShaderWatcher( CompileFn compile, WriteTimeFn write_time, ShaderDependencyGraph::ScanIncludesFn scan_includes );
+		~ShaderWatcher( );
+
+		// compiles the shader right away, returns invalid_shader on failure
+		uint32_t Add( const std::wstring& path, const std::string& entry_point, const std::string& target );
+
+		// render thread only. Valid until the next ApplyUpdates, empty for unknown ids
+		const std::vector<char>& Code( uint32_t shader_id ) const;
+
+#ifdef _WIN32
+		D3D12_SHADER_BYTECODE Bytecode( UINT shader_id ) const
+		{
+			const std::vector<char>& code = Code( shader_id );
+			const D3D12_SHADER_BYTECODE bytecode = { code.data( ), code.size( ) };
+			return bytecode;
+		}
+#endif
+
+		void Start( uint32_t poll_interval_ms );
+		void Stop( );
+
+		// render thread, at a frame boundary. Swaps in the shaders recompiled since the last call and hands their ids to
+		// link, Code( ) returns the new code while it runs. Shaders link fails with go back to their old code and link
+		// is called again with the rest, until nothing fails. Returns the ids of the shaders that were kept
+		std::vector<uint32_t> ApplyUpdates( LinkFn link );
+
+		// checks files once on the calling thread, Start does this periodically
+		void Poll( );
+
+	private:
+		struct Shader
+		{
+			std::wstring path;
+			std::string entry_point;
+			std::string target;
+			std::vector<char> bytecode;
+		};
+
+		CompileFn compile;
+		WriteTimeFn write_time;
+
+		std::vector<Shader> shaders;						// bytecode is only touched by the render thread
+
+		std::mutex mutex;									// guards everything below
+		ShaderDependencyGraph graph;
+		std::map<std::wstring, uint64_t> write_times;
+		std::map<uint32_t, std::vector<char>> pending;		// recompiled, not yet applied
+		std::vector<uint32_t> failed;						// didn't compile, tried again on every poll until they do
+
+		std::thread thread;
+		std::condition_variable stop_condition;
+		bool stop_requested;
+	};
+
+#ifdef _WIN32
+	// default implementations on top of d3dcompiler and win32 file apis
+
+	bool CompileShaderFromFile( const std::wstring& path, const std::string& entry_point, const std::string& target, std::vector<char>& bytecode );
+
+	UINT64 GetFileWriteTime( const std::wstring& path );
+
+	// finds #include "file" directives, paths are resolved relative to the including file
+	std::vector<std::wstring> ScanShaderIncludes( const std::wstring& path );
+#endif
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// sse2 is part of the x64 baseline and the msvc default for x86, other targets use the scalar paths
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#define DXL_SSE2 1
+#include <emmintrin.h>
+#else
+#define DXL_SSE2 0
+#endif
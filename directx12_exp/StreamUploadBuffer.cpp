@@ -0,0 +1,47 @@
+#include "StreamUploadBuffer.h"
+
+#include "d3dx12.h"
+
+namespace DXLayer
+{
+	StreamUploadBuffer::StreamUploadBuffer( )
+		: buffer( nullptr )
+	{ }
+
+	bool StreamUploadBuffer::Init( ID3D12Device* device, UINT64 size, const wchar_t* name )
+	{
+		HRESULT hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer( size ),
+			D3D12_RESOURCE_STATE_GENERIC_READ, // the only allowed state for upload heaps
+			nullptr,
+			IID_PPV_ARGS( &buffer ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		if ( name )
+			buffer->SetName( name );
+
+		// we never read from this memory on the cpu
+		BYTE* mapped_data;
+		CD3DX12_RANGE read_range( 0, 0 );
+		hr = buffer->Map( 0, &read_range, reinterpret_cast<void**>( &mapped_data ) );
+		if ( FAILED( hr ) )
+			return false;
+
+		arena.Init( mapped_data, size );
+		return true;
+	}
+
+	void StreamUploadBuffer::Release( )
+	{
+		arena.Close( );
+		if ( buffer )
+		{
+			buffer->Unmap( 0, nullptr );
+			buffer->Release( );
+			buffer = nullptr;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "UploadArena.h"
+
+namespace DXLayer
+{
+	// an UploadArena over a buffer in an upload heap, mapped for its whole lifetime. Decode threads write streamed
+	// meshes into it, copies into the geometry pool read them from Resource( ) at the allocation's offset
+	class StreamUploadBuffer
+	{
+	public:
+		StreamUploadBuffer( );
+
+		bool Init( ID3D12Device* device, UINT64 size, const wchar_t* name );
+
+		UploadArena& Arena( ) { return arena; }
+
+		ID3D12Resource* Resource( ) const { return buffer; }
+
+		// after the threads writing into it have stopped, Arena( ).Close( ) lets the ones waiting for space go
+		void Release( );
+
+	private:
+		UploadArena arena;
+		ID3D12Resource* buffer;
+	};
+}
@@ -0,0 +1,139 @@
+#include "SubresourceCopy.h"
+
+#include <cstring>
+
+#include "RunOnThreads.h"
+#include "Simd.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// narrow rows of small mips and bc blocks are plain copies, too few whole lines to make up for the head and tail
+		const size_t min_stream_size = 256;
+
+		// streaming stores for the whole cache lines, the partial lines at both ends are plain copies. A line that
+		// gets both kinds of store is flushed out half written, much slower than either on its own.
+		// No fence, the caller fences once after all of its blocks
+		void StreamBlock( uint8_t* destination, const uint8_t* source, size_t size )
+		{
+#if DXL_SSE2
+			const size_t head = ( 64 - ( reinterpret_cast<uintptr_t>( destination ) & 63 ) ) & 63;
+			if ( size >= head + 64 )
+			{
+				std::memcpy( destination, source, head );
+				destination += head;
+				source += head;
+				size -= head;
+				for ( ; size >= 64; size -= 64, destination += 64, source += 64 )
+				{
+					const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source ) );
+					const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + 16 ) );
+					const __m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + 32 ) );
+					const __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + 48 ) );
+					_mm_stream_si128( reinterpret_cast<__m128i*>( destination ), a );
+					_mm_stream_si128( reinterpret_cast<__m128i*>( destination + 16 ), b );
+					_mm_stream_si128( reinterpret_cast<__m128i*>( destination + 32 ), c );
+					_mm_stream_si128( reinterpret_cast<__m128i*>( destination + 48 ), d );
+				}
+			}
+#endif
+			if ( size )
+				std::memcpy( destination, source, size );
+		}
+
+		void StoreFence( )
+		{
+#if DXL_SSE2
+			_mm_sfence( );
+#endif
+		}
+	}
+
+	void CopySubresourceRows( const SubresourceDestination& destination, const SubresourceSource& source, size_t row_size, uint32_t row_count, uint32_t slice_count )
+	{
+		for ( uint32_t slice = 0; slice < slice_count; ++slice )
+		{
+			uint8_t* destination_slice = static_cast<uint8_t*>( destination.data ) + destination.slice_pitch * slice;
+			const uint8_t* source_slice = static_cast<const uint8_t*>( source.data ) + source.slice_pitch * slice;
+			for ( uint32_t row = 0; row < row_count; ++row )
+				std::memcpy( destination_slice + destination.row_pitch * row, source_slice + source.row_pitch * row, row_size );
+		}
+	}
+
+	void CopySubresource( const SubresourceDestination& destination, const SubresourceSource& source, size_t row_size, uint32_t row_count, uint32_t slice_count,
+		const SubresourceCopyOptions& options )
+	{
+		if ( !row_size || !row_count || !slice_count )
+			return;
+
+		// the copy as a list of blocks that are contiguous on both sides: rows, whole slices or everything at once.
+		// A single row or slice is contiguous whatever its pitch
+		size_t block_size = row_size;
+		size_t blocks_per_slice = row_count;
+		size_t slices = slice_count;
+		if ( row_count == 1 || ( destination.row_pitch == row_size && source.row_pitch == row_size ) )
+		{
+			block_size *= row_count;
+			blocks_per_slice = 1;
+			if ( slice_count == 1 || ( destination.slice_pitch == block_size && source.slice_pitch == block_size ) )
+			{
+				block_size *= slice_count;
+				slices = 1;
+			}
+		}
+		const size_t block_count = blocks_per_slice * slices;
+		const size_t total_size = block_size * block_count;
+
+		// byte range [first, end) of the packed data, the blocks one after the other
+		auto copy_range = [ & ] ( size_t first, size_t end )
+		{
+			const size_t block = first / block_size;
+			size_t slice = block / blocks_per_slice;
+			size_t row = block % blocks_per_slice;
+			size_t offset = first % block_size;
+			while ( first < end )
+			{
+				uint8_t* out = static_cast<uint8_t*>( destination.data ) + slice * destination.slice_pitch + row * destination.row_pitch + offset;
+				const uint8_t* in = static_cast<const uint8_t*>( source.data ) + slice * source.slice_pitch + row * source.row_pitch + offset;
+				const size_t size = block_size - offset < end - first ? block_size - offset : end - first;
+				if ( options.write_combined && size >= min_stream_size )
+					StreamBlock( out, in, size );
+				else
+					std::memcpy( out, in, size );
+				first += size;
+				offset = 0;
+				if ( ++row == blocks_per_slice )
+				{
+					row = 0;
+					++slice;
+				}
+			}
+			if ( options.write_combined )
+				StoreFence( );
+		};
+
+		// threads get equal shares of the bytes split at multiples of 64, so a contiguous copy into an aligned heap
+		// never has two cores writing the same cache line
+		size_t useful_threads = options.min_bytes_per_thread ? total_size / options.min_bytes_per_thread : options.thread_count;
+		if ( useful_threads > options.thread_count )
+			useful_threads = options.thread_count;
+		if ( useful_threads <= 1 )
+		{
+			copy_range( 0, total_size );
+			return;
+		}
+		RunOnThreads( uint32_t( useful_threads ), [ & ] ( uint32_t thread )
+		{
+			const size_t first = thread ? ( total_size / useful_threads * thread ) & ~size_t( 63 ) : 0;
+			const size_t end = thread + 1 < useful_threads ? ( total_size / useful_threads * ( thread + 1 ) ) & ~size_t( 63 ) : total_size;
+			copy_range( first, end );
+		} );
+	}
+
+	void CopyToWriteCombined( void* destination, const void* source, size_t size )
+	{
+		StreamBlock( static_cast<uint8_t*>( destination ), static_cast<const uint8_t*>( source ), size );
+		StoreFence( );
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// copies a subresource between two pitched layouts, what MemcpySubresource in d3dx12.h does row by row. Rows that
+// are contiguous on both sides collapse into one copy per slice, slices that are contiguous too into one copy of
+// everything. Upload heaps are write-combined: the cpu never reads them back, so going through the cache only
+// costs the reads for the lines it allocates. Copies into them use streaming stores that skip the cache.
+// No d3d in here, the pitches are the ones from D3D12_SUBRESOURCE_DATA and the copyable footprints
+
+namespace DXLayer
+{
+	// where a subresource's rows are, slices are row_pitch * rows or more apart. As in D3D12_MEMCPY_DEST
+	struct SubresourceDestination
+	{
+		void* data;
+		size_t row_pitch;
+		size_t slice_pitch;
+	};
+
+	// as in D3D12_SUBRESOURCE_DATA
+	struct SubresourceSource
+	{
+		const void* data;
+		size_t row_pitch;
+		size_t slice_pitch;
+	};
+
+	struct SubresourceCopyOptions
+	{
+		SubresourceCopyOptions( )
+			: write_combined( true ), thread_count( 1 ), min_bytes_per_thread( 4 << 20 )
+		{ }
+
+		bool write_combined;			// the destination is an upload heap or other memory the cpu doesn't read
+		uint32_t thread_count;			// the calling thread is one of them
+		size_t min_bytes_per_thread;	// smaller copies use fewer threads, thread startup costs about as much as copying a few hundred KB
+	};
+
+	// the copy d3dx12.h does, one memcpy per row
+	void CopySubresourceRows( const SubresourceDestination& destination, const SubresourceSource& source, size_t row_size, uint32_t row_count, uint32_t slice_count );
+
+	// row_size bytes of row_count rows in each of slice_count slices. The layouts must not overlap
+	void CopySubresource( const SubresourceDestination& destination, const SubresourceSource& source, size_t row_size, uint32_t row_count, uint32_t slice_count,
+		const SubresourceCopyOptions& options = SubresourceCopyOptions( ) );
+
+	// one contiguous block into write-combined memory. The stores are flushed before it returns
+	void CopyToWriteCombined( void* destination, const void* source, size_t size );
+}
@@ -0,0 +1,440 @@
+#include "TextureFile.h"
+
+#include <cstring>
+
+namespace DXLayer
+{
+	namespace
+	{
+		const uint32_t dds_header_bytes = 124;
+		const uint32_t dds_fourcc_dx10 = 0x30315844; // "DX10"
+
+		// DDS_HEADER flags and caps
+		const uint32_t dds_flags_texture = 0x1 | 0x2 | 0x4 | 0x1000;	// caps, height, width, pixel format
+		const uint32_t dds_flag_mip_count = 0x20000;
+		const uint32_t dds_flag_depth = 0x800000;
+		const uint32_t dds_caps_texture = 0x1000;
+		const uint32_t dds_caps_complex = 0x8;
+		const uint32_t dds_caps_mipmap = 0x400000;
+		const uint32_t dds_caps2_cube = 0x200;
+		const uint32_t dds_caps2_all_faces = 0xfc00;
+		const uint32_t dds_caps2_volume = 0x200000;
+
+		// DDS_PIXELFORMAT flags
+		const uint32_t dds_pf_alpha_pixels = 0x1;
+		const uint32_t dds_pf_alpha = 0x2;
+		const uint32_t dds_pf_fourcc = 0x4;
+		const uint32_t dds_pf_rgb = 0x40;
+		const uint32_t dds_pf_luminance = 0x20000;
+
+		const uint32_t dds_misc_cube = 0x4;	// DDS_HEADER_DXT10 miscFlag
+
+		const uint8_t ktx2_identifier[12] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+		const uint32_t ktx2_header_bytes = 80;
+		const uint32_t ktx2_level_bytes = 24;
+
+		// the d3d12 limits, which also keep every size below well inside 64 bits
+		const uint32_t max_texture_size = 16384;
+		const uint32_t max_volume_size = 2048;
+		const uint32_t max_array_size = 2048;
+
+		bool Fail( std::string& error, const char* message )
+		{
+			error = message;
+			return false;
+		}
+
+		bool RangeFits( uint64_t first, uint64_t count, uint64_t limit )
+		{
+			return first <= limit && count <= limit - first;
+		}
+
+		uint32_t Read32( const uint8_t* bytes )
+		{
+			uint32_t value;
+			std::memcpy( &value, bytes, sizeof( value ) );
+			return value;
+		}
+
+		uint64_t Read64( const uint8_t* bytes )
+		{
+			uint64_t value;
+			std::memcpy( &value, bytes, sizeof( value ) );
+			return value;
+		}
+
+		void Write32( uint8_t* bytes, uint32_t value )
+		{
+			std::memcpy( bytes, &value, sizeof( value ) );
+		}
+
+		uint32_t FourCC( char a, char b, char c, char d )
+		{
+			return uint32_t( uint8_t( a ) ) | uint32_t( uint8_t( b ) ) << 8 | uint32_t( uint8_t( c ) ) << 16 | uint32_t( uint8_t( d ) ) << 24;
+		}
+
+		// DDS_PIXELFORMAT of files written without the dx10 extension, the formats d3dx9 and texconv's -dx9 write
+		uint32_t LegacyDdsFormat( const uint8_t* pixel_format )
+		{
+			const uint32_t flags = Read32( pixel_format + 4 );
+			const uint32_t fourcc = Read32( pixel_format + 8 );
+			const uint32_t bit_count = Read32( pixel_format + 12 );
+			const uint32_t r = Read32( pixel_format + 16 ), g = Read32( pixel_format + 20 ), b = Read32( pixel_format + 24 ), a = Read32( pixel_format + 28 );
+
+			if ( flags & dds_pf_fourcc )
+			{
+				if ( fourcc == FourCC( 'D', 'X', 'T', '1' ) )
+					return 71;	// DXGI_FORMAT_BC1_UNORM
+				if ( fourcc == FourCC( 'D', 'X', 'T', '2' ) || fourcc == FourCC( 'D', 'X', 'T', '3' ) )
+					return 74;	// DXGI_FORMAT_BC2_UNORM
+				if ( fourcc == FourCC( 'D', 'X', 'T', '4' ) || fourcc == FourCC( 'D', 'X', 'T', '5' ) )
+					return 77;	// DXGI_FORMAT_BC3_UNORM
+				if ( fourcc == FourCC( 'A', 'T', 'I', '1' ) || fourcc == FourCC( 'B', 'C', '4', 'U' ) )
+					return 80;	// DXGI_FORMAT_BC4_UNORM
+				if ( fourcc == FourCC( 'B', 'C', '4', 'S' ) )
+					return 81;	// DXGI_FORMAT_BC4_SNORM
+				if ( fourcc == FourCC( 'A', 'T', 'I', '2' ) || fourcc == FourCC( 'B', 'C', '5', 'U' ) )
+					return 83;	// DXGI_FORMAT_BC5_UNORM
+				if ( fourcc == FourCC( 'B', 'C', '5', 'S' ) )
+					return 84;	// DXGI_FORMAT_BC5_SNORM
+
+				// D3DFORMAT values stored as the fourcc
+				switch ( fourcc )
+				{
+				case 36:	return 11;	// D3DFMT_A16B16G16R16, DXGI_FORMAT_R16G16B16A16_UNORM
+				case 110:	return 13;	// D3DFMT_Q16W16V16U16, DXGI_FORMAT_R16G16B16A16_SNORM
+				case 111:	return 54;	// D3DFMT_R16F, DXGI_FORMAT_R16_FLOAT
+				case 112:	return 34;	// D3DFMT_G16R16F, DXGI_FORMAT_R16G16_FLOAT
+				case 113:	return 10;	// D3DFMT_A16B16G16R16F, DXGI_FORMAT_R16G16B16A16_FLOAT
+				case 114:	return 41;	// D3DFMT_R32F, DXGI_FORMAT_R32_FLOAT
+				case 115:	return 16;	// D3DFMT_G32R32F, DXGI_FORMAT_R32G32_FLOAT
+				case 116:	return 2;	// D3DFMT_A32B32G32R32F, DXGI_FORMAT_R32G32B32A32_FLOAT
+				default:	return 0;
+				}
+			}
+			if ( ( flags & dds_pf_rgb ) && bit_count == 32 )
+			{
+				if ( r == 0xff && g == 0xff00 && b == 0xff0000 && a == 0xff000000 )
+					return 28;	// DXGI_FORMAT_R8G8B8A8_UNORM
+				if ( r == 0xff0000 && g == 0xff00 && b == 0xff && a == 0xff000000 )
+					return 87;	// DXGI_FORMAT_B8G8R8A8_UNORM
+				if ( r == 0xff0000 && g == 0xff00 && b == 0xff && !( flags & dds_pf_alpha_pixels ) )
+					return 88;	// DXGI_FORMAT_B8G8R8X8_UNORM
+				if ( r == 0xffff && g == 0xffff0000 && !b && !a )
+					return 35;	// DXGI_FORMAT_R16G16_UNORM
+				if ( r == 0xffffffff && !g && !b && !a )
+					return 41;	// DXGI_FORMAT_R32_FLOAT, the only 32 bit single channel d3dx9 wrote
+				return 0;
+			}
+			if ( ( flags & dds_pf_rgb ) && bit_count == 16 && r == 0xf800 && g == 0x7e0 && b == 0x1f )
+				return 85;	// DXGI_FORMAT_B5G6R5_UNORM
+			if ( ( flags & dds_pf_luminance ) && bit_count == 8 && r == 0xff )
+				return 61;	// DXGI_FORMAT_R8_UNORM
+			if ( ( flags & dds_pf_luminance ) && bit_count == 16 && r == 0xffff )
+				return 56;	// DXGI_FORMAT_R16_UNORM
+			if ( ( flags & dds_pf_alpha ) && bit_count == 8 && a == 0xff )
+				return 65;	// DXGI_FORMAT_A8_UNORM
+			return 0;
+		}
+
+		// the vulkan formats with a dxgi equivalent that TextureFootprints covers
+		uint32_t Ktx2Format( uint32_t vk_format )
+		{
+			switch ( vk_format )
+			{
+			case 9:		return 61;	// VK_FORMAT_R8_UNORM
+			case 10:	return 63;	// VK_FORMAT_R8_SNORM
+			case 13:	return 62;	// VK_FORMAT_R8_UINT
+			case 16:	return 49;	// VK_FORMAT_R8G8_UNORM
+			case 17:	return 51;	// VK_FORMAT_R8G8_SNORM
+			case 37:	return 28;	// VK_FORMAT_R8G8B8A8_UNORM
+			case 38:	return 31;	// VK_FORMAT_R8G8B8A8_SNORM
+			case 41:	return 30;	// VK_FORMAT_R8G8B8A8_UINT
+			case 43:	return 29;	// VK_FORMAT_R8G8B8A8_SRGB
+			case 44:	return 87;	// VK_FORMAT_B8G8R8A8_UNORM
+			case 50:	return 91;	// VK_FORMAT_B8G8R8A8_SRGB
+			case 64:	return 24;	// VK_FORMAT_A2B10G10R10_UNORM_PACK32
+			case 70:	return 56;	// VK_FORMAT_R16_UNORM
+			case 76:	return 54;	// VK_FORMAT_R16_SFLOAT
+			case 77:	return 35;	// VK_FORMAT_R16G16_UNORM
+			case 83:	return 34;	// VK_FORMAT_R16G16_SFLOAT
+			case 91:	return 11;	// VK_FORMAT_R16G16B16A16_UNORM
+			case 97:	return 10;	// VK_FORMAT_R16G16B16A16_SFLOAT
+			case 98:	return 42;	// VK_FORMAT_R32_UINT
+			case 100:	return 41;	// VK_FORMAT_R32_SFLOAT
+			case 103:	return 16;	// VK_FORMAT_R32G32_SFLOAT
+			case 109:	return 2;	// VK_FORMAT_R32G32B32A32_SFLOAT
+			case 122:	return 26;	// VK_FORMAT_B10G11R11_UFLOAT_PACK32
+			case 123:	return 67;	// VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+			case 131:	return 71;	// VK_FORMAT_BC1_RGB_UNORM_BLOCK
+			case 132:	return 72;	// VK_FORMAT_BC1_RGB_SRGB_BLOCK
+			case 133:	return 71;	// VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+			case 134:	return 72;	// VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+			case 135:	return 74;	// VK_FORMAT_BC2_UNORM_BLOCK
+			case 136:	return 75;	// VK_FORMAT_BC2_SRGB_BLOCK
+			case 137:	return 77;	// VK_FORMAT_BC3_UNORM_BLOCK
+			case 138:	return 78;	// VK_FORMAT_BC3_SRGB_BLOCK
+			case 139:	return 80;	// VK_FORMAT_BC4_UNORM_BLOCK
+			case 140:	return 81;	// VK_FORMAT_BC4_SNORM_BLOCK
+			case 141:	return 83;	// VK_FORMAT_BC5_UNORM_BLOCK
+			case 142:	return 84;	// VK_FORMAT_BC5_SNORM_BLOCK
+			case 143:	return 95;	// VK_FORMAT_BC6H_UFLOAT_BLOCK
+			case 144:	return 96;	// VK_FORMAT_BC6H_SFLOAT_BLOCK
+			case 145:	return 98;	// VK_FORMAT_BC7_UNORM_BLOCK
+			case 146:	return 99;	// VK_FORMAT_BC7_SRGB_BLOCK
+			default:	return 0;
+			}
+		}
+
+		// resolves the layout and fills in the row sizes of every level, offsets and strides are left to the container.
+		// element_size gets the bytes of one array element with all its mips tightly packed
+		bool ResolveLevels( const TextureLayoutDesc& desc, TextureFileView& view, uint64_t& element_size, std::string& error )
+		{
+			TextureFormatInfo info;
+			if ( !GetTextureFormatInfo( desc.format, info ) )
+				return Fail( error, "texture format isn't supported" );
+			if ( info.plane_count != 1 )
+				return Fail( error, "planar texture formats aren't supported" );
+			if ( desc.width > max_texture_size || desc.height > max_texture_size ||
+				desc.depth_or_array_size > ( desc.dimension == texture_3d ? max_volume_size : max_array_size ) )
+				return Fail( error, "texture is larger than d3d12 allows" );
+			if ( !ResolveTextureLayout( desc, view.layout, view.subresource_count ) )
+				return Fail( error, "texture size or mip count isn't valid" );
+			if ( view.layout.mip_levels > texture_file_max_levels )
+				return Fail( error, "too many mip levels" );
+
+			TextureFootprint footprints[texture_file_max_levels];
+			GetTextureFootprints( view.layout, 0, view.layout.mip_levels, 0, footprints );
+			element_size = 0;
+			for ( uint32_t mip = 0; mip < view.layout.mip_levels; ++mip )
+			{
+				TextureFileLevel& level = view.levels[mip];
+				level.row_size = footprints[mip].row_size;
+				level.row_count = footprints[mip].row_count;
+				level.depth = footprints[mip].depth;
+				element_size += level.row_size * level.row_count * level.depth;
+			}
+			return true;
+		}
+
+		bool ReadDds( const uint8_t* bytes, size_t size, TextureFileView& view, std::string& error )
+		{
+			if ( size < 4 + dds_header_bytes )
+				return Fail( error, "file too small for a dds header" );
+			const uint8_t* header = bytes + 4;
+			const uint8_t* pixel_format = header + 72;
+			if ( Read32( header ) != dds_header_bytes || Read32( pixel_format ) != 32 )
+				return Fail( error, "dds header has the wrong size" );
+
+			const uint32_t flags = Read32( header + 4 );
+			const uint32_t caps2 = Read32( header + 108 );
+			TextureLayoutDesc desc;
+			desc.width = Read32( header + 12 );
+			desc.height = Read32( header + 8 );
+			desc.mip_levels = Read32( header + 24 ) ? Read32( header + 24 ) : 1; // writers leave out the flag, the count is what counts
+			uint64_t data_offset = 4 + dds_header_bytes;
+			view.cube = false;
+
+			if ( ( Read32( pixel_format + 4 ) & dds_pf_fourcc ) && Read32( pixel_format + 8 ) == dds_fourcc_dx10 )
+			{
+				if ( size < dds_header_size )
+					return Fail( error, "file too small for a dds dx10 header" );
+				const uint8_t* dx10 = bytes + 4 + dds_header_bytes;
+				desc.format = Read32( dx10 );
+				const uint32_t dimension = Read32( dx10 + 4 );
+				const uint32_t array_size = Read32( dx10 + 12 );
+				if ( dimension < texture_1d || dimension > texture_3d )
+					return Fail( error, "dds resource dimension isn't a texture" );
+				desc.dimension = TextureDimension( dimension );
+				view.cube = ( Read32( dx10 + 8 ) & dds_misc_cube ) != 0;
+				if ( view.cube && desc.dimension != texture_2d )
+					return Fail( error, "dds cube map isn't 2d" );
+				if ( desc.dimension == texture_3d )
+				{
+					if ( array_size != 1 )
+						return Fail( error, "dds volume texture arrays aren't supported" );
+					desc.depth_or_array_size = Read32( header + 20 );
+				}
+				else
+				{
+					desc.depth_or_array_size = view.cube ? array_size * 6 : array_size;
+					if ( !array_size || desc.depth_or_array_size / ( view.cube ? 6 : 1 ) != array_size )
+						return Fail( error, "dds array size isn't valid" );
+				}
+				if ( desc.dimension == texture_1d && desc.height > 1 )
+					return Fail( error, "dds 1d texture is more than one texel high" );
+				data_offset = dds_header_size;
+			}
+			else
+			{
+				desc.format = LegacyDdsFormat( pixel_format );
+				if ( !desc.format )
+					return Fail( error, "dds pixel format isn't supported, resave it with the dx10 header" );
+				desc.dimension = texture_2d;
+				desc.depth_or_array_size = 1;
+				if ( ( caps2 & dds_caps2_volume ) || ( flags & dds_flag_depth ) )
+				{
+					desc.dimension = texture_3d;
+					desc.depth_or_array_size = Read32( header + 20 );
+				}
+				else if ( caps2 & dds_caps2_cube )
+				{
+					if ( ( caps2 & dds_caps2_all_faces ) != dds_caps2_all_faces )
+						return Fail( error, "dds cube maps without all six faces aren't supported" );
+					desc.depth_or_array_size = 6;
+					view.cube = true;
+				}
+			}
+			if ( view.cube && desc.width != desc.height )
+				return Fail( error, "dds cube map faces aren't square" );
+
+			// array element after array element, each with its whole mip chain
+			uint64_t element_size;
+			if ( !ResolveLevels( desc, view, element_size, error ) )
+				return false;
+			const uint32_t element_count = view.layout.dimension == texture_3d ? 1 : view.layout.depth_or_array_size;
+			if ( !RangeFits( data_offset, element_size * element_count, size ) )
+				return Fail( error, "dds texture is truncated" );
+			uint64_t offset = data_offset;
+			for ( uint32_t mip = 0; mip < view.layout.mip_levels; ++mip )
+			{
+				TextureFileLevel& level = view.levels[mip];
+				level.offset = offset;
+				level.element_stride = element_size;
+				offset += level.row_size * level.row_count * level.depth;
+			}
+			view.container = texture_file_dds;
+			return true;
+		}
+
+		bool ReadKtx2( const uint8_t* bytes, size_t size, TextureFileView& view, std::string& error )
+		{
+			if ( size < ktx2_header_bytes )
+				return Fail( error, "file too small for a ktx2 header" );
+			const uint32_t vk_format = Read32( bytes + 12 );
+			const uint32_t width = Read32( bytes + 20 );
+			const uint32_t height = Read32( bytes + 24 );
+			const uint32_t depth = Read32( bytes + 28 );
+			const uint32_t layer_count = Read32( bytes + 32 );
+			const uint32_t face_count = Read32( bytes + 36 );
+			const uint32_t level_count = Read32( bytes + 40 );
+			if ( Read32( bytes + 44 ) != 0 )
+				return Fail( error, "supercompressed ktx2 isn't supported" );
+
+			TextureLayoutDesc desc;
+			desc.format = Ktx2Format( vk_format );
+			if ( !desc.format )
+				return Fail( error, "ktx2 format isn't supported" );
+			if ( face_count != 1 && face_count != 6 )
+				return Fail( error, "ktx2 face count isn't 1 or 6" );
+			view.cube = face_count == 6;
+			if ( view.cube && ( depth || width != height ) )
+				return Fail( error, "ktx2 cube map faces aren't square 2d images" );
+			if ( depth && layer_count )
+				return Fail( error, "ktx2 volume texture arrays aren't supported" );
+			desc.dimension = depth ? texture_3d : height ? texture_2d : texture_1d;
+			desc.width = width;
+			desc.height = height ? height : 1;
+			desc.depth_or_array_size = depth ? depth : ( layer_count ? layer_count : 1 ) * face_count;
+			if ( !depth && layer_count > max_array_size )
+				return Fail( error, "texture is larger than d3d12 allows" );
+			desc.mip_levels = level_count ? level_count : 1; // 0 asks the loader to make the mips, they start out as level 0 only
+
+			uint64_t element_size;
+			if ( !ResolveLevels( desc, view, element_size, error ) )
+				return false;
+			if ( !RangeFits( ktx2_header_bytes, uint64_t( view.layout.mip_levels ) * ktx2_level_bytes, size ) )
+				return Fail( error, "ktx2 level index runs past the end of the file" );
+
+			// each level has its layers, faces and slices back to back, wherever the index says it is
+			const uint32_t element_count = view.layout.dimension == texture_3d ? 1 : view.layout.depth_or_array_size;
+			for ( uint32_t mip = 0; mip < view.layout.mip_levels; ++mip )
+			{
+				const uint8_t* entry = bytes + ktx2_header_bytes + mip * ktx2_level_bytes;
+				TextureFileLevel& level = view.levels[mip];
+				level.offset = Read64( entry );
+				level.element_stride = level.row_size * level.row_count * level.depth;
+				if ( Read64( entry + 8 ) != level.element_stride * element_count )
+					return Fail( error, "ktx2 level size doesn't match the format" );
+				if ( !RangeFits( level.offset, level.element_stride * element_count, size ) )
+					return Fail( error, "ktx2 level runs past the end of the file" );
+			}
+			view.container = texture_file_ktx2;
+			return true;
+		}
+	}
+
+	bool ReadTextureFile( const void* data, size_t size, TextureFileView& view, std::string& error )
+	{
+		std::memset( &view, 0, sizeof( view ) );
+		const uint8_t* bytes = static_cast<const uint8_t*>( data );
+		view.data = bytes;
+
+		if ( size >= 4 && Read32( bytes ) == dds_magic )
+			return ReadDds( bytes, size, view, error );
+		if ( size >= sizeof( ktx2_identifier ) && std::memcmp( bytes, ktx2_identifier, sizeof( ktx2_identifier ) ) == 0 )
+			return ReadKtx2( bytes, size, view, error );
+		return Fail( error, "not a dds or ktx2 file" );
+	}
+
+	SubresourceSource TextureFileSource( const TextureFileView& view, uint32_t subresource )
+	{
+		const TextureFileLevel& level = view.levels[subresource % view.layout.mip_levels];
+		const uint32_t element = subresource / view.layout.mip_levels;
+		const SubresourceSource source = { view.data + level.offset + element * level.element_stride, size_t( level.row_size ), size_t( level.row_size ) * level.row_count };
+		return source;
+	}
+
+	bool AddTextureFile( UploadPlanner& planner, uint32_t job, const TextureFileView& view )
+	{
+		if ( view.subresource_count > planner.Capacity( ) - planner.Count( ) )
+			return false;
+
+		// the planner places every call on the next placement boundary, which is where the next subresource of
+		// one big call would go as well
+		const uint32_t batch = 16;
+		SubresourceSource sources[batch];
+		for ( uint32_t first = 0; first < view.subresource_count; first += batch )
+		{
+			const uint32_t count = view.subresource_count - first < batch ? view.subresource_count - first : batch;
+			for ( uint32_t i = 0; i < count; ++i )
+				sources[i] = TextureFileSource( view, first + i );
+			planner.Add( job, view.layout, first, count, sources );
+		}
+		return true;
+	}
+
+	bool WriteDdsHeader( const TextureLayoutDesc& desc, bool cube, uint8_t ( &header )[dds_header_size], uint64_t& data_size )
+	{
+		TextureFileView view;
+		std::string error;
+		if ( cube && ( desc.dimension != texture_2d || desc.depth_or_array_size % 6 != 0 || desc.width != desc.height ) )
+			return false;
+		if ( !ResolveLevels( desc, view, data_size, error ) )
+			return false;
+		if ( view.layout.dimension != texture_3d )
+			data_size *= view.layout.depth_or_array_size;
+
+		std::memset( header, 0, sizeof( header ) );
+		uint8_t* dds = header + 4;
+		uint8_t* pixel_format = dds + 72;
+		uint8_t* dx10 = dds + dds_header_bytes;
+		Write32( header, dds_magic );
+		Write32( dds, dds_header_bytes );
+		Write32( dds + 4, dds_flags_texture | dds_flag_mip_count | ( view.layout.dimension == texture_3d ? dds_flag_depth : 0 ) );
+		Write32( dds + 8, view.layout.height );
+		Write32( dds + 12, uint32_t( view.layout.width ) );
+		Write32( dds + 20, view.layout.dimension == texture_3d ? view.layout.depth_or_array_size : 0 );
+		Write32( dds + 24, view.layout.mip_levels );
+		Write32( pixel_format, 32 );
+		Write32( pixel_format + 4, dds_pf_fourcc );
+		Write32( pixel_format + 8, dds_fourcc_dx10 );
+		Write32( dds + 104, dds_caps_texture | ( view.layout.mip_levels > 1 || cube ? dds_caps_complex : 0 ) | ( view.layout.mip_levels > 1 ? dds_caps_mipmap : 0 ) );
+		Write32( dds + 108, ( cube ? dds_caps2_cube | dds_caps2_all_faces : 0 ) | ( view.layout.dimension == texture_3d ? dds_caps2_volume : 0 ) );
+		Write32( dx10, view.layout.format );
+		Write32( dx10 + 4, view.layout.dimension );
+		Write32( dx10 + 8, cube ? dds_misc_cube : 0 );
+		Write32( dx10 + 12, view.layout.dimension == texture_3d ? 1 : view.layout.depth_or_array_size / ( cube ? 6 : 1 ) );
+		return true;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "SubresourceCopy.h"
+#include "TextureFootprints.h"
+#include "UploadBatch.h"
+
+// dds and ktx2 textures read in place: the header is checked and turned into a TextureLayoutDesc, every subresource
+// is a SubresourceSource pointing into the mapped file. AddTextureFile plans them straight into an UploadPlanner, so
+// FillUploads copies each mip from the mapping into the upload buffer at its footprint with no copy in between.
+// 1d, 2d, 3d, arrays and cube maps of the formats TextureFootprints covers, planar video formats and supercompressed
+// ktx2 aren't read. Everything is little endian, no d3d in here
+
+namespace DXLayer
+{
+	static const uint32_t dds_magic = 0x20534444; // "DDS "
+	static const size_t dds_header_size = 148; // magic, DDS_HEADER and DDS_HEADER_DXT10
+	static const uint32_t texture_file_max_levels = 16; // a 32768 texel wide chain, d3d12 stops at 16384
+
+	enum TextureFileContainer : uint32_t
+	{
+		texture_file_dds,
+		texture_file_ktx2
+	};
+
+	// where the subresources of one mip level are in the file: array element a starts at offset + a * element_stride,
+	// its slices and rows are tightly packed, rows of blocks for block compressed formats
+	struct TextureFileLevel
+	{
+		uint64_t offset;			// from the start of the file
+		uint64_t element_stride;
+		uint64_t row_size;
+		uint32_t row_count;
+		uint32_t depth;
+	};
+
+	// pointers into the mapped file, valid while the mapping is open
+	struct TextureFileView
+	{
+		TextureFileContainer container;
+		TextureLayoutDesc layout;	// mip_levels resolved, depth_or_array_size counts every face of a cube array
+		bool cube;					// faces in +x -x +y -y +z -z order, six array elements per cube
+		uint32_t subresource_count;
+		const uint8_t* data;		// the start of the file
+		TextureFileLevel levels[texture_file_max_levels];
+	};
+
+	// detects the container from the magic, validates the header against the format and checks that every level
+	// fits in the file. Texel data is never touched
+	bool ReadTextureFile( const void* data, size_t size, TextureFileView& view, std::string& error );
+
+	// subresource numbered like D3D12CalcSubresource: mip + array element * mip levels
+	SubresourceSource TextureFileSource( const TextureFileView& view, uint32_t subresource );
+
+	// every subresource of the file as job, sources in the mapping. False and nothing planned when the planner is full
+	bool AddTextureFile( UploadPlanner& planner, uint32_t job, const TextureFileView& view );
+
+	// dds header with the dx10 extension for a texture whose data follows in the order ReadTextureFile expects,
+	// data_size gets its bytes. False for a layout GetTextureFootprints doesn't cover or a cube that isn't 2d with a
+	// multiple of six array elements
+	bool WriteDdsHeader( const TextureLayoutDesc& desc, bool cube, uint8_t ( &header )[dds_header_size], uint64_t& data_size );
+}
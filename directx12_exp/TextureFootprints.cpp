@@ -0,0 +1,198 @@
+#include "TextureFootprints.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// the DXGI_FORMAT values of the plane formats
+		const uint32_t format_r16g16_typeless = 33;
+		const uint32_t format_r8g8_typeless = 48;
+		const uint32_t format_r16_typeless = 53;
+		const uint32_t format_r8_typeless = 60;
+
+		uint64_t AlignUp( uint64_t value, uint64_t alignment )
+		{
+			return ( value + alignment - 1 ) & ~( alignment - 1 );
+		}
+
+		// a mip dimension rounded up to whole blocks, never 0
+		uint64_t AlignAtLeast( uint64_t value, uint64_t alignment )
+		{
+			return value ? AlignUp( value, alignment ) : alignment;
+		}
+
+		bool Single( uint32_t format, uint32_t block_size, uint32_t block_bytes, TextureFormatInfo& info )
+		{
+			info.block_width = block_size;
+			info.block_height = block_size;
+			info.plane_count = 1;
+			info.planes[0].format = format;
+			info.planes[0].block_bytes = block_bytes;
+			info.planes[0].subsampling_x = 1;
+			info.planes[0].subsampling_y = 1;
+			info.planes[1] = info.planes[0];
+			return true;
+		}
+
+		// 4:2:0 video, full resolution luma then interleaved chroma at half the width and height
+		bool TwoPlane( uint32_t luma_format, uint32_t luma_bytes, uint32_t chroma_format, TextureFormatInfo& info )
+		{
+			Single( luma_format, 1, luma_bytes, info );
+			info.plane_count = 2;
+			info.planes[1].format = chroma_format;
+			info.planes[1].block_bytes = luma_bytes * 2;
+			info.planes[1].subsampling_x = 2;
+			info.planes[1].subsampling_y = 2;
+			return true;
+		}
+
+		uint32_t MipCount( uint64_t width, uint32_t height, uint32_t depth )
+		{
+			uint64_t largest = width > height ? width : height;
+			largest = largest > depth ? largest : depth;
+			uint32_t count = 1;
+			while ( largest >>= 1 )
+				++count;
+			return count;
+		}
+	}
+
+	bool GetTextureFormatInfo( uint32_t format, TextureFormatInfo& info )
+	{
+		if ( format >= 1 && format <= 4 )			// r32g32b32a32
+			return Single( format, 1, 16, info );
+		if ( format >= 5 && format <= 8 )			// r32g32b32
+			return Single( format, 1, 12, info );
+		if ( format >= 9 && format <= 18 )			// r16g16b16a16, r32g32
+			return Single( format, 1, 8, info );
+		if ( format >= 23 && format <= 43 )			// r10g10b10a2 to r32, d32_float
+			return Single( format, 1, 4, info );
+		if ( format >= 48 && format <= 59 )			// r8g8, r16
+			return Single( format, 1, 2, info );
+		if ( format >= 60 && format <= 65 )			// r8, a8
+			return Single( format, 1, 1, info );
+		if ( format == 67 )							// r9g9b9e5_sharedexp
+			return Single( format, 1, 4, info );
+		if ( ( format >= 70 && format <= 72 ) || ( format >= 79 && format <= 81 ) )	// bc1, bc4
+			return Single( format, 4, 8, info );
+		if ( ( format >= 73 && format <= 78 ) || ( format >= 82 && format <= 84 ) || ( format >= 94 && format <= 99 ) ) // bc2, bc3, bc5, bc6h, bc7
+			return Single( format, 4, 16, info );
+		if ( format >= 85 && format <= 86 )			// b5g6r5, b5g5r5a1
+			return Single( format, 1, 2, info );
+		if ( format >= 87 && format <= 93 )			// b8g8r8a8, b8g8r8x8, r10g10b10_xr_bias_a2
+			return Single( format, 1, 4, info );
+		if ( format >= 100 && format <= 101 )		// ayuv, y410
+			return Single( format, 1, 4, info );
+		if ( format == 102 )						// y416
+			return Single( format, 1, 8, info );
+		if ( format == 103 )						// nv12
+			return TwoPlane( format_r8_typeless, 1, format_r8g8_typeless, info );
+		if ( format >= 104 && format <= 105 )		// p010, p016
+			return TwoPlane( format_r16_typeless, 2, format_r16g16_typeless, info );
+		if ( format == 115 )						// b4g4r4a4
+			return Single( format, 1, 2, info );
+		return false;
+	}
+
+	bool ResolveTextureLayout( const TextureLayoutDesc& desc, TextureLayoutDesc& resolved, uint32_t& subresource_count )
+	{
+		resolved = desc;
+		if ( desc.dimension == texture_buffer )
+		{
+			resolved.height = 1;
+			resolved.depth_or_array_size = 1;
+			resolved.mip_levels = 1;
+			resolved.format = 0;
+			subresource_count = 1;
+			return desc.width != 0;
+		}
+
+		TextureFormatInfo info;
+		if ( desc.dimension < texture_1d || desc.dimension > texture_3d || !GetTextureFormatInfo( desc.format, info ) )
+			return false;
+		if ( desc.dimension == texture_1d )
+			resolved.height = 1;
+		if ( !resolved.width || !resolved.height || !resolved.depth_or_array_size )
+			return false;
+
+		const uint32_t full_chain = MipCount( resolved.width, resolved.height, desc.dimension == texture_3d ? resolved.depth_or_array_size : 1 );
+		if ( !resolved.mip_levels )
+			resolved.mip_levels = full_chain;
+		if ( resolved.mip_levels > full_chain )
+			return false;
+
+		const uint64_t count = uint64_t( resolved.mip_levels ) * ( desc.dimension == texture_3d ? 1 : resolved.depth_or_array_size ) * info.plane_count;
+		if ( count > ~0u )
+			return false;
+		subresource_count = uint32_t( count );
+		return true;
+	}
+
+	uint64_t GetTextureFootprints( const TextureLayoutDesc& desc, uint32_t first_subresource, uint32_t count, uint64_t base_offset, TextureFootprint* footprints )
+	{
+		TextureLayoutDesc resolved;
+		uint32_t subresource_count;
+		if ( !ResolveTextureLayout( desc, resolved, subresource_count ) || first_subresource > subresource_count || count > subresource_count - first_subresource )
+			return invalid_footprint_size;
+
+		if ( resolved.dimension == texture_buffer )
+		{
+			if ( count && footprints )
+			{
+				footprints[0].offset = base_offset;
+				footprints[0].format = 0;
+				footprints[0].width = uint32_t( resolved.width );
+				footprints[0].height = 1;
+				footprints[0].depth = 1;
+				footprints[0].row_pitch = uint32_t( AlignUp( resolved.width, texture_pitch_alignment ) );
+				footprints[0].row_count = 1;
+				footprints[0].row_size = resolved.width;
+			}
+			return count ? resolved.width : 0;
+		}
+
+		TextureFormatInfo info;
+		GetTextureFormatInfo( resolved.format, info );
+		const uint32_t array_size = resolved.dimension == texture_3d ? 1 : resolved.depth_or_array_size;
+		const uint32_t width_alignment = info.block_width * info.planes[info.plane_count - 1].subsampling_x;
+		const uint32_t height_alignment = info.block_height * info.planes[info.plane_count - 1].subsampling_y;
+
+		// every plane of every array slice has the full mip chain, subresource = mip + ( slice + plane * array_size ) * mips
+		uint64_t total = 0;
+		for ( uint32_t i = 0; i < count; ++i )
+		{
+			const uint32_t subresource = first_subresource + i;
+			const uint32_t mip = subresource % resolved.mip_levels;
+			const uint32_t plane = subresource / resolved.mip_levels / array_size;
+			const TextureFormatInfo::Plane& plane_info = info.planes[plane];
+
+			const uint64_t width = AlignAtLeast( resolved.width >> mip, width_alignment ) / plane_info.subsampling_x;
+			const uint64_t height = AlignAtLeast( resolved.height >> mip, height_alignment ) / plane_info.subsampling_y;
+			const uint64_t depth = resolved.dimension == texture_3d ? AlignAtLeast( resolved.depth_or_array_size >> mip, 1 ) : 1;
+			const uint64_t row_size = width / info.block_width * plane_info.block_bytes;
+			const uint64_t row_count = height / info.block_height;
+
+			// rows of planar formats are aligned so each plane starts right after the rows of the one before it
+			const uint64_t row_pitch = AlignUp( row_size, info.plane_count > 1 ? texture_placement_alignment : texture_pitch_alignment );
+			if ( row_pitch > ~0u )
+				return invalid_footprint_size;
+
+			if ( i )
+				total = AlignUp( total, texture_placement_alignment );
+			if ( footprints )
+			{
+				TextureFootprint& footprint = footprints[i];
+				footprint.offset = base_offset + total;
+				footprint.format = plane_info.format;
+				footprint.width = uint32_t( width );
+				footprint.height = uint32_t( height );
+				footprint.depth = uint32_t( depth );
+				footprint.row_pitch = uint32_t( row_pitch );
+				footprint.row_count = uint32_t( row_count );
+				footprint.row_size = row_size;
+			}
+			total += ( row_count * depth - 1 ) * row_pitch + row_size;
+		}
+		return total;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+// where each subresource of a texture goes in an upload or readback buffer, what ID3D12Device::GetCopyableFootprints
+// returns, without a device. Rows start at multiples of 256 bytes, subresources at multiples of 512, block
+// compressed formats count rows of blocks, planar video formats get a footprint per plane. Planning thousands of
+// uploads this way costs no COM calls or heap allocations. Formats are DXGI_FORMAT values, no d3d in here
+
+namespace DXLayer
+{
+	static const uint32_t texture_pitch_alignment = 256;		// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	static const uint32_t texture_placement_alignment = 512;	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+	static const uint64_t invalid_footprint_size = ~0ull;
+
+	// the values of D3D12_RESOURCE_DIMENSION
+	enum TextureDimension : uint32_t
+	{
+		texture_buffer = 1,
+		texture_1d = 2,
+		texture_2d = 3,
+		texture_3d = 4
+	};
+
+	// how a format is stored: blocks of block_width x block_height texels, 1 x 1 for everything that isn't block
+	// compressed. Planar formats have one entry per plane with the size of the plane relative to the texture
+	struct TextureFormatInfo
+	{
+		uint32_t block_width;
+		uint32_t block_height;
+		uint32_t plane_count;
+		struct Plane
+		{
+			uint32_t format;			// what the footprint of the plane says
+			uint32_t block_bytes;
+			uint32_t subsampling_x;		// the plane is 1 / subsampling of the texture wide and high
+			uint32_t subsampling_y;
+		} planes[2];
+	};
+
+	// false for formats the footprints don't cover: 1 bit and packed 4:2:2 formats, palettes, opaque video
+	// formats and depth with stencil, whose planes are in the footprints of a device only
+	bool GetTextureFormatInfo( uint32_t format, TextureFormatInfo& info );
+
+	// the part of D3D12_RESOURCE_DESC the layout depends on. mip_levels of 0 is the full chain, as at creation
+	struct TextureLayoutDesc
+	{
+		TextureDimension dimension;
+		uint64_t width;
+		uint32_t height;
+		uint32_t depth_or_array_size;
+		uint32_t mip_levels;
+		uint32_t format;
+	};
+
+	// D3D12_PLACED_SUBRESOURCE_FOOTPRINT with the row count and size next to it
+	struct TextureFootprint
+	{
+		uint64_t offset;
+		uint32_t format;
+		uint32_t width;			// in texels, block compressed formats rounded up to whole blocks
+		uint32_t height;
+		uint32_t depth;
+		uint32_t row_pitch;
+		uint32_t row_count;		// rows of blocks
+		uint64_t row_size;		// bytes of a row without the padding
+	};
+
+	// mip_levels resolved and subresource_count, mips * array size * planes. False for an unsupported format or
+	// an empty texture
+	bool ResolveTextureLayout( const TextureLayoutDesc& desc, TextureLayoutDesc& resolved, uint32_t& subresource_count );
+
+	// footprints of subresources [first_subresource, first_subresource + count) placed from base_offset, which should
+	// be a multiple of texture_placement_alignment. footprints may be null. Returns the bytes they span from
+	// base_offset, the last row of the last one unpadded like GetRequiredIntermediateSize, or invalid_footprint_size
+	// when the range or the desc isn't valid
+	uint64_t GetTextureFootprints( const TextureLayoutDesc& desc, uint32_t first_subresource, uint32_t count, uint64_t base_offset, TextureFootprint* footprints );
+}
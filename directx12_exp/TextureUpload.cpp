@@ -0,0 +1,225 @@
+#include "TextureUpload.h"
+
+#include "d3dx12.h"
+#include "SubresourceCopy.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// footprints are worked out this many at a time on the stack
+		const UINT footprint_batch = 16;
+
+		// maps intermediate once, fills it with everything planned and records the copies to each job's destination.
+		// Returns the bytes used from intermediate_offset, where the plan starts, 0 when intermediate is too small
+		template <typename Destination, typename IsBuffer>
+		UINT64 FillAndRecord( ID3D12GraphicsCommandList* command_list, ID3D12Resource* intermediate, UINT64 intermediate_offset, const UploadPlanner& planner,
+			UINT thread_count, Destination destination_of, IsBuffer is_buffer )
+		{
+			const D3D12_RESOURCE_DESC intermediate_desc = intermediate->GetDesc( );
+			if ( intermediate_desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER || intermediate_desc.Width < planner.End( ) )
+			{
+				return 0;
+			}
+
+			BYTE* mapped;
+			CD3DX12_RANGE read_range( 0, 0 ); // the cpu never reads from the upload heap
+			if ( FAILED( intermediate->Map( 0, &read_range, reinterpret_cast<void**>( &mapped ) ) ) )
+			{
+				return 0;
+			}
+			SubresourceCopyOptions options;
+			options.thread_count = thread_count;
+			FillUploads( planner.Uploads( ), planner.Count( ), mapped, options );
+			intermediate->Unmap( 0, nullptr );
+
+			for ( UINT i = 0; i < planner.Count( ); ++i )
+			{
+				const PlannedUpload& upload = planner.Uploads( )[i];
+				ID3D12Resource* destination = destination_of( upload.job );
+				if ( is_buffer( upload.job ) )
+				{
+					command_list->CopyBufferRegion( destination, 0, intermediate, upload.footprint.offset, upload.footprint.width );
+					continue;
+				}
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed;
+				placed.Offset = upload.footprint.offset;
+				placed.Footprint.Format = DXGI_FORMAT( upload.footprint.format );
+				placed.Footprint.Width = upload.footprint.width;
+				placed.Footprint.Height = upload.footprint.height;
+				placed.Footprint.Depth = upload.footprint.depth;
+				placed.Footprint.RowPitch = upload.footprint.row_pitch;
+				CD3DX12_TEXTURE_COPY_LOCATION copy_to( destination, upload.subresource );
+				CD3DX12_TEXTURE_COPY_LOCATION copy_from( intermediate, placed );
+				command_list->CopyTextureRegion( &copy_to, 0, 0, 0, &copy_from, nullptr );
+			}
+			return planner.End( ) - intermediate_offset;
+		}
+	}
+
+	UINT64 RequiredIntermediateSize( const D3D12_RESOURCE_DESC& desc, UINT first_subresource, UINT subresource_count )
+	{
+		return GetTextureFootprints( TextureLayoutOf( desc ), first_subresource, subresource_count, 0, nullptr );
+	}
+
+	UINT64 UpdateTextureSubresources( ID3D12GraphicsCommandList* command_list, ID3D12Resource* destination, const D3D12_RESOURCE_DESC& destination_desc,
+		ID3D12Resource* intermediate, UINT64 intermediate_offset, UINT first_subresource, UINT subresource_count, const D3D12_SUBRESOURCE_DATA* data )
+	{
+		const TextureLayoutDesc layout = TextureLayoutOf( destination_desc );
+		const UINT64 required_size = GetTextureFootprints( layout, first_subresource, subresource_count, intermediate_offset, nullptr );
+		const D3D12_RESOURCE_DESC intermediate_desc = intermediate->GetDesc( );
+		if ( required_size == invalid_footprint_size || intermediate_desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER ||
+			intermediate_desc.Width < intermediate_offset + required_size )
+		{
+			return 0;
+		}
+
+		BYTE* mapped;
+		CD3DX12_RANGE read_range( 0, 0 ); // the cpu never reads from the upload heap
+		if ( FAILED( intermediate->Map( 0, &read_range, reinterpret_cast<void**>( &mapped ) ) ) )
+		{
+			return 0;
+		}
+
+		// each batch continues where the last one stopped, aligned like the next subresource in one long list
+		TextureFootprint footprints[footprint_batch];
+		UINT64 batch_offset = 0;
+		for ( UINT batch_first = 0; batch_first < subresource_count; batch_first += footprint_batch )
+		{
+			const UINT batch_count = subresource_count - batch_first < footprint_batch ? subresource_count - batch_first : footprint_batch;
+			if ( batch_first )
+				batch_offset = ( batch_offset + texture_placement_alignment - 1 ) & ~UINT64( texture_placement_alignment - 1 );
+			batch_offset += GetTextureFootprints( layout, first_subresource + batch_first, batch_count, intermediate_offset + batch_offset, footprints );
+
+			for ( UINT i = 0; i < batch_count; ++i )
+			{
+				const TextureFootprint& footprint = footprints[i];
+				const D3D12_SUBRESOURCE_DATA& source = data[batch_first + i];
+				const SubresourceDestination copy_destination = { mapped + footprint.offset, footprint.row_pitch, size_t( footprint.row_pitch ) * footprint.row_count };
+				const SubresourceSource copy_source = { source.pData, size_t( source.RowPitch ), size_t( source.SlicePitch ) };
+				CopySubresource( copy_destination, copy_source, size_t( footprint.row_size ), footprint.row_count, footprint.depth );
+
+				if ( layout.dimension == texture_buffer )
+				{
+					command_list->CopyBufferRegion( destination, 0, intermediate, footprint.offset, footprint.width );
+					continue;
+				}
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed;
+				placed.Offset = footprint.offset;
+				placed.Footprint.Format = DXGI_FORMAT( footprint.format );
+				placed.Footprint.Width = footprint.width;
+				placed.Footprint.Height = footprint.height;
+				placed.Footprint.Depth = footprint.depth;
+				placed.Footprint.RowPitch = footprint.row_pitch;
+				CD3DX12_TEXTURE_COPY_LOCATION copy_to( destination, first_subresource + batch_first + i );
+				CD3DX12_TEXTURE_COPY_LOCATION copy_from( intermediate, placed );
+				command_list->CopyTextureRegion( &copy_to, 0, 0, 0, &copy_from, nullptr );
+			}
+		}
+		intermediate->Unmap( 0, nullptr );
+		return required_size;
+	}
+
+	UINT64 UploadTextures( ID3D12GraphicsCommandList* command_list, ID3D12Resource* intermediate, UINT64 intermediate_offset,
+		const TextureUploadJob* jobs, UINT job_count, PlannedUpload* storage, UINT storage_capacity, UINT thread_count )
+	{
+		UploadPlanner planner( storage, storage_capacity, intermediate_offset );
+		for ( UINT job = 0; job < job_count; ++job )
+		{
+			const UINT first_planned = planner.Count( );
+			if ( !planner.Add( job, TextureLayoutOf( jobs[job].desc ), jobs[job].first_subresource, jobs[job].subresource_count, nullptr ) )
+			{
+				return 0;
+			}
+			for ( UINT i = 0; i < jobs[job].subresource_count; ++i )
+			{
+				const D3D12_SUBRESOURCE_DATA& data = jobs[job].data[i];
+				storage[first_planned + i].source.data = data.pData;
+				storage[first_planned + i].source.row_pitch = size_t( data.RowPitch );
+				storage[first_planned + i].source.slice_pitch = size_t( data.SlicePitch );
+			}
+		}
+		return FillAndRecord( command_list, intermediate, intermediate_offset, planner, thread_count, [ & ] ( UINT job ) { return jobs[job].destination; },
+			[ & ] ( UINT job ) { return jobs[job].desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER; } );
+	}
+
+	D3D12_RESOURCE_DESC TextureFileResourceDesc( const TextureFileView& file )
+	{
+		const TextureLayoutDesc& layout = file.layout;
+		const DXGI_FORMAT format = DXGI_FORMAT( layout.format );
+		const UINT16 depth_or_array_size = UINT16( layout.depth_or_array_size );
+		const UINT16 mip_levels = UINT16( layout.mip_levels );
+		switch ( layout.dimension )
+		{
+		case texture_1d:
+			return CD3DX12_RESOURCE_DESC::Tex1D( format, layout.width, depth_or_array_size, mip_levels );
+		case texture_3d:
+			return CD3DX12_RESOURCE_DESC::Tex3D( format, layout.width, layout.height, depth_or_array_size, mip_levels );
+		default:
+			return CD3DX12_RESOURCE_DESC::Tex2D( format, layout.width, layout.height, depth_or_array_size, mip_levels );
+		}
+	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC TextureFileSrvDesc( const TextureFileView& file )
+	{
+		const TextureLayoutDesc& layout = file.layout;
+		D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+		desc.Format = DXGI_FORMAT( layout.format );
+		desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		const bool array = layout.depth_or_array_size > ( file.cube ? 6u : 1u );
+		if ( layout.dimension == texture_3d )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+			desc.Texture3D.MipLevels = layout.mip_levels;
+		}
+		else if ( file.cube && array )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+			desc.TextureCubeArray.MipLevels = layout.mip_levels;
+			desc.TextureCubeArray.NumCubes = layout.depth_or_array_size / 6;
+		}
+		else if ( file.cube )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+			desc.TextureCube.MipLevels = layout.mip_levels;
+		}
+		else if ( layout.dimension == texture_1d && array )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1DARRAY;
+			desc.Texture1DArray.MipLevels = layout.mip_levels;
+			desc.Texture1DArray.ArraySize = layout.depth_or_array_size;
+		}
+		else if ( layout.dimension == texture_1d )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1D;
+			desc.Texture1D.MipLevels = layout.mip_levels;
+		}
+		else if ( array )
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+			desc.Texture2DArray.MipLevels = layout.mip_levels;
+			desc.Texture2DArray.ArraySize = layout.depth_or_array_size;
+		}
+		else
+		{
+			desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			desc.Texture2D.MipLevels = layout.mip_levels;
+		}
+		return desc;
+	}
+
+	UINT64 UploadTextureFiles( ID3D12GraphicsCommandList* command_list, ID3D12Resource* intermediate, UINT64 intermediate_offset,
+		const TextureFileUploadJob* jobs, UINT job_count, PlannedUpload* storage, UINT storage_capacity, UINT thread_count )
+	{
+		UploadPlanner planner( storage, storage_capacity, intermediate_offset );
+		for ( UINT job = 0; job < job_count; ++job )
+		{
+			if ( !AddTextureFile( planner, job, *jobs[job].file ) )
+			{
+				return 0;
+			}
+		}
+		return FillAndRecord( command_list, intermediate, intermediate_offset, planner, thread_count, [ & ] ( UINT job ) { return jobs[job].destination; },
+			[ & ] ( UINT ) { return false; } );
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "TextureFile.h"
+#include "TextureFootprints.h"
+#include "UploadBatch.h"
+
+// GetRequiredIntermediateSize and UpdateSubresources from d3dx12.h without asking the device: footprints come from
+// GetTextureFootprints and rows are copied into the upload heap with CopySubresource. UploadTextures does many
+// textures at once, UploadTextureFiles the same for dds and ktx2 files copied straight out of their mappings
+
+namespace DXLayer
+{
+	inline TextureLayoutDesc TextureLayoutOf( const D3D12_RESOURCE_DESC& desc )
+	{
+		TextureLayoutDesc layout;
+		layout.dimension = TextureDimension( desc.Dimension );
+		layout.width = desc.Width;
+		layout.height = desc.Height;
+		layout.depth_or_array_size = desc.DepthOrArraySize;
+		layout.mip_levels = desc.MipLevels;
+		layout.format = uint32_t( desc.Format );
+		return layout;
+	}
+
+	// invalid_footprint_size for a layout GetTextureFootprints doesn't cover
+	UINT64 RequiredIntermediateSize( const D3D12_RESOURCE_DESC& desc, UINT first_subresource, UINT subresource_count );
+
+	// copies data into intermediate, an upload buffer, from intermediate_offset on and records the copies from there into
+	// destination, which has to be in the copy dest state. Returns the bytes used in intermediate, 0 on failure like
+	// UpdateSubresources
+	UINT64 UpdateTextureSubresources( ID3D12GraphicsCommandList* command_list, ID3D12Resource* destination, const D3D12_RESOURCE_DESC& destination_desc,
+		ID3D12Resource* intermediate, UINT64 intermediate_offset, UINT first_subresource, UINT subresource_count, const D3D12_SUBRESOURCE_DATA* data );
+
+	struct TextureUploadJob
+	{
+		ID3D12Resource* destination;		// in the copy dest state
+		D3D12_RESOURCE_DESC desc;
+		UINT first_subresource;
+		UINT subresource_count;
+		const D3D12_SUBRESOURCE_DATA* data;	// subresource_count of them
+	};
+
+	// every job in one pass: the subresources are planned into storage, intermediate is mapped once and filled on
+	// thread_count threads, and all the copies are recorded into command_list. Returns the bytes used in intermediate
+	// from intermediate_offset, 0 when storage or intermediate is too small or a job's layout isn't covered
+	UINT64 UploadTextures( ID3D12GraphicsCommandList* command_list, ID3D12Resource* intermediate, UINT64 intermediate_offset,
+		const TextureUploadJob* jobs, UINT job_count, PlannedUpload* storage, UINT storage_capacity, UINT thread_count );
+
+	// the resource a texture file goes into, Tex1D, Tex2D or Tex3D with its array size and mips. Cube maps are 2d
+	// arrays, TextureFileSrvDesc views them as cubes
+	D3D12_RESOURCE_DESC TextureFileResourceDesc( const TextureFileView& file );
+	D3D12_SHADER_RESOURCE_VIEW_DESC TextureFileSrvDesc( const TextureFileView& file );
+
+	struct TextureFileUploadJob
+	{
+		ID3D12Resource* destination;		// created from TextureFileResourceDesc, in the copy dest state
+		const TextureFileView* file;		// its mapping stays open until this returns
+	};
+
+	// UploadTextures for every subresource of each file, copied from the mapping into intermediate with nothing in
+	// between
+	UINT64 UploadTextureFiles( ID3D12GraphicsCommandList* command_list, ID3D12Resource* intermediate, UINT64 intermediate_offset,
+		const TextureFileUploadJob* jobs, UINT job_count, PlannedUpload* storage, UINT storage_capacity, UINT thread_count );
+}
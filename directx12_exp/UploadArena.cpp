@@ -0,0 +1,109 @@
+#include "UploadArena.h"
+
+namespace DXLayer
+{
+	const uint64_t UploadArena::invalid_offset;
+	const uint64_t UploadArena::alignment;
+
+	UploadArena::UploadArena( )
+		: data( nullptr ), size( 0 ), closed( false )
+	{ }
+
+	void UploadArena::Init( uint8_t* data, uint64_t size )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		this->data = data;
+		this->size = size;
+		blocks.Reset( uint32_t( size / alignment ) );
+		closed = false;
+	}
+
+	uint64_t UploadArena::Allocate( uint64_t size )
+	{
+		const uint64_t block_count = ( size + alignment - 1 ) / alignment;
+
+		std::unique_lock<std::mutex> lock( mutex );
+		if ( size == 0 || block_count > blocks.Capacity( ) )
+			return invalid_offset;
+
+		// every Free wakes the waiters, the space freed may not be one block yet but it's the only time it can be
+		for ( ;; )
+		{
+			if ( closed )
+				return invalid_offset;
+			const uint32_t block = blocks.Allocate( uint32_t( block_count ) );
+			if ( block != RangeAllocator::invalid_offset )
+				return block * alignment;
+			freed.wait( lock );
+		}
+	}
+
+	void UploadArena::Free( uint64_t offset, uint64_t size )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			blocks.Free( uint32_t( offset / alignment ), uint32_t( ( size + alignment - 1 ) / alignment ) );
+		}
+		freed.notify_all( );
+	}
+
+	void UploadArena::Close( )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			closed = true;
+		}
+		freed.notify_all( );
+	}
+
+	uint64_t UploadArena::Used( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		return uint64_t( blocks.Capacity( ) - blocks.FreeSize( ) ) * alignment;
+	}
+
+	bool UploadArenaAllocation::Allocate( UploadArena& arena, uint64_t size )
+	{
+		Free( );
+		const uint64_t offset = arena.Allocate( size );
+		if ( offset == UploadArena::invalid_offset )
+			return false;
+
+		this->arena = &arena;
+		this->offset = offset;
+		this->size = size;
+		return true;
+	}
+
+	void UploadArenaAllocation::Free( )
+	{
+		if ( arena )
+			arena->Free( offset, size );
+		arena = nullptr;
+		offset = UploadArena::invalid_offset;
+		size = 0;
+	}
+
+	UploadArenaAllocation::UploadArenaAllocation( UploadArenaAllocation&& other )
+		: arena( other.arena ), offset( other.offset ), size( other.size )
+	{
+		other.arena = nullptr;
+		other.offset = UploadArena::invalid_offset;
+		other.size = 0;
+	}
+
+	UploadArenaAllocation& UploadArenaAllocation::operator=( UploadArenaAllocation&& other )
+	{
+		if ( this != &other )
+		{
+			Free( );
+			arena = other.arena;
+			offset = other.offset;
+			size = other.size;
+			other.arena = nullptr;
+			other.offset = UploadArena::invalid_offset;
+			other.size = 0;
+		}
+		return *this;
+	}
+}
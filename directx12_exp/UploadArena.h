@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "GeometryPool.h"
+
+// space in one persistently mapped upload buffer for data made off the render thread. Decode threads write streamed
+// assets straight into it, the render thread records copies out of it and gives the space back once the gpu ran
+// them. Unlike FrameAllocator space isn't tied to a frame: a finished asset may wait frames before it's taken, and
+// is given back frames after that, in any order. A decode thread that finds the buffer full waits for space instead
+// of failing, the render thread frees it every frame. No d3d in here, StreamUploadBuffer puts an upload heap behind it
+
+namespace DXLayer
+{
+	class UploadArena
+	{
+	public:
+		static const uint64_t invalid_offset = ~0ull;
+		static const uint64_t alignment = 16;	// of every allocation, enough for index buffers and streaming stores
+
+		UploadArena( );
+
+		// an empty arena over size bytes mapped at data, which the caller owns
+		void Init( uint8_t* data, uint64_t size );
+
+		// size bytes, waits while allocations that are still held leave no free block large enough. invalid_offset
+		// for sizes over the whole arena and once it's closed
+		uint64_t Allocate( uint64_t size );
+
+		void Free( uint64_t offset, uint64_t size );
+
+		// fails every Allocate from now on, waiting ones too, so threads stuck in it can be joined. Frees still work
+		void Close( );
+
+		uint8_t* Data( ) const { return data; }
+		uint64_t Size( ) const { return size; }
+		uint64_t Used( );
+
+	private:
+		uint8_t* data;
+		uint64_t size;
+
+		std::mutex mutex;						// guards everything below
+		std::condition_variable freed;
+		RangeAllocator blocks;					// in units of alignment
+		bool closed;
+	};
+
+	// an allocation that frees itself. Decoded assets hold one, so whatever is dropped before it's uploaded gives its
+	// space back, the renderer keeps the ones it copied from until their frame comes around again
+	class UploadArenaAllocation
+	{
+	public:
+		UploadArenaAllocation( )
+			: arena( nullptr ), offset( UploadArena::invalid_offset ), size( 0 )
+		{ }
+
+		// false when the arena is closed or too small, see UploadArena::Allocate
+		bool Allocate( UploadArena& arena, uint64_t size );
+
+		void Free( );
+
+		UploadArenaAllocation( UploadArenaAllocation&& other );
+		UploadArenaAllocation& operator=( UploadArenaAllocation&& other );
+		~UploadArenaAllocation( ) { Free( ); }
+
+		uint8_t* Data( ) const { return arena->Data( ) + offset; }
+		uint64_t Offset( ) const { return offset; }		// from the start of the buffer
+		uint64_t Size( ) const { return size; }
+
+	private:
+		UploadArenaAllocation( const UploadArenaAllocation& ) = delete;
+		UploadArenaAllocation& operator=( const UploadArenaAllocation& ) = delete;
+
+		UploadArena* arena;
+		uint64_t offset;
+		uint64_t size;
+	};
+}
@@ -0,0 +1,109 @@
+#include "UploadBatch.h"
+
+#include "RunOnThreads.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		// footprints are worked out this many at a time on the stack
+		const uint32_t footprint_batch = 16;
+
+		uint64_t AlignPlacement( uint64_t value )
+		{
+			return ( value + texture_placement_alignment - 1 ) & ~uint64_t( texture_placement_alignment - 1 );
+		}
+
+		uint64_t UploadSize( const PlannedUpload& upload )
+		{
+			return upload.footprint.row_size * upload.footprint.row_count * upload.footprint.depth;
+		}
+
+		void Fill( const PlannedUpload& upload, uint8_t* mapped, const SubresourceCopyOptions& options )
+		{
+			const TextureFootprint& footprint = upload.footprint;
+			const SubresourceDestination destination = { mapped + footprint.offset, footprint.row_pitch, size_t( footprint.row_pitch ) * footprint.row_count };
+			CopySubresource( destination, upload.source, size_t( footprint.row_size ), footprint.row_count, footprint.depth, options );
+		}
+	}
+
+	UploadPlanner::UploadPlanner( PlannedUpload* storage, uint32_t capacity, uint64_t base_offset )
+		: storage( storage ), capacity( capacity ), count( 0 ), base_offset( base_offset ), size( 0 )
+	{ }
+
+	void UploadPlanner::Reset( uint64_t base_offset )
+	{
+		this->base_offset = base_offset;
+		count = 0;
+		size = 0;
+	}
+
+	bool UploadPlanner::Add( uint32_t job, const TextureLayoutDesc& desc, uint32_t first_subresource, uint32_t count, const SubresourceSource* sources )
+	{
+		TextureLayoutDesc resolved;
+		uint32_t subresource_count;
+		if ( !ResolveTextureLayout( desc, resolved, subresource_count ) || first_subresource > subresource_count || count > subresource_count - first_subresource ||
+			count > capacity - this->count )
+		{
+			return false;
+		}
+
+		// the batches continue like one long list, the job starts on the next placement boundary
+		const uint64_t job_offset = this->count ? AlignPlacement( size ) : 0;
+		uint64_t job_size = 0;
+		TextureFootprint footprints[footprint_batch];
+		for ( uint32_t batch_first = 0; batch_first < count; batch_first += footprint_batch )
+		{
+			const uint32_t batch_count = count - batch_first < footprint_batch ? count - batch_first : footprint_batch;
+			if ( batch_first )
+				job_size = AlignPlacement( job_size );
+			job_size += GetTextureFootprints( resolved, first_subresource + batch_first, batch_count, base_offset + job_offset + job_size, footprints );
+
+			PlannedUpload* planned = storage + this->count + batch_first;
+			for ( uint32_t i = 0; i < batch_count; ++i )
+			{
+				planned[i].job = job;
+				planned[i].subresource = first_subresource + batch_first + i;
+				planned[i].footprint = footprints[i];
+				if ( sources )
+					planned[i].source = sources[batch_first + i];
+			}
+		}
+		this->count += count;
+		size = job_offset + job_size;
+		return true;
+	}
+
+	void FillUploads( const PlannedUpload* uploads, uint32_t count, uint8_t* mapped, const SubresourceCopyOptions& options )
+	{
+		// a few big subresources, each one is split
+		if ( count < options.thread_count )
+		{
+			for ( uint32_t i = 0; i < count; ++i )
+				Fill( uploads[i], mapped, options );
+			return;
+		}
+
+		// every thread takes the subresources that start in its share of the bytes, each copied on that thread alone
+		uint64_t total = 0;
+		for ( uint32_t i = 0; i < count; ++i )
+			total += UploadSize( uploads[i] );
+		const uint32_t thread_count = options.min_bytes_per_thread && total / options.min_bytes_per_thread < options.thread_count ?
+			uint32_t( total / options.min_bytes_per_thread ) + 1 : options.thread_count;
+		SubresourceCopyOptions single_thread = options;
+		single_thread.thread_count = 1;
+		RunOnThreads( thread_count, [ & ] ( uint32_t thread )
+		{
+			const uint64_t first = total / thread_count * thread;
+			const uint64_t end = thread + 1 < thread_count ? total / thread_count * ( thread + 1 ) : total;
+			uint64_t start = 0;
+			for ( uint32_t i = 0; i < count && start < end; ++i )
+			{
+				const uint64_t size = UploadSize( uploads[i] );
+				if ( start >= first )
+					Fill( uploads[i], mapped, single_thread );
+				start += size;
+			}
+		} );
+	}
+}
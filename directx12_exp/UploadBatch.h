@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SubresourceCopy.h"
+#include "TextureFootprints.h"
+
+// many texture uploads as one: every subresource of every job is planned into storage the caller owns and reuses,
+// then all of them are copied into the mapped upload buffer in one pass spread over threads. Planning allocates
+// nothing, filling maps once. No d3d in here, UploadTextures in TextureUpload records the copies
+
+namespace DXLayer
+{
+	// one subresource of a batch: where it comes from, where it goes in the upload buffer
+	struct PlannedUpload
+	{
+		uint32_t job;				// the caller's index
+		uint32_t subresource;
+		TextureFootprint footprint;	// offset from the start of the upload buffer
+		SubresourceSource source;
+	};
+
+	class UploadPlanner
+	{
+	public:
+		// storage for capacity subresources, the plan starts at base_offset in the upload buffer
+		UploadPlanner( PlannedUpload* storage, uint32_t capacity, uint64_t base_offset );
+
+		// starts over, keeping the storage
+		void Reset( uint64_t base_offset );
+
+		// subresources [first_subresource, first_subresource + count) of a texture, from sources[count], or with the
+		// sources left for the caller to fill in when it's null. Each job starts at the next texture_placement_alignment.
+		// False and nothing planned when the storage is full or the layout isn't one GetTextureFootprints covers
+		bool Add( uint32_t job, const TextureLayoutDesc& desc, uint32_t first_subresource, uint32_t count, const SubresourceSource* sources );
+
+		const PlannedUpload* Uploads( ) const { return storage; }
+		uint32_t Count( ) const { return count; }
+		uint32_t Capacity( ) const { return capacity; }
+
+		// end of the last subresource from the start of the upload buffer
+		uint64_t End( ) const { return base_offset + size; }
+
+	private:
+		PlannedUpload* storage;
+		uint32_t capacity;
+		uint32_t count;
+		uint64_t base_offset;
+		uint64_t size;		// from base_offset
+	};
+
+	// copies every planned subresource into the upload buffer mapped at mapped. Subresources are shared out
+	// between options.thread_count threads by size, batches of fewer subresources than threads split each one
+	void FillUploads( const PlannedUpload* uploads, uint32_t count, uint8_t* mapped, const SubresourceCopyOptions& options = SubresourceCopyOptions( ) );
+}
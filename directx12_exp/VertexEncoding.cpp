@@ -0,0 +1,408 @@
+#include "VertexEncoding.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "Simd.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		template<typename T>
+		const T* Advance( const T* ptr, size_t stride, size_t count )
+		{
+			return reinterpret_cast<const T*>( reinterpret_cast<const uint8_t*>( ptr ) + stride * count );
+		}
+
+		template<typename T>
+		T* Advance( T* ptr, size_t stride, size_t count )
+		{
+			return reinterpret_cast<T*>( reinterpret_cast<uint8_t*>( ptr ) + stride * count );
+		}
+
+		// round half to even, what _mm_cvtps_epi32 does under the default rounding mode. The sse2 paths and the scalar
+		// ones compute the same values in the same order and round the same way, so they give the same bits
+		int32_t RoundToInt( float value )
+		{
+			return int32_t( std::nearbyint( value ) );
+		}
+
+		float DequantizeSnorm16( int16_t value )
+		{
+			// -32768 and -32767 both map to -1, same as the gpu
+			return std::max( float( value ) / 32767.0f, -1.0f );
+		}
+
+		void OctEncode( float x, float y, float z, float& u, float& v )
+		{
+			const float l1 = std::fabs( x ) + std::fabs( y ) + std::fabs( z );
+			if ( l1 <= 0.0f )
+			{
+				u = 0.0f;
+				v = 0.0f;
+				return;
+			}
+
+			u = x / l1;
+			v = y / l1;
+			if ( z < 0.0f )
+			{
+				// fold the lower hemisphere over the diagonals
+				const float fu = ( 1.0f - std::fabs( v ) ) * ( u >= 0.0f ? 1.0f : -1.0f );
+				const float fv = ( 1.0f - std::fabs( u ) ) * ( v >= 0.0f ? 1.0f : -1.0f );
+				u = fu;
+				v = fv;
+			}
+		}
+
+		void OctDecode( float u, float v, float* normal )
+		{
+			float x = u;
+			float y = v;
+			const float z = 1.0f - std::fabs( u ) - std::fabs( v );
+			if ( z < 0.0f )
+			{
+				x = ( 1.0f - std::fabs( v ) ) * ( u >= 0.0f ? 1.0f : -1.0f );
+				y = ( 1.0f - std::fabs( u ) ) * ( v >= 0.0f ? 1.0f : -1.0f );
+			}
+
+			const float length = std::sqrt( x * x + y * y + z * z );
+			normal[0] = x / length;
+			normal[1] = y / length;
+			normal[2] = z / length;
+		}
+
+#if DXL_SSE2
+		__m128 Abs( __m128 value )
+		{
+			return _mm_and_ps( value, _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) ) );
+		}
+
+		__m128 Select( __m128 mask, __m128 if_set, __m128 if_clear )
+		{
+			return _mm_or_ps( _mm_and_ps( mask, if_set ), _mm_andnot_ps( mask, if_clear ) );
+		}
+
+		// 1 for values >= 0, -1 otherwise, like the ternaries of OctEncode and OctDecode
+		__m128 SignOf( __m128 value )
+		{
+			return Select( _mm_cmpge_ps( value, _mm_setzero_ps( ) ), _mm_set1_ps( 1.0f ), _mm_set1_ps( -1.0f ) );
+		}
+
+		// exact for values that fit into an int
+		__m128 Floor( __m128 value )
+		{
+			const __m128 truncated = _mm_cvtepi32_ps( _mm_cvttps_epi32( value ) );
+			return _mm_sub_ps( truncated, _mm_and_ps( _mm_cmpgt_ps( truncated, value ), _mm_set1_ps( 1.0f ) ) );
+		}
+
+		// OctDecode of 4 dequantized candidates, dotted with the normals
+		__m128 OctDecodeDot( __m128 u, __m128 v, __m128 x, __m128 y, __m128 z )
+		{
+			const __m128 one = _mm_set1_ps( 1.0f );
+			const __m128 dz = _mm_sub_ps( _mm_sub_ps( one, Abs( u ) ), Abs( v ) );
+			const __m128 fold = _mm_cmplt_ps( dz, _mm_setzero_ps( ) );
+			const __m128 dx = Select( fold, _mm_mul_ps( _mm_sub_ps( one, Abs( v ) ), SignOf( u ) ), u );
+			const __m128 dy = Select( fold, _mm_mul_ps( _mm_sub_ps( one, Abs( u ) ), SignOf( v ) ), v );
+			const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ) );
+			return _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_div_ps( dx, length ), x ), _mm_mul_ps( _mm_div_ps( dy, length ), y ) ),
+							   _mm_mul_ps( _mm_div_ps( dz, length ), z ) );
+		}
+#endif
+	}
+
+	MeshBounds ComputeMeshBounds( const float* positions, size_t stride, size_t count )
+	{
+		float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for ( size_t i = 0; i < count; ++i )
+		{
+			const float* position = Advance( positions, stride, i );
+			for ( int c = 0; c < 3; ++c )
+			{
+				min[c] = std::min( min[c], position[c] );
+				max[c] = std::max( max[c], position[c] );
+			}
+		}
+
+		MeshBounds bounds;
+		for ( int c = 0; c < 3; ++c )
+		{
+			if ( count == 0 )
+				min[c] = max[c] = 0.0f;
+			bounds.center[c] = ( min[c] + max[c] ) * 0.5f;
+			bounds.extent[c] = std::max( ( max[c] - min[c] ) * 0.5f, FLT_MIN );
+		}
+		return bounds;
+	}
+
+	void EncodePositionsSnorm16( const float* positions, size_t stride, size_t count, const MeshBounds& bounds, int16_t* out, size_t out_stride )
+	{
+		size_t i = 0;
+
+#if DXL_SSE2
+		const __m128 center = _mm_setr_ps( bounds.center[0], bounds.center[1], bounds.center[2], 0.0f );
+		const __m128 scale = _mm_setr_ps( 32767.0f / bounds.extent[0], 32767.0f / bounds.extent[1], 32767.0f / bounds.extent[2], 0.0f );
+		const __m128 limit = _mm_set1_ps( 32767.0f );
+		const __m128 w_one = _mm_setr_ps( 0.0f, 0.0f, 0.0f, 32767.0f );
+		const __m128 xyz_mask = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) );
+
+		// a 16-byte load reads past the position, that's only safe while there's another vertex after it
+		const size_t wide_count = stride >= 4 * sizeof( float ) ? count : ( count > 0 ? count - 1 : 0 );
+		for ( ; i < wide_count; ++i )
+		{
+			// the 4th lane holds whatever follows the position, it may not even be a valid float
+			__m128 p = _mm_and_ps( _mm_loadu_ps( Advance( positions, stride, i ) ), xyz_mask );
+			p = _mm_mul_ps( _mm_sub_ps( p, center ), scale );
+			p = _mm_min_ps( _mm_max_ps( p, _mm_sub_ps( _mm_setzero_ps( ), limit ) ), limit );
+			p = _mm_add_ps( p, w_one );
+
+			const __m128i q = _mm_cvtps_epi32( p );
+			_mm_storel_epi64( reinterpret_cast<__m128i*>( Advance( out, out_stride, i ) ), _mm_packs_epi32( q, q ) );
+		}
+#endif
+
+		const float scales[3] = { 32767.0f / bounds.extent[0], 32767.0f / bounds.extent[1], 32767.0f / bounds.extent[2] };
+		for ( ; i < count; ++i )
+		{
+			const float* position = Advance( positions, stride, i );
+			int16_t* encoded = Advance( out, out_stride, i );
+			for ( int c = 0; c < 3; ++c )
+				encoded[c] = int16_t( RoundToInt( std::min( std::max( ( position[c] - bounds.center[c] ) * scales[c], -32767.0f ), 32767.0f ) ) );
+			encoded[3] = 32767;
+		}
+	}
+
+	void EncodePositionsHalf( const float* positions, size_t stride, size_t count, const MeshBounds& bounds, uint16_t* out, size_t out_stride )
+	{
+		for ( size_t i = 0; i < count; ++i )
+		{
+			const float* position = Advance( positions, stride, i );
+			uint16_t* encoded = Advance( out, out_stride, i );
+			for ( int c = 0; c < 3; ++c )
+				encoded[c] = FloatToHalf( ( position[c] - bounds.center[c] ) / bounds.extent[c] );
+			encoded[3] = 0x3c00; // 1.0
+		}
+	}
+
+	void EncodeNormalsOct16( const float* normals, size_t stride, size_t count, int16_t* out, size_t out_stride )
+	{
+		size_t i = 0;
+
+#if DXL_SSE2
+		// 4 normals at a time through the same steps as the scalar loop below
+		const __m128 zero = _mm_setzero_ps( );
+		const __m128 one = _mm_set1_ps( 1.0f );
+		const __m128 minus_one = _mm_set1_ps( -1.0f );
+		const __m128 limit = _mm_set1_ps( 32767.0f );
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			const float* n[4] = { Advance( normals, stride, i ), Advance( normals, stride, i + 1 ), Advance( normals, stride, i + 2 ),
+								  Advance( normals, stride, i + 3 ) };
+			const __m128 x = _mm_setr_ps( n[0][0], n[1][0], n[2][0], n[3][0] );
+			const __m128 y = _mm_setr_ps( n[0][1], n[1][1], n[2][1], n[3][1] );
+			const __m128 z = _mm_setr_ps( n[0][2], n[1][2], n[2][2], n[3][2] );
+
+			// OctEncode, zero normals end up at 0, 0
+			const __m128 l1 = _mm_add_ps( _mm_add_ps( Abs( x ), Abs( y ) ), Abs( z ) );
+			const __m128 nonzero = _mm_cmpgt_ps( l1, zero );
+			__m128 u = _mm_and_ps( _mm_div_ps( x, l1 ), nonzero );
+			__m128 v = _mm_and_ps( _mm_div_ps( y, l1 ), nonzero );
+			const __m128 fold = _mm_and_ps( _mm_cmplt_ps( z, zero ), nonzero );
+			const __m128 fu = _mm_mul_ps( _mm_sub_ps( one, Abs( v ) ), SignOf( u ) );
+			const __m128 fv = _mm_mul_ps( _mm_sub_ps( one, Abs( u ) ), SignOf( v ) );
+			u = Select( fold, fu, u );
+			v = Select( fold, fv, v );
+
+			const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+			const __m128 inv_length = _mm_and_ps( _mm_div_ps( one, length ), _mm_cmpgt_ps( length, zero ) );
+
+			const __m128 floor_u = Floor( _mm_mul_ps( _mm_min_ps( _mm_max_ps( u, minus_one ), one ), limit ) );
+			const __m128 floor_v = Floor( _mm_mul_ps( _mm_min_ps( _mm_max_ps( v, minus_one ), one ), limit ) );
+
+			__m128 best_dot = _mm_set1_ps( -2.0f );
+			__m128 best_u = zero;
+			__m128 best_v = zero;
+			for ( int candidate = 0; candidate < 4; ++candidate )
+			{
+				const __m128 cu = _mm_min_ps( _mm_add_ps( floor_u, _mm_set1_ps( float( candidate & 1 ) ) ), limit );
+				const __m128 cv = _mm_min_ps( _mm_add_ps( floor_v, _mm_set1_ps( float( candidate >> 1 ) ) ), limit );
+				const __m128 du = _mm_max_ps( _mm_div_ps( cu, limit ), minus_one );
+				const __m128 dv = _mm_max_ps( _mm_div_ps( cv, limit ), minus_one );
+				const __m128 dot = _mm_mul_ps( OctDecodeDot( du, dv, x, y, z ), inv_length );
+
+				const __m128 better = _mm_cmpgt_ps( dot, best_dot );
+				best_dot = Select( better, dot, best_dot );
+				best_u = Select( better, cu, best_u );
+				best_v = Select( better, cv, best_v );
+			}
+
+			int32_t encoded_u[4], encoded_v[4];
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( encoded_u ), _mm_cvttps_epi32( best_u ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( encoded_v ), _mm_cvttps_epi32( best_v ) );
+			for ( int lane = 0; lane < 4; ++lane )
+			{
+				int16_t* encoded = Advance( out, out_stride, i + lane );
+				encoded[0] = int16_t( encoded_u[lane] );
+				encoded[1] = int16_t( encoded_v[lane] );
+			}
+		}
+#endif
+
+		for ( ; i < count; ++i )
+		{
+			const float* normal = Advance( normals, stride, i );
+			int16_t* encoded = Advance( out, out_stride, i );
+
+			float u, v;
+			OctEncode( normal[0], normal[1], normal[2], u, v );
+
+			// rounding to nearest isn't the best choice on the octahedron, try all 4 neighbours
+			const float length = std::sqrt( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+			const float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+
+			const float fu = std::floor( std::min( std::max( u, -1.0f ), 1.0f ) * 32767.0f );
+			const float fv = std::floor( std::min( std::max( v, -1.0f ), 1.0f ) * 32767.0f );
+
+			float best_dot = -2.0f;
+			for ( int candidate = 0; candidate < 4; ++candidate )
+			{
+				const float cu = std::min( fu + float( candidate & 1 ), 32767.0f );
+				const float cv = std::min( fv + float( candidate >> 1 ), 32767.0f );
+				const int16_t qu = int16_t( cu );
+				const int16_t qv = int16_t( cv );
+
+				float decoded[3];
+				OctDecode( DequantizeSnorm16( qu ), DequantizeSnorm16( qv ), decoded );
+				const float dot = ( decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2] ) * inv_length;
+				if ( dot > best_dot )
+				{
+					best_dot = dot;
+					encoded[0] = qu;
+					encoded[1] = qv;
+				}
+			}
+		}
+	}
+
+	void EncodeColorsUnorm8( const float* colors, size_t stride, size_t count, uint8_t* out, size_t out_stride )
+	{
+		size_t i = 0;
+
+#if DXL_SSE2
+		const __m128 scale = _mm_set1_ps( 255.0f );
+		const __m128 one = _mm_set1_ps( 1.0f );
+		for ( ; i < count; ++i )
+		{
+			__m128 c = _mm_loadu_ps( Advance( colors, stride, i ) );
+			c = _mm_mul_ps( _mm_min_ps( _mm_max_ps( c, _mm_setzero_ps( ) ), one ), scale );
+
+			const __m128i q = _mm_cvtps_epi32( c );
+			const __m128i q16 = _mm_packs_epi32( q, q );
+			const int packed = _mm_cvtsi128_si32( _mm_packus_epi16( q16, q16 ) );
+			std::memcpy( Advance( out, out_stride, i ), &packed, 4 );
+		}
+#endif
+
+		for ( ; i < count; ++i )
+		{
+			const float* color = Advance( colors, stride, i );
+			uint8_t* encoded = Advance( out, out_stride, i );
+			for ( int c = 0; c < 4; ++c )
+				encoded[c] = uint8_t( RoundToInt( std::min( std::max( color[c], 0.0f ), 1.0f ) * 255.0f ) );
+		}
+	}
+
+	void DecodePositionSnorm16( const int16_t* in, const MeshBounds& bounds, float* position )
+	{
+		for ( int c = 0; c < 3; ++c )
+			position[c] = bounds.center[c] + DequantizeSnorm16( in[c] ) * bounds.extent[c];
+	}
+
+	void DecodePositionHalf( const uint16_t* in, const MeshBounds& bounds, float* position )
+	{
+		for ( int c = 0; c < 3; ++c )
+			position[c] = bounds.center[c] + HalfToFloat( in[c] ) * bounds.extent[c];
+	}
+
+	void DecodeNormalOct16( const int16_t* in, float* normal )
+	{
+		OctDecode( DequantizeSnorm16( in[0] ), DequantizeSnorm16( in[1] ), normal );
+	}
+
+	void DecodeColorUnorm8( const uint8_t* in, float* color )
+	{
+		for ( int c = 0; c < 4; ++c )
+			color[c] = float( in[c] ) / 255.0f;
+	}
+
+	uint16_t FloatToHalf( float value )
+	{
+		uint32_t bits;
+		std::memcpy( &bits, &value, 4 );
+
+		const uint32_t sign = ( bits >> 16 ) & 0x8000;
+		const uint32_t abs_bits = bits & 0x7fffffff;
+
+		if ( abs_bits >= 0x7f800000 ) // inf or nan
+			return uint16_t( sign | 0x7c00 | ( abs_bits > 0x7f800000 ? 0x200 : 0 ) );
+
+		if ( abs_bits >= 0x477ff000 ) // rounds to above the largest half
+			return uint16_t( sign | 0x7c00 );
+
+		if ( abs_bits < 0x38800000 ) // half denormal or zero
+		{
+			if ( abs_bits < 0x33000000 )
+				return uint16_t( sign );
+
+			const uint32_t mantissa = ( abs_bits & 0x7fffff ) | 0x800000;
+			const uint32_t shift = 126 - ( abs_bits >> 23 ); // 14 + 127 - exponent - 1
+			uint32_t result = mantissa >> shift;
+			// round to nearest even
+			const uint32_t remainder = mantissa & ( ( 1u << shift ) - 1 );
+			const uint32_t halfway = 1u << ( shift - 1 );
+			if ( remainder > halfway || ( remainder == halfway && ( result & 1 ) ) )
+				result++;
+			return uint16_t( sign | result );
+		}
+
+		// normal, rebias the exponent and round the mantissa to nearest even
+		uint32_t result = abs_bits - 0x38000000;
+		result += 0xfff + ( ( result >> 13 ) & 1 );
+		return uint16_t( sign | ( result >> 13 ) );
+	}
+
+	float HalfToFloat( uint16_t value )
+	{
+		const uint32_t sign = uint32_t( value & 0x8000 ) << 16;
+		uint32_t exponent = ( value >> 10 ) & 0x1f;
+		uint32_t mantissa = value & 0x3ff;
+
+		uint32_t bits;
+		if ( exponent == 0x1f )
+			bits = sign | 0x7f800000 | ( mantissa << 13 );
+		else if ( exponent != 0 )
+			bits = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+		else if ( mantissa == 0 )
+			bits = sign;
+		else
+		{
+			// denormal, normalize it
+			exponent = 113;
+			while ( !( mantissa & 0x400 ) )
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | ( exponent << 23 ) | ( ( mantissa & 0x3ff ) << 13 );
+		}
+
+		float result;
+		std::memcpy( &result, &bits, 4 );
+		return result;
+	}
+}
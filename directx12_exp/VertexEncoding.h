@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// converts authored float vertex attributes into compact gpu formats:
+//	position	R16G16B16A16_SNORM relative to the mesh bounds (or R16G16B16A16_FLOAT), 8 bytes instead of 12
+//	normal		octahedral R16G16_SNORM, 4 bytes instead of 12
+//	color		R8G8B8A8_UNORM, 4 bytes instead of 16
+// decoding happens in the shader, see vertex_decode.hlsli. Rounding is to nearest even on every path, so the sse2
+// encoders and the scalar ones give the same bits.
+// All encoders take strided input and output, so they can read straight from authored vertex structs
+// and write straight into interleaved compact vertices
+
+namespace DXLayer
+{
+	struct MeshBounds
+	{
+		float center[3];
+		float extent[3]; // half size, never zero so it can be divided by
+	};
+
+	MeshBounds ComputeMeshBounds( const float* positions, size_t stride, size_t count );
+
+	// w is set to 1.0 so the attribute can be read as float4
+	void EncodePositionsSnorm16( const float* positions, size_t stride, size_t count, const MeshBounds& bounds, int16_t* out, size_t out_stride );
+
+	// half floats of the bounds-relative position, less precise near the bounds edges but friendlier to huge meshes with small details near the center
+	void EncodePositionsHalf( const float* positions, size_t stride, size_t count, const MeshBounds& bounds, uint16_t* out, size_t out_stride );
+
+	// normals don't have to be normalized
+	void EncodeNormalsOct16( const float* normals, size_t stride, size_t count, int16_t* out, size_t out_stride );
+
+	// components are clamped to [0, 1]
+	void EncodeColorsUnorm8( const float* colors, size_t stride, size_t count, uint8_t* out, size_t out_stride );
+
+	// reference decoders, match the shader side. Mostly useful to measure encoding error
+
+	void DecodePositionSnorm16( const int16_t* in, const MeshBounds& bounds, float* position );
+	void DecodePositionHalf( const uint16_t* in, const MeshBounds& bounds, float* position );
+	void DecodeNormalOct16( const int16_t* in, float* normal );
+	void DecodeColorUnorm8( const uint8_t* in, float* color );
+
+	uint16_t FloatToHalf( float value );
+	float HalfToFloat( uint16_t value );
+}
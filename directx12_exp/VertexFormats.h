@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VertexEncoding.h"
+#include "VertexLayout.h"
+
+// compact vertex formats the gpu reads. They are produced from authored float vertices
+// by the encoders in VertexEncoding.h and decoded in vertex_decode.hlsli
+
+namespace DXLayer
+{
+	// 12 bytes, position and color only
+	struct CompactVertex
+	{
+		int16_t pos[4];		// snorm, relative to the mesh bounds, w = 1
+		uint8_t color[4];	// unorm
+	};
+
+	typedef VertexLayout<CompactVertex,
+		DXL_VERTEX_ATTRIBUTE_FORMAT( CompactVertex, pos, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+		DXL_VERTEX_ATTRIBUTE_FORMAT( CompactVertex, color, COLOR, 0, vertex_format_r8g8b8a8_unorm )> CompactVertexInputLayout;
+
+	// 16 bytes, for lit meshes
+	struct CompactVertexNormal
+	{
+		int16_t pos[4];		// snorm, relative to the mesh bounds, w = 1
+		int16_t normal[2];	// octahedral, snorm
+		uint8_t color[4];	// unorm
+	};
+
+	typedef VertexLayout<CompactVertexNormal,
+		DXL_VERTEX_ATTRIBUTE_FORMAT( CompactVertexNormal, pos, POSITION, 0, vertex_format_r16g16b16a16_snorm ),
+		DXL_VERTEX_ATTRIBUTE_FORMAT( CompactVertexNormal, normal, NORMAL, 0, vertex_format_r16g16_snorm ),
+		DXL_VERTEX_ATTRIBUTE_FORMAT( CompactVertexNormal, color, COLOR, 0, vertex_format_r8g8b8a8_unorm )> CompactVertexNormalInputLayout;
+
+	// the normal makes it a different layout, psos for the two must never be shared
+	static_assert( CompactVertexInputLayout::Hash( ) != CompactVertexNormalInputLayout::Hash( ), "compact vertex layouts hash equal" );
+}
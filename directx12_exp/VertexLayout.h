@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <d3d12.h>
+#endif
+
+#include "Hash.h"
+#include "MathTypes.h"
+
+// compile-time input layouts. A vertex struct is described once by listing its members,
+// offsets, formats and strides are derived from the struct itself:
+//
+//	typedef VertexLayout<Vertex,
+//		DXL_VERTEX_ATTRIBUTE( Vertex, pos, POSITION, 0 ),
+//		DXL_VERTEX_ATTRIBUTE( Vertex, color, COLOR, 0 )> VertexInputLayout;
+//
+//	pso_desc.InputLayout = VertexInputLayout::Desc( );
+//
+// Only Elements( ) and Desc( ) need d3d, the layouts and their checks build anywhere
+
+namespace DXLayer
+{
+	// the values of DXGI_FORMAT for what the input assembler reads vertices as
+	enum VertexFormat : uint32_t
+	{
+		vertex_format_r32g32b32a32_float = 2,
+		vertex_format_r32g32b32a32_uint = 3,
+		vertex_format_r32g32b32_float = 6,
+		vertex_format_r32g32b32_uint = 7,
+		vertex_format_r16g16b16a16_float = 10,
+		vertex_format_r16g16b16a16_unorm = 11,
+		vertex_format_r16g16b16a16_uint = 12,
+		vertex_format_r16g16b16a16_snorm = 13,
+		vertex_format_r32g32_float = 16,
+		vertex_format_r32g32_uint = 17,
+		vertex_format_r10g10b10a2_unorm = 24,
+		vertex_format_r8g8b8a8_unorm = 28,
+		vertex_format_r8g8b8a8_uint = 30,
+		vertex_format_r8g8b8a8_snorm = 31,
+		vertex_format_r16g16_float = 34,
+		vertex_format_r16g16_unorm = 35,
+		vertex_format_r16g16_uint = 36,
+		vertex_format_r16g16_snorm = 37,
+		vertex_format_r32_float = 41,
+		vertex_format_r32_uint = 42,
+		vertex_format_r8g8_unorm = 49,
+		vertex_format_r8g8_snorm = 51,
+		vertex_format_r16_float = 54,
+		vertex_format_r16_uint = 57,
+		vertex_format_b8g8r8a8_unorm = 87
+	};
+
+	// bytes of one element of a DXGI_FORMAT, 0 for formats vertices can't be read as
+	constexpr uint32_t VertexFormatSize( uint32_t format )
+	{
+		return format == 0 ? 0 : format <= 4 ? 16 : format <= 8 ? 12 : format <= 22 ? 8 : format <= 47 ? 4 : format <= 59 ? 2 :
+			format <= 65 ? 1 : format == 87 || format == 88 ? 4 : 0;
+	}
+
+	// maps a member type to the format the input assembler reads it as.
+	// Types that can be read in several ways (packed integers) should be wrapped in a distinct struct
+	template<typename T> struct VertexFormatOf; // intentionally undefined, add a specialization for new member types
+
+	template<> struct VertexFormatOf<float> { static const uint32_t value = vertex_format_r32_float; };
+	template<> struct VertexFormatOf<DirectX::XMFLOAT2> { static const uint32_t value = vertex_format_r32g32_float; };
+	template<> struct VertexFormatOf<DirectX::XMFLOAT3> { static const uint32_t value = vertex_format_r32g32b32_float; };
+	template<> struct VertexFormatOf<DirectX::XMFLOAT4> { static const uint32_t value = vertex_format_r32g32b32a32_float; };
+	template<> struct VertexFormatOf<DirectX::XMUINT2> { static const uint32_t value = vertex_format_r32g32_uint; };
+	template<> struct VertexFormatOf<DirectX::XMUINT4> { static const uint32_t value = vertex_format_r32g32b32a32_uint; };
+	template<> struct VertexFormatOf<uint32_t> { static const uint32_t value = vertex_format_r32_uint; };
+
+	// the per-vertex part of D3D12_INPUT_ELEMENT_DESC
+	struct VertexElement
+	{
+		const char* semantic;
+		uint32_t semantic_index;
+		uint32_t format;
+		uint32_t offset;
+	};
+
+	// semantic names have to be types to be usable as template arguments
+#define DXL_VERTEX_SEMANTIC( semantic ) \
+	struct VertexSemantic_##semantic { static constexpr const char* Name( ) { return #semantic; } }
+
+	DXL_VERTEX_SEMANTIC( POSITION );
+	DXL_VERTEX_SEMANTIC( NORMAL );
+	DXL_VERTEX_SEMANTIC( TANGENT );
+	DXL_VERTEX_SEMANTIC( COLOR );
+	DXL_VERTEX_SEMANTIC( TEXCOORD );
+
+	template<typename Semantic, uint32_t SemanticIndex, uint32_t Offset, uint32_t Format, uint32_t Size>
+	struct VertexAttribute
+	{
+		static const uint32_t offset = Offset;
+		static const uint32_t size = Size;
+
+		// a format wider or narrower than its member reads the neighbors or leaves bytes out
+		static_assert( VertexFormatSize( Format ) == Size, "vertex format doesn't match the size of the member" );
+
+		// IA fetches are dword-granular for everything but 1 and 2 byte formats
+		static_assert( Offset % ( Size < 4 ? Size : 4 ) == 0, "vertex attribute is misaligned" );
+
+		static constexpr VertexElement Describe( )
+		{
+			return VertexElement{ Semantic::Name( ), SemanticIndex, Format, Offset };
+		}
+
+#ifdef _WIN32
+		static D3D12_INPUT_ELEMENT_DESC Element( )
+		{
+			D3D12_INPUT_ELEMENT_DESC element = { Semantic::Name( ), SemanticIndex, DXGI_FORMAT( Format ), 0, Offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+			return element;
+		}
+#endif
+
+		static constexpr uint64_t Hash( uint64_t hash )
+		{
+			return Fnv1a64Int( Offset, 4, Fnv1a64Int( Format, 4, Fnv1a64Int( SemanticIndex, 4, Fnv1a64Str( Semantic::Name( ), hash ) ) ) );
+		}
+	};
+
+	// format is deduced from the member type
+#define DXL_VERTEX_ATTRIBUTE( vertex, member, semantic, semantic_index ) \
+	DXLayer::VertexAttribute<DXLayer::VertexSemantic_##semantic, semantic_index, offsetof( vertex, member ), \
+		DXLayer::VertexFormatOf<decltype( vertex::member )>::value, sizeof( decltype( vertex::member ) )>
+
+	// same, for members whose type doesn't determine the format. The format has to be as large as the member
+#define DXL_VERTEX_ATTRIBUTE_FORMAT( vertex, member, semantic, semantic_index, format ) \
+	DXLayer::VertexAttribute<DXLayer::VertexSemantic_##semantic, semantic_index, offsetof( vertex, member ), \
+		format, sizeof( decltype( vertex::member ) )>
+
+	namespace detail
+	{
+		// constexpr functions are limited to a single return statement on our compiler,
+		// so checks over the attribute list are done with template recursion
+		template<typename... Attributes>
+		struct AttributeList
+		{
+			static constexpr uint32_t TotalSize( ) { return 0; }
+			static constexpr bool Sorted( uint32_t ) { return true; }
+			static constexpr uint64_t Hash( uint64_t hash ) { return hash; }
+		};
+
+		template<typename First, typename... Rest>
+		struct AttributeList<First, Rest...>
+		{
+			static constexpr uint32_t TotalSize( ) { return First::size + AttributeList<Rest...>::TotalSize( ); }
+
+			// every attribute starts after the end of the previous one
+			static constexpr bool Sorted( uint32_t prev_end ) { return First::offset >= prev_end && AttributeList<Rest...>::Sorted( First::offset + First::size ); }
+
+			static constexpr uint64_t Hash( uint64_t hash ) { return AttributeList<Rest...>::Hash( First::Hash( hash ) ); }
+		};
+	}
+
+	template<typename Vertex, typename... Attributes>
+	struct VertexLayout
+	{
+		typedef detail::AttributeList<Attributes...> List;
+
+		static const uint32_t num_elements = sizeof...( Attributes );
+		static const uint32_t stride = sizeof( Vertex );
+
+		static_assert( sizeof...( Attributes ) > 0, "empty vertex layout" );
+		static_assert( List::Sorted( 0 ), "vertex attributes overlap or are not listed in memory order" );
+		static_assert( List::TotalSize( ) <= sizeof( Vertex ), "vertex attributes exceed the vertex size" );
+		static_assert( List::TotalSize( ) == sizeof( Vertex ), "vertex struct has padding or unlisted members, every byte is fetched by the gpu" );
+
+		// the input layout part of PipelineStateRegistry keys, so psos are looked up without hashing the element
+		// array at runtime. Layouts of different structs with the same members hash equal and share psos
+		static constexpr uint64_t Hash( )
+		{
+			return Fnv1a64Int( sizeof( Vertex ), 4, List::Hash( fnv_offset_basis ) );
+		}
+
+		static const VertexElement* VertexElements( )
+		{
+			static const VertexElement elements[] = { Attributes::Describe( )... };
+			return elements;
+		}
+
+#ifdef _WIN32
+		static const D3D12_INPUT_ELEMENT_DESC* Elements( )
+		{
+			static const D3D12_INPUT_ELEMENT_DESC elements[] = { Attributes::Element( )... };
+			return elements;
+		}
+
+		static D3D12_INPUT_LAYOUT_DESC Desc( )
+		{
+			D3D12_INPUT_LAYOUT_DESC desc = { Elements( ), num_elements };
+			return desc;
+		}
+#endif
+	};
+}
@@ -0,0 +1,298 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "TextureFootprints.h"
+
+namespace DXLayer
+{
+	namespace
+	{
+		const uint32_t no_tile = VirtualTexture::invalid_pool_tile;
+
+		// the standard 64 KB tile shapes in elements, blocks for compressed formats, by bits per element
+		bool StandardTileShape( uint32_t element_bits, uint32_t& width, uint32_t& height )
+		{
+			switch ( element_bits )
+			{
+			case 8: width = 256; height = 256; return true;
+			case 16: width = 256; height = 128; return true;
+			case 32: width = 128; height = 128; return true;
+			case 64: width = 128; height = 64; return true;
+			case 128: width = 64; height = 64; return true;
+			default: return false;
+			}
+		}
+	}
+
+	bool StandardVirtualTextureLayout( uint32_t format, uint32_t width, uint32_t height, uint32_t mip_levels, VirtualTextureLayout& layout )
+	{
+		std::memset( &layout, 0, sizeof( layout ) );
+		TextureFormatInfo info;
+		uint32_t shape_width, shape_height, subresource_count;
+		TextureLayoutDesc resolved;
+		if ( !GetTextureFormatInfo( format, info ) || info.plane_count != 1 || !StandardTileShape( info.planes[0].block_bytes * 8, shape_width, shape_height ) ||
+			!ResolveTextureLayout( { texture_2d, width, height, 1, mip_levels, format }, resolved, subresource_count ) || resolved.mip_levels > virtual_texture_max_mips )
+			return false;
+
+		layout.tile_width = shape_width * info.block_width;
+		layout.tile_height = shape_height * info.block_height;
+		uint64_t packed_bytes = 0;
+		for ( uint32_t mip = 0; mip < resolved.mip_levels; ++mip )
+		{
+			const uint32_t mip_width = width >> mip ? width >> mip : 1;
+			const uint32_t mip_height = height >> mip ? height >> mip : 1;
+			if ( layout.packed_mip_count == 0 && mip_width >= layout.tile_width && mip_height >= layout.tile_height )
+			{
+				layout.width_in_tiles[mip] = ( mip_width + layout.tile_width - 1 ) / layout.tile_width;
+				layout.height_in_tiles[mip] = ( mip_height + layout.tile_height - 1 ) / layout.tile_height;
+				++layout.mip_count;
+			}
+			else
+			{
+				packed_bytes += uint64_t( ( mip_width + info.block_width - 1 ) / info.block_width ) * ( ( mip_height + info.block_height - 1 ) / info.block_height ) * info.planes[0].block_bytes;
+				++layout.packed_mip_count;
+			}
+		}
+		layout.packed_tile_count = uint32_t( ( packed_bytes + virtual_tile_bytes - 1 ) / virtual_tile_bytes );
+		return layout.width_in_tiles[0] <= virtual_texture_max_tiles && layout.height_in_tiles[0] <= virtual_texture_max_tiles;
+	}
+
+	const uint32_t VirtualTexture::invalid_pool_tile;
+
+	VirtualTexture::VirtualTexture( )
+		: layout( ), oldest( no_tile ), newest( no_tile ), frame( 1 ), stats( )
+	{ }
+
+	bool VirtualTexture::Init( const VirtualTextureLayout& layout, uint32_t pool_tile_count )
+	{
+		if ( layout.mip_count > virtual_texture_max_mips || pool_tile_count < layout.packed_tile_count )
+			return false;
+		uint32_t page_count = 0;
+		for ( uint32_t mip = 0; mip < layout.mip_count; ++mip )
+		{
+			if ( layout.width_in_tiles[mip] > virtual_texture_max_tiles || layout.height_in_tiles[mip] > virtual_texture_max_tiles )
+				return false;
+			first_page[mip] = page_count;
+			page_count += layout.width_in_tiles[mip] * layout.height_in_tiles[mip];
+		}
+
+		this->layout = layout;
+		page_tiles.assign( page_count, no_tile );
+		requested_frame.assign( page_count, 0 );
+		resident_children.assign( page_count, 0 );
+		tiles.assign( pool_tile_count, Tile{ invalid_virtual_page, no_tile, no_tile } );
+		free_tiles.clear( );
+		for ( uint32_t tile = layout.packed_tile_count; tile < pool_tile_count; ++tile )
+			free_tiles.push_back( tile );
+		std::make_heap( free_tiles.begin( ), free_tiles.end( ), std::greater<uint32_t>( ) );
+		requested.clear( );
+		oldest = newest = no_tile;
+		frame = 1;
+		stats = VirtualTextureStats( );
+		return true;
+	}
+
+	void VirtualTexture::AddFeedback( const uint32_t* pages, size_t count )
+	{
+		for ( size_t i = 0; i < count; ++i )
+		{
+			// the mips above were asked for with the first page under them
+			for ( uint32_t page = pages[i]; page != invalid_virtual_page; page = Parent( page ) )
+			{
+				const uint32_t index = PageIndex( page );
+				if ( index == invalid_virtual_page || requested_frame[index] == frame )
+					break;
+				requested_frame[index] = frame;
+				requested.push_back( page );
+			}
+		}
+	}
+
+	void VirtualTexture::Update( uint32_t map_budget, std::vector<VirtualTileUpdate>& updates )
+	{
+		updates.clear( );
+		stats.requested = uint32_t( requested.size( ) );
+		stats.hits = stats.mapped = stats.evicted = stats.waiting = 0;
+
+		// finest mips first in key order, so touching the requested pages leaves each parent newer than the pages
+		// under it, and eviction gets to children first
+		std::sort( requested.begin( ), requested.end( ) );
+		Touch( requested );
+
+		// coarsest mip first, a page needs the one above it. Within a mip in tile order, which the free tiles follow
+		auto mip_end = requested.end( );
+		while ( mip_end != requested.begin( ) )
+		{
+			const uint32_t mip = VirtualPageMip( *( mip_end - 1 ) );
+			auto mip_begin = std::lower_bound( requested.begin( ), mip_end, VirtualPageKey( mip, 0, 0 ) );
+			for ( auto page = mip_begin; page != mip_end; ++page )
+			{
+				const uint32_t index = PageIndex( *page );
+				if ( page_tiles[index] != no_tile )
+				{
+					++stats.hits;
+					continue;
+				}
+				const uint32_t parent = Parent( *page );
+				if ( stats.mapped == map_budget || ( parent != invalid_virtual_page && page_tiles[PageIndex( parent )] == no_tile ) )
+				{
+					++stats.waiting;
+					continue;
+				}
+				const uint32_t tile = TakeTile( updates );
+				if ( tile == no_tile )
+				{
+					++stats.waiting;
+					continue;
+				}
+				page_tiles[index] = tile;
+				tiles[tile].page = *page;
+				PushNewest( tile );
+				if ( parent != invalid_virtual_page )
+					++resident_children[PageIndex( parent )];
+				updates.push_back( VirtualTileUpdate{ *page, tile } );
+				++stats.mapped;
+			}
+			mip_end = mip_begin;
+		}
+
+		// again for the pages mapped just now, which went in newest
+		Touch( requested );
+		stats.resident = uint32_t( tiles.size( ) ) - layout.packed_tile_count - uint32_t( free_tiles.size( ) );
+		requested.clear( );
+		++frame;
+	}
+
+	uint32_t VirtualTexture::PoolTile( uint32_t page ) const
+	{
+		const uint32_t index = PageIndex( page );
+		return index == invalid_virtual_page ? no_tile : page_tiles[index];
+	}
+
+	void VirtualTexture::MinMipMap( uint8_t* map ) const
+	{
+		const uint32_t width = layout.mip_count ? layout.width_in_tiles[0] : 0, height = layout.mip_count ? layout.height_in_tiles[0] : 0;
+		for ( uint32_t y = 0; y < height; ++y )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				// resident pages always have their parents, so it's the first page up the chain that is resident
+				uint32_t mip = 0;
+				for ( uint32_t page = VirtualPageKey( 0, x, y ); page != invalid_virtual_page && PoolTile( page ) == no_tile; page = Parent( page ) )
+					++mip;
+				map[y * width + x] = uint8_t( mip );
+			}
+		}
+	}
+
+	uint32_t VirtualTexture::PageIndex( uint32_t page ) const
+	{
+		const uint32_t mip = VirtualPageMip( page ), x = VirtualPageX( page ), y = VirtualPageY( page );
+		if ( page == invalid_virtual_page || mip >= layout.mip_count || x >= layout.width_in_tiles[mip] || y >= layout.height_in_tiles[mip] )
+			return invalid_virtual_page;
+		return first_page[mip] + y * layout.width_in_tiles[mip] + x;
+	}
+
+	// the page of the next mip over the same texels. Tiles are the same size in texels at every mip
+	uint32_t VirtualTexture::Parent( uint32_t page ) const
+	{
+		const uint32_t mip = VirtualPageMip( page ) + 1;
+		if ( mip >= layout.mip_count )
+			return invalid_virtual_page;
+		return VirtualPageKey( mip, std::min( VirtualPageX( page ) >> 1, layout.width_in_tiles[mip] - 1 ), std::min( VirtualPageY( page ) >> 1, layout.height_in_tiles[mip] - 1 ) );
+	}
+
+	void VirtualTexture::Unlink( uint32_t tile )
+	{
+		Tile& entry = tiles[tile];
+		( entry.older != no_tile ? tiles[entry.older].newer : oldest ) = entry.newer;
+		( entry.newer != no_tile ? tiles[entry.newer].older : newest ) = entry.older;
+		entry.older = entry.newer = no_tile;
+	}
+
+	void VirtualTexture::PushNewest( uint32_t tile )
+	{
+		tiles[tile].older = newest;
+		tiles[tile].newer = no_tile;
+		( newest != no_tile ? tiles[newest].newer : oldest ) = tile;
+		newest = tile;
+	}
+
+	void VirtualTexture::Touch( const std::vector<uint32_t>& pages )
+	{
+		for ( uint32_t page : pages )
+		{
+			const uint32_t tile = page_tiles[PageIndex( page )];
+			if ( tile != no_tile && tile != newest )
+			{
+				Unlink( tile );
+				PushNewest( tile );
+			}
+		}
+	}
+
+	// a free tile, or the tile of the least recently requested page, which is unmapped. None when every resident
+	// page was requested this frame
+	uint32_t VirtualTexture::TakeTile( std::vector<VirtualTileUpdate>& updates )
+	{
+		if ( !free_tiles.empty( ) )
+		{
+			std::pop_heap( free_tiles.begin( ), free_tiles.end( ), std::greater<uint32_t>( ) );
+			const uint32_t tile = free_tiles.back( );
+			free_tiles.pop_back( );
+			return tile;
+		}
+
+		if ( oldest == no_tile )
+			return no_tile;
+		const uint32_t tile = oldest;
+		const uint32_t page = tiles[tile].page;
+		const uint32_t index = PageIndex( page );
+		if ( requested_frame[index] == frame || resident_children[index] )
+			return no_tile;
+
+		Unlink( tile );
+		page_tiles[index] = no_tile;
+		tiles[tile].page = invalid_virtual_page;
+		const uint32_t parent = Parent( page );
+		if ( parent != invalid_virtual_page )
+			--resident_children[PageIndex( parent )];
+		updates.push_back( VirtualTileUpdate{ page, no_tile } );
+		++stats.evicted;
+		return tile;
+	}
+
+	void BuildTileRuns( const VirtualTextureLayout& layout, const std::vector<VirtualTileUpdate>& updates, std::vector<VirtualTileRun>& runs )
+	{
+		runs.clear( );
+		std::vector<VirtualTileUpdate> sorted( updates );
+		std::sort( sorted.begin( ), sorted.end( ), [ ] ( const VirtualTileUpdate& a, const VirtualTileUpdate& b ) { return a.page < b.page; } );
+
+		uint32_t last_page = invalid_virtual_page;
+		for ( const VirtualTileUpdate& update : sorted )
+		{
+			const uint32_t mip = VirtualPageMip( update.page ), x = VirtualPageX( update.page ), y = VirtualPageY( update.page );
+			if ( !runs.empty( ) )
+			{
+				// the next tile of the same mip, along the row or at the start of the next one
+				VirtualTileRun& run = runs.back( );
+				const bool next_tile = VirtualPageMip( last_page ) == mip &&
+					( ( VirtualPageY( last_page ) == y && VirtualPageX( last_page ) + 1 == x ) ||
+					( VirtualPageY( last_page ) + 1 == y && x == 0 && VirtualPageX( last_page ) + 1 == layout.width_in_tiles[mip] ) );
+				const bool next_pool_tile = run.pool_tile == VirtualTexture::invalid_pool_tile ? update.pool_tile == VirtualTexture::invalid_pool_tile :
+					update.pool_tile == run.pool_tile + run.tile_count;
+				if ( next_tile && next_pool_tile )
+				{
+					++run.tile_count;
+					last_page = update.page;
+					continue;
+				}
+			}
+			runs.push_back( VirtualTileRun{ mip, x, y, 1, update.pool_tile } );
+			last_page = update.page;
+		}
+	}
+}
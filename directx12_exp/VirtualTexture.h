@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// residency of a virtual texture: a reserved resource whose 64 KB tiles are backed by a pool heap much smaller
+// than the texture, holding only the pages the last frames sampled. A feedback pass writes the pages it wanted,
+// the least recently wanted pages make room for them, and the mapping changes of a frame go to the gpu as one
+// UpdateTileMappings call. Pages are only mapped after the mip above them, so sampling can always fall back to
+// a coarser mip that is there. No d3d in here, VirtualTextureResources owns the reserved resource and the tile
+// pool heap and applies the updates planned here
+
+namespace DXLayer
+{
+	const uint32_t virtual_texture_max_mips = 16;
+	const uint32_t virtual_texture_max_tiles = 4096;	// tiles across a mip, what fits the page key
+	const uint32_t virtual_tile_bytes = 65536;			// D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES
+	const uint32_t invalid_virtual_page = ~0u;
+
+	// a tile of a standard mip as feedback and updates name it: x in the low 12 bits, y in the next 12, the mip above
+	inline uint32_t VirtualPageKey( uint32_t mip, uint32_t x, uint32_t y ) { return mip << 24 | y << 12 | x; }
+	inline uint32_t VirtualPageMip( uint32_t page ) { return page >> 24; }
+	inline uint32_t VirtualPageX( uint32_t page ) { return page & 0xfff; }
+	inline uint32_t VirtualPageY( uint32_t page ) { return page >> 12 & 0xfff; }
+
+	// how the reserved resource splits into tiles, what GetResourceTiling reports
+	struct VirtualTextureLayout
+	{
+		uint32_t mip_count;			// standard mips, mapped a tile at a time
+		uint32_t width_in_tiles[virtual_texture_max_mips];
+		uint32_t height_in_tiles[virtual_texture_max_mips];
+		uint32_t tile_width;		// in texels
+		uint32_t tile_height;
+		uint32_t packed_mip_count;	// the small mips after the standard ones, mapped together and for good
+		uint32_t packed_tile_count;
+	};
+
+	// the layout of a 2d texture in the standard 64 KB tile shapes, for planning without a device. Mips smaller
+	// than a tile either way are packed, which is what drivers do at the lowest tiled resources tier. False for
+	// formats without a standard shape, like planar and 96 bit ones, or more tiles across than a page key holds
+	bool StandardVirtualTextureLayout( uint32_t format, uint32_t width, uint32_t height, uint32_t mip_levels, VirtualTextureLayout& layout );
+
+	// a page's mapping changes: its data goes to pool_tile, or it's unmapped when pool_tile is invalid_pool_tile
+	struct VirtualTileUpdate
+	{
+		uint32_t page;
+		uint32_t pool_tile;
+	};
+
+	// tile_count pages of one mip from x, y on in the order UpdateTileMappings walks a region without a box, row
+	// after row. Mapped to as many pool tiles from pool_tile on, or all unmapped
+	struct VirtualTileRun
+	{
+		uint32_t mip;
+		uint32_t x;
+		uint32_t y;
+		uint32_t tile_count;
+		uint32_t pool_tile;
+	};
+
+	struct VirtualTextureStats
+	{
+		uint32_t requested;		// distinct pages of the last feedback, with the mips above them
+		uint32_t hits;			// of those, resident before the update
+		uint32_t mapped;
+		uint32_t evicted;
+		uint32_t waiting;		// requested and still not resident, for lack of budget or pool tiles
+		uint32_t resident;		// pages in the pool, the packed mips aside
+	};
+
+	class VirtualTexture
+	{
+	public:
+		static const uint32_t invalid_pool_tile = ~0u;
+
+		VirtualTexture( );
+
+		// pool_tile_count tiles in the heap, the packed mips take the first layout.packed_tile_count of them. False
+		// when they don't fit or the layout has more mips or tiles than page keys hold
+		bool Init( const VirtualTextureLayout& layout, uint32_t pool_tile_count );
+
+		// feedback of the frame being drawn, in any number of calls: page keys in any order, with repeats.
+		// invalid_virtual_page entries and pages outside the texture are skipped. A page asks for the mips above it too
+		void AddFeedback( const uint32_t* pages, size_t count );
+
+		// ends the frame: maps up to map_budget of the requested pages that aren't resident, coarsest mip first,
+		// and evicts the pages least recently requested to make room. Pages requested this frame are never
+		// evicted. updates gets each changed page once. The data of newly mapped pages has to be copied into
+		// their tiles before anything samples them
+		void Update( uint32_t map_budget, std::vector<VirtualTileUpdate>& updates );
+
+		// the pool tile of a resident page, invalid_pool_tile when it isn't
+		uint32_t PoolTile( uint32_t page ) const;
+
+		// width_in_tiles[0] x height_in_tiles[0] bytes, for each tile of mip 0 the finest mip resident over it,
+		// mip_count where only the packed mips are. What a shader clamps its lod to, so it never samples an
+		// unmapped tile
+		void MinMipMap( uint8_t* map ) const;
+
+		const VirtualTextureLayout& Layout( ) const { return layout; }
+		uint32_t PoolTileCount( ) const { return uint32_t( tiles.size( ) ); }
+		const VirtualTextureStats& Stats( ) const { return stats; }
+
+	private:
+		struct Tile
+		{
+			uint32_t page;
+			uint32_t older;		// least recently requested list, through pool tiles
+			uint32_t newer;
+		};
+
+		uint32_t PageIndex( uint32_t page ) const;
+		uint32_t Parent( uint32_t page ) const;
+		void Unlink( uint32_t tile );
+		void PushNewest( uint32_t tile );
+		void Touch( const std::vector<uint32_t>& pages );
+		uint32_t TakeTile( std::vector<VirtualTileUpdate>& updates );
+
+		VirtualTextureLayout layout;
+		uint32_t first_page[virtual_texture_max_mips];	// where each mip starts in the page arrays
+		std::vector<uint32_t> page_tiles;				// per page, its pool tile
+		std::vector<uint32_t> requested_frame;			// per page, the last frame whose feedback asked for it
+		std::vector<uint8_t> resident_children;			// per page, how many of the pages below it are resident
+		std::vector<Tile> tiles;
+		std::vector<uint32_t> free_tiles;				// heap, lowest first so neighboring pages tend to get neighboring tiles
+		std::vector<uint32_t> requested;				// this frame's pages
+		uint32_t oldest;
+		uint32_t newest;
+		uint32_t frame;
+		VirtualTextureStats stats;
+	};
+
+	// updates as few runs as UpdateTileMappings needs: in tile order, neighbors merged when both are unmapped or
+	// their pool tiles follow on from each other as well
+	void BuildTileRuns( const VirtualTextureLayout& layout, const std::vector<VirtualTileUpdate>& updates, std::vector<VirtualTileRun>& runs );
+}
@@ -0,0 +1,127 @@
+#include "VirtualTextureResources.h"
+
+#include <cstring>
+
+#include "d3dx12.h"
+
+namespace DXLayer
+{
+	VirtualTextureResources::VirtualTextureResources( )
+		: texture( nullptr ), tile_pool( nullptr ), texture_state( D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE )
+	{ }
+
+	bool VirtualTextureResources::Init( ID3D12Device* device, ID3D12CommandQueue* queue, const D3D12_RESOURCE_DESC& desc, UINT pool_tile_count, VirtualTextureLayout& layout )
+	{
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = { };
+		if ( FAILED( device->CheckFeatureSupport( D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof( options ) ) ) ||
+			options.TiledResourcesTier == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED )
+			return false;
+		if ( desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || desc.DepthOrArraySize != 1 || desc.MipLevels > virtual_texture_max_mips )
+			return false;
+
+		// reserved resources always have the 64 KB tiles, their layout is the driver's
+		D3D12_RESOURCE_DESC reserved_desc = desc;
+		reserved_desc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+		texture_state = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		if ( FAILED( device->CreateReservedResource( &reserved_desc, texture_state, nullptr, IID_PPV_ARGS( &texture ) ) ) )
+			return false;
+		texture->SetName( L"Virtual Texture" );
+
+		const CD3DX12_HEAP_DESC heap_desc( UINT64( pool_tile_count ) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, D3D12_HEAP_TYPE_DEFAULT, 0,
+			D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES );
+		if ( FAILED( device->CreateHeap( &heap_desc, IID_PPV_ARGS( &tile_pool ) ) ) )
+			return false;
+		tile_pool->SetName( L"Virtual Texture Tile Pool" );
+
+		UINT tile_count;
+		D3D12_PACKED_MIP_INFO packed_mips;
+		D3D12_TILE_SHAPE tile_shape;
+		UINT subresource_count = texture->GetDesc( ).MipLevels;
+		D3D12_SUBRESOURCE_TILING tilings[virtual_texture_max_mips];
+		device->GetResourceTiling( texture, &tile_count, &packed_mips, &tile_shape, &subresource_count, 0, tilings );
+		std::memset( &layout, 0, sizeof( layout ) );
+		layout.mip_count = packed_mips.NumStandardMips;
+		for ( UINT mip = 0; mip < layout.mip_count; ++mip )
+		{
+			layout.width_in_tiles[mip] = tilings[mip].WidthInTiles;
+			layout.height_in_tiles[mip] = tilings[mip].HeightInTiles;
+		}
+		layout.tile_width = tile_shape.WidthInTexels;
+		layout.tile_height = tile_shape.HeightInTexels;
+		layout.packed_mip_count = packed_mips.NumPackedMips;
+		layout.packed_tile_count = packed_mips.NumTilesForPackedMips;
+		if ( pool_tile_count < layout.packed_tile_count )
+			return false;
+
+		// the packed mips are one region from the first of them, they can only be mapped together
+		if ( layout.packed_tile_count )
+		{
+			const CD3DX12_TILED_RESOURCE_COORDINATE coordinate( 0, 0, 0, layout.mip_count );
+			const CD3DX12_TILE_REGION_SIZE region_size( layout.packed_tile_count, FALSE, 0, 0, 0 );
+			const D3D12_TILE_RANGE_FLAGS flags = D3D12_TILE_RANGE_FLAG_NONE;
+			const UINT range_start = 0;
+			queue->UpdateTileMappings( texture, 1, &coordinate, &region_size, tile_pool, 1, &flags, &range_start, &layout.packed_tile_count, D3D12_TILE_MAPPING_FLAG_NONE );
+		}
+		return true;
+	}
+
+	void VirtualTextureResources::UpdateMappings( ID3D12CommandQueue* queue, const std::vector<VirtualTileRun>& runs )
+	{
+		if ( runs.empty( ) )
+			return;
+
+		// each run is a region and the range of pool tiles it maps to, unmapped runs take a null range
+		coordinates.resize( runs.size( ) );
+		region_sizes.resize( runs.size( ) );
+		range_flags.resize( runs.size( ) );
+		range_starts.resize( runs.size( ) );
+		range_tile_counts.resize( runs.size( ) );
+		for ( size_t i = 0; i < runs.size( ); ++i )
+		{
+			const VirtualTileRun& run = runs[i];
+			const bool unmap = run.pool_tile == VirtualTexture::invalid_pool_tile;
+			coordinates[i] = CD3DX12_TILED_RESOURCE_COORDINATE( run.x, run.y, 0, run.mip );
+			region_sizes[i] = CD3DX12_TILE_REGION_SIZE( run.tile_count, FALSE, 0, 0, 0 );
+			range_flags[i] = unmap ? D3D12_TILE_RANGE_FLAG_NULL : D3D12_TILE_RANGE_FLAG_NONE;
+			range_starts[i] = unmap ? 0 : run.pool_tile;
+			range_tile_counts[i] = run.tile_count;
+		}
+		queue->UpdateTileMappings( texture, UINT( runs.size( ) ), coordinates.data( ), region_sizes.data( ), tile_pool,
+			UINT( runs.size( ) ), range_flags.data( ), range_starts.data( ), range_tile_counts.data( ), D3D12_TILE_MAPPING_FLAG_NONE );
+	}
+
+	void VirtualTextureResources::UploadPages( ID3D12GraphicsCommandList* command_list, const uint32_t* pages, UINT page_count, ID3D12Resource* upload, UINT64 offset )
+	{
+		if ( !page_count )
+			return;
+
+		Transition( command_list, D3D12_RESOURCE_STATE_COPY_DEST );
+		for ( UINT p = 0; p < page_count; ++p )
+		{
+			const CD3DX12_TILED_RESOURCE_COORDINATE coordinate( VirtualPageX( pages[p] ), VirtualPageY( pages[p] ), 0, VirtualPageMip( pages[p] ) );
+			const CD3DX12_TILE_REGION_SIZE region_size( 1, FALSE, 0, 0, 0 );
+			command_list->CopyTiles( texture, &coordinate, &region_size, upload, offset + UINT64( p ) * virtual_tile_bytes,
+				D3D12_TILE_COPY_FLAG_LINEAR_BUFFER_TO_SWIZZLED_TILED_RESOURCE );
+		}
+		Transition( command_list, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+	}
+
+	void VirtualTextureResources::Release( )
+	{
+		if ( texture )
+			texture->Release( );
+		if ( tile_pool )
+			tile_pool->Release( );
+		texture = nullptr;
+		tile_pool = nullptr;
+	}
+
+	void VirtualTextureResources::Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES state )
+	{
+		if ( state == texture_state )
+			return;
+		const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition( texture, texture_state, state );
+		command_list->ResourceBarrier( 1, &barrier );
+		texture_state = state;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <vector>
+
+#include "VirtualTexture.h"
+
+namespace DXLayer
+{
+	// the reserved texture and the tile pool heap behind a VirtualTexture. Mappings change on the queue, between the
+	// command lists it runs, tile data is copied in on a command list. Between copies the texture sits in the
+	// pixel shader resource state
+	class VirtualTextureResources
+	{
+	public:
+		VirtualTextureResources( );
+
+		// a reserved resource for desc, a 2d texture with one array slice, and a heap of pool_tile_count tiles.
+		// layout comes from GetResourceTiling. The packed mips are mapped to the first tiles of the heap right
+		// away, they're regular subresources for UploadTextures. False without tiled resources support
+		bool Init( ID3D12Device* device, ID3D12CommandQueue* queue, const D3D12_RESOURCE_DESC& desc, UINT pool_tile_count, VirtualTextureLayout& layout );
+
+		// a frame's runs in one UpdateTileMappings call, before the command lists that copy into the new tiles
+		void UpdateMappings( ID3D12CommandQueue* queue, const std::vector<VirtualTileRun>& runs );
+
+		// copies whole tiles into pages from upload, virtual_tile_bytes each from offset on. A tile's data is its
+		// rows of texels, or of blocks, one after the other as CopyTiles reads a linear buffer
+		void UploadPages( ID3D12GraphicsCommandList* command_list, const uint32_t* pages, UINT page_count, ID3D12Resource* upload, UINT64 offset );
+
+		ID3D12Resource* Texture( ) const { return texture; }
+
+		void Release( );
+
+	private:
+		void Transition( ID3D12GraphicsCommandList* command_list, D3D12_RESOURCE_STATES state );
+
+		ID3D12Resource* texture;
+		ID3D12Heap* tile_pool;
+		D3D12_RESOURCE_STATES texture_state;
+		std::vector<D3D12_TILED_RESOURCE_COORDINATE> coordinates;	// kept between frames, like the runs
+		std::vector<D3D12_TILE_REGION_SIZE> region_sizes;
+		std::vector<D3D12_TILE_RANGE_FLAGS> range_flags;
+		std::vector<UINT> range_starts;
+		std::vector<UINT> range_tile_counts;
+	};
+}
@@ -1,8 +1,21 @@
 // as-is screen space vertex shader
 
+#include "vertex_decode.hlsli"
+
+// per-draw data, set as root constants (see PerDrawLayout in ShaderConstants.h)
+cbuffer PerDraw : register( b0 )
+{
+    float3 bounds_center;
+    uint object_index;
+    float3 bounds_extent;
+    uint material_index;
+    float4 tint;
+};
+
+// CompactVertex, both attributes are expanded to float by the input assembler
 struct VS_INPUT
 {
-    float3 pos : POSITION;
+    float4 pos : POSITION; // snorm, relative to the mesh bounds
     float4 color : COLOR;
 };
 
@@ -16,7 +29,7 @@ struct VS_OUTPUT
 VS_OUTPUT main( VS_INPUT input )
 {
     VS_OUTPUT output;
-    output.pos = float4( input.pos, 1.0f );
-    output.color = input.color;
+    output.pos = float4( DecodePosition( input.pos.xyz, bounds_center, bounds_extent ), 1.0f );
+    output.color = input.color * tint;
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,8 @@
+// decoding of the compact vertex formats, see VertexEncoding.cpp for the encoding side. No shader reads normals
+// yet, DecodeNormalOct16 there is what one would do
+
+// positions are stored as snorm relative to the mesh bounds
+float3 DecodePosition( float3 snorm_pos, float3 bounds_center, float3 bounds_extent )
+{
+    return bounds_center + snorm_pos * bounds_extent;
+}